@@ -16,15 +16,15 @@
  */
 
 #include "ble.h"
-#include "ble_ota.h"
+#include "ble_link.h"
 #include "ble_ota_handler.h"
-#include "ble_ota_integration.h"
 #include "bsp.h"
 #include "commands.h"
 #include "esp_efuse.h"
 #include "esp_log.h"
 #include "esp_random.h"
 #include "config_manager.h"
+#include "rpc_frame.h"
 #include "sdkconfig.h"
 #include "version.h"
 #include <inttypes.h>
@@ -64,16 +64,18 @@ static const ble_uuid128_t NUS_CHR_TX_UUID =
 // CONFIGURATION
 //==============================================================================
 
-#define BLE_CMD_QUEUE_SIZE 10
-#define BLE_CMD_TASK_STACK_SIZE 6144
-#define BLE_CMD_TASK_PRIORITY 5
 #define BLE_CMD_MAX_LENGTH 2048
 #define BLE_RESPONSE_MAX_LENGTH 2048
 #define BLE_MTU_MAX 512
 #define BLE_DEFAULT_MTU 23
 #define BLE_MUTEX_WAIT_MS 100
 #define BLE_ADV_START_DELAY_MS 100
-#define BLE_CHUNK_DELAY_MS 10
+#define BLE_TX_MBUF_RESERVE 4 // msys blocks left for the host's own ACL/ATT traffic
+#define BLE_TX_STALL_MS 2000  // Give up on a response after this long without a free buffer
+#define BLE_TX_MBUF_BLOCK_SIZE CONFIG_BT_NIMBLE_MSYS_1_BLOCK_SIZE
+#define BLE_LINK_BULK_BYTES 1024 // Responses past this switch the link to the throughput profile
+// Data blocks plus one for the packet header and the L2CAP/ATT headers in front of the data
+#define BLE_TX_MBUF_BLOCKS(len) (((len) + BLE_TX_MBUF_BLOCK_SIZE - 1) / BLE_TX_MBUF_BLOCK_SIZE + 1)
 #define BLE_ADV_TASK_STACK_SIZE 3072
 #define BLE_ADV_TASK_PRIORITY 5
 
@@ -92,11 +94,6 @@ typedef struct {
     uint32_t passkey;
 } ble_conn_state_t;
 
-typedef struct {
-    char data[BLE_CMD_MAX_LENGTH];
-    size_t len;
-} ble_cmd_t;
-
 static bool s_ble_initialized = false;
 static bool s_ble_enabled     = false;
 static uint16_t s_nus_tx_handle;
@@ -108,11 +105,31 @@ static ble_conn_state_t s_conn_state        = {.conn_handle           = BLE_HS_C
                                                .pairing_active        = false,
                                                .passkey               = 0};
 static SemaphoreHandle_t s_conn_state_mutex = NULL;
-static QueueHandle_t s_cmd_queue            = NULL;
-static TaskHandle_t s_cmd_task_handle       = NULL;
+static char s_cmd_buf[BLE_CMD_MAX_LENGTH]; // Only touched from the NimBLE host task
+static char s_frame_buf[BLE_CMD_MAX_LENGTH];
+static rpc_rx_t s_frame_rx; // Binary frames may span several writes; host task only
+static bool s_frame_bulk;   // Holds the throughput link profile while a frame spans writes
+static ble_link_hold_t s_frame_hold;
+
+// Response in flight; the pool runs one BLE request at a time
+typedef struct {
+    bool active;            // Between the first write and ble_response_end()
+    bool failed;            // A chunk was dropped, so the rest of the response is skipped
+    bool bulk;              // Holds the throughput link profile until ble_response_end()
+    ble_link_hold_t hold;   // Taken on the connection the response started on
+    uint32_t bytes;
+    uint32_t notifications;
+    uint32_t stalls;        // Times the msys pool ran dry and the writer had to wait
+    TickType_t start;
+} ble_tx_state_t;
+
+static ble_tx_state_t s_tx;
+static SemaphoreHandle_t s_tx_wake = NULL; // Given on NOTIFY_TX and disconnect
 
 // Forward declarations
-static void ble_send_response(const char *response);
+static void ble_response_write(const char *data, size_t len, void *ctx);
+static void ble_response_end(bool binary, void *ctx);
+static bool ble_route_authenticated(void *ctx);
 static void ble_advertise(void);
 
 //==============================================================================
@@ -135,27 +152,20 @@ static void conn_state_unlock(void)
 }
 
 //==============================================================================
-// COMMAND PROCESSING TASK
+// NUS CHARACTERISTIC ACCESS
 //==============================================================================
 
-static void ble_cmd_task(void *arg)
+static void ble_on_frame(char *msg, size_t len, bool binary, void *ctx)
 {
-    ESP_LOGI(TAG, "Command task started");
-
-    ble_cmd_t cmd;
-
-    while (1) {
-        if (xQueueReceive(s_cmd_queue, &cmd, portMAX_DELAY) == pdTRUE) {
-            ESP_LOGI(TAG, "Processing command: %s", cmd.data);
-            commands_execute(cmd.data, ble_send_response);
-        }
+    (void)ctx;
+    if (!binary) {
+        return; // JSON commands are whole writes, handled by nus_chr_access()
+    }
+    if (commands_submit_frame(COMMAND_TRANSPORT_BLE, msg, len) != ESP_OK) {
+        ESP_LOGW(TAG, "Command queue full, dropping binary request");
     }
 }
 
-//==============================================================================
-// NUS CHARACTERISTIC ACCESS
-//==============================================================================
-
 static int nus_chr_access(uint16_t conn_handle, uint16_t attr_handle, struct ble_gatt_access_ctxt *ctxt, void *arg)
 {
     switch (ctxt->op) {
@@ -170,23 +180,40 @@ static int nus_chr_access(uint16_t conn_handle, uint16_t attr_handle, struct ble
                 return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
             }
 
-            ble_cmd_t cmd = {0};
             uint16_t len_out;
-            int rc = ble_hs_mbuf_to_flat(ctxt->om, cmd.data, sizeof(cmd.data) - 1, &len_out);
+            int rc = ble_hs_mbuf_to_flat(ctxt->om, s_cmd_buf, sizeof(s_cmd_buf) - 1, &len_out);
             if (rc != 0) {
                 ESP_LOGE(TAG, "Failed to copy mbuf: %d", rc);
                 return BLE_ATT_ERR_UNLIKELY;
             }
 
-            cmd.len           = len_out;
-            cmd.data[cmd.len] = '\0';
+            size_t len     = len_out;
+            s_cmd_buf[len] = '\0';
+
+            ble_link_account(len);
+
+            // A JSON command never contains a zero byte, a binary frame starts with one
+            if (s_frame_rx.binary || s_cmd_buf[0] == RPC_FRAME_DELIMITER) {
+                rpc_rx_feed(&s_frame_rx, (const uint8_t *)s_cmd_buf, len, ble_on_frame, NULL);
+                if (s_frame_rx.binary != s_frame_bulk) {
+                    s_frame_bulk = s_frame_rx.binary;
+                    if (s_frame_bulk) {
+                        s_frame_hold = ble_link_acquire();
+                    } else {
+                        ble_link_release(s_frame_hold);
+                    }
+                }
+                return 0;
+            }
 
             // Strip trailing CR/LF (same as UART handler)
-            while (cmd.len > 0 && (cmd.data[cmd.len - 1] == '\r' || cmd.data[cmd.len - 1] == '\n')) {
-                cmd.data[--cmd.len] = '\0';
+            while (len > 0 && (s_cmd_buf[len - 1] == '\r' || s_cmd_buf[len - 1] == '\n')) {
+                s_cmd_buf[--len] = '\0';
             }
 
-            if (xQueueSend(s_cmd_queue, &cmd, 0) != pdTRUE) {
+            // Executed by the command worker pool; the host task only queues
+            ESP_LOGI(TAG, "Received command: %s", s_cmd_buf);
+            if (commands_submit(COMMAND_TRANSPORT_BLE, s_cmd_buf) != ESP_OK) {
                 ESP_LOGW(TAG, "Command queue full, dropping command");
                 return BLE_ATT_ERR_INSUFFICIENT_RES;
             }
@@ -260,18 +287,11 @@ static int gap_event_handler(struct ble_gap_event *event, void *arg)
                     }
 
                     // Set connection handle for OTA operations
-                    ble_ota_set_connection_handle(event->connect.conn_handle);
                     ble_ota_handler_set_connection(event->connect.conn_handle);
                 }
 
-                // Request connection parameter update for low latency
-                struct ble_gap_upd_params params = {
-                    .itvl_min            = BLE_GAP_INITIAL_CONN_ITVL_MIN,
-                    .itvl_max            = BLE_GAP_INITIAL_CONN_ITVL_MAX,
-                    .latency             = BLE_GAP_INITIAL_CONN_LATENCY,
-                    .supervision_timeout = BLE_GAP_INITIAL_SUPERVISION_TIMEOUT,
-                };
-                ble_gap_update_params(event->connect.conn_handle, &params);
+                // Idle until an OTA or a large RPC asks for the throughput profile
+                ble_link_connected(event->connect.conn_handle);
 
             } else {
                 ESP_LOGE(TAG, "Connection failed; status=%d", event->connect.status);
@@ -288,6 +308,13 @@ static int gap_event_handler(struct ble_gap_event *event, void *arg)
                 s_conn_state.notifications_enabled = false;
                 conn_state_unlock();
             }
+            if (s_tx_wake) {
+                xSemaphoreGive(s_tx_wake); // A stalled response writer gives up now, not at its timeout
+            }
+            ble_ota_handler_set_connection(BLE_HS_CONN_HANDLE_NONE);
+            ble_link_disconnected();
+            rpc_rx_init(&s_frame_rx, s_frame_buf, sizeof(s_frame_buf), false);
+            s_frame_bulk = false;
 
             // Restart advertising
             ble_advertise();
@@ -303,6 +330,11 @@ static int gap_event_handler(struct ble_gap_event *event, void *arg)
             }
             break;
 
+        case BLE_GAP_EVENT_PHY_UPDATE_COMPLETE:
+            ESP_LOGI(TAG, "PHY update: status=%d tx=%d rx=%d", event->phy_updated.status, event->phy_updated.tx_phy,
+                     event->phy_updated.rx_phy);
+            break;
+
         case BLE_GAP_EVENT_MTU:
             ESP_LOGI(TAG, "MTU update: channel_id=%d, mtu=%d", event->mtu.channel_id, event->mtu.value);
 
@@ -325,6 +357,13 @@ static int gap_event_handler(struct ble_gap_event *event, void *arg)
             }
             break;
 
+        case BLE_GAP_EVENT_NOTIFY_TX:
+            // Queued or failed; either way a stalled response writer should look at the pool again
+            if (!event->notify_tx.indication && s_tx_wake) {
+                xSemaphoreGive(s_tx_wake);
+            }
+            break;
+
         case BLE_GAP_EVENT_PASSKEY_ACTION:
             ESP_LOGI(TAG, "=== Passkey Action Event ===");
 
@@ -590,32 +629,38 @@ esp_err_t ble_init(void)
         }
     }
 
-    // Create command queue
-    s_cmd_queue = xQueueCreate(BLE_CMD_QUEUE_SIZE, sizeof(ble_cmd_t));
-    if (!s_cmd_queue) {
-        ESP_LOGE(TAG, "Failed to create command queue");
-        // Do not delete mutex here as it might be in use by other tasks
-        return ESP_ERR_NO_MEM;
+    // Kept across deinit like the mutex; a pool worker may still be waiting on it
+    if (!s_tx_wake) {
+        s_tx_wake = xSemaphoreCreateBinary();
+        if (!s_tx_wake) {
+            ESP_LOGE(TAG, "Failed to create TX semaphore");
+            return ESP_ERR_NO_MEM;
+        }
     }
 
-    // Create command processing task
-    BaseType_t ret =
-        xTaskCreate(ble_cmd_task, "ble_cmd", BLE_CMD_TASK_STACK_SIZE, NULL, BLE_CMD_TASK_PRIORITY, &s_cmd_task_handle);
-    if (ret != pdPASS) {
-        ESP_LOGE(TAG, "Failed to create command task");
-        vQueueDelete(s_cmd_queue);
-        s_cmd_queue = NULL;
-        // Do not delete mutex here
-        return ESP_ERR_NO_MEM;
+    esp_err_t rc = ble_link_init();
+    if (rc != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to init link profiles: %s", esp_err_to_name(rc));
+        return rc;
+    }
+
+    // Commands received over NUS run on the shared command worker pool
+    static const command_route_t ble_route = {.write         = ble_response_write,
+                                              .end           = ble_response_end,
+                                              .link          = RPC_LINK_BLE,
+                                              .authenticated = ble_route_authenticated};
+    rpc_rx_init(&s_frame_rx, s_frame_buf, sizeof(s_frame_buf), false);
+    rc = commands_register_transport(COMMAND_TRANSPORT_BLE, &ble_route);
+    if (rc != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register command route: %s", esp_err_to_name(rc));
+        // Do not delete mutex here as it might be in use by other tasks
+        return rc;
     }
 
     // Initialize NimBLE
-    esp_err_t rc = nimble_port_init();
+    rc = nimble_port_init();
     if (rc != ESP_OK) {
         ESP_LOGE(TAG, "Failed to init nimble: %d", rc);
-        vTaskDelete(s_cmd_task_handle);
-        vQueueDelete(s_cmd_queue);
-        s_cmd_queue = NULL;
         // Do not delete mutex here
         return rc;
     }
@@ -641,9 +686,6 @@ esp_err_t ble_init(void)
     if (rc != 0) {
         ESP_LOGE(TAG, "Failed to count GATT cfg: %d", rc);
         nimble_port_deinit();
-        vTaskDelete(s_cmd_task_handle);
-        vQueueDelete(s_cmd_queue);
-        s_cmd_queue = NULL;
         vSemaphoreDelete(s_conn_state_mutex);
         s_conn_state_mutex = NULL;
         return ESP_FAIL;
@@ -653,16 +695,13 @@ esp_err_t ble_init(void)
     if (rc != 0) {
         ESP_LOGE(TAG, "Failed to add GATT services: %d", rc);
         nimble_port_deinit();
-        vTaskDelete(s_cmd_task_handle);
-        vQueueDelete(s_cmd_queue);
-        s_cmd_queue = NULL;
         vSemaphoreDelete(s_conn_state_mutex);
         s_conn_state_mutex = NULL;
         return ESP_FAIL;
     }
 
     // Register BLE OTA services
-    rc = ble_ota_register_services();
+    rc = ble_ota_handler_register();
     if (rc != ESP_OK) {
         ESP_LOGW(TAG, "Failed to register OTA services, continuing without OTA");
     }
@@ -705,16 +744,6 @@ esp_err_t ble_deinit(void)
     nimble_port_stop();
     nimble_port_deinit();
 
-    if (s_cmd_task_handle) {
-        vTaskDelete(s_cmd_task_handle);
-        s_cmd_task_handle = NULL;
-    }
-
-    if (s_cmd_queue) {
-        vQueueDelete(s_cmd_queue);
-        s_cmd_queue = NULL;
-    }
-
     if (s_conn_state_mutex) {
         vSemaphoreDelete(s_conn_state_mutex);
         s_conn_state_mutex = NULL;
@@ -742,41 +771,94 @@ bool ble_is_connected(void)
     return connected;
 }
 
-static void ble_send_long_notification(uint16_t conn_handle, uint16_t attr_handle, const char *data, size_t len,
-                                       uint16_t mtu)
+static bool tx_link_up(uint16_t conn_handle)
 {
-    size_t chunk_size = mtu - 3; // ATT overhead
-    size_t offset     = 0;
+    bool up = false;
+    if (conn_state_lock()) {
+        up = s_conn_state.connected && s_conn_state.notifications_enabled && s_conn_state.conn_handle == conn_handle;
+        conn_state_unlock();
+    }
+    return up;
+}
+
+/**
+ * @brief Notify as fast as the controller drains, waiting only while the msys pool is dry
+ *
+ * Blocks return to the pool when the controller reports the ACL packets carrying earlier
+ * notifications as completed, so the free count is the credit. NimBLE raises NOTIFY_TX as
+ * soon as a notification is queued, which only serves to wake a stalled writer early.
+ */
+static esp_err_t ble_send_long_notification(uint16_t conn_handle, uint16_t attr_handle, const char *data, size_t len,
+                                            uint16_t mtu)
+{
+    size_t chunk_size      = mtu - 3; // ATT overhead
+    size_t offset          = 0;
+    bool stalled           = false;
+    TickType_t stall_start = 0;
 
     while (offset < len) {
         size_t to_send = (len - offset > chunk_size) ? chunk_size : (len - offset);
 
-        struct os_mbuf *om = ble_hs_mbuf_from_flat(data + offset, to_send);
-        if (!om) {
-            ESP_LOGE(TAG, "Failed to allocate mbuf");
-            return;
+        int rc = BLE_HS_ENOMEM;
+        if (os_msys_num_free() >= BLE_TX_MBUF_BLOCKS(to_send) + BLE_TX_MBUF_RESERVE) {
+            struct os_mbuf *om = ble_hs_mbuf_from_flat(data + offset, to_send);
+            if (om) {
+                rc = ble_gattc_notify_custom(conn_handle, attr_handle, om); // Frees om on failure too
+            }
         }
 
-        int rc = ble_gattc_notify_custom(conn_handle, attr_handle, om);
-        if (rc != 0) {
+        if (rc == 0) {
+            offset += to_send;
+            s_tx.bytes += to_send;
+            s_tx.notifications++;
+            ble_link_account(to_send);
+            stalled = false;
+            continue;
+        }
+        if (rc != BLE_HS_ENOMEM) {
             ESP_LOGE(TAG, "Failed to send notification: %d", rc);
-            return;
+            return ESP_FAIL;
         }
 
-        offset += to_send;
-
-        if (offset < len) {
-            vTaskDelay(pdMS_TO_TICKS(BLE_CHUNK_DELAY_MS)); // Small delay between chunks
+        // Congested: retry the same chunk once the controller has freed some blocks
+        if (!stalled) {
+            stalled     = true;
+            stall_start = xTaskGetTickCount();
+            s_tx.stalls++;
+        }
+        if (!tx_link_up(conn_handle)) {
+            ESP_LOGW(TAG, "Link lost; dropped %u of %u bytes", (unsigned)(len - offset), (unsigned)len);
+            return ESP_ERR_INVALID_STATE;
+        }
+        if (xTaskGetTickCount() - stall_start >= pdMS_TO_TICKS(BLE_TX_STALL_MS)) {
+            ESP_LOGE(TAG, "No TX buffers for %d ms; dropped %u of %u bytes", BLE_TX_STALL_MS, (unsigned)(len - offset),
+                     (unsigned)len);
+            return ESP_ERR_TIMEOUT;
         }
+        xSemaphoreTake(s_tx_wake, 1);
     }
+
+    return ESP_OK;
 }
 
-void ble_send_response(const char *response)
+static void ble_response_write(const char *data, size_t len, void *ctx)
 {
-    if (!response || strlen(response) == 0) {
+    (void)ctx;
+    if (len == 0) {
         return;
     }
 
+    if (!s_tx.active) {
+        s_tx = (ble_tx_state_t){.active = true, .start = xTaskGetTickCount()};
+    }
+    if (s_tx.failed) {
+        return; // A truncated response is easier on the client than one with a hole in it
+    }
+    if (!s_tx.bulk && s_tx.bytes + len > BLE_LINK_BULK_BYTES) {
+        s_tx.bulk = true;
+        s_tx.hold = ble_link_acquire();
+    }
+
     bool can_send = false;
     uint16_t conn_handle;
     uint16_t mtu;
@@ -790,10 +872,45 @@ void ble_send_response(const char *response)
 
     if (!can_send) {
         ESP_LOGW(TAG, "Cannot send: not connected or notifications disabled");
+        s_tx.failed = true;
         return;
     }
 
-    ble_send_long_notification(conn_handle, s_nus_tx_handle, response, strlen(response), mtu);
+    if (ble_send_long_notification(conn_handle, s_nus_tx_handle, data, len, mtu) != ESP_OK) {
+        s_tx.failed = true;
+    }
+}
+
+static void ble_response_end(bool binary, void *ctx)
+{
+    (void)binary; // NUS responses are one notification stream either way
+    (void)ctx;
+    if (s_tx.active && (s_tx.notifications > 1 || s_tx.failed)) {
+        uint32_t ms = pdTICKS_TO_MS(xTaskGetTickCount() - s_tx.start);
+        ESP_LOGI(TAG, "Response: %lu bytes in %lu notifications, %lu ms (%lu B/s), %lu stalls%s",
+                 (unsigned long)s_tx.bytes, (unsigned long)s_tx.notifications, (unsigned long)ms,
+                 (unsigned long)(ms ? (uint64_t)s_tx.bytes * 1000 / ms : 0), (unsigned long)s_tx.stalls,
+                 s_tx.failed ? ", truncated" : "");
+    }
+    if (s_tx.bulk) {
+        ble_link_release(s_tx.hold);
+    }
+    s_tx.active = false;
+}
+
+// Secrets and destructive methods need a bonded central, same as the OTA service
+static bool ble_route_authenticated(void *ctx)
+{
+    (void)ctx;
+    uint16_t conn_handle = BLE_HS_CONN_HANDLE_NONE;
+    if (conn_state_lock()) {
+        conn_handle = s_conn_state.conn_handle;
+        conn_state_unlock();
+    }
+
+    struct ble_gap_conn_desc desc;
+    return conn_handle != BLE_HS_CONN_HANDLE_NONE && ble_gap_conn_find(conn_handle, &desc) == 0 &&
+           desc.sec_state.bonded;
 }
 
 esp_err_t ble_set_enabled(bool enabled)
@@ -0,0 +1,222 @@
+/**
+ * @file ble_link.c
+ * @brief BLE link profiles: low power while idle, 2M PHY and short intervals for bulk data
+ *
+ * CONTEXT: NimBLE peripheral; the central decides, we can only request
+ * PURPOSE: Profile switching with nested holds and per-profile throughput logging, so
+ *          configurations can be compared from the logs of a real transfer
+ */
+
+#include "ble_link.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "host/ble_gap.h"
+#include "host/ble_hs.h"
+#include <inttypes.h>
+#include <string.h>
+
+static const char *TAG = "ble_link";
+
+typedef struct {
+    const char *name;
+    uint8_t phy_mask;             // Preferred PHYs, both directions
+    uint16_t itvl_min;            // 1.25 ms units
+    uint16_t itvl_max;            // 1.25 ms units
+    uint16_t latency;             // Connection events the peripheral may skip
+    uint16_t supervision_timeout; // 10 ms units
+    uint16_t tx_octets;           // Link-layer payload per PDU, 27..251; 0 keeps what the link has
+    uint16_t tx_time;             // us on air for tx_octets at 1M, as the HCI command expects
+} ble_link_params_t;
+
+// Low power keeps the connect-time interval and does not touch the data length: an idle link
+// sends empty PDUs whatever the maximum is, and a central that negotiated long PDUs keeps them
+// for the odd response instead of paying a data length update on every connect and release.
+// The cost is that such a response goes out in long PDUs, a longer radio burst per event
+static const ble_link_params_t PROFILES[BLE_LINK_PROFILE_COUNT] = {
+    [BLE_LINK_PROFILE_LOW_POWER]  = {.name                = "low-power",
+                                     .phy_mask            = BLE_GAP_LE_PHY_1M_MASK | BLE_GAP_LE_PHY_2M_MASK,
+                                     .itvl_min            = BLE_GAP_INITIAL_CONN_ITVL_MIN,
+                                     .itvl_max            = BLE_GAP_INITIAL_CONN_ITVL_MAX,
+                                     .latency             = BLE_GAP_INITIAL_CONN_LATENCY,
+                                     .supervision_timeout = BLE_GAP_INITIAL_SUPERVISION_TIMEOUT,
+                                     .tx_octets           = 0,
+                                     .tx_time             = 0},
+    [BLE_LINK_PROFILE_THROUGHPUT] = {.name                = "throughput",
+                                     .phy_mask            = BLE_GAP_LE_PHY_2M_MASK,
+                                     .itvl_min            = 6,  // 7.5 ms
+                                     .itvl_max            = 12, // 15 ms
+                                     .latency             = 0,
+                                     .supervision_timeout = 400,
+                                     .tx_octets           = 251,
+                                     .tx_time             = 2120},
+};
+
+// Bytes of one profile; the time runs from the first to the last byte, so idle gaps between
+// transfers do not dilute the rate
+typedef struct {
+    uint32_t bytes;
+    uint32_t ticks;
+} ble_link_total_t;
+
+static SemaphoreHandle_t s_switch_mutex = NULL; // Orders profile switches from several tasks
+static portMUX_TYPE s_stats_lock        = portMUX_INITIALIZER_UNLOCKED;
+static uint16_t s_conn_handle           = BLE_HS_CONN_HANDLE_NONE;
+static uint8_t s_holds                  = 0;
+static ble_link_hold_t s_generation     = 0; // Bumped on connect and disconnect; tags the holds
+static ble_link_profile_t s_profile     = BLE_LINK_PROFILE_LOW_POWER;
+static ble_link_total_t s_period; // Current profile since the last switch
+static TickType_t s_period_first;
+static ble_link_total_t s_totals[BLE_LINK_PROFILE_COUNT];
+
+static uint32_t rate(const ble_link_total_t *t)
+{
+    uint32_t ms = pdTICKS_TO_MS(t->ticks);
+    return ms ? (uint32_t)((uint64_t)t->bytes * 1000 / ms) : 0;
+}
+
+static void apply_profile(uint16_t conn_handle, ble_link_profile_t profile)
+{
+    const ble_link_params_t *p = &PROFILES[profile];
+
+    int rc = ble_gap_set_prefered_le_phy(conn_handle, p->phy_mask, p->phy_mask, BLE_GAP_LE_PHY_CODED_ANY);
+    if (rc != 0) {
+        ESP_LOGW(TAG, "PHY request failed: %d", rc);
+    }
+
+    if (p->tx_octets > 0) {
+        rc = ble_gap_set_data_len(conn_handle, p->tx_octets, p->tx_time);
+        if (rc != 0) {
+            ESP_LOGW(TAG, "Data length request failed: %d", rc);
+        }
+    }
+
+    struct ble_gap_upd_params params = {
+        .itvl_min            = p->itvl_min,
+        .itvl_max            = p->itvl_max,
+        .latency             = p->latency,
+        .supervision_timeout = p->supervision_timeout,
+    };
+    rc = ble_gap_update_params(conn_handle, &params);
+    if (rc != 0) {
+        ESP_LOGW(TAG, "Connection parameter request failed: %d", rc);
+    }
+
+    if (p->tx_octets > 0) {
+        ESP_LOGI(TAG, "Requested %s profile, %u-byte PDUs", p->name, p->tx_octets);
+    } else {
+        ESP_LOGI(TAG, "Requested %s profile, data length unchanged", p->name);
+    }
+}
+
+// Fold the current period into its profile's total and start a new one
+static ble_link_total_t close_period(void)
+{
+    taskENTER_CRITICAL(&s_stats_lock);
+    ble_link_total_t period = s_period;
+    s_totals[s_profile].bytes += period.bytes;
+    s_totals[s_profile].ticks += period.ticks;
+    s_period = (ble_link_total_t){0};
+    taskEXIT_CRITICAL(&s_stats_lock);
+    return period;
+}
+
+static void switch_profile(ble_link_profile_t profile)
+{
+    ble_link_total_t period = close_period();
+    if (period.bytes > 0) {
+        ESP_LOGI(TAG, "%s: %" PRIu32 " bytes in %" PRIu32 " ms (%" PRIu32 " B/s)", PROFILES[s_profile].name,
+                 period.bytes, (uint32_t)pdTICKS_TO_MS(period.ticks), rate(&period));
+    }
+
+    s_profile = profile;
+    if (s_conn_handle != BLE_HS_CONN_HANDLE_NONE) {
+        apply_profile(s_conn_handle, profile);
+    }
+}
+
+esp_err_t ble_link_init(void)
+{
+    if (!s_switch_mutex) {
+        s_switch_mutex = xSemaphoreCreateMutex();
+        if (!s_switch_mutex) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    return ESP_OK;
+}
+
+void ble_link_connected(uint16_t conn_handle)
+{
+    xSemaphoreTake(s_switch_mutex, portMAX_DELAY);
+    taskENTER_CRITICAL(&s_stats_lock);
+    s_period = (ble_link_total_t){0};
+    memset(s_totals, 0, sizeof(s_totals));
+    taskEXIT_CRITICAL(&s_stats_lock);
+
+    s_conn_handle = conn_handle;
+    s_holds       = 0;
+    s_profile     = BLE_LINK_PROFILE_LOW_POWER;
+    s_generation++;
+    apply_profile(conn_handle, BLE_LINK_PROFILE_LOW_POWER);
+    xSemaphoreGive(s_switch_mutex);
+}
+
+void ble_link_disconnected(void)
+{
+    xSemaphoreTake(s_switch_mutex, portMAX_DELAY);
+    close_period();
+    for (int i = 0; i < BLE_LINK_PROFILE_COUNT; i++) {
+        if (s_totals[i].bytes > 0) {
+            ESP_LOGI(TAG, "Connection total, %s: %" PRIu32 " bytes in %" PRIu32 " ms (%" PRIu32 " B/s)",
+                     PROFILES[i].name, s_totals[i].bytes, (uint32_t)pdTICKS_TO_MS(s_totals[i].ticks),
+                     rate(&s_totals[i]));
+        }
+    }
+
+    s_conn_handle = BLE_HS_CONN_HANDLE_NONE;
+    s_holds       = 0;
+    s_profile     = BLE_LINK_PROFILE_LOW_POWER;
+    s_generation++;
+    xSemaphoreGive(s_switch_mutex);
+}
+
+ble_link_hold_t ble_link_acquire(void)
+{
+    xSemaphoreTake(s_switch_mutex, portMAX_DELAY);
+    if (s_holds++ == 0) {
+        switch_profile(BLE_LINK_PROFILE_THROUGHPUT);
+    }
+    ble_link_hold_t hold = s_generation;
+    xSemaphoreGive(s_switch_mutex);
+    return hold;
+}
+
+void ble_link_release(ble_link_hold_t hold)
+{
+    xSemaphoreTake(s_switch_mutex, portMAX_DELAY);
+    // A disconnect drops every hold; a transfer that outlived its link releases nothing on the next one
+    if (hold == s_generation && s_holds > 0 && --s_holds == 0) {
+        switch_profile(BLE_LINK_PROFILE_LOW_POWER);
+    }
+    xSemaphoreGive(s_switch_mutex);
+}
+
+void ble_link_account(size_t bytes)
+{
+    TickType_t now = xTaskGetTickCount();
+
+    taskENTER_CRITICAL(&s_stats_lock);
+    if (s_period.bytes == 0) {
+        s_period_first = now;
+    }
+    s_period.bytes += bytes;
+    s_period.ticks = now - s_period_first;
+    taskEXIT_CRITICAL(&s_stats_lock);
+}
+
+ble_link_profile_t ble_link_get_profile(void)
+{
+    return s_profile;
+}
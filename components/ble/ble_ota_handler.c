@@ -1,209 +1,340 @@
 /**
  * @file ble_ota_handler.c
- * @brief BLE OTA handler with streaming firmware update
+ * @brief BLE firmware upload through ota_engine with the ota_bulk stream
  *
  * Security model:
- * - Requires bonded/paired connection
- * - BLE pairing provides transport security
- * - Only accepts OTA from authenticated devices
+ * - Requires bonded/paired connection, checked on every write; the data characteristic
+ *   also needs an encrypted, authenticated link
+ * - firmware:upgrade / ota:resume (RPC_FLAG_AUTH, so bonded as well) start ota_engine with
+ *   the expected SHA-256 and Ed25519 signature; the image is verified before it can boot
+ *
+ * The central writes ota_bulk chunks (ota_bulk.h) to the data characteristic without
+ * response. The access callback copies each write straight from the mbuf chain into the free
+ * sector-sized ota_bulk buffer; a writer task feeds full buffers to ota_engine_write(), which
+ * erases ahead in the background, and notifies ACKs on the status characteristic while the
+ * central keeps BLE_OTA_WINDOW chunks in flight. The host task never waits for flash: when
+ * both buffers are still being written the data is dropped and a NAK with ESP_ERR_NO_MEM asks
+ * the central to resend from that chunk once the next ACK shows a buffer went back
+ * (ble_ota_rx.c, tested on the host).
  */
 
-#include "ble_ota.h"
-#include "bsp.h"
+#include "ble_link.h"
+#include "ble_ota_handler.h"
+#include "ble_ota_rx.h"
 #include "esp_log.h"
 #include "esp_ota_ops.h"
 #include "esp_system.h"
 #include "freertos/FreeRTOS.h"
-#include "freertos/ringbuf.h"
 #include "freertos/semphr.h"
 #include "freertos/task.h"
 #include "host/ble_gap.h"
+#include "host/ble_hs.h"
+#include "host/ble_uuid.h"
+#include "os/os_mbuf.h"
+#include "ota_bulk.h"
+#include "ota_engine.h"
+#include "task_config.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#define BLE_OTA_WINDOW 3 // Chunks in flight: both buffers plus the one on the air
+#define BLE_OTA_IDLE_TIMEOUT_MS 5000
+#define BLE_OTA_NOTIFY_RETRIES 20 // One tick apart; a lost DONE would leave the central waiting
+#define BLE_OTA_REBOOT_DELAY_MS 1000
+
+static const char *TAG = "ble_ota";
+
+// LoRaCue OTA service: data (write without response) and status (notify)
+static const ble_uuid128_t OTA_SERVICE_UUID =
+    BLE_UUID128_INIT(0x4c, 0x43, 0x4f, 0x54, 0x41, 0x00, 0x9e, 0x8d, 0x6a, 0x4b, 0x21, 0x7e, 0x01, 0x00, 0xc0, 0x1a);
+
+static const ble_uuid128_t OTA_CHR_DATA_UUID =
+    BLE_UUID128_INIT(0x4c, 0x43, 0x4f, 0x54, 0x41, 0x00, 0x9e, 0x8d, 0x6a, 0x4b, 0x21, 0x7e, 0x02, 0x00, 0xc0, 0x1a);
+
+static const ble_uuid128_t OTA_CHR_STATUS_UUID =
+    BLE_UUID128_INIT(0x4c, 0x43, 0x4f, 0x54, 0x41, 0x00, 0x9e, 0x8d, 0x6a, 0x4b, 0x21, 0x7e, 0x03, 0x00, 0xc0, 0x1a);
+
+static ble_ota_rx_t s_rx; // Host task receives into s_rx.bulk, the writer task drains it
+static uint8_t *s_storage;
+static uint16_t s_status_handle;
+static uint16_t s_conn_handle = BLE_HS_CONN_HANDLE_NONE;
+static TaskHandle_t s_writer_task;
+static SemaphoreHandle_t s_rx_lock; // Receiver (host task) against session start and end
+static atomic_bool s_session;
+static atomic_bool s_stop; // The upload is over: link lost, or the writer gave up
+static ble_link_hold_t s_link_hold;
+
+static void send_status(ota_bulk_status_t type, uint16_t seq, int32_t value)
+{
+    uint8_t record[OTA_BULK_STATUS_SIZE];
+    size_t len = ota_bulk_encode_status(record, type, seq, value);
 
-#define OTA_RINGBUF_SIZE 4096
-#define OTA_TASK_SIZE 8192
-
-static const char *TAG           = "ble_ota";
-static RingbufHandle_t s_ringbuf = NULL;
-SemaphoreHandle_t notify_sem     = NULL; // Global - required by BLE OTA library
-static esp_ota_handle_t out_handle;
-static TaskHandle_t s_ota_task_handle = NULL;
-static uint16_t s_ota_conn_handle     = BLE_HS_CONN_HANDLE_NONE;
-
-// Forward declaration
-static void ota_task(void *arg);
+    for (int attempt = 0; attempt < BLE_OTA_NOTIFY_RETRIES; attempt++) {
+        uint16_t conn_handle = s_conn_handle;
+        if (conn_handle == BLE_HS_CONN_HANDLE_NONE) {
+            return;
+        }
+        struct os_mbuf *om = ble_hs_mbuf_from_flat(record, len);
+        int rc             = om ? ble_gattc_notify_custom(conn_handle, s_status_handle, om) : BLE_HS_ENOMEM;
+        if (rc != BLE_HS_ENOMEM) {
+            if (rc != 0) {
+                ESP_LOGW(TAG, "Status notification failed: %d", rc);
+            }
+            return;
+        }
+        vTaskDelay(1);
+    }
+    ESP_LOGW(TAG, "No buffers for status %c %u", (char)type, seq);
+}
 
-bool ble_ota_ringbuf_init(uint32_t ringbuf_size)
+static void copy_mbuf(void *ctx, const void *src, size_t off, size_t len, uint8_t *dst)
 {
-    s_ringbuf = xRingbufferCreate(ringbuf_size, RINGBUF_TYPE_BYTEBUF);
-    return s_ringbuf != NULL;
+    (void)ctx;
+    os_mbuf_copydata((const struct os_mbuf *)src, (int)off, (int)len, dst);
 }
 
-size_t write_to_ringbuf(const uint8_t *data, size_t size)
+static void notify_status(void *ctx, ota_bulk_status_t type, uint16_t seq, int32_t value)
 {
-    BaseType_t done = xRingbufferSend(s_ringbuf, (void *)data, size, (TickType_t)portMAX_DELAY);
-    return done ? size : 0;
+    (void)ctx;
+    if (value == ESP_ERR_NO_MEM) {
+        ESP_LOGD(TAG, "No free buffer, NAK busy from chunk %u", seq);
+    }
+    send_status(type, seq, value);
 }
 
-void ota_recv_fw_cb(uint8_t *buf, uint32_t length)
+static void wake_writer(void *ctx)
 {
-    // Security check: Require bonded connection
-    if (s_ota_conn_handle != BLE_HS_CONN_HANDLE_NONE) {
-        struct ble_gap_conn_desc desc;
-        if (ble_gap_conn_find(s_ota_conn_handle, &desc) == 0) {
-            if (!desc.sec_state.bonded) {
-                ESP_LOGE(TAG, "OTA rejected: device not bonded");
-                return;
-            }
-        } else {
-            ESP_LOGE(TAG, "OTA rejected: connection not found");
-            return;
-        }
-    }
+    (void)ctx;
+    xTaskNotifyGive(s_writer_task);
+}
 
-    // Create OTA task on first data reception
-    if (s_ota_task_handle == NULL) {
-        ESP_LOGI(TAG, "OTA transfer started from bonded device");
-        xTaskCreate(&ota_task, "ota_task", OTA_TASK_SIZE, NULL, 5, &s_ota_task_handle);
-    }
-    write_to_ringbuf(buf, length);
+static const ble_ota_rx_ops_t RX_OPS = {
+    .copy   = copy_mbuf,
+    .status = notify_status,
+    .block  = wake_writer,
+};
+
+static void end_session(void)
+{
+    atomic_store(&s_stop, true);
+    xSemaphoreTake(s_rx_lock, portMAX_DELAY);
+    free(s_storage);
+    s_storage = NULL;
+    atomic_store(&s_session, false);
+    xSemaphoreGive(s_rx_lock);
+    ble_link_release(s_link_hold);
 }
 
-static void ota_task(void *arg)
+// One upload, from the first chunk to the final status
+static void write_upload(void)
 {
-    esp_partition_t *partition_ptr = NULL;
-    esp_partition_t partition;
-    const esp_partition_t *next_partition = NULL;
-    uint32_t recv_len                     = 0;
-    uint8_t *data                         = NULL;
-    size_t item_size                      = 0;
-    uint32_t fw_length;
-    uint8_t last_progress = 0;
+    esp_err_t result  = ESP_ERR_TIMEOUT; // No chunk for BLE_OTA_IDLE_TIMEOUT_MS
+    bool finished     = false;           // ota_engine_finish() ran: report DONE, not ERROR
+    uint32_t received = 0;
+    TickType_t start  = xTaskGetTickCount();
+
+    while (!finished) {
+        const ota_bulk_block_t *block = ota_bulk_next_block(&s_rx.bulk);
+        if (!block) {
+            if (atomic_load(&s_stop)) {
+                ESP_LOGW(TAG, "Central disconnected during upload");
+                result = ESP_ERR_INVALID_STATE;
+                break;
+            }
+            if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(BLE_OTA_IDLE_TIMEOUT_MS)) == 0 &&
+                !ota_bulk_next_block(&s_rx.bulk)) {
+                ESP_LOGW(TAG, "No data for %d ms, giving up", BLE_OTA_IDLE_TIMEOUT_MS);
+                break;
+            }
+            continue;
+        }
 
-    ESP_LOGI(TAG, "OTA task started");
+        uint8_t flags = block->flags;
+        uint16_t seq  = block->seq;
+        esp_err_t ret = block->len > 0 ? ota_engine_write(block->data, block->len) : ESP_OK;
+        received += block->len;
+        ota_bulk_release(&s_rx.bulk);
 
-    // TODO: Add OTA screen support for UI
-    // For now, OTA proceeds without UI feedback
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Write of chunk %u failed: %s", seq, esp_err_to_name(ret));
+            result = ret;
+            break;
+        }
+        if (flags & OTA_BULK_FLAG_ABORT) {
+            ESP_LOGW(TAG, "Upload aborted by central");
+            result = ESP_ERR_INVALID_STATE;
+            break;
+        }
+        send_status(OTA_BULK_STATUS_ACK, seq + 1, ESP_OK);
+        if (flags & OTA_BULK_FLAG_LAST) {
+            result   = ota_engine_finish();
+            finished = true;
+        }
+    }
 
-    notify_sem = xSemaphoreCreateCounting(100, 0);
-    xSemaphoreGive(notify_sem);
+    end_session();
 
-    fw_length = esp_ble_ota_get_fw_length();
-    ESP_LOGI(TAG, "Expected firmware size: %u bytes (%.1f MB)", fw_length, fw_length / 1048576.0f);
+    uint32_t ms = pdTICKS_TO_MS(xTaskGetTickCount() - start);
+    ESP_LOGI(TAG, "%lu bytes in %lu ms (%lu KiB/s), %lu CRC errors, %lu framing errors, %lu stalls",
+             (unsigned long)received, (unsigned long)ms, (unsigned long)(ms ? received / 1024 * 1000 / ms : 0),
+             (unsigned long)s_rx.bulk.crc_errors, (unsigned long)s_rx.bulk.framing_errors,
+             (unsigned long)s_rx.bulk.stalls);
 
-    // Get boot partition
-    partition_ptr = (esp_partition_t *)esp_ota_get_boot_partition();
-    if (partition_ptr == NULL || partition_ptr->type != ESP_PARTITION_TYPE_APP) {
-        ESP_LOGE(TAG, "Invalid boot partition");
-        goto OTA_ERROR;
+    if (result == ESP_OK) {
+        result = esp_ota_set_boot_partition(esp_ota_get_next_update_partition(NULL));
     }
-
-    // Determine next OTA partition
-    if (partition_ptr->subtype == ESP_PARTITION_SUBTYPE_APP_FACTORY) {
-        partition.subtype = ESP_PARTITION_SUBTYPE_APP_OTA_0;
-    } else {
-        next_partition    = esp_ota_get_next_update_partition(partition_ptr);
-        partition.subtype = next_partition ? next_partition->subtype : ESP_PARTITION_SUBTYPE_APP_OTA_0;
+    if (result != ESP_OK) {
+        ota_engine_abort();
     }
+    send_status(finished ? OTA_BULK_STATUS_DONE : OTA_BULK_STATUS_ERROR, ota_bulk_rx_seq(&s_rx.bulk), result);
 
-    partition.type = ESP_PARTITION_TYPE_APP;
-    partition_ptr  = (esp_partition_t *)esp_partition_find_first(partition.type, partition.subtype, NULL);
-    if (partition_ptr == NULL) {
-        ESP_LOGE(TAG, "OTA partition not found");
-        goto OTA_ERROR;
+    if (result != ESP_OK) {
+        ESP_LOGE(TAG, "Firmware upload failed: %s", esp_err_to_name(result));
+        return;
     }
+    ESP_LOGI(TAG, "Firmware update complete, rebooting");
+    vTaskDelay(pdMS_TO_TICKS(BLE_OTA_REBOOT_DELAY_MS));
+    esp_restart();
+}
 
-    memcpy(&partition, partition_ptr, sizeof(esp_partition_t));
-    ESP_LOGI(TAG, "Target partition: %s (subtype %d)", partition_ptr->label, partition_ptr->subtype);
-
-    // Begin OTA
-    if (esp_ota_begin(&partition, OTA_SIZE_UNKNOWN, &out_handle) != ESP_OK) {
-        ESP_LOGE(TAG, "esp_ota_begin failed");
-        goto OTA_ERROR;
+static void writer_task(void *arg)
+{
+    (void)arg;
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (atomic_load(&s_session)) {
+            write_upload();
+        }
     }
+}
 
-    ESP_LOGI(TAG, "Receiving firmware...");
-
-    // Stream firmware data directly to flash
-    while (recv_len < fw_length) {
-        data = (uint8_t *)xRingbufferReceive(s_ringbuf, &item_size, (TickType_t)portMAX_DELAY);
-        xSemaphoreTake(notify_sem, portMAX_DELAY);
+// Host task, with s_rx_lock held: the first write after firmware:upgrade opens the session
+static esp_err_t start_session(void)
+{
+    if (ota_engine_get_state() != OTA_STATE_ACTIVE) {
+        ESP_LOGW(TAG, "Data before firmware:upgrade, ignored");
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!s_writer_task &&
+        xTaskCreate(writer_task, "ble_ota_wr", TASK_STACK_SIZE_LARGE, NULL, TASK_PRIORITY_NORMAL, &s_writer_task) !=
+            pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    s_storage = malloc(OTA_BULK_STORAGE_SIZE(OTA_BULK_CHUNK_MAX));
+    if (!s_storage) {
+        return ESP_ERR_NO_MEM;
+    }
 
-        if (item_size != 0) {
-            if (recv_len + item_size > fw_length) {
-                ESP_LOGE(TAG, "Received more data than expected");
-                vRingbufferReturnItem(s_ringbuf, (void *)data);
-                goto OTA_ERROR;
-            }
+    ble_ota_rx_start(&s_rx, s_storage, OTA_BULK_CHUNK_MAX);
+    atomic_store(&s_stop, false);
+    atomic_store(&s_session, true);
+    s_link_hold = ble_link_acquire(); // Released by end_session()
+    xTaskNotifyGive(s_writer_task);
 
-            // Write directly to flash
-            if (esp_ota_write(out_handle, data, item_size) != ESP_OK) {
-                ESP_LOGE(TAG, "esp_ota_write failed");
-                vRingbufferReturnItem(s_ringbuf, (void *)data);
-                goto OTA_ERROR;
-            }
-
-            recv_len += item_size;
-            vRingbufferReturnItem(s_ringbuf, (void *)data);
+    ESP_LOGI(TAG, "Upload started from bonded device: %d byte chunks, window %d", OTA_BULK_CHUNK_MAX,
+             BLE_OTA_WINDOW);
+    return ESP_OK;
+}
 
-            // Update progress
-            uint8_t progress = (recv_len * 100) / fw_length;
-            if (progress != last_progress) {
-                last_progress = progress;
-                // TODO: Add OTA progress UI update
-                ESP_LOGI(TAG, "Progress: %u%%", progress);
-            }
-        }
-        xSemaphoreGive(notify_sem);
+static int ota_data_access(uint16_t conn_handle, uint16_t attr_handle, struct ble_gatt_access_ctxt *ctxt, void *arg)
+{
+    (void)attr_handle;
+    (void)arg;
+    if (ctxt->op != BLE_GATT_ACCESS_OP_WRITE_CHR) {
+        return BLE_ATT_ERR_UNLIKELY;
     }
 
-    ESP_LOGI(TAG, "Firmware received successfully");
-
-    if (esp_ota_end(out_handle) != ESP_OK) {
-        ESP_LOGE(TAG, "esp_ota_end failed");
-        goto OTA_ERROR;
+    // Security check: Require bonded connection
+    struct ble_gap_conn_desc desc;
+    if (ble_gap_conn_find(conn_handle, &desc) != 0) {
+        ESP_LOGE(TAG, "OTA rejected: connection not found");
+        return BLE_ATT_ERR_UNLIKELY;
     }
-
-    if (esp_ota_set_boot_partition(&partition) != ESP_OK) {
-        ESP_LOGE(TAG, "esp_ota_set_boot_partition failed");
-        goto OTA_ERROR;
+    if (!desc.sec_state.bonded) {
+        ESP_LOGE(TAG, "OTA rejected: device not bonded");
+        return BLE_ATT_ERR_INSUFFICIENT_AUTHEN;
     }
 
-    ESP_LOGI(TAG, "========================================");
-    ESP_LOGI(TAG, "  OTA Update Successful!");
-    ESP_LOGI(TAG, "  Rebooting in 2 seconds...");
-    ESP_LOGI(TAG, "========================================");
+    ble_link_account(OS_MBUF_PKTLEN(ctxt->om));
 
-    vSemaphoreDelete(notify_sem);
-    vTaskDelay(pdMS_TO_TICKS(2000));
-    esp_restart();
+    xSemaphoreTake(s_rx_lock, portMAX_DELAY);
+    esp_err_t ret = atomic_load(&s_session) ? ESP_OK : start_session();
+    if (ret == ESP_OK) {
+        ble_ota_rx_write(&s_rx, ctxt->om, OS_MBUF_PKTLEN(ctxt->om), &RX_OPS);
+    }
+    xSemaphoreGive(s_rx_lock);
 
-OTA_ERROR:
-    ESP_LOGE(TAG, "========================================");
-    ESP_LOGE(TAG, "  OTA Update Failed!");
-    ESP_LOGE(TAG, "========================================");
-    if (notify_sem)
-        vSemaphoreDelete(notify_sem);
+    if (ret != ESP_OK) {
+        send_status(OTA_BULK_STATUS_ERROR, 0, ret); // Write without response: this is the only answer
+        return BLE_ATT_ERR_UNLIKELY;
+    }
+    return 0;
+}
 
-    s_ota_task_handle = NULL;
-    vTaskDelete(NULL);
+static int ota_status_access(uint16_t conn_handle, uint16_t attr_handle, struct ble_gatt_access_ctxt *ctxt,
+                             void *arg)
+{
+    (void)conn_handle;
+    (void)attr_handle;
+    (void)ctxt;
+    (void)arg;
+    return BLE_ATT_ERR_READ_NOT_PERMITTED;
 }
 
-esp_err_t ble_ota_handler_init(void)
+static const struct ble_gatt_svc_def ota_svcs[] = {
+    {
+        .type            = BLE_GATT_SVC_TYPE_PRIMARY,
+        .uuid            = &OTA_SERVICE_UUID.u,
+        .characteristics = (struct ble_gatt_chr_def[]){{
+                                                           .uuid      = &OTA_CHR_DATA_UUID.u,
+                                                           .access_cb = ota_data_access,
+                                                           .flags     = BLE_GATT_CHR_F_WRITE_NO_RSP |
+                                                                    BLE_GATT_CHR_F_WRITE_ENC |
+                                                                    BLE_GATT_CHR_F_WRITE_AUTHEN,
+                                                       },
+                                                       {
+                                                           .uuid       = &OTA_CHR_STATUS_UUID.u,
+                                                           .access_cb  = ota_status_access,
+                                                           .val_handle = &s_status_handle,
+                                                           .flags      = BLE_GATT_CHR_F_NOTIFY,
+                                                       },
+                                                       {0}},
+    },
+    {0},
+};
+
+esp_err_t ble_ota_handler_register(void)
 {
-    if (!ble_ota_ringbuf_init(OTA_RINGBUF_SIZE)) {
-        ESP_LOGE(TAG, "Ring buffer init failed");
+    int rc = ble_gatts_count_cfg(ota_svcs);
+    if (rc == 0) {
+        rc = ble_gatts_add_svcs(ota_svcs);
+    }
+    if (rc != 0) {
+        ESP_LOGE(TAG, "Failed to add OTA service: %d", rc);
         return ESP_FAIL;
     }
+    return ESP_OK;
+}
 
-    // Register callback - task will be created when OTA transfer starts
-    esp_ble_ota_recv_fw_data_callback(ota_recv_fw_cb);
-
-    ESP_LOGI(TAG, "BLE OTA handler initialized (task starts on transfer)");
+esp_err_t ble_ota_handler_init(void)
+{
+    if (!s_rx_lock) {
+        s_rx_lock = xSemaphoreCreateMutex();
+    }
+    if (!s_rx_lock) {
+        ESP_LOGE(TAG, "Failed to create OTA lock");
+        return ESP_ERR_NO_MEM;
+    }
 
+    ESP_LOGI(TAG, "BLE OTA handler initialized (writer starts on first upload)");
     return ESP_OK;
 }
 
 void ble_ota_handler_set_connection(uint16_t conn_handle)
 {
-    s_ota_conn_handle = conn_handle;
+    s_conn_handle = conn_handle;
+    if (conn_handle == BLE_HS_CONN_HANDLE_NONE && atomic_load(&s_session)) {
+        atomic_store(&s_stop, true);
+        xTaskNotifyGive(s_writer_task);
+    }
 }
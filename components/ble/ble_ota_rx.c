@@ -0,0 +1,43 @@
+/**
+ * @file ble_ota_rx.c
+ * @brief GATT writes into the ota_bulk stream, without ever waiting for the writer
+ */
+
+#include "ble_ota_rx.h"
+#include "esp_err.h"
+
+void ble_ota_rx_start(ble_ota_rx_t *rx, uint8_t *storage, size_t chunk_max)
+{
+    ota_bulk_init(&rx->bulk, storage, chunk_max);
+    rx->done = false;
+}
+
+void ble_ota_rx_write(ble_ota_rx_t *rx, const void *src, size_t len, const ble_ota_rx_ops_t *ops)
+{
+    size_t off = 0;
+
+    while (off < len && !rx->done) {
+        uint8_t *dst;
+        size_t want = ota_bulk_rx_window(&rx->bulk, &dst);
+        if (want == 0) {
+            // Both buffers wait for flash: holding the write would stall the whole host, so the central resends
+            if (ota_bulk_rx_drop(&rx->bulk)) {
+                ops->status(ops->ctx, OTA_BULK_STATUS_NAK, ota_bulk_rx_seq(&rx->bulk), ESP_ERR_NO_MEM);
+            }
+            return;
+        }
+
+        size_t left = len - off;
+        size_t n    = left < want ? left : want;
+        ops->copy(ops->ctx, src, off, n, dst);
+        off += n;
+
+        ota_bulk_rx_result_t r = ota_bulk_rx_commit(&rx->bulk, n);
+        if (r == OTA_BULK_RX_BAD) {
+            ops->status(ops->ctx, OTA_BULK_STATUS_NAK, ota_bulk_rx_seq(&rx->bulk), ESP_ERR_INVALID_CRC);
+        } else if (r == OTA_BULK_RX_BLOCK) {
+            ops->block(ops->ctx);
+            rx->done = rx->bulk.rx_flags & (OTA_BULK_FLAG_LAST | OTA_BULK_FLAG_ABORT);
+        }
+    }
+}
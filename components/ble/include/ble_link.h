@@ -0,0 +1,78 @@
+/**
+ * @file ble_link.h
+ * @brief BLE link profiles for the NUS/OTA connection
+ *
+ * CONTEXT: One central at a time; the link idles most of the connection
+ * PURPOSE: Keep the connection in a low-power profile and switch to 2M PHY, 251-byte data
+ *          length and a 7.5-15 ms interval only while an OTA or a large RPC is moving data.
+ *          Low power never shrinks the data length: idle events are empty PDUs either way
+ * USAGE: ble.c reports connect/disconnect; bulk transfers bracket themselves with
+ *        ble_link_acquire()/ble_link_release() and report their bytes with ble_link_account()
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief A hold on the throughput profile, tagged with the connection it was taken on
+ */
+typedef uint32_t ble_link_hold_t;
+
+typedef enum {
+    BLE_LINK_PROFILE_LOW_POWER = 0,
+    BLE_LINK_PROFILE_THROUGHPUT,
+    BLE_LINK_PROFILE_COUNT,
+} ble_link_profile_t;
+
+/**
+ * @brief Create the profile lock; call from ble_init() before the first connection
+ */
+esp_err_t ble_link_init(void);
+
+/**
+ * @brief A central connected: request the low-power profile and reset the statistics
+ */
+void ble_link_connected(uint16_t conn_handle);
+
+/**
+ * @brief The central disconnected: log per-profile throughput and drop all holds
+ */
+void ble_link_disconnected(void);
+
+/**
+ * @brief Switch to the throughput profile until the matching ble_link_release()
+ *
+ * Holds nest; the link goes back to low power when the last one is released.
+ *
+ * @return The hold, to pass to ble_link_release()
+ */
+ble_link_hold_t ble_link_acquire(void);
+
+/**
+ * @brief Drop one hold taken with ble_link_acquire()
+ *
+ * A hold taken on an earlier connection was dropped when that link went down; releasing it
+ * late (a response still draining after a reconnect) does nothing.
+ */
+void ble_link_release(ble_link_hold_t hold);
+
+/**
+ * @brief Count payload bytes moved over the link towards the current profile's throughput
+ */
+void ble_link_account(size_t bytes);
+
+/**
+ * @return The profile currently requested
+ */
+ble_link_profile_t ble_link_get_profile(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,6 +1,12 @@
 /**
  * @file ble_ota_handler.h
  * @brief BLE OTA handler interface
+ *
+ * The LoRaCue OTA service (1ac00001-7e21-4b6a-8d9e-00414f54434c) carries the ota_bulk stream
+ * (ota_bulk.h): after firmware:upgrade or ota:resume over NUS, the central writes chunks
+ * without response to the data characteristic (1ac00002-...) and gets ACK/NAK/DONE/ERROR
+ * records as notifications on the status characteristic (1ac00003-...). Keep at most 3
+ * chunks unacknowledged. The client steps are in components/ota_engine/README.md.
  */
 
 #pragma once
@@ -13,16 +19,24 @@ extern "C" {
 #endif
 
 /**
- * @brief Initialize BLE OTA handler
+ * @brief Add the OTA service to the GATT server (before the host syncs)
  *
  * @return ESP_OK on success, ESP_FAIL on error
  */
+esp_err_t ble_ota_handler_register(void);
+
+/**
+ * @brief Initialize BLE OTA handler
+ *
+ * @return ESP_OK on success, ESP_ERR_NO_MEM on error
+ */
 esp_err_t ble_ota_handler_init(void);
 
 /**
- * @brief Set connection handle for OTA security checks
+ * @brief Set the connection status notifications go to
  *
- * @param conn_handle BLE connection handle
+ * @param conn_handle BLE connection handle, BLE_HS_CONN_HANDLE_NONE on disconnect (ends an
+ *                    upload in progress)
  */
 void ble_ota_handler_set_connection(uint16_t conn_handle);
 
@@ -0,0 +1,57 @@
+/**
+ * @file ble_ota_rx.h
+ * @brief Receiving side of the BLE OTA service: GATT writes into the ota_bulk stream
+ *
+ * CONTEXT: A write without response cannot be refused or held: the host task must take it
+ *          at once, or stall every other connection event
+ * PURPOSE: Split each write across ota_bulk buffers and decide the status records it needs
+ *          (NAK for damaged data, NAK ESP_ERR_NO_MEM when both buffers wait for flash), apart
+ *          from NimBLE so the protocol can be tested on the host
+ * USAGE: Pure C; ble_ota_handler.c calls ble_ota_rx_write() from the access callback with
+ *        os_mbuf_copydata() as the copy function, tests/host drives it as a simulated central
+ */
+
+#pragma once
+
+#include "ota_bulk.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Where a write comes from and where its results go
+ */
+typedef struct {
+    void (*copy)(void *ctx, const void *src, size_t off, size_t len, uint8_t *dst); ///< len bytes of the write at off
+    void (*status)(void *ctx, ota_bulk_status_t type, uint16_t seq, int32_t value); ///< Notify a status record
+    void (*block)(void *ctx); ///< A chunk is queued: wake the writer
+    void *ctx;
+} ble_ota_rx_ops_t;
+
+typedef struct {
+    ota_bulk_t bulk;
+    bool done; ///< LAST or ABORT queued: ignore writes until the session ends
+} ble_ota_rx_t;
+
+/**
+ * @brief Start a session
+ *
+ * @param storage OTA_BULK_STORAGE_SIZE(chunk_max) bytes, owned by the caller
+ */
+void ble_ota_rx_start(ble_ota_rx_t *rx, uint8_t *storage, size_t chunk_max);
+
+/**
+ * @brief Take one GATT write of len bytes
+ *
+ * Data that finds both buffers busy is dropped with a single NAK (ESP_ERR_NO_MEM) per
+ * streak; the central resends from that chunk after the next ACK.
+ */
+void ble_ota_rx_write(ble_ota_rx_t *rx, const void *src, size_t len, const ble_ota_rx_ops_t *ops);
+
+#ifdef __cplusplus
+}
+#endif
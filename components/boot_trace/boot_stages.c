@@ -0,0 +1,71 @@
+/**
+ * @file boot_stages.c
+ * @brief app_main init stages, their time budgets and dependencies
+ */
+
+#include "boot_stages.h"
+#include <stddef.h>
+
+#define DEP BOOT_DEP
+
+// Budgets are worst cases seen on Heltec V3 plus margin; fixed delays are spelled out.
+// Dependencies are the real ordering constraints: stages without a path between them
+// may run on different cores at the same time.
+static const boot_stage_info_t stages[BOOT_STAGE_COUNT] = {
+    [BOOT_STAGE_NVS]       = {"nvs", 30000, 0},
+    [BOOT_STAGE_OTA]       = {"ota", 30000, DEP(BOOT_STAGE_NVS)},
+    [BOOT_STAGE_CONFIG]    = {"config", 20000, DEP(BOOT_STAGE_NVS)},
+    [BOOT_STAGE_POWER]     = {"power", 10000, DEP(BOOT_STAGE_CONFIG)},
+    [BOOT_STAGE_I2C]       = {"i2c", 10000, 0},
+    [BOOT_STAGE_I2CONSOLE] = {"i2console", 100000 + 30000, DEP(BOOT_STAGE_I2C)}, // 100 ms settle delay + probe
+    [BOOT_STAGE_BSP]       = {"bsp", 60000, DEP(BOOT_STAGE_I2C)}, // Reuses the I2C bus, sets up the LoRa SPI bus
+    [BOOT_STAGE_LED]       = {"led", 10000, DEP(BOOT_STAGE_BSP)},
+    [BOOT_STAGE_EVENTS]    = {"events", 5000, 0},
+    [BOOT_STAGE_INPUT]     = {"input", 10000, DEP(BOOT_STAGE_BSP) | DEP(BOOT_STAGE_POWER) | DEP(BOOT_STAGE_EVENTS)},
+
+    // Display init + boot screen flush
+    [BOOT_STAGE_UI] = {"ui", 150000,
+                       DEP(BOOT_STAGE_BSP) | DEP(BOOT_STAGE_CONFIG) | DEP(BOOT_STAGE_POWER) | DEP(BOOT_STAGE_EVENTS)},
+
+    [BOOT_STAGE_MODE_MANAGERS] = {"mode_managers", 5000, DEP(BOOT_STAGE_CONFIG) | DEP(BOOT_STAGE_EVENTS)},
+    [BOOT_STAGE_INPUT_START]   = {"input_start", 5000,
+                                  DEP(BOOT_STAGE_INPUT) | DEP(BOOT_STAGE_UI) | DEP(BOOT_STAGE_MODE_MANAGERS)},
+    [BOOT_STAGE_REGISTRY]      = {"registry", 20000, DEP(BOOT_STAGE_CONFIG)},
+
+    // Reset pulse + calibration, config. Input installs the GPIO ISR service DIO1 is added to.
+    [BOOT_STAGE_LORA_DRIVER] = {"lora_driver", 40000 + 80000,
+                                DEP(BOOT_STAGE_BSP) | DEP(BOOT_STAGE_POWER) | DEP(BOOT_STAGE_INPUT)},
+
+    [BOOT_STAGE_LORA_PROTOCOL] = {"lora_protocol", 20000,
+                                  DEP(BOOT_STAGE_LORA_DRIVER) | DEP(BOOT_STAGE_REGISTRY) | DEP(BOOT_STAGE_EVENTS)},
+    [BOOT_STAGE_LORA_START]    = {"lora_start", 10000,
+                                  DEP(BOOT_STAGE_LORA_PROTOCOL) | DEP(BOOT_STAGE_MODE_MANAGERS) | DEP(BOOT_STAGE_USB_HID)},
+    [BOOT_STAGE_MAIN_SCREEN]   = {"main_screen", 50000, DEP(BOOT_STAGE_LORA_PROTOCOL) | DEP(BOOT_STAGE_INPUT_START)},
+    [BOOT_STAGE_USB_HID]       = {"usb_hid", 60000,
+                                  DEP(BOOT_STAGE_CONFIG) | DEP(BOOT_STAGE_EVENTS) | DEP(BOOT_STAGE_REGISTRY)},
+
+    // Command transports reach every subsystem as soon as they are up. BLE commands need a
+    // connected, bonded central, which takes far longer than LoRa bring-up after advertising
+    // starts, so the controller init (the slowest stage) overlaps the radio instead.
+    [BOOT_STAGE_USB_CDC] = {"usb_cdc", 20000,
+                            DEP(BOOT_STAGE_USB_HID) | DEP(BOOT_STAGE_OTA) | DEP(BOOT_STAGE_LORA_PROTOCOL)},
+    [BOOT_STAGE_BLE]     = {"ble", 300000, DEP(BOOT_STAGE_OTA) | DEP(BOOT_STAGE_POWER) | DEP(BOOT_STAGE_EVENTS)},
+    [BOOT_STAGE_UART]    = {"uart", 10000, DEP(BOOT_STAGE_OTA) | DEP(BOOT_STAGE_LORA_PROTOCOL)},
+};
+
+const boot_stage_info_t *boot_stage_info(boot_stage_t stage)
+{
+    if ((int)stage < 0 || (int)stage >= BOOT_STAGE_COUNT) {
+        return NULL;
+    }
+    return &stages[stage];
+}
+
+uint64_t boot_stages_budget_until(boot_stage_t last)
+{
+    uint64_t total = 0;
+    for (int i = 0; i <= (int)last && i < BOOT_STAGE_COUNT; i++) {
+        total += stages[i].budget_us;
+    }
+    return total;
+}
@@ -0,0 +1,124 @@
+/**
+ * @file boot_trace.c
+ * @brief Boot-time tracing of app_main init stages
+ */
+
+#include "boot_trace.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+static const char *TAG = "BOOT_TRACE";
+
+static trace_buffer_t s_trace;
+static int s_stage_span[BOOT_STAGE_COUNT];
+static bool s_initialized      = false;
+static portMUX_TYPE trace_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// First call wins; app_main starts with a mark so the buffer is ready before any stage
+static void ensure_init(void)
+{
+    if (!s_initialized) {
+        trace_buffer_init(&s_trace);
+        for (int i = 0; i < BOOT_STAGE_COUNT; i++) {
+            s_stage_span[i] = -1;
+        }
+        s_initialized = true;
+    }
+}
+
+void boot_trace_begin(boot_stage_t stage)
+{
+    const boot_stage_info_t *info = boot_stage_info(stage);
+    if (!info) {
+        return;
+    }
+
+    uint64_t now  = esp_timer_get_time();
+    uint32_t heap = esp_get_free_heap_size();
+    taskENTER_CRITICAL(&trace_lock);
+    ensure_init();
+    s_stage_span[stage] = trace_buffer_begin_on(&s_trace, xPortGetCoreID(), info->name, info->budget_us, now, heap);
+    taskEXIT_CRITICAL(&trace_lock);
+}
+
+void boot_trace_end(boot_stage_t stage)
+{
+    if (!boot_stage_info(stage)) {
+        return;
+    }
+
+    uint64_t now  = esp_timer_get_time();
+    uint32_t heap = esp_get_free_heap_size();
+    taskENTER_CRITICAL(&trace_lock);
+    ensure_init();
+    trace_buffer_end(&s_trace, s_stage_span[stage], now, heap);
+    taskEXIT_CRITICAL(&trace_lock);
+}
+
+void boot_trace_mark(const char *name)
+{
+    uint64_t now  = esp_timer_get_time();
+    uint32_t heap = esp_get_free_heap_size();
+    taskENTER_CRITICAL(&trace_lock);
+    ensure_init();
+    trace_buffer_mark(&s_trace, name, now, heap);
+    taskEXIT_CRITICAL(&trace_lock);
+}
+
+static void log_mark(const trace_buffer_t *trace, const char *mark, const char *what, uint32_t budget_us)
+{
+    int id = trace_buffer_find(trace, mark);
+    if (id < 0) {
+        return;
+    }
+
+    uint64_t at_us = trace->spans[id].start_us;
+    if (at_us > budget_us) {
+        ESP_LOGW(TAG, "%s after %llu ms (budget %lu ms)", what, at_us / 1000, budget_us / 1000);
+    } else {
+        ESP_LOGI(TAG, "%s after %llu ms", what, at_us / 1000);
+    }
+}
+
+void boot_trace_finish(void)
+{
+    boot_trace_mark(BOOT_TRACE_MARK_COMPLETE);
+
+    // Logging happens outside the spinlock on a copy
+    static trace_buffer_t trace;
+    boot_trace_snapshot(&trace);
+
+    log_mark(&trace, BOOT_TRACE_MARK_LORA_READY, "LoRa ready", BOOT_LORA_READY_BUDGET_US);
+    log_mark(&trace, BOOT_TRACE_MARK_KEYPRESS_READY, "First keypress possible", BOOT_KEYPRESS_READY_BUDGET_US);
+    int done = trace_buffer_find(&trace, BOOT_TRACE_MARK_COMPLETE);
+    if (done >= 0) {
+        ESP_LOGI(TAG, "Boot complete after %llu ms", trace.spans[done].start_us / 1000);
+    }
+
+    for (int i = 0; i < trace.count; i++) {
+        const trace_span_t *span = &trace.spans[i];
+        if (trace_span_over_budget(span)) {
+            ESP_LOGW(TAG, "Stage %s took %llu ms (budget %lu ms)", span->name, trace_span_duration_us(span) / 1000,
+                     span->budget_us / 1000);
+        }
+    }
+    if (trace.dropped > 0) {
+        ESP_LOGW(TAG, "%u trace events dropped (buffer holds %d)", trace.dropped, TRACE_BUFFER_MAX_SPANS);
+    }
+}
+
+esp_err_t boot_trace_snapshot(trace_buffer_t *out)
+{
+    if (!out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    taskENTER_CRITICAL(&trace_lock);
+    ensure_init();
+    *out = s_trace;
+    taskEXIT_CRITICAL(&trace_lock);
+    return ESP_OK;
+}
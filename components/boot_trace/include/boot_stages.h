@@ -0,0 +1,85 @@
+/**
+ * @file boot_stages.h
+ * @brief app_main init stages and their time budgets
+ *
+ * CONTEXT: Time from reset to "first LoRa packet can be sent" is the boot latency users feel
+ * PURPOSE: Name every init stage, give it a budget and the stages it depends on, and derive
+ *          the LoRa-ready budget from the stages that run before it; the host tests fail when
+ *          that sum or the critical path regresses
+ * USAGE: Pure C; boot_trace and init_scheduler use the table at runtime, tests/host checks it offline
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Init stages in serial boot order
+ *
+ * init_scheduler may run independent stages concurrently; the dependency masks in
+ * boot_stage_info_t are what orders them.
+ */
+typedef enum {
+    BOOT_STAGE_NVS,
+    BOOT_STAGE_OTA,
+    BOOT_STAGE_CONFIG,
+    BOOT_STAGE_POWER,
+    BOOT_STAGE_I2C,
+    BOOT_STAGE_I2CONSOLE,
+    BOOT_STAGE_BSP,
+    BOOT_STAGE_LED,
+    BOOT_STAGE_EVENTS,
+    BOOT_STAGE_INPUT,
+    BOOT_STAGE_UI,
+    BOOT_STAGE_MODE_MANAGERS,
+    BOOT_STAGE_INPUT_START,
+    BOOT_STAGE_REGISTRY,
+    BOOT_STAGE_LORA_DRIVER,
+    BOOT_STAGE_LORA_PROTOCOL,
+    BOOT_STAGE_LORA_START,
+    BOOT_STAGE_MAIN_SCREEN,
+    BOOT_STAGE_USB_HID,
+    BOOT_STAGE_USB_CDC,
+    BOOT_STAGE_BLE,
+    BOOT_STAGE_UART,
+    BOOT_STAGE_COUNT,
+} boot_stage_t;
+
+/// Last stage before the first LoRa packet can be queued
+#define BOOT_STAGE_LORA_READY BOOT_STAGE_LORA_PROTOCOL
+/// Last stage before a button press reaches the presenter (time to first keypress)
+#define BOOT_STAGE_KEYPRESS_READY BOOT_STAGE_MAIN_SCREEN
+
+/// Dependency mask bit of a stage
+#define BOOT_DEP(stage) (1UL << (stage))
+
+/// ROM + bootloader + app image load before app_main (esp_timer counts from reset)
+#define BOOT_PRE_APP_BUDGET_US 300000
+/// Reset to LoRa ready; raising this needs a reason in the commit message
+#define BOOT_LORA_READY_BUDGET_US 1000000
+/// Reset to first keypress with stages scheduled on both cores
+#define BOOT_KEYPRESS_READY_BUDGET_US 1000000
+
+typedef struct {
+    const char *name;   ///< Span name in traces
+    uint32_t budget_us; ///< Expected upper bound on target
+    uint32_t deps;      ///< BOOT_DEP() mask of stages that must finish first
+} boot_stage_info_t;
+
+/**
+ * @brief Name and budget of a stage, NULL for unknown stages
+ */
+const boot_stage_info_t *boot_stage_info(boot_stage_t stage);
+
+/**
+ * @brief Sum of stage budgets from the first stage up to and including last
+ */
+uint64_t boot_stages_budget_until(boot_stage_t last);
+
+#ifdef __cplusplus
+}
+#endif
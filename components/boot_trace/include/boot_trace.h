@@ -0,0 +1,57 @@
+/**
+ * @file boot_trace.h
+ * @brief Boot-time tracing of app_main init stages
+ *
+ * CONTEXT: Startup latency regressions are invisible without per-stage timing
+ * PURPOSE: Record esp_timer spans and heap deltas per init stage into a fixed RAM
+ *          buffer, check them against the stage budgets and expose them for
+ *          system:bootTrace (Chrome trace format)
+ * USAGE: boot_trace_begin()/boot_trace_end() around each stage in app_main
+ */
+
+#pragma once
+
+#include "boot_stages.h"
+#include "esp_err.h"
+#include "trace_buffer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BOOT_TRACE_MARK_APP_START "app_main"
+#define BOOT_TRACE_MARK_LORA_READY "lora_ready"
+#define BOOT_TRACE_MARK_KEYPRESS_READY "keypress_ready"
+#define BOOT_TRACE_MARK_COMPLETE "boot_complete"
+
+/**
+ * @brief Start timing an init stage on the calling core's track
+ */
+void boot_trace_begin(boot_stage_t stage);
+
+/**
+ * @brief Stop timing an init stage
+ */
+void boot_trace_end(boot_stage_t stage);
+
+/**
+ * @brief Record an instant event (name must be a static string)
+ */
+void boot_trace_mark(const char *name);
+
+/**
+ * @brief Mark boot complete and log stages that exceeded their budget
+ */
+void boot_trace_finish(void);
+
+/**
+ * @brief Copy the trace recorded so far
+ *
+ * @param out Output trace (about 2.5 KB, avoid the stack of small tasks)
+ * @return ESP_OK on success
+ */
+esp_err_t boot_trace_snapshot(trace_buffer_t *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,111 @@
+/**
+ * @file trace_buffer.h
+ * @brief Fixed-size span recorder for boot tracing
+ *
+ * CONTEXT: Boot latency is the sum of ~20 init calls nobody measured individually
+ * PURPOSE: Record named, nested time spans with heap deltas and per-span budgets into
+ *          a fixed RAM buffer; no allocation, names are static strings
+ * USAGE: Pure C, caller provides timestamps and free heap (see boot_trace)
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TRACE_BUFFER_MAX_SPANS 48
+#define TRACE_BUFFER_MAX_TRACKS 2 ///< One per CPU core
+
+/**
+ * @brief One recorded span or instant mark
+ */
+typedef struct {
+    const char *name;    ///< Static string, not copied
+    uint64_t start_us;
+    uint64_t end_us;     ///< Equal to start_us for marks and still-open spans
+    uint32_t heap_start; ///< Free heap at begin
+    int32_t heap_delta;  ///< Free heap change over the span (negative: allocated)
+    uint32_t budget_us;  ///< Expected upper bound, 0 if none
+    uint8_t depth;       ///< Nesting level within the track, 0 = top level
+    uint8_t track;       ///< Track (core) the span ran on
+    bool open;
+    bool instant;
+} trace_span_t;
+
+/**
+ * @brief Trace state
+ */
+typedef struct {
+    trace_span_t spans[TRACE_BUFFER_MAX_SPANS];
+    uint8_t count;
+    uint8_t depth;    ///< Currently open spans
+    uint8_t track_depth[TRACE_BUFFER_MAX_TRACKS];
+    uint16_t dropped; ///< Spans and marks lost to a full buffer
+} trace_buffer_t;
+
+/**
+ * @brief Initialize an empty trace
+ */
+void trace_buffer_init(trace_buffer_t *trace);
+
+/**
+ * @brief Open a span nested inside any span still open
+ *
+ * @param budget_us Expected upper bound for the span, 0 if none
+ * @return Span id, -1 if the buffer is full
+ */
+int trace_buffer_begin(trace_buffer_t *trace, const char *name, uint32_t budget_us, uint64_t now_us,
+                       uint32_t free_heap);
+
+/**
+ * @brief Open a span on a track; spans on different tracks may overlap without nesting
+ *
+ * @return Span id, -1 if the buffer is full or the track is out of range
+ */
+int trace_buffer_begin_on(trace_buffer_t *trace, uint8_t track, const char *name, uint32_t budget_us,
+                          uint64_t now_us, uint32_t free_heap);
+
+/**
+ * @brief Close a span
+ *
+ * @return ESP_ERR_INVALID_ARG for unknown ids, ESP_ERR_INVALID_STATE if already closed
+ */
+esp_err_t trace_buffer_end(trace_buffer_t *trace, int id, uint64_t now_us, uint32_t free_heap);
+
+/**
+ * @brief Record an instant event (e.g. "lora_ready")
+ *
+ * @return Span id, -1 if the buffer is full
+ */
+int trace_buffer_mark(trace_buffer_t *trace, const char *name, uint64_t now_us, uint32_t free_heap);
+
+/**
+ * @brief First span or mark with this name, -1 if none
+ */
+int trace_buffer_find(const trace_buffer_t *trace, const char *name);
+
+/**
+ * @brief Span duration, 0 for marks and open spans
+ */
+uint64_t trace_span_duration_us(const trace_span_t *span);
+
+/**
+ * @brief True if a closed span took longer than its budget
+ */
+bool trace_span_over_budget(const trace_span_t *span);
+
+/**
+ * @brief Number of spans over budget
+ *
+ * @param worst Output span exceeding its budget by the most (may be NULL), -1 if none
+ */
+uint8_t trace_buffer_over_budget(const trace_buffer_t *trace, int *worst);
+
+#ifdef __cplusplus
+}
+#endif
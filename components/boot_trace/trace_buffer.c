@@ -0,0 +1,124 @@
+/**
+ * @file trace_buffer.c
+ * @brief Fixed-size span recorder for boot tracing
+ */
+
+#include "trace_buffer.h"
+#include <string.h>
+
+void trace_buffer_init(trace_buffer_t *trace)
+{
+    memset(trace, 0, sizeof(*trace));
+}
+
+static int add_span(trace_buffer_t *trace, const char *name, uint64_t now_us, uint32_t free_heap)
+{
+    if (trace->count >= TRACE_BUFFER_MAX_SPANS) {
+        trace->dropped++;
+        return -1;
+    }
+
+    trace_span_t *span = &trace->spans[trace->count];
+    memset(span, 0, sizeof(*span));
+    span->name       = name;
+    span->start_us   = now_us;
+    span->end_us     = now_us;
+    span->heap_start = free_heap;
+    return trace->count++;
+}
+
+int trace_buffer_begin(trace_buffer_t *trace, const char *name, uint32_t budget_us, uint64_t now_us,
+                       uint32_t free_heap)
+{
+    return trace_buffer_begin_on(trace, 0, name, budget_us, now_us, free_heap);
+}
+
+int trace_buffer_begin_on(trace_buffer_t *trace, uint8_t track, const char *name, uint32_t budget_us,
+                          uint64_t now_us, uint32_t free_heap)
+{
+    if (track >= TRACE_BUFFER_MAX_TRACKS) {
+        return -1;
+    }
+
+    int id = add_span(trace, name, now_us, free_heap);
+    if (id >= 0) {
+        trace_span_t *span = &trace->spans[id];
+        span->budget_us    = budget_us;
+        span->track        = track;
+        span->depth        = trace->track_depth[track]++;
+        span->open         = true;
+        trace->depth++;
+    }
+    return id;
+}
+
+esp_err_t trace_buffer_end(trace_buffer_t *trace, int id, uint64_t now_us, uint32_t free_heap)
+{
+    if (id < 0 || id >= trace->count) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    trace_span_t *span = &trace->spans[id];
+    if (!span->open) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    span->open       = false;
+    span->end_us     = now_us > span->start_us ? now_us : span->start_us;
+    span->heap_delta = (int32_t)free_heap - (int32_t)span->heap_start;
+    trace->track_depth[span->track]--;
+    trace->depth--;
+    return ESP_OK;
+}
+
+int trace_buffer_mark(trace_buffer_t *trace, const char *name, uint64_t now_us, uint32_t free_heap)
+{
+    int id = add_span(trace, name, now_us, free_heap);
+    if (id >= 0) {
+        trace->spans[id].instant = true;
+    }
+    return id;
+}
+
+int trace_buffer_find(const trace_buffer_t *trace, const char *name)
+{
+    for (int i = 0; i < trace->count; i++) {
+        if (strcmp(trace->spans[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+uint64_t trace_span_duration_us(const trace_span_t *span)
+{
+    return span->open ? 0 : span->end_us - span->start_us;
+}
+
+bool trace_span_over_budget(const trace_span_t *span)
+{
+    return span->budget_us > 0 && !span->open && trace_span_duration_us(span) > span->budget_us;
+}
+
+uint8_t trace_buffer_over_budget(const trace_buffer_t *trace, int *worst)
+{
+    uint8_t over    = 0;
+    int worst_id    = -1;
+    uint64_t excess = 0;
+    for (int i = 0; i < trace->count; i++) {
+        const trace_span_t *span = &trace->spans[i];
+        if (!trace_span_over_budget(span)) {
+            continue;
+        }
+        over++;
+        uint64_t span_excess = trace_span_duration_us(span) - span->budget_us;
+        if (worst_id < 0 || span_excess > excess) {
+            worst_id = i;
+            excess   = span_excess;
+        }
+    }
+    if (worst) {
+        *worst = worst_id;
+    }
+    return over;
+}
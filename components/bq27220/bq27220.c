@@ -50,11 +50,12 @@ uint16_t bq27220_get_voltage_mv(void)
     return 0;
 }
 
-int16_t bq27220_get_current_ma(void)
+esp_err_t bq27220_get_current_ma(int16_t *current_ma)
 {
     uint16_t current;
-    if (bq27220_read_word(BQ27220_CMD_CURRENT, &current) == ESP_OK) {
-        return (int16_t)current;
+    esp_err_t ret = bq27220_read_word(BQ27220_CMD_CURRENT, &current);
+    if (ret == ESP_OK) {
+        *current_ma = (int16_t)current;
     }
-    return 0;
+    return ret;
 }
@@ -12,7 +12,7 @@ extern "C" {
 esp_err_t bq27220_init(void);
 uint8_t bq27220_get_soc(void);
 uint16_t bq27220_get_voltage_mv(void);
-int16_t bq27220_get_current_ma(void);
+esp_err_t bq27220_get_current_ma(int16_t *current_ma);
 
 #ifdef __cplusplus
 }
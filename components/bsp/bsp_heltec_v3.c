@@ -458,6 +458,12 @@ bool bsp_battery_is_charging(void)
     return false;
 }
 
+esp_err_t bsp_battery_get_current_ma(int16_t *current_ma)
+{
+    // Heltec V3 measures voltage only (ADC divider, no fuel gauge)
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
 const bsp_usb_config_t *bsp_get_usb_config(void)
 {
     static bsp_usb_config_t usb_config = {.usb_pid = 0xFAB0, .usb_product = NULL};
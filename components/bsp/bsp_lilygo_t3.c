@@ -143,6 +143,12 @@ bool bsp_battery_is_charging(void)
     return false;
 }
 
+esp_err_t bsp_battery_get_current_ma(int16_t *current_ma)
+{
+    // LilyGO T3-S3 doesn't have a fuel gauge
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
 gpio_num_t bsp_get_encoder_clk_gpio(void)
 {
     return ENCODER_CLK_PIN;
@@ -375,6 +375,14 @@ bool bsp_battery_is_charging(void)
     return bq25896_is_charging();
 }
 
+esp_err_t bsp_battery_get_current_ma(int16_t *current_ma)
+{
+    if (!current_ma) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return bq27220_get_current_ma(current_ma);
+}
+
 void bsp_led_set(bool state)
 {
     gpio_set_level(BOARD_BL_EN, state ? 1 : 0);
@@ -198,6 +198,15 @@ static inline uint8_t bsp_battery_voltage_to_percentage(float voltage)
  */
 bool bsp_battery_is_charging(void);
 
+/**
+ * @brief Read battery current from the fuel gauge
+ *
+ * @param current_ma Output current in mA (negative = discharging)
+ * @return ESP_OK on success, ESP_ERR_NOT_SUPPORTED if the board has no fuel gauge, or the I2C
+ *         error of a failed read (current_ma is left unchanged)
+ */
+esp_err_t bsp_battery_get_current_ma(int16_t *current_ma);
+
 /**
  * @brief Enter deep sleep mode with button wake-up
  *
@@ -0,0 +1,68 @@
+/**
+ * @file command_sched.c
+ * @brief Per-transport request queues for the JSON-RPC worker pool
+ */
+
+#include "command_sched.h"
+#include <string.h>
+
+void command_sched_init(command_sched_t *sched)
+{
+    memset(sched, 0, sizeof(*sched));
+}
+
+static esp_err_t push_job(command_sched_t *sched, const command_job_t *job)
+{
+    if ((unsigned)job->transport >= COMMAND_TRANSPORT_COUNT || !job->line) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    command_transport_t transport = job->transport;
+    if (sched->count[transport] >= COMMAND_SCHED_DEPTH) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    uint8_t tail                 = (sched->head[transport] + sched->count[transport]) % COMMAND_SCHED_DEPTH;
+    sched->jobs[transport][tail] = *job;
+    sched->count[transport]++;
+    return ESP_OK;
+}
+
+esp_err_t command_sched_push(command_sched_t *sched, command_transport_t transport, char *line)
+{
+    return push_job(sched, &(command_job_t){.transport = transport, .line = line});
+}
+
+esp_err_t command_sched_push_frame(command_sched_t *sched, command_transport_t transport, char *payload, size_t len)
+{
+    return push_job(sched, &(command_job_t){.transport = transport, .line = payload, .binary = true, .frame_len = len});
+}
+
+bool command_sched_next(command_sched_t *sched, command_job_t *job)
+{
+    for (int i = 0; i < COMMAND_TRANSPORT_COUNT; i++) {
+        int t = (sched->next + i) % COMMAND_TRANSPORT_COUNT;
+        if (sched->count[t] == 0 || (sched->busy & (1UL << t))) {
+            continue;
+        }
+
+        *job           = sched->jobs[t][sched->head[t]];
+        sched->head[t] = (sched->head[t] + 1) % COMMAND_SCHED_DEPTH;
+        sched->count[t]--;
+        sched->busy |= 1UL << t;
+        sched->next  = (uint8_t)((t + 1) % COMMAND_TRANSPORT_COUNT);
+        return true;
+    }
+    return false;
+}
+
+void command_sched_done(command_sched_t *sched, command_transport_t transport)
+{
+    if ((unsigned)transport < COMMAND_TRANSPORT_COUNT) {
+        sched->busy &= ~(1UL << transport);
+    }
+}
+
+uint8_t command_sched_pending(const command_sched_t *sched, command_transport_t transport)
+{
+    return (unsigned)transport < COMMAND_TRANSPORT_COUNT ? sched->count[transport] : 0;
+}
@@ -1,6 +1,6 @@
 #include "commands.h"
+#include "boot_trace.h"
 #include "bsp.h"
-#include "cJSON.h"
 #include "commands_api.h"
 #include "esp_chip_info.h"
 #include "esp_flash.h"
@@ -10,318 +10,580 @@
 #include "esp_partition.h"
 #include "esp_system.h"
 #include "esp_timer.h"
+#include "fast_resume.h"
 #include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include "freertos/task.h"
+#include "init_scheduler.h"
+#include "json_stream.h"
 #include "power_mgmt.h"
+#include "rpc_frame.h"
+#include "rpc_schema.h"
+#include "sdkconfig.h"
+#include "task_config.h"
 #include "version.h"
+#include <stdlib.h>
 #include <string.h>
 
-// JSON-RPC 2.0 error codes
-#define JSONRPC_PARSE_ERROR -32700
-#define JSONRPC_INVALID_REQUEST -32600
-#define JSONRPC_METHOD_NOT_FOUND -32601
-#define JSONRPC_INVALID_PARAMS -32602
-#define JSONRPC_INTERNAL_ERROR -32603
+static const char *TAG = "commands";
 
 #define BYTES_PER_MB (1024 * 1024)
 #define BYTES_PER_KB 1024
 #define US_PER_SEC 1000000
-#define SLOT_ID_MIN 1
-#define SLOT_ID_MAX 16
 #define MAX_COMMAND_LENGTH 8192
 #define RESET_DELAY_MS 500
 
-static response_fn_t s_send_response = NULL;
-static cJSON *s_request_id           = NULL;
+#define COMMAND_WORKER_STACK_SIZE 6144 // power:stats gathers the energy and sleep reports on the stack
+
+/**
+ * @brief Per-request context passed to every handler
+ */
+struct rpc_request {
+    json_writer_t writer; ///< Streams into the route through a COMMAND_RESPONSE_CHUNK stack buffer
+    const command_route_t *route;
+    const char *id; ///< Raw request id, NULL for notifications and unparseable requests
+    size_t id_len;
+    bool binary;               ///< Request came in a frame: answer CBOR [id, status, body], framed
+    rpc_frame_encoder_t frame; ///< Binary only: sits between the writer and the route
+};
+
+// Worker pool: requests from submitting transports, executed by CONFIG_LORACUE_COMMAND_WORKERS tasks
+static SemaphoreHandle_t s_pool_lock = NULL;
+static SemaphoreHandle_t s_pool_work = NULL; // Counts submitted requests not yet picked up
+static command_sched_t s_sched;
+static command_route_t s_routes[COMMAND_TRANSPORT_COUNT];
 
-static void send_jsonrpc_result(cJSON *result)
+static void route_write(const char *data, size_t len, void *ctx)
 {
-    cJSON *response = cJSON_CreateObject();
-    cJSON_AddStringToObject(response, "jsonrpc", "2.0");
-    cJSON_AddItemToObject(response, "result", result);
-    if (s_request_id) {
-        cJSON_AddItemToObject(response, "id", cJSON_Duplicate(s_request_id, 1));
-    }
+    const command_route_t *route = ctx;
+    route->write(data, len, route->ctx);
+}
 
-    char *json_str = cJSON_PrintUnformatted(response);
-    if (json_str) {
-        s_send_response(json_str);
-        free(json_str);
+static void write_id(rpc_request_t *req)
+{
+    if (req->id) {
+        json_write_raw(&req->writer, req->id, req->id_len);
+    } else {
+        json_write_null(&req->writer);
     }
-    cJSON_Delete(response);
 }
 
-static void send_jsonrpc_error(int code, const char *message)
+// Writes the envelope up to the value of member ("result" or "error"); a binary response
+// carries the status code in place of the member name
+static json_writer_t *begin_response(rpc_request_t *req, const char *member, int code)
 {
-    cJSON *response = cJSON_CreateObject();
-    cJSON_AddStringToObject(response, "jsonrpc", "2.0");
+    json_writer_t *w = &req->writer;
+    if (req->binary) {
+        json_write_array_begin(w);
+        write_id(req);
+        json_write_int(w, code);
+        return w;
+    }
 
-    cJSON *error = cJSON_CreateObject();
-    cJSON_AddNumberToObject(error, "code", code);
-    cJSON_AddStringToObject(error, "message", message);
-    cJSON_AddItemToObject(response, "error", error);
+    json_write_object_begin(w);
+    json_write_kv_string(w, "jsonrpc", "2.0");
+    json_write_key(w, "id");
+    write_id(req);
+    json_write_key(w, member);
+    return w;
+}
+
+static json_writer_t *begin_result(rpc_request_t *req)
+{
+    return begin_response(req, "result", 0);
+}
 
-    if (s_request_id) {
-        cJSON_AddItemToObject(response, "id", cJSON_Duplicate(s_request_id, 1));
+static void end_response(rpc_request_t *req)
+{
+    if (req->binary) {
+        json_write_array_end(&req->writer);
+        json_writer_flush(&req->writer);
+        rpc_frame_encoder_end(&req->frame);
     } else {
-        cJSON_AddNullToObject(response, "id");
+        json_write_object_end(&req->writer);
+        json_writer_flush(&req->writer);
+    }
+    if (req->route->end) {
+        req->route->end(req->binary, req->route->ctx);
     }
+}
+
+static void send_jsonrpc_result_string(rpc_request_t *req, const char *result)
+{
+    json_write_string(begin_result(req), result);
+    end_response(req);
+}
 
-    char *json_str = cJSON_PrintUnformatted(response);
-    if (json_str) {
-        s_send_response(json_str);
-        free(json_str);
+static void send_jsonrpc_error(rpc_request_t *req, int code, const char *message)
+{
+    json_writer_t *w = begin_response(req, "error", code);
+    if (req->binary) {
+        json_write_string(w, message);
+        end_response(req);
+        return;
     }
-    cJSON_Delete(response);
+    json_write_object_begin(w);
+    json_write_kv_int(w, "code", code);
+    json_write_kv_string(w, "message", message);
+    json_write_object_end(w);
+    end_response(req);
 }
 
-static void handle_ping(void)
+json_writer_t *commands_begin_result(rpc_request_t *req)
 {
-    send_jsonrpc_result(cJSON_CreateString("pong"));
+    return begin_result(req);
 }
 
-static void handle_get_device_info(void)
+void commands_end_response(rpc_request_t *req)
 {
-    cJSON *response = cJSON_CreateObject();
+    end_response(req);
+}
 
-    cJSON_AddStringToObject(response, "model", bsp_get_model_name());
-    cJSON_AddStringToObject(response, "board_id", bsp_get_board_id());
-    cJSON_AddStringToObject(response, "version", LORACUE_VERSION_STRING);
-    cJSON_AddStringToObject(response, "commit", LORACUE_BUILD_COMMIT_SHORT);
-    cJSON_AddStringToObject(response, "branch", LORACUE_BUILD_BRANCH);
-    cJSON_AddStringToObject(response, "build_date", LORACUE_BUILD_DATE);
+void commands_send_error(rpc_request_t *req, int code, const char *message)
+{
+    send_jsonrpc_error(req, code, message);
+}
 
+static void send_params_error(rpc_request_t *req, rpc_method_t method, int bad_param)
+{
+    if (bad_param == RPC_PARAM_NONE) {
+        send_jsonrpc_error(req, JSONRPC_INVALID_PARAMS, "Missing params");
+        return;
+    }
+
+    const rpc_param_t *param = &rpc_method_info(method)->params[bad_param];
+    if (param->error) {
+        send_jsonrpc_error(req, JSONRPC_INVALID_PARAMS, param->error);
+        return;
+    }
+    char message[48];
+    snprintf(message, sizeof(message), "Invalid %s", param->name);
+    send_jsonrpc_error(req, JSONRPC_INVALID_PARAMS, message);
+}
+
+static void format_mac(char out[18], const uint8_t mac[6])
+{
+    snprintf(out, 18, "%02x:%02x:%02x:%02x:%02x:%02x", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+}
+
+static bool parse_mac(const char *str, uint8_t mac[6])
+{
+    return sscanf(str, "%02hhx:%02hhx:%02hhx:%02hhx:%02hhx:%02hhx", &mac[0], &mac[1], &mac[2], &mac[3], &mac[4],
+                  &mac[5]) == 6;
+}
+
+static void handle_ping(rpc_request_t *req, const rpc_params_t *params)
+{
+    (void)params;
+    send_jsonrpc_result_string(req, "pong");
+}
+
+static void handle_get_device_info(rpc_request_t *req, const rpc_params_t *params)
+{
+    (void)params;
     esp_chip_info_t chip_info;
     esp_chip_info(&chip_info);
-    cJSON_AddStringToObject(response, "chip_model", CONFIG_IDF_TARGET);
-    cJSON_AddNumberToObject(response, "chip_revision", chip_info.revision);
-    cJSON_AddNumberToObject(response, "cpu_cores", chip_info.cores);
-
     uint32_t flash_size = 0;
     esp_flash_get_size(NULL, &flash_size);
-    cJSON_AddNumberToObject(response, "flash_size_mb", flash_size / BYTES_PER_MB);
-
     uint8_t mac[6];
     esp_efuse_mac_get_default(mac);
     char mac_str[18];
-    snprintf(mac_str, sizeof(mac_str), "%02x:%02x:%02x:%02x:%02x:%02x", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
-    cJSON_AddStringToObject(response, "mac", mac_str);
-
-    cJSON_AddNumberToObject(response, "uptime_sec", esp_timer_get_time() / US_PER_SEC);
-    cJSON_AddNumberToObject(response, "free_heap_kb", esp_get_free_heap_size() / BYTES_PER_KB);
+    format_mac(mac_str, mac);
+
+    json_writer_t *w = begin_result(req);
+    json_write_object_begin(w);
+    json_write_kv_string(w, "model", bsp_get_model_name());
+    json_write_kv_string(w, "board_id", bsp_get_board_id());
+    json_write_kv_string(w, "version", LORACUE_VERSION_STRING);
+    json_write_kv_string(w, "commit", LORACUE_BUILD_COMMIT_SHORT);
+    json_write_kv_string(w, "branch", LORACUE_BUILD_BRANCH);
+    json_write_kv_string(w, "build_date", LORACUE_BUILD_DATE);
+    json_write_kv_string(w, "chip_model", CONFIG_IDF_TARGET);
+    json_write_kv_uint(w, "chip_revision", chip_info.revision);
+    json_write_kv_uint(w, "cpu_cores", chip_info.cores);
+    json_write_kv_uint(w, "flash_size_mb", flash_size / BYTES_PER_MB);
+    json_write_kv_string(w, "mac", mac_str);
+    json_write_kv_int(w, "uptime_sec", esp_timer_get_time() / US_PER_SEC);
+    json_write_kv_uint(w, "free_heap_kb", esp_get_free_heap_size() / BYTES_PER_KB);
 
     const esp_partition_t *running = esp_ota_get_running_partition();
     if (running) {
-        cJSON_AddStringToObject(response, "partition", running->label);
+        json_write_kv_string(w, "partition", running->label);
     }
-
-    send_jsonrpc_result(response);
+    json_write_object_end(w);
+    end_response(req);
 }
 
-static void handle_get_general(void)
+static void handle_get_general(rpc_request_t *req, const rpc_params_t *params)
 {
+    (void)params;
     general_config_t config;
     if (cmd_get_general_config(&config) != ESP_OK) {
-        send_jsonrpc_error(JSONRPC_INTERNAL_ERROR, "Failed to get config");
+        send_jsonrpc_error(req, JSONRPC_INTERNAL_ERROR, "Failed to get config");
         return;
     }
 
-    cJSON *response = cJSON_CreateObject();
-    cJSON_AddStringToObject(response, "name", config.device_name);
-    cJSON_AddStringToObject(response, "mode", device_mode_to_string(config.device_mode));
-    cJSON_AddNumberToObject(response, "contrast", config.display_contrast);
-    cJSON_AddBoolToObject(response, "bluetooth", config.bluetooth_enabled);
-    cJSON_AddBoolToObject(response, "bluetooth_pairing", config.bluetooth_pairing_enabled);
-    cJSON_AddNumberToObject(response, "slot_id", config.slot_id);
-
-    send_jsonrpc_result(response);
+    json_writer_t *w = begin_result(req);
+    json_write_object_begin(w);
+    json_write_kv_string(w, "name", config.device_name);
+    json_write_kv_string(w, "mode", device_mode_to_string(config.device_mode));
+    json_write_kv_uint(w, "contrast", config.display_contrast);
+    json_write_kv_bool(w, "bluetooth", config.bluetooth_enabled);
+    json_write_kv_bool(w, "bluetooth_pairing", config.bluetooth_pairing_enabled);
+    json_write_kv_uint(w, "slot_id", config.slot_id);
+    json_write_object_end(w);
+    end_response(req);
 }
 
-static void handle_set_general(cJSON *config_json)
+static void handle_set_general(rpc_request_t *req, const rpc_params_t *params)
 {
+    const rpc_general_set_params_t *p = &params->general_set;
+
     general_config_t config;
     if (cmd_get_general_config(&config) != ESP_OK) {
-        send_jsonrpc_error(JSONRPC_INTERNAL_ERROR, "Failed to get current config");
+        send_jsonrpc_error(req, JSONRPC_INTERNAL_ERROR, "Failed to get current config");
         return;
     }
 
-    cJSON *name = cJSON_GetObjectItem(config_json, "name");
-    if (name && cJSON_IsString(name)) {
-        strncpy(config.device_name, name->valuestring, sizeof(config.device_name) - 1);
-        config.device_name[sizeof(config.device_name) - 1] = '\0';
+    if (rpc_param_present(params, GENERAL_SET_NAME)) {
+        strcpy(config.device_name, p->name); // Schema bounds name to the field
     }
-
-    cJSON *mode = cJSON_GetObjectItem(config_json, "mode");
-    if (mode && cJSON_IsString(mode)) {
-        if (strcmp(mode->valuestring, "PRESENTER") == 0) {
+    if (rpc_param_present(params, GENERAL_SET_MODE)) {
+        if (strcmp(p->mode, "PRESENTER") == 0) {
             config.device_mode = DEVICE_MODE_PRESENTER;
-        } else if (strcmp(mode->valuestring, "PC") == 0) {
+        } else if (strcmp(p->mode, "PC") == 0) {
             config.device_mode = DEVICE_MODE_PC;
         } else {
-            send_jsonrpc_error(JSONRPC_INVALID_PARAMS, "Invalid mode");
+            send_jsonrpc_error(req, JSONRPC_INVALID_PARAMS, "Invalid mode");
             return;
         }
     }
+    if (rpc_param_present(params, GENERAL_SET_CONTRAST)) {
+        config.display_contrast = (uint8_t)p->contrast;
+    }
+    if (rpc_param_present(params, GENERAL_SET_BLUETOOTH)) {
+        config.bluetooth_enabled = p->bluetooth;
+    }
+    if (rpc_param_present(params, GENERAL_SET_BLUETOOTH_PAIRING)) {
+        config.bluetooth_pairing_enabled = p->bluetooth_pairing;
+    }
+    if (rpc_param_present(params, GENERAL_SET_SLOT_ID)) {
+        config.slot_id = (uint8_t)p->slot_id;
+    }
 
-    cJSON *contrast = cJSON_GetObjectItem(config_json, "contrast");
-    if (contrast && cJSON_IsNumber(contrast)) {
-        config.display_contrast = (uint8_t)contrast->valueint;
+    if (cmd_set_general_config(&config) != ESP_OK) {
+        send_jsonrpc_error(req, JSONRPC_INTERNAL_ERROR, "Failed to save config");
+        return;
     }
 
-    cJSON *bluetooth = cJSON_GetObjectItem(config_json, "bluetooth");
-    if (bluetooth && cJSON_IsBool(bluetooth)) {
-        config.bluetooth_enabled = cJSON_IsTrue(bluetooth);
+    send_jsonrpc_result_string(req, "Config updated");
+}
+
+static void handle_get_power_management(rpc_request_t *req, const rpc_params_t *params)
+{
+    (void)params;
+    power_config_t config;
+    if (cmd_get_power_config(&config) != ESP_OK) {
+        send_jsonrpc_error(req, JSONRPC_INTERNAL_ERROR, "Failed to get power config");
+        return;
     }
 
-    cJSON *bluetooth_pairing = cJSON_GetObjectItem(config_json, "bluetooth_pairing");
-    if (bluetooth_pairing && cJSON_IsBool(bluetooth_pairing)) {
-        config.bluetooth_pairing_enabled = cJSON_IsTrue(bluetooth_pairing);
+    json_writer_t *w = begin_result(req);
+    json_write_object_begin(w);
+    json_write_kv_bool(w, "display_sleep_enabled", config.enable_auto_display_sleep);
+    json_write_kv_uint(w, "display_sleep_timeout_ms", config.display_sleep_timeout_ms);
+    json_write_kv_bool(w, "light_sleep_enabled", config.enable_auto_light_sleep);
+    json_write_kv_uint(w, "light_sleep_timeout_ms", config.light_sleep_timeout_ms);
+    json_write_kv_bool(w, "deep_sleep_enabled", config.enable_auto_deep_sleep);
+    json_write_kv_uint(w, "deep_sleep_timeout_ms", config.deep_sleep_timeout_ms);
+    json_write_object_end(w);
+    end_response(req);
+}
+
+static void write_sleep_report(json_writer_t *w, const power_sleep_report_t *sleep)
+{
+    const sleep_policy_t *policy = &sleep->policy;
+    int blocker                  = sleep_policy_blocker(policy);
+    int fastest;
+    uint32_t min_period = sleep_policy_min_wake_period_ms(policy, &fastest);
+
+    json_write_kv_object(w, "sleep");
+    json_write_kv_bool(w, "can_sleep", sleep_policy_can_sleep(policy));
+    json_write_kv_string(w, "blocker", blocker >= 0 ? policy->clients[blocker].name : NULL);
+    json_write_kv_uint(w, "blocked_ms", sleep_policy_any_blocked_us(policy, sleep->now_us) / 1000);
+    json_write_kv_uint(w, "light_sleep_count", sleep->light_sleep_count);
+    json_write_kv_uint(w, "light_sleep_ms", sleep->light_sleep_us / 1000);
+    json_write_kv_uint(w, "min_wake_period_ms", min_period);
+    if (fastest >= 0) {
+        json_write_kv_string(w, "min_wake_period_client", policy->clients[fastest].name);
     }
 
-    cJSON *slot_id = cJSON_GetObjectItem(config_json, "slot_id");
-    if (slot_id && cJSON_IsNumber(slot_id)) {
-        int slot = slot_id->valueint;
-        if (slot < SLOT_ID_MIN || slot > SLOT_ID_MAX) {
-            send_jsonrpc_error(JSONRPC_INVALID_PARAMS, "Invalid slot_id (1-16)");
-            return;
+    json_write_kv_array(w, "clients");
+    for (int i = 0; i < policy->count; i++) {
+        const sleep_client_t *client = &policy->clients[i];
+        json_write_object_begin(w);
+        json_write_kv_string(w, "name", client->name);
+
+        json_write_kv_array(w, "wake_sources");
+        for (int b = 0; b < SLEEP_WAKE_SOURCE_COUNT; b++) {
+            if (client->wake_sources & (1 << b)) {
+                json_write_string(w, sleep_policy_wake_source_name(1 << b));
+            }
         }
-        config.slot_id = slot;
+        json_write_array_end(w);
+        json_write_kv_uint(w, "period_ms", client->wake_period_ms);
+        json_write_kv_bool(w, "blocking", client->block_depth > 0);
+        json_write_kv_uint(w, "blocked_ms", sleep_policy_blocked_us(policy, i, sleep->now_us) / 1000);
+        json_write_kv_uint(w, "block_count", client->block_count);
+        json_write_object_end(w);
     }
+    json_write_array_end(w);
+    json_write_object_end(w);
+}
 
-    if (cmd_set_general_config(&config) != ESP_OK) {
-        send_jsonrpc_error(JSONRPC_INTERNAL_ERROR, "Failed to save config");
+static void handle_get_power_stats(rpc_request_t *req, const rpc_params_t *params)
+{
+    (void)params;
+    energy_report_t report;
+    if (power_mgmt_get_energy_report(&report) != ESP_OK) {
+        send_jsonrpc_error(req, JSONRPC_INTERNAL_ERROR, "Energy accounting not available");
         return;
     }
 
-    send_jsonrpc_result(cJSON_CreateString("Config updated"));
+    json_writer_t *w = begin_result(req);
+    json_write_object_begin(w);
+    json_write_kv_uint(w, "uptime_ms", report.uptime_ms);
+
+    json_write_kv_object(w, "components");
+    for (int c = 0; c < ENERGY_COMPONENT_COUNT; c++) {
+        json_write_kv_object(w, energy_model_component_name((energy_component_t)c));
+        json_write_kv_string(w, "state", energy_model_state_name((energy_component_t)c, report.state[c]));
+        json_write_kv_uint(w, "transitions", report.transitions[c]);
+
+        json_write_kv_object(w, "residency_ms");
+        for (uint8_t s = 0; s < ENERGY_MAX_STATES; s++) {
+            const char *state_name = energy_model_state_name((energy_component_t)c, s);
+            if (state_name) {
+                json_write_kv_uint(w, state_name, report.residency_ms[c][s]);
+            }
+        }
+        json_write_object_end(w);
+        json_write_object_end(w);
+    }
+    json_write_object_end(w);
+
+    json_write_kv_uint(w, "modeled_avg_ua", report.modeled_avg_ua);
+    json_write_kv_uint(w, "calibrated_avg_ua", report.calibrated_avg_ua);
+    json_write_kv_int(w, "measured_ua", report.last_measured_ua);
+    json_write_kv_double(w, "calibration_scale", report.calibration_scale);
+    json_write_kv_uint(w, "calibration_samples", report.calibration_samples);
+    json_write_kv_double(w, "projected_battery_hours", report.projected_hours);
+
+    power_sleep_report_t sleep;
+    if (power_mgmt_get_sleep_report(&sleep) == ESP_OK) {
+        write_sleep_report(w, &sleep);
+    }
+
+    fast_resume_timing_t resume;
+    if (fast_resume_get_timing(&resume) == ESP_OK && resume.attempted) {
+        json_write_kv_object(w, "resume");
+        json_write_kv_string(w, "result", esp_err_to_name(resume.result));
+        json_write_kv_uint(w, "app_start_us", resume.app_start_us);
+        json_write_kv_uint(w, "crypto_us", resume.crypto_us);
+        json_write_kv_uint(w, "radio_us", resume.radio_us);
+        json_write_kv_uint(w, "button_to_tx_done_us", resume.tx_done_us);
+        json_write_object_end(w);
+    }
+
+    json_write_object_end(w);
+    end_response(req);
 }
 
-static void handle_get_power_management(void)
+static void write_mark_time(json_writer_t *w, const char *key, const trace_buffer_t *trace, const char *mark)
 {
-    power_config_t config;
-    if (cmd_get_power_config(&config) != ESP_OK) {
-        send_jsonrpc_error(JSONRPC_INTERNAL_ERROR, "Failed to get power config");
-        return;
+    int id = trace_buffer_find(trace, mark);
+    if (id >= 0) {
+        json_write_kv_uint(w, key, trace->spans[id].start_us);
+    } else {
+        json_write_kv_null(w, key);
     }
+}
 
-    cJSON *response = cJSON_CreateObject();
-    cJSON_AddBoolToObject(response, "display_sleep_enabled", config.enable_auto_display_sleep);
-    cJSON_AddNumberToObject(response, "display_sleep_timeout_ms", config.display_sleep_timeout_ms);
-    cJSON_AddBoolToObject(response, "light_sleep_enabled", config.enable_auto_light_sleep);
-    cJSON_AddNumberToObject(response, "light_sleep_timeout_ms", config.light_sleep_timeout_ms);
-    cJSON_AddBoolToObject(response, "deep_sleep_enabled", config.enable_auto_deep_sleep);
-    cJSON_AddNumberToObject(response, "deep_sleep_timeout_ms", config.deep_sleep_timeout_ms);
+// Result is a Chrome trace (chrome://tracing, ui.perfetto.dev): save it as a .json file to view
+static void handle_get_boot_trace(rpc_request_t *req, const rpc_params_t *params)
+{
+    (void)params;
+    trace_buffer_t *trace = malloc(sizeof(trace_buffer_t));
+    if (!trace) {
+        send_jsonrpc_error(req, JSONRPC_INTERNAL_ERROR, "Out of memory");
+        return;
+    }
+    boot_trace_snapshot(trace);
+
+    json_writer_t *w = begin_result(req);
+    json_write_object_begin(w);
+    json_write_kv_array(w, "traceEvents");
+    for (int i = 0; i < trace->count; i++) {
+        const trace_span_t *span = &trace->spans[i];
+        json_write_object_begin(w);
+        json_write_kv_string(w, "name", span->name);
+        json_write_kv_string(w, "cat", "boot");
+        json_write_kv_string(w, "ph", span->instant ? "i" : "X");
+        json_write_kv_uint(w, "ts", span->start_us);
+        if (span->instant) {
+            json_write_kv_string(w, "s", "g");
+        } else {
+            json_write_kv_uint(w, "dur", trace_span_duration_us(span));
+        }
+        json_write_kv_uint(w, "pid", 1);
+        json_write_kv_uint(w, "tid", span->track + 1); // One row per core
+
+        json_write_kv_object(w, "args");
+        json_write_kv_uint(w, "heap_free", span->heap_start);
+        if (!span->instant) {
+            json_write_kv_int(w, "heap_delta", span->heap_delta);
+            json_write_kv_uint(w, "budget_us", span->budget_us);
+            json_write_kv_bool(w, "over_budget", trace_span_over_budget(span));
+            json_write_kv_bool(w, "open", span->open);
+        }
+        json_write_object_end(w);
+        json_write_object_end(w);
+    }
+    json_write_array_end(w);
+    json_write_kv_string(w, "displayTimeUnit", "ms");
+
+    json_write_kv_object(w, "otherData");
+    write_mark_time(w, "app_main_us", trace, BOOT_TRACE_MARK_APP_START);
+    write_mark_time(w, "lora_ready_us", trace, BOOT_TRACE_MARK_LORA_READY);
+    write_mark_time(w, "keypress_ready_us", trace, BOOT_TRACE_MARK_KEYPRESS_READY);
+    write_mark_time(w, "boot_complete_us", trace, BOOT_TRACE_MARK_COMPLETE);
+    json_write_kv_uint(w, "lora_ready_budget_us", BOOT_LORA_READY_BUDGET_US);
+    json_write_kv_uint(w, "keypress_ready_budget_us", BOOT_KEYPRESS_READY_BUDGET_US);
+    json_write_kv_int(w, "over_budget", trace_buffer_over_budget(trace, NULL));
+    json_write_kv_uint(w, "dropped", trace->dropped);
+    free(trace);
+
+    init_scheduler_report_t *report = malloc(sizeof(init_scheduler_report_t));
+    if (report && init_scheduler_get_report(report) == ESP_OK) {
+        json_write_kv_uint(w, "init_workers", report->workers);
+        json_write_kv_uint(w, "init_serial_us", report->serial_us);
+        json_write_kv_uint(w, "critical_path_us", report->path_us);
+        json_write_kv_array(w, "critical_path");
+        for (int i = 0; i < report->path_len; i++) {
+            json_write_string(w, boot_stage_info((boot_stage_t)report->path[i])->name);
+        }
+        json_write_array_end(w);
+    }
+    free(report);
 
-    send_jsonrpc_result(response);
+    json_write_object_end(w);
+    json_write_object_end(w);
+    end_response(req);
 }
 
-static void handle_set_power_management(cJSON *config_json)
+static void handle_set_power_management(rpc_request_t *req, const rpc_params_t *params)
 {
+    const rpc_power_set_params_t *p = &params->power_set;
+
     power_config_t config;
     if (cmd_get_power_config(&config) != ESP_OK) {
-        send_jsonrpc_error(JSONRPC_INTERNAL_ERROR, "Failed to get current power config");
+        send_jsonrpc_error(req, JSONRPC_INTERNAL_ERROR, "Failed to get current power config");
         return;
     }
 
-    cJSON *item;
-    if ((item = cJSON_GetObjectItem(config_json, "display_sleep_enabled")) && cJSON_IsBool(item))
-        config.enable_auto_display_sleep = cJSON_IsTrue(item);
-    if ((item = cJSON_GetObjectItem(config_json, "display_sleep_timeout_ms")) && cJSON_IsNumber(item))
-        config.display_sleep_timeout_ms = item->valueint;
-    if ((item = cJSON_GetObjectItem(config_json, "light_sleep_enabled")) && cJSON_IsBool(item))
-        config.enable_auto_light_sleep = cJSON_IsTrue(item);
-    if ((item = cJSON_GetObjectItem(config_json, "light_sleep_timeout_ms")) && cJSON_IsNumber(item))
-        config.light_sleep_timeout_ms = item->valueint;
-    if ((item = cJSON_GetObjectItem(config_json, "deep_sleep_enabled")) && cJSON_IsBool(item))
-        config.enable_auto_deep_sleep = cJSON_IsTrue(item);
-    if ((item = cJSON_GetObjectItem(config_json, "deep_sleep_timeout_ms")) && cJSON_IsNumber(item))
-        config.deep_sleep_timeout_ms = item->valueint;
+    if (rpc_param_present(params, POWER_SET_DISPLAY_SLEEP_ENABLED))
+        config.enable_auto_display_sleep = p->display_sleep_enabled;
+    if (rpc_param_present(params, POWER_SET_DISPLAY_SLEEP_TIMEOUT_MS))
+        config.display_sleep_timeout_ms = p->display_sleep_timeout_ms;
+    if (rpc_param_present(params, POWER_SET_LIGHT_SLEEP_ENABLED))
+        config.enable_auto_light_sleep = p->light_sleep_enabled;
+    if (rpc_param_present(params, POWER_SET_LIGHT_SLEEP_TIMEOUT_MS))
+        config.light_sleep_timeout_ms = p->light_sleep_timeout_ms;
+    if (rpc_param_present(params, POWER_SET_DEEP_SLEEP_ENABLED))
+        config.enable_auto_deep_sleep = p->deep_sleep_enabled;
+    if (rpc_param_present(params, POWER_SET_DEEP_SLEEP_TIMEOUT_MS))
+        config.deep_sleep_timeout_ms = p->deep_sleep_timeout_ms;
 
     if (cmd_set_power_config(&config) != ESP_OK) {
-        send_jsonrpc_error(JSONRPC_INTERNAL_ERROR, "Failed to save power config");
+        send_jsonrpc_error(req, JSONRPC_INTERNAL_ERROR, "Failed to save power config");
         return;
     }
 
-    send_jsonrpc_result(cJSON_CreateString("Power config updated"));
+    send_jsonrpc_result_string(req, "Power config updated");
 }
 
-static void handle_get_lora_config(void)
+static void handle_get_lora_config(rpc_request_t *req, const rpc_params_t *params)
 {
+    (void)params;
     lora_config_t config;
     if (cmd_get_lora_config(&config) != ESP_OK) {
-        send_jsonrpc_error(JSONRPC_INTERNAL_ERROR, "Failed to get LoRa config");
+        send_jsonrpc_error(req, JSONRPC_INTERNAL_ERROR, "Failed to get LoRa config");
         return;
     }
 
-    cJSON *response = cJSON_CreateObject();
-    cJSON_AddStringToObject(response, "band_id", config.band_id);
-    cJSON_AddNumberToObject(response, "frequency_khz", config.frequency / 1000);
-    cJSON_AddNumberToObject(response, "spreading_factor", config.spreading_factor);
-    cJSON_AddNumberToObject(response, "bandwidth_khz", config.bandwidth);
-    cJSON_AddNumberToObject(response, "coding_rate", config.coding_rate);
-    cJSON_AddNumberToObject(response, "tx_power_dbm", config.tx_power);
-    cJSON_AddStringToObject(response, "regulatory_domain", strlen(config.regulatory_domain) > 0 ? config.regulatory_domain : "Unknown");
-
-    send_jsonrpc_result(response);
+    json_writer_t *w = begin_result(req);
+    json_write_object_begin(w);
+    json_write_kv_string(w, "band_id", config.band_id);
+    json_write_kv_uint(w, "frequency_khz", config.frequency / 1000);
+    json_write_kv_uint(w, "spreading_factor", config.spreading_factor);
+    json_write_kv_uint(w, "bandwidth_khz", config.bandwidth);
+    json_write_kv_uint(w, "coding_rate", config.coding_rate);
+    json_write_kv_int(w, "tx_power_dbm", config.tx_power);
+    json_write_kv_string(w, "regulatory_domain",
+                         strlen(config.regulatory_domain) > 0 ? config.regulatory_domain : "Unknown");
+    json_write_object_end(w);
+    end_response(req);
 }
 
-static void handle_set_lora_config(cJSON *config_json)
+static void handle_set_lora_config(rpc_request_t *req, const rpc_params_t *params)
 {
+    const rpc_lora_set_params_t *p = &params->lora_set;
+
     lora_config_t config;
     if (cmd_get_lora_config(&config) != ESP_OK) {
-        send_jsonrpc_error(JSONRPC_INTERNAL_ERROR, "Failed to get current LoRa config");
-        return;
-    }
-
-    cJSON *freq    = cJSON_GetObjectItem(config_json, "frequency_khz");
-    cJSON *sf      = cJSON_GetObjectItem(config_json, "spreading_factor");
-    cJSON *bw      = cJSON_GetObjectItem(config_json, "bandwidth_khz");
-    cJSON *cr      = cJSON_GetObjectItem(config_json, "coding_rate");
-    cJSON *power   = cJSON_GetObjectItem(config_json, "tx_power_dbm");
-    cJSON *band_id = cJSON_GetObjectItem(config_json, "band_id");
-    cJSON *regulatory_domain = cJSON_GetObjectItem(config_json, "regulatory_domain");
-
-    if (cJSON_IsNumber(bw))
-        config.bandwidth = bw->valueint;
-    if (cJSON_IsNumber(freq))
-        config.frequency = freq->valueint * 1000;
-    if (cJSON_IsNumber(sf))
-        config.spreading_factor = sf->valueint;
-    if (cJSON_IsNumber(cr))
-        config.coding_rate = cr->valueint;
-    if (cJSON_IsString(band_id)) {
-        strncpy(config.band_id, band_id->valuestring, sizeof(config.band_id) - 1);
-        config.band_id[sizeof(config.band_id) - 1] = '\0';
-    }
-    if (cJSON_IsNumber(power))
-        config.tx_power = power->valueint;
-    if (cJSON_IsString(regulatory_domain)) {
-        const char *domain = cJSON_GetStringValue(regulatory_domain);
-        if (!lora_regulatory_validate_domain(domain)) {
-            send_jsonrpc_error(JSONRPC_INVALID_PARAMS, "Invalid regulatory domain");
+        send_jsonrpc_error(req, JSONRPC_INTERNAL_ERROR, "Failed to get current LoRa config");
+        return;
+    }
+
+    // Schema ranges keep every value inside its config field
+    if (rpc_param_present(params, LORA_SET_BANDWIDTH_KHZ))
+        config.bandwidth = (uint16_t)p->bandwidth_khz;
+    if (rpc_param_present(params, LORA_SET_FREQUENCY_KHZ))
+        config.frequency = (uint32_t)p->frequency_khz * 1000;
+    if (rpc_param_present(params, LORA_SET_SPREADING_FACTOR))
+        config.spreading_factor = (uint8_t)p->spreading_factor;
+    if (rpc_param_present(params, LORA_SET_CODING_RATE))
+        config.coding_rate = (uint8_t)p->coding_rate;
+    if (rpc_param_present(params, LORA_SET_BAND_ID))
+        strcpy(config.band_id, p->band_id);
+    if (rpc_param_present(params, LORA_SET_TX_POWER_DBM))
+        config.tx_power = (int8_t)p->tx_power_dbm;
+    if (rpc_param_present(params, LORA_SET_REGULATORY_DOMAIN)) {
+        if (!lora_regulatory_validate_domain(p->regulatory_domain)) {
+            send_jsonrpc_error(req, JSONRPC_INVALID_PARAMS, "Invalid regulatory domain");
             return;
         }
-        strncpy(config.regulatory_domain, domain, sizeof(config.regulatory_domain) - 1);
-        config.regulatory_domain[sizeof(config.regulatory_domain) - 1] = '\0';
+        strcpy(config.regulatory_domain, p->regulatory_domain);
     }
 
     esp_err_t ret = cmd_set_lora_config(&config);
     if (ret == ESP_ERR_INVALID_ARG) {
-        send_jsonrpc_error(JSONRPC_INVALID_PARAMS, "Invalid LoRa parameters");
+        send_jsonrpc_error(req, JSONRPC_INVALID_PARAMS, "Invalid LoRa parameters");
         return;
     } else if (ret != ESP_OK) {
-        send_jsonrpc_error(JSONRPC_INTERNAL_ERROR, "Failed to save LoRa config");
+        send_jsonrpc_error(req, JSONRPC_INTERNAL_ERROR, "Failed to save LoRa config");
         return;
     }
 
-    send_jsonrpc_result(cJSON_CreateString("LoRa config updated"));
+    send_jsonrpc_result_string(req, "LoRa config updated");
 }
 
-static void handle_get_lora_key(void)
+static void handle_get_lora_key(rpc_request_t *req, const rpc_params_t *params)
 {
+    (void)params;
     lora_config_t config;
     if (cmd_get_lora_config(&config) != ESP_OK) {
-        send_jsonrpc_error(JSONRPC_INTERNAL_ERROR, "Failed to get LoRa config");
+        send_jsonrpc_error(req, JSONRPC_INTERNAL_ERROR, "Failed to get LoRa config");
         return;
     }
 
@@ -331,234 +593,482 @@ static void handle_get_lora_key(void)
     }
     hex_key[64] = '\0';
 
-    cJSON *response = cJSON_CreateObject();
-    cJSON_AddStringToObject(response, "aes_key", hex_key);
-    send_jsonrpc_result(response);
+    json_writer_t *w = begin_result(req);
+    json_write_object_begin(w);
+    json_write_kv_string(w, "aes_key", hex_key);
+    json_write_object_end(w);
+    end_response(req);
 }
 
-static void handle_set_lora_key(cJSON *json)
+static void handle_set_lora_key(rpc_request_t *req, const rpc_params_t *params)
 {
-    cJSON *aes_key_json = cJSON_GetObjectItem(json, "aes_key");
-    if (!aes_key_json || !cJSON_IsString(aes_key_json) || strlen(aes_key_json->valuestring) != 64) {
-        send_jsonrpc_error(JSONRPC_INVALID_PARAMS, "Invalid aes_key (must be 64 hex chars)");
+    const char *hex_key = params->lora_key_set.aes_key;
+    if (strlen(hex_key) != 64) {
+        send_jsonrpc_error(req, JSONRPC_INVALID_PARAMS, "Invalid aes_key (must be 64 hex chars)");
         return;
     }
 
     uint8_t key_bytes[32];
-    const char *hex_key = aes_key_json->valuestring;
     for (int i = 0; i < 32; i++) {
         const char byte_str[3] = {hex_key[i * 2], hex_key[i * 2 + 1], '\0'};
         key_bytes[i]           = (uint8_t)strtol(byte_str, NULL, 16);
     }
 
     if (cmd_set_lora_key(key_bytes) != ESP_OK) {
-        send_jsonrpc_error(JSONRPC_INTERNAL_ERROR, "Failed to set key");
+        send_jsonrpc_error(req, JSONRPC_INTERNAL_ERROR, "Failed to set key");
         return;
     }
 
-    send_jsonrpc_result(cJSON_CreateString("Key updated"));
+    send_jsonrpc_result_string(req, "Key updated");
 }
 
-static void handle_get_paired_devices(void)
+static void handle_get_paired_devices(rpc_request_t *req, const rpc_params_t *params)
 {
-    paired_device_t devices[SLOT_ID_MAX]; // Assume max 16
+    (void)params;
+    // Registry capacity is configurable (up to 128), too large for the task stack
+    paired_device_t *devices = malloc(MAX_PAIRED_DEVICES * sizeof(paired_device_t));
+    if (!devices) {
+        send_jsonrpc_error(req, JSONRPC_INTERNAL_ERROR, "Out of memory");
+        return;
+    }
     size_t count = 0;
 
-    // Using arbitrary max limit that should cover expected MAX_PAIRED_DEVICES
-    if (cmd_get_paired_devices(devices, SLOT_ID_MAX, &count) != ESP_OK) {
-        send_jsonrpc_error(JSONRPC_INTERNAL_ERROR, "Failed to get devices");
+    if (cmd_get_paired_devices(devices, MAX_PAIRED_DEVICES, &count) != ESP_OK) {
+        free(devices);
+        send_jsonrpc_error(req, JSONRPC_INTERNAL_ERROR, "Failed to get devices");
         return;
     }
 
-    cJSON *array = cJSON_CreateArray();
+    json_writer_t *w = begin_result(req);
+    json_write_array_begin(w);
     for (size_t i = 0; i < count; i++) {
-        cJSON *obj = cJSON_CreateObject();
-        cJSON_AddStringToObject(obj, "name", devices[i].device_name);
-
         char mac_str[18];
-        snprintf(mac_str, sizeof(mac_str), "%02x:%02x:%02x:%02x:%02x:%02x", devices[i].mac_address[0],
-                 devices[i].mac_address[1], devices[i].mac_address[2], devices[i].mac_address[3],
-                 devices[i].mac_address[4], devices[i].mac_address[5]);
-        cJSON_AddStringToObject(obj, "mac", mac_str);
+        format_mac(mac_str, devices[i].mac_address);
 
-        cJSON_AddItemToArray(array, obj);
+        json_write_object_begin(w);
+        json_write_kv_string(w, "name", devices[i].device_name);
+        json_write_kv_string(w, "mac", mac_str);
+        json_write_object_end(w);
     }
-    send_jsonrpc_result(array);
+    json_write_array_end(w);
+    free(devices);
+    end_response(req);
 }
 
-static void handle_pair_device(cJSON *params)
+static void handle_pair_device(rpc_request_t *req, const rpc_params_t *params)
 {
-    cJSON *name      = cJSON_GetObjectItem(params, "name");
-    const cJSON *mac = cJSON_GetObjectItem(params, "mac");
-    const cJSON *key = cJSON_GetObjectItem(params, "aes_key");
-
-    if (!name || !mac || !key) {
-        send_jsonrpc_error(JSONRPC_INVALID_PARAMS, "Missing params");
-        return;
-    }
+    const rpc_paired_pair_params_t *p = &params->paired_pair;
 
     uint8_t mac_bytes[6];
-    if (sscanf(mac->valuestring, "%02hhx:%02hhx:%02hhx:%02hhx:%02hhx:%02hhx", &mac_bytes[0], &mac_bytes[1],
-               &mac_bytes[2], &mac_bytes[3], &mac_bytes[4], &mac_bytes[5]) != 6) {
-        send_jsonrpc_error(JSONRPC_INVALID_PARAMS, "Invalid MAC");
+    if (!parse_mac(p->mac, mac_bytes)) {
+        send_jsonrpc_error(req, JSONRPC_INVALID_PARAMS, "Invalid MAC");
         return;
     }
 
     uint8_t key_bytes[32];
-    const char *k = key->valuestring;
-    if (strlen(k) != 64) {
-        send_jsonrpc_error(JSONRPC_INVALID_PARAMS, "Invalid Key Length");
+    if (strlen(p->aes_key) != 64) {
+        send_jsonrpc_error(req, JSONRPC_INVALID_PARAMS, "Invalid Key Length");
         return;
     }
     for (int i = 0; i < 32; i++) {
-        if (sscanf(k + i * 2, "%02hhx", &key_bytes[i]) != 1) {
-            send_jsonrpc_error(JSONRPC_INVALID_PARAMS, "Invalid Key Hex");
+        if (sscanf(p->aes_key + i * 2, "%02hhx", &key_bytes[i]) != 1) {
+            send_jsonrpc_error(req, JSONRPC_INVALID_PARAMS, "Invalid Key Hex");
             return;
         }
     }
 
-    if (cmd_pair_device(name->valuestring, mac_bytes, key_bytes) != ESP_OK) {
-        send_jsonrpc_error(JSONRPC_INTERNAL_ERROR, "Pairing failed");
+    if (cmd_pair_device(p->name, mac_bytes, key_bytes) != ESP_OK) {
+        send_jsonrpc_error(req, JSONRPC_INTERNAL_ERROR, "Pairing failed");
         return;
     }
 
-    send_jsonrpc_result(cJSON_CreateString("Paired"));
+    send_jsonrpc_result_string(req, "Paired");
 }
 
-static void handle_unpair_device(cJSON *params)
+static void handle_unpair_device(rpc_request_t *req, const rpc_params_t *params)
 {
-    const cJSON *mac = cJSON_GetObjectItem(params, "mac");
-    if (!mac) {
-        send_jsonrpc_error(JSONRPC_INVALID_PARAMS, "Missing MAC");
-        return;
-    }
-
     uint8_t mac_bytes[6];
-    if (sscanf(mac->valuestring, "%02hhx:%02hhx:%02hhx:%02hhx:%02hhx:%02hhx", &mac_bytes[0], &mac_bytes[1],
-               &mac_bytes[2], &mac_bytes[3], &mac_bytes[4], &mac_bytes[5]) != 6) {
-        send_jsonrpc_error(JSONRPC_INVALID_PARAMS, "Invalid MAC");
+    if (!parse_mac(params->paired_unpair.mac, mac_bytes)) {
+        send_jsonrpc_error(req, JSONRPC_INVALID_PARAMS, "Invalid MAC");
         return;
     }
 
     if (cmd_unpair_device(mac_bytes) != ESP_OK) {
-        send_jsonrpc_error(JSONRPC_INTERNAL_ERROR, "Unpair failed");
+        send_jsonrpc_error(req, JSONRPC_INTERNAL_ERROR, "Unpair failed");
         return;
     }
-    send_jsonrpc_result(cJSON_CreateString("Unpaired"));
+    send_jsonrpc_result_string(req, "Unpaired");
 }
 
-static void handle_device_reset(void)
+static void handle_device_reset(rpc_request_t *req, const rpc_params_t *params)
 {
-    send_jsonrpc_result(cJSON_CreateString("Reset initiated"));
+    (void)params;
+    send_jsonrpc_result_string(req, "Reset initiated");
     // Allow time to send response
     vTaskDelay(pdMS_TO_TICKS(RESET_DELAY_MS));
     cmd_factory_reset();
 }
 
-static void handle_firmware_start(cJSON *params)
+static void handle_firmware_start(rpc_request_t *req, const rpc_params_t *params)
 {
-    cJSON *size = cJSON_GetObjectItem(params, "size");
-    cJSON *sha  = cJSON_GetObjectItem(params, "sha256");
-    cJSON *sig  = cJSON_GetObjectItem(params, "signature");
+    const rpc_firmware_upgrade_params_t *p = &params->firmware_upgrade;
 
-    if (!size || !sha || !sig) {
-        send_jsonrpc_error(JSONRPC_INVALID_PARAMS, "Missing params");
+    esp_err_t ret = cmd_firmware_upgrade_start((size_t)p->size, p->sha256, p->signature);
+    if (ret != ESP_OK) {
+        send_jsonrpc_error(req, JSONRPC_INTERNAL_ERROR, "Failed to start OTA");
         return;
     }
 
-    esp_err_t ret = cmd_firmware_upgrade_start((size_t)size->valueint, sha->valuestring, sig->valuestring);
+    json_writer_t *w = begin_result(req);
+    json_write_object_begin(w);
+    json_write_kv_string(w, "status", "ready");
+    json_write_kv_int(w, "size", p->size);
+    json_write_object_end(w);
+    end_response(req);
+}
+
+static void handle_ota_resume(rpc_request_t *req, const rpc_params_t *params)
+{
+    const rpc_firmware_upgrade_params_t *p = &params->firmware_upgrade;
+
+    size_t offset = 0;
+    esp_err_t ret = cmd_firmware_resume((size_t)p->size, p->sha256, p->signature, &offset);
     if (ret != ESP_OK) {
-        send_jsonrpc_error(JSONRPC_INTERNAL_ERROR, "Failed to start OTA");
-        return;
-    }
-
-    cJSON *res = cJSON_CreateObject();
-    cJSON_AddStringToObject(res, "status", "ready");
-    cJSON_AddNumberToObject(res, "size", size->valueint);
-    send_jsonrpc_result(res);
-}
-
-// Dispatch table
-typedef void (*method_handler_no_params_t)(void);
-typedef void (*method_handler_with_params_t)(cJSON *params);
-
-typedef struct {
-    const char *method;
-    bool has_params;
-    union {
-        method_handler_no_params_t no_params;
-        method_handler_with_params_t with_params;
-    } handler;
-} jsonrpc_method_t;
-
-static const jsonrpc_method_t method_table[] = {
-    {"ping", false, {.no_params = handle_ping}},
-    {"device:info", false, {.no_params = handle_get_device_info}},
-    {"general:get", false, {.no_params = handle_get_general}},
-    {"general:set", true, {.with_params = handle_set_general}},
-    {"power:get", false, {.no_params = handle_get_power_management}},
-    {"power:set", true, {.with_params = handle_set_power_management}},
-    {"lora:get", false, {.no_params = handle_get_lora_config}},
-    {"lora:set", true, {.with_params = handle_set_lora_config}},
-    {"lora:key:get", false, {.no_params = handle_get_lora_key}},
-    {"lora:key:set", true, {.with_params = handle_set_lora_key}},
-    {"paired:list", false, {.no_params = handle_get_paired_devices}},
-    {"paired:pair", true, {.with_params = handle_pair_device}},
-    {"paired:unpair", true, {.with_params = handle_unpair_device}},
-    {"device:reset", false, {.no_params = handle_device_reset}},
-    {"firmware:upgrade", true, {.with_params = handle_firmware_start}},
+        send_jsonrpc_error(req, JSONRPC_INTERNAL_ERROR, "Failed to start OTA");
+        return;
+    }
+
+    json_writer_t *w = begin_result(req);
+    json_write_object_begin(w);
+    json_write_kv_string(w, "status", "ready");
+    json_write_kv_int(w, "size", p->size);
+    json_write_kv_int(w, "offset", (int64_t)offset);
+    json_write_object_end(w);
+    end_response(req);
+}
+
+static void write_method(json_writer_t *w, const rpc_method_info_t *info)
+{
+    static const char *const param_types[] = {
+        [RPC_PARAM_STRING] = "string",
+        [RPC_PARAM_INT]    = "int",
+        [RPC_PARAM_BOOL]   = "bool",
+    };
+    static const struct {
+        uint8_t link;
+        const char *name;
+    } links[] = {
+        {RPC_LINK_USB_CDC, "usb"},
+        {RPC_LINK_BLE, "ble"},
+        {RPC_LINK_UART, "uart"},
+        {RPC_LINK_HTTP, "http"},
+    };
+
+    json_write_object_begin(w);
+    json_write_kv_string(w, "name", info->name);
+    json_write_kv_bool(w, "auth", info->flags & RPC_FLAG_AUTH);
+    json_write_kv_bool(w, "long_running", info->flags & RPC_FLAG_LONG_RUNNING);
+
+    json_write_key(w, "links");
+    json_write_array_begin(w);
+    for (size_t i = 0; i < sizeof(links) / sizeof(links[0]); i++) {
+        if (info->links == RPC_LINK_ANY || (info->links & links[i].link)) {
+            json_write_string(w, links[i].name);
+        }
+    }
+    json_write_array_end(w);
+
+    json_write_key(w, "params");
+    json_write_array_begin(w);
+    for (int i = 0; i < info->param_count; i++) {
+        const rpc_param_t *param = &info->params[i];
+        json_write_object_begin(w);
+        json_write_kv_string(w, "name", param->name);
+        json_write_kv_string(w, "type", param_types[param->type]);
+        json_write_kv_bool(w, "required", param->required);
+        if (param->type == RPC_PARAM_INT) {
+            json_write_kv_int(w, "min", param->min);
+            json_write_kv_int(w, "max", param->max);
+        } else if (param->type == RPC_PARAM_STRING) {
+            json_write_kv_int(w, "max_length", param->size - 1);
+        }
+        json_write_object_end(w);
+    }
+    json_write_array_end(w);
+    json_write_object_end(w);
+}
+
+static void handle_list_methods(rpc_request_t *req, const rpc_params_t *params)
+{
+    (void)params;
+    json_writer_t *w = begin_result(req);
+    json_write_array_begin(w);
+    size_t count = rpc_method_count();
+    for (size_t m = 0; m < count; m++) {
+        write_method(w, rpc_method_info((rpc_method_t)m));
+    }
+    json_write_array_end(w);
+    end_response(req);
+}
+
+// Dispatch table for the built-in methods: names and param schemas live in rpc_schema.c
+static const commands_handler_t method_table[RPC_METHOD_COUNT] = {
+    [RPC_METHOD_PING]              = handle_ping,
+    [RPC_METHOD_DEVICE_INFO]       = handle_get_device_info,
+    [RPC_METHOD_GENERAL_GET]       = handle_get_general,
+    [RPC_METHOD_GENERAL_SET]       = handle_set_general,
+    [RPC_METHOD_POWER_GET]         = handle_get_power_management,
+    [RPC_METHOD_POWER_SET]         = handle_set_power_management,
+    [RPC_METHOD_POWER_STATS]       = handle_get_power_stats,
+    [RPC_METHOD_SYSTEM_BOOT_TRACE] = handle_get_boot_trace,
+    [RPC_METHOD_LORA_GET]          = handle_get_lora_config,
+    [RPC_METHOD_LORA_SET]          = handle_set_lora_config,
+    [RPC_METHOD_LORA_KEY_GET]      = handle_get_lora_key,
+    [RPC_METHOD_LORA_KEY_SET]      = handle_set_lora_key,
+    [RPC_METHOD_PAIRED_LIST]       = handle_get_paired_devices,
+    [RPC_METHOD_PAIRED_PAIR]       = handle_pair_device,
+    [RPC_METHOD_PAIRED_UNPAIR]     = handle_unpair_device,
+    [RPC_METHOD_DEVICE_RESET]      = handle_device_reset,
+    [RPC_METHOD_FIRMWARE_UPGRADE]  = handle_firmware_start,
+    [RPC_METHOD_OTA_RESUME]        = handle_ota_resume,
+    [RPC_METHOD_RPC_LIST_METHODS]  = handle_list_methods,
 };
 
-void commands_execute(const char *command_line, response_fn_t send_response)
+static commands_handler_t find_handler(rpc_method_t method)
+{
+    if (method < RPC_METHOD_COUNT) {
+        return method_table[method];
+    }
+    // Registered methods are commands_method_t, whose first member is the info
+    return ((const commands_method_t *)rpc_method_info(method))->handler;
+}
+
+// Metadata checks before the params are even looked at
+static int check_access(const rpc_method_info_t *info, const command_route_t *route)
 {
-    if (!send_response)
+    if (info->links != RPC_LINK_ANY && !(info->links & route->link)) {
+        return RPC_ERROR_LINK_NOT_ALLOWED;
+    }
+    if ((info->flags & RPC_FLAG_AUTH) && route->authenticated && !route->authenticated(route->ctx)) {
+        return RPC_ERROR_UNAUTHORIZED;
+    }
+    return 0;
+}
+
+static void execute_request(const char *request, size_t len, bool binary, const command_route_t *route)
+{
+    if (!route || !route->write)
         return;
-    s_send_response = send_response;
-    s_request_id    = NULL;
+
+    char chunk[COMMAND_RESPONSE_CHUNK];
+    rpc_request_t req = {.route = route, .binary = binary};
+    if (binary) {
+        rpc_frame_encoder_begin(&req.frame, route_write, (void *)route);
+        json_writer_init_cbor(&req.writer, chunk, sizeof(chunk), rpc_frame_encoder_write, &req.frame);
+    } else {
+        json_writer_init(&req.writer, chunk, sizeof(chunk), route_write, (void *)route);
+    }
 
     power_mgmt_update_activity();
 
-    if (strlen(command_line) > MAX_COMMAND_LENGTH) {
-        send_jsonrpc_error(JSONRPC_INVALID_REQUEST, "Request too large");
+    if (len > MAX_COMMAND_LENGTH) {
+        send_jsonrpc_error(&req, JSONRPC_INVALID_REQUEST, "Request too large");
+        return;
+    }
+
+    rpc_envelope_t env;
+    int err    = binary ? rpc_parse_envelope_cbor(request, len, &env) : rpc_parse_envelope(request, len, &env);
+    req.id     = env.id;
+    req.id_len = env.id_len;
+    if (err == JSONRPC_PARSE_ERROR) {
+        send_jsonrpc_error(&req, err, binary ? "Invalid CBOR" : "Invalid JSON");
+        return;
+    } else if (err == JSONRPC_INVALID_REQUEST) {
+        send_jsonrpc_error(&req, err, "Invalid method");
+        return;
+    } else if (err == JSONRPC_METHOD_NOT_FOUND) {
+        send_jsonrpc_error(&req, err, "Method not found");
         return;
     }
 
-    cJSON *request = cJSON_Parse(command_line);
-    if (!request) {
-        send_jsonrpc_error(JSONRPC_PARSE_ERROR, "Invalid JSON");
+    const rpc_method_info_t *info = rpc_method_info(env.method);
+    err                           = check_access(info, route);
+    if (err != 0) {
+        send_jsonrpc_error(&req, err,
+                           err == RPC_ERROR_UNAUTHORIZED ? "Authentication required" : "Not available on this link");
         return;
     }
 
-    cJSON *method = cJSON_GetObjectItem(request, "method");
-    if (!method || !cJSON_IsString(method)) {
-        send_jsonrpc_error(JSONRPC_INVALID_REQUEST, "Invalid method");
-        cJSON_Delete(request);
+    rpc_params_t params;
+    int bad_param;
+    if (rpc_bind_params(&env, &params, &bad_param) != 0) {
+        send_params_error(&req, env.method, bad_param);
         return;
     }
+    find_handler(env.method)(&req, &params);
+
+    if (info->flags & RPC_FLAG_LONG_RUNNING) {
+        // Inactivity timers count from the end of the operation, not from its start
+        power_mgmt_update_activity();
+    }
+}
 
-    s_request_id  = cJSON_GetObjectItem(request, "id");
-    cJSON *params = cJSON_GetObjectItem(request, "params");
+void commands_execute(const char *command_line, const command_route_t *route)
+{
+    execute_request(command_line, strlen(command_line), false, route);
+}
 
-    bool found = false;
-    for (size_t i = 0; i < sizeof(method_table) / sizeof(method_table[0]); i++) {
-        if (strcmp(method->valuestring, method_table[i].method) == 0) {
-            if (method_table[i].has_params) {
-                if (!params) {
-                    send_jsonrpc_error(JSONRPC_INVALID_PARAMS, "Missing params");
-                } else {
-                    method_table[i].handler.with_params(params);
-                }
+void commands_execute_frame(const char *payload, size_t len, const command_route_t *route)
+{
+    execute_request(payload, len, true, route);
+}
+
+static void command_worker_task(void *arg)
+{
+    (void)arg;
+    while (1) {
+        xSemaphoreTake(s_pool_work, portMAX_DELAY);
+
+        // Keep going while work is runnable: a request queued behind a busy transport has
+        // already consumed its wakeup and is picked up here once that transport finishes
+        command_job_t job;
+        while (1) {
+            xSemaphoreTake(s_pool_lock, portMAX_DELAY);
+            bool found = command_sched_next(&s_sched, &job);
+            xSemaphoreGive(s_pool_lock);
+            if (!found) {
+                break;
+            }
+
+            if (job.binary) {
+                commands_execute_frame(job.line, job.frame_len, &s_routes[job.transport]);
             } else {
-                method_table[i].handler.no_params();
+                commands_execute(job.line, &s_routes[job.transport]);
+            }
+            free(job.line);
+
+            xSemaphoreTake(s_pool_lock, portMAX_DELAY);
+            command_sched_done(&s_sched, job.transport);
+            xSemaphoreGive(s_pool_lock);
+        }
+    }
+}
+
+esp_err_t commands_init(void)
+{
+    if (s_pool_lock) {
+        return ESP_OK;
+    }
+
+    command_sched_init(&s_sched);
+    s_pool_work = xSemaphoreCreateCounting(COMMAND_TRANSPORT_COUNT * COMMAND_SCHED_DEPTH, 0);
+    if (!s_pool_work) {
+        return ESP_ERR_NO_MEM;
+    }
+    SemaphoreHandle_t lock = xSemaphoreCreateMutex();
+    if (!lock) {
+        vSemaphoreDelete(s_pool_work);
+        s_pool_work = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    for (int i = 0; i < CONFIG_LORACUE_COMMAND_WORKERS; i++) {
+        char name[configMAX_TASK_NAME_LEN];
+        snprintf(name, sizeof(name), "rpc_%d", i);
+        if (xTaskCreate(command_worker_task, name, COMMAND_WORKER_STACK_SIZE, NULL, TASK_PRIORITY_NORMAL, NULL) !=
+            pdPASS) {
+            // Workers already running keep serving; fewer workers only means less parallelism
+            ESP_LOGE(TAG, "Failed to create command worker %d", i);
+            if (i == 0) {
+                vSemaphoreDelete(lock);
+                vSemaphoreDelete(s_pool_work);
+                s_pool_work = NULL;
+                return ESP_ERR_NO_MEM;
             }
-            found = true;
             break;
         }
     }
 
-    if (!found) {
-        send_jsonrpc_error(JSONRPC_METHOD_NOT_FOUND, "Method not found");
+    s_pool_lock = lock;
+    ESP_LOGI(TAG, "Command pool started (%d workers, %d queued requests per transport)",
+             CONFIG_LORACUE_COMMAND_WORKERS, COMMAND_SCHED_DEPTH);
+    return ESP_OK;
+}
+
+esp_err_t commands_register_transport(command_transport_t transport, const command_route_t *route)
+{
+    if ((unsigned)transport >= COMMAND_TRANSPORT_COUNT || !route || !route->write) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_pool_lock) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(s_pool_lock, portMAX_DELAY);
+    s_routes[transport] = *route;
+    xSemaphoreGive(s_pool_lock);
+    return ESP_OK;
+}
+
+esp_err_t commands_register_method(const commands_method_t *method)
+{
+    if (!method || !method->handler) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_pool_lock) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    rpc_method_t id;
+    xSemaphoreTake(s_pool_lock, portMAX_DELAY);
+    esp_err_t ret = rpc_register_method(&method->info, &id);
+    xSemaphoreGive(s_pool_lock);
+
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register method %s: %s", method->info.name ? method->info.name : "(null)",
+                 esp_err_to_name(ret));
+        return ret;
+    }
+    ESP_LOGI(TAG, "Registered method %s (id %d)", method->info.name, id);
+    return ESP_OK;
+}
+
+// Queues a request the caller's buffer held; the copy is owned by the scheduler from here
+static esp_err_t submit_copy(command_transport_t transport, const char *request, size_t len, bool binary)
+{
+    if ((unsigned)transport >= COMMAND_TRANSPORT_COUNT || !request) {
+        return ESP_ERR_INVALID_ARG;
     }
+    if (!s_pool_lock || !s_routes[transport].write) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    char *line = malloc(len + 1);
+    if (!line) {
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(line, request, len);
+    line[len] = '\0';
+
+    xSemaphoreTake(s_pool_lock, portMAX_DELAY);
+    esp_err_t ret = binary ? command_sched_push_frame(&s_sched, transport, line, len)
+                           : command_sched_push(&s_sched, transport, line);
+    xSemaphoreGive(s_pool_lock);
+
+    if (ret != ESP_OK) {
+        free(line);
+        return ret;
+    }
+    xSemaphoreGive(s_pool_work);
+    return ESP_OK;
+}
+
+esp_err_t commands_submit(command_transport_t transport, const char *command_line)
+{
+    return submit_copy(transport, command_line, command_line ? strlen(command_line) : 0, false);
+}
 
-    cJSON_Delete(request);
+esp_err_t commands_submit_frame(command_transport_t transport, const char *payload, size_t len)
+{
+    return submit_copy(transport, payload, len, true);
 }
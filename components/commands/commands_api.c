@@ -198,6 +198,19 @@ esp_err_t cmd_firmware_upgrade_start(size_t size, const char *sha256, const char
     return ota_engine_start(size);
 }
 
+esp_err_t cmd_firmware_resume(size_t size, const char *sha256, const char *signature, size_t *offset)
+{
+    esp_err_t ret = ota_engine_set_expected_sha256(sha256);
+    if (ret != ESP_OK)
+        return ret;
+
+    ret = ota_engine_verify_signature(signature);
+    if (ret != ESP_OK)
+        return ret;
+
+    return ota_engine_resume(size, offset);
+}
+
 esp_err_t cmd_factory_reset(void)
 {
     ESP_LOGW(TAG, "Factory reset initiated - erasing all NVS data");
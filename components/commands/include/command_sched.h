@@ -0,0 +1,92 @@
+/**
+ * @file command_sched.h
+ * @brief Per-transport request queues for the JSON-RPC worker pool
+ *
+ * CONTEXT: CDC, BLE and UART each ran commands_execute() on their own task, sharing the
+ *          response callback and request id through file statics
+ * PURPOSE: Queue requests per transport and hand workers the next runnable one: transports
+ *          execute in parallel, requests of one transport in arrival order (a client's
+ *          "set" is always applied before its following "get")
+ * USAGE: Pure C; commands.c serializes calls with its pool lock and runs the workers,
+ *        tests/host drives it from threads
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define COMMAND_SCHED_DEPTH 4 ///< Queued requests per transport, beyond the one executing
+
+/**
+ * @brief Transports that submit JSON-RPC requests
+ *
+ * HTTP is not one: httpd handlers must answer inside the handler and call
+ * commands_execute() with a per-request route instead.
+ */
+typedef enum {
+    COMMAND_TRANSPORT_USB_CDC,
+    COMMAND_TRANSPORT_BLE,
+    COMMAND_TRANSPORT_UART,
+    COMMAND_TRANSPORT_COUNT,
+} command_transport_t;
+
+/**
+ * @brief One queued request; line is owned by the scheduler until handed to a worker
+ */
+typedef struct {
+    command_transport_t transport;
+    char *line;
+    bool binary;      ///< line is a decoded binary frame payload, not a NUL-terminated JSON line
+    size_t frame_len; ///< Binary only
+} command_job_t;
+
+typedef struct {
+    command_job_t jobs[COMMAND_TRANSPORT_COUNT][COMMAND_SCHED_DEPTH];
+    uint8_t head[COMMAND_TRANSPORT_COUNT];
+    uint8_t count[COMMAND_TRANSPORT_COUNT];
+    uint32_t busy; ///< Bit per transport with a request executing
+    uint8_t next;  ///< Round-robin start so one chatty transport cannot starve the others
+} command_sched_t;
+
+void command_sched_init(command_sched_t *sched);
+
+/**
+ * @brief Queue a request
+ *
+ * @return ESP_OK (line now owned by the scheduler), ESP_ERR_NO_MEM if the transport's queue
+ *         is full, ESP_ERR_INVALID_ARG for an unknown transport or NULL line
+ */
+esp_err_t command_sched_push(command_sched_t *sched, command_transport_t transport, char *line);
+
+/**
+ * @brief Queue a binary frame payload; same ownership and errors as command_sched_push()
+ */
+esp_err_t command_sched_push_frame(command_sched_t *sched, command_transport_t transport, char *payload, size_t len);
+
+/**
+ * @brief Take the next request of an idle transport and mark that transport busy
+ *
+ * @return false if every transport is idle-and-empty or already executing
+ */
+bool command_sched_next(command_sched_t *sched, command_job_t *job);
+
+/**
+ * @brief Mark the transport's current request finished
+ */
+void command_sched_done(command_sched_t *sched, command_transport_t transport);
+
+/**
+ * @brief Requests queued for a transport, not counting the executing one
+ */
+uint8_t command_sched_pending(const command_sched_t *sched, command_transport_t transport);
+
+#ifdef __cplusplus
+}
+#endif
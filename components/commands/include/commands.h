@@ -1,21 +1,140 @@
 #ifndef COMMANDS_H
 #define COMMANDS_H
 
+#include "command_sched.h"
+#include "esp_err.h"
+#include "json_stream.h"
+#include "rpc_schema.h"
+#include <stdbool.h>
 #include <stddef.h>
 
 /**
- * @brief Response callback function type
+ * @brief Receives a piece of a response
  *
- * @param response The response string to send back to the client
+ * Responses are streamed: a response arrives as one or more calls of at most
+ * COMMAND_RESPONSE_CHUNK bytes, written straight into the transport (CDC FIFO, BLE
+ * notification, httpd chunk), followed by one end call.
+ *
+ * @param data Response bytes, not NUL-terminated
+ * @param len Number of bytes
+ * @param ctx Context registered with the route (connection, HTTP request, ...)
+ */
+typedef void (*response_write_fn_t)(const char *data, size_t len, void *ctx);
+
+/**
+ * @brief Marks the end of one response (line terminator, flush, last chunk)
+ *
+ * @param binary The response was a binary frame, which is self-delimiting: flush, but write
+ *               no line terminator
+ */
+typedef void (*response_end_fn_t)(bool binary, void *ctx);
+
+#define COMMAND_RESPONSE_CHUNK 244 ///< One notification at the largest BLE ATT MTU (247 - 3)
+
+/**
+ * @brief Where the responses of one request go
+ */
+typedef struct {
+    response_write_fn_t write;
+    response_end_fn_t end; ///< Optional
+    void *ctx;
+    uint8_t link; ///< RPC_LINK_* of the transport, checked against the method's links
+    /**
+     * Optional: whether the peer may call RPC_FLAG_AUTH methods right now (BLE: bonded).
+     * NULL when the link itself is trusted (USB, UART, the WPA2 config AP).
+     */
+    bool (*authenticated)(void *ctx);
+} command_route_t;
+
+/**
+ * @brief One request being answered; handlers write the response through it
+ */
+typedef struct rpc_request rpc_request_t;
+
+/**
+ * @brief Method handler: must send exactly one response (result or error)
+ *
+ * @param params Bound and validated against the method's schema
+ */
+typedef void (*commands_handler_t)(rpc_request_t *req, const rpc_params_t *params);
+
+/**
+ * @brief A method another component serves; see commands_register_method()
+ */
+typedef struct {
+    rpc_method_info_t info; ///< Must stay first: the registry hands back &info
+    commands_handler_t handler;
+} commands_method_t;
+
+/**
+ * @brief Start the JSON-RPC worker pool
+ *
+ * Must run before any transport submits; idempotent.
+ */
+esp_err_t commands_init(void);
+
+/**
+ * @brief Set the response route for requests submitted by a transport
+ *
+ * The route is copied.
+ */
+esp_err_t commands_register_transport(command_transport_t transport, const command_route_t *route);
+
+/**
+ * @brief Queue a command for the worker pool and return immediately
+ *
+ * The line is copied. Requests of one transport execute in order, different transports in
+ * parallel; responses go to the transport's registered route.
+ *
+ * @return ESP_OK, ESP_ERR_NO_MEM if the transport's queue is full, ESP_ERR_INVALID_STATE
+ *         before commands_init()
+ */
+esp_err_t commands_submit(command_transport_t transport, const char *command_line);
+
+/**
+ * @brief Queue a binary request (a frame payload from rpc_rx_feed()); answered with a frame
+ *
+ * Same copying, ordering and return values as commands_submit().
+ */
+esp_err_t commands_submit_frame(command_transport_t transport, const char *payload, size_t len);
+
+/**
+ * @brief Serve a method from another component (telemetry, diagnostics, ...)
+ *
+ * method is kept by pointer, so it is normally a static const. Name lookup stays O(1);
+ * rpc:listMethods lists the method with its params and metadata.
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_STATE before commands_init() or for a name in use,
+ *         otherwise see rpc_register_method()
  */
-typedef void (*response_fn_t)(const char *response);
+esp_err_t commands_register_method(const commands_method_t *method);
 
 /**
- * @brief Execute a command string
+ * @brief Start a successful response; write the result value, then commands_end_response()
+ */
+json_writer_t *commands_begin_result(rpc_request_t *req);
+
+void commands_end_response(rpc_request_t *req);
+
+/**
+ * @brief Send an error response (code: JSONRPC_* or RPC_ERROR_*)
+ */
+void commands_send_error(rpc_request_t *req, int code, const char *message);
+
+/**
+ * @brief Execute a command string in the calling task
+ *
+ * Reentrant: request state lives in a per-call context, so transports that must answer
+ * synchronously (HTTP) can call this concurrently with the worker pool.
  *
  * @param command_line The command string to execute
- * @param send_response Callback function to send responses
+ * @param route Where to send responses
+ */
+void commands_execute(const char *command_line, const command_route_t *route);
+
+/**
+ * @brief Execute a binary request (CBOR, see rpc_frame.h) in the calling task
  */
-void commands_execute(const char *command_line, response_fn_t send_response);
+void commands_execute_frame(const char *payload, size_t len, const command_route_t *route);
 
 #endif // COMMANDS_H
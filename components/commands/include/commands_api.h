@@ -31,6 +31,11 @@ esp_err_t cmd_get_paired_devices(paired_device_t *devices, size_t max_count, siz
 
 // Firmware
 esp_err_t cmd_firmware_upgrade_start(size_t size, const char *sha256, const char *signature);
+/**
+ * @brief As cmd_firmware_upgrade_start(), continuing an interrupted upload of the same image
+ * @param[out] offset Bytes the device already has; 0 when it starts over
+ */
+esp_err_t cmd_firmware_resume(size_t size, const char *sha256, const char *signature, size_t *offset);
 
 // System
 esp_err_t cmd_factory_reset(void);
@@ -0,0 +1,183 @@
+/**
+ * @file json_stream.h
+ * @brief Allocation-free JSON pull tokenizer and streaming writer
+ *
+ * CONTEXT: Every JSON-RPC request was parsed into a cJSON tree and every response built as
+ *          one and printed into a heap string before the transport saw a byte
+ * PURPOSE: Tokenize requests in place (tokens point into the request line) and write
+ *          responses through a small caller buffer that is handed to the transport each
+ *          time it fills, so neither direction touches the heap
+ * USAGE: Pure C; rpc_schema.c binds request params with the reader, commands.c writes
+ *        responses into the route's sink, tests/host covers both. The _cbor init variants
+ *        read and write the same data model as CBOR (RFC 8949) for the binary RPC frames
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define JSON_MAX_DEPTH 16 ///< Nesting limit for both reader and writer
+
+typedef enum {
+    JSON_TOK_ERROR,
+    JSON_TOK_END, ///< Input exhausted after one complete top-level value
+    JSON_TOK_OBJECT_BEGIN,
+    JSON_TOK_OBJECT_END,
+    JSON_TOK_ARRAY_BEGIN,
+    JSON_TOK_ARRAY_END,
+    JSON_TOK_KEY,
+    JSON_TOK_STRING,
+    JSON_TOK_NUMBER,
+    JSON_TOK_TRUE,
+    JSON_TOK_FALSE,
+    JSON_TOK_NULL,
+} json_tok_type_t;
+
+/**
+ * @brief One token; start/len is its raw text in the input (strings and keys with quotes)
+ *
+ * For CBOR input start/len is the whole data item, head included (empty for the end of a
+ * definite-length container).
+ */
+typedef struct {
+    json_tok_type_t type;
+    const char *start;
+    size_t len;
+    uint8_t depth; ///< Containers open around the token (a container's own begin/end excluded)
+    bool cbor;
+} json_token_t;
+
+typedef struct {
+    const char *buf;
+    size_t len;
+    size_t pos;
+    uint32_t objects; ///< Bit per open container: 1 = object, 0 = array
+    uint8_t depth;
+    uint8_t state;
+    bool cbor;
+    uint32_t keys;                      ///< CBOR: bit per open map whose next item is a key
+    uint32_t remaining[JSON_MAX_DEPTH]; ///< CBOR: items left per open container, UINT32_MAX if indefinite
+} json_reader_t;
+
+void json_reader_init(json_reader_t *reader, const char *buf, size_t len);
+
+/**
+ * @brief Tokenize CBOR instead of JSON
+ *
+ * Accepts the JSON data model: unsigned/negative integers, floats, definite-length text
+ * strings, arrays and maps (definite or indefinite length) with text keys, false, true,
+ * null (undefined reads as null). Byte strings, tags and other simple values are errors.
+ */
+void json_reader_init_cbor(json_reader_t *reader, const char *buf, size_t len);
+
+/**
+ * @brief Validate and return the next token
+ *
+ * Errors are sticky: once JSON_TOK_ERROR is returned every further call returns it too.
+ */
+json_tok_type_t json_next(json_reader_t *reader, json_token_t *tok);
+
+/**
+ * @brief Consume the rest of the value tok starts (a no-op for scalars)
+ *
+ * @return false on malformed input
+ */
+bool json_skip(json_reader_t *reader, const json_token_t *tok);
+
+/**
+ * @brief Decode a string or key token into out, NUL-terminated
+ *
+ * @return false if it does not fit or contains an escaped NUL
+ */
+bool json_token_copy(const json_token_t *tok, char *out, size_t size, size_t *out_len);
+
+/**
+ * @brief Compare a string or key token's decoded text with a C string
+ */
+bool json_token_equals(const json_token_t *tok, const char *str);
+
+/**
+ * @brief Read a number token without fraction or exponent
+ *
+ * @return false for non-integers or values outside int64_t
+ */
+bool json_token_int(const json_token_t *tok, int64_t *out);
+
+/**
+ * @brief Receives the writer's buffer each time it fills and on json_writer_flush()
+ */
+typedef void (*json_sink_fn_t)(const char *data, size_t len, void *ctx);
+
+typedef struct {
+    char *buf;
+    size_t size;
+    size_t used;
+    size_t total; ///< Bytes handed to the sink so far
+    json_sink_fn_t sink;
+    void *ctx;
+    uint32_t has_items; ///< Bit per open container: next item needs a comma
+    uint8_t depth;
+    bool after_key;
+    bool cbor;
+} json_writer_t;
+
+void json_writer_init(json_writer_t *writer, char *buf, size_t size, json_sink_fn_t sink, void *ctx);
+
+/**
+ * @brief Write CBOR instead of JSON
+ *
+ * Objects and arrays are indefinite-length so nothing has to be counted up front; numbers
+ * use the shortest integer head, non-integral doubles float32 when exact, else float64.
+ */
+void json_writer_init_cbor(json_writer_t *writer, char *buf, size_t size, json_sink_fn_t sink, void *ctx);
+
+/**
+ * @brief Hand buffered output to the sink
+ */
+void json_writer_flush(json_writer_t *writer);
+
+void json_write_object_begin(json_writer_t *writer);
+void json_write_object_end(json_writer_t *writer);
+void json_write_array_begin(json_writer_t *writer);
+void json_write_array_end(json_writer_t *writer);
+void json_write_key(json_writer_t *writer, const char *key);
+
+/**
+ * @brief Write a string value, escaped; NULL writes null
+ */
+void json_write_string(json_writer_t *writer, const char *str);
+void json_write_int(json_writer_t *writer, int64_t value);
+void json_write_uint(json_writer_t *writer, uint64_t value);
+
+/**
+ * @brief Write a number with up to six decimals, without printf's float path (newlib's
+ *        allocates); NaN and infinity are written as null like cJSON does
+ */
+void json_write_double(json_writer_t *writer, double value);
+void json_write_bool(json_writer_t *writer, bool value);
+void json_write_null(json_writer_t *writer);
+
+/**
+ * @brief Write a pre-encoded value (a request id echoed back verbatim), in the writer's encoding
+ */
+void json_write_raw(json_writer_t *writer, const char *json, size_t len);
+
+// Key-value shorthands for object members
+void json_write_kv_string(json_writer_t *writer, const char *key, const char *str);
+void json_write_kv_int(json_writer_t *writer, const char *key, int64_t value);
+void json_write_kv_uint(json_writer_t *writer, const char *key, uint64_t value);
+void json_write_kv_double(json_writer_t *writer, const char *key, double value);
+void json_write_kv_bool(json_writer_t *writer, const char *key, bool value);
+void json_write_kv_null(json_writer_t *writer, const char *key);
+void json_write_kv_object(json_writer_t *writer, const char *key);
+void json_write_kv_array(json_writer_t *writer, const char *key);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,106 @@
+/**
+ * @file rpc_frame.h
+ * @brief COBS framing with CRC for binary (CBOR) RPC, and the transports' receive assembler
+ *
+ * CONTEXT: Every management transport carried newline-delimited JSON, assembled byte by byte;
+ *          bulk provisioning (pairing, key rotation, telemetry pulls) paid for the text
+ * PURPOSE: A frame is 0x00, COBS(CBOR request + CRC-16), 0x00. A JSON line never contains a
+ *          zero byte, so the leading delimiter is the magic that switches the receiver into
+ *          binary mode for one frame: JSON and binary clients share a port without any
+ *          session negotiation
+ * USAGE: Pure C; transports feed received bytes to rpc_rx_feed(), commands.c streams binary
+ *        responses through rpc_frame_encoder_t, tools/loracue_rpc.py is the host side
+ *
+ * Binary request:  CBOR array [id, method name, params map (optional)]
+ * Binary response: CBOR array [id, 0, result] or [id, JSON-RPC error code, message]
+ */
+
+#pragma once
+
+#include "json_stream.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RPC_FRAME_DELIMITER 0x00
+#define RPC_FRAME_CRC_SIZE 2       ///< CRC-16/CCITT-FALSE of the payload, big-endian, inside the COBS data
+#define RPC_FRAME_COBS_BLOCK 254   ///< Longest run of non-zero bytes one COBS code byte covers
+#define RPC_FRAME_ENCODER_BUF 512  ///< Holds a complete block plus the one being filled
+
+/**
+ * @brief CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF); pass the previous result to continue
+ */
+uint16_t rpc_frame_crc16(uint16_t crc, const uint8_t *data, size_t len);
+
+/**
+ * @brief Decode the bytes between two delimiters in place and check the CRC
+ *
+ * @param payload_len Payload length without the CRC
+ * @return false on a malformed COBS block or CRC mismatch
+ */
+bool rpc_frame_decode(uint8_t *buf, size_t len, size_t *payload_len);
+
+/**
+ * @brief Streaming frame encoder; output reaches the sink in pieces of up to RPC_FRAME_ENCODER_BUF
+ */
+typedef struct {
+    uint8_t out[RPC_FRAME_ENCODER_BUF];
+    uint16_t used;
+    uint16_t code_pos; ///< Code byte of the open block
+    uint16_t crc;
+    json_sink_fn_t sink;
+    void *ctx;
+} rpc_frame_encoder_t;
+
+/**
+ * @brief Start a frame (the leading delimiter is buffered, not sent yet)
+ */
+void rpc_frame_encoder_begin(rpc_frame_encoder_t *enc, json_sink_fn_t sink, void *ctx);
+
+/**
+ * @brief Append payload bytes; a json_sink_fn_t, so a json_writer_t can write into it
+ *
+ * @param ctx The rpc_frame_encoder_t
+ */
+void rpc_frame_encoder_write(const char *data, size_t len, void *ctx);
+
+/**
+ * @brief Append the CRC and the closing delimiter and hand everything left to the sink
+ */
+void rpc_frame_encoder_end(rpc_frame_encoder_t *enc);
+
+/**
+ * @brief Receives one complete message from the assembler
+ *
+ * @param msg Text line (NUL-terminated, terminator stripped) or decoded binary payload;
+ *            valid only during the call
+ */
+typedef void (*rpc_rx_fn_t)(char *msg, size_t len, bool binary, void *ctx);
+
+/**
+ * @brief Splits a byte stream into JSON lines and binary frames
+ */
+typedef struct {
+    char *buf;
+    size_t size;
+    size_t len;
+    bool binary;       ///< Inside a frame
+    bool discarding;   ///< Overflowed: drop input up to the end of this line or frame
+    bool line_editing; ///< Terminal input: backspace/DEL edit the line, other control bytes are dropped
+    uint32_t dropped;  ///< Overlong lines and frames, bad frames
+} rpc_rx_t;
+
+void rpc_rx_init(rpc_rx_t *rx, char *buf, size_t size, bool line_editing);
+
+/**
+ * @brief Consume received bytes, calling on_message for each completed line or valid frame
+ */
+void rpc_rx_feed(rpc_rx_t *rx, const uint8_t *data, size_t len, rpc_rx_fn_t on_message, void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
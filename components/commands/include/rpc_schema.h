@@ -0,0 +1,286 @@
+/**
+ * @file rpc_schema.h
+ * @brief JSON-RPC method table, per-method param schemas and request binding
+ *
+ * CONTEXT: Handlers pulled their params out of a cJSON tree one cJSON_GetObjectItem() at a
+ *          time, each with its own type checks (or none)
+ * PURPOSE: Each method declares its params once; the request is tokenized in place and the
+ *          params bound, type- and range-checked into a fixed struct before the handler runs
+ * USAGE: Pure C; commands.c pairs every rpc_method_t with a handler, tests/host benchmarks
+ *        every method here. Built-in names are found through a perfect hash that
+ *        tools/generate_rpc_hash.py builds from method_table; other components add methods
+ *        at runtime through commands_register_method()
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// JSON-RPC 2.0 error codes
+#define JSONRPC_PARSE_ERROR -32700
+#define JSONRPC_INVALID_REQUEST -32600
+#define JSONRPC_METHOD_NOT_FOUND -32601
+#define JSONRPC_INVALID_PARAMS -32602
+#define JSONRPC_INTERNAL_ERROR -32603
+
+// Server errors (JSON-RPC reserves -32000 to -32099 for these)
+#define RPC_ERROR_UNAUTHORIZED -32001     ///< RPC_FLAG_AUTH method over a link that is not authenticated
+#define RPC_ERROR_LINK_NOT_ALLOWED -32002 ///< Method is not served over this link
+
+#define RPC_PARAM_NONE -1 ///< rpc_bind_params() error not tied to one param (params missing or not an object)
+
+#define RPC_METHOD_NAME_MAX 32        ///< Longest method name, without the NUL
+#define RPC_REGISTERED_METHODS_MAX 16 ///< Methods other components may add with rpc_register_method()
+
+// rpc_method_info_t.flags
+#define RPC_FLAG_AUTH 0x01         ///< Secrets or destructive: only over an authenticated link
+#define RPC_FLAG_LONG_RUNNING 0x02 ///< Blocks for seconds (flash erase, reboot); clients should allow for it
+
+// rpc_method_info_t.links: links a method is served over; the route of a request names its link
+#define RPC_LINK_USB_CDC 0x01
+#define RPC_LINK_BLE 0x02
+#define RPC_LINK_UART 0x04
+#define RPC_LINK_HTTP 0x08
+#define RPC_LINK_ANY 0x00
+
+typedef enum {
+    RPC_METHOD_PING,
+    RPC_METHOD_DEVICE_INFO,
+    RPC_METHOD_GENERAL_GET,
+    RPC_METHOD_GENERAL_SET,
+    RPC_METHOD_POWER_GET,
+    RPC_METHOD_POWER_SET,
+    RPC_METHOD_POWER_STATS,
+    RPC_METHOD_SYSTEM_BOOT_TRACE,
+    RPC_METHOD_LORA_GET,
+    RPC_METHOD_LORA_SET,
+    RPC_METHOD_LORA_KEY_GET,
+    RPC_METHOD_LORA_KEY_SET,
+    RPC_METHOD_PAIRED_LIST,
+    RPC_METHOD_PAIRED_PAIR,
+    RPC_METHOD_PAIRED_UNPAIR,
+    RPC_METHOD_DEVICE_RESET,
+    RPC_METHOD_FIRMWARE_UPGRADE,
+    RPC_METHOD_OTA_RESUME,
+    RPC_METHOD_RPC_LIST_METHODS,
+    RPC_METHOD_COUNT,       ///< Built-in methods; registered methods follow from here
+    RPC_METHOD_NONE = 0xFF, ///< Unknown method
+} rpc_method_t;
+
+typedef enum {
+    RPC_PARAM_STRING, ///< char[size], NUL-terminated; longer strings are rejected
+    RPC_PARAM_INT,    ///< int32_t within [min, max]; fractions are rejected
+    RPC_PARAM_BOOL,   ///< bool
+} rpc_param_type_t;
+
+typedef struct {
+    const char *name;
+    rpc_param_type_t type;
+    bool required;
+    uint16_t offset; ///< Field in the method's params struct
+    uint16_t size;   ///< String capacity including the NUL
+    int32_t min;
+    int32_t max;
+    const char *error; ///< Error message when invalid, NULL for "Invalid <name>"
+} rpc_param_t;
+
+typedef struct {
+    const char *name;
+    const rpc_param_t *params; ///< NULL: the method takes no params and ignores any sent
+    uint8_t param_count;
+    uint8_t flags; ///< RPC_FLAG_*
+    uint8_t links; ///< RPC_LINK_* bits, RPC_LINK_ANY for every link
+} rpc_method_info_t;
+
+// Params structs: `present` has bit N set when schema entry N was in the request
+
+enum {
+    GENERAL_SET_NAME,
+    GENERAL_SET_MODE,
+    GENERAL_SET_CONTRAST,
+    GENERAL_SET_BLUETOOTH,
+    GENERAL_SET_BLUETOOTH_PAIRING,
+    GENERAL_SET_SLOT_ID,
+    GENERAL_SET_PARAM_COUNT,
+};
+
+typedef struct {
+    uint32_t present;
+    char name[32];
+    char mode[16];
+    int32_t contrast;
+    bool bluetooth;
+    bool bluetooth_pairing;
+    int32_t slot_id;
+} rpc_general_set_params_t;
+
+enum {
+    POWER_SET_DISPLAY_SLEEP_ENABLED,
+    POWER_SET_DISPLAY_SLEEP_TIMEOUT_MS,
+    POWER_SET_LIGHT_SLEEP_ENABLED,
+    POWER_SET_LIGHT_SLEEP_TIMEOUT_MS,
+    POWER_SET_DEEP_SLEEP_ENABLED,
+    POWER_SET_DEEP_SLEEP_TIMEOUT_MS,
+    POWER_SET_PARAM_COUNT,
+};
+
+typedef struct {
+    uint32_t present;
+    bool display_sleep_enabled;
+    int32_t display_sleep_timeout_ms;
+    bool light_sleep_enabled;
+    int32_t light_sleep_timeout_ms;
+    bool deep_sleep_enabled;
+    int32_t deep_sleep_timeout_ms;
+} rpc_power_set_params_t;
+
+enum {
+    LORA_SET_FREQUENCY_KHZ,
+    LORA_SET_SPREADING_FACTOR,
+    LORA_SET_BANDWIDTH_KHZ,
+    LORA_SET_CODING_RATE,
+    LORA_SET_TX_POWER_DBM,
+    LORA_SET_BAND_ID,
+    LORA_SET_REGULATORY_DOMAIN,
+    LORA_SET_PARAM_COUNT,
+};
+
+typedef struct {
+    uint32_t present;
+    int32_t frequency_khz;
+    int32_t spreading_factor;
+    int32_t bandwidth_khz;
+    int32_t coding_rate;
+    int32_t tx_power_dbm;
+    char band_id[16];
+    char regulatory_domain[3];
+} rpc_lora_set_params_t;
+
+typedef struct {
+    uint32_t present;
+    char aes_key[65];
+} rpc_lora_key_set_params_t;
+
+typedef struct {
+    uint32_t present;
+    char name[32];
+    char mac[18];
+    char aes_key[65];
+} rpc_paired_pair_params_t;
+
+typedef struct {
+    uint32_t present;
+    char mac[18];
+} rpc_paired_unpair_params_t;
+
+typedef struct {
+    uint32_t present;
+    int32_t size;
+    char sha256[65];
+    char signature[129];
+} rpc_firmware_upgrade_params_t;
+
+/**
+ * @brief Storage for the params of any method, so the dispatcher needs one stack buffer
+ */
+typedef union {
+    uint32_t present;
+    rpc_general_set_params_t general_set;
+    rpc_power_set_params_t power_set;
+    rpc_lora_set_params_t lora_set;
+    rpc_lora_key_set_params_t lora_key_set;
+    rpc_paired_pair_params_t paired_pair;
+    rpc_paired_unpair_params_t paired_unpair;
+    rpc_firmware_upgrade_params_t firmware_upgrade;
+} rpc_params_t;
+
+/**
+ * @brief Request fields located by rpc_parse_envelope(); pointers are into the request
+ */
+typedef struct {
+    rpc_method_t method; ///< RPC_METHOD_NONE if the name is unknown
+    const char *id;      ///< Raw JSON of the id, echoed back verbatim; NULL if absent
+    size_t id_len;
+    const char *params; ///< Raw JSON of params, NULL if absent
+    size_t params_len;
+    bool cbor; ///< id and params are CBOR (binary frame), not JSON text
+} rpc_envelope_t;
+
+/**
+ * @brief Method metadata, for built-in and registered methods alike
+ *
+ * @return NULL for ids at or past rpc_method_count()
+ */
+const rpc_method_info_t *rpc_method_info(rpc_method_t method);
+
+/**
+ * @brief Number of methods: built-ins, then registered ones in registration order
+ */
+size_t rpc_method_count(void);
+
+/**
+ * @brief Look up a method by name; O(1) for built-ins and registered methods
+ *
+ * @return RPC_METHOD_NONE if unknown
+ */
+rpc_method_t rpc_method_find(const char *name, size_t len);
+
+/**
+ * @brief Add a method at runtime; it takes the next id from RPC_METHOD_COUNT on
+ *
+ * info is kept by pointer and must stay valid. Its params struct must begin with the
+ * uint32_t present mask and fit in rpc_params_t. Registrations must be serialized by the
+ * caller, but may run while other tasks look methods up.
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_ARG for a bad name or schema, ESP_ERR_INVALID_STATE if
+ *         the name is taken, ESP_ERR_NO_MEM past RPC_REGISTERED_METHODS_MAX
+ */
+esp_err_t rpc_register_method(const rpc_method_info_t *info, rpc_method_t *id);
+
+/**
+ * @brief Method name hash; tools/generate_rpc_hash.py mirrors it to build the perfect hash
+ */
+uint32_t rpc_method_hash(uint32_t seed, const char *name, size_t len);
+
+/**
+ * @brief Validate a request and locate method, id and params
+ *
+ * @return 0, JSONRPC_PARSE_ERROR for malformed JSON, JSONRPC_INVALID_REQUEST for a
+ *         non-object request or missing/non-string method, JSONRPC_METHOD_NOT_FOUND (with
+ *         id set)
+ */
+int rpc_parse_envelope(const char *json, size_t len, rpc_envelope_t *env);
+
+/**
+ * @brief rpc_parse_envelope() for a binary frame: CBOR [id, method, params (optional)]
+ *
+ * Same return values; JSONRPC_INVALID_REQUEST for anything but a 2 or 3 item array with a
+ * text method.
+ */
+int rpc_parse_envelope_cbor(const char *cbor, size_t len, rpc_envelope_t *env);
+
+/**
+ * @brief Bind params against the method's schema
+ *
+ * Unknown members are skipped. Zeroes params first.
+ *
+ * @param bad_param Schema index of the offending param, or RPC_PARAM_NONE
+ * @return 0 or JSONRPC_INVALID_PARAMS
+ */
+int rpc_bind_params(const rpc_envelope_t *env, rpc_params_t *params, int *bad_param);
+
+static inline bool rpc_param_present(const rpc_params_t *params, int index)
+{
+    return (params->present & (1UL << index)) != 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
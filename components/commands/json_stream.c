@@ -0,0 +1,1131 @@
+/**
+ * @file json_stream.c
+ * @brief Allocation-free JSON pull tokenizer and streaming writer
+ */
+
+#include "json_stream.h"
+#include <math.h>
+#include <string.h>
+
+#define DOUBLE_FRACTION_SCALE 1000000ULL
+#define DOUBLE_FRACTION_DIGITS 6
+#define DOUBLE_FRACTION_LIMIT 1e12 // Keeps value * scale inside uint64_t
+
+// CBOR (RFC 8949) major types and initial bytes
+enum {
+    CBOR_UINT,
+    CBOR_NEGINT,
+    CBOR_BYTES,
+    CBOR_TEXT,
+    CBOR_ARRAY,
+    CBOR_MAP,
+    CBOR_TAG,
+    CBOR_SIMPLE,
+};
+
+#define CBOR_AI_1BYTE 24
+#define CBOR_AI_8BYTES 27
+#define CBOR_AI_INDEFINITE 31
+#define CBOR_FALSE 0xF4
+#define CBOR_TRUE 0xF5
+#define CBOR_NULL 0xF6
+#define CBOR_UNDEFINED 0xF7
+#define CBOR_FLOAT16 0xF9
+#define CBOR_FLOAT32 0xFA
+#define CBOR_FLOAT64 0xFB
+#define CBOR_BREAK 0xFF
+#define CBOR_INDEFINITE UINT32_MAX
+#define CBOR_INT_LIMIT 9223372036854775808.0 // 2^63
+
+enum {
+    READ_VALUE,
+    READ_VALUE_OR_END, // After '['
+    READ_KEY_OR_END,   // After '{'
+    READ_COMMA_OR_END, // After a value inside a container
+    READ_DONE,         // Top-level value complete, only whitespace may follow
+    READ_ERROR,
+};
+
+//==============================================================================
+// READER
+//==============================================================================
+
+void json_reader_init(json_reader_t *reader, const char *buf, size_t len)
+{
+    memset(reader, 0, sizeof(*reader));
+    reader->buf   = buf;
+    reader->len   = len;
+    reader->state = READ_VALUE;
+}
+
+void json_reader_init_cbor(json_reader_t *reader, const char *buf, size_t len)
+{
+    json_reader_init(reader, buf, len);
+    reader->cbor = true;
+}
+
+static void skip_whitespace(json_reader_t *r)
+{
+    while (r->pos < r->len) {
+        char c = r->buf[r->pos];
+        if (c != ' ' && c != '\t' && c != '\n' && c != '\r') {
+            break;
+        }
+        r->pos++;
+    }
+}
+
+static json_tok_type_t fail(json_reader_t *r, json_token_t *tok)
+{
+    r->state  = READ_ERROR;
+    tok->type = JSON_TOK_ERROR;
+    return JSON_TOK_ERROR;
+}
+
+static json_tok_type_t emit_token(json_reader_t *r, json_token_t *tok, json_tok_type_t type, size_t start)
+{
+    tok->type  = type;
+    tok->start = r->buf + start;
+    tok->len   = r->pos - start;
+    return type;
+}
+
+static bool is_digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+static int hex_value(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+// Validates a string starting at the opening quote and leaves pos after the closing one
+static bool scan_string(json_reader_t *r)
+{
+    size_t i = r->pos + 1;
+    while (i < r->len) {
+        unsigned char c = (unsigned char)r->buf[i];
+        if (c == '"') {
+            r->pos = i + 1;
+            return true;
+        }
+        if (c < 0x20) {
+            return false;
+        }
+        if (c != '\\') {
+            i++;
+            continue;
+        }
+
+        if (++i >= r->len) {
+            return false;
+        }
+        c = (unsigned char)r->buf[i];
+        if (c == 'u') {
+            if (i + 4 >= r->len) {
+                return false;
+            }
+            for (int k = 1; k <= 4; k++) {
+                if (hex_value(r->buf[i + k]) < 0) {
+                    return false;
+                }
+            }
+            i += 5;
+        } else if (c != '\0' && strchr("\"\\/bfnrt", c)) {
+            i++;
+        } else {
+            return false;
+        }
+    }
+    return false;
+}
+
+static bool scan_digits(json_reader_t *r)
+{
+    size_t start = r->pos;
+    while (r->pos < r->len && is_digit(r->buf[r->pos])) {
+        r->pos++;
+    }
+    return r->pos > start;
+}
+
+static bool scan_number(json_reader_t *r)
+{
+    if (r->buf[r->pos] == '-') {
+        r->pos++;
+    }
+    if (r->pos < r->len && r->buf[r->pos] == '0') {
+        r->pos++;
+    } else if (!scan_digits(r)) {
+        return false;
+    }
+
+    if (r->pos < r->len && r->buf[r->pos] == '.') {
+        r->pos++;
+        if (!scan_digits(r)) {
+            return false;
+        }
+    }
+    if (r->pos < r->len && (r->buf[r->pos] == 'e' || r->buf[r->pos] == 'E')) {
+        r->pos++;
+        if (r->pos < r->len && (r->buf[r->pos] == '+' || r->buf[r->pos] == '-')) {
+            r->pos++;
+        }
+        if (!scan_digits(r)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool scan_literal(json_reader_t *r, const char *literal)
+{
+    size_t n = strlen(literal);
+    if (r->len - r->pos < n || memcmp(r->buf + r->pos, literal, n) != 0) {
+        return false;
+    }
+    r->pos += n;
+    return true;
+}
+
+static json_tok_type_t read_value(json_reader_t *r, json_token_t *tok)
+{
+    if (r->pos >= r->len) {
+        return fail(r, tok);
+    }
+
+    size_t start = r->pos;
+    char c       = r->buf[r->pos];
+    if (c == '{' || c == '[') {
+        if (r->depth >= JSON_MAX_DEPTH) {
+            return fail(r, tok);
+        }
+        bool object = (c == '{');
+        if (object) {
+            r->objects |= 1UL << r->depth;
+        } else {
+            r->objects &= ~(1UL << r->depth);
+        }
+        r->depth++;
+        r->pos++;
+        r->state = object ? READ_KEY_OR_END : READ_VALUE_OR_END;
+        return emit_token(r, tok, object ? JSON_TOK_OBJECT_BEGIN : JSON_TOK_ARRAY_BEGIN, start);
+    }
+
+    json_tok_type_t type;
+    bool ok;
+    if (c == '"') {
+        type = JSON_TOK_STRING;
+        ok   = scan_string(r);
+    } else if (c == '-' || is_digit(c)) {
+        type = JSON_TOK_NUMBER;
+        ok   = scan_number(r);
+    } else if (c == 't') {
+        type = JSON_TOK_TRUE;
+        ok   = scan_literal(r, "true");
+    } else if (c == 'f') {
+        type = JSON_TOK_FALSE;
+        ok   = scan_literal(r, "false");
+    } else if (c == 'n') {
+        type = JSON_TOK_NULL;
+        ok   = scan_literal(r, "null");
+    } else {
+        ok = false;
+    }
+    if (!ok) {
+        return fail(r, tok);
+    }
+
+    r->state = r->depth ? READ_COMMA_OR_END : READ_DONE;
+    return emit_token(r, tok, type, start);
+}
+
+static json_tok_type_t read_key(json_reader_t *r, json_token_t *tok)
+{
+    size_t start = r->pos;
+    if (r->pos >= r->len || r->buf[r->pos] != '"' || !scan_string(r)) {
+        return fail(r, tok);
+    }
+    emit_token(r, tok, JSON_TOK_KEY, start);
+
+    skip_whitespace(r);
+    if (r->pos >= r->len || r->buf[r->pos] != ':') {
+        return fail(r, tok);
+    }
+    r->pos++;
+    r->state = READ_VALUE;
+    return JSON_TOK_KEY;
+}
+
+static json_tok_type_t close_container(json_reader_t *r, json_token_t *tok, bool object)
+{
+    if (r->buf[r->pos] != (object ? '}' : ']')) {
+        return fail(r, tok);
+    }
+    size_t start = r->pos++;
+    r->depth--;
+    tok->depth = r->depth;
+    r->state   = r->depth ? READ_COMMA_OR_END : READ_DONE;
+    return emit_token(r, tok, object ? JSON_TOK_OBJECT_END : JSON_TOK_ARRAY_END, start);
+}
+
+// Decodes the head of the data item at p; returns its length, 0 if truncated or reserved
+static size_t cbor_head(const uint8_t *p, size_t avail, uint8_t *major, uint64_t *arg, bool *indefinite)
+{
+    if (avail == 0) {
+        return 0;
+    }
+    *major      = p[0] >> 5;
+    uint8_t ai  = p[0] & 0x1F;
+    *indefinite = (ai == CBOR_AI_INDEFINITE);
+    *arg        = ai;
+    if (ai < CBOR_AI_1BYTE || *indefinite) {
+        return 1;
+    }
+    if (ai > CBOR_AI_8BYTES) {
+        return 0;
+    }
+
+    size_t n = (size_t)1 << (ai - CBOR_AI_1BYTE);
+    if (avail < 1 + n) {
+        return 0;
+    }
+    uint64_t value = 0;
+    for (size_t i = 1; i <= n; i++) {
+        value = value << 8 | p[i];
+    }
+    *arg = value;
+    return 1 + n;
+}
+
+static json_tok_type_t cbor_close(json_reader_t *r, json_token_t *tok, size_t consumed)
+{
+    size_t start = r->pos;
+    bool object  = r->objects & (1UL << (r->depth - 1));
+    r->pos += consumed;
+    r->depth--;
+    tok->depth = r->depth;
+    if (r->depth == 0) {
+        r->state = READ_DONE;
+    }
+    return emit_token(r, tok, object ? JSON_TOK_OBJECT_END : JSON_TOK_ARRAY_END, start);
+}
+
+static json_tok_type_t cbor_next(json_reader_t *r, json_token_t *tok)
+{
+    tok->cbor = true;
+    if (r->state == READ_DONE) {
+        if (r->pos != r->len) {
+            return fail(r, tok);
+        }
+        tok->type = JSON_TOK_END;
+        return JSON_TOK_END;
+    }
+
+    const uint8_t *p = (const uint8_t *)r->buf + r->pos;
+    size_t avail     = r->len - r->pos;
+    bool at_key      = false;
+    if (r->depth > 0) {
+        uint32_t bit = 1UL << (r->depth - 1);
+        bool object  = r->objects & bit;
+        at_key       = object && (r->keys & bit);
+
+        uint32_t *remaining = &r->remaining[r->depth - 1];
+        if (*remaining == CBOR_INDEFINITE && avail > 0 && p[0] == CBOR_BREAK) {
+            return at_key || !object ? cbor_close(r, tok, 1) : fail(r, tok);
+        }
+        if (*remaining == 0) {
+            return cbor_close(r, tok, 0);
+        }
+        if (*remaining != CBOR_INDEFINITE) {
+            (*remaining)--;
+        }
+        if (object) {
+            r->keys ^= bit;
+        }
+    }
+
+    uint8_t major;
+    uint64_t arg;
+    bool indefinite;
+    size_t head = cbor_head(p, avail, &major, &arg, &indefinite);
+    if (head == 0 || (at_key && major != CBOR_TEXT)) {
+        return fail(r, tok);
+    }
+
+    size_t start = r->pos;
+    json_tok_type_t type;
+    switch (major) {
+        case CBOR_UINT:
+        case CBOR_NEGINT:
+            if (indefinite) {
+                return fail(r, tok);
+            }
+            type = JSON_TOK_NUMBER;
+            break;
+        case CBOR_TEXT:
+            if (indefinite || arg > avail - head) {
+                return fail(r, tok);
+            }
+            type = at_key ? JSON_TOK_KEY : JSON_TOK_STRING;
+            head += (size_t)arg;
+            break;
+        case CBOR_ARRAY:
+        case CBOR_MAP: {
+            bool object = (major == CBOR_MAP);
+            // Every item takes at least one byte, which also bounds 2 * pairs
+            if (r->depth >= JSON_MAX_DEPTH || (!indefinite && arg > (avail - head) / (object ? 2 : 1))) {
+                return fail(r, tok);
+            }
+            uint32_t bit = 1UL << r->depth;
+            if (object) {
+                r->objects |= bit;
+                r->keys |= bit;
+            } else {
+                r->objects &= ~bit;
+            }
+            r->remaining[r->depth] = indefinite ? CBOR_INDEFINITE : (uint32_t)(object ? arg * 2 : arg);
+            r->depth++;
+            r->pos += head;
+            return emit_token(r, tok, object ? JSON_TOK_OBJECT_BEGIN : JSON_TOK_ARRAY_BEGIN, start);
+        }
+        case CBOR_SIMPLE:
+            if (p[0] == CBOR_FALSE) {
+                type = JSON_TOK_FALSE;
+            } else if (p[0] == CBOR_TRUE) {
+                type = JSON_TOK_TRUE;
+            } else if (p[0] == CBOR_NULL || p[0] == CBOR_UNDEFINED) {
+                type = JSON_TOK_NULL;
+            } else if (p[0] >= CBOR_FLOAT16 && p[0] <= CBOR_FLOAT64) {
+                type = JSON_TOK_NUMBER;
+            } else {
+                return fail(r, tok);
+            }
+            break;
+        default: // Byte strings and tags have no JSON counterpart
+            return fail(r, tok);
+    }
+
+    r->pos += head;
+    if (r->depth == 0) {
+        r->state = READ_DONE;
+    }
+    return emit_token(r, tok, type, start);
+}
+
+json_tok_type_t json_next(json_reader_t *reader, json_token_t *tok)
+{
+    tok->type  = JSON_TOK_ERROR;
+    tok->start = NULL;
+    tok->len   = 0;
+    tok->depth = reader->depth;
+    tok->cbor  = false;
+    if (reader->state == READ_ERROR) {
+        return JSON_TOK_ERROR;
+    }
+    if (reader->cbor) {
+        return cbor_next(reader, tok);
+    }
+
+    skip_whitespace(reader);
+    if (reader->state == READ_DONE) {
+        if (reader->pos != reader->len) {
+            return fail(reader, tok);
+        }
+        tok->type = JSON_TOK_END;
+        return JSON_TOK_END;
+    }
+    if (reader->pos >= reader->len) {
+        return fail(reader, tok);
+    }
+
+    char c         = reader->buf[reader->pos];
+    bool in_object = reader->depth > 0 && (reader->objects & (1UL << (reader->depth - 1)));
+    switch (reader->state) {
+        case READ_COMMA_OR_END:
+            if (c != ',') {
+                return close_container(reader, tok, in_object);
+            }
+            reader->pos++;
+            skip_whitespace(reader);
+            return in_object ? read_key(reader, tok) : read_value(reader, tok);
+        case READ_KEY_OR_END:
+            return c == '}' ? close_container(reader, tok, true) : read_key(reader, tok);
+        case READ_VALUE_OR_END:
+            return c == ']' ? close_container(reader, tok, false) : read_value(reader, tok);
+        default:
+            return read_value(reader, tok);
+    }
+}
+
+bool json_skip(json_reader_t *reader, const json_token_t *tok)
+{
+    if (tok->type != JSON_TOK_OBJECT_BEGIN && tok->type != JSON_TOK_ARRAY_BEGIN) {
+        return tok->type != JSON_TOK_ERROR;
+    }
+
+    json_token_t t;
+    while (1) {
+        json_tok_type_t type = json_next(reader, &t);
+        if (type == JSON_TOK_ERROR || type == JSON_TOK_END) {
+            return false;
+        }
+        if ((type == JSON_TOK_OBJECT_END || type == JSON_TOK_ARRAY_END) && t.depth == tok->depth) {
+            return true;
+        }
+    }
+}
+
+//==============================================================================
+// TOKEN ACCESS
+//==============================================================================
+
+static size_t encode_utf8(uint32_t cp, char out[4])
+{
+    if (cp < 0x80) {
+        out[0] = (char)cp;
+        return 1;
+    }
+    if (cp < 0x800) {
+        out[0] = (char)(0xC0 | (cp >> 6));
+        out[1] = (char)(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        out[0] = (char)(0xE0 | (cp >> 12));
+        out[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | (cp >> 18));
+    out[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+    out[3] = (char)(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+static uint32_t read_hex4(const char *p)
+{
+    return (uint32_t)(hex_value(p[0]) << 12 | hex_value(p[1]) << 8 | hex_value(p[2]) << 4 | hex_value(p[3]));
+}
+
+// Decodes one character of an already validated string body; returns its UTF-8 length, 0 on error
+static size_t decode_next(const char **p, const char *end, char out[4])
+{
+    const char *s = *p;
+    if (*s != '\\') {
+        out[0] = *s;
+        *p     = s + 1;
+        return 1;
+    }
+
+    char e = s[1];
+    *p     = s + 2;
+    switch (e) {
+        case 'b':
+            out[0] = '\b';
+            return 1;
+        case 'f':
+            out[0] = '\f';
+            return 1;
+        case 'n':
+            out[0] = '\n';
+            return 1;
+        case 'r':
+            out[0] = '\r';
+            return 1;
+        case 't':
+            out[0] = '\t';
+            return 1;
+        case 'u':
+            break;
+        default: // '"', '\\', '/'
+            out[0] = e;
+            return 1;
+    }
+
+    uint32_t cp = read_hex4(s + 2);
+    *p          = s + 6;
+    if (cp >= 0xDC00 && cp <= 0xDFFF) {
+        return 0; // Lone low surrogate
+    }
+    if (cp >= 0xD800 && cp <= 0xDBFF) {
+        if (end - *p < 6 || (*p)[0] != '\\' || (*p)[1] != 'u') {
+            return 0;
+        }
+        uint32_t low = read_hex4(*p + 2);
+        if (low < 0xDC00 || low > 0xDFFF) {
+            return 0;
+        }
+        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+        *p += 6;
+    }
+    return cp == 0 ? 0 : encode_utf8(cp, out);
+}
+
+static bool is_string_token(const json_token_t *tok)
+{
+    return (tok->type == JSON_TOK_STRING || tok->type == JSON_TOK_KEY) && tok->len >= 2;
+}
+
+// Payload of a CBOR text token; no escapes, the reader has bounds-checked the length
+static bool cbor_text(const json_token_t *tok, const char **text, size_t *len)
+{
+    uint8_t major;
+    uint64_t arg;
+    bool indefinite;
+    size_t head = cbor_head((const uint8_t *)tok->start, tok->len, &major, &arg, &indefinite);
+    if ((tok->type != JSON_TOK_STRING && tok->type != JSON_TOK_KEY) || head == 0 || major != CBOR_TEXT) {
+        return false;
+    }
+    *text = tok->start + head;
+    *len  = (size_t)arg;
+    return true;
+}
+
+bool json_token_copy(const json_token_t *tok, char *out, size_t size, size_t *out_len)
+{
+    if (tok->cbor) {
+        const char *text;
+        size_t len;
+        if (!cbor_text(tok, &text, &len) || len >= size || memchr(text, '\0', len)) {
+            return false;
+        }
+        memcpy(out, text, len);
+        out[len] = '\0';
+        if (out_len) {
+            *out_len = len;
+        }
+        return true;
+    }
+    if (!is_string_token(tok) || size == 0) {
+        return false;
+    }
+
+    const char *p   = tok->start + 1;
+    const char *end = tok->start + tok->len - 1;
+    size_t n        = (size_t)(end - p);
+    if (!memchr(p, '\\', n)) {
+        // No escapes (the usual case): the raw text is the string, control characters were rejected
+        if (n >= size) {
+            return false;
+        }
+        memcpy(out, p, n);
+        out[n] = '\0';
+        if (out_len) {
+            *out_len = n;
+        }
+        return true;
+    }
+
+    n = 0;
+    while (p < end) {
+        char unit[4];
+        size_t k = decode_next(&p, end, unit);
+        if (k == 0 || n + k >= size) {
+            return false;
+        }
+        memcpy(out + n, unit, k);
+        n += k;
+    }
+    out[n] = '\0';
+    if (out_len) {
+        *out_len = n;
+    }
+    return true;
+}
+
+bool json_token_equals(const json_token_t *tok, const char *str)
+{
+    if (tok->cbor) {
+        const char *text;
+        size_t len;
+        return cbor_text(tok, &text, &len) && strncmp(str, text, len) == 0 && str[len] == '\0' &&
+               !memchr(text, '\0', len);
+    }
+    if (!is_string_token(tok)) {
+        return false;
+    }
+
+    const char *p   = tok->start + 1;
+    const char *end = tok->start + tok->len - 1;
+    size_t raw_len  = (size_t)(end - p);
+    if (!memchr(p, '\\', raw_len)) {
+        return strncmp(str, p, raw_len) == 0 && str[raw_len] == '\0';
+    }
+
+    while (p < end) {
+        char unit[4];
+        size_t k = decode_next(&p, end, unit);
+        if (k == 0 || strncmp(str, unit, k) != 0) {
+            return false;
+        }
+        str += k;
+    }
+    return *str == '\0';
+}
+
+bool json_token_int(const json_token_t *tok, int64_t *out)
+{
+    if (tok->type != JSON_TOK_NUMBER) {
+        return false;
+    }
+    if (tok->cbor) {
+        uint8_t major;
+        uint64_t arg;
+        bool indefinite;
+        cbor_head((const uint8_t *)tok->start, tok->len, &major, &arg, &indefinite);
+        if ((major != CBOR_UINT && major != CBOR_NEGINT) || arg > INT64_MAX) {
+            return false; // Floats are rejected like JSON fractions
+        }
+        *out = major == CBOR_UINT ? (int64_t)arg : -1 - (int64_t)arg;
+        return true;
+    }
+
+    const char *p   = tok->start;
+    const char *end = tok->start + tok->len;
+    bool negative   = (*p == '-');
+    if (negative) {
+        p++;
+    }
+
+    uint64_t limit = negative ? (uint64_t)INT64_MAX + 1 : (uint64_t)INT64_MAX;
+    uint64_t value = 0;
+    for (; p < end; p++) {
+        if (!is_digit(*p)) {
+            return false; // Fraction or exponent
+        }
+        uint64_t digit = (uint64_t)(*p - '0');
+        if (value > (limit - digit) / 10) {
+            return false;
+        }
+        value = value * 10 + digit;
+    }
+
+    *out = negative ? (int64_t)(0 - value) : (int64_t)value;
+    return true;
+}
+
+//==============================================================================
+// WRITER
+//==============================================================================
+
+void json_writer_init(json_writer_t *writer, char *buf, size_t size, json_sink_fn_t sink, void *ctx)
+{
+    memset(writer, 0, sizeof(*writer));
+    writer->buf  = buf;
+    writer->size = size;
+    writer->sink = sink;
+    writer->ctx  = ctx;
+}
+
+void json_writer_init_cbor(json_writer_t *writer, char *buf, size_t size, json_sink_fn_t sink, void *ctx)
+{
+    json_writer_init(writer, buf, size, sink, ctx);
+    writer->cbor = true;
+}
+
+void json_writer_flush(json_writer_t *writer)
+{
+    if (writer->used == 0) {
+        return;
+    }
+    if (writer->sink) {
+        writer->sink(writer->buf, writer->used, writer->ctx);
+    }
+    writer->total += writer->used;
+    writer->used = 0;
+}
+
+static void emit(json_writer_t *w, const char *data, size_t len)
+{
+    while (len > 0) {
+        if (w->used == w->size) {
+            json_writer_flush(w);
+        }
+        size_t room = w->size - w->used;
+        size_t n    = len < room ? len : room;
+        memcpy(w->buf + w->used, data, n);
+        w->used += n;
+        data += n;
+        len -= n;
+    }
+}
+
+static void emit_char(json_writer_t *w, char c)
+{
+    emit(w, &c, 1);
+}
+
+// Comma before every item of a container but the first; none between a key and its value
+static void begin_item(json_writer_t *w)
+{
+    if (w->cbor) {
+        return;
+    }
+    if (w->after_key) {
+        w->after_key = false;
+        return;
+    }
+    if (w->depth == 0) {
+        return;
+    }
+
+    uint32_t bit = 1UL << (w->depth - 1);
+    if (w->has_items & bit) {
+        emit_char(w, ',');
+    }
+    w->has_items |= bit;
+}
+
+static void emit_escaped(json_writer_t *w, const char *str)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    emit_char(w, '"');
+    const char *run = str;
+    for (const char *p = str; *p; p++) {
+        unsigned char c = (unsigned char)*p;
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+
+        emit(w, run, (size_t)(p - run));
+        run = p + 1;
+
+        char esc[6] = {'\\', 0};
+        size_t n    = 2;
+        switch (c) {
+            case '"':
+            case '\\':
+                esc[1] = (char)c;
+                break;
+            case '\b':
+                esc[1] = 'b';
+                break;
+            case '\f':
+                esc[1] = 'f';
+                break;
+            case '\n':
+                esc[1] = 'n';
+                break;
+            case '\r':
+                esc[1] = 'r';
+                break;
+            case '\t':
+                esc[1] = 't';
+                break;
+            default:
+                memcpy(esc + 1, "u00", 3);
+                esc[4] = hex[c >> 4];
+                esc[5] = hex[c & 0xF];
+                n      = 6;
+                break;
+        }
+        emit(w, esc, n);
+    }
+    emit(w, run, strlen(run));
+    emit_char(w, '"');
+}
+
+static void emit_uint(json_writer_t *w, uint64_t value)
+{
+    char digits[20];
+    size_t n = sizeof(digits);
+    do {
+        digits[--n] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value);
+    emit(w, digits + n, sizeof(digits) - n);
+}
+
+static void cbor_emit_head(json_writer_t *w, uint8_t major, uint64_t arg)
+{
+    uint8_t head[9];
+    size_t n;
+    if (arg < CBOR_AI_1BYTE) {
+        head[0] = (uint8_t)(major << 5 | arg);
+        n       = 0;
+    } else if (arg <= UINT8_MAX) {
+        head[0] = (uint8_t)(major << 5 | CBOR_AI_1BYTE);
+        n       = 1;
+    } else if (arg <= UINT16_MAX) {
+        head[0] = (uint8_t)(major << 5 | (CBOR_AI_1BYTE + 1));
+        n       = 2;
+    } else if (arg <= UINT32_MAX) {
+        head[0] = (uint8_t)(major << 5 | (CBOR_AI_1BYTE + 2));
+        n       = 4;
+    } else {
+        head[0] = (uint8_t)(major << 5 | CBOR_AI_8BYTES);
+        n       = 8;
+    }
+    for (size_t i = 0; i < n; i++) {
+        head[n - i] = (uint8_t)(arg >> (8 * i));
+    }
+    emit(w, (const char *)head, n + 1);
+}
+
+static void cbor_emit_byte(json_writer_t *w, uint8_t b)
+{
+    emit_char(w, (char)b);
+}
+
+static void cbor_emit_text(json_writer_t *w, const char *str)
+{
+    size_t len = strlen(str);
+    cbor_emit_head(w, CBOR_TEXT, len);
+    emit(w, str, len);
+}
+
+static void cbor_emit_float(json_writer_t *w, double value)
+{
+    uint8_t out[9];
+    size_t n;
+    float f = (float)value;
+    if ((double)f == value) {
+        uint32_t bits;
+        memcpy(&bits, &f, sizeof(bits));
+        out[0] = CBOR_FLOAT32;
+        for (n = 0; n < 4; n++) {
+            out[4 - n] = (uint8_t)(bits >> (8 * n));
+        }
+    } else {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        out[0] = CBOR_FLOAT64;
+        for (n = 0; n < 8; n++) {
+            out[8 - n] = (uint8_t)(bits >> (8 * n));
+        }
+    }
+    emit(w, (const char *)out, n + 1);
+}
+
+static void container_begin(json_writer_t *w, char open)
+{
+    begin_item(w);
+    if (w->cbor) {
+        cbor_emit_byte(w, (uint8_t)((open == '{' ? CBOR_MAP : CBOR_ARRAY) << 5 | CBOR_AI_INDEFINITE));
+    } else {
+        emit_char(w, open);
+    }
+    if (w->depth < JSON_MAX_DEPTH) {
+        w->has_items &= ~(1UL << w->depth);
+        w->depth++;
+    }
+}
+
+static void container_end(json_writer_t *w, char close)
+{
+    if (w->depth) {
+        w->depth--;
+    }
+    if (w->cbor) {
+        cbor_emit_byte(w, CBOR_BREAK);
+    } else {
+        emit_char(w, close);
+    }
+}
+
+void json_write_object_begin(json_writer_t *writer)
+{
+    container_begin(writer, '{');
+}
+
+void json_write_object_end(json_writer_t *writer)
+{
+    container_end(writer, '}');
+}
+
+void json_write_array_begin(json_writer_t *writer)
+{
+    container_begin(writer, '[');
+}
+
+void json_write_array_end(json_writer_t *writer)
+{
+    container_end(writer, ']');
+}
+
+void json_write_key(json_writer_t *writer, const char *key)
+{
+    if (writer->cbor) {
+        cbor_emit_text(writer, key);
+        return;
+    }
+    begin_item(writer);
+    emit_escaped(writer, key);
+    emit_char(writer, ':');
+    writer->after_key = true;
+}
+
+void json_write_string(json_writer_t *writer, const char *str)
+{
+    if (!str) {
+        json_write_null(writer);
+        return;
+    }
+    if (writer->cbor) {
+        cbor_emit_text(writer, str);
+        return;
+    }
+    begin_item(writer);
+    emit_escaped(writer, str);
+}
+
+void json_write_int(json_writer_t *writer, int64_t value)
+{
+    if (writer->cbor) {
+        // -1 - value without overflowing at INT64_MIN
+        cbor_emit_head(writer, value < 0 ? CBOR_NEGINT : CBOR_UINT, value < 0 ? ~(uint64_t)value : (uint64_t)value);
+        return;
+    }
+    begin_item(writer);
+    if (value < 0) {
+        emit_char(writer, '-');
+        emit_uint(writer, 0 - (uint64_t)value);
+    } else {
+        emit_uint(writer, (uint64_t)value);
+    }
+}
+
+void json_write_uint(json_writer_t *writer, uint64_t value)
+{
+    if (writer->cbor) {
+        cbor_emit_head(writer, CBOR_UINT, value);
+        return;
+    }
+    begin_item(writer);
+    emit_uint(writer, value);
+}
+
+void json_write_double(json_writer_t *writer, double value)
+{
+    if (isnan(value) || isinf(value)) {
+        json_write_null(writer);
+        return;
+    }
+
+    if (writer->cbor) {
+        if (value > -CBOR_INT_LIMIT && value < CBOR_INT_LIMIT && value == (double)(int64_t)value) {
+            json_write_int(writer, (int64_t)value);
+        } else {
+            cbor_emit_float(writer, value);
+        }
+        return;
+    }
+
+    bool negative = value < 0;
+    double mag    = negative ? -value : value;
+    if (mag >= DOUBLE_FRACTION_LIMIT) {
+        json_write_int(writer, (int64_t)value);
+        return;
+    }
+
+    uint64_t scaled   = (uint64_t)(mag * DOUBLE_FRACTION_SCALE + 0.5);
+    uint64_t integral = scaled / DOUBLE_FRACTION_SCALE;
+    uint64_t fraction = scaled % DOUBLE_FRACTION_SCALE;
+
+    begin_item(writer);
+    if (negative && scaled) {
+        emit_char(writer, '-');
+    }
+    emit_uint(writer, integral);
+    if (fraction == 0) {
+        return;
+    }
+
+    char digits[DOUBLE_FRACTION_DIGITS + 1] = {'.'};
+    for (int i = DOUBLE_FRACTION_DIGITS; i > 0; i--) {
+        digits[i] = (char)('0' + fraction % 10);
+        fraction /= 10;
+    }
+    size_t n = sizeof(digits);
+    while (digits[n - 1] == '0') {
+        n--;
+    }
+    emit(writer, digits, n);
+}
+
+void json_write_bool(json_writer_t *writer, bool value)
+{
+    if (writer->cbor) {
+        cbor_emit_byte(writer, value ? CBOR_TRUE : CBOR_FALSE);
+        return;
+    }
+    begin_item(writer);
+    emit(writer, value ? "true" : "false", value ? 4 : 5);
+}
+
+void json_write_null(json_writer_t *writer)
+{
+    if (writer->cbor) {
+        cbor_emit_byte(writer, CBOR_NULL);
+        return;
+    }
+    begin_item(writer);
+    emit(writer, "null", 4);
+}
+
+void json_write_raw(json_writer_t *writer, const char *json, size_t len)
+{
+    begin_item(writer);
+    emit(writer, json, len);
+}
+
+void json_write_kv_string(json_writer_t *writer, const char *key, const char *str)
+{
+    json_write_key(writer, key);
+    json_write_string(writer, str);
+}
+
+void json_write_kv_int(json_writer_t *writer, const char *key, int64_t value)
+{
+    json_write_key(writer, key);
+    json_write_int(writer, value);
+}
+
+void json_write_kv_uint(json_writer_t *writer, const char *key, uint64_t value)
+{
+    json_write_key(writer, key);
+    json_write_uint(writer, value);
+}
+
+void json_write_kv_double(json_writer_t *writer, const char *key, double value)
+{
+    json_write_key(writer, key);
+    json_write_double(writer, value);
+}
+
+void json_write_kv_bool(json_writer_t *writer, const char *key, bool value)
+{
+    json_write_key(writer, key);
+    json_write_bool(writer, value);
+}
+
+void json_write_kv_null(json_writer_t *writer, const char *key)
+{
+    json_write_key(writer, key);
+    json_write_null(writer);
+}
+
+void json_write_kv_object(json_writer_t *writer, const char *key)
+{
+    json_write_key(writer, key);
+    json_write_object_begin(writer);
+}
+
+void json_write_kv_array(json_writer_t *writer, const char *key)
+{
+    json_write_key(writer, key);
+    json_write_array_begin(writer);
+}
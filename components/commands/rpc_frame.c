@@ -0,0 +1,221 @@
+/**
+ * @file rpc_frame.c
+ * @brief COBS framing with CRC for binary (CBOR) RPC, and the transports' receive assembler
+ */
+
+#include "rpc_frame.h"
+#include <string.h>
+
+#define CRC16_INIT 0xFFFF
+#define COBS_CODE_FULL 0xFF // Block of RPC_FRAME_COBS_BLOCK bytes not followed by a zero
+
+uint16_t rpc_frame_crc16(uint16_t crc, const uint8_t *data, size_t len)
+{
+    // Byte-wise form of polynomial 0x1021: no table, and no per-bit loop on every byte of a frame
+    for (size_t i = 0; i < len; i++) {
+        uint8_t x = (uint8_t)(crc >> 8 ^ data[i]);
+        x ^= x >> 4;
+        crc = (uint16_t)(crc << 8 ^ (uint16_t)x << 12 ^ (uint16_t)x << 5 ^ x);
+    }
+    return crc;
+}
+
+bool rpc_frame_decode(uint8_t *buf, size_t len, size_t *payload_len)
+{
+    size_t in  = 0;
+    size_t out = 0;
+    while (in < len) {
+        uint8_t code = buf[in++];
+        size_t n     = (size_t)code - 1;
+        if (code == 0 || n > len - in) {
+            return false;
+        }
+        // Output trails input by at least the code byte, so decoding in place is safe
+        memmove(buf + out, buf + in, n);
+        out += n;
+        in += n;
+        if (code != COBS_CODE_FULL && in < len) {
+            buf[out++] = 0;
+        }
+    }
+
+    if (out < RPC_FRAME_CRC_SIZE) {
+        return false;
+    }
+    out -= RPC_FRAME_CRC_SIZE;
+    uint16_t crc = (uint16_t)(buf[out] << 8 | buf[out + 1]);
+    if (rpc_frame_crc16(CRC16_INIT, buf, out) != crc) {
+        return false;
+    }
+    *payload_len = out;
+    return true;
+}
+
+//==============================================================================
+// ENCODER
+//==============================================================================
+
+void rpc_frame_encoder_begin(rpc_frame_encoder_t *enc, json_sink_fn_t sink, void *ctx)
+{
+    enc->out[0]   = RPC_FRAME_DELIMITER;
+    enc->code_pos = 1;
+    enc->used     = 2;
+    enc->crc      = CRC16_INIT;
+    enc->sink     = sink;
+    enc->ctx      = ctx;
+}
+
+// Closes the open block and opens the next; completed blocks are sent once there is no
+// longer room for a full one behind them
+static void close_block(rpc_frame_encoder_t *enc, uint8_t code)
+{
+    enc->out[enc->code_pos] = code;
+    if (sizeof(enc->out) - enc->used < RPC_FRAME_COBS_BLOCK + 2) {
+        enc->sink((const char *)enc->out, enc->used, enc->ctx);
+        enc->used = 0;
+    }
+    enc->code_pos = enc->used++;
+}
+
+static void put_byte(rpc_frame_encoder_t *enc, uint8_t b)
+{
+    // Full blocks are closed lazily: one that ends the frame needs no zero after it
+    if (enc->used - enc->code_pos - 1 == RPC_FRAME_COBS_BLOCK) {
+        close_block(enc, COBS_CODE_FULL);
+    }
+    if (b == 0) {
+        close_block(enc, (uint8_t)(enc->used - enc->code_pos));
+    } else {
+        enc->out[enc->used++] = b;
+    }
+}
+
+void rpc_frame_encoder_write(const char *data, size_t len, void *ctx)
+{
+    rpc_frame_encoder_t *enc = ctx;
+    const uint8_t *bytes     = (const uint8_t *)data;
+    enc->crc                 = rpc_frame_crc16(enc->crc, bytes, len);
+    while (len > 0) {
+        // Copy the run of non-zero bytes that fits the open block in one go
+        size_t room = RPC_FRAME_COBS_BLOCK - (size_t)(enc->used - enc->code_pos - 1);
+        size_t run  = 0;
+        while (run < len && run < room && bytes[run] != 0) {
+            run++;
+        }
+        if (run == 0) {
+            put_byte(enc, *bytes);
+            run = 1;
+        } else {
+            memcpy(enc->out + enc->used, bytes, run);
+            enc->used = (uint16_t)(enc->used + run);
+        }
+        bytes += run;
+        len -= run;
+    }
+}
+
+void rpc_frame_encoder_end(rpc_frame_encoder_t *enc)
+{
+    put_byte(enc, (uint8_t)(enc->crc >> 8));
+    put_byte(enc, (uint8_t)enc->crc);
+    enc->out[enc->code_pos] = (uint8_t)(enc->used - enc->code_pos);
+    enc->out[enc->used++]   = RPC_FRAME_DELIMITER;
+    enc->sink((const char *)enc->out, enc->used, enc->ctx);
+    enc->used = 0;
+}
+
+//==============================================================================
+// RECEIVE ASSEMBLER
+//==============================================================================
+
+void rpc_rx_init(rpc_rx_t *rx, char *buf, size_t size, bool line_editing)
+{
+    memset(rx, 0, sizeof(*rx));
+    rx->buf          = buf;
+    rx->size         = size;
+    rx->line_editing = line_editing;
+}
+
+static void reset(rpc_rx_t *rx, bool binary)
+{
+    rx->len        = 0;
+    rx->binary     = binary;
+    rx->discarding = false;
+}
+
+static void frame_byte(rpc_rx_t *rx, uint8_t c, rpc_rx_fn_t on_message, void *ctx)
+{
+    if (c != RPC_FRAME_DELIMITER) {
+        if (rx->discarding) {
+            return;
+        }
+        if (rx->len < rx->size) {
+            rx->buf[rx->len++] = (char)c;
+        } else {
+            rx->discarding = true;
+        }
+        return;
+    }
+
+    if (rx->len == 0 && !rx->discarding) {
+        return; // Back-to-back delimiters: still waiting for the frame
+    }
+    size_t payload_len;
+    if (!rx->discarding && rpc_frame_decode((uint8_t *)rx->buf, rx->len, &payload_len)) {
+        on_message(rx->buf, payload_len, true, ctx);
+    } else {
+        rx->dropped++;
+    }
+    reset(rx, false);
+}
+
+static void line_byte(rpc_rx_t *rx, uint8_t c, rpc_rx_fn_t on_message, void *ctx)
+{
+    if (c == '\n' || c == '\r') {
+        if (!rx->discarding && rx->len > 0) {
+            rx->buf[rx->len] = '\0';
+            on_message(rx->buf, rx->len, false, ctx);
+        }
+        reset(rx, false);
+        return;
+    }
+    if (rx->discarding) {
+        return;
+    }
+
+    if (rx->line_editing) {
+        if (c == '\b' || c == 127) {
+            if (rx->len > 0) {
+                rx->len--;
+            }
+            return;
+        }
+        if (c < 32 || c > 126) {
+            return;
+        }
+    }
+    if (rx->len < rx->size - 1) {
+        rx->buf[rx->len++] = (char)c;
+    } else {
+        rx->discarding = true;
+        rx->dropped++;
+    }
+}
+
+void rpc_rx_feed(rpc_rx_t *rx, const uint8_t *data, size_t len, rpc_rx_fn_t on_message, void *ctx)
+{
+    for (size_t i = 0; i < len; i++) {
+        uint8_t c = data[i];
+        if (rx->binary) {
+            frame_byte(rx, c, on_message, ctx);
+        } else if (c == RPC_FRAME_DELIMITER) {
+            // JSON never contains a zero byte: a partial line before it was cut off by a binary client
+            if (rx->len > 0 && !rx->discarding) {
+                rx->dropped++;
+            }
+            reset(rx, true);
+        } else {
+            line_byte(rx, c, on_message, ctx);
+        }
+    }
+}
@@ -0,0 +1,434 @@
+/**
+ * @file rpc_schema.c
+ * @brief JSON-RPC method table, per-method param schemas and request binding
+ */
+
+#include "rpc_schema.h"
+#include "json_stream.h"
+#include <stdatomic.h>
+#include <string.h>
+
+#define FIELD_SIZE(st, field) sizeof(((st *)0)->field)
+
+#define PARAM_STRING(st, field, req)                                                                                   \
+    {.name = #field, .type = RPC_PARAM_STRING, .required = (req), .offset = offsetof(st, field),                       \
+     .size = FIELD_SIZE(st, field)}
+#define PARAM_STRING_MSG(st, field, req, msg)                                                                          \
+    {.name = #field, .type = RPC_PARAM_STRING, .required = (req), .offset = offsetof(st, field),                       \
+     .size = FIELD_SIZE(st, field), .error = (msg)}
+#define PARAM_INT(st, field, req, lo, hi)                                                                              \
+    {.name = #field, .type = RPC_PARAM_INT, .required = (req), .offset = offsetof(st, field), .min = (lo),             \
+     .max = (hi)}
+#define PARAM_INT_MSG(st, field, req, lo, hi, msg)                                                                     \
+    {.name = #field, .type = RPC_PARAM_INT, .required = (req), .offset = offsetof(st, field), .min = (lo),             \
+     .max = (hi), .error = (msg)}
+#define PARAM_BOOL(st, field, req)                                                                                     \
+    {.name = #field, .type = RPC_PARAM_BOOL, .required = (req), .offset = offsetof(st, field)}
+
+#define PARAM_COUNT(schema) (sizeof(schema) / sizeof((schema)[0]))
+#define WITH_PARAMS(method_name, schema, ...)                                                                          \
+    {.name = (method_name), .params = (schema), .param_count = PARAM_COUNT(schema), __VA_ARGS__}
+
+static const rpc_param_t general_set_params[GENERAL_SET_PARAM_COUNT] = {
+    [GENERAL_SET_NAME]              = PARAM_STRING(rpc_general_set_params_t, name, false),
+    [GENERAL_SET_MODE]              = PARAM_STRING_MSG(rpc_general_set_params_t, mode, false, "Invalid mode"),
+    [GENERAL_SET_CONTRAST]          = PARAM_INT(rpc_general_set_params_t, contrast, false, 0, UINT8_MAX),
+    [GENERAL_SET_BLUETOOTH]         = PARAM_BOOL(rpc_general_set_params_t, bluetooth, false),
+    [GENERAL_SET_BLUETOOTH_PAIRING] = PARAM_BOOL(rpc_general_set_params_t, bluetooth_pairing, false),
+    [GENERAL_SET_SLOT_ID] = PARAM_INT_MSG(rpc_general_set_params_t, slot_id, false, 1, 16, "Invalid slot_id (1-16)"),
+};
+
+#define POWER_PARAM_BOOL(field) PARAM_BOOL(rpc_power_set_params_t, field, false)
+#define POWER_PARAM_TIMEOUT(field) PARAM_INT(rpc_power_set_params_t, field, false, 0, INT32_MAX)
+
+static const rpc_param_t power_set_params[POWER_SET_PARAM_COUNT] = {
+    [POWER_SET_DISPLAY_SLEEP_ENABLED]    = POWER_PARAM_BOOL(display_sleep_enabled),
+    [POWER_SET_DISPLAY_SLEEP_TIMEOUT_MS] = POWER_PARAM_TIMEOUT(display_sleep_timeout_ms),
+    [POWER_SET_LIGHT_SLEEP_ENABLED]      = POWER_PARAM_BOOL(light_sleep_enabled),
+    [POWER_SET_LIGHT_SLEEP_TIMEOUT_MS]   = POWER_PARAM_TIMEOUT(light_sleep_timeout_ms),
+    [POWER_SET_DEEP_SLEEP_ENABLED]       = POWER_PARAM_BOOL(deep_sleep_enabled),
+    [POWER_SET_DEEP_SLEEP_TIMEOUT_MS]    = POWER_PARAM_TIMEOUT(deep_sleep_timeout_ms),
+};
+
+// Radio limits are checked by cmd_set_lora_config() against the band; these only keep the
+// values inside the config fields (frequency is stored in Hz)
+static const rpc_param_t lora_set_params[LORA_SET_PARAM_COUNT] = {
+    [LORA_SET_FREQUENCY_KHZ]     = PARAM_INT(rpc_lora_set_params_t, frequency_khz, false, 0, UINT32_MAX / 1000),
+    [LORA_SET_SPREADING_FACTOR]  = PARAM_INT(rpc_lora_set_params_t, spreading_factor, false, 0, UINT8_MAX),
+    [LORA_SET_BANDWIDTH_KHZ]     = PARAM_INT(rpc_lora_set_params_t, bandwidth_khz, false, 0, UINT16_MAX),
+    [LORA_SET_CODING_RATE]       = PARAM_INT(rpc_lora_set_params_t, coding_rate, false, 0, UINT8_MAX),
+    [LORA_SET_TX_POWER_DBM]      = PARAM_INT(rpc_lora_set_params_t, tx_power_dbm, false, INT8_MIN, INT8_MAX),
+    [LORA_SET_BAND_ID]           = PARAM_STRING(rpc_lora_set_params_t, band_id, false),
+    [LORA_SET_REGULATORY_DOMAIN] = PARAM_STRING_MSG(rpc_lora_set_params_t, regulatory_domain, false,
+                                                    "Invalid regulatory domain"),
+};
+
+static const rpc_param_t lora_key_set_params[] = {
+    PARAM_STRING_MSG(rpc_lora_key_set_params_t, aes_key, true, "Invalid aes_key (must be 64 hex chars)"),
+};
+
+static const rpc_param_t paired_pair_params[] = {
+    PARAM_STRING(rpc_paired_pair_params_t, name, true),
+    PARAM_STRING_MSG(rpc_paired_pair_params_t, mac, true, "Invalid MAC"),
+    PARAM_STRING_MSG(rpc_paired_pair_params_t, aes_key, true, "Invalid Key Length"),
+};
+
+static const rpc_param_t paired_unpair_params[] = {
+    PARAM_STRING_MSG(rpc_paired_unpair_params_t, mac, true, "Invalid MAC"),
+};
+
+static const rpc_param_t firmware_upgrade_params[] = {
+    PARAM_INT(rpc_firmware_upgrade_params_t, size, true, 1, INT32_MAX),
+    PARAM_STRING(rpc_firmware_upgrade_params_t, sha256, true),
+    PARAM_STRING(rpc_firmware_upgrade_params_t, signature, true),
+};
+
+// tools/generate_rpc_hash.py reads the names below at build time: keep each name the first
+// string literal of its entry
+static const rpc_method_info_t method_table[RPC_METHOD_COUNT] = {
+    [RPC_METHOD_PING]              = {.name = "ping"},
+    [RPC_METHOD_DEVICE_INFO]       = {.name = "device:info"},
+    [RPC_METHOD_GENERAL_GET]       = {.name = "general:get"},
+    [RPC_METHOD_GENERAL_SET]       = WITH_PARAMS("general:set", general_set_params),
+    [RPC_METHOD_POWER_GET]         = {.name = "power:get"},
+    [RPC_METHOD_POWER_SET]         = WITH_PARAMS("power:set", power_set_params),
+    [RPC_METHOD_POWER_STATS]       = {.name = "power:stats"},
+    [RPC_METHOD_SYSTEM_BOOT_TRACE] = {.name = "system:bootTrace"},
+    [RPC_METHOD_LORA_GET]          = {.name = "lora:get"},
+    [RPC_METHOD_LORA_SET]          = WITH_PARAMS("lora:set", lora_set_params),
+    [RPC_METHOD_LORA_KEY_GET]      = {.name = "lora:key:get", .flags = RPC_FLAG_AUTH},
+    [RPC_METHOD_LORA_KEY_SET]      = WITH_PARAMS("lora:key:set", lora_key_set_params, .flags = RPC_FLAG_AUTH),
+    [RPC_METHOD_PAIRED_LIST]       = {.name = "paired:list"},
+    [RPC_METHOD_PAIRED_PAIR]       = WITH_PARAMS("paired:pair", paired_pair_params, .flags = RPC_FLAG_AUTH),
+    [RPC_METHOD_PAIRED_UNPAIR]     = WITH_PARAMS("paired:unpair", paired_unpair_params, .flags = RPC_FLAG_AUTH),
+    [RPC_METHOD_DEVICE_RESET]      = {.name = "device:reset", .flags = RPC_FLAG_AUTH | RPC_FLAG_LONG_RUNNING},
+    // The image follows on the link's bulk path: cdc_ota on USB/UART, the OTA GATT service on BLE
+    // (ble_ota_handler.c); HTTP has its own upload endpoint
+    [RPC_METHOD_FIRMWARE_UPGRADE] = WITH_PARAMS("firmware:upgrade", firmware_upgrade_params,
+                                                .flags = RPC_FLAG_AUTH | RPC_FLAG_LONG_RUNNING,
+                                                .links = RPC_LINK_USB_CDC | RPC_LINK_UART | RPC_LINK_BLE),
+    // Same parameters: the checkpoint must be for this image (ota_checkpoint.h)
+    [RPC_METHOD_OTA_RESUME]       = WITH_PARAMS("ota:resume", firmware_upgrade_params,
+                                                .flags = RPC_FLAG_AUTH | RPC_FLAG_LONG_RUNNING,
+                                                .links = RPC_LINK_USB_CDC | RPC_LINK_UART | RPC_LINK_BLE),
+    [RPC_METHOD_RPC_LIST_METHODS] = {.name = "rpc:listMethods"},
+};
+
+// Generated from method_table: rpc_method_hash_seed, RPC_METHOD_HASH_SLOTS, rpc_method_hash_slots
+#include "rpc_method_hash.h"
+
+_Static_assert(sizeof(((rpc_params_t *)0)->present) * 8 >= LORA_SET_PARAM_COUNT, "present bitmask too narrow");
+
+// Registered methods: append-only. A slot is published (release) only once its entry is
+// written, so lookups need no lock
+#define REGISTERED_SLOTS (RPC_REGISTERED_METHODS_MAX * 2) // Power of two, at most half full
+#define SLOT_EMPTY 0                                      // Slots hold the registry index + 1
+
+static const rpc_method_info_t *s_registered[RPC_REGISTERED_METHODS_MAX];
+static atomic_uint_fast8_t s_registered_slots[REGISTERED_SLOTS];
+static atomic_size_t s_registered_count;
+
+uint32_t rpc_method_hash(uint32_t seed, const char *name, size_t len)
+{
+    uint32_t h = 2166136261u ^ seed; // FNV-1a
+    for (size_t i = 0; i < len; i++) {
+        h ^= (uint8_t)name[i];
+        h *= 16777619u;
+    }
+    // Final mix: the table index is the low bits, which FNV alone spreads poorly
+    h ^= h >> 16;
+    h *= 0x7feb352du;
+    h ^= h >> 15;
+    return h;
+}
+
+static bool name_is(const rpc_method_info_t *info, const char *name, size_t len)
+{
+    return strlen(info->name) == len && memcmp(info->name, name, len) == 0;
+}
+
+static rpc_method_t find_registered(const char *name, size_t len)
+{
+    uint32_t slot = rpc_method_hash(0, name, len);
+    for (int probe = 0; probe < REGISTERED_SLOTS; probe++, slot++) {
+        unsigned index = atomic_load_explicit(&s_registered_slots[slot % REGISTERED_SLOTS], memory_order_acquire);
+        if (index == SLOT_EMPTY) {
+            break;
+        }
+        if (name_is(s_registered[index - 1], name, len)) {
+            return (rpc_method_t)(RPC_METHOD_COUNT + index - 1);
+        }
+    }
+    return RPC_METHOD_NONE;
+}
+
+rpc_method_t rpc_method_find(const char *name, size_t len)
+{
+    uint8_t m = rpc_method_hash_slots[rpc_method_hash(rpc_method_hash_seed, name, len) & (RPC_METHOD_HASH_SLOTS - 1)];
+    if (m != RPC_METHOD_NONE && name_is(&method_table[m], name, len)) {
+        return (rpc_method_t)m;
+    }
+    return find_registered(name, len);
+}
+
+size_t rpc_method_count(void)
+{
+    return RPC_METHOD_COUNT + atomic_load_explicit(&s_registered_count, memory_order_acquire);
+}
+
+// The params struct starts with the present mask and must fit the dispatcher's rpc_params_t
+static bool schema_fits(const rpc_method_info_t *info)
+{
+    if (info->param_count > sizeof(((rpc_params_t *)0)->present) * 8 || (info->param_count && !info->params)) {
+        return false;
+    }
+    for (int i = 0; i < info->param_count; i++) {
+        const rpc_param_t *param = &info->params[i];
+        size_t size              = param->type == RPC_PARAM_STRING ? param->size
+                                   : param->type == RPC_PARAM_INT  ? sizeof(int32_t)
+                                                                   : sizeof(bool);
+        if (!param->name || size == 0 || param->offset < sizeof(uint32_t) ||
+            param->offset + size > sizeof(rpc_params_t)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+esp_err_t rpc_register_method(const rpc_method_info_t *info, rpc_method_t *id)
+{
+    size_t len = info && info->name ? strlen(info->name) : 0;
+    if (len == 0 || len > RPC_METHOD_NAME_MAX || !schema_fits(info)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (rpc_method_find(info->name, len) != RPC_METHOD_NONE) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    size_t index = atomic_load_explicit(&s_registered_count, memory_order_relaxed);
+    if (index >= RPC_REGISTERED_METHODS_MAX) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    s_registered[index] = info;
+    uint32_t slot       = rpc_method_hash(0, info->name, len);
+    while (atomic_load_explicit(&s_registered_slots[slot % REGISTERED_SLOTS], memory_order_relaxed) != SLOT_EMPTY) {
+        slot++;
+    }
+    atomic_store_explicit(&s_registered_slots[slot % REGISTERED_SLOTS], index + 1, memory_order_release);
+    atomic_store_explicit(&s_registered_count, index + 1, memory_order_release);
+    if (id) {
+        *id = (rpc_method_t)(RPC_METHOD_COUNT + index);
+    }
+    return ESP_OK;
+}
+
+const rpc_method_info_t *rpc_method_info(rpc_method_t method)
+{
+    if ((unsigned)method < RPC_METHOD_COUNT) {
+        return &method_table[method];
+    }
+    size_t index = (unsigned)method - RPC_METHOD_COUNT;
+    return index < atomic_load_explicit(&s_registered_count, memory_order_acquire) ? s_registered[index] : NULL;
+}
+
+static rpc_method_t find_method(const json_token_t *name)
+{
+    // Unescaped (or CBOR) text, so the hash sees the same bytes as the generator did
+    char buf[RPC_METHOD_NAME_MAX + 1];
+    size_t len;
+    if (!json_token_copy(name, buf, sizeof(buf), &len)) {
+        return RPC_METHOD_NONE;
+    }
+    return rpc_method_find(buf, len);
+}
+
+// Raw text of the value tok starts, which the reader has just consumed
+static void value_span(const json_reader_t *reader, const json_token_t *tok, const char **start, size_t *len)
+{
+    *start = tok->start;
+    *len   = (size_t)(reader->buf + reader->pos - tok->start);
+}
+
+int rpc_parse_envelope(const char *json, size_t len, rpc_envelope_t *env)
+{
+    memset(env, 0, sizeof(*env));
+    env->method = RPC_METHOD_NONE;
+
+    json_reader_t reader;
+    json_token_t tok;
+    json_reader_init(&reader, json, len);
+
+    json_tok_type_t type = json_next(&reader, &tok);
+    if (type == JSON_TOK_ERROR) {
+        return JSONRPC_PARSE_ERROR;
+    }
+    bool is_object = (type == JSON_TOK_OBJECT_BEGIN);
+
+    json_token_t method = {.type = JSON_TOK_ERROR};
+    if (is_object) {
+        while ((type = json_next(&reader, &tok)) == JSON_TOK_KEY) {
+            json_token_t key = tok;
+            json_token_t value;
+            if (json_next(&reader, &value) == JSON_TOK_ERROR || !json_skip(&reader, &value)) {
+                return JSONRPC_PARSE_ERROR;
+            }
+
+            if (json_token_equals(&key, "method")) {
+                method = value;
+            } else if (json_token_equals(&key, "id")) {
+                value_span(&reader, &value, &env->id, &env->id_len);
+            } else if (json_token_equals(&key, "params")) {
+                value_span(&reader, &value, &env->params, &env->params_len);
+            }
+        }
+        if (type != JSON_TOK_OBJECT_END) {
+            return JSONRPC_PARSE_ERROR;
+        }
+    } else if (!json_skip(&reader, &tok)) {
+        return JSONRPC_PARSE_ERROR;
+    }
+    if (json_next(&reader, &tok) != JSON_TOK_END) {
+        return JSONRPC_PARSE_ERROR;
+    }
+
+    // Like the cJSON path, the id is only echoed once the request is known to be well formed
+    if (!is_object || method.type != JSON_TOK_STRING) {
+        env->id = NULL;
+        return JSONRPC_INVALID_REQUEST;
+    }
+    env->method = find_method(&method);
+    return env->method == RPC_METHOD_NONE ? JSONRPC_METHOD_NOT_FOUND : 0;
+}
+
+int rpc_parse_envelope_cbor(const char *cbor, size_t len, rpc_envelope_t *env)
+{
+    memset(env, 0, sizeof(*env));
+    env->method = RPC_METHOD_NONE;
+    env->cbor   = true;
+
+    json_reader_t reader;
+    json_token_t tok;
+    json_reader_init_cbor(&reader, cbor, len);
+
+    json_tok_type_t type = json_next(&reader, &tok);
+    if (type == JSON_TOK_ERROR) {
+        return JSONRPC_PARSE_ERROR;
+    }
+    bool is_array = (type == JSON_TOK_ARRAY_BEGIN);
+
+    json_token_t method = {.type = JSON_TOK_ERROR};
+    int items           = 0;
+    if (is_array) {
+        json_token_t value;
+        while ((type = json_next(&reader, &value)) != JSON_TOK_ARRAY_END) {
+            if (type == JSON_TOK_ERROR || !json_skip(&reader, &value)) {
+                return JSONRPC_PARSE_ERROR;
+            }
+            if (items == 0) {
+                value_span(&reader, &value, &env->id, &env->id_len);
+            } else if (items == 1) {
+                method = value;
+            } else if (items == 2) {
+                value_span(&reader, &value, &env->params, &env->params_len);
+            }
+            items++;
+        }
+    } else if (!json_skip(&reader, &tok)) {
+        return JSONRPC_PARSE_ERROR;
+    }
+    if (json_next(&reader, &tok) != JSON_TOK_END) {
+        return JSONRPC_PARSE_ERROR;
+    }
+
+    if (!is_array || items < 2 || items > 3 || method.type != JSON_TOK_STRING) {
+        env->id = NULL;
+        return JSONRPC_INVALID_REQUEST;
+    }
+    env->method = find_method(&method);
+    return env->method == RPC_METHOD_NONE ? JSONRPC_METHOD_NOT_FOUND : 0;
+}
+
+static const rpc_param_t *find_param(const rpc_method_info_t *info, const json_token_t *key, int *index)
+{
+    for (int i = 0; i < info->param_count; i++) {
+        if (json_token_equals(key, info->params[i].name)) {
+            *index = i;
+            return &info->params[i];
+        }
+    }
+    return NULL;
+}
+
+static bool bind_value(const rpc_param_t *param, const json_token_t *value, uint8_t *field)
+{
+    switch (param->type) {
+        case RPC_PARAM_STRING:
+            return value->type == JSON_TOK_STRING && json_token_copy(value, (char *)field, param->size, NULL);
+        case RPC_PARAM_INT: {
+            int64_t v;
+            if (!json_token_int(value, &v) || v < param->min || v > param->max) {
+                return false;
+            }
+            int32_t v32 = (int32_t)v;
+            memcpy(field, &v32, sizeof(v32));
+            return true;
+        }
+        case RPC_PARAM_BOOL:
+            if (value->type != JSON_TOK_TRUE && value->type != JSON_TOK_FALSE) {
+                return false;
+            }
+            *(bool *)field = (value->type == JSON_TOK_TRUE);
+            return true;
+    }
+    return false;
+}
+
+int rpc_bind_params(const rpc_envelope_t *env, rpc_params_t *params, int *bad_param)
+{
+    memset(params, 0, sizeof(*params));
+    *bad_param = RPC_PARAM_NONE;
+
+    const rpc_method_info_t *info = rpc_method_info(env->method);
+    if (!info || !info->params) {
+        return 0;
+    }
+    if (!env->params) {
+        return JSONRPC_INVALID_PARAMS;
+    }
+
+    // The envelope pass already validated this span
+    json_reader_t reader;
+    json_token_t tok;
+    if (env->cbor) {
+        json_reader_init_cbor(&reader, env->params, env->params_len);
+    } else {
+        json_reader_init(&reader, env->params, env->params_len);
+    }
+    if (json_next(&reader, &tok) != JSON_TOK_OBJECT_BEGIN) {
+        return JSONRPC_INVALID_PARAMS;
+    }
+
+    while (json_next(&reader, &tok) == JSON_TOK_KEY) {
+        json_token_t value;
+        int index;
+        const rpc_param_t *param = find_param(info, &tok, &index);
+        json_next(&reader, &value);
+        if (!param) {
+            json_skip(&reader, &value);
+            continue;
+        }
+        if (!bind_value(param, &value, (uint8_t *)params + param->offset)) {
+            *bad_param = index;
+            return JSONRPC_INVALID_PARAMS;
+        }
+        params->present |= 1UL << index;
+    }
+
+    for (int i = 0; i < info->param_count; i++) {
+        if (info->params[i].required && !rpc_param_present(params, i)) {
+            *bad_param = RPC_PARAM_NONE;
+            return JSONRPC_INVALID_PARAMS;
+        }
+    }
+    return 0;
+}
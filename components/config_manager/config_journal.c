@@ -0,0 +1,134 @@
+/**
+ * @file config_journal.c
+ * @brief Double-slot config records and write coalescing
+ */
+
+#include "config_journal.h"
+#include <string.h>
+
+#define CRC32_POLY 0xEDB88320u
+
+static uint32_t crc32_update(uint32_t crc, const uint8_t *data, size_t len)
+{
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (CRC32_POLY & (0u - (crc & 1u)));
+        }
+    }
+    return ~crc;
+}
+
+uint32_t config_journal_record_crc(const config_journal_record_t *record)
+{
+    const uint8_t header[6] = {
+        (uint8_t)(record->generation),       (uint8_t)(record->generation >> 8), (uint8_t)(record->generation >> 16),
+        (uint8_t)(record->generation >> 24), (uint8_t)(record->length),          (uint8_t)(record->length >> 8),
+    };
+    uint32_t crc = crc32_update(0, header, sizeof(header));
+    size_t len   = record->length <= CONFIG_JOURNAL_MAX_PAYLOAD ? record->length : CONFIG_JOURNAL_MAX_PAYLOAD;
+    return crc32_update(crc, record->payload, len);
+}
+
+static bool record_valid(const config_journal_record_t *record, size_t stored, size_t size)
+{
+    return stored == CONFIG_JOURNAL_HEADER_SIZE + size && record->length == size && record->generation != 0 &&
+           record->crc == config_journal_record_crc(record);
+}
+
+esp_err_t config_journal_open(config_journal_t *journal, const config_journal_backend_t *backend, void *data,
+                              size_t size)
+{
+    if (!journal || !backend || !backend->read || !data || size > CONFIG_JOURNAL_MAX_PAYLOAD) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    journal->generation  = 0;
+    journal->active_slot = 0;
+
+    for (uint8_t slot = 0; slot < CONFIG_JOURNAL_SLOTS; slot++) {
+        config_journal_record_t record;
+        size_t stored = sizeof(record);
+        if (backend->read(backend->ctx, slot, &record, &stored) != ESP_OK || !record_valid(&record, stored, size)) {
+            continue; // Missing, torn or from another layout
+        }
+        if (record.generation > journal->generation) {
+            journal->generation  = record.generation;
+            journal->active_slot = slot;
+            memcpy(data, record.payload, size);
+        }
+    }
+
+    return journal->generation != 0 ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t config_journal_write(config_journal_t *journal, const config_journal_backend_t *backend, const void *data,
+                               size_t size)
+{
+    if (!journal || !backend || !backend->write || !data || size > CONFIG_JOURNAL_MAX_PAYLOAD) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Never overwrite the newest durable record
+    uint8_t slot = journal->generation != 0 ? (uint8_t)((journal->active_slot + 1) % CONFIG_JOURNAL_SLOTS) : 0;
+
+    config_journal_record_t record = {
+        .generation = journal->generation + 1,
+        .length     = (uint16_t)size,
+    };
+    memcpy(record.payload, data, size);
+    record.crc = config_journal_record_crc(&record);
+
+    esp_err_t ret = backend->write(backend->ctx, slot, &record, CONFIG_JOURNAL_HEADER_SIZE + size);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    journal->generation  = record.generation;
+    journal->active_slot = slot;
+    return ESP_OK;
+}
+
+void config_coalescer_init(config_coalescer_t *coalescer, uint32_t quiet_ms, uint32_t max_delay_ms)
+{
+    memset(coalescer, 0, sizeof(*coalescer));
+    coalescer->quiet_ms     = quiet_ms;
+    coalescer->max_delay_ms = max_delay_ms < quiet_ms ? quiet_ms : max_delay_ms;
+}
+
+void config_coalescer_mark(config_coalescer_t *coalescer, uint32_t sections, uint32_t now_ms)
+{
+    if (!sections) {
+        return;
+    }
+    if (!coalescer->dirty) {
+        coalescer->first_change_ms = now_ms;
+    }
+    coalescer->dirty |= sections;
+    coalescer->last_change_ms = now_ms;
+}
+
+uint32_t config_coalescer_due_in(const config_coalescer_t *coalescer, uint32_t now_ms)
+{
+    if (!coalescer->dirty) {
+        return UINT32_MAX;
+    }
+
+    uint32_t quiet_for = now_ms - coalescer->last_change_ms;
+    uint32_t dirty_for = now_ms - coalescer->first_change_ms;
+    if (quiet_for >= coalescer->quiet_ms || dirty_for >= coalescer->max_delay_ms) {
+        return 0;
+    }
+
+    uint32_t until_quiet = coalescer->quiet_ms - quiet_for;
+    uint32_t until_max   = coalescer->max_delay_ms - dirty_for;
+    return until_quiet < until_max ? until_quiet : until_max;
+}
+
+uint32_t config_coalescer_take(config_coalescer_t *coalescer)
+{
+    uint32_t dirty   = coalescer->dirty;
+    coalescer->dirty = 0;
+    return dirty;
+}
@@ -1,15 +1,22 @@
 #include "config_manager.h"
+#include "config_journal.h"
+#include "config_snapshot.h"
 #include "config_validation.h"
 #include "nvs_flash.h"
 #include "nvs.h"
 #include "esp_log.h"
 #include "esp_mac.h"
 #include "esp_system.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include "freertos/task.h"
+#include "sdkconfig.h"
+#include "task_config.h"
+#include <stdlib.h>
 #include <string.h>
 
-// static const char *TAG = "config_manager";
+static const char *TAG = "config_manager";
 
 // NVS namespaces
 #define NVS_NAMESPACE_GENERAL "general"
@@ -17,16 +24,41 @@
 #define NVS_NAMESPACE_LORA "lora"
 #define NVS_NAMESPACE_REGISTRY "registry"
 
-// Cache
-static general_config_t cached_general;
-static power_config_t cached_power;
-static lora_config_t cached_lora;
+// Legacy registry blob cache; general/power/LoRa are served from config_snapshot
 static device_registry_config_t cached_registry;
-static bool cache_valid[4] = {false, false, false, false};
-
-// Transaction state
+static bool registry_cache_valid = false;
+
+// Per-device registry (dev_XXXX records, sqXXXX journals), registered by device_registry_init()
+static const config_registry_ops_t *registry_ops;
+
+// Serializes writers, the coalescer and transaction state
+static SemaphoreHandle_t writer_lock;
+
+#define PUBLISH_RETRIES 10
+
+// Deferred persistence: set_*() publish to RAM and mark sections dirty, persist_task writes
+// each dirty section once after the quiet period (journal keys "cfga"/"cfgb" per namespace)
+#define JOURNAL_KEY_A "cfga"
+#define JOURNAL_KEY_B "cfgb"
+#define LEGACY_KEY "config" // Pre-journal single blob, read once for migration
+
+typedef struct {
+    const char *nvs_namespace;
+    uint32_t section; // CONFIG_SECTION_*
+    size_t offset;    // Section within config_snapshot_t
+    size_t size;
+    const void *defaults;
+} persist_section_t;
+
+static config_coalescer_t coalescer;
+static config_journal_t journals[3];
+static config_journal_backend_t journal_backends[3];
+static TaskHandle_t persist_task_handle;
+static SemaphoreHandle_t flush_lock; // One flush at a time (task, shutdown handler, callers)
+static volatile bool nvs_erased;     // Factory reset done: nothing may be written back before the restart
+
+// Transaction state: dirty sections are held back until commit
 static bool transaction_active = false;
-static nvs_handle_t transaction_handles[4];
 
 // Default configurations
 static const general_config_t default_general = {
@@ -58,154 +90,286 @@ static const lora_config_t default_lora = {
     .aes_key = {0}
 };
 
-esp_err_t config_manager_init(void) {
-    esp_err_t ret = nvs_flash_init();
-    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
-        ESP_ERROR_CHECK(nvs_flash_erase());
-        ret = nvs_flash_init();
+static const persist_section_t persist_sections[3] = {
+    {NVS_NAMESPACE_GENERAL, CONFIG_SECTION_GENERAL, offsetof(config_snapshot_t, general), sizeof(general_config_t),
+     &default_general},
+    {NVS_NAMESPACE_POWER, CONFIG_SECTION_POWER, offsetof(config_snapshot_t, power), sizeof(power_config_t),
+     &default_power},
+    {NVS_NAMESPACE_LORA, CONFIG_SECTION_LORA, offsetof(config_snapshot_t, lora), sizeof(lora_config_t),
+     &default_lora},
+};
+
+_Static_assert(sizeof(general_config_t) <= CONFIG_JOURNAL_MAX_PAYLOAD, "general config exceeds journal record");
+_Static_assert(sizeof(power_config_t) <= CONFIG_JOURNAL_MAX_PAYLOAD, "power config exceeds journal record");
+_Static_assert(sizeof(lora_config_t) <= CONFIG_JOURNAL_MAX_PAYLOAD, "LoRa config exceeds journal record");
+
+static uint32_t now_ms(void) {
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+static void writer_take(void) {
+    // Before config_manager_init() boot is single-threaded
+    if (writer_lock) {
+        xSemaphoreTake(writer_lock, portMAX_DELAY);
     }
-    return ret;
 }
 
-esp_err_t config_manager_get_general(general_config_t *config) {
-    if (cache_valid[0]) {
-        *config = cached_general;
-        return ESP_OK;
+static void writer_give(void) {
+    if (writer_lock) {
+        xSemaphoreGive(writer_lock);
     }
+}
 
+static esp_err_t journal_nvs_read(void *ctx, uint8_t slot, void *buf, size_t *len) {
     nvs_handle_t handle;
-    esp_err_t ret = nvs_open(NVS_NAMESPACE_GENERAL, NVS_READONLY, &handle);
-    if (ret != ESP_OK) {
-        *config = default_general;
-        return ESP_OK;
-    }
+    esp_err_t ret = nvs_open((const char *)ctx, NVS_READONLY, &handle);
+    if (ret != ESP_OK) return ret;
 
-    size_t size = sizeof(general_config_t);
-    ret = nvs_get_blob(handle, "config", config, &size);
+    ret = nvs_get_blob(handle, slot ? JOURNAL_KEY_B : JOURNAL_KEY_A, buf, len);
     nvs_close(handle);
-
-    if (ret != ESP_OK) {
-        *config = default_general;
-    } else {
-        cached_general = *config;
-        cache_valid[0] = true;
-    }
-    return ESP_OK;
+    return ret;
 }
 
-esp_err_t config_manager_set_general(const general_config_t *config) {
-    esp_err_t ret = config_validate_general(config);
-    if (ret != ESP_OK) return ret;
-
+static esp_err_t journal_nvs_write(void *ctx, uint8_t slot, const void *buf, size_t len) {
     nvs_handle_t handle;
-    ret = nvs_open(NVS_NAMESPACE_GENERAL, NVS_READWRITE, &handle);
+    esp_err_t ret = nvs_open((const char *)ctx, NVS_READWRITE, &handle);
     if (ret != ESP_OK) return ret;
 
-    ret = nvs_set_blob(handle, "config", config, sizeof(general_config_t));
-    if (ret == ESP_OK && !transaction_active) {
+    ret = nvs_set_blob(handle, slot ? JOURNAL_KEY_B : JOURNAL_KEY_A, buf, len);
+    if (ret == ESP_OK) {
         ret = nvs_commit(handle);
     }
     nvs_close(handle);
+    return ret;
+}
 
+// Read a legacy section blob from NVS, falling back to defaults
+static void load_section(const char *ns, void *config, size_t size, const void *defaults) {
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(ns, NVS_READONLY, &handle);
     if (ret == ESP_OK) {
-        cached_general = *config;
-        cache_valid[0] = true;
+        size_t len = size;
+        ret = nvs_get_blob(handle, LEGACY_KEY, config, &len);
+        nvs_close(handle);
+    }
+    if (ret != ESP_OK) {
+        memcpy(config, defaults, size);
     }
-    return ret;
 }
 
-esp_err_t config_manager_get_power(power_config_t *config) {
-    if (cache_valid[1]) {
-        *config = cached_power;
-        return ESP_OK;
+// Call with writer_lock held; slots only stay busy while readers hold short pins
+static esp_err_t publish(const general_config_t *general, const power_config_t *power, const lora_config_t *lora) {
+    esp_err_t ret = config_snapshot_publish(general, power, lora);
+    for (int i = 0; ret == ESP_ERR_NO_MEM && i < PUBLISH_RETRIES; i++) {
+        vTaskDelay(1);
+        ret = config_snapshot_publish(general, power, lora);
     }
-
-    nvs_handle_t handle;
-    esp_err_t ret = nvs_open(NVS_NAMESPACE_POWER, NVS_READONLY, &handle);
     if (ret != ESP_OK) {
-        *config = default_power;
-        return ESP_OK;
+        ESP_LOGE(TAG, "Failed to publish config snapshot: %s", esp_err_to_name(ret));
     }
+    return ret;
+}
 
-    size_t size = sizeof(power_config_t);
-    ret = nvs_get_blob(handle, "config", config, &size);
-    nvs_close(handle);
+// Load the durable state of all sections into a new snapshot; call with writer_lock held
+static esp_err_t publish_from_nvs(void) {
+    config_snapshot_t loaded;
+    for (int i = 0; i < 3; i++) {
+        const persist_section_t *section = &persist_sections[i];
+        uint8_t *data                    = (uint8_t *)&loaded + section->offset;
+        if (config_journal_open(&journals[i], &journal_backends[i], data, section->size) == ESP_ERR_NOT_FOUND) {
+            // Migrated on the first write: the journal record is written next to the legacy blob
+            load_section(section->nvs_namespace, data, section->size, section->defaults);
+        }
+    }
+    return publish(&loaded.general, &loaded.power, &loaded.lora);
+}
 
-    if (ret != ESP_OK) {
-        *config = default_power;
-    } else {
-        cached_power = *config;
-        cache_valid[1] = true;
+// Publish a changed section to RAM and schedule its write
+static esp_err_t stage_section(const general_config_t *general, const power_config_t *power,
+                               const lora_config_t *lora, uint32_t section) {
+    if (config_snapshot_version() == 0) return ESP_ERR_INVALID_STATE;
+
+    writer_take();
+    esp_err_t ret = publish(general, power, lora);
+    if (ret == ESP_OK) {
+        config_coalescer_mark(&coalescer, section, now_ms());
     }
-    return ESP_OK;
+    writer_give();
+
+    if (ret == ESP_OK && persist_task_handle) {
+        xTaskNotifyGive(persist_task_handle);
+    }
+    return ret;
 }
 
-esp_err_t config_manager_set_power(const power_config_t *config) {
-    esp_err_t ret = config_validate_power(config);
-    if (ret != ESP_OK) return ret;
+static esp_err_t flush_sections(void) {
+    if (!flush_lock || nvs_erased) return ESP_OK; // Not initialized: nothing staged
 
-    nvs_handle_t handle;
-    ret = nvs_open(NVS_NAMESPACE_POWER, NVS_READWRITE, &handle);
-    if (ret != ESP_OK) return ret;
+    xSemaphoreTake(flush_lock, portMAX_DELAY);
 
-    ret = nvs_set_blob(handle, "config", config, sizeof(power_config_t));
-    if (ret == ESP_OK && !transaction_active) {
-        ret = nvs_commit(handle);
+    writer_take();
+    uint32_t dirty = config_coalescer_take(&coalescer);
+    writer_give();
+
+    esp_err_t result = ESP_OK;
+    for (int i = 0; i < 3 && dirty; i++) {
+        const persist_section_t *section = &persist_sections[i];
+        if (!(dirty & section->section)) continue;
+
+        // Newest values, even if they changed again since the dirty bit was taken
+        uint8_t data[CONFIG_JOURNAL_MAX_PAYLOAD];
+        const config_snapshot_t *snapshot = config_snapshot_acquire();
+        memcpy(data, (const uint8_t *)snapshot + section->offset, section->size);
+        config_snapshot_release(snapshot);
+
+        esp_err_t ret = config_journal_write(&journals[i], &journal_backends[i], data, section->size);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to persist %s config: %s", section->nvs_namespace, esp_err_to_name(ret));
+            writer_take();
+            config_coalescer_mark(&coalescer, section->section, now_ms());
+            writer_give();
+            result = ret;
+        } else {
+            ESP_LOGD(TAG, "Persisted %s config (generation %lu)", section->nvs_namespace,
+                     (unsigned long)journals[i].generation);
+        }
     }
-    nvs_close(handle);
 
-    if (ret == ESP_OK) {
-        cached_power = *config;
-        cache_valid[1] = true;
+    xSemaphoreGive(flush_lock);
+    return result;
+}
+
+static void persist_task(void *arg) {
+    (void)arg;
+    while (1) {
+        writer_take();
+        uint32_t due_in = transaction_active ? UINT32_MAX : config_coalescer_due_in(&coalescer, now_ms());
+        writer_give();
+
+        if (due_in == 0) {
+            flush_sections();
+            continue;
+        }
+        // Woken early by every change; otherwise sleep until the quiet period ends
+        ulTaskNotifyTake(pdTRUE, due_in == UINT32_MAX ? portMAX_DELAY : pdMS_TO_TICKS(due_in) + 1);
     }
-    return ret;
 }
 
-esp_err_t config_manager_get_lora(lora_config_t *config) {
-    if (cache_valid[2]) {
-        *config = cached_lora;
-        return ESP_OK;
+static void persist_shutdown_handler(void) {
+    config_manager_flush();
+}
+
+esp_err_t config_manager_init(void) {
+    esp_err_t ret = nvs_flash_init();
+    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        ret = nvs_flash_init();
     }
+    if (ret != ESP_OK) return ret;
 
-    nvs_handle_t handle;
-    esp_err_t ret = nvs_open(NVS_NAMESPACE_LORA, NVS_READONLY, &handle);
-    if (ret != ESP_OK) {
-        *config = default_lora;
-        return ESP_OK;
+    if (!writer_lock) {
+        writer_lock = xSemaphoreCreateMutex();
+        flush_lock  = xSemaphoreCreateMutex();
+        if (!writer_lock || !flush_lock) return ESP_ERR_NO_MEM;
     }
 
-    size_t size = sizeof(lora_config_t);
-    ret = nvs_get_blob(handle, "config", config, &size);
-    nvs_close(handle);
+    for (int i = 0; i < 3; i++) {
+        journal_backends[i].read  = journal_nvs_read;
+        journal_backends[i].write = journal_nvs_write;
+        journal_backends[i].ctx   = (void *)persist_sections[i].nvs_namespace;
+    }
+    config_coalescer_init(&coalescer, CONFIG_LORACUE_CONFIG_PERSIST_QUIET_MS,
+                          CONFIG_LORACUE_CONFIG_PERSIST_MAX_DELAY_MS);
 
-    if (ret != ESP_OK) {
-        *config = default_lora;
+    // The only flash read of these sections; readers use the snapshot from here on
+    writer_take();
+    ret = publish_from_nvs();
+    writer_give();
+    if (ret != ESP_OK) return ret;
+
+    if (!persist_task_handle) {
+        if (xTaskCreate(persist_task, "cfg_persist", TASK_STACK_SIZE_MEDIUM, NULL, TASK_PRIORITY_LOW,
+                        &persist_task_handle) != pdPASS) {
+            persist_task_handle = NULL;
+            ESP_LOGE(TAG, "Failed to create persist task");
+            return ESP_ERR_NO_MEM;
+        }
+        // Pending changes survive orderly restarts (OTA, config reboot)
+        esp_register_shutdown_handler(persist_shutdown_handler);
+    }
+    return ESP_OK;
+}
+
+esp_err_t config_manager_flush(void) {
+    writer_take();
+    bool held_back = transaction_active;
+    writer_give();
+    return held_back ? ESP_OK : flush_sections();
+}
+
+esp_err_t config_manager_subscribe(config_snapshot_cb_t cb, void *ctx) {
+    writer_take();
+    esp_err_t ret = config_snapshot_subscribe(cb, ctx);
+    writer_give();
+    return ret;
+}
+
+esp_err_t config_manager_unsubscribe(config_snapshot_cb_t cb, void *ctx) {
+    writer_take();
+    esp_err_t ret = config_snapshot_unsubscribe(cb, ctx);
+    writer_give();
+    return ret;
+}
+
+esp_err_t config_manager_get_general(general_config_t *config) {
+    const config_snapshot_t *snapshot = config_snapshot_acquire();
+    if (snapshot) {
+        *config = snapshot->general;
+        config_snapshot_release(snapshot);
     } else {
-        cached_lora = *config;
-        cache_valid[2] = true;
+        load_section(NVS_NAMESPACE_GENERAL, config, sizeof(*config), &default_general);
     }
     return ESP_OK;
 }
 
-esp_err_t config_manager_set_lora(const lora_config_t *config) {
-    esp_err_t ret = config_validate_lora(config);
+esp_err_t config_manager_set_general(const general_config_t *config) {
+    esp_err_t ret = config_validate_general(config);
     if (ret != ESP_OK) return ret;
+    return stage_section(config, NULL, NULL, CONFIG_SECTION_GENERAL);
+}
 
-    nvs_handle_t handle;
-    ret = nvs_open(NVS_NAMESPACE_LORA, NVS_READWRITE, &handle);
+esp_err_t config_manager_get_power(power_config_t *config) {
+    const config_snapshot_t *snapshot = config_snapshot_acquire();
+    if (snapshot) {
+        *config = snapshot->power;
+        config_snapshot_release(snapshot);
+    } else {
+        load_section(NVS_NAMESPACE_POWER, config, sizeof(*config), &default_power);
+    }
+    return ESP_OK;
+}
+
+esp_err_t config_manager_set_power(const power_config_t *config) {
+    esp_err_t ret = config_validate_power(config);
     if (ret != ESP_OK) return ret;
+    return stage_section(NULL, config, NULL, CONFIG_SECTION_POWER);
+}
 
-    ret = nvs_set_blob(handle, "config", config, sizeof(lora_config_t));
-    if (ret == ESP_OK && !transaction_active) {
-        ret = nvs_commit(handle);
+esp_err_t config_manager_get_lora(lora_config_t *config) {
+    const config_snapshot_t *snapshot = config_snapshot_acquire();
+    if (snapshot) {
+        *config = snapshot->lora;
+        config_snapshot_release(snapshot);
+    } else {
+        load_section(NVS_NAMESPACE_LORA, config, sizeof(*config), &default_lora);
     }
-    nvs_close(handle);
+    return ESP_OK;
+}
 
-    if (ret == ESP_OK) {
-        cached_lora = *config;
-        cache_valid[2] = true;
-    }
-    return ret;
+esp_err_t config_manager_set_lora(const lora_config_t *config) {
+    esp_err_t ret = config_validate_lora(config);
+    if (ret != ESP_OK) return ret;
+    return stage_section(NULL, NULL, config, CONFIG_SECTION_LORA);
 }
 
 esp_err_t config_manager_get_regulatory_domain(char *domain, size_t max_len) {
@@ -232,7 +396,7 @@ esp_err_t config_manager_set_regulatory_domain(const char *domain) {
 }
 
 esp_err_t config_manager_get_device_registry(device_registry_config_t *config) {
-    if (cache_valid[3]) {
+    if (registry_cache_valid) {
         *config = cached_registry;
         return ESP_OK;
     }
@@ -245,14 +409,14 @@ esp_err_t config_manager_get_device_registry(device_registry_config_t *config) {
     }
 
     size_t size = sizeof(device_registry_config_t);
-    ret = nvs_get_blob(handle, "config", config, &size);
+    ret = nvs_get_blob(handle, LEGACY_KEY, config, &size);
     nvs_close(handle);
 
     if (ret != ESP_OK) {
         memset(config, 0, sizeof(device_registry_config_t));
     } else {
         cached_registry = *config;
-        cache_valid[3] = true;
+        registry_cache_valid = true;
     }
     return ESP_OK;
 }
@@ -265,7 +429,7 @@ esp_err_t config_manager_set_device_registry(const device_registry_config_t *con
     ret = nvs_open(NVS_NAMESPACE_REGISTRY, NVS_READWRITE, &handle);
     if (ret != ESP_OK) return ret;
 
-    ret = nvs_set_blob(handle, "config", config, sizeof(device_registry_config_t));
+    ret = nvs_set_blob(handle, LEGACY_KEY, config, sizeof(device_registry_config_t));
     if (ret == ESP_OK && !transaction_active) {
         ret = nvs_commit(handle);
     }
@@ -273,63 +437,57 @@ esp_err_t config_manager_set_device_registry(const device_registry_config_t *con
 
     if (ret == ESP_OK) {
         cached_registry = *config;
-        cache_valid[3] = true;
+        registry_cache_valid = true;
     }
     return ret;
 }
 
-esp_err_t config_manager_begin_transaction(void) {
-    if (transaction_active) return ESP_ERR_INVALID_STATE;
+esp_err_t config_manager_register_registry(const config_registry_ops_t *ops) {
+    if (!ops || !ops->count || !ops->list || !ops->clear) return ESP_ERR_INVALID_ARG;
+    registry_ops = ops;
+    return ESP_OK;
+}
 
-    const char* namespaces[] = {NVS_NAMESPACE_GENERAL, NVS_NAMESPACE_POWER, 
-                               NVS_NAMESPACE_LORA, NVS_NAMESPACE_REGISTRY};
-    
-    for (int i = 0; i < 4; i++) {
-        esp_err_t ret = nvs_open(namespaces[i], NVS_READWRITE, &transaction_handles[i]);
-        if (ret != ESP_OK) {
-            for (int j = 0; j < i; j++) {
-                nvs_close(transaction_handles[j]);
-            }
-            return ret;
-        }
-    }
-    
+esp_err_t config_manager_begin_transaction(void) {
+    writer_take();
+    esp_err_t ret = transaction_active ? ESP_ERR_INVALID_STATE : ESP_OK;
     transaction_active = true;
-    return ESP_OK;
+    writer_give();
+    return ret;
 }
 
 esp_err_t config_manager_commit_transaction(void) {
-    if (!transaction_active) return ESP_ERR_INVALID_STATE;
-
-    esp_err_t ret = ESP_OK;
-    for (int i = 0; i < 4; i++) {
-        esp_err_t commit_ret = nvs_commit(transaction_handles[i]);
-        if (commit_ret != ESP_OK) ret = commit_ret;
-        nvs_close(transaction_handles[i]);
-    }
-    
+    writer_take();
+    bool active = transaction_active;
     transaction_active = false;
-    return ret;
+    writer_give();
+    if (!active) return ESP_ERR_INVALID_STATE;
+
+    return flush_sections();
 }
 
 esp_err_t config_manager_rollback_transaction(void) {
-    if (!transaction_active) return ESP_ERR_INVALID_STATE;
-
-    for (int i = 0; i < 4; i++) {
-        nvs_close(transaction_handles[i]);
+    writer_take();
+    if (!transaction_active) {
+        writer_give();
+        return ESP_ERR_INVALID_STATE;
     }
-    
-    // Invalidate cache to force reload
-    memset(cache_valid, false, sizeof(cache_valid));
     transaction_active = false;
-    return ESP_OK;
+
+    // Drop staged changes and republish what is durable
+    config_coalescer_take(&coalescer);
+    registry_cache_valid = false;
+    esp_err_t ret = config_snapshot_version() != 0 ? publish_from_nvs() : ESP_OK;
+    writer_give();
+    return ret;
 }
 
 esp_err_t config_manager_validate_all(void) {
     general_config_t general;
     power_config_t power;
     lora_config_t lora;
-    device_registry_config_t registry;
+
+    if (!registry_ops) return ESP_ERR_INVALID_STATE;
 
     esp_err_t ret = config_manager_get_general(&general);
     if (ret != ESP_OK) return ret;
@@ -340,13 +498,22 @@ esp_err_t config_manager_validate_all(void) {
     ret = config_manager_get_lora(&lora);
     if (ret != ESP_OK) return ret;
     
-    ret = config_manager_get_device_registry(&registry);
-    if (ret != ESP_OK) return ret;
+    // Registry capacity is a Kconfig option, so the copy goes on the heap rather than the caller's stack
+    size_t count = registry_ops->count();
+    paired_device_t *devices = calloc(count ? count : 1, sizeof(*devices));
+    if (!devices) return ESP_ERR_NO_MEM;
 
-    return config_validate_cross_config(&general, &power, &lora, &registry);
+    ret = registry_ops->list(devices, count, &count);
+    if (ret == ESP_OK) {
+        ret = config_validate_cross_config(&general, &power, &lora, devices, count);
+    }
+    free(devices);
+    return ret;
 }
 
 esp_err_t config_manager_reset_all(void) {
+    if (!registry_ops) return ESP_ERR_INVALID_STATE;
+
     esp_err_t ret = config_manager_set_general(&default_general);
     if (ret != ESP_OK) return ret;
     
@@ -356,8 +523,8 @@ esp_err_t config_manager_reset_all(void) {
     ret = config_manager_set_lora(&default_lora);
     if (ret != ESP_OK) return ret;
 
-    device_registry_config_t empty_registry = {0};
-    return config_manager_set_device_registry(&empty_registry);
+    registry_cache_valid = false;
+    return registry_ops->clear();
 }
 
 const char *device_mode_to_string(device_mode_t mode) {
@@ -380,11 +547,21 @@ uint16_t config_manager_get_device_id(void) {
 esp_err_t config_manager_factory_reset(void) {
     ESP_LOGW("config_manager", "Factory reset initiated - erasing all NVS data");
 
+    // Wait out a journal write in progress and hold off the persist task until the restart;
+    // nothing pending may be written back after the erase
+    if (flush_lock) xSemaphoreTake(flush_lock, portMAX_DELAY);
+    writer_take();
+    config_coalescer_take(&coalescer);
+    writer_give();
+
     esp_err_t ret = nvs_flash_erase();
     if (ret != ESP_OK) {
+        if (flush_lock) xSemaphoreGive(flush_lock);
         ESP_LOGE("config_manager", "Failed to erase NVS: %s", esp_err_to_name(ret));
         return ret;
     }
+    // The shutdown handler flushes from this task, which still holds flush_lock
+    nvs_erased = true;
 
     ESP_LOGI("config_manager", "NVS erased successfully, rebooting...");
     vTaskDelay(pdMS_TO_TICKS(500));
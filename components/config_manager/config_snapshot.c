@@ -0,0 +1,139 @@
+/**
+ * @file config_snapshot.c
+ * @brief Immutable, versioned configuration snapshots for lock-free readers
+ *
+ * A reader pins a slot by incrementing its reader count and then re-checking that the slot
+ * is still current; if a publish moved on in between it unpins and retries. The writer only
+ * reuses slots that are not current and have no pins, so a pinned snapshot never changes.
+ */
+
+#include "config_snapshot.h"
+#include <stdbool.h>
+#include <string.h>
+
+typedef struct {
+    config_snapshot_cb_t cb;
+    void *ctx;
+} subscriber_t;
+
+static config_snapshot_t slots[CONFIG_SNAPSHOT_SLOTS];
+static _Atomic(config_snapshot_t *) current;
+static subscriber_t subscribers[CONFIG_SNAPSHOT_MAX_SUBSCRIBERS];
+static uint32_t next_version = 1;
+
+const config_snapshot_t *config_snapshot_acquire(void)
+{
+    while (1) {
+        config_snapshot_t *snapshot = atomic_load(&current);
+        if (!snapshot) {
+            return NULL;
+        }
+
+        atomic_fetch_add(&snapshot->readers, 1);
+        if (atomic_load(&current) == snapshot) {
+            return snapshot;
+        }
+        // Replaced before the pin landed; the writer may already be refilling it
+        atomic_fetch_sub(&snapshot->readers, 1);
+    }
+}
+
+void config_snapshot_release(const config_snapshot_t *snapshot)
+{
+    if (snapshot) {
+        atomic_fetch_sub(&((config_snapshot_t *)snapshot)->readers, 1);
+    }
+}
+
+uint32_t config_snapshot_version(void)
+{
+    const config_snapshot_t *snapshot = config_snapshot_acquire();
+    uint32_t version                  = snapshot ? snapshot->version : 0;
+    config_snapshot_release(snapshot);
+    return version;
+}
+
+static config_snapshot_t *find_free_slot(const config_snapshot_t *live)
+{
+    for (int i = 0; i < CONFIG_SNAPSHOT_SLOTS; i++) {
+        if (&slots[i] != live && atomic_load(&slots[i].readers) == 0) {
+            return &slots[i];
+        }
+    }
+    return NULL;
+}
+
+esp_err_t config_snapshot_publish(const general_config_t *general, const power_config_t *power,
+                                  const lora_config_t *lora)
+{
+    // Writers are serialized, so current cannot change under us and needs no pin
+    config_snapshot_t *live = atomic_load(&current);
+    if (!live && (!general || !power || !lora)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    config_snapshot_t *next = find_free_slot(live);
+    if (!next) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Readers that pin this slot from now on fail the re-check until it is published
+    next->general = general ? *general : live->general;
+    next->power   = power ? *power : live->power;
+    next->lora    = lora ? *lora : live->lora;
+    next->version = next_version++;
+    if (next_version == 0) {
+        next_version = 1;
+    }
+
+    uint32_t changed = CONFIG_SECTION_ALL;
+    if (live) {
+        changed = 0;
+        if (memcmp(&next->general, &live->general, sizeof(next->general)) != 0) {
+            changed |= CONFIG_SECTION_GENERAL;
+        }
+        if (memcmp(&next->power, &live->power, sizeof(next->power)) != 0) {
+            changed |= CONFIG_SECTION_POWER;
+        }
+        if (memcmp(&next->lora, &live->lora, sizeof(next->lora)) != 0) {
+            changed |= CONFIG_SECTION_LORA;
+        }
+    }
+
+    atomic_store(&current, next);
+
+    for (int i = 0; i < CONFIG_SNAPSHOT_MAX_SUBSCRIBERS; i++) {
+        if (subscribers[i].cb) {
+            subscribers[i].cb(next, changed, subscribers[i].ctx);
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t config_snapshot_subscribe(config_snapshot_cb_t cb, void *ctx)
+{
+    if (!cb) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    for (int i = 0; i < CONFIG_SNAPSHOT_MAX_SUBSCRIBERS; i++) {
+        if (!subscribers[i].cb) {
+            subscribers[i].cb  = cb;
+            subscribers[i].ctx = ctx;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+esp_err_t config_snapshot_unsubscribe(config_snapshot_cb_t cb, void *ctx)
+{
+    for (int i = 0; i < CONFIG_SNAPSHOT_MAX_SUBSCRIBERS; i++) {
+        if (subscribers[i].cb == cb && subscribers[i].ctx == ctx) {
+            subscribers[i].cb  = NULL;
+            subscribers[i].ctx = NULL;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
@@ -75,6 +75,20 @@ esp_err_t config_validate_lora(const lora_config_t *config) {
     return ESP_OK;
 }
 
+esp_err_t config_validate_paired_devices(const paired_device_t *devices, size_t device_count) {
+    if (!devices && device_count > 0) return ESP_ERR_INVALID_ARG;
+    
+    for (size_t i = 0; i < device_count; i++) {
+        if (strnlen(devices[i].device_name, sizeof(devices[i].device_name)) == 0 ||
+            strnlen(devices[i].device_name, sizeof(devices[i].device_name)) >= 32) {
+            ESP_LOGE(TAG, "Invalid device name at index %zu", i);
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    
+    return ESP_OK;
+}
+
 esp_err_t config_validate_device_registry(const device_registry_config_t *config) {
     if (!config) return ESP_ERR_INVALID_ARG;
     
@@ -83,21 +97,14 @@ esp_err_t config_validate_device_registry(const device_registry_config_t *config
         return ESP_ERR_INVALID_ARG;
     }
     
-    for (size_t i = 0; i < config->device_count; i++) {
-        if (strlen(config->devices[i].device_name) == 0 || 
-            strlen(config->devices[i].device_name) >= 32) {
-            ESP_LOGE(TAG, "Invalid device name at index %zu", i);
-            return ESP_ERR_INVALID_ARG;
-        }
-    }
-    
-    return ESP_OK;
+    return config_validate_paired_devices(config->devices, config->device_count);
 }
 
 esp_err_t config_validate_cross_config(const general_config_t *general,
                                        const power_config_t *power,
                                        const lora_config_t *lora,
-                                       const device_registry_config_t *registry) {
+                                       const paired_device_t *devices,
+                                       size_t device_count) {
     esp_err_t ret;
     
     ret = config_validate_general(general);
@@ -109,11 +116,11 @@ esp_err_t config_validate_cross_config(const general_config_t *general,
     ret = config_validate_lora(lora);
     if (ret != ESP_OK) return ret;
     
-    ret = config_validate_device_registry(registry);
+    ret = config_validate_paired_devices(devices, device_count);
     if (ret != ESP_OK) return ret;
     
     // Cross-validation rules
-    if (general->device_mode == DEVICE_MODE_PRESENTER && registry->device_count == 0) {
+    if (general->device_mode == DEVICE_MODE_PRESENTER && device_count == 0) {
         ESP_LOGW(TAG, "Presenter mode with no paired devices");
     }
     
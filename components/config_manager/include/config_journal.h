@@ -0,0 +1,125 @@
+/**
+ * @file config_journal.h
+ * @brief Power-loss safe config records and write coalescing
+ *
+ * CONTEXT: Every config_manager_set_*() used to open, write and commit NVS synchronously, so
+ *          scrolling contrast or TX power with the encoder cost a flash write per detent and
+ *          blocked the UI task
+ * FORMAT: Two alternating slots per section {generation, length, crc32, payload}; the newest
+ *         valid slot wins, so a write torn by power loss falls back to the previous record
+ * PURPOSE: The coalescer tracks which sections changed and when, so a background task
+ *          writes each dirty section once after the user stops changing it
+ * USAGE: Pure C with pluggable storage; config_manager binds it to NVS, tests/host to a
+ *        simulated flash
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CONFIG_JOURNAL_SLOTS 2
+#define CONFIG_JOURNAL_MAX_PAYLOAD 128
+
+/**
+ * @brief Stored record; only the header and length payload bytes are written
+ */
+typedef struct {
+    uint32_t generation; ///< Monotonic write counter, 0 = never written
+    uint16_t length;     ///< Payload bytes
+    uint16_t reserved;   ///< Written as 0
+    uint32_t crc;        ///< CRC32 over generation, length and payload
+    uint8_t payload[CONFIG_JOURNAL_MAX_PAYLOAD];
+} config_journal_record_t;
+
+#define CONFIG_JOURNAL_HEADER_SIZE offsetof(config_journal_record_t, payload)
+
+/**
+ * @brief Storage backend for the slots of one journal
+ *
+ * read() gets the buffer capacity in *len and returns the stored size in it.
+ */
+typedef struct {
+    esp_err_t (*read)(void *ctx, uint8_t slot, void *buf, size_t *len);
+    esp_err_t (*write)(void *ctx, uint8_t slot, const void *buf, size_t len);
+    void *ctx;
+} config_journal_backend_t;
+
+/**
+ * @brief Journal state (RAM)
+ */
+typedef struct {
+    uint32_t generation; ///< Generation of newest durable record (0 = empty)
+    uint8_t active_slot; ///< Slot holding the newest durable record
+} config_journal_t;
+
+/**
+ * @brief Restore the newest valid record of the expected size
+ *
+ * Records of another size (struct layout changed by a firmware update) are ignored.
+ *
+ * @param data Output payload, untouched unless ESP_OK is returned
+ * @return ESP_OK if data was restored, ESP_ERR_NOT_FOUND if no valid record exists (still usable),
+ *         ESP_ERR_INVALID_ARG for a size above CONFIG_JOURNAL_MAX_PAYLOAD
+ */
+esp_err_t config_journal_open(config_journal_t *journal, const config_journal_backend_t *backend, void *data,
+                              size_t size);
+
+/**
+ * @brief Write a new record to the inactive slot
+ *
+ * On failure the previous record stays authoritative and journal state is unchanged.
+ */
+esp_err_t config_journal_write(config_journal_t *journal, const config_journal_backend_t *backend, const void *data,
+                               size_t size);
+
+/**
+ * @brief Compute record CRC over header fields and payload
+ */
+uint32_t config_journal_record_crc(const config_journal_record_t *record);
+
+/**
+ * @brief Dirty tracking for deferred writes
+ *
+ * Sections are bits (CONFIG_SECTION_*). A flush is due once no section changed for quiet_ms,
+ * or max_delay_ms after the oldest unflushed change so continuous edits still get saved.
+ * Times are wrapping milliseconds from the caller's clock.
+ */
+typedef struct {
+    uint32_t quiet_ms;
+    uint32_t max_delay_ms;
+    uint32_t dirty;           ///< Sections changed since their last successful write
+    uint32_t first_change_ms; ///< Oldest unflushed change
+    uint32_t last_change_ms;  ///< Newest change
+} config_coalescer_t;
+
+void config_coalescer_init(config_coalescer_t *coalescer, uint32_t quiet_ms, uint32_t max_delay_ms);
+
+/**
+ * @brief Record that sections changed in RAM
+ */
+void config_coalescer_mark(config_coalescer_t *coalescer, uint32_t sections, uint32_t now_ms);
+
+/**
+ * @brief Milliseconds until a flush is due
+ *
+ * @return 0 if due now, UINT32_MAX if nothing is dirty
+ */
+uint32_t config_coalescer_due_in(const config_coalescer_t *coalescer, uint32_t now_ms);
+
+/**
+ * @brief Take the dirty sections for writing and mark everything clean
+ *
+ * Re-mark sections whose write failed so they are retried.
+ */
+uint32_t config_coalescer_take(config_coalescer_t *coalescer);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "config_snapshot.h"
 #include "config_types.h"
 #include "esp_err.h"
 
@@ -9,9 +10,33 @@ extern "C" {
 
 /**
  * @brief Initialize configuration manager
+ *
+ * Loads general, power and LoRa config from NVS once and publishes the first snapshot;
+ * the getters below copy from the current snapshot and never touch flash afterwards.
+ * Hot paths should read config_snapshot_acquire() directly instead of copying.
+ *
+ * The set_*() functions for these sections only publish to RAM; a low-priority task writes
+ * each changed section once after CONFIG_LORACUE_CONFIG_PERSIST_QUIET_MS without changes
+ * (power-loss safe double-buffered records). Pending changes are flushed on orderly restart.
  */
 esp_err_t config_manager_init(void);
 
+/**
+ * @brief Write pending general, power and LoRa changes to flash now
+ *
+ * Blocks the caller for the flash writes. Call before deep sleep or anything that powers
+ * down without esp_restart(). A no-op while a transaction is open.
+ */
+esp_err_t config_manager_flush(void);
+
+/**
+ * @brief Get notified after every config_manager_set_*() that publishes a snapshot
+ *
+ * The callback runs in the writing task; see config_snapshot_cb_t.
+ */
+esp_err_t config_manager_subscribe(config_snapshot_cb_t cb, void *ctx);
+esp_err_t config_manager_unsubscribe(config_snapshot_cb_t cb, void *ctx);
+
 /**
  * @brief General configuration operations
  */
@@ -37,23 +62,57 @@ esp_err_t config_manager_get_regulatory_domain(char *domain, size_t max_len);
 esp_err_t config_manager_set_regulatory_domain(const char *domain);
 
 /**
- * @brief Device registry operations
+ * @brief Legacy single-blob device registry operations
+ *
+ * The device_registry component now stores one NVS record per device and
+ * migrates this blob on first boot; prefer the device_registry API.
  */
 esp_err_t config_manager_get_device_registry(device_registry_config_t *config);
 esp_err_t config_manager_set_device_registry(const device_registry_config_t *config);
 
+/**
+ * @brief Paired-device store behind config_manager_validate_all() and config_manager_reset_all()
+ *
+ * device_registry depends on config_manager, so it registers itself at init instead of being called directly.
+ */
+typedef struct {
+    size_t (*count)(void);
+    esp_err_t (*list)(paired_device_t *devices, size_t max_devices, size_t *count);
+    esp_err_t (*clear)(void); ///< Remove every device with its NVS records
+} config_registry_ops_t;
+
+/**
+ * @brief Register the paired-device store (called by device_registry_init())
+ *
+ * @param ops Operations; must stay valid for the lifetime of the program
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if an operation is missing
+ */
+esp_err_t config_manager_register_registry(const config_registry_ops_t *ops);
+
 /**
  * @brief Atomic transaction support
+ *
+ * Changes made inside a transaction are held in RAM until commit writes them; rollback
+ * discards them and republishes the stored configuration.
  */
 esp_err_t config_manager_begin_transaction(void);
 esp_err_t config_manager_commit_transaction(void);
 esp_err_t config_manager_rollback_transaction(void);
 
 /**
- * @brief Validation
+ * @brief Validate general, power and LoRa config against each other and the paired devices
+ *
+ * @return ESP_ERR_INVALID_STATE before the device registry is registered
  */
 esp_err_t config_manager_validate_all(void);
 
+/**
+ * @brief Restore default general, power and LoRa config and unpair all devices
+ *
+ * @return ESP_ERR_INVALID_STATE before the device registry is registered
+ */
+esp_err_t config_manager_reset_all(void);
+
 /**
  * @brief Get string representation of device mode
  */
@@ -0,0 +1,109 @@
+/**
+ * @file config_snapshot.h
+ * @brief Immutable, versioned configuration snapshots for lock-free readers
+ *
+ * CONTEXT: config_manager_get_general() ran on every received packet, copied the struct and
+ *          could fall through to an NVS read after a set; the caches were unsynchronized statics
+ * PURPOSE: Publish general/power/LoRa config as one immutable snapshot. Readers pin the current
+ *          snapshot with two atomic operations (no locks, no flash); writers fill a free slot
+ *          and swap it in with one atomic store, then notify subscribers
+ * USAGE: Readers: s = config_snapshot_acquire(); use s->general...; config_snapshot_release(s).
+ *        Cache derived values and recompute only when s->version changes.
+ *        Writers (config_manager only) must be serialized by the caller.
+ */
+
+#pragma once
+
+#include "config_types.h"
+#include "esp_err.h"
+#include <stdatomic.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CONFIG_SNAPSHOT_SLOTS 4       ///< One current, the rest free or still pinned by readers
+#define CONFIG_SNAPSHOT_MAX_SUBSCRIBERS 8
+
+/**
+ * @brief Config sections, as a bitmask of what a publish changed
+ */
+#define CONFIG_SECTION_GENERAL (1U << 0)
+#define CONFIG_SECTION_POWER (1U << 1)
+#define CONFIG_SECTION_LORA (1U << 2)
+#define CONFIG_SECTION_ALL (CONFIG_SECTION_GENERAL | CONFIG_SECTION_POWER | CONFIG_SECTION_LORA)
+
+/**
+ * @brief One published configuration; never modified while it can be pinned
+ */
+typedef struct {
+    uint32_t version; ///< Increments with every publish, never 0 once published
+    general_config_t general;
+    power_config_t power;
+    lora_config_t lora;
+    atomic_uint readers; ///< Internal: pins held on this slot
+} config_snapshot_t;
+
+/**
+ * @brief Called by the writer after a snapshot is published
+ *
+ * Runs in the writer's task with the writer lock held: keep it short and do not write
+ * config from it. The snapshot stays valid for the duration of the call.
+ *
+ * @param changed CONFIG_SECTION_* bits that differ from the previous snapshot
+ */
+typedef void (*config_snapshot_cb_t)(const config_snapshot_t *snapshot, uint32_t changed, void *ctx);
+
+/**
+ * @brief Pin the current snapshot
+ *
+ * Lock-free and wait-free unless a publish races with the call, in which case it retries.
+ *
+ * @return Current snapshot, NULL before the first publish
+ */
+const config_snapshot_t *config_snapshot_acquire(void);
+
+/**
+ * @brief Unpin a snapshot from config_snapshot_acquire() (NULL is ignored)
+ */
+void config_snapshot_release(const config_snapshot_t *snapshot);
+
+/**
+ * @brief Version of the current snapshot, 0 before the first publish
+ */
+uint32_t config_snapshot_version(void);
+
+/**
+ * @brief Publish a new snapshot
+ *
+ * Sections passed as NULL are carried over from the current snapshot; the first publish
+ * must provide all of them. Writers must be serialized by the caller.
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if a section is missing on the first publish,
+ *         ESP_ERR_NO_MEM if every other slot is still pinned by readers (retry later)
+ */
+esp_err_t config_snapshot_publish(const general_config_t *general, const power_config_t *power,
+                                  const lora_config_t *lora);
+
+/**
+ * @brief Register a callback for published snapshots
+ *
+ * Serialized with publishes like a writer; components use config_manager_subscribe().
+ *
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if the subscriber table is full
+ */
+esp_err_t config_snapshot_subscribe(config_snapshot_cb_t cb, void *ctx);
+
+/**
+ * @brief Remove a callback registered with the same cb and ctx
+ *
+ * Serialized with publishes like a writer; components use config_manager_unsubscribe().
+ *
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if it was not registered
+ */
+esp_err_t config_snapshot_unsubscribe(config_snapshot_cb_t cb, void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
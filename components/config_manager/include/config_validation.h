@@ -23,7 +23,12 @@ esp_err_t config_validate_power(const power_config_t *config);
 esp_err_t config_validate_lora(const lora_config_t *config);
 
 /**
- * @brief Validate device registry
+ * @brief Validate paired devices
+ */
+esp_err_t config_validate_paired_devices(const paired_device_t *devices, size_t device_count);
+
+/**
+ * @brief Validate legacy single-blob device registry
  */
 esp_err_t config_validate_device_registry(const device_registry_config_t *config);
 
@@ -33,7 +38,8 @@ esp_err_t config_validate_device_registry(const device_registry_config_t *config
 esp_err_t config_validate_cross_config(const general_config_t *general,
                                        const power_config_t *power,
                                        const lora_config_t *lora,
-                                       const device_registry_config_t *registry);
+                                       const paired_device_t *devices,
+                                       size_t device_count);
 
 #ifdef __cplusplus
 }
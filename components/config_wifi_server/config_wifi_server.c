@@ -15,11 +15,21 @@
 #include "esp_timer.h"
 #include "esp_wifi.h"
 #include "config_manager.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "lwip/sockets.h"
 #include "lora_driver.h"
+#include "lora_fuota_service.h"
 #include "ota_engine.h"
+#include "system_events.h"
 #include "version.h"
+#include "web_assets.h"
+#include "ws_telemetry.h"
+#include <fcntl.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 static const char *TAG = "CONFIG_WIFI_SERVER";
 
@@ -30,27 +40,55 @@ static const char *TAG = "CONFIG_WIFI_SERVER";
 #define HTTPD_STACK_SIZE 12288
 #define OTA_BUFFER_SIZE 4096
 #define RESTART_DELAY_MS 500
+#define WEB_ROOT "/storage"
+#define FILE_BUFFER_SIZE 8192 // A few TCP segments per read instead of one per KB
+#define HEADER_VALUE_SIZE 256
+#define TELEMETRY_TICK_MS 50 // Send granularity; frames per client are limited by its interval
+#define TELEMETRY_QUERY_SIZE 32
+#define FUOTA_UPLOAD_PATH WEB_ROOT "/fuota_tx.bin" // Deleted by lora_fuota_service once broadcast
+#define FUOTA_QUERY_SIZE (LORA_FUOTA_SIGNATURE_SIZE * 2 + 16)
 
 static httpd_handle_t server = NULL;
 static esp_netif_t *ap_netif = NULL;
 static bool server_running   = false;
+static web_assets_t s_assets; // Empty for web UI images built without scripts/precompress_web.py
+static uint8_t s_file_buf[FILE_BUFFER_SIZE]; // httpd runs one handler at a time
+
+// Live telemetry: sys_events writes the state, the httpd task snapshots it and owns the clients
+static ws_telemetry_state_t s_telemetry;
+static ws_telemetry_client_t s_ws_clients[CONFIG_LORACUE_TELEMETRY_MAX_CLIENTS];
+static char s_ws_frame[WS_TELEMETRY_FRAME_MAX];
+static SemaphoreHandle_t s_telemetry_mutex             = NULL;
+static esp_event_handler_instance_t s_telemetry_events = NULL;
+static esp_timer_handle_t s_telemetry_timer            = NULL;
+static volatile int s_ws_client_count                  = 0;
+static volatile bool s_telemetry_queued                = false; // One work item in the httpd queue at a time
+static bool s_ota_reported_active                      = false;
+
+// Commands API bridge: each request carries its own route, so concurrent handlers never
+// answer each other's requests
+static void http_response_write(const char *data, size_t len, void *ctx)
+{
+    httpd_resp_send_chunk((httpd_req_t *)ctx, data, len);
+}
 
-// Commands API bridge
-static httpd_req_t *s_current_req = NULL;
+static void http_response_end(bool binary, void *ctx)
+{
+    (void)binary; // HTTP only executes JSON
+    httpd_resp_send_chunk((httpd_req_t *)ctx, NULL, 0);
+}
 
-static void http_response_callback(const char *response)
+static void http_execute(httpd_req_t *req, const char *command)
 {
-    if (!s_current_req || !response)
-        return;
-    httpd_resp_sendstr(s_current_req, response);
+    const command_route_t route = {
+        .write = http_response_write, .end = http_response_end, .ctx = req, .link = RPC_LINK_HTTP};
+    httpd_resp_set_type(req, "application/json");
+    commands_execute(command, &route);
 }
 
 static esp_err_t commands_api_handle_get(httpd_req_t *req, const char *command)
 {
-    httpd_resp_set_type(req, "application/json");
-    s_current_req = req;
-    commands_execute(command, http_response_callback);
-    s_current_req = NULL;
+    http_execute(req, command);
     return ESP_OK;
 }
 
@@ -67,10 +105,7 @@ static esp_err_t commands_api_handle_post(httpd_req_t *req, const char *command_
     char command[COMMAND_BUFFER_SIZE];
     snprintf(command, sizeof(command), command_fmt, content);
 
-    httpd_resp_set_type(req, "application/json");
-    s_current_req = req;
-    commands_execute(command, http_response_callback);
-    s_current_req = NULL;
+    http_execute(req, command);
     return ESP_OK;
 }
 
@@ -94,54 +129,114 @@ static void generate_wifi_credentials(char *ssid, size_t ssid_len, char *passwor
     password[8] = '\0';
 }
 
-// Serve static files from LittleFS
+static void load_asset_index(void)
+{
+    web_assets_free(&s_assets);
+
+    struct stat st;
+    if (stat(WEB_ROOT WEB_ASSETS_INDEX, &st) != 0) {
+        ESP_LOGW(TAG, "No %s: serving the web UI without compression or caching", WEB_ASSETS_INDEX);
+        return;
+    }
+    char *text = malloc(st.st_size + 1);
+    FILE *file = text ? fopen(WEB_ROOT WEB_ASSETS_INDEX, "r") : NULL;
+    if (!file) {
+        free(text);
+        ESP_LOGE(TAG, "Failed to read %s", WEB_ASSETS_INDEX);
+        return;
+    }
+    size_t len = fread(text, 1, st.st_size, file);
+    fclose(file);
+    text[len] = '\0';
+
+    esp_err_t ret = web_assets_parse(&s_assets, text);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Invalid %s: %s", WEB_ASSETS_INDEX, esp_err_to_name(ret));
+        return;
+    }
+    ESP_LOGI(TAG, "Web UI: %zu assets indexed", s_assets.count);
+}
+
+// Stream a file with large direct reads; no stdio buffer in between
+static esp_err_t send_file(httpd_req_t *req, const char *path)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        ESP_LOGW(TAG, "File not found: %s", path);
+        httpd_resp_send_404(req);
+        return ESP_FAIL;
+    }
+
+    esp_err_t ret = ESP_OK;
+    ssize_t n;
+    while ((n = read(fd, s_file_buf, sizeof(s_file_buf))) > 0) {
+        ret = httpd_resp_send_chunk(req, (const char *)s_file_buf, n);
+        if (ret != ESP_OK) {
+            break; // Client went away
+        }
+    }
+    close(fd);
+    if (ret == ESP_OK) {
+        ret = httpd_resp_send_chunk(req, NULL, 0);
+    }
+    return ret;
+}
+
+// Indexed asset: pre-compressed variant by Accept-Encoding, 304 while the client's copy is current
+static esp_err_t serve_asset(httpd_req_t *req, const web_asset_t *asset)
+{
+    char header[HEADER_VALUE_SIZE];
+    bool has_header = httpd_req_get_hdr_value_str(req, "Accept-Encoding", header, sizeof(header)) == ESP_OK;
+    web_encoding_t encoding = web_assets_pick_encoding(asset, has_header ? header : NULL);
+
+    char etag[WEB_ASSETS_ETAG_MAX];
+    web_assets_format_etag(asset, encoding, etag);
+
+    // httpd keeps the pointers until the response is sent; all of these outlive it
+    httpd_resp_set_type(req, web_assets_content_type(asset->path));
+    httpd_resp_set_hdr(req, "Cache-Control", web_assets_cache_control(asset->path));
+    httpd_resp_set_hdr(req, "ETag", etag);
+    if (asset->variants) {
+        httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+    }
+
+    has_header = httpd_req_get_hdr_value_str(req, "If-None-Match", header, sizeof(header)) == ESP_OK;
+    if (has_header && web_assets_etag_match(header, etag)) {
+        httpd_resp_set_status(req, "304 Not Modified");
+        return httpd_resp_send(req, NULL, 0);
+    }
+
+    const char *content_encoding = web_assets_content_encoding(encoding);
+    if (content_encoding) {
+        httpd_resp_set_hdr(req, "Content-Encoding", content_encoding);
+    }
+
+    char path[PATH_BUFFER_SIZE];
+    snprintf(path, sizeof(path), WEB_ROOT "%s%s", asset->path, web_assets_suffix(encoding));
+    return send_file(req, path);
+}
+
+// Serve static files from LittleFS (images without an asset index)
 static esp_err_t serve_static_file(httpd_req_t *req, const char *filepath)
 {
     ESP_LOGI(TAG, "Attempting to serve: %s", filepath);
-    FILE *file = fopen(filepath, "r");
+    char index_path[PATH_BUFFER_SIZE];
+    struct stat st;
 
     // If file not found and path doesn't end with .html/.js/.css, try index.html
-    if (!file) {
+    if (stat(filepath, &st) != 0) {
         const char *ext = strrchr(filepath, '.');
         if (!ext || (strcmp(ext, ".html") != 0 && strcmp(ext, ".js") != 0 && strcmp(ext, ".css") != 0 &&
                      strcmp(ext, ".json") != 0)) {
-            char index_path[PATH_BUFFER_SIZE];
             snprintf(index_path, sizeof(index_path), "%s%sindex.html", filepath,
                      (filepath[strlen(filepath) - 1] == '/') ? "" : "/");
-            file = fopen(index_path, "r");
-            if (file) {
-                ESP_LOGI(TAG, "Serving index: %s", index_path);
-            }
+            ESP_LOGI(TAG, "Serving index: %s", index_path);
+            filepath = index_path;
         }
     }
 
-    if (!file) {
-        ESP_LOGW(TAG, "File not found: %s", filepath);
-        httpd_resp_send_404(req);
-        return ESP_FAIL;
-    }
-
-    // Set content type based on file extension
-    const char *ext = strrchr(filepath, '.');
-    if (ext) {
-        if (strcmp(ext, ".html") == 0)
-            httpd_resp_set_type(req, "text/html");
-        else if (strcmp(ext, ".css") == 0)
-            httpd_resp_set_type(req, "text/css");
-        else if (strcmp(ext, ".js") == 0)
-            httpd_resp_set_type(req, "application/javascript");
-        else if (strcmp(ext, ".json") == 0)
-            httpd_resp_set_type(req, "application/json");
-    }
-
-    char buffer[1024];
-    size_t read_bytes;
-    while ((read_bytes = fread(buffer, 1, sizeof(buffer), file)) > 0) {
-        httpd_resp_send_chunk(req, buffer, read_bytes);
-    }
-    httpd_resp_send_chunk(req, NULL, 0);
-    fclose(file);
-    return ESP_OK;
+    httpd_resp_set_type(req, web_assets_content_type(filepath));
+    return send_file(req, filepath);
 }
 
 // HTTP handlers
@@ -149,9 +244,19 @@ static esp_err_t static_handler(httpd_req_t *req)
 {
     char filepath[PATH_BUFFER_SIZE];
 
+    if (s_assets.count > 0) {
+        const web_asset_t *asset = web_assets_find(&s_assets, req->uri);
+        if (!asset) {
+            ESP_LOGW(TAG, "File not found: %s", req->uri);
+            httpd_resp_send_404(req);
+            return ESP_FAIL;
+        }
+        return serve_asset(req, asset);
+    }
+
     // If root is requested, serve index.html
     if (strcmp(req->uri, "/") == 0) {
-        return serve_static_file(req, "/storage/index.html");
+        return serve_static_file(req, WEB_ROOT "/index.html");
     }
 
     if (strlen(req->uri) > MAX_URI_LENGTH) {
@@ -160,7 +265,7 @@ static esp_err_t static_handler(httpd_req_t *req)
     }
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wformat-truncation"
-    snprintf(filepath, sizeof(filepath), "/storage%s", req->uri);
+    snprintf(filepath, sizeof(filepath), WEB_ROOT "%s", req->uri);
 #pragma GCC diagnostic pop
     return serve_static_file(req, filepath);
 }
@@ -238,10 +343,7 @@ static esp_err_t api_devices_post_handler(httpd_req_t *req)
     char command[COMMAND_BUFFER_SIZE];
     snprintf(command, sizeof(command), is_update ? "UPDATE_PAIRED_DEVICE %s" : "PAIR_DEVICE %s", content);
 
-    httpd_resp_set_type(req, "application/json");
-    s_current_req = req;
-    commands_execute(command, http_response_callback);
-    s_current_req = NULL;
+    http_execute(req, command);
     return ESP_OK;
 }
 
@@ -282,10 +384,7 @@ static esp_err_t api_devices_delete_handler(httpd_req_t *req)
     char command[768];
     snprintf(command, sizeof(command), "UNPAIR_DEVICE %s", content);
 
-    httpd_resp_set_type(req, "application/json");
-    s_current_req = req;
-    commands_execute(command, http_response_callback);
-    s_current_req = NULL;
+    http_execute(req, command);
     return ESP_OK;
 }
 
@@ -346,16 +445,105 @@ static esp_err_t api_firmware_upload_handler(httpd_req_t *req)
     return ESP_OK;
 }
 
+static bool parse_signature(const char *hex, uint8_t out[LORA_FUOTA_SIGNATURE_SIZE])
+{
+    if (strlen(hex) != LORA_FUOTA_SIGNATURE_SIZE * 2) {
+        return false;
+    }
+    for (int i = 0; i < LORA_FUOTA_SIGNATURE_SIZE; i++) {
+        char byte[3] = {hex[i * 2], hex[i * 2 + 1], '\0'};
+        char *end;
+        out[i] = (uint8_t)strtoul(byte, &end, 16);
+        if (*end != '\0') {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Multicast update of the paired presenters: stage the container, then lora_fuota_service sends it
+static esp_err_t api_fuota_broadcast_handler(httpd_req_t *req)
+{
+    char query[FUOTA_QUERY_SIZE];
+    char hex[LORA_FUOTA_SIGNATURE_SIZE * 2 + 1];
+    uint8_t signature[LORA_FUOTA_SIGNATURE_SIZE];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK ||
+        httpd_query_key_value(query, "signature", hex, sizeof(hex)) != ESP_OK || !parse_signature(hex, signature)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "signature=<128 hex digits> required");
+        return ESP_FAIL;
+    }
+    if (req->content_len == 0) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "No content");
+        return ESP_FAIL;
+    }
+    if (lora_fuota_service_broadcasting()) {
+        httpd_resp_set_status(req, "409 Conflict");
+        httpd_resp_sendstr(req, "{\"error\":\"Broadcast already running\"}");
+        return ESP_OK;
+    }
+    size_t total = 0;
+    size_t used  = 0;
+    if (esp_littlefs_info("storage", &total, &used) != ESP_OK || req->content_len > total - used) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Not enough storage for the container");
+        return ESP_FAIL;
+    }
+
+    FILE *file = fopen(FUOTA_UPLOAD_PATH, "wb");
+    if (!file) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Cannot stage the container");
+        return ESP_FAIL;
+    }
+    size_t received = 0;
+    while (received < req->content_len) {
+        int len = httpd_req_recv(req, (char *)s_file_buf, sizeof(s_file_buf));
+        if (len == HTTPD_SOCK_ERR_TIMEOUT) {
+            continue;
+        }
+        if (len <= 0 || fwrite(s_file_buf, 1, len, file) != (size_t)len) {
+            ESP_LOGE(TAG, "Staging the FUOTA container failed at %zu bytes", received);
+            fclose(file);
+            remove(FUOTA_UPLOAD_PATH);
+            return ESP_FAIL;
+        }
+        received += len;
+    }
+    fclose(file);
+
+    esp_err_t ret = lora_fuota_service_broadcast(FUOTA_UPLOAD_PATH, signature);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "FUOTA broadcast not started: %s", esp_err_to_name(ret));
+        remove(FUOTA_UPLOAD_PATH);
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Broadcast not started");
+        return ESP_FAIL;
+    }
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, "{\"status\":\"broadcasting\"}");
+    return ESP_OK;
+}
+
+static esp_err_t api_fuota_status_handler(httpd_req_t *req)
+{
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, lora_fuota_service_broadcasting() ? "{\"broadcasting\":true}" : "{\"broadcasting\":false}");
+    return ESP_OK;
+}
+
 // OTA progress endpoint
 static esp_err_t api_firmware_progress_handler(httpd_req_t *req)
 {
     httpd_resp_set_type(req, "application/json");
 
-    size_t progress   = ota_engine_get_progress();
+    ota_timing_t timing;
+    size_t progress   = ota_engine_get_progress(&timing);
     ota_state_t state = ota_engine_get_state();
 
-    char response[128];
-    snprintf(response, sizeof(response), "{\"progress\":%zu,\"state\":%d}", progress, state);
+    char response[256];
+    snprintf(response, sizeof(response),
+             "{\"progress\":%zu,\"state\":%d,\"erase_ms\":%lu,\"write_ms\":%lu,\"hash_ms\":%lu,"
+             "\"erase_wait_ms\":%lu,\"erased\":%lu,\"flashed\":%lu}",
+             progress, state, (unsigned long)timing.erase_ms, (unsigned long)timing.write_ms,
+             (unsigned long)timing.hash_ms, (unsigned long)timing.erase_wait_ms, (unsigned long)timing.erased_bytes,
+             (unsigned long)timing.flashed_bytes);
 
     httpd_resp_sendstr(req, response);
     return ESP_OK;
@@ -376,6 +564,243 @@ static esp_err_t factory_reset_handler(httpd_req_t *req)
     return ESP_OK;
 }
 
+// Live telemetry over WebSocket (/ws/telemetry)
+
+static void telemetry_event_handler(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    xSemaphoreTake(s_telemetry_mutex, portMAX_DELAY);
+    switch (id) {
+        case SYSTEM_EVENT_BATTERY_CHANGED: {
+            const system_event_battery_t *evt = data;
+            ws_telemetry_set_battery(&s_telemetry, evt->level, evt->charging);
+            break;
+        }
+        case SYSTEM_EVENT_USB_CHANGED:
+            ws_telemetry_set_usb(&s_telemetry, ((const system_event_usb_t *)data)->connected);
+            break;
+        case SYSTEM_EVENT_LORA_STATE_CHANGED: {
+            const system_event_lora_t *evt = data;
+            ws_telemetry_set_lora(&s_telemetry, evt->connected, evt->rssi);
+            break;
+        }
+        case SYSTEM_EVENT_LORA_COMMAND_RECEIVED: {
+            const system_event_lora_cmd_t *evt = data;
+            ws_telemetry_add_lora_command(&s_telemetry, evt->command, evt->rssi);
+            break;
+        }
+        case SYSTEM_EVENT_OTA_PROGRESS: {
+            const system_event_ota_t *evt = data;
+            ws_telemetry_set_ota(&s_telemetry, evt->percent, evt->status);
+            break;
+        }
+        case SYSTEM_EVENT_MODE_CHANGED:
+            ws_telemetry_set_mode(&s_telemetry, device_mode_to_string(((const system_event_mode_t *)data)->mode));
+            break;
+        case SYSTEM_EVENT_HID_COMMAND_RECEIVED: {
+            const system_event_hid_command_t *evt = data;
+            ws_telemetry_add_hid_report(&s_telemetry, evt->device_id, evt->hid_type, evt->hid_report);
+            break;
+        }
+        default:
+            break;
+    }
+    xSemaphoreGive(s_telemetry_mutex);
+}
+
+// The OTA engine posts no events; sample it while an upload runs, and once more when it ends
+static void telemetry_sample_ota(void)
+{
+    static const char *const OTA_STATE_NAMES[] = {"idle", "active", "finalizing"};
+
+    ota_state_t state = ota_engine_get_state();
+    if (state == OTA_STATE_IDLE && !s_ota_reported_active) {
+        return;
+    }
+    s_ota_reported_active = state != OTA_STATE_IDLE;
+
+    uint8_t percent = (uint8_t)ota_engine_get_progress(NULL);
+    xSemaphoreTake(s_telemetry_mutex, portMAX_DELAY);
+    ws_telemetry_set_ota(&s_telemetry, percent, OTA_STATE_NAMES[state]);
+    xSemaphoreGive(s_telemetry_mutex);
+}
+
+static void telemetry_drop_client(ws_telemetry_client_t *client, const char *reason)
+{
+    ESP_LOGI(TAG, "Telemetry client %d gone (%s)", client->fd, reason);
+    client->fd = -1;
+    s_ws_client_count--;
+}
+
+// Full send buffer: the client is not keeping up, so it skips this tick instead of queueing
+static bool socket_writable(int fd)
+{
+    fd_set fds;
+    FD_ZERO(&fds);
+    FD_SET(fd, &fds);
+    struct timeval timeout = {0};
+    return select(fd + 1, NULL, &fds, NULL, &timeout) > 0;
+}
+
+// Runs on the httpd task, so sends never interleave with a handler's response
+static void telemetry_work(void *arg)
+{
+    s_telemetry_queued = false;
+    if (!server) {
+        return;
+    }
+    telemetry_sample_ota();
+
+    ws_telemetry_state_t snapshot;
+    xSemaphoreTake(s_telemetry_mutex, portMAX_DELAY);
+    snapshot = s_telemetry;
+    xSemaphoreGive(s_telemetry_mutex);
+
+    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    for (int i = 0; i < CONFIG_LORACUE_TELEMETRY_MAX_CLIENTS; i++) {
+        ws_telemetry_client_t *client = &s_ws_clients[i];
+        if (client->fd < 0) {
+            continue;
+        }
+        if (httpd_ws_get_fd_info(server, client->fd) != HTTPD_WS_CLIENT_WEBSOCKET) {
+            telemetry_drop_client(client, "closed");
+            continue;
+        }
+        if (!ws_telemetry_client_due(&snapshot, client, now_ms)) {
+            continue;
+        }
+        if (!socket_writable(client->fd)) {
+            client->skipped++;
+            continue;
+        }
+
+        size_t len = ws_telemetry_encode(&snapshot, client, now_ms, s_ws_frame, sizeof(s_ws_frame));
+        httpd_ws_frame_t frame = {
+            .final = true, .type = HTTPD_WS_TYPE_TEXT, .payload = (uint8_t *)s_ws_frame, .len = len};
+        if (len == 0 || httpd_ws_send_frame_async(server, client->fd, &frame) != ESP_OK) {
+            telemetry_drop_client(client, "send failed");
+            continue;
+        }
+        ws_telemetry_client_sent(&snapshot, client, now_ms);
+    }
+}
+
+static void telemetry_tick(void *arg)
+{
+    if (s_ws_client_count == 0 || s_telemetry_queued) {
+        return; // Nobody listening, or the httpd task has not caught up with the last tick
+    }
+    s_telemetry_queued = true;
+    if (httpd_queue_work(server, telemetry_work, NULL) != ESP_OK) {
+        s_telemetry_queued = false;
+    }
+}
+
+static esp_err_t ws_telemetry_handler(httpd_req_t *req)
+{
+    int fd = httpd_req_to_sockfd(req);
+
+    if (req->method == HTTP_GET) {
+        // Handshake: ?interval=<ms> picks this client's rate
+        uint32_t interval_ms = CONFIG_LORACUE_TELEMETRY_INTERVAL_MS;
+        char query[TELEMETRY_QUERY_SIZE];
+        char value[12];
+        if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+            httpd_query_key_value(query, "interval", value, sizeof(value)) == ESP_OK) {
+            interval_ms = strtoul(value, NULL, 10);
+        }
+
+        ws_telemetry_client_t *slot = NULL;
+        for (int i = 0; i < CONFIG_LORACUE_TELEMETRY_MAX_CLIENTS && !slot; i++) {
+            if (s_ws_clients[i].fd == fd) {
+                slot = &s_ws_clients[i];
+                s_ws_client_count--; // Re-registered below
+            }
+        }
+        for (int i = 0; i < CONFIG_LORACUE_TELEMETRY_MAX_CLIENTS && !slot; i++) {
+            int other = s_ws_clients[i].fd;
+            if (other < 0 || httpd_ws_get_fd_info(server, other) != HTTPD_WS_CLIENT_WEBSOCKET) {
+                slot = &s_ws_clients[i];
+                if (slot->fd >= 0) {
+                    telemetry_drop_client(slot, "closed");
+                }
+            }
+        }
+        if (!slot) {
+            ESP_LOGW(TAG, "Telemetry client %d refused: %d clients connected", fd, s_ws_client_count);
+            return ESP_FAIL;
+        }
+
+        ws_telemetry_client_init(slot, fd, interval_ms, CONFIG_LORACUE_TELEMETRY_MIN_INTERVAL_MS);
+        s_ws_client_count++;
+        ESP_LOGI(TAG, "Telemetry client %d, one frame per %lu ms at most", fd, (unsigned long)slot->interval_ms);
+        return ESP_OK;
+    }
+
+    // The stream is one-way: read and discard what the client sends (httpd answers pings)
+    uint8_t buf[64];
+    httpd_ws_frame_t frame = {.payload = buf};
+    esp_err_t ret = httpd_ws_recv_frame(req, &frame, 0);
+    if (ret != ESP_OK || frame.len > sizeof(buf)) {
+        return ESP_FAIL;
+    }
+    return frame.len > 0 ? httpd_ws_recv_frame(req, &frame, sizeof(buf)) : ESP_OK;
+}
+
+static void telemetry_start(void)
+{
+    if (!s_telemetry_mutex) {
+        s_telemetry_mutex = xSemaphoreCreateMutex();
+        if (!s_telemetry_mutex) {
+            ESP_LOGE(TAG, "Telemetry disabled: no memory");
+            return;
+        }
+    }
+
+    ws_telemetry_init(&s_telemetry);
+    for (int i = 0; i < CONFIG_LORACUE_TELEMETRY_MAX_CLIENTS; i++) {
+        s_ws_clients[i].fd = -1;
+    }
+    s_ws_client_count     = 0;
+    s_telemetry_queued    = false;
+    s_ota_reported_active = false;
+
+    // Events only carry changes: seed what the current configuration already knows
+    general_config_t general;
+    if (config_manager_get_general(&general) == ESP_OK) {
+        ws_telemetry_set_mode(&s_telemetry, device_mode_to_string(general.device_mode));
+    }
+
+    esp_err_t ret = esp_event_handler_instance_register_with(system_events_get_loop(), SYSTEM_EVENTS, ESP_EVENT_ANY_ID,
+                                                             telemetry_event_handler, NULL, &s_telemetry_events);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Telemetry events unavailable: %s", esp_err_to_name(ret));
+    }
+
+    const esp_timer_create_args_t timer_args = {.callback = telemetry_tick, .name = "ws_telemetry"};
+    ret = esp_timer_create(&timer_args, &s_telemetry_timer);
+    if (ret == ESP_OK) {
+        ret = esp_timer_start_periodic(s_telemetry_timer, TELEMETRY_TICK_MS * 1000);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Telemetry timer failed: %s", esp_err_to_name(ret));
+    }
+}
+
+static void telemetry_stop(void)
+{
+    if (s_telemetry_timer) {
+        esp_timer_stop(s_telemetry_timer);
+        esp_timer_delete(s_telemetry_timer);
+        s_telemetry_timer = NULL;
+    }
+    if (s_telemetry_events) {
+        esp_event_handler_instance_unregister_with(system_events_get_loop(), SYSTEM_EVENTS, ESP_EVENT_ANY_ID,
+                                                   s_telemetry_events);
+        s_telemetry_events = NULL;
+    }
+    s_ws_client_count = 0;
+}
+
 esp_err_t config_wifi_server_start(void)
 {
     if (server_running) {
@@ -396,6 +821,7 @@ esp_err_t config_wifi_server_start(void)
         if (ret == ESP_OK) {
             ESP_LOGI(TAG, "LittleFS: %zu KB total, %zu KB used", total / 1024, used / 1024);
         }
+        load_asset_index();
     }
 
     // Initialize WiFi
@@ -487,11 +913,25 @@ esp_err_t config_wifi_server_start(void)
             .uri = "/api/firmware/progress", .method = HTTP_GET, .handler = api_firmware_progress_handler};
         httpd_register_uri_handler(server, &fw_progress_uri);
 
+        // LoRa multicast update of the paired presenters (lora_fuota_service.h)
+        httpd_uri_t fuota_broadcast_uri = {
+            .uri = "/api/fuota/broadcast", .method = HTTP_POST, .handler = api_fuota_broadcast_handler};
+        httpd_register_uri_handler(server, &fuota_broadcast_uri);
+
+        httpd_uri_t fuota_status_uri = {.uri = "/api/fuota", .method = HTTP_GET, .handler = api_fuota_status_handler};
+        httpd_register_uri_handler(server, &fuota_status_uri);
+
         // System API endpoints
         httpd_uri_t factory_reset_uri = {
             .uri = "/api/system/factory-reset", .method = HTTP_POST, .handler = factory_reset_handler};
         httpd_register_uri_handler(server, &factory_reset_uri);
 
+        // Live telemetry stream (replaces polling the progress and device info endpoints)
+        httpd_uri_t ws_telemetry_uri = {
+            .uri = "/ws/telemetry", .method = HTTP_GET, .handler = ws_telemetry_handler, .is_websocket = true};
+        httpd_register_uri_handler(server, &ws_telemetry_uri);
+        telemetry_start();
+
         // Static file handler LAST - catch-all for everything else
         httpd_uri_t static_files = {.uri = "/*", .method = HTTP_GET, .handler = static_handler};
         httpd_register_uri_handler(server, &static_files);
@@ -513,6 +953,7 @@ esp_err_t config_wifi_server_stop(void)
     ESP_LOGI(TAG, "Stopping WiFi AP and web server");
 
     // Stop HTTP server
+    telemetry_stop();
     if (server) {
         httpd_stop(server);
         server = NULL;
@@ -536,6 +977,7 @@ esp_err_t config_wifi_server_stop(void)
     }
 
     // Unmount LittleFS
+    web_assets_free(&s_assets);
     esp_vfs_littlefs_unregister("storage");
 
     // Only disable WiFi on real hardware for power saving
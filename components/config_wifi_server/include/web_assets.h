@@ -0,0 +1,116 @@
+/**
+ * @file web_assets.h
+ * @brief Web UI asset index: pre-compressed variants, strong ETags and cache policy
+ *
+ * CONTEXT: The config AP served the exported web interface with an fopen() per request,
+ *          extra fopen() probes for SPA routes, 1 KB reads and no caching or compression,
+ *          so the UI loaded slowly on a phone over the soft-AP
+ * PURPOSE: scripts/precompress_web.py writes <file>.gz (and <file>.br) next to each
+ *          compressible asset plus an index of path, content hash and variants. The server
+ *          loads the index once; a request is then one lookup, at most one open() and large
+ *          reads, or a 304 when the browser's ETag still matches
+ * USAGE: Pure C; config_wifi_server.c does the I/O, tests/host covers parsing, lookup and
+ *        negotiation
+ *
+ * Index (WEB_ASSETS_INDEX at the storage root), one asset per line:
+ *   <path> TAB <hash> TAB <variants> LF
+ *   path      URL path with a leading '/', e.g. /_next/static/chunks/main-1a2b3c.js
+ *   hash      hex digest of the uncompressed file, the strong validator
+ *   variants  "g" if <path>.gz exists, "b" if <path>.br exists, "-" for neither
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define WEB_ASSETS_INDEX "/asset-index.txt"
+#define WEB_ASSETS_ETAG_MAX 80 ///< Buffer for web_assets_format_etag(), quotes and suffix included
+
+#define WEB_ASSET_GZIP 0x01
+#define WEB_ASSET_BROTLI 0x02
+
+typedef enum {
+    WEB_ENCODING_IDENTITY = 0,
+    WEB_ENCODING_GZIP,
+    WEB_ENCODING_BROTLI,
+} web_encoding_t;
+
+typedef struct {
+    const char *path; ///< Points into the index text
+    const char *hash;
+    uint8_t variants; ///< WEB_ASSET_* bits
+} web_asset_t;
+
+typedef struct {
+    web_asset_t *assets; ///< Sorted by path
+    size_t count;
+    char *text; ///< The index, split in place; owned
+} web_assets_t;
+
+/**
+ * @brief Parse an index, taking ownership of text (malloc'd, NUL-terminated)
+ *
+ * @return ESP_ERR_INVALID_ARG on a malformed line (text is freed), ESP_ERR_NO_MEM
+ */
+esp_err_t web_assets_parse(web_assets_t *table, char *text);
+
+void web_assets_free(web_assets_t *table);
+
+/**
+ * @brief Asset for a request URI
+ *
+ * The query string is ignored, "/" is /index.html, and an unknown path without one of the
+ * extensions .html/.js/.css/.json is looked up as a directory (<path>/index.html), the way
+ * the trailing-slash static export lays out its routes.
+ *
+ * @return NULL if there is no such asset
+ */
+const web_asset_t *web_assets_find(const web_assets_t *table, const char *uri);
+
+/**
+ * @brief Best variant the client accepts: brotli, then gzip, then identity
+ *
+ * @param accept_encoding Accept-Encoding header value, NULL if absent
+ */
+web_encoding_t web_assets_pick_encoding(const web_asset_t *asset, const char *accept_encoding);
+
+/**
+ * @return File name suffix of a variant ("", ".gz" or ".br")
+ */
+const char *web_assets_suffix(web_encoding_t encoding);
+
+/**
+ * @return Content-Encoding value, NULL for identity
+ */
+const char *web_assets_content_encoding(web_encoding_t encoding);
+
+/**
+ * @brief Quoted strong ETag of one variant; variants of an asset get distinct tags
+ */
+void web_assets_format_etag(const web_asset_t *asset, web_encoding_t encoding, char out[WEB_ASSETS_ETAG_MAX]);
+
+/**
+ * @brief Whether an If-None-Match value (a list of tags or "*") matches etag
+ */
+bool web_assets_etag_match(const char *if_none_match, const char *etag);
+
+/**
+ * @brief Content-hashed build output may be cached for a year, the rest must revalidate
+ */
+const char *web_assets_cache_control(const char *path);
+
+/**
+ * @return MIME type by extension, application/octet-stream if unknown
+ */
+const char *web_assets_content_type(const char *path);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,113 @@
+/**
+ * @file ws_telemetry.h
+ * @brief Live telemetry for the web UI: latest-value state and per-client delta frames
+ *
+ * CONTEXT: The web UI polled /api/device/info and /api/firmware/progress, and every poll
+ *          ran a full JSON-RPC handler even when nothing had changed
+ * PURPOSE: system_events handlers store the latest value of each topic and bump its
+ *          version; each WebSocket client remembers the versions it has seen and gets one
+ *          frame with only the topics that changed since. Updates in between coalesce, so a
+ *          slow or rate-limited client receives the newest state late rather than a backlog
+ * USAGE: Pure C; config_wifi_server.c owns the state, the clients and the socket I/O,
+ *        tests/host covers versioning, rate limits and encoding
+ *
+ * Frame (JSON text; only changed topics appear, the first frame carries all known ones):
+ *   {"t":ms,"bat":[level,charging],"usb":bool,"lora":[connected,rssi],"mode":"PRESENTER",
+ *    "ota":[percent,"status"],"cmd":[count,"command",rssi],"hid":[count,device_id,type,"report hex"],
+ *    "skip":n}
+ *   t     device uptime in ms
+ *   cmd   LoRa commands, hid HID reports; count is the running total, so a client can tell
+ *         how many it missed between two frames
+ *   skip  ticks this client was not sent to because its socket was full (omitted when 0)
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define WS_TELEMETRY_FRAME_MAX 512 ///< Every topic at its longest, strings fully escaped
+
+typedef enum {
+    WS_TELEMETRY_BATTERY = 0,
+    WS_TELEMETRY_USB,
+    WS_TELEMETRY_LORA,
+    WS_TELEMETRY_MODE,
+    WS_TELEMETRY_OTA,
+    WS_TELEMETRY_LORA_COMMAND,
+    WS_TELEMETRY_HID,
+    WS_TELEMETRY_TOPIC_COUNT,
+} ws_telemetry_topic_t;
+
+typedef struct {
+    uint32_t version[WS_TELEMETRY_TOPIC_COUNT]; ///< 0: never set, not sent
+    uint8_t battery_level;
+    bool battery_charging;
+    bool usb_connected;
+    bool lora_connected;
+    int8_t lora_rssi;
+    const char *mode; ///< Static string (device_mode_to_string)
+    uint8_t ota_percent;
+    char ota_status[32];
+    uint32_t lora_commands;
+    char lora_command[16];
+    int8_t lora_command_rssi;
+    uint32_t hid_reports;
+    uint16_t hid_device_id;
+    uint8_t hid_type;
+    uint8_t hid_report[5];
+} ws_telemetry_state_t;
+
+typedef struct {
+    int fd;                                  ///< Socket, -1 for a free slot
+    uint32_t interval_ms;                    ///< Minimum time between two frames
+    uint32_t last_ms;                        ///< When the last frame went out
+    uint32_t sent[WS_TELEMETRY_TOPIC_COUNT]; ///< Topic versions the client has
+    uint32_t skipped;                        ///< Frames deferred by backpressure since the last one
+} ws_telemetry_client_t;
+
+void ws_telemetry_init(ws_telemetry_state_t *state);
+
+// Setters bump a topic's version only when its value changes; commands and reports always do
+void ws_telemetry_set_battery(ws_telemetry_state_t *state, uint8_t level, bool charging);
+void ws_telemetry_set_usb(ws_telemetry_state_t *state, bool connected);
+void ws_telemetry_set_lora(ws_telemetry_state_t *state, bool connected, int8_t rssi);
+void ws_telemetry_set_mode(ws_telemetry_state_t *state, const char *mode);
+void ws_telemetry_set_ota(ws_telemetry_state_t *state, uint8_t percent, const char *status);
+void ws_telemetry_add_lora_command(ws_telemetry_state_t *state, const char *command, int8_t rssi);
+void ws_telemetry_add_hid_report(ws_telemetry_state_t *state, uint16_t device_id, uint8_t type,
+                                 const uint8_t report[5]);
+
+/**
+ * @brief Start a client with nothing seen, so its first frame is a full snapshot
+ *
+ * @param interval_ms Requested minimum interval, raised to min_interval_ms if lower
+ */
+void ws_telemetry_client_init(ws_telemetry_client_t *client, int fd, uint32_t interval_ms, uint32_t min_interval_ms);
+
+/**
+ * @brief Whether the client has unseen topics and its interval has passed
+ */
+bool ws_telemetry_client_due(const ws_telemetry_state_t *state, const ws_telemetry_client_t *client, uint32_t now_ms);
+
+/**
+ * @brief Encode the client's delta frame; the client is unchanged until ws_telemetry_client_sent()
+ *
+ * @return Frame length, 0 if out is too small
+ */
+size_t ws_telemetry_encode(const ws_telemetry_state_t *state, const ws_telemetry_client_t *client, uint32_t now_ms,
+                           char *out, size_t size);
+
+/**
+ * @brief The frame encoded from state went out: mark its topics seen
+ */
+void ws_telemetry_client_sent(const ws_telemetry_state_t *state, ws_telemetry_client_t *client, uint32_t now_ms);
+
+#ifdef __cplusplus
+}
+#endif
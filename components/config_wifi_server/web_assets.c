@@ -0,0 +1,272 @@
+/**
+ * @file web_assets.c
+ * @brief Web UI asset index: parsing, lookup, content negotiation and cache policy
+ */
+
+#include "web_assets.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#define PATH_MAX_LEN 512
+#define HASHED_PREFIX "/_next/static/" // Next.js names everything below after its content hash
+
+static int compare_assets(const void *a, const void *b)
+{
+    return strcmp(((const web_asset_t *)a)->path, ((const web_asset_t *)b)->path);
+}
+
+static int compare_key(const void *key, const void *asset)
+{
+    return strcmp((const char *)key, ((const web_asset_t *)asset)->path);
+}
+
+esp_err_t web_assets_parse(web_assets_t *table, char *text)
+{
+    memset(table, 0, sizeof(*table));
+
+    size_t lines = 0;
+    for (const char *p = text; *p; p++) {
+        lines += *p == '\n';
+    }
+    table->assets = calloc(lines + 1, sizeof(web_asset_t)); // +1: last line may lack its LF
+    if (!table->assets) {
+        free(text);
+        return ESP_ERR_NO_MEM;
+    }
+    table->text = text;
+
+    char *line = text;
+    while (*line) {
+        char *end = strchr(line, '\n');
+        if (end) {
+            *end = '\0';
+        }
+        if (*line) {
+            char *hash     = strchr(line, '\t');
+            char *variants = hash ? strchr(hash + 1, '\t') : NULL;
+            if (line[0] != '/' || !variants || variants == hash + 1) {
+                web_assets_free(table);
+                return ESP_ERR_INVALID_ARG;
+            }
+            *hash++     = '\0';
+            *variants++ = '\0';
+
+            web_asset_t *asset = &table->assets[table->count++];
+            asset->path        = line;
+            asset->hash        = hash;
+            asset->variants    = (strchr(variants, 'g') ? WEB_ASSET_GZIP : 0) |
+                              (strchr(variants, 'b') ? WEB_ASSET_BROTLI : 0);
+        }
+        if (!end) {
+            break;
+        }
+        line = end + 1;
+    }
+
+    qsort(table->assets, table->count, sizeof(web_asset_t), compare_assets);
+    return ESP_OK;
+}
+
+void web_assets_free(web_assets_t *table)
+{
+    free(table->assets);
+    free(table->text);
+    memset(table, 0, sizeof(*table));
+}
+
+static const web_asset_t *lookup(const web_assets_t *table, const char *path)
+{
+    if (table->count == 0) {
+        return NULL;
+    }
+    return bsearch(path, table->assets, table->count, sizeof(web_asset_t), compare_key);
+}
+
+static bool has_page_extension(const char *path)
+{
+    const char *slash = strrchr(path, '/');
+    const char *ext   = strrchr(path, '.');
+    if (!ext || (slash && ext < slash)) {
+        return false;
+    }
+    return strcmp(ext, ".html") == 0 || strcmp(ext, ".js") == 0 || strcmp(ext, ".css") == 0 ||
+           strcmp(ext, ".json") == 0;
+}
+
+const web_asset_t *web_assets_find(const web_assets_t *table, const char *uri)
+{
+    char path[PATH_MAX_LEN];
+    size_t len = strcspn(uri, "?#");
+    if (len == 0 || len >= sizeof(path) - sizeof("/index.html")) {
+        return NULL;
+    }
+    memcpy(path, uri, len);
+    path[len] = '\0';
+
+    if (path[len - 1] != '/') {
+        const web_asset_t *asset = lookup(table, path);
+        if (asset || has_page_extension(path)) {
+            return asset;
+        }
+        path[len++] = '/';
+    }
+    strcpy(path + len, "index.html");
+    return lookup(table, path);
+}
+
+// Whether a comma-separated list of "token[;q=value]" accepts name with q > 0. The whole list
+// is read: name's own entry wins over "*" wherever it appears, "*" only covers a name not listed
+static bool accepts(const char *list, const char *name)
+{
+    size_t name_len = strlen(name);
+    const char *p   = list;
+    bool listed     = false; // name has its own entry
+    bool exact      = false; // ... with q > 0
+    bool wildcard   = false; // "*" with q > 0
+
+    while (*p) {
+        while (*p == ' ' || *p == ',') {
+            p++;
+        }
+        const char *token = p;
+        while (*p && *p != ',' && *p != ';' && *p != ' ') {
+            p++;
+        }
+        size_t token_len = p - token;
+
+        bool zero_q = false;
+        while (*p && *p != ',') {
+            if (*p == 'q' && p[1] == '=') {
+                zero_q = strtod(p + 2, NULL) <= 0.0;
+            }
+            p++;
+        }
+
+        if (token_len == name_len && strncasecmp(token, name, name_len) == 0) {
+            listed = true;
+            exact  = !zero_q;
+        } else if (token_len == 1 && *token == '*') {
+            wildcard = !zero_q;
+        }
+    }
+    return listed ? exact : wildcard;
+}
+
+web_encoding_t web_assets_pick_encoding(const web_asset_t *asset, const char *accept_encoding)
+{
+    if (!accept_encoding) {
+        return WEB_ENCODING_IDENTITY;
+    }
+    if ((asset->variants & WEB_ASSET_BROTLI) && accepts(accept_encoding, "br")) {
+        return WEB_ENCODING_BROTLI;
+    }
+    if ((asset->variants & WEB_ASSET_GZIP) && accepts(accept_encoding, "gzip")) {
+        return WEB_ENCODING_GZIP;
+    }
+    return WEB_ENCODING_IDENTITY;
+}
+
+const char *web_assets_suffix(web_encoding_t encoding)
+{
+    switch (encoding) {
+        case WEB_ENCODING_GZIP:
+            return ".gz";
+        case WEB_ENCODING_BROTLI:
+            return ".br";
+        default:
+            return "";
+    }
+}
+
+const char *web_assets_content_encoding(web_encoding_t encoding)
+{
+    switch (encoding) {
+        case WEB_ENCODING_GZIP:
+            return "gzip";
+        case WEB_ENCODING_BROTLI:
+            return "br";
+        default:
+            return NULL;
+    }
+}
+
+void web_assets_format_etag(const web_asset_t *asset, web_encoding_t encoding, char out[WEB_ASSETS_ETAG_MAX])
+{
+    const char *suffix = web_assets_suffix(encoding);
+    snprintf(out, WEB_ASSETS_ETAG_MAX, "\"%.64s%s%s\"", asset->hash, *suffix ? "-" : "", *suffix ? suffix + 1 : "");
+}
+
+bool web_assets_etag_match(const char *if_none_match, const char *etag)
+{
+    if (!if_none_match) {
+        return false;
+    }
+    size_t etag_len = strlen(etag);
+    const char *p   = if_none_match;
+
+    while (*p) {
+        while (*p == ' ' || *p == ',') {
+            p++;
+        }
+        if (*p == '*') {
+            return true;
+        }
+        if (strncmp(p, "W/", 2) == 0) {
+            p += 2; // If-None-Match uses the weak comparison
+        }
+        const char *tag = p;
+        if (*p == '"') {
+            p = strchr(p + 1, '"');
+            p = p ? p + 1 : tag + strlen(tag);
+        }
+        while (*p && *p != ',') {
+            p++;
+        }
+        size_t tag_len = p - tag;
+        while (tag_len > 0 && tag[tag_len - 1] == ' ') {
+            tag_len--;
+        }
+        if (tag_len == etag_len && strncmp(tag, etag, etag_len) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *web_assets_cache_control(const char *path)
+{
+    if (strncmp(path, HASHED_PREFIX, strlen(HASHED_PREFIX)) == 0) {
+        return "public, max-age=31536000, immutable";
+    }
+    return "no-cache";
+}
+
+const char *web_assets_content_type(const char *path)
+{
+    static const struct {
+        const char *ext;
+        const char *type;
+    } types[] = {
+        {".html", "text/html"},
+        {".css", "text/css"},
+        {".js", "application/javascript"},
+        {".json", "application/json"},
+        {".svg", "image/svg+xml"},
+        {".png", "image/png"},
+        {".ico", "image/x-icon"},
+        {".woff2", "font/woff2"},
+        {".txt", "text/plain"},
+    };
+
+    const char *ext = strrchr(path, '.');
+    if (ext && !strchr(ext, '/')) {
+        for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+            if (strcasecmp(ext, types[i].ext) == 0) {
+                return types[i].type;
+            }
+        }
+    }
+    return "application/octet-stream";
+}
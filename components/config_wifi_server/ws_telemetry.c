@@ -0,0 +1,213 @@
+/**
+ * @file ws_telemetry.c
+ * @brief Live telemetry state, per-client rate limits and delta frame encoding
+ */
+
+#include "ws_telemetry.h"
+#include "json_stream.h"
+#include <stdio.h>
+#include <string.h>
+
+#define WRITER_BUFFER_SIZE 64
+
+typedef struct {
+    char *out;
+    size_t size;
+    size_t len;
+    bool overflow;
+} frame_sink_t;
+
+static void frame_write(const char *data, size_t len, void *ctx)
+{
+    frame_sink_t *sink = ctx;
+    if (sink->overflow || len > sink->size - sink->len) {
+        sink->overflow = true;
+        return;
+    }
+    memcpy(sink->out + sink->len, data, len);
+    sink->len += len;
+}
+
+static void bump(ws_telemetry_state_t *state, ws_telemetry_topic_t topic)
+{
+    // Skip 0 on wrap: it means "never set" and would stop the topic from being sent
+    if (++state->version[topic] == 0) {
+        state->version[topic] = 1;
+    }
+}
+
+void ws_telemetry_init(ws_telemetry_state_t *state)
+{
+    memset(state, 0, sizeof(*state));
+}
+
+void ws_telemetry_set_battery(ws_telemetry_state_t *state, uint8_t level, bool charging)
+{
+    if (state->version[WS_TELEMETRY_BATTERY] && state->battery_level == level && state->battery_charging == charging) {
+        return;
+    }
+    state->battery_level    = level;
+    state->battery_charging = charging;
+    bump(state, WS_TELEMETRY_BATTERY);
+}
+
+void ws_telemetry_set_usb(ws_telemetry_state_t *state, bool connected)
+{
+    if (state->version[WS_TELEMETRY_USB] && state->usb_connected == connected) {
+        return;
+    }
+    state->usb_connected = connected;
+    bump(state, WS_TELEMETRY_USB);
+}
+
+void ws_telemetry_set_lora(ws_telemetry_state_t *state, bool connected, int8_t rssi)
+{
+    if (state->version[WS_TELEMETRY_LORA] && state->lora_connected == connected && state->lora_rssi == rssi) {
+        return;
+    }
+    state->lora_connected = connected;
+    state->lora_rssi      = rssi;
+    bump(state, WS_TELEMETRY_LORA);
+}
+
+void ws_telemetry_set_mode(ws_telemetry_state_t *state, const char *mode)
+{
+    if (state->version[WS_TELEMETRY_MODE] && state->mode && mode && strcmp(state->mode, mode) == 0) {
+        return;
+    }
+    state->mode = mode;
+    bump(state, WS_TELEMETRY_MODE);
+}
+
+void ws_telemetry_set_ota(ws_telemetry_state_t *state, uint8_t percent, const char *status)
+{
+    status = status ? status : "";
+    if (state->version[WS_TELEMETRY_OTA] && state->ota_percent == percent &&
+        strncmp(state->ota_status, status, sizeof(state->ota_status) - 1) == 0) {
+        return;
+    }
+    state->ota_percent = percent;
+    snprintf(state->ota_status, sizeof(state->ota_status), "%s", status);
+    bump(state, WS_TELEMETRY_OTA);
+}
+
+void ws_telemetry_add_lora_command(ws_telemetry_state_t *state, const char *command, int8_t rssi)
+{
+    state->lora_commands++;
+    snprintf(state->lora_command, sizeof(state->lora_command), "%s", command ? command : "");
+    state->lora_command_rssi = rssi;
+    bump(state, WS_TELEMETRY_LORA_COMMAND);
+}
+
+void ws_telemetry_add_hid_report(ws_telemetry_state_t *state, uint16_t device_id, uint8_t type,
+                                 const uint8_t report[5])
+{
+    state->hid_reports++;
+    state->hid_device_id = device_id;
+    state->hid_type      = type;
+    memcpy(state->hid_report, report, sizeof(state->hid_report));
+    bump(state, WS_TELEMETRY_HID);
+}
+
+void ws_telemetry_client_init(ws_telemetry_client_t *client, int fd, uint32_t interval_ms, uint32_t min_interval_ms)
+{
+    memset(client, 0, sizeof(*client));
+    client->fd          = fd;
+    client->interval_ms = interval_ms < min_interval_ms ? min_interval_ms : interval_ms;
+}
+
+static bool has_unseen(const ws_telemetry_state_t *state, const ws_telemetry_client_t *client, bool *fresh)
+{
+    bool unseen = false;
+    *fresh      = true;
+    for (int i = 0; i < WS_TELEMETRY_TOPIC_COUNT; i++) {
+        unseen |= state->version[i] != client->sent[i];
+        *fresh &= client->sent[i] == 0;
+    }
+    return unseen;
+}
+
+bool ws_telemetry_client_due(const ws_telemetry_state_t *state, const ws_telemetry_client_t *client, uint32_t now_ms)
+{
+    bool fresh;
+    if (!has_unseen(state, client, &fresh)) {
+        return false;
+    }
+    // The snapshot for a new client goes out at once; after that the interval applies
+    return fresh || now_ms - client->last_ms >= client->interval_ms;
+}
+
+static bool changed(const ws_telemetry_state_t *state, const ws_telemetry_client_t *client, ws_telemetry_topic_t topic)
+{
+    return state->version[topic] != client->sent[topic];
+}
+
+size_t ws_telemetry_encode(const ws_telemetry_state_t *state, const ws_telemetry_client_t *client, uint32_t now_ms,
+                           char *out, size_t size)
+{
+    char buf[WRITER_BUFFER_SIZE];
+    frame_sink_t sink = {.out = out, .size = size};
+    json_writer_t w;
+    json_writer_init(&w, buf, sizeof(buf), frame_write, &sink);
+
+    json_write_object_begin(&w);
+    json_write_kv_uint(&w, "t", now_ms);
+
+    if (changed(state, client, WS_TELEMETRY_BATTERY)) {
+        json_write_kv_array(&w, "bat");
+        json_write_uint(&w, state->battery_level);
+        json_write_bool(&w, state->battery_charging);
+        json_write_array_end(&w);
+    }
+    if (changed(state, client, WS_TELEMETRY_USB)) {
+        json_write_kv_bool(&w, "usb", state->usb_connected);
+    }
+    if (changed(state, client, WS_TELEMETRY_LORA)) {
+        json_write_kv_array(&w, "lora");
+        json_write_bool(&w, state->lora_connected);
+        json_write_int(&w, state->lora_rssi);
+        json_write_array_end(&w);
+    }
+    if (changed(state, client, WS_TELEMETRY_MODE)) {
+        json_write_kv_string(&w, "mode", state->mode);
+    }
+    if (changed(state, client, WS_TELEMETRY_OTA)) {
+        json_write_kv_array(&w, "ota");
+        json_write_uint(&w, state->ota_percent);
+        json_write_string(&w, state->ota_status);
+        json_write_array_end(&w);
+    }
+    if (changed(state, client, WS_TELEMETRY_LORA_COMMAND)) {
+        json_write_kv_array(&w, "cmd");
+        json_write_uint(&w, state->lora_commands);
+        json_write_string(&w, state->lora_command);
+        json_write_int(&w, state->lora_command_rssi);
+        json_write_array_end(&w);
+    }
+    if (changed(state, client, WS_TELEMETRY_HID)) {
+        char report[sizeof(state->hid_report) * 2 + 1];
+        for (size_t i = 0; i < sizeof(state->hid_report); i++) {
+            snprintf(report + i * 2, 3, "%02x", state->hid_report[i]);
+        }
+        json_write_kv_array(&w, "hid");
+        json_write_uint(&w, state->hid_reports);
+        json_write_uint(&w, state->hid_device_id);
+        json_write_uint(&w, state->hid_type);
+        json_write_string(&w, report);
+        json_write_array_end(&w);
+    }
+    if (client->skipped > 0) {
+        json_write_kv_uint(&w, "skip", client->skipped);
+    }
+
+    json_write_object_end(&w);
+    json_writer_flush(&w);
+    return sink.overflow ? 0 : sink.len;
+}
+
+void ws_telemetry_client_sent(const ws_telemetry_state_t *state, ws_telemetry_client_t *client, uint32_t now_ms)
+{
+    memcpy(client->sent, state->version, sizeof(client->sent));
+    client->last_ms = now_ms;
+    client->skipped = 0;
+}
@@ -0,0 +1,111 @@
+/**
+ * @file device_index.c
+ * @brief Open-addressing device ID index implementation
+ */
+
+#include "device_index.h"
+#include <stdbool.h>
+
+static inline size_t home_bucket(const device_index_t *index, uint16_t device_id)
+{
+    // Fibonacci hashing: device IDs are MAC-derived and often share low bits
+    return (size_t)(((uint32_t)device_id * 2654435761u) >> 16) & index->bucket_mask;
+}
+
+static inline bool bucket_used(const device_index_bucket_t *bucket)
+{
+    return bucket->slot != DEVICE_INDEX_EMPTY_SLOT;
+}
+
+esp_err_t device_index_init(device_index_t *index, device_index_bucket_t *buckets, size_t bucket_count)
+{
+    if (!index || !buckets || bucket_count < 2 || (bucket_count & (bucket_count - 1)) != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    index->buckets     = buckets;
+    index->bucket_mask = bucket_count - 1;
+    device_index_clear(index);
+    return ESP_OK;
+}
+
+void device_index_clear(device_index_t *index)
+{
+    for (size_t i = 0; i <= index->bucket_mask; i++) {
+        index->buckets[i].device_id = 0;
+        index->buckets[i].slot      = DEVICE_INDEX_EMPTY_SLOT;
+    }
+    index->count = 0;
+}
+
+esp_err_t device_index_put(device_index_t *index, uint16_t device_id, uint16_t slot)
+{
+    if (slot == DEVICE_INDEX_EMPTY_SLOT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    size_t i = home_bucket(index, device_id);
+    while (bucket_used(&index->buckets[i])) {
+        if (index->buckets[i].device_id == device_id) {
+            index->buckets[i].slot = slot;
+            return ESP_OK;
+        }
+        i = (i + 1) & index->bucket_mask;
+    }
+
+    // Keep load factor <= 0.5 so probe sequences stay short
+    if (index->count >= (index->bucket_mask + 1) / 2) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    index->buckets[i].device_id = device_id;
+    index->buckets[i].slot      = slot;
+    index->count++;
+    return ESP_OK;
+}
+
+int device_index_find(const device_index_t *index, uint16_t device_id)
+{
+    size_t i = home_bucket(index, device_id);
+    while (bucket_used(&index->buckets[i])) {
+        if (index->buckets[i].device_id == device_id) {
+            return index->buckets[i].slot;
+        }
+        i = (i + 1) & index->bucket_mask;
+    }
+    return -1;
+}
+
+esp_err_t device_index_remove(device_index_t *index, uint16_t device_id)
+{
+    size_t i = home_bucket(index, device_id);
+    while (bucket_used(&index->buckets[i])) {
+        if (index->buckets[i].device_id == device_id) {
+            break;
+        }
+        i = (i + 1) & index->bucket_mask;
+    }
+    if (!bucket_used(&index->buckets[i])) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    // Backward-shift: pull later entries of the probe chain into the hole
+    size_t hole = i;
+    size_t j    = (i + 1) & index->bucket_mask;
+    while (bucket_used(&index->buckets[j])) {
+        size_t home = home_bucket(index, index->buckets[j].device_id);
+        // Entry at j may move to hole only if its home is not cyclically within (hole, j]
+        size_t dist_home = (j - home) & index->bucket_mask;
+        size_t dist_hole = (j - hole) & index->bucket_mask;
+        if (dist_home >= dist_hole) {
+            index->buckets[hole] = index->buckets[j];
+            hole                 = j;
+        }
+        j = (j + 1) & index->bucket_mask;
+    }
+
+    index->buckets[hole].device_id = 0;
+    index->buckets[hole].slot      = DEVICE_INDEX_EMPTY_SLOT;
+    index->count--;
+    return ESP_OK;
+}
@@ -1,35 +1,305 @@
 /**
  * @file device_registry.c
- * @brief Simplified device registry implementation using config_manager
+ * @brief Device registry implementation with per-device NVS records and hash index
  */
 
 #include "device_registry.h"
+#include "common_types.h"
+#include "device_index.h"
 #include "esp_log.h"
+#include "nvs.h"
+#include "replay_window.h"
+#include "seq_journal.h"
+#include "sequence_store.h"
+#include <stdio.h>
 #include <string.h>
 
 static const char *TAG = "DEVICE_REGISTRY";
 
-// Runtime sequence tracking (RAM-only, not persisted)
-static paired_device_t runtime_devices[MAX_PAIRED_DEVICES];
-static bool runtime_loaded = false;
+#define NVS_NAMESPACE_REGISTRY "registry"
+#define LEGACY_REGISTRY_KEY "config" // Single-blob format used before per-device records
+#define DEVICE_KEY_PREFIX "dev_"
+#define DEVICE_KEY_LEN 9 // "dev_" + 4 hex digits + NUL
+#define SEQUENCE_KEY_BASE_FMT "sq%04x_" // Journal slots "sqXXXX_a" / "sqXXXX_b"
 
-static void load_runtime_data(void)
+_Static_assert(MAX_PAIRED_DEVICES < DEVICE_INDEX_EMPTY_SLOT, "Registry slot must fit in index bucket");
+
+/**
+ * @brief Persisted per-device record (sequence tracking is journaled separately)
+ */
+typedef struct {
+    uint16_t device_id;
+    char device_name[DEVICE_NAME_MAX_LEN];
+    uint8_t mac_address[DEVICE_MAC_ADDR_LEN];
+    uint8_t aes_key[DEVICE_AES_KEY_LEN];
+} device_record_t;
+
+/**
+ * @brief RAM registry entry: device plus its replay-window snapshot state
+ */
+typedef struct {
+    paired_device_t device;
+    seq_journal_t seq_journal; ///< Last durable highest_sequence snapshot
+    bool seq_dirty;            ///< highest_sequence changed since last snapshot
+    uint32_t seq_epoch;        ///< New on every add or reset; a snapshot from an older epoch is stale
+} registry_entry_t;
+
+// Dense RAM copy of all paired devices, slot order is not significant
+static registry_entry_t entries[MAX_PAIRED_DEVICES];
+static size_t device_count = 0;
+
+// Source of seq_epoch, never reset: a remove and re-add must not bring back an in-flight flush's epoch
+static uint32_t seq_epoch_counter = 0;
+
+static device_index_bucket_t index_buckets[DEVICE_INDEX_BUCKETS(MAX_PAIRED_DEVICES)];
+static device_index_t device_index;
+
+static SemaphoreHandle_t registry_mutex = NULL;
+static bool registry_initialized        = false;
+
+static void registry_lock(void)
+{
+    xSemaphoreTake(registry_mutex, portMAX_DELAY);
+}
+
+static void registry_unlock(void)
 {
-    if (runtime_loaded) return;
-    
-    device_registry_config_t config;
-    esp_err_t ret = config_manager_get_device_registry(&config);
+    xSemaphoreGive(registry_mutex);
+}
+
+static void make_device_key(uint16_t device_id, char *key)
+{
+    snprintf(key, DEVICE_KEY_LEN, DEVICE_KEY_PREFIX "%04x", device_id);
+}
+
+static void sequence_backend(uint16_t device_id, seq_journal_backend_t *backend, sequence_store_nvs_ctx_t *ctx)
+{
+    char key_base[SEQUENCE_STORE_KEY_MAX_LEN];
+    snprintf(key_base, sizeof(key_base), SEQUENCE_KEY_BASE_FMT, device_id);
+    sequence_store_nvs_backend(backend, ctx, NVS_NAMESPACE_REGISTRY, key_base);
+}
+
+static void record_from_device(const paired_device_t *device, device_record_t *record)
+{
+    memset(record, 0, sizeof(*record));
+    record->device_id = device->device_id;
+    memcpy(record->device_name, device->device_name, DEVICE_NAME_MAX_LEN);
+    memcpy(record->mac_address, device->mac_address, DEVICE_MAC_ADDR_LEN);
+    memcpy(record->aes_key, device->aes_key, DEVICE_AES_KEY_LEN);
+}
+
+static esp_err_t store_record(const device_record_t *record)
+{
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(NVS_NAMESPACE_REGISTRY, NVS_READWRITE, &handle);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    char key[DEVICE_KEY_LEN];
+    make_device_key(record->device_id, key);
+    ret = nvs_set_blob(handle, key, record, sizeof(*record));
+    if (ret == ESP_OK) {
+        ret = nvs_commit(handle);
+    }
+    nvs_close(handle);
+    return ret;
+}
+
+static esp_err_t erase_record(uint16_t device_id)
+{
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(NVS_NAMESPACE_REGISTRY, NVS_READWRITE, &handle);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    char key[DEVICE_KEY_LEN];
+    make_device_key(device_id, key);
+    ret = nvs_erase_key(handle, key);
+    if (ret == ESP_ERR_NVS_NOT_FOUND) {
+        ret = ESP_OK;
+    }
+    if (ret == ESP_OK) {
+        ret = nvs_commit(handle);
+    }
+    nvs_close(handle);
+
     if (ret == ESP_OK) {
-        size_t count = (config.device_count < MAX_PAIRED_DEVICES) ? config.device_count : MAX_PAIRED_DEVICES;
-        memcpy(runtime_devices, config.devices, count * sizeof(paired_device_t));
+        seq_journal_backend_t backend;
+        sequence_store_nvs_ctx_t ctx;
+        sequence_backend(device_id, &backend, &ctx);
+        sequence_store_nvs_erase(&ctx);
+    }
+    return ret;
+}
+
+// Caller must hold registry_mutex
+static esp_err_t insert_device(const device_record_t *record)
+{
+    if (device_count >= MAX_PAIRED_DEVICES) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    registry_entry_t *entry = &entries[device_count];
+    memset(entry, 0, sizeof(*entry));
+    entry->seq_epoch = ++seq_epoch_counter;
+
+    paired_device_t *device = &entry->device;
+    device->device_id       = record->device_id;
+    memcpy(device->device_name, record->device_name, DEVICE_NAME_MAX_LEN);
+    device->device_name[DEVICE_NAME_MAX_LEN - 1] = '\0';
+    memcpy(device->mac_address, record->mac_address, DEVICE_MAC_ADDR_LEN);
+    memcpy(device->aes_key, record->aes_key, DEVICE_AES_KEY_LEN);
+
+    esp_err_t ret = device_index_put(&device_index, record->device_id, (uint16_t)device_count);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    device_count++;
+    return ESP_OK;
+}
+
+/**
+ * @brief Convert the legacy single-blob registry into per-device records
+ */
+static void migrate_legacy_registry(void)
+{
+    nvs_handle_t handle;
+    if (nvs_open(NVS_NAMESPACE_REGISTRY, NVS_READWRITE, &handle) != ESP_OK) {
+        return;
+    }
+
+    device_registry_config_t legacy;
+    size_t size   = sizeof(legacy);
+    esp_err_t ret = nvs_get_blob(handle, LEGACY_REGISTRY_KEY, &legacy, &size);
+    if (ret != ESP_OK || size != sizeof(legacy)) {
+        nvs_close(handle);
+        return;
+    }
+
+    size_t legacy_count = legacy.device_count;
+    size_t legacy_max   = sizeof(legacy.devices) / sizeof(legacy.devices[0]);
+    if (legacy_count > legacy_max) {
+        legacy_count = legacy_max;
+    }
+
+    ESP_LOGI(TAG, "Migrating %zu device(s) from legacy registry blob", legacy_count);
+
+    for (size_t i = 0; i < legacy_count; i++) {
+        device_record_t record;
+        record_from_device(&legacy.devices[i], &record);
+
+        char key[DEVICE_KEY_LEN];
+        make_device_key(record.device_id, key);
+        ret = nvs_set_blob(handle, key, &record, sizeof(record));
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Migration of device 0x%04X failed: %s", record.device_id, esp_err_to_name(ret));
+            nvs_close(handle);
+            return; // Keep legacy blob so migration is retried on next boot
+        }
+    }
+
+    nvs_erase_key(handle, LEGACY_REGISTRY_KEY);
+    nvs_commit(handle);
+    nvs_close(handle);
+}
+
+/**
+ * @brief Resume the replay window from the last durable snapshot
+ *
+ * Everything up to the end of the snapshot's block is treated as already seen
+ * (replay_window_restore()); a sender that did not reboot meanwhile resyncs by
+ * skipping a block (lora_protocol.c).
+ */
+static void restore_sequence(registry_entry_t *entry)
+{
+    seq_journal_backend_t backend;
+    sequence_store_nvs_ctx_t ctx;
+    sequence_backend(entry->device.device_id, &backend, &ctx);
+
+    if (seq_journal_open(&entry->seq_journal, &backend) == ESP_OK) {
+        replay_window_t window;
+        replay_window_restore(&window, (uint16_t)entry->seq_journal.value);
+        entry->device.highest_sequence = window.highest;
+        entry->device.recent_bitmap    = window.recent;
+    }
+}
+
+static void load_devices(void)
+{
+    nvs_iterator_t it = NULL;
+    esp_err_t ret     = nvs_entry_find(NVS_DEFAULT_PART_NAME, NVS_NAMESPACE_REGISTRY, NVS_TYPE_BLOB, &it);
+    if (ret != ESP_OK) {
+        return; // Empty namespace
+    }
+
+    nvs_handle_t handle;
+    if (nvs_open(NVS_NAMESPACE_REGISTRY, NVS_READONLY, &handle) != ESP_OK) {
+        nvs_release_iterator(it);
+        return;
+    }
+
+    while (ret == ESP_OK) {
+        nvs_entry_info_t info;
+        nvs_entry_info(it, &info);
+
+        if (strncmp(info.key, DEVICE_KEY_PREFIX, strlen(DEVICE_KEY_PREFIX)) == 0) {
+            device_record_t record;
+            size_t size = sizeof(record);
+            if (nvs_get_blob(handle, info.key, &record, &size) == ESP_OK && size == sizeof(record)) {
+                if (insert_device(&record) != ESP_OK) {
+                    ESP_LOGW(TAG, "Registry full, ignoring stored device 0x%04X", record.device_id);
+                } else {
+                    restore_sequence(&entries[device_count - 1]);
+                }
+            } else {
+                ESP_LOGW(TAG, "Skipping malformed registry entry %s", info.key);
+            }
+        }
+
+        ret = nvs_entry_next(&it);
     }
-    runtime_loaded = true;
+
+    nvs_release_iterator(it);
+    nvs_close(handle);
 }
 
+// config_manager validates and resets the registry through these (it cannot depend on this component)
+static const config_registry_ops_t registry_ops = {
+    .count = device_registry_get_count,
+    .list  = device_registry_list,
+    .clear = device_registry_clear,
+};
+
 esp_err_t device_registry_init(void)
 {
-    ESP_LOGI(TAG, "Initializing simplified device registry (max %d devices)", MAX_PAIRED_DEVICES);
-    load_runtime_data();
+    if (registry_initialized) {
+        return ESP_OK;
+    }
+
+    ESP_LOGI(TAG, "Initializing device registry (max %d devices)", MAX_PAIRED_DEVICES);
+
+    CREATE_MUTEX_OR_FAIL(registry_mutex);
+
+    esp_err_t ret = device_index_init(&device_index, index_buckets, sizeof(index_buckets) / sizeof(index_buckets[0]));
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    ret = sequence_store_init();
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    device_count = 0;
+    migrate_legacy_registry();
+    load_devices();
+
+    registry_initialized = true;
+    sequence_store_register_flusher(device_registry_flush_sequences);
+    config_manager_register_registry(&registry_ops);
+    ESP_LOGI(TAG, "Loaded %zu paired device(s)", device_count);
     return ESP_OK;
 }
 
@@ -39,61 +309,58 @@ esp_err_t device_registry_add(uint16_t device_id, const char *device_name, const
     if (!device_name || !mac_address || !aes_key) {
         return ESP_ERR_INVALID_ARG;
     }
+    CHECK_INITIALIZED(registry_initialized, "Device registry");
 
-    load_runtime_data();
+    device_record_t record = {.device_id = device_id};
+    strncpy(record.device_name, device_name, DEVICE_NAME_MAX_LEN - 1);
+    memcpy(record.mac_address, mac_address, DEVICE_MAC_ADDR_LEN);
+    memcpy(record.aes_key, aes_key, DEVICE_AES_KEY_LEN);
 
-    // Get current config
-    device_registry_config_t config;
-    esp_err_t ret = config_manager_get_device_registry(&config);
-    if (ret != ESP_OK) {
-        memset(&config, 0, sizeof(config));
+    registry_lock();
+
+    int slot = device_index_find(&device_index, device_id);
+    if (slot < 0 && device_count >= MAX_PAIRED_DEVICES) {
+        registry_unlock();
+        ESP_LOGE(TAG, "Registry full (max %d devices)", MAX_PAIRED_DEVICES);
+        return ESP_ERR_NO_MEM;
     }
 
-    // Check if device already exists (update case)
-    int existing_index = -1;
-    for (size_t i = 0; i < config.device_count; i++) {
-        if (config.devices[i].device_id == device_id) {
-            existing_index = i;
-            break;
-        }
+    // Persist first so RAM never holds a device that is not in flash
+    esp_err_t ret = store_record(&record);
+    if (ret != ESP_OK) {
+        registry_unlock();
+        ESP_LOGE(TAG, "Failed to save device 0x%04X: %s", device_id, esp_err_to_name(ret));
+        return ret;
     }
 
-    if (existing_index >= 0) {
-        // Update existing device
-        strncpy(config.devices[existing_index].device_name, device_name, DEVICE_NAME_MAX_LEN - 1);
-        config.devices[existing_index].device_name[DEVICE_NAME_MAX_LEN - 1] = '\0';
-        memcpy(config.devices[existing_index].mac_address, mac_address, DEVICE_MAC_ADDR_LEN);
-        memcpy(config.devices[existing_index].aes_key, aes_key, DEVICE_AES_KEY_LEN);
+    if (slot >= 0) {
+        // Re-paired (a factory-reset presenter counts from 0 again): its old replay window would drop everything
+        registry_entry_t *entry = &entries[slot];
+        paired_device_t *device = &entry->device;
+        memcpy(device->device_name, record.device_name, DEVICE_NAME_MAX_LEN);
+        memcpy(device->mac_address, record.mac_address, DEVICE_MAC_ADDR_LEN);
+        memcpy(device->aes_key, record.aes_key, DEVICE_AES_KEY_LEN);
+        device->highest_sequence = 0;
+        device->recent_bitmap    = 0;
+        memset(&entry->seq_journal, 0, sizeof(entry->seq_journal));
+        entry->seq_dirty = false;
+        entry->seq_epoch = ++seq_epoch_counter;
+
+        seq_journal_backend_t backend;
+        sequence_store_nvs_ctx_t ctx;
+        sequence_backend(device_id, &backend, &ctx);
+        sequence_store_nvs_erase(&ctx);
     } else {
-        // Add new device
-        if (config.device_count >= MAX_PAIRED_DEVICES) {
-            ESP_LOGE(TAG, "Registry full (max %d devices)", MAX_PAIRED_DEVICES);
-            return ESP_ERR_NO_MEM;
-        }
-
-        paired_device_t *new_device = &config.devices[config.device_count];
-        new_device->device_id = device_id;
-        strncpy(new_device->device_name, device_name, DEVICE_NAME_MAX_LEN - 1);
-        new_device->device_name[DEVICE_NAME_MAX_LEN - 1] = '\0';
-        memcpy(new_device->mac_address, mac_address, DEVICE_MAC_ADDR_LEN);
-        memcpy(new_device->aes_key, aes_key, DEVICE_AES_KEY_LEN);
-        new_device->highest_sequence = 0;
-        new_device->recent_bitmap = 0;
-        config.device_count++;
+        ret = insert_device(&record);
     }
 
-    // Save to NVS
-    ret = config_manager_set_device_registry(&config);
+    registry_unlock();
+
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to save device registry");
         return ret;
     }
 
-    // Update runtime data
-    memcpy(runtime_devices, config.devices, config.device_count * sizeof(paired_device_t));
-
-    ESP_LOGI(TAG, "Device 0x%04X (%s) %s", device_id, device_name, 
-             (existing_index >= 0) ? "updated" : "added");
+    ESP_LOGI(TAG, "Device 0x%04X (%s) %s", device_id, record.device_name, (slot >= 0) ? "updated" : "added");
     return ESP_OK;
 }
 
@@ -102,107 +369,205 @@ esp_err_t device_registry_get(uint16_t device_id, paired_device_t *device)
     if (!device) {
         return ESP_ERR_INVALID_ARG;
     }
+    CHECK_INITIALIZED(registry_initialized, "Device registry");
 
-    load_runtime_data();
-
-    // Linear search through runtime data (includes sequence tracking)
-    for (size_t i = 0; i < MAX_PAIRED_DEVICES; i++) {
-        if (runtime_devices[i].device_id == device_id && runtime_devices[i].device_id != 0) {
-            memcpy(device, &runtime_devices[i], sizeof(paired_device_t));
-            return ESP_OK;
-        }
+    registry_lock();
+    int slot = device_index_find(&device_index, device_id);
+    if (slot >= 0) {
+        memcpy(device, &entries[slot].device, sizeof(paired_device_t));
     }
+    registry_unlock();
 
-    return ESP_ERR_NOT_FOUND;
+    return (slot >= 0) ? ESP_OK : ESP_ERR_NOT_FOUND;
 }
 
 esp_err_t device_registry_update_sequence(uint16_t device_id, uint16_t highest_sequence, uint64_t recent_bitmap)
 {
-    load_runtime_data();
+    CHECK_INITIALIZED(registry_initialized, "Device registry");
 
-    // Update runtime data only (not persisted to save flash wear)
-    for (size_t i = 0; i < MAX_PAIRED_DEVICES; i++) {
-        if (runtime_devices[i].device_id == device_id) {
-            runtime_devices[i].highest_sequence = highest_sequence;
-            runtime_devices[i].recent_bitmap = recent_bitmap;
-            return ESP_OK;
-        }
+    bool flush_now = false;
+
+    registry_lock();
+    int slot = device_index_find(&device_index, device_id);
+    if (slot >= 0) {
+        registry_entry_t *entry       = &entries[slot];
+        entry->device.highest_sequence = highest_sequence;
+        entry->device.recent_bitmap    = recent_bitmap;
+        entry->seq_dirty               = true;
+
+        // Snapshot immediately on first packet or after a full block, otherwise coalesce
+        flush_now = !seq_journal_has_value(&entry->seq_journal) ||
+                    seq_journal_block_crossed((uint16_t)entry->seq_journal.value, highest_sequence);
+    }
+    registry_unlock();
+
+    if (flush_now) {
+        sequence_store_request_flush();
     }
 
-    return ESP_ERR_NOT_FOUND;
+    return (slot >= 0) ? ESP_OK : ESP_ERR_NOT_FOUND;
 }
 
-esp_err_t device_registry_remove(uint16_t device_id)
+void device_registry_flush_sequences(void)
 {
-    load_runtime_data();
-
-    device_registry_config_t config;
-    esp_err_t ret = config_manager_get_device_registry(&config);
-    if (ret != ESP_OK) {
-        return ret;
+    if (!registry_initialized) {
+        return;
     }
 
-    // Find and remove device
-    bool found = false;
-    for (size_t i = 0; i < config.device_count; i++) {
-        if (config.devices[i].device_id == device_id) {
-            // Shift remaining devices
-            memmove(&config.devices[i], &config.devices[i + 1], 
-                    (config.device_count - i - 1) * sizeof(paired_device_t));
-            config.device_count--;
-            found = true;
-            break;
+    // One device per lock hold: NVS writes must not stall the RX hot path
+    while (1) {
+        uint16_t device_id = 0;
+        uint16_t highest   = 0;
+        uint32_t epoch     = 0;
+        seq_journal_t journal;
+        bool found = false;
+
+        registry_lock();
+        for (size_t i = 0; i < device_count; i++) {
+            if (entries[i].seq_dirty) {
+                entries[i].seq_dirty = false;
+                device_id            = entries[i].device.device_id;
+                highest              = entries[i].device.highest_sequence;
+                journal              = entries[i].seq_journal;
+                epoch                = entries[i].seq_epoch;
+                found                = true;
+                break;
+            }
+        }
+        registry_unlock();
+
+        if (!found) {
+            return;
+        }
+
+        seq_journal_backend_t backend;
+        sequence_store_nvs_ctx_t ctx;
+        sequence_backend(device_id, &backend, &ctx);
+        esp_err_t ret = seq_journal_write(&journal, &backend, highest);
+
+        registry_lock();
+        int slot   = device_index_find(&device_index, device_id);
+        bool stale = slot < 0 || entries[slot].seq_epoch != epoch;
+        if (!stale) {
+            if (ret == ESP_OK) {
+                entries[slot].seq_journal = journal;
+            } else {
+                entries[slot].seq_dirty = true; // Retry on next flush
+            }
+        }
+        registry_unlock();
+
+        if (stale && ret == ESP_OK) {
+            sequence_store_nvs_erase(&ctx); // Device was removed or re-paired while the snapshot was written
+        }
+
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "Sequence snapshot for 0x%04X failed: %s", device_id, esp_err_to_name(ret));
+            return;
         }
     }
+}
+
+esp_err_t device_registry_remove(uint16_t device_id)
+{
+    CHECK_INITIALIZED(registry_initialized, "Device registry");
+
+    registry_lock();
 
-    if (!found) {
+    int slot = device_index_find(&device_index, device_id);
+    if (slot < 0) {
+        registry_unlock();
         return ESP_ERR_NOT_FOUND;
     }
 
-    // Save updated config
-    ret = config_manager_set_device_registry(&config);
+    esp_err_t ret = erase_record(device_id);
     if (ret != ESP_OK) {
+        registry_unlock();
+        ESP_LOGE(TAG, "Failed to erase device 0x%04X: %s", device_id, esp_err_to_name(ret));
         return ret;
     }
 
-    // Update runtime data
-    memset(runtime_devices, 0, sizeof(runtime_devices));
-    memcpy(runtime_devices, config.devices, config.device_count * sizeof(paired_device_t));
+    // Swap-remove: move last device into the freed slot and re-point its index entry
+    device_index_remove(&device_index, device_id);
+    size_t last = device_count - 1;
+    if ((size_t)slot != last) {
+        entries[slot] = entries[last];
+        device_index_put(&device_index, entries[slot].device.device_id, (uint16_t)slot);
+    }
+    memset(&entries[last], 0, sizeof(registry_entry_t));
+    device_count--;
+
+    registry_unlock();
 
     ESP_LOGI(TAG, "Device 0x%04X removed", device_id);
     return ESP_OK;
 }
 
-esp_err_t device_registry_list(paired_device_t *devices, size_t max_devices, size_t *count)
+esp_err_t device_registry_clear(void)
 {
-    if (!devices || !count) {
-        return ESP_ERR_INVALID_ARG;
+    CHECK_INITIALIZED(registry_initialized, "Device registry");
+
+    registry_lock();
+
+    esp_err_t result = ESP_OK;
+    size_t kept      = 0;
+    for (size_t i = 0; i < device_count; i++) {
+        esp_err_t ret = erase_record(entries[i].device.device_id);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to erase device 0x%04X: %s", entries[i].device.device_id, esp_err_to_name(ret));
+            entries[kept++] = entries[i];
+            result          = ret;
+        }
     }
 
-    device_registry_config_t config;
-    esp_err_t ret = config_manager_get_device_registry(&config);
-    if (ret != ESP_OK) {
+    // Compact the survivors and rebuild the index around them
+    device_index_clear(&device_index);
+    for (size_t i = 0; i < kept; i++) {
+        device_index_put(&device_index, entries[i].device.device_id, (uint16_t)i);
+    }
+    memset(&entries[kept], 0, (device_count - kept) * sizeof(registry_entry_t));
+    device_count = kept;
+
+    registry_unlock();
+
+    ESP_LOGI(TAG, "Registry cleared (%zu device(s) kept)", kept);
+    return result;
+}
+
+esp_err_t device_registry_list(paired_device_t *out_devices, size_t max_devices, size_t *count)
+{
+    if (!out_devices || !count) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!registry_initialized) {
         *count = 0;
         return ESP_OK;
     }
 
-    *count = (config.device_count < max_devices) ? config.device_count : max_devices;
-    memcpy(devices, config.devices, *count * sizeof(paired_device_t));
+    registry_lock();
+    *count = (device_count < max_devices) ? device_count : max_devices;
+    for (size_t i = 0; i < *count; i++) {
+        out_devices[i] = entries[i].device;
+    }
+    registry_unlock();
 
     return ESP_OK;
 }
 
 bool device_registry_is_paired(uint16_t device_id)
 {
-    paired_device_t device;
-    return (device_registry_get(device_id, &device) == ESP_OK);
+    if (!registry_initialized) {
+        return false;
+    }
+
+    registry_lock();
+    bool paired = device_index_find(&device_index, device_id) >= 0;
+    registry_unlock();
+
+    return paired;
 }
 
 size_t device_registry_get_count(void)
 {
-    device_registry_config_t config;
-    if (config_manager_get_device_registry(&config) != ESP_OK) {
-        return 0;
-    }
-    return config.device_count;
+    return registry_initialized ? device_count : 0;
 }
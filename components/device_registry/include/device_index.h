@@ -0,0 +1,83 @@
+/**
+ * @file device_index.h
+ * @brief Fixed-size hash index mapping device IDs to registry slots
+ *
+ * CONTEXT: O(1) device lookup on the LoRa RX hot path
+ * STORAGE: Caller-provided bucket array (no heap), open addressing with linear probing
+ * REMOVAL: Backward-shift deletion, so lookups never walk tombstones
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DEVICE_INDEX_EMPTY_SLOT 0xFFFF
+
+/**
+ * @brief Bucket count for a given capacity (power of two, load factor <= 0.5)
+ */
+#define DEVICE_INDEX_BUCKETS(capacity)                                                                                 \
+    ((capacity) <= 4     ? 8                                                                                           \
+     : (capacity) <= 8   ? 16                                                                                          \
+     : (capacity) <= 16  ? 32                                                                                          \
+     : (capacity) <= 32  ? 64                                                                                          \
+     : (capacity) <= 64  ? 128                                                                                         \
+     : (capacity) <= 128 ? 256                                                                                         \
+                         : 512)
+
+typedef struct {
+    uint16_t device_id;
+    uint16_t slot; ///< Registry slot, DEVICE_INDEX_EMPTY_SLOT if bucket is free
+} device_index_bucket_t;
+
+typedef struct {
+    device_index_bucket_t *buckets;
+    size_t bucket_mask; ///< bucket_count - 1
+    size_t count;
+} device_index_t;
+
+/**
+ * @brief Initialize index over caller-provided storage
+ *
+ * @param index Index to initialize
+ * @param buckets Bucket storage
+ * @param bucket_count Number of buckets (must be a power of two)
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if bucket_count is not a power of two
+ */
+esp_err_t device_index_init(device_index_t *index, device_index_bucket_t *buckets, size_t bucket_count);
+
+/**
+ * @brief Remove all entries
+ */
+void device_index_clear(device_index_t *index);
+
+/**
+ * @brief Insert or update mapping device_id -> slot
+ *
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if the index is at its load limit
+ */
+esp_err_t device_index_put(device_index_t *index, uint16_t device_id, uint16_t slot);
+
+/**
+ * @brief Look up registry slot for device_id
+ *
+ * @return Slot number, or -1 if not present
+ */
+int device_index_find(const device_index_t *index, uint16_t device_id);
+
+/**
+ * @brief Remove mapping for device_id
+ *
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if not present
+ */
+esp_err_t device_index_remove(device_index_t *index, uint16_t device_id);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,15 +1,16 @@
 /**
  * @file device_registry.h
- * @brief Simplified device registry for managing up to 4 paired presenters
+ * @brief Device registry for paired presenters with per-device AES keys
  *
- * CONTEXT: Simplified for typical use case of max 4 presenters
+ * CONTEXT: One receiver may serve a pool of shared presenters (capacity via Kconfig)
  * PURPOSE: Store and manage paired devices with per-device AES keys
- * STORAGE: Single NVS blob via config_manager
+ * STORAGE: One NVS key per device, RAM copy indexed by device_id for O(1) lookup
  */
 
 #pragma once
 
 #include "config_manager.h"
+#include "sdkconfig.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -18,7 +19,12 @@ extern "C" {
 #define DEVICE_NAME_MAX_LEN 32
 #define DEVICE_AES_KEY_LEN 32 // AES-256 requires 32 bytes
 #define DEVICE_MAC_ADDR_LEN 6
-#define MAX_PAIRED_DEVICES 4 // Simplified for typical presentation use case
+
+#ifdef CONFIG_LORACUE_MAX_PAIRED_DEVICES
+#define MAX_PAIRED_DEVICES CONFIG_LORACUE_MAX_PAIRED_DEVICES
+#else
+#define MAX_PAIRED_DEVICES 32
+#endif
 
 /**
  * @brief Initialize device registry
@@ -45,11 +51,18 @@ esp_err_t device_registry_add(uint16_t device_id, const char *device_name, const
  * @param device_id Device ID to lookup
  * @param device Output device information
  * @return ESP_OK if found, ESP_ERR_NOT_FOUND if not found
+ *
+ * @note O(1) hash lookup, no flash access (safe for the RX hot path)
  */
 esp_err_t device_registry_get(uint16_t device_id, paired_device_t *device);
 
 /**
- * @brief Update sequence tracking for deduplication (RAM-only, not persisted)
+ * @brief Update sequence tracking for deduplication
+ *
+ * Updates RAM immediately; highest_sequence is snapshotted to NVS by the
+ * sequence store task (coalesced, immediately after each 256-sequence block).
+ * After reboot the window resumes at the last snapshot with all older
+ * sequences treated as seen.
  *
  * @param device_id Device ID
  * @param highest_sequence Highest sequence number seen
@@ -58,6 +71,13 @@ esp_err_t device_registry_get(uint16_t device_id, paired_device_t *device);
  */
 esp_err_t device_registry_update_sequence(uint16_t device_id, uint16_t highest_sequence, uint64_t recent_bitmap);
 
+/**
+ * @brief Persist pending replay-window snapshots now (blocking)
+ *
+ * Called from the sequence store task; call directly before sleep or restart.
+ */
+void device_registry_flush_sequences(void);
+
 /**
  * @brief Remove device from registry
  *
@@ -66,6 +86,13 @@ esp_err_t device_registry_update_sequence(uint16_t device_id, uint16_t highest_s
  */
 esp_err_t device_registry_remove(uint16_t device_id);
 
+/**
+ * @brief Remove all devices, with their NVS records and sequence journals
+ *
+ * @return ESP_OK on success; devices whose record could not be erased stay paired
+ */
+esp_err_t device_registry_clear(void);
+
 /**
  * @brief Get list of all paired devices
  *
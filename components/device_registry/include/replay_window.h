@@ -0,0 +1,71 @@
+/**
+ * @file replay_window.h
+ * @brief Per-device sliding window over received sequence numbers
+ *
+ * CONTEXT: lora_protocol.c rejects replayed and duplicated packets on the RX hot path
+ * STATE: Highest sequence seen plus a bitmap of the REPLAY_WINDOW_RECENT before it; distance is
+ *        modulo 2^16, so wrap-around is forward progress. recent == 0 means nothing seen yet:
+ *        the next sequence starts the window, as for a new or re-paired device
+ * USAGE: Pure C; device_registry keeps the state per device and journals highest to NVS
+ *
+ * A sender behind the window is locked out, not treated as restarted: a replayed capture looks
+ * the same. It is accepted again once its sequence passes the highest seen, or after it is
+ * re-paired (device_registry_add() resets the window). Senders never go back on their own: they
+ * resume above their journaled reservation, and skip a block when a receiver that rebooted
+ * stops acknowledging (lora_protocol_send_reliable()). A presenter whose NVS was wiped has lost
+ * its key as well and has to be re-paired anyway.
+ */
+
+#pragma once
+
+#include "seq_journal.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define REPLAY_WINDOW_GAP 64    ///< A jump this far ahead starts the window over
+#define REPLAY_WINDOW_RECENT 32 ///< Sequences this far behind the highest are still accepted once
+
+typedef struct {
+    uint16_t highest; ///< Highest sequence seen
+    uint64_t recent;  ///< Bit i: highest - i was seen; 0 before the first packet
+} replay_window_t;
+
+typedef enum {
+    REPLAY_WINDOW_FIRST,        ///< First packet: starts the window
+    REPLAY_WINDOW_NEW,          ///< Ahead of the highest
+    REPLAY_WINDOW_JUMP,         ///< At least REPLAY_WINDOW_GAP ahead: loss, or a sender resuming from its next block
+    REPLAY_WINDOW_OUT_OF_ORDER, ///< Behind the highest but inside the window, not seen before
+    REPLAY_WINDOW_DUPLICATE,    ///< Already seen
+    REPLAY_WINDOW_STALE,        ///< Behind the window, or more than half the sequence space ahead: a replay
+} replay_window_result_t;
+
+/**
+ * @brief Check a sequence and record it if accepted
+ */
+replay_window_result_t replay_window_check(replay_window_t *window, uint16_t sequence);
+
+/**
+ * @brief Whether a check result lets the packet through
+ */
+static inline bool replay_window_accepted(replay_window_result_t result)
+{
+    return result <= REPLAY_WINDOW_OUT_OF_ORDER;
+}
+
+/**
+ * @brief Resume from a journaled high-water mark after a reboot
+ *
+ * The receiver journals its highest sequence only when it has moved a block past the last
+ * snapshot (seq_journal_block_crossed()), so up to a block beyond the snapshot may have been
+ * accepted. As the sender does with its reservations, everything up to the end of that block
+ * counts as seen.
+ */
+void replay_window_restore(replay_window_t *window, uint16_t journaled);
+
+#ifdef __cplusplus
+}
+#endif
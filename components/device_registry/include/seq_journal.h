@@ -0,0 +1,150 @@
+/**
+ * @file seq_journal.h
+ * @brief Power-loss safe journal for sequence high-water marks
+ *
+ * CONTEXT: Replay protection state must survive reboots without one flash write per packet
+ * FORMAT: Two alternating slots {generation, value, crc32}; the newest valid slot wins,
+ *         so a write torn by power loss falls back to the previous record
+ * USAGE: TX side reserves sequence blocks ahead of use, RX side snapshots highest seen
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SEQ_JOURNAL_BLOCK_SIZE 256                         ///< Sequences reserved per journal write
+#define SEQ_JOURNAL_LOW_WATER (SEQ_JOURNAL_BLOCK_SIZE / 2) ///< Remaining reservation that triggers refill
+#define SEQ_JOURNAL_SLOTS 2
+
+/**
+ * @brief On-flash journal record
+ */
+typedef struct {
+    uint32_t generation; ///< Monotonic write counter, 0 = never written
+    uint32_t value;      ///< Journaled value
+    uint32_t crc;        ///< CRC32 over generation and value
+} seq_journal_record_t;
+
+/**
+ * @brief Storage backend for journal slots
+ */
+typedef struct {
+    esp_err_t (*read)(void *ctx, uint8_t slot, seq_journal_record_t *record);
+    esp_err_t (*write)(void *ctx, uint8_t slot, const seq_journal_record_t *record);
+    void *ctx;
+} seq_journal_backend_t;
+
+/**
+ * @brief Journal state (RAM), kept small so one can be held per paired device
+ */
+typedef struct {
+    uint32_t generation; ///< Generation of newest durable record (0 = empty)
+    uint32_t value;      ///< Newest durable value
+    uint8_t active_slot; ///< Slot holding the newest durable record
+} seq_journal_t;
+
+/**
+ * @brief TX sequence allocator backed by block reservations
+ *
+ * Invariant: every sequence handed out is < reserved, and reserved is durable,
+ * so after power loss the allocator restarts at or above anything ever sent.
+ */
+typedef struct {
+    seq_journal_t journal;
+    uint32_t next;     ///< Next sequence to hand out
+    uint32_t reserved; ///< Exclusive upper bound of the durable reservation
+} seq_reservation_t;
+
+/**
+ * @brief Compute record CRC
+ */
+uint32_t seq_journal_record_crc(const seq_journal_record_t *record);
+
+/**
+ * @brief Restore newest valid record from backend
+ *
+ * @return ESP_OK if a value was restored, ESP_ERR_NOT_FOUND if journal is empty (still usable)
+ */
+esp_err_t seq_journal_open(seq_journal_t *journal, const seq_journal_backend_t *backend);
+
+/**
+ * @brief Append value to journal (writes the inactive slot)
+ *
+ * On failure the previous record stays authoritative and journal state is unchanged.
+ */
+esp_err_t seq_journal_write(seq_journal_t *journal, const seq_journal_backend_t *backend, uint32_t value);
+
+/**
+ * @brief Check whether a journal holds a value
+ */
+static inline bool seq_journal_has_value(const seq_journal_t *journal)
+{
+    return journal->generation != 0;
+}
+
+/**
+ * @brief Check whether a 16-bit RX sequence has advanced a full block past its last snapshot
+ */
+static inline bool seq_journal_block_crossed(uint16_t persisted, uint16_t highest)
+{
+    return (uint16_t)(highest - persisted) >= SEQ_JOURNAL_BLOCK_SIZE &&
+           (uint16_t)(highest - persisted) < 0x8000; // Only forward progress counts
+}
+
+/**
+ * @brief Initialize allocator and make the first reservation durable
+ *
+ * Resumes at the restored reservation (skipping any unused remainder) or at seed
+ * on first boot.
+ *
+ * @return ESP_OK on success, backend error if the reservation could not be written
+ */
+esp_err_t seq_reservation_init(seq_reservation_t *res, const seq_journal_backend_t *backend, uint32_t seed);
+
+/**
+ * @brief Resume allocator at a counter retained outside flash (RTC memory across deep sleep)
+ *
+ * Continues at next without burning the unused part of the reservation, as long as next
+ * lies inside the durable reservation; otherwise behaves like seq_reservation_init().
+ * Writes the journal only if the remaining reservation is below the low-water mark.
+ *
+ * @param next Retained next sequence (everything below it may have been sent)
+ * @param seed First-boot start value when the journal is empty
+ */
+esp_err_t seq_reservation_resume(seq_reservation_t *res, const seq_journal_backend_t *backend, uint32_t next,
+                                 uint32_t seed);
+
+/**
+ * @brief Take the next sequence number
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if the reservation is exhausted
+ *         (caller must seq_reservation_extend() first)
+ */
+esp_err_t seq_reservation_take(seq_reservation_t *res, uint32_t *sequence);
+
+/**
+ * @brief Check whether remaining reservation is below the low-water mark
+ */
+bool seq_reservation_needs_extend(const seq_reservation_t *res);
+
+/**
+ * @brief Reserve the next block (one journal write)
+ */
+esp_err_t seq_reservation_extend(seq_reservation_t *res, const seq_journal_backend_t *backend);
+
+/**
+ * @brief Move the next sequence count ahead, reserving past it first
+ *
+ * On failure next is unchanged; any block that did get reserved is kept.
+ */
+esp_err_t seq_reservation_skip(seq_reservation_t *res, const seq_journal_backend_t *backend, uint32_t count);
+
+#ifdef __cplusplus
+}
+#endif
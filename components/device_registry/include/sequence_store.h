@@ -0,0 +1,78 @@
+/**
+ * @file sequence_store.h
+ * @brief NVS-backed sequence journals with deferred, coalesced writes
+ *
+ * CONTEXT: Replay-window state and TX sequence reservations must survive reboots
+ * PURPOSE: Provide NVS journal backends and a low-priority task that performs
+ *          journal writes off the LoRa RX/TX hot paths
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include "seq_journal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SEQUENCE_STORE_KEY_MAX_LEN 16 // NVS key limit incl. NUL
+#define SEQUENCE_STORE_MAX_FLUSHERS 4
+
+/**
+ * @brief NVS location of one journal (two keys: "<base>a" and "<base>b")
+ */
+typedef struct {
+    const char *nvs_namespace;
+    char key_base[SEQUENCE_STORE_KEY_MAX_LEN - 1];
+} sequence_store_nvs_ctx_t;
+
+/**
+ * @brief Deferred flush callback, runs in the sequence store task
+ */
+typedef void (*sequence_store_flush_fn_t)(void);
+
+/**
+ * @brief Start the background flush task (idempotent)
+ *
+ * @return ESP_OK on success
+ */
+esp_err_t sequence_store_init(void);
+
+/**
+ * @brief Bind a journal backend to an NVS namespace/key pair
+ *
+ * @param backend Backend to fill in
+ * @param ctx Context storage, must outlive the backend
+ * @param nvs_namespace NVS namespace
+ * @param key_base Key prefix (max 14 chars, slot letter is appended)
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if key_base is too long
+ */
+esp_err_t sequence_store_nvs_backend(seq_journal_backend_t *backend, sequence_store_nvs_ctx_t *ctx,
+                                     const char *nvs_namespace, const char *key_base);
+
+/**
+ * @brief Erase both journal slots
+ */
+esp_err_t sequence_store_nvs_erase(const sequence_store_nvs_ctx_t *ctx);
+
+/**
+ * @brief Register a flush callback (called periodically and on request)
+ *
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if all flusher slots are used
+ */
+esp_err_t sequence_store_register_flusher(sequence_store_flush_fn_t fn);
+
+/**
+ * @brief Wake the background task to flush now (non-blocking)
+ */
+void sequence_store_request_flush(void);
+
+/**
+ * @brief Run all flushers synchronously in the calling task (before sleep/restart)
+ */
+void sequence_store_flush_now(void);
+
+#ifdef __cplusplus
+}
+#endif
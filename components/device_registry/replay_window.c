@@ -0,0 +1,46 @@
+/**
+ * @file replay_window.c
+ * @brief Sliding window replay and duplicate detection
+ */
+
+#include "replay_window.h"
+
+replay_window_result_t replay_window_check(replay_window_t *window, uint16_t sequence)
+{
+    int16_t diff = (int16_t)(sequence - window->highest);
+
+    if (window->recent == 0) {
+        window->highest = sequence;
+        window->recent  = 1;
+        return REPLAY_WINDOW_FIRST;
+    }
+    if (diff > 0) {
+        replay_window_result_t result = REPLAY_WINDOW_NEW;
+        if (diff < REPLAY_WINDOW_GAP) {
+            window->recent = (window->recent << diff) | 1;
+        } else {
+            window->recent = 1;
+            result         = REPLAY_WINDOW_JUMP;
+        }
+        window->highest = sequence;
+        return result;
+    }
+    if (diff == 0) {
+        return REPLAY_WINDOW_DUPLICATE;
+    }
+    if (diff > -REPLAY_WINDOW_RECENT) {
+        uint64_t bit = 1ULL << -diff;
+        if (window->recent & bit) {
+            return REPLAY_WINDOW_DUPLICATE;
+        }
+        window->recent |= bit;
+        return REPLAY_WINDOW_OUT_OF_ORDER;
+    }
+    return REPLAY_WINDOW_STALE;
+}
+
+void replay_window_restore(replay_window_t *window, uint16_t journaled)
+{
+    window->highest = (uint16_t)(journaled + SEQ_JOURNAL_BLOCK_SIZE - 1);
+    window->recent  = UINT64_MAX;
+}
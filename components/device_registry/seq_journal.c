@@ -0,0 +1,169 @@
+/**
+ * @file seq_journal.c
+ * @brief Double-slot sequence journal and block reservation implementation
+ */
+
+#include "seq_journal.h"
+#include <stddef.h>
+
+#define CRC32_POLY 0xEDB88320u
+
+static uint32_t crc32_update(uint32_t crc, const uint8_t *data, size_t len)
+{
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (CRC32_POLY & (0u - (crc & 1u)));
+        }
+    }
+    return ~crc;
+}
+
+uint32_t seq_journal_record_crc(const seq_journal_record_t *record)
+{
+    const uint8_t bytes[8] = {
+        (uint8_t)(record->generation), (uint8_t)(record->generation >> 8), (uint8_t)(record->generation >> 16),
+        (uint8_t)(record->generation >> 24), (uint8_t)(record->value), (uint8_t)(record->value >> 8),
+        (uint8_t)(record->value >> 16), (uint8_t)(record->value >> 24),
+    };
+    return crc32_update(0, bytes, sizeof(bytes));
+}
+
+static bool record_valid(const seq_journal_record_t *record)
+{
+    return record->generation != 0 && record->crc == seq_journal_record_crc(record);
+}
+
+esp_err_t seq_journal_open(seq_journal_t *journal, const seq_journal_backend_t *backend)
+{
+    if (!journal || !backend || !backend->read) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    journal->generation  = 0;
+    journal->value       = 0;
+    journal->active_slot = 0;
+
+    for (uint8_t slot = 0; slot < SEQ_JOURNAL_SLOTS; slot++) {
+        seq_journal_record_t record;
+        if (backend->read(backend->ctx, slot, &record) != ESP_OK || !record_valid(&record)) {
+            continue; // Missing or torn slot
+        }
+        if (record.generation > journal->generation) {
+            journal->generation  = record.generation;
+            journal->value       = record.value;
+            journal->active_slot = slot;
+        }
+    }
+
+    return seq_journal_has_value(journal) ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t seq_journal_write(seq_journal_t *journal, const seq_journal_backend_t *backend, uint32_t value)
+{
+    if (!journal || !backend || !backend->write) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Never overwrite the newest durable record
+    uint8_t slot = seq_journal_has_value(journal) ? (uint8_t)((journal->active_slot + 1) % SEQ_JOURNAL_SLOTS) : 0;
+
+    seq_journal_record_t record = {
+        .generation = journal->generation + 1,
+        .value      = value,
+    };
+    record.crc = seq_journal_record_crc(&record);
+
+    esp_err_t ret = backend->write(backend->ctx, slot, &record);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    journal->generation  = record.generation;
+    journal->value       = value;
+    journal->active_slot = slot;
+    return ESP_OK;
+}
+
+esp_err_t seq_reservation_init(seq_reservation_t *res, const seq_journal_backend_t *backend, uint32_t seed)
+{
+    if (!res) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = seq_journal_open(&res->journal, backend);
+    if (ret == ESP_OK) {
+        // Unused remainder of the previous reservation may have been partly sent: skip it
+        res->next = res->journal.value;
+    } else if (ret == ESP_ERR_NOT_FOUND) {
+        res->next = seed;
+    } else {
+        return ret;
+    }
+
+    res->reserved = res->next;
+    return seq_reservation_extend(res, backend);
+}
+
+esp_err_t seq_reservation_resume(seq_reservation_t *res, const seq_journal_backend_t *backend, uint32_t next,
+                                 uint32_t seed)
+{
+    if (!res) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = seq_journal_open(&res->journal, backend);
+    if (ret != ESP_OK || (int32_t)(res->journal.value - next) <= 0) {
+        return seq_reservation_init(res, backend, seed);
+    }
+
+    res->next     = next;
+    res->reserved = res->journal.value;
+    return seq_reservation_needs_extend(res) ? seq_reservation_extend(res, backend) : ESP_OK;
+}
+
+esp_err_t seq_reservation_take(seq_reservation_t *res, uint32_t *sequence)
+{
+    if ((int32_t)(res->reserved - res->next) <= 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    *sequence = res->next++;
+    return ESP_OK;
+}
+
+bool seq_reservation_needs_extend(const seq_reservation_t *res)
+{
+    return (int32_t)(res->reserved - res->next) <= SEQ_JOURNAL_LOW_WATER;
+}
+
+esp_err_t seq_reservation_extend(seq_reservation_t *res, const seq_journal_backend_t *backend)
+{
+    uint32_t target = res->reserved + SEQ_JOURNAL_BLOCK_SIZE;
+    esp_err_t ret   = seq_journal_write(&res->journal, backend, target);
+    if (ret == ESP_OK) {
+        res->reserved = target;
+    }
+    return ret;
+}
+
+esp_err_t seq_reservation_skip(seq_reservation_t *res, const seq_journal_backend_t *backend, uint32_t count)
+{
+    if (!res) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    seq_reservation_t moved = *res;
+    moved.next += count;
+    while (seq_reservation_needs_extend(&moved)) {
+        esp_err_t ret = seq_reservation_extend(&moved, backend);
+        if (ret != ESP_OK) {
+            res->journal  = moved.journal;
+            res->reserved = moved.reserved;
+            return ret;
+        }
+    }
+
+    *res = moved;
+    return ESP_OK;
+}
@@ -0,0 +1,179 @@
+/**
+ * @file sequence_store.c
+ * @brief NVS journal backend and deferred flush task
+ */
+
+#include "sequence_store.h"
+#include "common_types.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "nvs.h"
+#include "task_config.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "SEQ_STORE";
+
+#define SEQUENCE_STORE_FLUSH_INTERVAL_MS 30000 // Coalescing window for RX snapshots
+
+static sequence_store_flush_fn_t flushers[SEQUENCE_STORE_MAX_FLUSHERS];
+static size_t flusher_count          = 0;
+static TaskHandle_t store_task       = NULL;
+static SemaphoreHandle_t flush_mutex = NULL;
+
+static void make_slot_key(const sequence_store_nvs_ctx_t *ctx, uint8_t slot, char *key)
+{
+    snprintf(key, SEQUENCE_STORE_KEY_MAX_LEN, "%s%c", ctx->key_base, 'a' + slot);
+}
+
+static esp_err_t nvs_slot_read(void *arg, uint8_t slot, seq_journal_record_t *record)
+{
+    const sequence_store_nvs_ctx_t *ctx = arg;
+
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(ctx->nvs_namespace, NVS_READONLY, &handle);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    char key[SEQUENCE_STORE_KEY_MAX_LEN];
+    make_slot_key(ctx, slot, key);
+    size_t size = sizeof(*record);
+    ret         = nvs_get_blob(handle, key, record, &size);
+    nvs_close(handle);
+
+    if (ret == ESP_OK && size != sizeof(*record)) {
+        ret = ESP_ERR_INVALID_SIZE;
+    }
+    return ret;
+}
+
+static esp_err_t nvs_slot_write(void *arg, uint8_t slot, const seq_journal_record_t *record)
+{
+    const sequence_store_nvs_ctx_t *ctx = arg;
+
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(ctx->nvs_namespace, NVS_READWRITE, &handle);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    char key[SEQUENCE_STORE_KEY_MAX_LEN];
+    make_slot_key(ctx, slot, key);
+    ret = nvs_set_blob(handle, key, record, sizeof(*record));
+    if (ret == ESP_OK) {
+        ret = nvs_commit(handle);
+    }
+    nvs_close(handle);
+    return ret;
+}
+
+esp_err_t sequence_store_nvs_backend(seq_journal_backend_t *backend, sequence_store_nvs_ctx_t *ctx,
+                                     const char *nvs_namespace, const char *key_base)
+{
+    if (!backend || !ctx || !nvs_namespace || !key_base || strlen(key_base) >= sizeof(ctx->key_base)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    ctx->nvs_namespace = nvs_namespace;
+    strncpy(ctx->key_base, key_base, sizeof(ctx->key_base) - 1);
+    ctx->key_base[sizeof(ctx->key_base) - 1] = '\0';
+
+    backend->read  = nvs_slot_read;
+    backend->write = nvs_slot_write;
+    backend->ctx   = ctx;
+    return ESP_OK;
+}
+
+esp_err_t sequence_store_nvs_erase(const sequence_store_nvs_ctx_t *ctx)
+{
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(ctx->nvs_namespace, NVS_READWRITE, &handle);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    for (uint8_t slot = 0; slot < SEQ_JOURNAL_SLOTS; slot++) {
+        char key[SEQUENCE_STORE_KEY_MAX_LEN];
+        make_slot_key(ctx, slot, key);
+        nvs_erase_key(handle, key); // Missing slots are fine
+    }
+    ret = nvs_commit(handle);
+    nvs_close(handle);
+    return ret;
+}
+
+static void run_flushers(void)
+{
+    xSemaphoreTake(flush_mutex, portMAX_DELAY);
+    for (size_t i = 0; i < flusher_count; i++) {
+        flushers[i]();
+    }
+    xSemaphoreGive(flush_mutex);
+}
+
+static void sequence_store_task(void *arg)
+{
+    while (1) {
+        // Wake on explicit request (block crossed, reservation low) or after the coalescing window
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(SEQUENCE_STORE_FLUSH_INTERVAL_MS));
+        run_flushers();
+    }
+}
+
+static void sequence_store_shutdown_handler(void)
+{
+    sequence_store_flush_now();
+}
+
+esp_err_t sequence_store_init(void)
+{
+    if (store_task) {
+        return ESP_OK;
+    }
+
+    CREATE_MUTEX_OR_FAIL(flush_mutex);
+
+    BaseType_t ret =
+        xTaskCreate(sequence_store_task, "seq_store", TASK_STACK_SIZE_MEDIUM, NULL, TASK_PRIORITY_LOW, &store_task);
+    if (ret != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create sequence store task");
+        store_task = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Persist pending snapshots on orderly restart (OTA, factory reset, config reboot)
+    esp_register_shutdown_handler(sequence_store_shutdown_handler);
+
+    ESP_LOGI(TAG, "Sequence store started (flush interval %d ms)", SEQUENCE_STORE_FLUSH_INTERVAL_MS);
+    return ESP_OK;
+}
+
+esp_err_t sequence_store_register_flusher(sequence_store_flush_fn_t fn)
+{
+    if (!fn) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (flusher_count >= SEQUENCE_STORE_MAX_FLUSHERS) {
+        return ESP_ERR_NO_MEM;
+    }
+    flushers[flusher_count++] = fn;
+    return ESP_OK;
+}
+
+void sequence_store_request_flush(void)
+{
+    if (store_task) {
+        xTaskNotifyGive(store_task);
+    }
+}
+
+void sequence_store_flush_now(void)
+{
+    if (flush_mutex) {
+        run_flushers();
+    }
+}
@@ -0,0 +1,123 @@
+/**
+ * @file fast_resume.c
+ * @brief Deep-sleep wake path that transmits the wake keypress first
+ */
+
+#include "fast_resume.h"
+#include "bsp.h"
+#include "config_manager.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_sleep.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "lora_driver.h"
+#include "lora_protocol.h"
+#include "power_mgmt.h"
+#include "presenter_mode_manager.h"
+
+static const char *TAG = "FAST_RESUME";
+
+#define RESUME_MAGIC 0x46525331 // "FRS1"
+
+// Configuration needed before config_manager (and NVS) is up
+typedef struct {
+    uint32_t magic;
+    uint8_t device_mode;
+    uint8_t slot_id;
+} resume_config_t;
+
+static RTC_DATA_ATTR resume_config_t s_config;
+static fast_resume_timing_t s_timing;
+static input_event_t s_wake_event;
+
+static void fast_resume_deep_sleep_cb(void)
+{
+    general_config_t config;
+    if (config_manager_get_general(&config) != ESP_OK) {
+        s_config.magic = 0;
+        return;
+    }
+
+    s_config.device_mode = config.device_mode;
+    s_config.slot_id     = config.slot_id;
+    s_config.magic       = RESUME_MAGIC;
+}
+
+esp_err_t fast_resume_init(void)
+{
+    return power_mgmt_register_deep_sleep_cb(fast_resume_deep_sleep_cb);
+}
+
+static input_event_t wake_button_event(void)
+{
+#if CONFIG_LORACUE_INPUT_HAS_DUAL_BUTTONS
+    if (BSP_GPIO_BUTTON_WAKE == bsp_get_button_prev_gpio()) {
+        return INPUT_EVENT_PREV_SHORT;
+    }
+#endif
+    // Long and double presses cannot be told apart this early; the wake press counts as a click
+    return INPUT_EVENT_NEXT_SHORT;
+}
+
+esp_err_t fast_resume_run(void)
+{
+#if CONFIG_LORACUE_FAST_RESUME
+    s_timing.app_start_us = esp_timer_get_time();
+
+    bool valid     = s_config.magic == RESUME_MAGIC;
+    s_config.magic = 0; // One attempt per deep sleep
+    if (!valid || esp_reset_reason() != ESP_RST_DEEPSLEEP ||
+        esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_EXT0 || s_config.device_mode != DEVICE_MODE_PRESENTER) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    s_timing.attempted = true;
+    s_wake_event       = wake_button_event();
+    uint8_t keycode    = presenter_mode_manager_get_keycode(s_wake_event);
+
+    esp_err_t ret = lora_protocol_fast_resume();
+    if (ret == ESP_OK) {
+        s_timing.crypto_us = esp_timer_get_time();
+        ret                = lora_driver_fast_resume();
+    }
+    if (ret == ESP_OK) {
+        s_timing.radio_us = esp_timer_get_time();
+        ret               = lora_protocol_fast_send_keyboard(s_config.slot_id, 0, keycode);
+    }
+    s_timing.tx_done_us = esp_timer_get_time();
+    s_timing.result     = ret;
+
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "Wake keypress sent: TX_DONE %llu us after reset (app %llu, crypto %llu, radio %llu us)",
+                 s_timing.tx_done_us, s_timing.app_start_us, s_timing.crypto_us - s_timing.app_start_us,
+                 s_timing.radio_us - s_timing.crypto_us);
+    } else {
+        ESP_LOGW(TAG, "Fast resume failed: %s, sending after full boot", esp_err_to_name(ret));
+    }
+    return ret;
+#else
+    return ESP_ERR_NOT_FOUND;
+#endif
+}
+
+bool fast_resume_get_wake_event(input_event_t *event)
+{
+    if (!s_timing.attempted) {
+        return false;
+    }
+    if (event) {
+        *event = s_wake_event;
+    }
+    return true;
+}
+
+esp_err_t fast_resume_get_timing(fast_resume_timing_t *timing)
+{
+    if (!timing) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    *timing = s_timing;
+    return ESP_OK;
+}
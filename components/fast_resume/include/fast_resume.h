@@ -0,0 +1,71 @@
+/**
+ * @file fast_resume.h
+ * @brief Deep-sleep wake path that transmits the wake keypress first
+ *
+ * CONTEXT: A presenter that sleeps between slides must not lose the first click to a full boot
+ * PURPOSE: Restore radio and crypto state retained in RTC memory, send the slide change the
+ *          wake button stands for, then let app_main bring up everything else
+ * USAGE: fast_resume_run() first thing in app_main; fast_resume_init() after config_manager
+ *        and power_mgmt so the state is saved on the next deep sleep
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include "input_manager.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Stage timestamps of the last fast resume (esp_timer, us since chip reset)
+ *
+ * The timer starts with the wake reset, so tx_done_us approximates button-to-TX_DONE
+ * latency including ROM and bootloader time.
+ */
+typedef struct {
+    bool attempted;        ///< A button wake ran the fast path on this boot
+    esp_err_t result;      ///< ESP_OK if the keypress reached TX_DONE
+    uint64_t app_start_us; ///< fast_resume_run() entry
+    uint64_t crypto_us;    ///< Key schedule and sequence restored
+    uint64_t radio_us;     ///< Radio awake with retained configuration
+    uint64_t tx_done_us;   ///< Packet encrypted and sent, TX_DONE (or failure)
+} fast_resume_timing_t;
+
+/**
+ * @brief Save device mode and slot on the next deep sleep
+ *
+ * @return ESP_OK on success
+ */
+esp_err_t fast_resume_init(void);
+
+/**
+ * @brief Transmit the wake keypress if this boot is a button wake from deep sleep
+ *
+ * @return ESP_OK if the keypress was sent, ESP_ERR_NOT_FOUND if this boot is no
+ *         presenter-mode button wake, other errors if the fast path failed
+ */
+esp_err_t fast_resume_run(void);
+
+/**
+ * @brief Input event the wake button stood for
+ *
+ * @param event Output event
+ * @return true if fast_resume_run() handled a button wake (sent or not)
+ */
+bool fast_resume_get_wake_event(input_event_t *event);
+
+/**
+ * @brief Get stage timings of this boot
+ *
+ * @param timing Output timing
+ * @return ESP_OK on success
+ */
+esp_err_t fast_resume_get_timing(fast_resume_timing_t *timing);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,126 @@
+/**
+ * @file init_graph.h
+ * @brief Dependency graph of init stages with critical-first list scheduling
+ *
+ * CONTEXT: Serial init makes time-to-first-keypress the sum of every stage, even ones
+ *          the keypress path never touches (BLE, USB CDC, I2Console probe)
+ * PURPOSE: Validate the stage dependency graph, mark the stages the boot targets depend
+ *          on as critical, pick the next stage for an idle worker (critical first, then
+ *          longest remaining path), compute critical paths and simulate a schedule
+ * USAGE: Pure C, no RTOS; init_scheduler executes it on the CPU cores, tests/host
+ *        simulate it with stage durations
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define INIT_GRAPH_MAX_NODES 32 ///< Dependencies are a uint32_t bitmask
+#define INIT_GRAPH_MAX_WORKERS 4
+
+/**
+ * @brief One init stage
+ */
+typedef struct {
+    const char *name; ///< Static string, not copied
+    uint32_t deps;    ///< Bitmask of node ids that must finish first
+    uint32_t cost_us; ///< Expected duration, drives priorities
+} init_node_t;
+
+/**
+ * @brief Graph state
+ */
+typedef struct {
+    init_node_t nodes[INIT_GRAPH_MAX_NODES];
+    uint8_t count;
+    bool finalized;
+    uint32_t targets;                       ///< Nodes whose completion the boot is measured by
+    uint32_t critical;                      ///< Targets and every node they depend on
+    uint8_t order[INIT_GRAPH_MAX_NODES];    ///< Topological order
+    uint64_t rank_us[INIT_GRAPH_MAX_NODES]; ///< Longest cost path from the node to any sink, own cost included
+} init_graph_t;
+
+/**
+ * @brief Simulated schedule
+ */
+typedef struct {
+    uint64_t start_us[INIT_GRAPH_MAX_NODES];
+    uint64_t end_us[INIT_GRAPH_MAX_NODES];
+    uint8_t worker[INIT_GRAPH_MAX_NODES];
+    uint64_t makespan_us; ///< End of the last node
+} init_schedule_t;
+
+/**
+ * @brief Initialize an empty graph
+ */
+void init_graph_init(init_graph_t *graph);
+
+/**
+ * @brief Add a node; ids are assigned in call order starting at 0
+ *
+ * Dependencies may name nodes added later; they are checked by init_graph_finalize().
+ *
+ * @param id Output node id (may be NULL)
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if the graph is full, ESP_ERR_INVALID_STATE after finalize
+ */
+esp_err_t init_graph_add(init_graph_t *graph, const char *name, uint32_t deps, uint32_t cost_us, int *id);
+
+/**
+ * @brief Validate the graph and compute priorities
+ *
+ * @param targets Bitmask of nodes the boot latency is measured by (e.g. LoRa ready, first keypress)
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG for dependencies or targets on unknown nodes,
+ *         ESP_ERR_INVALID_STATE if the dependencies contain a cycle
+ */
+esp_err_t init_graph_finalize(init_graph_t *graph, uint32_t targets);
+
+/**
+ * @brief True if a node is a target or a target depends on it
+ */
+bool init_graph_is_critical(const init_graph_t *graph, int id);
+
+/**
+ * @brief Choose the next node for an idle worker
+ *
+ * Among nodes not yet taken whose dependencies are all done: critical nodes first, then
+ * the one with the longest remaining path, then the lowest id.
+ *
+ * @param done Bitmask of finished nodes
+ * @param taken Bitmask of finished and running nodes
+ * @return Node id, -1 if nothing is ready
+ */
+int init_graph_pick(const init_graph_t *graph, uint32_t done, uint32_t taken);
+
+/**
+ * @brief Longest dependency chain ending at a node
+ *
+ * @param cost_us Per-node durations (e.g. measured), NULL to use the declared costs
+ * @param target Last node of the chain, -1 for the longest chain in the graph
+ * @param path Output node ids from first to last (INIT_GRAPH_MAX_NODES entries, may be NULL)
+ * @param len Output number of nodes in path (may be NULL)
+ * @return Sum of the durations along the chain, 0 for an unfinalized graph or unknown target
+ */
+uint64_t init_graph_critical_path(const init_graph_t *graph, const uint32_t *cost_us, int target, uint8_t *path,
+                                  uint8_t *len);
+
+/**
+ * @brief Simulate the scheduler on a number of workers
+ *
+ * Same picking rule as the runtime: whenever a worker is idle it takes init_graph_pick().
+ *
+ * @param cost_us Per-node durations, NULL to use the declared costs
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE for an unfinalized graph,
+ *         ESP_ERR_INVALID_ARG for a worker count outside 1..INIT_GRAPH_MAX_WORKERS
+ */
+esp_err_t init_graph_simulate(const init_graph_t *graph, const uint32_t *cost_us, uint8_t workers,
+                              init_schedule_t *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,67 @@
+/**
+ * @file init_scheduler.h
+ * @brief Runs the app_main init stages on both cores in dependency order
+ *
+ * CONTEXT: Stages such as BLE bring-up, the boot screen and SX1262 calibration do not
+ *          depend on each other, yet serial init made the first keypress wait for all of them
+ * PURPOSE: Execute the stage functions from the boot_stages dependency graph with one worker
+ *          per core, stages on the path to LoRa ready and first keypress first, and report
+ *          the measured critical path
+ * USAGE: app_main passes one function per boot stage to init_scheduler_run()
+ */
+
+#pragma once
+
+#include "boot_stages.h"
+#include "esp_err.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Stage init function
+ *
+ * Returns an error only for failures the device cannot run without; those stop the
+ * scheduler from starting further stages. Non-fatal problems are logged and swallowed.
+ */
+typedef esp_err_t (*init_stage_fn_t)(void);
+
+/**
+ * @brief Result of the last run
+ */
+typedef struct {
+    uint64_t start_us[BOOT_STAGE_COUNT]; ///< esp_timer time, 0 for stages not run
+    uint64_t end_us[BOOT_STAGE_COUNT];
+    uint8_t core[BOOT_STAGE_COUNT];
+    esp_err_t result[BOOT_STAGE_COUNT];
+    uint8_t workers;
+    uint8_t path[BOOT_STAGE_COUNT]; ///< Critical path to first keypress with measured durations
+    uint8_t path_len;
+    uint64_t path_us;        ///< Sum of measured durations along path
+    uint64_t keypress_us;    ///< End of BOOT_STAGE_KEYPRESS_READY
+    uint64_t serial_us;      ///< Sum of all measured durations (what serial init would take)
+    uint64_t finished_us;    ///< End of the last stage
+} init_scheduler_report_t;
+
+/**
+ * @brief Run all stages and return when every stage has finished or a stage failed
+ *
+ * The calling task is one worker; with CONFIG_LORACUE_INIT_PARALLEL a second worker
+ * task runs on the other core. Each stage is traced with boot_trace_begin()/end().
+ *
+ * @param stages One function per boot stage, NULL for stages not built in
+ * @return ESP_OK on success, the first fatal stage error otherwise,
+ *         ESP_ERR_INVALID_STATE if the stage graph is invalid
+ */
+esp_err_t init_scheduler_run(const init_stage_fn_t stages[BOOT_STAGE_COUNT]);
+
+/**
+ * @brief Copy the report of the last run
+ */
+esp_err_t init_scheduler_get_report(init_scheduler_report_t *report);
+
+#ifdef __cplusplus
+}
+#endif
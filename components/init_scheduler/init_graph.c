@@ -0,0 +1,238 @@
+/**
+ * @file init_graph.c
+ * @brief Dependency graph of init stages with critical-first list scheduling
+ */
+
+#include "init_graph.h"
+#include <string.h>
+
+#define NODE_BIT(id) (1UL << (id))
+
+static uint32_t all_nodes(const init_graph_t *graph)
+{
+    return graph->count >= 32 ? UINT32_MAX : NODE_BIT(graph->count) - 1;
+}
+
+static uint32_t node_cost(const init_graph_t *graph, const uint32_t *cost_us, int id)
+{
+    return cost_us ? cost_us[id] : graph->nodes[id].cost_us;
+}
+
+void init_graph_init(init_graph_t *graph)
+{
+    memset(graph, 0, sizeof(*graph));
+}
+
+esp_err_t init_graph_add(init_graph_t *graph, const char *name, uint32_t deps, uint32_t cost_us, int *id)
+{
+    if (graph->finalized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (graph->count >= INIT_GRAPH_MAX_NODES) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    init_node_t *node = &graph->nodes[graph->count];
+    node->name        = name;
+    node->deps        = deps;
+    node->cost_us     = cost_us;
+    if (id) {
+        *id = graph->count;
+    }
+    graph->count++;
+    return ESP_OK;
+}
+
+esp_err_t init_graph_finalize(init_graph_t *graph, uint32_t targets)
+{
+    uint32_t valid = all_nodes(graph);
+    if (targets & ~valid) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (int i = 0; i < graph->count; i++) {
+        if (graph->nodes[i].deps & ~valid) {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+
+    // Kahn's algorithm, lowest id first so the order is deterministic
+    uint32_t placed = 0;
+    for (int n = 0; n < graph->count; n++) {
+        int next = -1;
+        for (int i = 0; i < graph->count && next < 0; i++) {
+            if (!(placed & NODE_BIT(i)) && (graph->nodes[i].deps & ~placed) == 0) {
+                next = i;
+            }
+        }
+        if (next < 0) {
+            return ESP_ERR_INVALID_STATE; // Every remaining node waits on another one
+        }
+        graph->order[n] = (uint8_t)next;
+        placed |= NODE_BIT(next);
+    }
+
+    // Successors come later in topological order, so walking it backwards visits them first
+    graph->targets  = targets;
+    graph->critical = targets;
+    for (int n = graph->count - 1; n >= 0; n--) {
+        int id        = graph->order[n];
+        uint64_t tail = 0;
+        for (int m = n + 1; m < graph->count; m++) {
+            int succ = graph->order[m];
+            if ((graph->nodes[succ].deps & NODE_BIT(id)) && graph->rank_us[succ] > tail) {
+                tail = graph->rank_us[succ];
+            }
+        }
+        graph->rank_us[id] = graph->nodes[id].cost_us + tail;
+        if (graph->critical & NODE_BIT(id)) {
+            graph->critical |= graph->nodes[id].deps;
+        }
+    }
+
+    graph->finalized = true;
+    return ESP_OK;
+}
+
+bool init_graph_is_critical(const init_graph_t *graph, int id)
+{
+    return id >= 0 && id < graph->count && (graph->critical & NODE_BIT(id));
+}
+
+int init_graph_pick(const init_graph_t *graph, uint32_t done, uint32_t taken)
+{
+    int best = -1;
+    for (int i = 0; i < graph->count; i++) {
+        if ((taken & NODE_BIT(i)) || (graph->nodes[i].deps & ~done)) {
+            continue;
+        }
+        if (best < 0) {
+            best = i;
+            continue;
+        }
+
+        bool critical      = init_graph_is_critical(graph, i);
+        bool best_critical = init_graph_is_critical(graph, best);
+        if (critical != best_critical) {
+            if (critical) {
+                best = i;
+            }
+        } else if (graph->rank_us[i] > graph->rank_us[best]) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+uint64_t init_graph_critical_path(const init_graph_t *graph, const uint32_t *cost_us, int target, uint8_t *path,
+                                  uint8_t *len)
+{
+    if (len) {
+        *len = 0;
+    }
+    if (!graph->finalized || target >= graph->count || graph->count == 0) {
+        return 0;
+    }
+
+    uint64_t dist[INIT_GRAPH_MAX_NODES];
+    int8_t prev[INIT_GRAPH_MAX_NODES];
+    for (int n = 0; n < graph->count; n++) {
+        int id   = graph->order[n];
+        dist[id] = 0;
+        prev[id] = -1;
+        for (int d = 0; d < graph->count; d++) {
+            if ((graph->nodes[id].deps & NODE_BIT(d)) && (prev[id] < 0 || dist[d] > dist[id])) {
+                dist[id] = dist[d];
+                prev[id] = (int8_t)d;
+            }
+        }
+        dist[id] += node_cost(graph, cost_us, id);
+    }
+
+    int last = target;
+    if (last < 0) {
+        last = 0;
+        for (int i = 1; i < graph->count; i++) {
+            if (dist[i] > dist[last]) {
+                last = i;
+            }
+        }
+    }
+
+    // Walk back to the root, then reverse into first-to-last order
+    uint8_t chain[INIT_GRAPH_MAX_NODES];
+    uint8_t count = 0;
+    for (int id = last; id >= 0; id = prev[id]) {
+        chain[count++] = (uint8_t)id;
+    }
+    if (path) {
+        for (int i = 0; i < count; i++) {
+            path[i] = chain[count - 1 - i];
+        }
+    }
+    if (len) {
+        *len = count;
+    }
+    return dist[last];
+}
+
+esp_err_t init_graph_simulate(const init_graph_t *graph, const uint32_t *cost_us, uint8_t workers,
+                              init_schedule_t *out)
+{
+    if (!graph->finalized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (workers == 0 || workers > INIT_GRAPH_MAX_WORKERS || !out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(out, 0, sizeof(*out));
+    int running[INIT_GRAPH_MAX_WORKERS];
+    uint64_t busy_until[INIT_GRAPH_MAX_WORKERS] = {0};
+    for (int w = 0; w < workers; w++) {
+        running[w] = -1;
+    }
+
+    uint32_t all   = all_nodes(graph);
+    uint32_t done  = 0;
+    uint32_t taken = 0;
+    uint64_t now   = 0;
+    while (done != all) {
+        for (int w = 0; w < workers; w++) {
+            if (running[w] >= 0) {
+                continue;
+            }
+            int id = init_graph_pick(graph, done, taken);
+            if (id < 0) {
+                break;
+            }
+            taken |= NODE_BIT(id);
+
+            running[w]        = id;
+            out->start_us[id] = now;
+            out->end_us[id]   = now + node_cost(graph, cost_us, id);
+            out->worker[id]   = (uint8_t)w;
+            busy_until[w]     = out->end_us[id];
+        }
+
+        // Advance to the next completion
+        uint64_t next = UINT64_MAX;
+        for (int w = 0; w < workers; w++) {
+            if (running[w] >= 0 && busy_until[w] < next) {
+                next = busy_until[w];
+            }
+        }
+        if (next == UINT64_MAX) {
+            return ESP_FAIL; // Unreachable for a finalized graph
+        }
+        now = next;
+        for (int w = 0; w < workers; w++) {
+            if (running[w] >= 0 && busy_until[w] == now) {
+                done |= NODE_BIT(running[w]);
+                running[w] = -1;
+            }
+        }
+    }
+
+    out->makespan_us = now;
+    return ESP_OK;
+}
@@ -0,0 +1,217 @@
+/**
+ * @file init_scheduler.c
+ * @brief Runs the app_main init stages on both cores in dependency order
+ */
+
+#include "init_scheduler.h"
+#include "boot_trace.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "init_graph.h"
+#include "sdkconfig.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "INIT_SCHED";
+
+#if CONFIG_LORACUE_INIT_PARALLEL && !CONFIG_FREERTOS_UNICORE
+#define INIT_WORKERS 2
+#else
+#define INIT_WORKERS 1
+#endif
+
+#define STAGE_BIT(stage) BOOT_DEP(stage)
+#define ALL_STAGES (BOOT_DEP(BOOT_STAGE_COUNT) - 1)
+
+static init_graph_t s_graph;
+static const init_stage_fn_t *s_stages;
+static uint32_t s_done;
+static uint32_t s_taken;
+static uint8_t s_waiting;
+static uint8_t s_workers;
+static esp_err_t s_failed;
+static init_scheduler_report_t s_report;
+static SemaphoreHandle_t s_progress;
+#if INIT_WORKERS > 1
+static SemaphoreHandle_t s_helper_done;
+#endif
+static portMUX_TYPE sched_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static esp_err_t run_stage(boot_stage_t stage)
+{
+    init_stage_fn_t fn = s_stages[stage];
+    if (!fn) {
+        return ESP_OK;
+    }
+
+    s_report.core[stage]     = xPortGetCoreID();
+    s_report.start_us[stage] = esp_timer_get_time();
+    boot_trace_begin(stage);
+    esp_err_t ret = fn();
+    boot_trace_end(stage);
+    s_report.end_us[stage] = esp_timer_get_time();
+    s_report.result[stage] = ret;
+
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Stage %s failed: %s", s_graph.nodes[stage].name, esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+// Each worker takes the best ready stage until all are done; when nothing is ready it
+// sleeps until another worker finishes a stage
+static void run_worker(void)
+{
+    while (1) {
+        taskENTER_CRITICAL(&sched_lock);
+        bool finished = s_failed != ESP_OK || s_done == ALL_STAGES;
+        int stage     = finished ? -1 : init_graph_pick(&s_graph, s_done, s_taken);
+        if (stage >= 0) {
+            s_taken |= STAGE_BIT(stage);
+        } else if (!finished) {
+            s_waiting++;
+        }
+        taskEXIT_CRITICAL(&sched_lock);
+
+        if (finished) {
+            return;
+        }
+        if (stage < 0) {
+            xSemaphoreTake(s_progress, portMAX_DELAY);
+            continue;
+        }
+
+        esp_err_t ret = run_stage((boot_stage_t)stage);
+
+        taskENTER_CRITICAL(&sched_lock);
+        s_done |= STAGE_BIT(stage);
+        if (ret != ESP_OK && s_failed == ESP_OK) {
+            s_failed = ret;
+        }
+        uint8_t wake = s_waiting;
+        s_waiting    = 0;
+        taskEXIT_CRITICAL(&sched_lock);
+
+        while (wake--) {
+            xSemaphoreGive(s_progress);
+        }
+    }
+}
+
+#if INIT_WORKERS > 1
+static void helper_task(void *arg)
+{
+    run_worker();
+    xSemaphoreGive(s_helper_done);
+    vTaskDelete(NULL);
+}
+#endif
+
+static void build_report(void)
+{
+    uint32_t measured[INIT_GRAPH_MAX_NODES] = {0};
+    s_report.serial_us                      = 0;
+    s_report.finished_us                    = 0;
+    for (int i = 0; i < BOOT_STAGE_COUNT; i++) {
+        if (s_report.end_us[i] > s_report.start_us[i]) {
+            measured[i] = (uint32_t)(s_report.end_us[i] - s_report.start_us[i]);
+        }
+        s_report.serial_us += measured[i];
+        if (s_report.end_us[i] > s_report.finished_us) {
+            s_report.finished_us = s_report.end_us[i];
+        }
+    }
+
+    s_report.workers     = s_workers;
+    s_report.keypress_us = s_report.end_us[BOOT_STAGE_KEYPRESS_READY];
+    s_report.path_us =
+        init_graph_critical_path(&s_graph, measured, BOOT_STAGE_KEYPRESS_READY, s_report.path, &s_report.path_len);
+}
+
+static void log_report(void)
+{
+    ESP_LOGI(TAG, "%d stages on %d core(s): first keypress at %llu ms, all done at %llu ms (serial sum %llu ms)",
+             BOOT_STAGE_COUNT, s_report.workers, s_report.keypress_us / 1000, s_report.finished_us / 1000,
+             s_report.serial_us / 1000);
+
+    char path[160];
+    int len = 0;
+    for (int i = 0; i < s_report.path_len && len < (int)sizeof(path); i++) {
+        len += snprintf(path + len, sizeof(path) - len, "%s%s", i ? " > " : "", s_graph.nodes[s_report.path[i]].name);
+    }
+    ESP_LOGI(TAG, "Critical path (%llu ms): %s", s_report.path_us / 1000, s_report.path_len ? path : "-");
+}
+
+esp_err_t init_scheduler_run(const init_stage_fn_t stages[BOOT_STAGE_COUNT])
+{
+    if (!stages) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    init_graph_init(&s_graph);
+    for (int i = 0; i < BOOT_STAGE_COUNT; i++) {
+        const boot_stage_info_t *info = boot_stage_info((boot_stage_t)i);
+        init_graph_add(&s_graph, info->name, info->deps, info->budget_us, NULL);
+    }
+    esp_err_t ret =
+        init_graph_finalize(&s_graph, BOOT_DEP(BOOT_STAGE_LORA_READY) | BOOT_DEP(BOOT_STAGE_KEYPRESS_READY));
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Invalid stage graph: %s", esp_err_to_name(ret));
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    memset(&s_report, 0, sizeof(s_report));
+    s_stages  = stages;
+    s_done    = 0;
+    s_taken   = 0;
+    s_waiting = 0;
+    s_workers = 1;
+    s_failed  = ESP_OK;
+
+    s_progress = xSemaphoreCreateCounting(INIT_WORKERS, 0);
+    if (!s_progress) {
+        return ESP_ERR_NO_MEM;
+    }
+
+#if INIT_WORKERS > 1
+    // The helper runs on the other core at the caller's priority
+    s_helper_done = xSemaphoreCreateBinary();
+    if (s_helper_done && xTaskCreatePinnedToCore(helper_task, "init_worker", CONFIG_LORACUE_INIT_WORKER_STACK_SIZE,
+                                                 NULL, uxTaskPriorityGet(NULL), NULL, !xPortGetCoreID()) == pdPASS) {
+        s_workers++;
+    } else {
+        ESP_LOGW(TAG, "No second init worker, running stages on one core");
+    }
+#endif
+
+    run_worker();
+
+#if INIT_WORKERS > 1
+    if (s_workers > 1) {
+        xSemaphoreTake(s_helper_done, portMAX_DELAY);
+    }
+    if (s_helper_done) {
+        vSemaphoreDelete(s_helper_done);
+        s_helper_done = NULL;
+    }
+#endif
+    vSemaphoreDelete(s_progress);
+    s_progress = NULL;
+
+    build_report();
+    log_report();
+    return s_failed;
+}
+
+esp_err_t init_scheduler_get_report(init_scheduler_report_t *report)
+{
+    if (!report) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    *report = s_report;
+    return ESP_OK;
+}
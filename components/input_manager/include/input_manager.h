@@ -70,6 +70,15 @@ esp_err_t input_manager_register_callback(input_callback_t callback);
  */
 esp_err_t input_manager_start(void);
 
+/**
+ * @brief Ignore the current press of any button that is still held
+ *
+ * Used after fast_resume already transmitted the press that woke the device,
+ * so its release does not send the slide change a second time.
+ * Call after input_manager_init() and before input_manager_start().
+ */
+void input_manager_consume_held_buttons(void);
+
 #ifdef __cplusplus
 }
 #endif
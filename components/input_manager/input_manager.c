@@ -33,6 +33,9 @@ static const char *TAG = "INPUT_MGR";
 #define INPUT_POLL_INTERVAL_MS 10
 #define ENCODER_QUEUE_SIZE 4
 
+// Without an encoder (whose library polls on its own esp_timer) the task sleeps on a button interrupt while idle
+#define INPUT_EVENT_DRIVEN (!CONFIG_LORACUE_INPUT_HAS_ENCODER)
+
 // Timing from Kconfig
 #define DEBOUNCE_MS CONFIG_LORACUE_INPUT_DEBOUNCE_MS
 #define LONG_PRESS_MS CONFIG_LORACUE_INPUT_LONG_PRESS_MS
@@ -43,6 +46,9 @@ static input_callback_t s_callback = NULL;
 static TaskHandle_t s_task_handle  = NULL;
 static QueueHandle_t s_event_queue = NULL;
 static bool s_initialized          = false;
+static int s_sleep_client          = -1;
+static bool s_sleep_blocked        = false;
+static bool s_irq_ready            = false;
 
 // Button state tracking
 typedef struct {
@@ -176,11 +182,123 @@ static void handle_encoder(uint32_t now)
 }
 #endif
 
+static bool button_busy(const button_state_t *btn)
+{
+    return btn->pressed || btn->click_count > 0;
+}
+
+// True while a press, long-press timer or double-click window needs the 10ms poll
+static bool input_busy(void)
+{
+#if CONFIG_LORACUE_INPUT_HAS_DUAL_BUTTONS
+    bool busy = button_busy(&s_prev_btn) || button_busy(&s_next_btn);
+#else
+    bool busy = button_busy(&s_btn);
+#endif
+#if CONFIG_LORACUE_INPUT_HAS_ENCODER
+    busy = busy || s_encoder_btn_pressed;
+#endif
+    return busy;
+}
+
+// A held button keeps its low-level wakeup asserted, so light sleep would return immediately
+static void update_sleep_block(bool busy)
+{
+    if (busy && !s_sleep_blocked) {
+        power_mgmt_sleep_block(s_sleep_client);
+    } else if (!busy && s_sleep_blocked) {
+        power_mgmt_sleep_allow(s_sleep_client);
+    }
+    s_sleep_blocked = busy;
+}
+
+#if INPUT_EVENT_DRIVEN
+#if CONFIG_LORACUE_INPUT_HAS_DUAL_BUTTONS
+#define BUTTON_IRQ_COUNT 2
+#else
+#define BUTTON_IRQ_COUNT 1
+#endif
+
+static gpio_num_t s_button_irq_gpio[BUTTON_IRQ_COUNT];
+
+static void button_isr_handler(void *arg)
+{
+    // Level interrupt: mask until the task has finished polling the press
+    for (int i = 0; i < BUTTON_IRQ_COUNT; i++) {
+        gpio_intr_disable(s_button_irq_gpio[i]);
+    }
+
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(s_task_handle, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+static esp_err_t button_irq_init(void)
+{
+#if CONFIG_LORACUE_INPUT_HAS_DUAL_BUTTONS
+    s_button_irq_gpio[0] = bsp_get_button_prev_gpio();
+    s_button_irq_gpio[1] = bsp_get_button_next_gpio();
+#else
+    s_button_irq_gpio[0] = BSP_GPIO_BUTTON_WAKE;
+#endif
+
+    esp_err_t ret = gpio_install_isr_service(0);
+    if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) {
+        return ret;
+    }
+
+    for (int i = 0; i < BUTTON_IRQ_COUNT; i++) {
+        gpio_num_t gpio = s_button_irq_gpio[i];
+        gpio_intr_disable(gpio);
+        ret = gpio_isr_handler_add(gpio, button_isr_handler, NULL);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        // Sets the interrupt type to low level and arms light sleep wakeup for the pin
+        gpio_wakeup_enable(gpio, GPIO_INTR_LOW_LEVEL);
+    }
+    return ESP_OK;
+}
+
+// Block until a button goes low; interrupt latency replaces the 10ms poll while idle
+static void wait_for_press(void)
+{
+    for (int i = 0; i < BUTTON_IRQ_COUNT; i++) {
+        gpio_intr_enable(s_button_irq_gpio[i]);
+    }
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+}
+#endif
+
+// Pressed with the event already sent: the release then produces no click
+static void consume_if_held(button_state_t *btn, bool pressed)
+{
+    if (pressed) {
+        btn->pressed        = true;
+        btn->press_start_ms = xTaskGetTickCount() * portTICK_PERIOD_MS;
+        btn->long_sent      = true;
+        btn->click_count    = 0;
+    }
+}
+
+void input_manager_consume_held_buttons(void)
+{
+#if CONFIG_LORACUE_INPUT_HAS_DUAL_BUTTONS
+    consume_if_held(&s_prev_btn, !gpio_get_level(bsp_get_button_prev_gpio()));
+    consume_if_held(&s_next_btn, !gpio_get_level(bsp_get_button_next_gpio()));
+#else
+    consume_if_held(&s_btn, bsp_read_button(BSP_BUTTON_NEXT));
+#endif
+}
+
 static void input_task(void *arg)
 {
     ESP_LOGI(TAG, "Input manager task started");
 
     input_event_t event;
+#if INPUT_EVENT_DRIVEN
+    bool irq_wake = false;
+#endif
     while (1) {
         uint32_t now = xTaskGetTickCount() * portTICK_PERIOD_MS;
 
@@ -202,12 +320,26 @@ static void input_task(void *arg)
         handle_encoder(now);
 #endif
 
-        // Process events
-        if (xQueueReceive(s_event_queue, &event, pdMS_TO_TICKS(INPUT_POLL_INTERVAL_MS)) == pdTRUE) {
+        // Deliver events posted by the handlers above
+        while (xQueueReceive(s_event_queue, &event, 0) == pdTRUE) {
             if (s_callback) {
                 s_callback(event);
             }
         }
+
+        bool busy = input_busy();
+        update_sleep_block(busy);
+
+#if INPUT_EVENT_DRIVEN
+        // A wake that produced no press (bounce, pin not mapped to a button) polls once before re-arming
+        if (!busy && s_irq_ready && !irq_wake) {
+            wait_for_press();
+            irq_wake = true;
+            continue;
+        }
+        irq_wake = false;
+#endif
+        vTaskDelay(pdMS_TO_TICKS(INPUT_POLL_INTERVAL_MS));
     }
 }
 
@@ -304,6 +436,13 @@ esp_err_t input_manager_start(void)
         return ESP_OK;
     }
 
+#if INPUT_EVENT_DRIVEN
+    power_mgmt_sleep_register("input", SLEEP_WAKE_GPIO, 0, &s_sleep_client);
+#else
+    // Encoder library polls on its own esp_timer, so the task keeps its fixed poll as well
+    power_mgmt_sleep_register("input", SLEEP_WAKE_GPIO | SLEEP_WAKE_TIMER, INPUT_POLL_INTERVAL_MS, &s_sleep_client);
+#endif
+
     BaseType_t ret =
         xTaskCreate(input_task, "input_mgr", INPUT_TASK_STACK_SIZE, NULL, INPUT_TASK_PRIORITY, &s_task_handle);
     if (ret != pdPASS) {
@@ -311,6 +450,19 @@ esp_err_t input_manager_start(void)
         return ESP_ERR_NO_MEM;
     }
 
+#if INPUT_EVENT_DRIVEN
+    // ISR notifies s_task_handle, so arm interrupts only once the task exists
+    esp_err_t irq_ret = button_irq_init();
+    if (irq_ret == ESP_OK) {
+        s_irq_ready = true;
+    } else {
+        ESP_LOGW(TAG, "Button interrupt unavailable (%s), polling every %dms", esp_err_to_name(irq_ret),
+                 INPUT_POLL_INTERVAL_MS);
+        power_mgmt_sleep_register("input", SLEEP_WAKE_GPIO | SLEEP_WAKE_TIMER, INPUT_POLL_INTERVAL_MS,
+                                  &s_sleep_client);
+    }
+#endif
+
     ESP_LOGI(TAG, "Input manager started");
     return ESP_OK;
 }
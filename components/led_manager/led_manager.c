@@ -10,15 +10,17 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/timers.h"
+#include "power_mgmt.h"
 #include <math.h>
 
 static const char *TAG = "LED_MANAGER";
 
 // LEDC configuration for PWM fading
+// RC_FAST keeps the PWM running through automatic light sleep (APB stops); ~17.5MHz allows 10 bits at 5kHz
 #define LEDC_TIMER LEDC_TIMER_0
 #define LEDC_MODE LEDC_LOW_SPEED_MODE
 #define LEDC_CHANNEL LEDC_CHANNEL_0
-#define LEDC_DUTY_RES LEDC_TIMER_13_BIT
+#define LEDC_DUTY_RES LEDC_TIMER_10_BIT
 #define LEDC_FREQUENCY 5000
 #define LEDC_MAX_DUTY ((1 << LEDC_DUTY_RES) - 1)
 
@@ -33,6 +35,7 @@ static led_pattern_t current_pattern = LED_PATTERN_OFF;
 static TaskHandle_t fade_task_handle = NULL;
 static uint32_t fade_period_ms       = LED_DEFAULT_FADE_PERIOD_MS;
 static bool button_feedback_active   = false;
+static int sleep_client              = -1;
 
 // Forward declaration
 static void fade_task(void *pvParameters);
@@ -46,7 +49,7 @@ esp_err_t led_manager_init(void)
                                       .timer_num       = LEDC_TIMER,
                                       .duty_resolution = LEDC_DUTY_RES,
                                       .freq_hz         = LEDC_FREQUENCY,
-                                      .clk_cfg         = LEDC_AUTO_CLK};
+                                      .clk_cfg         = LEDC_USE_RC_FAST_CLK};
     esp_err_t ret                  = ledc_timer_config(&ledc_timer);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to configure LEDC timer: %s", esp_err_to_name(ret));
@@ -59,13 +62,17 @@ esp_err_t led_manager_init(void)
                                           .intr_type  = LEDC_INTR_DISABLE,
                                           .gpio_num   = bsp_get_led_gpio(),
                                           .duty       = 0,
-                                          .hpoint     = 0};
+                                          .hpoint     = 0,
+                                          .sleep_mode = LEDC_SLEEP_MODE_KEEP_ALIVE};
     ret                                = ledc_channel_config(&ledc_channel);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to configure LEDC channel: %s", esp_err_to_name(ret));
         return ret;
     }
 
+    // Only the fade task wakes the CPU; solid patterns run from the LEDC hardware alone
+    power_mgmt_sleep_register("led", 0, 0, &sleep_client);
+
     current_pattern = LED_PATTERN_OFF;
     ESP_LOGI(TAG, "LED manager initialized");
     return ESP_OK;
@@ -84,6 +91,7 @@ esp_err_t led_manager_solid(bool on)
     uint32_t duty = on ? LEDC_MAX_DUTY : 0;
     ledc_set_duty(LEDC_MODE, LEDC_CHANNEL, duty);
     ledc_update_duty(LEDC_MODE, LEDC_CHANNEL);
+    power_mgmt_record_state(ENERGY_COMPONENT_LED, on ? ENERGY_LED_ON : ENERGY_LED_OFF);
 
     return ESP_OK;
 }
@@ -128,6 +136,8 @@ esp_err_t led_manager_fade(uint32_t period_ms)
         return ESP_ERR_NO_MEM;
     }
 
+    power_mgmt_record_state(ENERGY_COMPONENT_LED, ENERGY_LED_FADE);
+    power_mgmt_sleep_register("led", SLEEP_WAKE_TIMER, LED_FADE_STEP_MS, &sleep_client);
     return ESP_OK;
 }
 
@@ -145,6 +155,8 @@ esp_err_t led_manager_stop(void)
     // Turn off LED
     ledc_set_duty(LEDC_MODE, LEDC_CHANNEL, 0);
     ledc_update_duty(LEDC_MODE, LEDC_CHANNEL);
+    power_mgmt_record_state(ENERGY_COMPONENT_LED, ENERGY_LED_OFF);
+    power_mgmt_sleep_register("led", 0, 0, &sleep_client);
 
     current_pattern = LED_PATTERN_OFF;
     return ESP_OK;
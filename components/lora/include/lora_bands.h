@@ -1,6 +1,8 @@
 /**
  * @file lora_bands.h
  * @brief LoRa regulatory compliance and hardware profiles
+ *
+ * Returned pointers refer to const tables in flash and stay valid forever.
  */
 
 #pragma once
@@ -13,48 +15,46 @@
 extern "C" {
 #endif
 
-#define LORA_MAX_HARDWARE 8     // Max hardware profiles
-#define LORA_MAX_REGIONS 16     // Max regulatory regions
-#define LORA_MAX_COMPLIANCE 64  // Max compliance rules
-#define LORA_BAND_ID_LEN 16
-#define LORA_BAND_NAME_LEN 64
-
 /**
  * @brief Hardware profile structure
  */
 typedef struct {
-    char id[LORA_BAND_ID_LEN];     ///< Hardware ID (e.g., "HW_433")
-    char name[LORA_BAND_NAME_LEN]; ///< Human-readable name
-    uint32_t freq_min_khz;         ///< Hardware minimum frequency in kHz
-    uint32_t freq_max_khz;         ///< Hardware maximum frequency in kHz
-    uint32_t optimal_khz;          ///< Optimal frequency in kHz
+    const char *id;        ///< Hardware ID (e.g., "HW_433")
+    const char *name;      ///< Human-readable name
+    uint32_t freq_min_khz; ///< Hardware minimum frequency in kHz
+    uint32_t freq_max_khz; ///< Hardware maximum frequency in kHz
+    uint32_t optimal_khz;  ///< Optimal frequency in kHz
 } lora_hardware_t;
 
 /**
  * @brief Regulatory region structure
  */
 typedef struct {
-    char id[LORA_BAND_ID_LEN];     ///< Region ID (e.g., "EU", "US")
-    char name[LORA_BAND_NAME_LEN]; ///< Human-readable name
+    const char *id;   ///< Region ID (e.g., "EU", "US")
+    const char *name; ///< Human-readable name
 } lora_region_t;
 
 /**
  * @brief Compliance rule structure
  */
 typedef struct {
-    char region_id[LORA_BAND_ID_LEN];   ///< Region ID
-    char hardware_id[LORA_BAND_ID_LEN]; ///< Hardware ID
-    uint32_t freq_min_khz;              ///< Legal minimum frequency in kHz
-    uint32_t freq_max_khz;              ///< Legal maximum frequency in kHz
-    int8_t max_power_dbm;               ///< Maximum legal TX power
-    uint8_t duty_cycle_percent;         ///< Duty cycle limit (0 = no limit)
-    bool fhss_required;                 ///< FHSS required
-    bool lbt_required;                  ///< Listen-before-talk required
+    const char *region_id;      ///< Region ID
+    const char *hardware_id;    ///< Hardware ID
+    uint32_t freq_min_khz;      ///< Legal minimum frequency in kHz
+    uint32_t freq_max_khz;      ///< Legal maximum frequency in kHz
+    int8_t max_power_dbm;       ///< Maximum legal TX power
+    uint8_t duty_cycle_percent; ///< Duty cycle limit (0 = no limit)
+    bool fhss_required;         ///< FHSS required
+    bool lbt_required;          ///< Listen-before-talk required
 } lora_compliance_t;
 
 /**
- * @brief Initialize regulatory system from embedded JSON
- * @return ESP_OK on success
+ * @brief Initialize regulatory system
+ *
+ * The tables are generated from lora_regulatory.json at build time and live in flash,
+ * so there is nothing to parse; kept so callers need not change.
+ *
+ * @return ESP_OK
  */
 esp_err_t lora_regulatory_init(void);
 
@@ -83,8 +83,6 @@ const lora_hardware_t *lora_hardware_get_profile_by_id(const char *id);
  */
 bool lora_regulatory_validate_domain(const char *domain);
 const lora_compliance_t *lora_regulatory_get_limits(const char *domain, const char *hardware_id);
-int lora_regulatory_get_region_count(void);
-const lora_region_t *lora_regulatory_get_region(int index);
 
 /**
  * @brief Get hardware index for a given frequency
@@ -18,6 +18,7 @@ extern "C" {
 
 // LoRa network configuration
 #define LORA_PRIVATE_SYNC_WORD 0x1424 ///< Private network sync word (prevents public network interference)
+#define LORA_WAIT_FOREVER UINT32_MAX   ///< Receive timeout that blocks until a packet arrives
 
 /**
  * @brief LoRa bandwidth options (kHz)
@@ -53,14 +54,34 @@ esp_err_t lora_driver_init(void);
  */
 esp_err_t lora_send_packet(const uint8_t *data, size_t length);
 
+/**
+ * @brief Wake the radio from warm-start sleep after deep sleep
+ *
+ * Only brings up SPI and restores packet parameters; no reset, calibration or tasks.
+ * lora_driver_init() later reinitializes the radio completely.
+ *
+ * @return ESP_OK if the radio kept its configuration, error otherwise
+ */
+esp_err_t lora_driver_fast_resume(void);
+
+/**
+ * @brief Transmit synchronously without the TX task (fast resume only)
+ *
+ * @param data Packet data
+ * @param length Packet length
+ * @return ESP_OK on TX_DONE, ESP_ERR_TIMEOUT otherwise
+ */
+esp_err_t lora_driver_transmit_now(const uint8_t *data, size_t length);
+
 /**
  * @brief Receive LoRa packet
  *
  * @param data Buffer to store received data
  * @param max_length Maximum buffer size
  * @param received_length Actual received length
- * @param timeout_ms Timeout in milliseconds
- * @return ESP_OK on success, ESP_ERR_TIMEOUT on timeout
+ * @param timeout_ms Timeout in milliseconds, LORA_WAIT_FOREVER to block
+ * @return ESP_OK on success, ESP_ERR_TIMEOUT on timeout, ESP_ERR_INVALID_SIZE if the packet was longer
+ *         than max_length (data holds its first max_length bytes)
  */
 esp_err_t lora_receive_packet(uint8_t *data, size_t max_length, size_t *received_length, uint32_t timeout_ms);
 
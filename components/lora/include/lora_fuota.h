@@ -0,0 +1,276 @@
+/**
+ * @file lora_fuota.h
+ * @brief Multicast firmware updates over LoRa: fragment sessions with forward error correction
+ *
+ * CONTEXT: Presenters in the field were only updated over USB, BLE or Wi-Fi, one at a time
+ * PURPOSE: A receiver broadcasts a compressed container (ota_decompress.h) to all paired
+ *          presenters at once. After the N data fragments it sends parity fragments, each the
+ *          XOR of a pseudo-random half of the data (the LoRaWAN fragmentation matrix, TS004).
+ *          Every presenter rebuilds whatever it lost from any parity it did receive, so one
+ *          repair fragment serves every device instead of a retransmission per device
+ * USAGE: Pure C; lora_fuota_service.c supplies MACs, radio, storage and the clock,
+ *        tests/host runs whole sessions over a simulated lossy radio
+ *
+ * Frame (big-endian): DeviceID(2) | Type(1) | Session(1) | Body | MAC(4)
+ *   SETUP  (receiver): image_size u32 | frag_count u16 | frag_size u8 | version u32 | Ed25519 signature [64]
+ *   FRAG   (receiver): index u16 | data [frag_size]; index >= frag_count is parity index - frag_count + 1
+ *   POLL   (receiver): slot_ms u16, presenters answer in their own slot
+ *   STATUS (presenter): state u8 | received u16 | needed u16 | first_missing u16 | missing u64
+ * The MAC is the truncated HMAC-SHA256 of the sender's per-device key, as in lora_protocol.c.
+ * No frame is sizeof(lora_packet_t) long, so the received length tells them from HID packets (lora_rx.h).
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LORA_FUOTA_FRAME_SETUP 0xF0
+#define LORA_FUOTA_FRAME_FRAG 0xF1
+#define LORA_FUOTA_FRAME_POLL 0xF2
+#define LORA_FUOTA_FRAME_STATUS 0xF3
+
+#define LORA_FUOTA_HEADER_SIZE 4
+#define LORA_FUOTA_MAC_SIZE 4 ///< Same truncation as LORA_MAC_SIZE
+#define LORA_FUOTA_SIGNATURE_SIZE 64
+#define LORA_FUOTA_SETUP_SIZE (LORA_FUOTA_HEADER_SIZE + 11 + LORA_FUOTA_SIGNATURE_SIZE + LORA_FUOTA_MAC_SIZE)
+#define LORA_FUOTA_POLL_SIZE (LORA_FUOTA_HEADER_SIZE + 2 + LORA_FUOTA_MAC_SIZE)
+#define LORA_FUOTA_STATUS_SIZE (LORA_FUOTA_HEADER_SIZE + 15 + LORA_FUOTA_MAC_SIZE)
+#define LORA_FUOTA_FRAG_OVERHEAD (LORA_FUOTA_HEADER_SIZE + 2 + LORA_FUOTA_MAC_SIZE)
+#define LORA_FUOTA_FRAG_SIZE_MIN 16  ///< Keeps FRAG frames clear of the 22-byte HID packet
+#define LORA_FUOTA_FRAG_SIZE_MAX 200 ///< About 80 ms on air at SF7/BW500
+#define LORA_FUOTA_FRAME_MAX (LORA_FUOTA_FRAG_OVERHEAD + LORA_FUOTA_FRAG_SIZE_MAX)
+#define LORA_FUOTA_STATUS_WINDOW 64 ///< Fragments covered by the missing bitmap, as the RX dedup window
+
+/**
+ * @brief Presenter state reported in STATUS
+ */
+typedef enum {
+    LORA_FUOTA_RX_RECEIVING = 0,
+    LORA_FUOTA_RX_COMPLETE  = 1, ///< Every fragment known; the container goes to ota_engine
+    LORA_FUOTA_RX_FAILED    = 2, ///< More fragments lost than the decoder has room for
+} lora_fuota_rx_state_t;
+
+/**
+ * @brief Compute the truncated MAC of data with device_id's key
+ *
+ * @return ESP_ERR_NOT_FOUND if device_id is not paired
+ */
+typedef esp_err_t (*lora_fuota_mac_t)(uint16_t device_id, const uint8_t *data, size_t len,
+                                      uint8_t mac[LORA_FUOTA_MAC_SIZE], void *ctx);
+
+/**
+ * @brief Fragment store, frag_size bytes per index; the sender only reads
+ */
+typedef esp_err_t (*lora_fuota_read_t)(uint16_t index, uint8_t *data, void *ctx);
+typedef esp_err_t (*lora_fuota_write_t)(uint16_t index, const uint8_t *data, void *ctx);
+
+/**
+ * @brief Image version as SETUP carries it; numeric order is release order
+ */
+#define LORA_FUOTA_VERSION(major, minor, patch) \
+    (((uint32_t)(major) << 24) | ((uint32_t)(minor) << 16) | (uint32_t)(patch))
+
+typedef struct {
+    uint32_t image_size;
+    uint16_t frag_count;
+    uint8_t frag_size;
+    uint32_t version; ///< LORA_FUOTA_VERSION() of the image: presenters refuse replays and downgrades
+    uint8_t signature[LORA_FUOTA_SIGNATURE_SIZE];
+} lora_fuota_setup_t;
+
+typedef struct {
+    uint8_t state;          ///< lora_fuota_rx_state_t
+    uint16_t received;      ///< Fragments received, data or parity
+    uint16_t needed;        ///< Further parity fragments the decoder needs at best, 0 when complete
+    uint16_t first_missing; ///< Lowest data fragment not received
+    uint64_t missing;       ///< Bit i: fragment first_missing + i not received, as CMD_ACK's window
+} lora_fuota_status_t;
+
+/**
+ * @brief A parsed and authenticated frame; frag.data points into the parsed buffer
+ */
+typedef struct {
+    uint16_t device_id;
+    uint8_t type;
+    uint8_t session;
+    union {
+        lora_fuota_setup_t setup;
+        struct {
+            uint16_t index;
+            const uint8_t *data;
+            uint8_t len;
+        } frag;
+        uint16_t poll_slot_ms;
+        lora_fuota_status_t status;
+    };
+} lora_fuota_frame_t;
+
+/**
+ * @return ESP_OK, ESP_ERR_NOT_SUPPORTED if this is not a FUOTA frame, ESP_ERR_INVALID_SIZE
+ *         for a truncated one, ESP_ERR_INVALID_CRC if the MAC does not verify, the MAC
+ *         callback's error for an unpaired sender
+ */
+esp_err_t lora_fuota_parse(const uint8_t *buf, size_t len, lora_fuota_frame_t *frame, lora_fuota_mac_t mac,
+                           void *ctx);
+
+/**
+ * @brief Parse "major.minor.patch" as esp_app_desc_t.version holds it; a pre-release or build suffix is ignored
+ *
+ * @return ESP_ERR_INVALID_ARG if text does not start with three numbers in range
+ */
+esp_err_t lora_fuota_parse_version(const char *text, uint32_t *version);
+
+/**
+ * @return Frame length written to out, at most LORA_FUOTA_FRAME_MAX; 0 if the MAC failed
+ */
+size_t lora_fuota_build_setup(uint8_t *out, uint16_t device_id, uint8_t session, const lora_fuota_setup_t *setup,
+                              lora_fuota_mac_t mac, void *ctx);
+size_t lora_fuota_build_poll(uint8_t *out, uint16_t device_id, uint8_t session, uint16_t slot_ms,
+                             lora_fuota_mac_t mac, void *ctx);
+size_t lora_fuota_build_status(uint8_t *out, uint16_t device_id, uint8_t session, const lora_fuota_status_t *status,
+                               lora_fuota_mac_t mac, void *ctx);
+
+/**
+ * @brief Which data fragments parity fragment n (1-based) is the XOR of
+ *
+ * @param row (frag_count + 7) / 8 bytes, bit i set if fragment i is included
+ */
+void lora_fuota_parity_row(uint16_t n, uint16_t frag_count, uint8_t *row);
+
+/**
+ * @brief Broadcast side: data fragments, then parity in rounds sized by STATUS replies
+ */
+typedef struct {
+    lora_fuota_read_t read;
+    void *ctx;
+    uint8_t session;
+    uint8_t frag_size;
+    uint16_t frag_count;
+    uint8_t redundancy_percent; ///< Parity sent unasked, and margin on every repair round
+    uint8_t *row;               ///< Parity row scratch, (frag_count + 7) / 8 bytes
+    uint16_t next_data;         ///< Next data fragment of the first round
+    uint32_t next_parity;       ///< Next parity number; each is sent once per session
+    uint32_t round_left;        ///< Parity fragments left in the current round
+} lora_fuota_tx_t;
+
+/**
+ * @param row_buf (frag_count + 7) / 8 bytes, owned by the caller
+ * @return ESP_ERR_INVALID_ARG if frag_size is out of range or the image needs more than
+ *         half of the 16-bit fragment index space
+ */
+esp_err_t lora_fuota_tx_init(lora_fuota_tx_t *tx, uint8_t session, uint32_t image_size, uint8_t frag_size,
+                             uint8_t redundancy_percent, uint8_t *row_buf, lora_fuota_read_t read, void *ctx);
+
+/**
+ * @brief Build the next FRAG frame of the current round
+ *
+ * @return Frame length, 0 when the round is over (poll the presenters then), or 0 with
+ *         *err set if the store or the MAC failed
+ */
+size_t lora_fuota_tx_next(lora_fuota_tx_t *tx, uint16_t device_id, uint8_t *out, lora_fuota_mac_t mac, void *ctx,
+                          esp_err_t *err);
+
+/**
+ * @brief Start a repair round for the neediest presenter
+ *
+ * @param needed Largest STATUS needed among presenters not yet complete
+ * @return Parity fragments in the round, 0 if nothing is needed or the parity space is used up
+ */
+uint32_t lora_fuota_tx_repair(lora_fuota_tx_t *tx, uint16_t needed);
+
+/**
+ * @brief Presenter side: rebuilds lost data fragments from parity
+ *
+ * Data fragments go to the store at their index. The first parity fragment freezes the set
+ * of missing fragments; from then on every fragment is a row of a linear system over GF(2)
+ * in the missing ones, reduced on arrival (incremental Gaussian elimination). A row whose
+ * lowest unknown is column q is kept in the store slot of missing fragment q, so the store
+ * is the image itself plus nothing: back substitution turns those slots into the data.
+ */
+typedef struct {
+    lora_fuota_read_t read;
+    lora_fuota_write_t write;
+    void *ctx;
+    uint32_t image_size;
+    uint16_t frag_count;
+    uint8_t frag_size;
+    uint8_t state;          ///< lora_fuota_rx_state_t
+    uint16_t max_missing;   ///< Decoder capacity in lost fragments
+    uint16_t received;      ///< Fragments accepted, data or parity
+    uint16_t data_known;    ///< Data fragments received as such
+    bool coded;             ///< A parity fragment arrived: missing[] is fixed
+    uint16_t missing_count; ///< Unknowns of the system
+    uint16_t pivots;        ///< Independent rows held
+    uint8_t *known;         ///< frag_count bits
+    uint16_t *missing;      ///< Column -> fragment index, ascending
+    uint8_t *matrix;        ///< max_missing rows of max_missing bits; row q set iff it has bit q
+    uint8_t *row;           ///< Parity row scratch
+    uint8_t *cols;          ///< Row scratch in missing columns
+    uint8_t *acc;           ///< frag_size scratch
+    uint8_t *tmp;           ///< frag_size scratch
+} lora_fuota_rx_t;
+
+/**
+ * @return Bytes of memory lora_fuota_rx_init() needs for this session
+ */
+size_t lora_fuota_rx_mem_size(uint16_t frag_count, uint8_t frag_size, uint16_t max_missing);
+
+/**
+ * @param mem lora_fuota_rx_mem_size() bytes, owned by the caller
+ */
+esp_err_t lora_fuota_rx_init(lora_fuota_rx_t *rx, const lora_fuota_setup_t *setup, uint16_t max_missing, void *mem,
+                             lora_fuota_read_t read, lora_fuota_write_t write, void *ctx);
+
+/**
+ * @brief Take one received fragment
+ *
+ * @return ESP_OK, also for duplicates and rows that add nothing; ESP_ERR_INVALID_ARG for an
+ *         index or length outside the session; ESP_ERR_NO_MEM once more fragments were lost
+ *         than max_missing (state FAILED); the store's error
+ */
+esp_err_t lora_fuota_rx_fragment(lora_fuota_rx_t *rx, uint16_t index, const uint8_t *data, size_t len);
+
+void lora_fuota_rx_status(const lora_fuota_rx_t *rx, lora_fuota_status_t *status);
+
+/**
+ * @brief Time on air of one explicit-header LoRa packet with CRC, as lora_driver sends it
+ *
+ * @param coding_rate 5..8 for 4/5..4/8, as lora_config_t
+ */
+uint32_t lora_fuota_airtime_us(uint8_t spreading_factor, uint16_t bandwidth_khz, uint8_t coding_rate,
+                               uint16_t preamble, size_t payload_len);
+
+/**
+ * @brief Duty-cycle budget: after a packet of airtime t the band is off for t * (100 / percent - 1)
+ *
+ * The per-transmission off-time of ETSI EN 300 220, as LoRaWAN devices apply it. It never
+ * exceeds the hourly budget and needs no history.
+ */
+typedef struct {
+    uint8_t percent;     ///< From lora_compliance_t, 0 = no limit
+    uint64_t next_tx_us; ///< Earliest start of the next transmission
+    uint64_t airtime_us; ///< Spent in this session
+} lora_fuota_duty_t;
+
+void lora_fuota_duty_init(lora_fuota_duty_t *duty, uint8_t percent);
+
+/**
+ * @return Microseconds to wait before a transmission may start at now_us
+ */
+uint64_t lora_fuota_duty_wait_us(const lora_fuota_duty_t *duty, uint64_t now_us);
+
+/**
+ * @brief Record a transmission that started at now_us
+ */
+void lora_fuota_duty_spend(lora_fuota_duty_t *duty, uint64_t now_us, uint32_t airtime_us);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,50 @@
+/**
+ * @file lora_fuota_service.h
+ * @brief LoRa multicast firmware updates on the device (see lora_fuota.h)
+ *
+ * CONTEXT: lora_fuota.c is the radio-independent session logic
+ * PURPOSE: A receiver broadcasts a staged container to every paired presenter under the
+ *          regional duty cycle and repairs losses in rounds from their STATUS bitmaps;
+ *          presenters rebuild it in a LittleFS staging file and hand it to ota_engine,
+ *          which verifies the Ed25519 signature before anything boots
+ * USAGE: lora_fuota_service_start() after lora_protocol_start(); a receiver then calls
+ *        lora_fuota_service_broadcast() with a container from sign_firmware.py --compress
+ *        (POST /api/fuota/broadcast on the config web server)
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include "lora_fuota.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Take FUOTA frames from the protocol RX task and start the service task
+ */
+esp_err_t lora_fuota_service_start(void);
+
+/**
+ * @brief Broadcast a container to all paired presenters in the background
+ *
+ * The image version for SETUP comes from the image's esp_app_desc_t; presenters only accept
+ * a version newer than the one they run.
+ *
+ * @param path Container on a mounted filesystem, staged for the broadcast: deleted when it ends
+ * @param signature Ed25519 signature of the decompressed image (.sig)
+ * @return ESP_ERR_INVALID_STATE if the service is not started or already broadcasting
+ */
+esp_err_t lora_fuota_service_broadcast(const char *path, const uint8_t signature[LORA_FUOTA_SIGNATURE_SIZE]);
+
+/**
+ * @return Whether a broadcast is queued or running
+ */
+bool lora_fuota_service_broadcasting(void);
+
+#ifdef __cplusplus
+}
+#endif
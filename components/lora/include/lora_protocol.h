@@ -122,6 +122,25 @@ esp_err_t lora_protocol_init(uint16_t device_id, const uint8_t *aes_key);
  */
 esp_err_t lora_protocol_send_keyboard(uint8_t slot_id, uint8_t modifiers, uint8_t keycode);
 
+/**
+ * @brief Restore device ID, key schedule and TX sequence retained across deep sleep
+ *
+ * For fast_resume only; runs before NVS and lora_protocol_init().
+ *
+ * @return ESP_ERR_INVALID_STATE if nothing valid was retained
+ */
+esp_err_t lora_protocol_fast_resume(void);
+
+/**
+ * @brief Send keyboard key press right after lora_protocol_fast_resume()
+ *
+ * Unreliable send through lora_driver_transmit_now(). Uses only sequence numbers
+ * already reserved in NVS; lora_protocol_init() continues after them.
+ *
+ * @return ESP_ERR_INVALID_STATE if not resumed or the reservation is used up
+ */
+esp_err_t lora_protocol_fast_send_keyboard(uint8_t slot_id, uint8_t modifiers, uint8_t keycode);
+
 /**
  * @brief Send keyboard with ACK
  */
@@ -262,6 +281,38 @@ void lora_protocol_register_rx_callback(lora_protocol_rx_callback_t callback, vo
  */
 void lora_protocol_register_state_callback(lora_protocol_state_callback_t callback, void *user_ctx);
 
+/**
+ * @brief Receives packets that are not sizeof(lora_packet_t) long, unverified (lora_fuota.h)
+ *
+ * Runs in the protocol RX task: copy the frame and return.
+ */
+typedef void (*lora_protocol_frame_callback_t)(const uint8_t *frame, size_t length, int16_t rssi, void *user_ctx);
+
+/**
+ * @brief Register raw frame callback
+ * @param callback Callback function
+ * @param user_ctx User context
+ */
+void lora_protocol_register_frame_callback(lora_protocol_frame_callback_t callback, void *user_ctx);
+
+/**
+ * @brief Truncated HMAC-SHA256 of a raw frame, with this device's key or a paired device's
+ *
+ * @param mac LORA_MAC_SIZE bytes out
+ * @return ESP_ERR_NOT_FOUND if device_id is neither this device nor paired
+ */
+esp_err_t lora_protocol_frame_mac(uint16_t device_id, const uint8_t *data, size_t length, uint8_t *mac);
+
+/**
+ * @brief Queue a raw frame that already carries its MAC
+ */
+esp_err_t lora_protocol_send_frame(const uint8_t *frame, size_t length);
+
+/**
+ * @brief Device ID given to lora_protocol_init()
+ */
+uint16_t lora_protocol_get_device_id(void);
+
 /**
  * @brief Start protocol RX task
  * @return ESP_OK on success
@@ -0,0 +1,36 @@
+/**
+ * @file lora_rx.h
+ * @brief Routing of received radio payloads by their length
+ *
+ * CONTEXT: lora_protocol_receive_packet() sees every payload the radio receives
+ * PURPOSE: HID/ACK packets are exactly LORA_RX_PACKET_SIZE long; any other length is a multicast
+ *          OTA frame (lora_fuota.h) for the frame callback. Routing needs the length as received,
+ *          so the receive buffer holds the largest radio payload, not one HID packet
+ * USAGE: Pure C; tests/host feeds full-length FUOTA frames through it
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LORA_RX_PACKET_SIZE 22  ///< sizeof(lora_packet_t)
+#define LORA_RX_BUFFER_SIZE 255 ///< Largest SX126x payload; every FUOTA frame fits
+
+typedef enum {
+    LORA_RX_PACKET,  ///< HID/ACK packet, verified by lora_protocol
+    LORA_RX_FRAME,   ///< Multicast OTA frame, verified by its consumer
+    LORA_RX_INVALID, ///< Empty, or longer than the receive buffer (truncated)
+} lora_rx_kind_t;
+
+/**
+ * @param length Payload length as received, before any copy into a buffer
+ */
+lora_rx_kind_t lora_rx_classify(size_t length);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,151 +1,65 @@
 /**
  * @file lora_bands.c
  * @brief LoRa regulatory compliance and hardware profiles
+ *
+ * Lookups over the const tables generated from lora_regulatory.json (see lora_tables.h)
  */
 
 #include "lora_bands.h"
-#include "cJSON.h"
-#include "esp_log.h"
+#include "lora_tables.h"
+#include <stdlib.h>
 #include <string.h>
 
-static const char *TAG = "LORA_REGULATORY";
-
-// Embedded JSON file
-extern const uint8_t lora_regulatory_json_start[] asm("_binary_lora_regulatory_json_start");
-extern const uint8_t lora_regulatory_json_end[] asm("_binary_lora_regulatory_json_end");
-
-static lora_hardware_t hardware_profiles[LORA_MAX_HARDWARE];
-static lora_region_t regions[LORA_MAX_REGIONS];
-static lora_compliance_t compliance_rules[LORA_MAX_COMPLIANCE];
-static int hardware_count = 0;
-static int region_count = 0;
-static int compliance_count = 0;
-static bool regulatory_initialized = false;
-
-esp_err_t lora_regulatory_init(void)
+static int compare_region_slot(const void *key, const void *entry)
 {
-    if (regulatory_initialized) {
-        return ESP_OK;
-    }
-
-    ESP_LOGI(TAG, "Parsing embedded lora_regulatory.json");
-
-    cJSON *root = cJSON_Parse((const char *)lora_regulatory_json_start);
-    if (!root) {
-        ESP_LOGE(TAG, "Failed to parse JSON");
-        return ESP_FAIL;
-    }
-
-    // Parse hardware profiles
-    cJSON *hardware_array = cJSON_GetObjectItem(root, "hardware");
-    if (cJSON_IsArray(hardware_array)) {
-        hardware_count = 0;
-        cJSON *hw = NULL;
-        cJSON_ArrayForEach(hw, hardware_array) {
-            if (hardware_count >= LORA_MAX_HARDWARE) break;
-            
-            cJSON *id = cJSON_GetObjectItem(hw, "id");
-            cJSON *name = cJSON_GetObjectItem(hw, "name");
-            cJSON *freq_min = cJSON_GetObjectItem(hw, "freq_min_khz");
-            cJSON *freq_max = cJSON_GetObjectItem(hw, "freq_max_khz");
-            cJSON *optimal = cJSON_GetObjectItem(hw, "optimal_khz");
-            
-            if (cJSON_IsString(id) && cJSON_IsString(name) && 
-                cJSON_IsNumber(freq_min) && cJSON_IsNumber(freq_max) && cJSON_IsNumber(optimal)) {
-                
-                strncpy(hardware_profiles[hardware_count].id, id->valuestring, sizeof(hardware_profiles[hardware_count].id) - 1);
-                strncpy(hardware_profiles[hardware_count].name, name->valuestring, sizeof(hardware_profiles[hardware_count].name) - 1);
-                hardware_profiles[hardware_count].freq_min_khz = freq_min->valueint;
-                hardware_profiles[hardware_count].freq_max_khz = freq_max->valueint;
-                hardware_profiles[hardware_count].optimal_khz = optimal->valueint;
-                hardware_count++;
-            }
-        }
-    }
+    return strcmp((const char *)key, ((const lora_region_slot_t *)entry)->id);
+}
 
-    // Parse regions
-    cJSON *regions_array = cJSON_GetObjectItem(root, "regions");
-    if (cJSON_IsArray(regions_array)) {
-        region_count = 0;
-        cJSON *region = NULL;
-        cJSON_ArrayForEach(region, regions_array) {
-            if (region_count >= LORA_MAX_REGIONS) break;
-            
-            cJSON *id = cJSON_GetObjectItem(region, "id");
-            cJSON *name = cJSON_GetObjectItem(region, "name");
-            
-            if (cJSON_IsString(id) && cJSON_IsString(name)) {
-                strncpy(regions[region_count].id, id->valuestring, sizeof(regions[region_count].id) - 1);
-                strncpy(regions[region_count].name, name->valuestring, sizeof(regions[region_count].name) - 1);
-                region_count++;
-            }
-        }
+static const lora_region_slot_t *find_region_slot(const char *region_id)
+{
+    if (!region_id) {
+        return NULL;
     }
+    return bsearch(region_id, lora_region_index, lora_region_count, sizeof(lora_region_index[0]),
+                   compare_region_slot);
+}
 
-    // Parse compliance rules
-    cJSON *compliance_array = cJSON_GetObjectItem(root, "compliance");
-    if (cJSON_IsArray(compliance_array)) {
-        compliance_count = 0;
-        cJSON *rule = NULL;
-        cJSON_ArrayForEach(rule, compliance_array) {
-            if (compliance_count >= LORA_MAX_COMPLIANCE) break;
-            
-            cJSON *region = cJSON_GetObjectItem(rule, "region");
-            cJSON *hardware = cJSON_GetObjectItem(rule, "hardware");
-            cJSON *freq_min = cJSON_GetObjectItem(rule, "freq_min_khz");
-            cJSON *freq_max = cJSON_GetObjectItem(rule, "freq_max_khz");
-            cJSON *max_power = cJSON_GetObjectItem(rule, "max_power_dbm");
-            
-            if (cJSON_IsString(region) && cJSON_IsString(hardware) && 
-                cJSON_IsNumber(freq_min) && cJSON_IsNumber(freq_max) && cJSON_IsNumber(max_power)) {
-                
-                strncpy(compliance_rules[compliance_count].region_id, region->valuestring, sizeof(compliance_rules[compliance_count].region_id) - 1);
-                strncpy(compliance_rules[compliance_count].hardware_id, hardware->valuestring, sizeof(compliance_rules[compliance_count].hardware_id) - 1);
-                compliance_rules[compliance_count].freq_min_khz = freq_min->valueint;
-                compliance_rules[compliance_count].freq_max_khz = freq_max->valueint;
-                compliance_rules[compliance_count].max_power_dbm = max_power->valueint;
-                
-                // Optional fields
-                cJSON *duty_cycle = cJSON_GetObjectItem(rule, "duty_cycle_percent");
-                compliance_rules[compliance_count].duty_cycle_percent = cJSON_IsNumber(duty_cycle) ? duty_cycle->valueint : 0;
-                
-                cJSON *fhss = cJSON_GetObjectItem(rule, "fhss_required");
-                compliance_rules[compliance_count].fhss_required = cJSON_IsTrue(fhss);
-                
-                cJSON *lbt = cJSON_GetObjectItem(rule, "lbt_required");
-                compliance_rules[compliance_count].lbt_required = cJSON_IsTrue(lbt);
-                
-                compliance_count++;
-            }
-        }
+static int compare_freq_segment(const void *key, const void *entry)
+{
+    uint32_t freq_khz                  = *(const uint32_t *)key;
+    const lora_freq_segment_t *segment = entry;
+    if (freq_khz < segment->freq_min_khz) {
+        return -1;
     }
+    return freq_khz > segment->freq_max_khz ? 1 : 0;
+}
 
-    cJSON_Delete(root);
-    regulatory_initialized = true;
-
-    ESP_LOGI(TAG, "Loaded %d hardware profiles, %d regions, %d compliance rules", 
-             hardware_count, region_count, compliance_count);
+esp_err_t lora_regulatory_init(void)
+{
     return ESP_OK;
 }
 
 int lora_hardware_get_count(void)
 {
-    return hardware_count;
+    return lora_hardware_count;
 }
 
 const lora_hardware_t *lora_hardware_get_profile(int index)
 {
-    if (index < 0 || index >= hardware_count) {
+    if (index < 0 || index >= lora_hardware_count) {
         return NULL;
     }
-    return &hardware_profiles[index];
+    return &lora_hardware_table[index];
 }
 
 const lora_hardware_t *lora_hardware_get_profile_by_id(const char *id)
 {
-    for (int i = 0; i < hardware_count; i++) {
-        if (strcmp(hardware_profiles[i].id, id) == 0) {
-            return &hardware_profiles[i];
+    if (!id) {
+        return NULL;
+    }
+    for (int i = 0; i < lora_hardware_count; i++) {
+        if (strcmp(lora_hardware_table[i].id, id) == 0) {
+            return &lora_hardware_table[i];
         }
     }
     return NULL;
@@ -153,46 +67,42 @@ const lora_hardware_t *lora_hardware_get_profile_by_id(const char *id)
 
 int lora_hardware_get_index_by_frequency(uint32_t frequency_hz)
 {
-    uint32_t freq_khz = frequency_hz / 1000;
-
-    for (int i = 0; i < hardware_count; i++) {
-        if (freq_khz >= hardware_profiles[i].freq_min_khz && freq_khz <= hardware_profiles[i].freq_max_khz) {
-            return i;
-        }
-    }
-
-    return -1;
+    uint32_t freq_khz                  = frequency_hz / 1000;
+    const lora_freq_segment_t *segment = bsearch(&freq_khz, lora_freq_index, lora_freq_index_count,
+                                                 sizeof(lora_freq_index[0]), compare_freq_segment);
+    return segment ? segment->hardware : -1;
 }
 
 int lora_regulatory_get_region_count(void)
 {
-    return region_count;
+    return lora_region_count;
 }
 
 const lora_region_t *lora_regulatory_get_region(int index)
 {
-    if (index < 0 || index >= region_count) {
+    if (index < 0 || index >= lora_region_count) {
         return NULL;
     }
-    return &regions[index];
+    return &lora_region_table[index];
 }
 
 const lora_region_t *lora_regulatory_get_region_by_id(const char *region_id)
 {
-    for (int i = 0; i < region_count; i++) {
-        if (strcmp(regions[i].id, region_id) == 0) {
-            return &regions[i];
-        }
-    }
-    return NULL;
+    const lora_region_slot_t *slot = find_region_slot(region_id);
+    return slot ? &lora_region_table[slot->region] : NULL;
 }
 
 const lora_compliance_t *lora_regulatory_get_compliance(const char *region_id, const char *hardware_id)
 {
-    for (int i = 0; i < compliance_count; i++) {
-        if (strcmp(compliance_rules[i].region_id, region_id) == 0 && 
-            strcmp(compliance_rules[i].hardware_id, hardware_id) == 0) {
-            return &compliance_rules[i];
+    const lora_region_slot_t *slot = find_region_slot(region_id);
+    if (!slot || !hardware_id) {
+        return NULL;
+    }
+
+    for (int i = 0; i < slot->rules_count; i++) {
+        const lora_compliance_t *rule = &lora_compliance_table[lora_compliance_by_region[slot->rules_first + i]];
+        if (strcmp(rule->hardware_id, hardware_id) == 0) {
+            return rule;
         }
     }
     return NULL;
@@ -200,20 +110,21 @@ const lora_compliance_t *lora_regulatory_get_compliance(const char *region_id, c
 
 int lora_regulatory_get_available_hardware(const char *region_id, const char **hardware_ids, int max_count)
 {
+    const lora_region_slot_t *slot = find_region_slot(region_id);
+    if (!slot) {
+        return 0;
+    }
+
     int count = 0;
-    for (int i = 0; i < compliance_count && count < max_count; i++) {
-        if (strcmp(compliance_rules[i].region_id, region_id) == 0) {
-            // Check if already added
-            bool already_added = false;
-            for (int j = 0; j < count; j++) {
-                if (strcmp(hardware_ids[j], compliance_rules[i].hardware_id) == 0) {
-                    already_added = true;
-                    break;
-                }
-            }
-            if (!already_added) {
-                hardware_ids[count++] = compliance_rules[i].hardware_id;
-            }
+    for (int i = 0; i < slot->rules_count && count < max_count; i++) {
+        const char *hardware_id = lora_compliance_table[lora_compliance_by_region[slot->rules_first + i]].hardware_id;
+        // A region can have several rules for the same hardware (sub-bands)
+        bool already_added = false;
+        for (int j = 0; j < count && !already_added; j++) {
+            already_added = strcmp(hardware_ids[j], hardware_id) == 0;
+        }
+        if (!already_added) {
+            hardware_ids[count++] = hardware_id;
         }
     }
     return count;
@@ -222,7 +133,7 @@ int lora_regulatory_get_available_hardware(const char *region_id, const char **h
 bool lora_regulatory_validate_domain(const char *domain)
 {
     if (!domain || strlen(domain) == 0) return true; // Empty = "Unknown" is valid
-    if (strlen(domain) != 2) return false; // Must be 2 chars
+    if (strlen(domain) != 2) return false;           // Must be 2 chars
     return lora_regulatory_get_region_by_id(domain) != NULL;
 }
 
@@ -231,14 +142,3 @@ const lora_compliance_t *lora_regulatory_get_limits(const char *domain, const ch
     if (!domain || strlen(domain) == 0) return NULL; // No limits for "Unknown"
     return lora_regulatory_get_compliance(domain, hardware_id);
 }
-
-int lora_regulatory_get_region_count(void)
-{
-    return region_count;
-}
-
-const lora_region_t *lora_regulatory_get_region(int index)
-{
-    if (index < 0 || index >= region_count) return NULL;
-    return &regions[index];
-}
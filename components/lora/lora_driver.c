@@ -15,6 +15,7 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
 #include "lora_bands.h"
+#include "power_mgmt.h"
 #include "sx126x.h"
 #include "task_config.h"
 #include <string.h>
@@ -25,6 +26,8 @@ static const char *TAG = "LORA_DRIVER";
 #define TX_QUEUE_SIZE 8
 #define RX_QUEUE_SIZE 8
 #define MAX_PACKET_SIZE 255
+#define RX_POLL_INTERVAL_MS 5  // Fallback for boards without DIO1
+#define TX_DONE_TIMEOUT_MS 600 // Longest packet at SF12/125 kHz stays below this
 
 // cppcheck-suppress unusedStructMember
 typedef struct {
@@ -42,6 +45,7 @@ static QueueHandle_t tx_queue      = NULL;
 static QueueHandle_t rx_queue      = NULL;
 static TaskHandle_t tx_task_handle = NULL;
 static TaskHandle_t rx_task_handle = NULL;
+static int rx_sleep_client         = -1;
 
 // LoRa configuration
 static lora_config_t current_config = {
@@ -84,6 +88,12 @@ static uint8_t lora_bandwidth_to_register(uint16_t bandwidth)
     return 0x04; // Default to 125 kHz
 }
 
+// Park the radio in warm-start sleep so fast_resume can transmit without reset/calibration
+static void lora_deep_sleep_cb(void)
+{
+    sx126x_sleep_warm();
+}
+
 // TX task - processes queue and transmits packets
 static void lora_tx_task(void *arg)
 {
@@ -94,7 +104,10 @@ static void lora_tx_task(void *arg)
         if (xQueueReceive(tx_queue, &packet, portMAX_DELAY) == pdTRUE) {
             ESP_LOGI(TAG, "LoRa TX: %d bytes", packet.length);
 
+            // Sync TX returns after TX_DONE with the radio back in continuous RX
+            power_mgmt_record_state(ENERGY_COMPONENT_RADIO, ENERGY_RADIO_TX);
             esp_err_t ret = sx126x_send(packet.data, packet.length, SX126x_TXMODE_SYNC);
+            power_mgmt_record_state(ENERGY_COMPONENT_RADIO, ENERGY_RADIO_RX);
             if (ret != ESP_OK) {
                 ESP_LOGE(TAG, "TX failed: %s", esp_err_to_name(ret));
             } else {
@@ -104,14 +117,27 @@ static void lora_tx_task(void *arg)
     }
 }
 
-// RX task - continuously polls for incoming packets and enqueues them
+// RX task - waits for DIO1 (or polls where the board has no DIO1 line) and enqueues packets
 static void lora_rx_task(void *arg)
 {
     uint8_t rx_buffer[MAX_PACKET_SIZE];
     uint8_t bytes_received;
 
+    // Interrupt-driven RX lets the CPU light-sleep between packets
+    bool irq_driven = (sx126x_enable_dio1_irq(xTaskGetCurrentTaskHandle()) == ESP_OK);
+    if (irq_driven) {
+        power_mgmt_sleep_register("lora_rx", SLEEP_WAKE_RADIO, 0, &rx_sleep_client);
+    } else {
+        ESP_LOGW(TAG, "DIO1 interrupt unavailable, polling radio every %dms", RX_POLL_INTERVAL_MS);
+        power_mgmt_sleep_register("lora_rx", SLEEP_WAKE_TIMER, RX_POLL_INTERVAL_MS, &rx_sleep_client);
+    }
+
     while (1) {
-        // Check for TX completion (for interrupt-driven TX)
+        if (irq_driven) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        }
+
+        // Check for TX completion (signals sx126x_send)
         sx126x_check_tx_done();
 
         esp_err_t ret = sx126x_receive(rx_buffer, MAX_PACKET_SIZE, &bytes_received);
@@ -129,8 +155,11 @@ static void lora_rx_task(void *arg)
             }
         }
 
-        // Poll every 5ms for better responsiveness
-        vTaskDelay(pdMS_TO_TICKS(5));
+        if (irq_driven) {
+            sx126x_dio1_rearm();
+        } else {
+            vTaskDelay(pdMS_TO_TICKS(RX_POLL_INTERVAL_MS));
+        }
     }
 }
 
@@ -224,6 +253,9 @@ esp_err_t lora_driver_init(void)
         return ESP_FAIL;
     }
 
+    power_mgmt_record_state(ENERGY_COMPONENT_RADIO, ENERGY_RADIO_RX);
+    power_mgmt_register_deep_sleep_cb(lora_deep_sleep_cb);
+
     ESP_LOGI(TAG, "SX1262 initialized successfully with TX/RX tasks");
     return ESP_OK;
 }
@@ -252,6 +284,33 @@ esp_err_t lora_send_packet(const uint8_t *data, size_t length)
     return ESP_OK;
 }
 
+esp_err_t lora_driver_fast_resume(void)
+{
+    esp_err_t ret = sx126x_resume_warm();
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Warm radio resume failed: %s", esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+esp_err_t lora_driver_transmit_now(const uint8_t *data, size_t length)
+{
+    if (!data || length == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (length > MAX_PACKET_SIZE) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // No tasks or DIO1 ISR yet: start TX and busy-poll for TX_DONE
+    esp_err_t ret = sx126x_send(data, length, SX126x_TXMODE_ASYNC);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    return sx126x_wait_tx_done(TX_DONE_TIMEOUT_MS);
+}
+
 esp_err_t lora_receive_packet(uint8_t *data, size_t max_length, size_t *received_length, uint32_t timeout_ms)
 {
     if (!data || !received_length || max_length == 0) {
@@ -262,13 +321,16 @@ esp_err_t lora_receive_packet(uint8_t *data, size_t max_length, size_t *received
     *received_length = 0;
 
     lora_rx_packet_t rx_packet;
-    if (xQueueReceive(rx_queue, &rx_packet, pdMS_TO_TICKS(timeout_ms)) == pdTRUE) {
+    TickType_t ticks = (timeout_ms == LORA_WAIT_FOREVER) ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+    if (xQueueReceive(rx_queue, &rx_packet, ticks) == pdTRUE) {
         size_t copy_len = (rx_packet.length < max_length) ? rx_packet.length : max_length;
         memcpy(data, rx_packet.data, copy_len);
         *received_length = copy_len;
 
+        // A cut payload has the wrong length for routing and a MAC that cannot verify
         if (rx_packet.length > max_length) {
             ESP_LOGW(TAG, "RX packet truncated: %d > %d", rx_packet.length, max_length);
+            return ESP_ERR_INVALID_SIZE;
         }
 
         return ESP_OK;
@@ -403,6 +465,7 @@ esp_err_t lora_set_receive_mode(void)
 
     // Set LoRa to continuous receive mode
     SetRx(0); // 0 = continuous receive mode
+    power_mgmt_record_state(ENERGY_COMPONENT_RADIO, ENERGY_RADIO_RX);
 
     return ESP_OK;
 }
@@ -0,0 +1,600 @@
+/**
+ * @file lora_fuota.c
+ * @brief Multicast firmware updates over LoRa: fragment sessions with forward error correction
+ */
+
+#include "lora_fuota.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define FRAG_INDEX_SPACE 65536U
+
+static void put_be16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+static void put_be32(uint8_t *p, uint32_t v)
+{
+    put_be16(p, (uint16_t)(v >> 16));
+    put_be16(p + 2, (uint16_t)v);
+}
+
+static uint16_t get_be16(const uint8_t *p)
+{
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static uint32_t get_be32(const uint8_t *p)
+{
+    return ((uint32_t)get_be16(p) << 16) | get_be16(p + 2);
+}
+
+static bool bit_get(const uint8_t *bits, uint32_t i)
+{
+    return (bits[i / 8] >> (i % 8)) & 1;
+}
+
+static void bit_set(uint8_t *bits, uint32_t i)
+{
+    bits[i / 8] |= (uint8_t)(1U << (i % 8));
+}
+
+static void xor_bytes(uint8_t *dst, const uint8_t *src, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        dst[i] ^= src[i];
+    }
+}
+
+static size_t put_header(uint8_t *out, uint16_t device_id, uint8_t type, uint8_t session)
+{
+    put_be16(out, device_id);
+    out[2] = type;
+    out[3] = session;
+    return LORA_FUOTA_HEADER_SIZE;
+}
+
+static size_t seal(uint8_t *out, size_t len, uint16_t device_id, lora_fuota_mac_t mac, void *ctx)
+{
+    if (mac(device_id, out, len, out + len, ctx) != ESP_OK) {
+        return 0;
+    }
+    return len + LORA_FUOTA_MAC_SIZE;
+}
+
+esp_err_t lora_fuota_parse(const uint8_t *buf, size_t len, lora_fuota_frame_t *frame, lora_fuota_mac_t mac,
+                           void *ctx)
+{
+    if (len < LORA_FUOTA_HEADER_SIZE + LORA_FUOTA_MAC_SIZE) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    uint8_t type = buf[2];
+    bool sized;
+    switch (type) {
+        case LORA_FUOTA_FRAME_SETUP:
+            sized = len == LORA_FUOTA_SETUP_SIZE;
+            break;
+        case LORA_FUOTA_FRAME_FRAG:
+            sized = len >= LORA_FUOTA_FRAG_OVERHEAD + LORA_FUOTA_FRAG_SIZE_MIN && len <= LORA_FUOTA_FRAME_MAX;
+            break;
+        case LORA_FUOTA_FRAME_POLL:
+            sized = len == LORA_FUOTA_POLL_SIZE;
+            break;
+        case LORA_FUOTA_FRAME_STATUS:
+            sized = len == LORA_FUOTA_STATUS_SIZE;
+            break;
+        default:
+            return ESP_ERR_NOT_SUPPORTED;
+    }
+    if (!sized) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    memset(frame, 0, sizeof(*frame));
+    frame->device_id = get_be16(buf);
+    frame->type      = type;
+    frame->session   = buf[3];
+
+    uint8_t expected[LORA_FUOTA_MAC_SIZE];
+    size_t body_end = len - LORA_FUOTA_MAC_SIZE;
+    esp_err_t ret   = mac(frame->device_id, buf, body_end, expected, ctx);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    if (memcmp(expected, buf + body_end, LORA_FUOTA_MAC_SIZE) != 0) {
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    const uint8_t *body = buf + LORA_FUOTA_HEADER_SIZE;
+    switch (type) {
+        case LORA_FUOTA_FRAME_SETUP:
+            frame->setup.image_size = get_be32(body);
+            frame->setup.frag_count = get_be16(body + 4);
+            frame->setup.frag_size  = body[6];
+            frame->setup.version    = get_be32(body + 7);
+            memcpy(frame->setup.signature, body + 11, LORA_FUOTA_SIGNATURE_SIZE);
+            break;
+        case LORA_FUOTA_FRAME_FRAG:
+            frame->frag.index = get_be16(body);
+            frame->frag.data  = body + 2;
+            frame->frag.len   = (uint8_t)(body_end - LORA_FUOTA_HEADER_SIZE - 2);
+            break;
+        case LORA_FUOTA_FRAME_POLL:
+            frame->poll_slot_ms = get_be16(body);
+            break;
+        case LORA_FUOTA_FRAME_STATUS:
+            frame->status.state         = body[0];
+            frame->status.received      = get_be16(body + 1);
+            frame->status.needed        = get_be16(body + 3);
+            frame->status.first_missing = get_be16(body + 5);
+            frame->status.missing       = ((uint64_t)get_be32(body + 7) << 32) | get_be32(body + 11);
+            break;
+    }
+    return ESP_OK;
+}
+
+esp_err_t lora_fuota_parse_version(const char *text, uint32_t *version)
+{
+    static const unsigned long limit[3] = {0xFF, 0xFF, 0xFFFF};
+    unsigned long part[3];
+    const char *p = text;
+    for (int i = 0; i < 3; i++) {
+        if (*p < '0' || *p > '9') {
+            return ESP_ERR_INVALID_ARG;
+        }
+        char *end;
+        part[i] = strtoul(p, &end, 10);
+        if (part[i] > limit[i] || (i < 2 && *end != '.')) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        p = i < 2 ? end + 1 : end;
+    }
+    if (*p != '\0' && *p != '-' && *p != '+') {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *version = LORA_FUOTA_VERSION(part[0], part[1], part[2]);
+    return ESP_OK;
+}
+
+size_t lora_fuota_build_setup(uint8_t *out, uint16_t device_id, uint8_t session, const lora_fuota_setup_t *setup,
+                              lora_fuota_mac_t mac, void *ctx)
+{
+    size_t n = put_header(out, device_id, LORA_FUOTA_FRAME_SETUP, session);
+    put_be32(out + n, setup->image_size);
+    put_be16(out + n + 4, setup->frag_count);
+    out[n + 6] = setup->frag_size;
+    put_be32(out + n + 7, setup->version);
+    memcpy(out + n + 11, setup->signature, LORA_FUOTA_SIGNATURE_SIZE);
+    return seal(out, n + 11 + LORA_FUOTA_SIGNATURE_SIZE, device_id, mac, ctx);
+}
+
+size_t lora_fuota_build_poll(uint8_t *out, uint16_t device_id, uint8_t session, uint16_t slot_ms,
+                             lora_fuota_mac_t mac, void *ctx)
+{
+    size_t n = put_header(out, device_id, LORA_FUOTA_FRAME_POLL, session);
+    put_be16(out + n, slot_ms);
+    return seal(out, n + 2, device_id, mac, ctx);
+}
+
+size_t lora_fuota_build_status(uint8_t *out, uint16_t device_id, uint8_t session, const lora_fuota_status_t *status,
+                               lora_fuota_mac_t mac, void *ctx)
+{
+    size_t n   = put_header(out, device_id, LORA_FUOTA_FRAME_STATUS, session);
+    out[n]     = status->state;
+    put_be16(out + n + 1, status->received);
+    put_be16(out + n + 3, status->needed);
+    put_be16(out + n + 5, status->first_missing);
+    put_be32(out + n + 7, (uint32_t)(status->missing >> 32));
+    put_be32(out + n + 11, (uint32_t)status->missing);
+    return seal(out, n + 15, device_id, mac, ctx);
+}
+
+// PRBS-23 of the LoRaWAN fragmented data block transport (TS004)
+static uint32_t prbs23(uint32_t x)
+{
+    uint32_t b0 = x & 1;
+    uint32_t b1 = (x & 0x20) >> 5;
+    return (x >> 1) + ((b0 ^ b1) << 22);
+}
+
+void lora_fuota_parity_row(uint16_t n, uint16_t frag_count, uint8_t *row)
+{
+    memset(row, 0, (frag_count + 7U) / 8);
+    if (frag_count < 2) {
+        row[0] = frag_count; // The TS004 line would be empty: repeat the single fragment
+        return;
+    }
+
+    uint32_t m  = frag_count;
+    uint32_t mm = (m & (m - 1)) == 0 ? 1 : 0;
+    uint32_t x  = 1 + 1001U * n;
+    for (uint32_t coeffs = 0; coeffs < m / 2; coeffs++) {
+        uint32_t r = m;
+        while (r >= m) {
+            x = prbs23(x);
+            r = x % (m + mm);
+        }
+        bit_set(row, r);
+    }
+}
+
+esp_err_t lora_fuota_tx_init(lora_fuota_tx_t *tx, uint8_t session, uint32_t image_size, uint8_t frag_size,
+                             uint8_t redundancy_percent, uint8_t *row_buf, lora_fuota_read_t read, void *ctx)
+{
+    if (frag_size < LORA_FUOTA_FRAG_SIZE_MIN || frag_size > LORA_FUOTA_FRAG_SIZE_MAX || image_size == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uint32_t frag_count = (image_size + frag_size - 1) / frag_size;
+    if (frag_count > FRAG_INDEX_SPACE / 2) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(tx, 0, sizeof(*tx));
+    tx->read               = read;
+    tx->ctx                = ctx;
+    tx->session            = session;
+    tx->frag_size          = frag_size;
+    tx->frag_count         = (uint16_t)frag_count;
+    tx->redundancy_percent = redundancy_percent;
+    tx->row                = row_buf;
+    tx->next_parity        = 1;
+    tx->round_left         = (frag_count * redundancy_percent + 99) / 100;
+    return ESP_OK;
+}
+
+size_t lora_fuota_tx_next(lora_fuota_tx_t *tx, uint16_t device_id, uint8_t *out, lora_fuota_mac_t mac, void *ctx,
+                          esp_err_t *err)
+{
+    uint8_t *data = out + LORA_FUOTA_HEADER_SIZE + 2;
+    uint32_t index;
+
+    *err = ESP_OK;
+
+    if (tx->next_data < tx->frag_count) {
+        index = tx->next_data;
+        *err  = tx->read((uint16_t)index, data, tx->ctx);
+        if (*err != ESP_OK) {
+            return 0;
+        }
+        tx->next_data++;
+    } else {
+        index = tx->frag_count + tx->next_parity - 1U;
+        if (tx->round_left == 0 || index >= FRAG_INDEX_SPACE) {
+            return 0;
+        }
+        uint8_t tmp[LORA_FUOTA_FRAG_SIZE_MAX];
+        memset(data, 0, tx->frag_size);
+        lora_fuota_parity_row((uint16_t)tx->next_parity, tx->frag_count, tx->row);
+        for (uint32_t i = 0; i < tx->frag_count; i++) {
+            if (!bit_get(tx->row, i)) {
+                continue;
+            }
+            *err = tx->read((uint16_t)i, tmp, tx->ctx);
+            if (*err != ESP_OK) {
+                return 0;
+            }
+            xor_bytes(data, tmp, tx->frag_size);
+        }
+        tx->next_parity++;
+        tx->round_left--;
+    }
+
+    size_t n = put_header(out, device_id, LORA_FUOTA_FRAME_FRAG, tx->session);
+    put_be16(out + n, (uint16_t)index);
+    n = seal(out, n + 2 + tx->frag_size, device_id, mac, ctx);
+    if (n == 0) {
+        *err = ESP_FAIL;
+    }
+    return n;
+}
+
+uint32_t lora_fuota_tx_repair(lora_fuota_tx_t *tx, uint16_t needed)
+{
+    uint32_t space = FRAG_INDEX_SPACE - (tx->frag_count + tx->next_parity - 1U);
+    uint32_t round = needed + ((uint32_t)needed * tx->redundancy_percent + 99) / 100;
+    tx->round_left = round < space ? round : space;
+    return tx->round_left;
+}
+
+static size_t rx_stride(uint16_t max_missing)
+{
+    return (max_missing + 7U) / 8;
+}
+
+size_t lora_fuota_rx_mem_size(uint16_t frag_count, uint8_t frag_size, uint16_t max_missing)
+{
+    size_t bitmap = (frag_count + 7U) / 8;
+    size_t stride = rx_stride(max_missing);
+    return max_missing * sizeof(uint16_t) + (size_t)max_missing * stride + stride + 2 * bitmap + 2U * frag_size;
+}
+
+esp_err_t lora_fuota_rx_init(lora_fuota_rx_t *rx, const lora_fuota_setup_t *setup, uint16_t max_missing, void *mem,
+                             lora_fuota_read_t read, lora_fuota_write_t write, void *ctx)
+{
+    if (setup->frag_size < LORA_FUOTA_FRAG_SIZE_MIN || setup->frag_size > LORA_FUOTA_FRAG_SIZE_MAX ||
+        setup->frag_count == 0 || setup->frag_count > FRAG_INDEX_SPACE / 2 ||
+        (setup->image_size + setup->frag_size - 1) / setup->frag_size != setup->frag_count) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(rx, 0, sizeof(*rx));
+    rx->read        = read;
+    rx->write       = write;
+    rx->ctx         = ctx;
+    rx->image_size  = setup->image_size;
+    rx->frag_count  = setup->frag_count;
+    rx->frag_size   = setup->frag_size;
+    rx->max_missing = max_missing;
+    rx->state       = LORA_FUOTA_RX_RECEIVING;
+
+    size_t bitmap = (rx->frag_count + 7U) / 8;
+    size_t stride = rx_stride(max_missing);
+    memset(mem, 0, lora_fuota_rx_mem_size(rx->frag_count, rx->frag_size, max_missing));
+    rx->missing = mem; // First, for its alignment
+    uint8_t *p  = (uint8_t *)mem + max_missing * sizeof(uint16_t);
+    rx->matrix  = p;
+    p += (size_t)max_missing * stride;
+    rx->cols = p;
+    p += stride;
+    rx->known = p;
+    p += bitmap;
+    rx->row = p;
+    p += bitmap;
+    rx->acc = p;
+    rx->tmp = p + rx->frag_size;
+    return ESP_OK;
+}
+
+/**
+ * @brief Back substitution once every missing column has a row: highest column first, each
+ *        slot becomes its data fragment
+ */
+static esp_err_t rx_solve(lora_fuota_rx_t *rx)
+{
+    size_t stride = rx_stride(rx->max_missing);
+    for (uint32_t q = rx->missing_count; q-- > 0;) {
+        const uint8_t *prow = rx->matrix + q * stride;
+        esp_err_t ret       = rx->read(rx->missing[q], rx->acc, rx->ctx);
+        for (uint32_t k = q + 1; ret == ESP_OK && k < rx->missing_count; k++) {
+            if (bit_get(prow, k)) {
+                ret = rx->read(rx->missing[k], rx->tmp, rx->ctx);
+                xor_bytes(rx->acc, rx->tmp, rx->frag_size);
+            }
+        }
+        if (ret == ESP_OK) {
+            ret = rx->write(rx->missing[q], rx->acc, rx->ctx);
+        }
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+    memset(rx->known, 0xFF, (rx->frag_count + 7U) / 8);
+    rx->data_known = rx->frag_count;
+    rx->state      = LORA_FUOTA_RX_COMPLETE;
+    return ESP_OK;
+}
+
+/**
+ * @brief Eliminate cols/acc against the rows held; keep what remains as a new row
+ */
+static esp_err_t rx_reduce(lora_fuota_rx_t *rx)
+{
+    size_t stride = rx_stride(rx->max_missing);
+    size_t from   = 0;
+    for (;;) {
+        while (from < stride && rx->cols[from] == 0) {
+            from++;
+        }
+        if (from == stride) {
+            return ESP_OK; // Depends on the rows held: nothing new
+        }
+        uint32_t q = from * 8;
+        while (!bit_get(rx->cols, q)) {
+            q++;
+        }
+
+        uint8_t *prow = rx->matrix + q * stride;
+        if (!bit_get(prow, q)) {
+            memcpy(prow, rx->cols, stride);
+            esp_err_t ret = rx->write(rx->missing[q], rx->acc, rx->ctx);
+            if (ret != ESP_OK) {
+                memset(prow, 0, stride);
+                return ret;
+            }
+            rx->pivots++;
+            return rx->pivots == rx->missing_count ? rx_solve(rx) : ESP_OK;
+        }
+
+        esp_err_t ret = rx->read(rx->missing[q], rx->tmp, rx->ctx);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        xor_bytes(rx->acc, rx->tmp, rx->frag_size);
+        xor_bytes(rx->cols + from, prow + from, stride - from); // Rows hold no bits below their own
+    }
+}
+
+/**
+ * @brief First parity fragment: the data fragments not received so far become the unknowns
+ */
+static esp_err_t rx_freeze(lora_fuota_rx_t *rx)
+{
+    uint32_t count = rx->frag_count - rx->data_known;
+    if (count > rx->max_missing) {
+        rx->state = LORA_FUOTA_RX_FAILED;
+        return ESP_ERR_NO_MEM;
+    }
+    rx->missing_count = 0;
+    for (uint32_t i = 0; i < rx->frag_count; i++) {
+        if (!bit_get(rx->known, i)) {
+            rx->missing[rx->missing_count++] = (uint16_t)i;
+        }
+    }
+    rx->coded = true;
+    return ESP_OK;
+}
+
+static uint32_t rx_column(const lora_fuota_rx_t *rx, uint16_t index)
+{
+    uint32_t lo = 0, hi = rx->missing_count;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (rx->missing[mid] < index) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+esp_err_t lora_fuota_rx_fragment(lora_fuota_rx_t *rx, uint16_t index, const uint8_t *data, size_t len)
+{
+    if (rx->state == LORA_FUOTA_RX_FAILED) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (len != rx->frag_size) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (rx->state == LORA_FUOTA_RX_COMPLETE) {
+        return ESP_OK;
+    }
+
+    if (index < rx->frag_count) {
+        if (bit_get(rx->known, index)) {
+            return ESP_OK;
+        }
+        rx->received++;
+        if (!rx->coded) {
+            esp_err_t ret = rx->write(index, data, rx->ctx);
+            if (ret != ESP_OK) {
+                return ret;
+            }
+            bit_set(rx->known, index);
+            rx->data_known++;
+            if (rx->data_known == rx->frag_count) {
+                rx->state = LORA_FUOTA_RX_COMPLETE;
+            }
+            return ESP_OK;
+        }
+        // Late data fragment after the freeze: a row with a single unknown
+        memset(rx->cols, 0, rx_stride(rx->max_missing));
+        bit_set(rx->cols, rx_column(rx, index));
+        memcpy(rx->acc, data, rx->frag_size);
+        return rx_reduce(rx);
+    }
+
+    if (!rx->coded) {
+        esp_err_t ret = rx_freeze(rx);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+    rx->received++;
+
+    lora_fuota_parity_row((uint16_t)(index - rx->frag_count + 1), rx->frag_count, rx->row);
+    memset(rx->cols, 0, rx_stride(rx->max_missing));
+    memcpy(rx->acc, data, rx->frag_size);
+    uint32_t col = 0;
+    for (uint32_t i = 0; i < rx->frag_count; i++) {
+        if (!bit_get(rx->row, i)) {
+            continue;
+        }
+        if (bit_get(rx->known, i)) {
+            esp_err_t ret = rx->read((uint16_t)i, rx->tmp, rx->ctx);
+            if (ret != ESP_OK) {
+                return ret;
+            }
+            xor_bytes(rx->acc, rx->tmp, rx->frag_size);
+        } else {
+            while (rx->missing[col] < i) {
+                col++;
+            }
+            bit_set(rx->cols, col);
+        }
+    }
+    return rx_reduce(rx);
+}
+
+void lora_fuota_rx_status(const lora_fuota_rx_t *rx, lora_fuota_status_t *status)
+{
+    memset(status, 0, sizeof(*status));
+    status->state    = rx->state;
+    status->received = rx->received;
+    if (rx->state == LORA_FUOTA_RX_COMPLETE) {
+        status->first_missing = rx->frag_count;
+        return;
+    }
+    status->needed = rx->coded ? rx->missing_count - rx->pivots : rx->frag_count - rx->data_known;
+
+    uint32_t first = 0;
+    while (first < rx->frag_count && bit_get(rx->known, first)) {
+        first++;
+    }
+    status->first_missing = (uint16_t)first;
+    for (uint32_t i = 0; i < LORA_FUOTA_STATUS_WINDOW && first + i < rx->frag_count; i++) {
+        if (!bit_get(rx->known, first + i)) {
+            status->missing |= 1ULL << i;
+        }
+    }
+}
+
+// lora_bandwidth_t holds kHz truncated to an integer
+static uint32_t bandwidth_hz(uint16_t bandwidth_khz)
+{
+    switch (bandwidth_khz) {
+        case 7:
+            return 7810;
+        case 10:
+            return 10420;
+        case 15:
+            return 15630;
+        case 20:
+            return 20830;
+        case 31:
+            return 31250;
+        case 41:
+            return 41670;
+        case 62:
+            return 62500;
+        default:
+            return bandwidth_khz * 1000U;
+    }
+}
+
+uint32_t lora_fuota_airtime_us(uint8_t spreading_factor, uint16_t bandwidth_khz, uint8_t coding_rate,
+                               uint16_t preamble, size_t payload_len)
+{
+    // Semtech AN1200.13 with explicit header, CRC on, low data rate optimization off (lora_driver.c)
+    uint64_t symbol_ns = ((uint64_t)1000000000U << spreading_factor) / bandwidth_hz(bandwidth_khz);
+    int32_t num        = 8 * (int32_t)payload_len - 4 * spreading_factor + 28 + 16;
+    int32_t den        = 4 * spreading_factor;
+    int32_t blocks     = num > 0 ? (num + den - 1) / den : 0;
+    uint64_t symbols4  = 4U * preamble + 17 + 4U * (8 + (uint32_t)blocks * coding_rate); // In quarter symbols
+    return (uint32_t)(symbols4 * symbol_ns / 4 / 1000);
+}
+
+void lora_fuota_duty_init(lora_fuota_duty_t *duty, uint8_t percent)
+{
+    memset(duty, 0, sizeof(*duty));
+    duty->percent = percent;
+}
+
+uint64_t lora_fuota_duty_wait_us(const lora_fuota_duty_t *duty, uint64_t now_us)
+{
+    return duty->next_tx_us > now_us ? duty->next_tx_us - now_us : 0;
+}
+
+void lora_fuota_duty_spend(lora_fuota_duty_t *duty, uint64_t now_us, uint32_t airtime_us)
+{
+    duty->airtime_us += airtime_us;
+
+    uint64_t period = airtime_us;
+    if (duty->percent > 0 && duty->percent < 100) {
+        period = (uint64_t)airtime_us * 100 / duty->percent;
+    }
+    duty->next_tx_us = now_us + period;
+}
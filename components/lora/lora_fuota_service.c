@@ -0,0 +1,649 @@
+/**
+ * @file lora_fuota_service.c
+ * @brief LoRa multicast firmware updates on the device: broadcast on the receiver, apply on presenters
+ */
+
+#include "lora_fuota_service.h"
+#include "config_manager.h"
+#include "device_registry.h"
+#include "esp_app_desc.h"
+#include "esp_app_format.h"
+#include "esp_littlefs.h"
+#include "esp_log.h"
+#include "esp_ota_ops.h"
+#include "esp_random.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "lora_bands.h"
+#include "lora_protocol.h"
+#include "ota_decompress.h"
+#include "ota_engine.h"
+#include "power_mgmt.h"
+#include "task_config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+static const char *TAG = "LORA_FUOTA";
+
+#define STAGING_PATH "/storage/fuota.bin"
+#define STAGING_BASE_PATH "/storage"
+#define STAGING_PARTITION "storage"
+#define FRAME_QUEUE_DEPTH 8
+#define SETUP_REPEATS 3    // SETUP is not repaired by parity: send it more than once
+#define POLL_SLOT_MS 150   // One STATUS frame plus turnaround at SF7/BW500
+#define POLL_SLOTS 16      // Presenters answer in slot device_id % POLL_SLOTS
+#define PREAMBLE_SYMBOLS 8 // As lora_driver.c configures the radio
+#define APPLY_CHUNK_SIZE 4096
+#define APPLIED_REBOOT_MS 15000 // Applied image: reboot once the session has been quiet this long
+#define FRAME_WAIT_MS 1000
+#define VERSION_READ_CHUNK 128
+
+// esp_app_desc_t follows the image header and the first segment header
+#define APP_DESC_OFFSET (sizeof(esp_image_header_t) + sizeof(esp_image_segment_header_t))
+
+typedef struct {
+    uint16_t length; ///< 0 wakes the task for a broadcast
+    uint8_t data[LORA_FUOTA_FRAME_MAX];
+} frame_msg_t;
+
+typedef struct {
+    FILE *file;
+    uint32_t size; ///< Bytes past it read as zero padding
+    uint8_t frag_size;
+} staging_t;
+
+typedef struct {
+    uint16_t device_id;
+    bool answered;
+    lora_fuota_status_t status;
+} peer_t;
+
+static QueueHandle_t frame_queue = NULL;
+static TaskHandle_t service_task = NULL;
+
+// Presenter side: one session at a time
+static struct {
+    bool active;
+    bool applied;
+    bool apply_failed;
+    uint8_t session;
+    uint16_t sender;
+    staging_t staging;
+    void *mem;
+    lora_fuota_setup_t setup;
+    lora_fuota_rx_t rx;
+    lora_fuota_duty_t duty;
+    int64_t last_frame_us;
+} rx_session;
+
+// Receiver side
+static volatile bool broadcast_pending = false;
+static char broadcast_path[64];
+static uint8_t broadcast_signature[LORA_FUOTA_SIGNATURE_SIZE];
+static uint32_t broadcast_version;
+
+static esp_err_t frame_mac(uint16_t device_id, const uint8_t *data, size_t len, uint8_t mac[LORA_FUOTA_MAC_SIZE],
+                           void *ctx)
+{
+    (void)ctx;
+    return lora_protocol_frame_mac(device_id, data, len, mac);
+}
+
+static void on_frame(const uint8_t *frame, size_t length, int16_t rssi, void *user_ctx)
+{
+    (void)rssi;
+    (void)user_ctx;
+    if (length == 0 || length > LORA_FUOTA_FRAME_MAX) {
+        return;
+    }
+    frame_msg_t msg = {.length = (uint16_t)length};
+    memcpy(msg.data, frame, length);
+    xQueueSend(frame_queue, &msg, 0); // Full queue: the frame counts as lost, parity covers it
+}
+
+static esp_err_t staging_read(uint16_t index, uint8_t *data, void *ctx)
+{
+    staging_t *s   = ctx;
+    uint32_t start = (uint32_t)index * s->frag_size;
+    size_t n       = 0;
+    if (start < s->size) {
+        if (fseek(s->file, (long)start, SEEK_SET) != 0) {
+            return ESP_FAIL;
+        }
+        n = fread(data, 1, s->frag_size, s->file);
+    }
+    memset(data + n, 0, s->frag_size - n);
+    return ESP_OK;
+}
+
+static esp_err_t staging_write(uint16_t index, const uint8_t *data, void *ctx)
+{
+    staging_t *s = ctx;
+    if (fseek(s->file, (long)index * s->frag_size, SEEK_SET) != 0 ||
+        fwrite(data, 1, s->frag_size, s->file) != s->frag_size) {
+        return ESP_FAIL;
+    }
+    uint32_t end = ((uint32_t)index + 1) * s->frag_size;
+    s->size      = end > s->size ? end : s->size;
+    return ESP_OK;
+}
+
+static esp_err_t mount_staging(void)
+{
+    if (esp_littlefs_mounted(STAGING_PARTITION)) {
+        return ESP_OK;
+    }
+    // The partition also holds the web UI: a failed mount must not wipe it
+    esp_vfs_littlefs_conf_t conf = {.base_path              = STAGING_BASE_PATH,
+                                    .partition_label        = STAGING_PARTITION,
+                                    .format_if_mount_failed = false,
+                                    .dont_mount             = false};
+    return esp_vfs_littlefs_register(&conf);
+}
+
+static const lora_compliance_t *current_limits(lora_config_t *config)
+{
+    config_manager_get_lora(config);
+    return lora_regulatory_get_limits(config->regulatory_domain, config->band_id);
+}
+
+/**
+ * @brief Wait out the duty-cycle budget, then queue the frame
+ */
+static esp_err_t send_frame(lora_fuota_duty_t *duty, const lora_config_t *config, const uint8_t *frame,
+                            size_t length)
+{
+    uint64_t wait_us = lora_fuota_duty_wait_us(duty, (uint64_t)esp_timer_get_time());
+    if (wait_us > 0) {
+        vTaskDelay(pdMS_TO_TICKS(wait_us / 1000 + 1));
+    }
+    uint32_t airtime = lora_fuota_airtime_us(config->spreading_factor, config->bandwidth, config->coding_rate,
+                                             PREAMBLE_SYMBOLS, length);
+    lora_fuota_duty_spend(duty, (uint64_t)esp_timer_get_time(), airtime);
+    return lora_protocol_send_frame(frame, length);
+}
+
+static uint32_t running_version(void)
+{
+    uint32_t version = 0;
+    lora_fuota_parse_version(esp_app_get_description()->version, &version);
+    return version;
+}
+
+/**
+ * @brief Close and delete the staged container; applied or abandoned, it is not needed again
+ */
+static void staging_discard(void)
+{
+    if (rx_session.staging.file) {
+        fclose(rx_session.staging.file);
+        rx_session.staging.file = NULL;
+        remove(STAGING_PATH);
+    }
+}
+
+static void rx_end(void)
+{
+    staging_discard();
+    free(rx_session.mem);
+    memset(&rx_session, 0, sizeof(rx_session));
+}
+
+static void rx_begin(const lora_fuota_frame_t *f)
+{
+    if (rx_session.active) {
+        if (f->session == rx_session.session && f->device_id == rx_session.sender) {
+            return; // Repeated SETUP
+        }
+        if (rx_session.rx.state == LORA_FUOTA_RX_RECEIVING || rx_session.applied) {
+            ESP_LOGW(TAG, "Ignoring session 0x%02X from 0x%04X: busy", f->session, f->device_id);
+            return;
+        }
+        rx_end();
+    }
+
+    const config_snapshot_t *config = config_snapshot_acquire();
+    bool presenter                  = config && config->general.device_mode == DEVICE_MODE_PRESENTER;
+    config_snapshot_release(config);
+    if (!presenter || ota_engine_get_state() != OTA_STATE_IDLE) {
+        return;
+    }
+    // A replayed SETUP carries the version already installed, an old one a lower version
+    if (f->setup.version <= running_version()) {
+        ESP_LOGW(TAG, "Ignoring session 0x%02X from 0x%04X: version %08lx is not newer than %08lx", f->session,
+                 f->device_id, (unsigned long)f->setup.version, (unsigned long)running_version());
+        return;
+    }
+
+    esp_err_t ret = mount_staging();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Staging filesystem unavailable: %s", esp_err_to_name(ret));
+        return;
+    }
+
+    uint16_t max_missing         = CONFIG_LORACUE_FUOTA_MAX_MISSING;
+    size_t mem_size              = lora_fuota_rx_mem_size(f->setup.frag_count, f->setup.frag_size, max_missing);
+    rx_session.mem               = malloc(mem_size);
+    rx_session.staging.file      = fopen(STAGING_PATH, "w+b");
+    rx_session.staging.frag_size = f->setup.frag_size;
+    if (!rx_session.mem || !rx_session.staging.file) {
+        ESP_LOGE(TAG, "No room for session 0x%02X (%zu bytes decoder)", f->session, mem_size);
+        rx_end();
+        return;
+    }
+    ret = lora_fuota_rx_init(&rx_session.rx, &f->setup, max_missing, rx_session.mem, staging_read, staging_write,
+                             &rx_session.staging);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Invalid session 0x%02X: %s", f->session, esp_err_to_name(ret));
+        rx_end();
+        return;
+    }
+
+    lora_config_t lora;
+    const lora_compliance_t *limits = current_limits(&lora);
+    lora_fuota_duty_init(&rx_session.duty, limits ? limits->duty_cycle_percent : 0);
+    rx_session.active  = true;
+    rx_session.session = f->session;
+    rx_session.sender  = f->device_id;
+    rx_session.setup   = f->setup;
+    ESP_LOGI(TAG, "Session 0x%02X from 0x%04X: %lu bytes in %u fragments of %u", f->session, f->device_id,
+             (unsigned long)f->setup.image_size, f->setup.frag_count, f->setup.frag_size);
+}
+
+/**
+ * @brief Stream the rebuilt container through ota_engine; it verifies hash and signature
+ */
+static esp_err_t rx_apply(void)
+{
+    char signature_hex[LORA_FUOTA_SIGNATURE_SIZE * 2 + 1];
+    for (int i = 0; i < LORA_FUOTA_SIGNATURE_SIZE; i++) {
+        snprintf(&signature_hex[i * 2], 3, "%02x", rx_session.setup.signature[i]);
+    }
+
+    uint8_t *chunk = malloc(APPLY_CHUNK_SIZE);
+    if (!chunk) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // The container carries the image hash; ota_engine_finish() checks the signature over it
+    esp_err_t ret = ota_engine_set_expected_sha256(NULL);
+    if (ret == ESP_OK) {
+        ret = ota_engine_verify_signature(signature_hex);
+    }
+    if (ret == ESP_OK) {
+        ret = ota_engine_start(rx_session.setup.image_size);
+    }
+    if (ret == ESP_OK && fseek(rx_session.staging.file, 0, SEEK_SET) != 0) {
+        ret = ESP_FAIL;
+    }
+
+    uint32_t left = rx_session.setup.image_size;
+    while (ret == ESP_OK && left > 0) {
+        size_t n = left < APPLY_CHUNK_SIZE ? left : APPLY_CHUNK_SIZE;
+        if (fread(chunk, 1, n, rx_session.staging.file) != n) {
+            ret = ESP_FAIL;
+            break;
+        }
+        ret = ota_engine_write(chunk, n);
+        left -= n;
+    }
+    free(chunk);
+
+    if (ret == ESP_OK) {
+        ret = ota_engine_finish();
+    } else if (ota_engine_get_state() != OTA_STATE_IDLE) {
+        ota_engine_abort();
+    }
+    // SETUP's version is only as good as the sender: the signed image must carry the same one
+    const esp_partition_t *partition = esp_ota_get_next_update_partition(NULL);
+    esp_app_desc_t desc;
+    uint32_t version = 0;
+    if (ret == ESP_OK && (esp_ota_get_partition_description(partition, &desc) != ESP_OK ||
+                          lora_fuota_parse_version(desc.version, &version) != ESP_OK ||
+                          version != rx_session.setup.version)) {
+        ESP_LOGE(TAG, "Image version does not match session 0x%02X", rx_session.session);
+        ret = ESP_ERR_INVALID_VERSION;
+    }
+    if (ret == ESP_OK) {
+        // Without this the restart after APPLIED_REBOOT_MS boots the old firmware again
+        ret = esp_ota_set_boot_partition(partition);
+    }
+    return ret;
+}
+
+static void rx_fragment(const lora_fuota_frame_t *f)
+{
+    esp_err_t ret = lora_fuota_rx_fragment(&rx_session.rx, f->frag.index, f->frag.data, f->frag.len);
+    if (ret == ESP_ERR_NO_MEM) {
+        ESP_LOGW(TAG, "Session 0x%02X: more fragments lost than %d, giving up", rx_session.session,
+                 CONFIG_LORACUE_FUOTA_MAX_MISSING);
+        staging_discard();
+        return;
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Fragment %u rejected: %s", f->frag.index, esp_err_to_name(ret));
+        return;
+    }
+    if (rx_session.rx.state != LORA_FUOTA_RX_COMPLETE || rx_session.applied || rx_session.apply_failed) {
+        return;
+    }
+
+    ESP_LOGI(TAG, "Session 0x%02X complete after %u fragments, applying", rx_session.session,
+             rx_session.rx.received);
+    ret = rx_apply();
+    staging_discard();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Applying session 0x%02X failed: %s", rx_session.session, esp_err_to_name(ret));
+        rx_session.apply_failed = true;
+        return;
+    }
+    rx_session.applied = true;
+    ESP_LOGI(TAG, "Update installed, rebooting once the sender is done");
+}
+
+static void rx_poll(const lora_fuota_frame_t *f)
+{
+    uint16_t slot = lora_protocol_get_device_id() % POLL_SLOTS;
+    vTaskDelay(pdMS_TO_TICKS((uint32_t)slot * f->poll_slot_ms));
+
+    lora_fuota_status_t status;
+    lora_fuota_rx_status(&rx_session.rx, &status);
+    if (rx_session.apply_failed) {
+        status.state = LORA_FUOTA_RX_FAILED;
+    }
+
+    uint8_t frame[LORA_FUOTA_STATUS_SIZE];
+    size_t len = lora_fuota_build_status(frame, lora_protocol_get_device_id(), rx_session.session, &status,
+                                         frame_mac, NULL);
+    lora_config_t lora;
+    config_manager_get_lora(&lora);
+    if (len == 0 || lora_fuota_duty_wait_us(&rx_session.duty, (uint64_t)esp_timer_get_time()) > 0) {
+        return; // Out of budget: the sender keeps our last answer
+    }
+    send_frame(&rx_session.duty, &lora, frame, len);
+}
+
+static void handle_frame(const frame_msg_t *msg)
+{
+    lora_fuota_frame_t f;
+    esp_err_t ret = lora_fuota_parse(msg->data, msg->length, &f, frame_mac, NULL);
+    if (ret != ESP_OK) {
+        ESP_LOGD(TAG, "Frame dropped: %s", esp_err_to_name(ret));
+        return;
+    }
+
+    if (f.type == LORA_FUOTA_FRAME_SETUP) {
+        rx_begin(&f);
+        return;
+    }
+    if (!rx_session.active || f.session != rx_session.session || f.device_id != rx_session.sender) {
+        return;
+    }
+    rx_session.last_frame_us = esp_timer_get_time();
+    power_mgmt_update_activity(); // Keeps an idle presenter out of deep sleep until the session ends
+    if (f.type == LORA_FUOTA_FRAME_FRAG) {
+        rx_fragment(&f);
+    } else if (f.type == LORA_FUOTA_FRAME_POLL) {
+        rx_poll(&f);
+    }
+}
+
+/**
+ * @brief Collect STATUS replies until the poll window closes
+ */
+static void collect_status(uint8_t session, peer_t *peers, size_t peer_count, uint32_t window_ms)
+{
+    int64_t deadline = esp_timer_get_time() + (int64_t)window_ms * 1000;
+    frame_msg_t msg;
+    for (;;) {
+        int64_t left_us = deadline - esp_timer_get_time();
+        if (left_us <= 0 || xQueueReceive(frame_queue, &msg, pdMS_TO_TICKS(left_us / 1000 + 1)) != pdTRUE) {
+            return;
+        }
+        lora_fuota_frame_t f;
+        if (msg.length == 0 || lora_fuota_parse(msg.data, msg.length, &f, frame_mac, NULL) != ESP_OK ||
+            f.type != LORA_FUOTA_FRAME_STATUS || f.session != session) {
+            continue;
+        }
+        for (size_t i = 0; i < peer_count; i++) {
+            if (peers[i].device_id == f.device_id) {
+                peers[i].answered = true;
+                peers[i].status   = f.status;
+            }
+        }
+    }
+}
+
+/**
+ * @brief SETUP, then data and parity in rounds until every presenter that answers is done
+ */
+static void broadcast_rounds(lora_fuota_tx_t *tx, peer_t *peers, size_t peer_count)
+{
+    lora_config_t lora;
+    const lora_compliance_t *limits = current_limits(&lora);
+    lora_fuota_duty_t duty;
+    lora_fuota_duty_init(&duty, limits ? limits->duty_cycle_percent : 0);
+    uint16_t self    = lora_protocol_get_device_id();
+    int64_t start_us = esp_timer_get_time();
+    ESP_LOGI(TAG, "Session 0x%02X: %u fragments of %u to %zu presenters, duty cycle %u%%", tx->session,
+             tx->frag_count, tx->frag_size, peer_count, duty.percent);
+
+    uint8_t frame[LORA_FUOTA_FRAME_MAX];
+    lora_fuota_setup_t setup = {.image_size = ((staging_t *)tx->ctx)->size,
+                                .frag_count = tx->frag_count,
+                                .frag_size  = tx->frag_size,
+                                .version    = broadcast_version};
+    memcpy(setup.signature, broadcast_signature, sizeof(setup.signature));
+    size_t len = lora_fuota_build_setup(frame, self, tx->session, &setup, frame_mac, NULL);
+    for (int i = 0; len > 0 && i < SETUP_REPEATS; i++) {
+        send_frame(&duty, &lora, frame, len);
+    }
+
+    size_t complete = 0;
+    for (int round = 0; round < CONFIG_LORACUE_FUOTA_MAX_ROUNDS; round++) {
+        esp_err_t err;
+        uint32_t sent = 0;
+        while ((len = lora_fuota_tx_next(tx, self, frame, frame_mac, NULL, &err)) > 0) {
+            send_frame(&duty, &lora, frame, len);
+            sent++;
+        }
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Reading %s failed: %s", broadcast_path, esp_err_to_name(err));
+            break;
+        }
+
+        len = lora_fuota_build_poll(frame, self, tx->session, POLL_SLOT_MS, frame_mac, NULL);
+        send_frame(&duty, &lora, frame, len);
+        collect_status(tx->session, peers, peer_count, (POLL_SLOTS + 1) * POLL_SLOT_MS);
+
+        // Presenters that never answered missed the SETUP or are out of range: not waited for
+        uint16_t needed = 0;
+        size_t waiting  = 0;
+        complete        = 0;
+        for (size_t i = 0; i < peer_count; i++) {
+            const lora_fuota_status_t *st = &peers[i].status;
+            if (peers[i].answered && st->state == LORA_FUOTA_RX_COMPLETE) {
+                complete++;
+            } else if (peers[i].answered && st->state == LORA_FUOTA_RX_RECEIVING) {
+                waiting++;
+                needed = st->needed > needed ? st->needed : needed;
+                ESP_LOGI(TAG, "0x%04X: %u received, needs %u, first missing %u (bitmap %08lx%08lx)",
+                         peers[i].device_id, st->received, st->needed, st->first_missing,
+                         (unsigned long)(st->missing >> 32), (unsigned long)st->missing);
+            }
+        }
+        ESP_LOGI(TAG, "Round %d: %lu fragments, %zu/%zu presenters complete, %zu waiting", round, (unsigned long)sent,
+                 complete, peer_count, waiting);
+        if (waiting == 0 || lora_fuota_tx_repair(tx, needed) == 0) {
+            break;
+        }
+    }
+
+    ESP_LOGI(TAG, "Session 0x%02X done: %zu/%zu presenters updated, %lu ms on air in %lu s", tx->session, complete,
+             peer_count, (unsigned long)(duty.airtime_us / 1000),
+             (unsigned long)((esp_timer_get_time() - start_us) / 1000000));
+}
+
+typedef struct {
+    uint8_t *out;
+    size_t size;
+    size_t len;
+} head_t;
+
+static esp_err_t head_sink(const uint8_t *data, size_t len, void *ctx)
+{
+    head_t *head = ctx;
+    size_t n     = head->size - head->len < len ? head->size - head->len : len;
+    memcpy(head->out + head->len, data, n);
+    head->len += n;
+    return ESP_OK;
+}
+
+/**
+ * @brief Version of the image a container or raw image produces, from its esp_app_desc_t
+ */
+static esp_err_t read_image_version(FILE *file, uint32_t *version)
+{
+    uint8_t image[APP_DESC_OFFSET + sizeof(esp_app_desc_t)];
+    head_t head = {.out = image, .size = sizeof(image)};
+    uint8_t buf[VERSION_READ_CHUNK];
+    ota_container_t container;
+
+    size_t n      = fread(buf, 1, OTA_CONTAINER_HEADER_SIZE, file);
+    esp_err_t ret = ota_container_parse(buf, n, &container);
+    if (ret == ESP_ERR_NOT_FOUND) {
+        memcpy(image, buf, n);
+        head.len = n + fread(image + n, 1, sizeof(image) - n, file);
+        ret      = ESP_OK;
+    } else if (ret == ESP_OK) {
+        ota_decompress_t dec;
+        uint8_t *window = malloc((size_t)1 << container.window_bits);
+        if (!window) {
+            return ESP_ERR_NO_MEM;
+        }
+        ota_decompress_init(&dec, &container, window, head_sink, &head);
+        while (ret == ESP_OK && head.len < head.size && (n = fread(buf, 1, sizeof(buf), file)) > 0) {
+            ret = ota_decompress_feed(&dec, buf, n);
+        }
+        free(window);
+    }
+    rewind(file);
+
+    esp_app_desc_t desc;
+    memcpy(&desc, image + APP_DESC_OFFSET, sizeof(desc));
+    if (ret != ESP_OK || head.len < head.size || desc.magic_word != ESP_APP_DESC_MAGIC_WORD) {
+        return ESP_ERR_INVALID_VERSION;
+    }
+    desc.version[sizeof(desc.version) - 1] = '\0';
+    return lora_fuota_parse_version(desc.version, version);
+}
+
+static void run_broadcast(void)
+{
+    staging_t staging = {.frag_size = CONFIG_LORACUE_FUOTA_FRAG_SIZE};
+    struct stat st;
+    staging.file = fopen(broadcast_path, "rb");
+    if (!staging.file || fstat(fileno(staging.file), &st) != 0 || st.st_size <= 0 ||
+        read_image_version(staging.file, &broadcast_version) != ESP_OK) {
+        ESP_LOGE(TAG, "Cannot read a firmware image from %s", broadcast_path);
+        if (staging.file) {
+            fclose(staging.file);
+        }
+        remove(broadcast_path);
+        broadcast_pending = false;
+        return;
+    }
+    staging.size = (uint32_t)st.st_size;
+
+    uint32_t frag_count      = (staging.size + staging.frag_size - 1) / staging.frag_size;
+    uint8_t *row             = malloc((frag_count + 7) / 8);
+    paired_device_t *devices = calloc(MAX_PAIRED_DEVICES, sizeof(*devices));
+    peer_t *peers            = calloc(MAX_PAIRED_DEVICES, sizeof(*peers));
+    size_t peer_count        = 0;
+
+    lora_fuota_tx_t tx;
+    if (!row || !devices || !peers ||
+        lora_fuota_tx_init(&tx, (uint8_t)esp_random(), staging.size, staging.frag_size,
+                           CONFIG_LORACUE_FUOTA_REDUNDANCY_PERCENT, row, staging_read, &staging) != ESP_OK) {
+        ESP_LOGE(TAG, "Cannot broadcast %lu bytes", (unsigned long)staging.size);
+    } else if (device_registry_list(devices, MAX_PAIRED_DEVICES, &peer_count) != ESP_OK || peer_count == 0) {
+        ESP_LOGW(TAG, "No paired presenters to update");
+    } else {
+        for (size_t i = 0; i < peer_count; i++) {
+            peers[i].device_id = devices[i].device_id;
+        }
+        broadcast_rounds(&tx, peers, peer_count);
+    }
+
+    fclose(staging.file);
+    remove(broadcast_path);
+    free(row);
+    free(devices);
+    free(peers);
+    broadcast_pending = false;
+}
+
+static void service_task_fn(void *arg)
+{
+    (void)arg;
+    frame_msg_t msg;
+    for (;;) {
+        if (broadcast_pending) {
+            run_broadcast();
+            continue;
+        }
+        if (xQueueReceive(frame_queue, &msg, pdMS_TO_TICKS(FRAME_WAIT_MS)) == pdTRUE && msg.length > 0) {
+            handle_frame(&msg);
+        }
+        if (rx_session.applied && esp_timer_get_time() - rx_session.last_frame_us > APPLIED_REBOOT_MS * 1000LL) {
+            ESP_LOGI(TAG, "Rebooting into the update");
+            esp_restart();
+        }
+    }
+}
+
+esp_err_t lora_fuota_service_start(void)
+{
+    if (service_task) {
+        return ESP_OK;
+    }
+    frame_queue = xQueueCreate(FRAME_QUEUE_DEPTH, sizeof(frame_msg_t));
+    if (!frame_queue) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (xTaskCreate(service_task_fn, "lora_fuota", TASK_STACK_SIZE_LARGE, NULL, TASK_PRIORITY_LOW, &service_task) !=
+        pdPASS) {
+        vQueueDelete(frame_queue);
+        frame_queue = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    lora_protocol_register_frame_callback(on_frame, NULL);
+    return ESP_OK;
+}
+
+esp_err_t lora_fuota_service_broadcast(const char *path, const uint8_t signature[LORA_FUOTA_SIGNATURE_SIZE])
+{
+    if (!path || !signature || strlen(path) >= sizeof(broadcast_path)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!service_task || broadcast_pending || rx_session.active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    strcpy(broadcast_path, path);
+    memcpy(broadcast_signature, signature, LORA_FUOTA_SIGNATURE_SIZE);
+    broadcast_pending  = true;
+    frame_msg_t wakeup = {.length = 0};
+    xQueueSend(frame_queue, &wakeup, 0);
+    return ESP_OK;
+}
+
+bool lora_fuota_service_broadcasting(void)
+{
+    return broadcast_pending;
+}
@@ -9,40 +9,53 @@
 #include "lora_protocol.h"
 #include "common_types.h"
 #include "device_registry.h"
+#include "esp_attr.h"
 #include "esp_log.h"
 #include "esp_random.h"
+#include "esp_system.h"
 #include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/event_groups.h"
 #include "freertos/task.h"
 #include "config_manager.h"
 #include "lora_driver.h"
+#include "lora_rx.h"
 #include "mbedtls/aes.h"
 #include "mbedtls/md.h"
 #include "power_mgmt.h"
+#include "replay_window.h"
+#include "sequence_store.h"
 #include "task_config.h"
 #include <string.h>
 
 static const char *TAG = "LORA_PROTOCOL";
 
+_Static_assert(sizeof(lora_packet_t) == LORA_RX_PACKET_SIZE, "Received payloads are routed by length");
+
 // ACK handling
 #define ACK_RECEIVED_BIT (1 << 0)
 static EventGroupHandle_t ack_event_group = NULL;
 static uint16_t pending_ack_sequence      = 0;
 static SemaphoreHandle_t ack_mutex        = NULL;
+static bool tx_resynced                   = false; // Sequence skipped since the last ACK
 static SemaphoreHandle_t crypto_mutex     = NULL;
 
-#define RX_TIMEOUT_MS 1000
 #define RX_TASK_DELAY_MS 5
 #define SEMAPHORE_WAIT_MS 10
-#define WINDOW_SIZE_LARGE 64
-#define WINDOW_SIZE_SMALL 32
 #define MAC_DATA_BUFFER_SIZE 18
 
 // Protocol state
 static bool protocol_initialized = false;
 static uint16_t local_device_id  = 0;
-static uint16_t sequence_counter = 0;
+
+// TX sequence numbers come from durable block reservations so they never repeat across reboots
+#define TX_SEQUENCE_NVS_NAMESPACE "lora_seq"
+#define TX_SEQUENCE_KEY_BASE "tx"
+static seq_reservation_t tx_sequence;
+static seq_journal_backend_t tx_sequence_backend;
+static sequence_store_nvs_ctx_t tx_sequence_ctx;
+static SemaphoreHandle_t sequence_mutex = NULL;
+static SemaphoreHandle_t reserve_mutex  = NULL;
 static uint8_t local_device_key[32]; // Local device's AES-256 key
 
 // RSSI monitoring variables (event-driven, updated on packet reception)
@@ -55,15 +68,152 @@ static mbedtls_aes_context aes_ctx;
 static mbedtls_md_context_t hmac_ctx;
 static const mbedtls_md_info_t *hmac_md_info = NULL;
 
+// Crypto and sequence state kept in RTC memory across deep sleep, so the first keypress
+// after wake can be sent before NVS, mutexes and the AES key schedule are set up again
+#define RESUME_STATE_MAGIC 0x4C435253 // "LCRS"
+typedef struct {
+    uint32_t magic;
+    uint16_t device_id;
+    uint8_t key[32];
+    mbedtls_aes_context aes; // Expanded key schedule (plain data, no heap pointers)
+    seq_reservation_t tx_sequence;
+} protocol_resume_state_t;
+static RTC_DATA_ATTR protocol_resume_state_t resume_state;
+
 // Callback state
 static lora_protocol_rx_callback_t rx_callback       = NULL;
 static void *rx_callback_ctx                         = NULL;
 static lora_protocol_state_callback_t state_callback = NULL;
 static void *state_callback_ctx                      = NULL;
+static lora_protocol_frame_callback_t frame_callback = NULL;
+static void *frame_callback_ctx                      = NULL;
 static TaskHandle_t protocol_rx_task_handle          = NULL;
 static bool protocol_rx_task_running                 = false;
 static lora_connection_state_t last_connection_state = LORA_CONNECTION_LOST;
 
+/**
+ * @brief Make the next TX sequence block durable
+ *
+ * The NVS write runs outside sequence_mutex; reserve_mutex serializes writers.
+ *
+ * @param force Extend even if the reservation is above the low-water mark
+ */
+static esp_err_t tx_sequence_extend(bool force)
+{
+    xSemaphoreTake(reserve_mutex, portMAX_DELAY);
+
+    xSemaphoreTake(sequence_mutex, portMAX_DELAY);
+    bool needed                = force || seq_reservation_needs_extend(&tx_sequence);
+    seq_reservation_t snapshot = tx_sequence;
+    xSemaphoreGive(sequence_mutex);
+
+    esp_err_t ret = needed ? seq_reservation_extend(&snapshot, &tx_sequence_backend) : ESP_OK;
+    if (needed && ret == ESP_OK) {
+        xSemaphoreTake(sequence_mutex, portMAX_DELAY);
+        tx_sequence.journal  = snapshot.journal;
+        tx_sequence.reserved = snapshot.reserved;
+        xSemaphoreGive(sequence_mutex);
+    }
+
+    xSemaphoreGive(reserve_mutex);
+    return ret;
+}
+
+static void tx_sequence_flush(void)
+{
+    esp_err_t ret = tx_sequence_extend(false);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "TX sequence reservation failed: %s", esp_err_to_name(ret));
+    }
+}
+
+/**
+ * @brief Move the TX sequence a block ahead
+ *
+ * A receiver that rebooted treats everything up to a block past its last snapshot as
+ * already seen (replay_window_restore()), so a presenter that kept running is rejected
+ * as stale until it gets past that. Skipping a block puts it ahead again at once.
+ */
+static esp_err_t tx_sequence_resync(void)
+{
+    xSemaphoreTake(reserve_mutex, portMAX_DELAY);
+
+    xSemaphoreTake(sequence_mutex, portMAX_DELAY);
+    seq_reservation_t snapshot = tx_sequence;
+    xSemaphoreGive(sequence_mutex);
+
+    esp_err_t ret = seq_reservation_skip(&snapshot, &tx_sequence_backend, SEQ_JOURNAL_BLOCK_SIZE);
+
+    xSemaphoreTake(sequence_mutex, portMAX_DELAY);
+    tx_sequence.journal  = snapshot.journal;
+    tx_sequence.reserved = snapshot.reserved;
+    if (ret == ESP_OK) {
+        tx_sequence.next += SEQ_JOURNAL_BLOCK_SIZE; // Sends during the write kept counting
+    }
+    xSemaphoreGive(sequence_mutex);
+
+    xSemaphoreGive(reserve_mutex);
+    return ret;
+}
+
+/**
+ * @brief Take the next TX sequence number
+ */
+static uint16_t take_tx_sequence(void)
+{
+    uint32_t sequence;
+
+    xSemaphoreTake(sequence_mutex, portMAX_DELAY);
+    esp_err_t ret = seq_reservation_take(&tx_sequence, &sequence);
+    xSemaphoreGive(sequence_mutex);
+
+    if (ret != ESP_OK) {
+        // Background refill fell behind: extend synchronously (one NVS write)
+        ret = tx_sequence_extend(true);
+
+        xSemaphoreTake(sequence_mutex, portMAX_DELAY);
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "TX sequence reservation failed: %s, sending unreserved", esp_err_to_name(ret));
+            tx_sequence.reserved = tx_sequence.next + SEQ_JOURNAL_BLOCK_SIZE;
+        }
+        seq_reservation_take(&tx_sequence, &sequence);
+        xSemaphoreGive(sequence_mutex);
+    }
+
+    xSemaphoreTake(sequence_mutex, portMAX_DELAY);
+    bool low = seq_reservation_needs_extend(&tx_sequence);
+    xSemaphoreGive(sequence_mutex);
+
+    if (low) {
+        sequence_store_request_flush();
+    }
+    return (uint16_t)sequence;
+}
+
+static void lora_protocol_deep_sleep_cb(void)
+{
+    resume_state.device_id = local_device_id;
+    memcpy(resume_state.key, local_device_key, sizeof(resume_state.key));
+    memcpy(&resume_state.aes, &aes_ctx, sizeof(resume_state.aes));
+
+    xSemaphoreTake(sequence_mutex, portMAX_DELAY);
+    resume_state.tx_sequence = tx_sequence;
+    xSemaphoreGive(sequence_mutex);
+
+    resume_state.magic = RESUME_STATE_MAGIC;
+}
+
+/**
+ * @brief Retained state is only trusted after a deep sleep wake with unchanged identity
+ *
+ * RTC memory also survives software resets, where the counter may have moved on since.
+ */
+static bool resume_state_valid(uint16_t device_id, const uint8_t *key)
+{
+    return resume_state.magic == RESUME_STATE_MAGIC && esp_reset_reason() == ESP_RST_DEEPSLEEP &&
+           resume_state.device_id == device_id && memcmp(resume_state.key, key, sizeof(resume_state.key)) == 0;
+}
+
 esp_err_t lora_protocol_init(uint16_t device_id, const uint8_t *key)
 {
     ESP_LOGI(TAG, "Initializing LoRa protocol for device 0x%04X with AES-256", device_id);
@@ -113,8 +263,41 @@ esp_err_t lora_protocol_init(uint16_t device_id, const uint8_t *key)
         }
     }
 
-    // Initialize sequence counter with random value
-    sequence_counter = esp_random() & 0xFFFF;
+    if (sequence_mutex == NULL) {
+        sequence_mutex = xSemaphoreCreateMutex();
+        if (sequence_mutex == NULL) {
+            ESP_LOGE(TAG, "Failed to create sequence mutex");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    if (reserve_mutex == NULL) {
+        reserve_mutex = xSemaphoreCreateMutex();
+        if (reserve_mutex == NULL) {
+            ESP_LOGE(TAG, "Failed to create reserve mutex");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    // Resume TX sequence above anything sent before reboot (random start on first boot).
+    // After deep sleep the retained counter (including fast-resume sends) avoids a journal write.
+    sequence_store_nvs_backend(&tx_sequence_backend, &tx_sequence_ctx, TX_SEQUENCE_NVS_NAMESPACE,
+                               TX_SEQUENCE_KEY_BASE);
+    esp_err_t seq_ret;
+    if (resume_state_valid(device_id, key)) {
+        seq_ret = seq_reservation_resume(&tx_sequence, &tx_sequence_backend, resume_state.tx_sequence.next,
+                                         esp_random() & 0xFFFF);
+    } else {
+        seq_ret = seq_reservation_init(&tx_sequence, &tx_sequence_backend, esp_random() & 0xFFFF);
+    }
+    resume_state.magic = 0;
+    if (seq_ret != ESP_OK) {
+        ESP_LOGW(TAG, "TX sequence reservation not persisted: %s", esp_err_to_name(seq_ret));
+    }
+    if (sequence_store_init() == ESP_OK) {
+        sequence_store_register_flusher(tx_sequence_flush);
+    }
+    power_mgmt_register_deep_sleep_cb(lora_protocol_deep_sleep_cb);
 
     protocol_initialized = true;
     ESP_LOGI(TAG, "LoRa protocol initialized with AES-256 encryption");
@@ -157,35 +340,50 @@ static esp_err_t calculate_mac_safe(const uint8_t *data, size_t data_len, const
     return ret;
 }
 
-static esp_err_t lora_protocol_send_command(lora_command_t command, const uint8_t *payload, uint8_t payload_length)
+/**
+ * @brief Fill device ID and encrypted block; the caller adds the MAC
+ *
+ * @param mac_data Output MAC input: device ID + encrypted block
+ */
+static esp_err_t encrypt_packet(uint16_t sequence, lora_command_t command, const uint8_t *payload,
+                                uint8_t payload_length, lora_packet_t *packet, uint8_t *mac_data)
 {
-    lora_packet_t packet;
-    packet.device_id = local_device_id;
+    packet->device_id = local_device_id;
 
     uint8_t plaintext[16] = {0};
-    plaintext[0]          = (sequence_counter >> 8) & 0xFF;
-    plaintext[1]          = sequence_counter & 0xFF;
+    plaintext[0]          = (sequence >> 8) & 0xFF;
+    plaintext[1]          = sequence & 0xFF;
     plaintext[2]          = command;
     plaintext[3]          = payload_length;
     if (payload && payload_length > 0) {
         memcpy(&plaintext[4], payload, payload_length);
     }
 
-    int ret = mbedtls_aes_crypt_ecb(&aes_ctx, MBEDTLS_AES_ENCRYPT, plaintext, packet.encrypted_data);
+    int ret = mbedtls_aes_crypt_ecb(&aes_ctx, MBEDTLS_AES_ENCRYPT, plaintext, packet->encrypted_data);
     if (ret != 0) {
         ESP_LOGE(TAG, "AES encryption failed: -0x%04X", -ret);
         return ESP_FAIL;
     }
 
-    uint8_t mac_data[18];
-    mac_data[0] = (packet.device_id >> 8) & 0xFF;
-    mac_data[1] = packet.device_id & 0xFF;
-    memcpy(&mac_data[2], packet.encrypted_data, 16);
+    mac_data[0] = (packet->device_id >> 8) & 0xFF;
+    mac_data[1] = packet->device_id & 0xFF;
+    memcpy(&mac_data[2], packet->encrypted_data, 16);
+    return ESP_OK;
+}
+
+static esp_err_t lora_protocol_send_command(lora_command_t command, const uint8_t *payload, uint8_t payload_length)
+{
+    lora_packet_t packet;
+    uint8_t mac_data[MAC_DATA_BUFFER_SIZE];
+
+    esp_err_t ret = encrypt_packet(take_tx_sequence(), command, payload, payload_length, &packet, mac_data);
+    if (ret != ESP_OK) {
+        return ret;
+    }
 
     // Protect shared HMAC context
     calculate_mac_safe(mac_data, MAC_DATA_BUFFER_SIZE, local_device_key, packet.mac);
 
-    sequence_counter++;
     connection_stats.packets_sent++;
 
     return lora_send_packet((uint8_t *)&packet, sizeof(packet));
@@ -209,6 +407,61 @@ esp_err_t lora_protocol_send_keyboard(uint8_t slot_id, uint8_t modifiers, uint8_
     return lora_protocol_send_command(CMD_HID_REPORT, (const uint8_t *)&payload, sizeof(lora_payload_t));
 }
 
+esp_err_t lora_protocol_fast_resume(void)
+{
+    if (resume_state.magic != RESUME_STATE_MAGIC || esp_reset_reason() != ESP_RST_DEEPSLEEP) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    local_device_id = resume_state.device_id;
+    memcpy(local_device_key, resume_state.key, sizeof(local_device_key));
+    memcpy(&aes_ctx, &resume_state.aes, sizeof(aes_ctx));
+    tx_sequence = resume_state.tx_sequence;
+    return ESP_OK;
+}
+
+esp_err_t lora_protocol_fast_send_keyboard(uint8_t slot_id, uint8_t modifiers, uint8_t keycode)
+{
+    if (resume_state.magic != RESUME_STATE_MAGIC) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Only numbers inside the durable reservation: extending it needs NVS, which is not up yet
+    uint32_t sequence;
+    if (seq_reservation_take(&tx_sequence, &sequence) != ESP_OK) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    resume_state.tx_sequence.next = tx_sequence.next;
+
+    lora_payload_t payload;
+    payload.version_slot                   = LORA_MAKE_VS(LORA_PROTOCOL_VERSION, slot_id);
+    payload.type_flags                     = LORA_MAKE_TF(HID_TYPE_KEYBOARD, 0);
+    payload.hid_report.keyboard.modifiers  = modifiers;
+    payload.hid_report.keyboard.keycode[0] = keycode;
+    payload.hid_report.keyboard.keycode[1] = 0;
+    payload.hid_report.keyboard.keycode[2] = 0;
+    payload.hid_report.keyboard.keycode[3] = 0;
+
+    lora_packet_t packet;
+    uint8_t mac_data[MAC_DATA_BUFFER_SIZE];
+    esp_err_t ret = encrypt_packet((uint16_t)sequence, CMD_HID_REPORT, (const uint8_t *)&payload,
+                                   sizeof(lora_payload_t), &packet, mac_data);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    // One-shot HMAC: the shared context and its mutex are created by lora_protocol_init()
+    uint8_t full_mac[32];
+    if (mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), local_device_key, sizeof(local_device_key),
+                        mac_data, sizeof(mac_data), full_mac) != 0) {
+        return ESP_FAIL;
+    }
+    memcpy(packet.mac, full_mac, LORA_MAC_SIZE);
+
+    connection_stats.packets_sent++;
+    return lora_driver_transmit_now((uint8_t *)&packet, sizeof(packet));
+}
+
 esp_err_t lora_protocol_send_keyboard_reliable(uint8_t slot_id, uint8_t modifiers, uint8_t keycode, uint32_t timeout_ms,
                                                uint8_t max_retries)
 {
@@ -237,7 +490,9 @@ esp_err_t lora_protocol_send_reliable(lora_command_t command, const uint8_t *pay
 
     for (uint8_t attempt = 0; attempt <= max_retries; attempt++) {
         // Capture sequence number that will be sent
-        uint16_t expected_ack_seq = sequence_counter;
+        xSemaphoreTake(sequence_mutex, portMAX_DELAY);
+        uint16_t expected_ack_seq = (uint16_t)tx_sequence.next;
+        xSemaphoreGive(sequence_mutex);
 
         // Clear any pending ACK event
         xEventGroupClearBits(ack_event_group, ACK_RECEIVED_BIT);
@@ -267,6 +522,7 @@ esp_err_t lora_protocol_send_reliable(lora_command_t command, const uint8_t *pay
             if (xSemaphoreTake(ack_mutex, pdMS_TO_TICKS(SEMAPHORE_WAIT_MS)) == pdTRUE) {
                 if (pending_ack_sequence == expected_ack_seq) {
                     xSemaphoreGive(ack_mutex);
+                    tx_resynced = false;
                     connection_stats.acks_received++;
                     ESP_LOGI(TAG, "ACK received for seq %d", expected_ack_seq);
                     return ESP_OK;
@@ -280,6 +536,14 @@ esp_err_t lora_protocol_send_reliable(lora_command_t command, const uint8_t *pay
 
     ESP_LOGE(TAG, "Failed to get ACK after %d attempts", max_retries + 1);
     connection_stats.failed_transmissions++;
+
+    // The receiver may have rebooted and now rejects these sequences as stale. Skip once per
+    // unacknowledged streak, so a receiver that is simply off does not push the counter round
+    if (!tx_resynced) {
+        esp_err_t resync_ret = tx_sequence_resync();
+        tx_resynced          = resync_ret == ESP_OK;
+        ESP_LOGW(TAG, "TX sequence skipped a block: %s", esp_err_to_name(resync_ret));
+    }
     return ESP_ERR_TIMEOUT;
 }
 
@@ -287,15 +551,22 @@ esp_err_t lora_protocol_receive_packet(lora_packet_data_t *packet_data, uint32_t
 {
     CHECK_INITIALIZED(protocol_initialized, "LoRa protocol");
 
-    uint8_t rx_buffer[LORA_PACKET_MAX_SIZE];
+    // Sized for the largest radio payload: routing below needs the length as received
+    uint8_t rx_buffer[LORA_RX_BUFFER_SIZE];
     size_t received_length;
 
     esp_err_t ret = lora_receive_packet(rx_buffer, sizeof(rx_buffer), &received_length, timeout_ms);
     if (ret != ESP_OK) {
-        return ret; // Timeout or error
+        return ret; // Timeout, truncation or error
     }
 
-    if (received_length != sizeof(lora_packet_t)) {
+    lora_rx_kind_t kind = lora_rx_classify(received_length);
+    if (kind == LORA_RX_FRAME && frame_callback) {
+        // Multicast OTA frames carry their own MAC (lora_fuota.h)
+        frame_callback(rx_buffer, received_length, lora_get_rssi(), frame_callback_ctx);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if (kind != LORA_RX_PACKET) {
         ESP_LOGW(TAG, "Invalid packet size: %d bytes", received_length);
         return ESP_ERR_INVALID_SIZE;
     }
@@ -375,49 +646,36 @@ esp_err_t lora_protocol_receive_packet(lora_packet_data_t *packet_data, uint32_t
         memcpy(packet_data->payload, &plaintext[4], packet_data->payload_length);
     }
 
-    // Sliding window deduplication with bitmap (enterprise-grade)
-    int32_t seq_diff = (int32_t)packet_data->sequence_num - (int32_t)sender_device.highest_sequence;
+    // Sliding window deduplication (window state is restored from NVS, or reset when the device is re-paired)
+    replay_window_t window = {.highest = sender_device.highest_sequence, .recent = sender_device.recent_bitmap};
+    replay_window_result_t seen = replay_window_check(&window, packet_data->sequence_num);
 
-    if (seq_diff > 0) {
-        // New packet, higher than anything seen
-        if (seq_diff < WINDOW_SIZE_LARGE) {
-            // Shift bitmap and mark this packet
-            sender_device.recent_bitmap <<= seq_diff;
-            sender_device.recent_bitmap |= 1;
-        } else {
-            // Large gap (reboot or wrap-around), reset bitmap
+    switch (seen) {
+        case REPLAY_WINDOW_JUMP:
+            // Packet loss or sender resumed from its next reserved block
             ESP_LOGI(TAG, "Large sequence gap detected for 0x%04X, resetting window", packet_data->device_id);
-            sender_device.recent_bitmap = 1;
-        }
-        sender_device.highest_sequence = packet_data->sequence_num;
-
-    } else if (seq_diff == 0) {
-        // Exact duplicate of highest sequence
-        ESP_LOGW(TAG, "Duplicate packet from 0x%04X: seq %d", packet_data->device_id, packet_data->sequence_num);
-        return ESP_ERR_INVALID_STATE;
-
-    } else if (seq_diff > -WINDOW_SIZE_SMALL) {
-        // Within recent window (out-of-order packet)
-        uint8_t bit_pos = -seq_diff;
-        if (sender_device.recent_bitmap & (1ULL << bit_pos)) {
-            ESP_LOGW(TAG, "Duplicate packet from 0x%04X: seq %d (already seen)", packet_data->device_id,
+            break;
+        case REPLAY_WINDOW_OUT_OF_ORDER:
+            ESP_LOGD(TAG, "Out-of-order packet accepted from 0x%04X: seq %d", packet_data->device_id,
                      packet_data->sequence_num);
-            return ESP_ERR_INVALID_STATE;
-        }
-        // Mark as seen
-        sender_device.recent_bitmap |= (1ULL << bit_pos);
-        ESP_LOGD(TAG, "Out-of-order packet accepted from 0x%04X: seq %d", packet_data->device_id,
-                 packet_data->sequence_num);
-
-    } else {
-        // Too old (>32 packets behind), likely reboot or major packet loss
-        ESP_LOGI(TAG, "Very old packet from 0x%04X (seq %d vs %d), accepting as reboot", packet_data->device_id,
-                 packet_data->sequence_num, sender_device.highest_sequence);
-        sender_device.highest_sequence = packet_data->sequence_num;
-        sender_device.recent_bitmap    = 1;
+            break;
+        case REPLAY_WINDOW_DUPLICATE:
+            ESP_LOGW(TAG, "Duplicate packet from 0x%04X: seq %d", packet_data->device_id, packet_data->sequence_num);
+            break;
+        case REPLAY_WINDOW_STALE:
+            ESP_LOGW(TAG, "Stale packet from 0x%04X rejected (seq %d vs %d)", packet_data->device_id,
+                     packet_data->sequence_num, sender_device.highest_sequence);
+            break;
+        default:
+            break;
     }
+    if (!replay_window_accepted(seen)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    sender_device.highest_sequence = window.highest;
+    sender_device.recent_bitmap    = window.recent;
 
-    // Update device registry with new sequence tracking (RAM-only, not persisted)
+    // Update device registry with new sequence tracking (snapshotted to NVS in the background)
     device_registry_update_sequence(packet_data->device_id, sender_device.highest_sequence,
                                     sender_device.recent_bitmap);
 
@@ -458,7 +716,10 @@ esp_err_t lora_protocol_send_ack(uint16_t to_device_id, uint16_t ack_sequence_nu
 
 uint16_t lora_protocol_get_next_sequence(void)
 {
-    return sequence_counter + 1;
+    xSemaphoreTake(sequence_mutex, portMAX_DELAY);
+    uint16_t next = (uint16_t)(tx_sequence.next + 1);
+    xSemaphoreGive(sequence_mutex);
+    return next;
 }
 
 lora_connection_state_t lora_protocol_get_connection_state(void)
@@ -524,13 +785,48 @@ void lora_protocol_register_state_callback(lora_protocol_state_callback_t callba
     state_callback_ctx = user_ctx;
 }
 
+void lora_protocol_register_frame_callback(lora_protocol_frame_callback_t callback, void *user_ctx)
+{
+    frame_callback     = callback;
+    frame_callback_ctx = user_ctx;
+}
+
+esp_err_t lora_protocol_frame_mac(uint16_t device_id, const uint8_t *data, size_t length, uint8_t *mac)
+{
+    CHECK_INITIALIZED(protocol_initialized, "LoRa protocol");
+
+    if (device_id == local_device_id) {
+        return calculate_mac_safe(data, length, local_device_key, mac);
+    }
+
+    paired_device_t device;
+    if (device_registry_get(device_id, &device) != ESP_OK) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    return calculate_mac_safe(data, length, device.aes_key, mac);
+}
+
+esp_err_t lora_protocol_send_frame(const uint8_t *frame, size_t length)
+{
+    CHECK_INITIALIZED(protocol_initialized, "LoRa protocol");
+
+    connection_stats.packets_sent++;
+    return lora_send_packet(frame, length);
+}
+
+uint16_t lora_protocol_get_device_id(void)
+{
+    return local_device_id;
+}
+
 static void protocol_rx_task(void *arg)
 {
     ESP_LOGI(TAG, "Protocol RX task started");
 
     while (protocol_rx_task_running) {
         lora_packet_data_t packet_data;
-        esp_err_t ret = lora_protocol_receive_packet(&packet_data, RX_TIMEOUT_MS);
+        // Block until a packet arrives; connection state only changes on reception
+        esp_err_t ret = lora_protocol_receive_packet(&packet_data, LORA_WAIT_FOREVER);
 
         if (ret == ESP_OK) {
             ESP_LOGD(TAG, "RX task: packet received, processing");
@@ -548,9 +844,11 @@ static void protocol_rx_task(void *arg)
                 continue;
             }
 
-            // Update activity for display sleep (PC mode only)
-            general_config_t config;
-            if (config_manager_get_general(&config) == ESP_OK && config.device_mode == DEVICE_MODE_PC) {
+            // Update activity for display sleep (PC mode only); snapshot read, no copy or flash access
+            const config_snapshot_t *config = config_snapshot_acquire();
+            bool pc_mode                    = config && config->general.device_mode == DEVICE_MODE_PC;
+            config_snapshot_release(config);
+            if (pc_mode) {
                 power_mgmt_update_activity();
             }
 
@@ -0,0 +1,14 @@
+/**
+ * @file lora_rx.c
+ * @brief Routing of received radio payloads by their length
+ */
+
+#include "lora_rx.h"
+
+lora_rx_kind_t lora_rx_classify(size_t length)
+{
+    if (length == 0 || length > LORA_RX_BUFFER_SIZE) {
+        return LORA_RX_INVALID;
+    }
+    return length == LORA_RX_PACKET_SIZE ? LORA_RX_PACKET : LORA_RX_FRAME;
+}
@@ -0,0 +1,60 @@
+/**
+ * @file lora_tables.h
+ * @brief Regulatory tables generated from lora_regulatory.json at build time
+ *
+ * CONTEXT: lora_regulatory_init() used to cJSON-parse the embedded JSON on every boot and
+ *          copy it into RAM arrays
+ * PURPOSE: Declare the const tables tools/generate_lora_tables.py emits into lora_tables.c,
+ *          together with the lookup indexes it precomputes
+ * USAGE: Private to the lora component; lora_bands.c implements the public API on top
+ */
+
+#pragma once
+
+#include "lora_bands.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Frequency range owned by one hardware profile
+ *
+ * Segments are disjoint and sorted by frequency. Where profiles overlap, the segment
+ * belongs to the first profile in JSON order.
+ */
+typedef struct {
+    uint32_t freq_min_khz;
+    uint32_t freq_max_khz; ///< Inclusive
+    uint8_t hardware;      ///< Index into lora_hardware_table
+} lora_freq_segment_t;
+
+/**
+ * @brief Region lookup entry, sorted by id (strcmp order)
+ */
+typedef struct {
+    const char *id;
+    uint8_t region;      ///< Index into lora_region_table
+    uint8_t rules_first; ///< First entry in lora_compliance_by_region
+    uint8_t rules_count;
+} lora_region_slot_t;
+
+extern const lora_hardware_t lora_hardware_table[]; ///< JSON order
+extern const int lora_hardware_count;
+
+extern const lora_freq_segment_t lora_freq_index[];
+extern const int lora_freq_index_count;
+
+extern const lora_region_t lora_region_table[]; ///< JSON order, as shown in the UI
+extern const lora_region_slot_t lora_region_index[];
+extern const int lora_region_count; ///< Entries in both region arrays
+
+extern const lora_compliance_t lora_compliance_table[]; ///< JSON order
+extern const int lora_compliance_count;
+
+extern const uint8_t lora_compliance_by_region[]; ///< Compliance indexes grouped by region, JSON order per region
+
+#ifdef __cplusplus
+}
+#endif
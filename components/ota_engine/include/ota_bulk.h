@@ -0,0 +1,154 @@
+/**
+ * @file ota_bulk.h
+ * @brief Bulk firmware upload stream: CRC-checked chunks, ping-pong buffers, windowed ACKs
+ *
+ * CONTEXT: firmware:upgrade only started ota_engine; the CDC transport had no way to carry
+ *          the image, and any stop-and-wait scheme leaves the link idle while flash is written
+ * PURPOSE: The receiver reads chunks straight from the transport FIFO into one of two
+ *          buffers while the writer hands the other to ota_engine_write() (flash write and
+ *          SHA-256), and the host keeps a window of chunks in flight, so the upload runs at
+ *          the speed of the slower of link and flash instead of their sum
+ * USAGE: Pure C, one receiver and one writer task; usb_cdc's cdc_ota.c runs it on the CDC
+ *        link, tools/loracue_rpc.py upload is the host side, tests/host drives it from threads
+ *
+ * Chunk (host -> device, little-endian):
+ *   magic 0xB7 | flags | seq u16 | len u16 | reserved u16 (0) | payload[len] | CRC-32 u32
+ *   The CRC-32 (IEEE) covers header and payload. Sequence numbers start at 0 and count
+ *   chunks; the last chunk carries OTA_BULK_FLAG_LAST.
+ *
+ * Status (device -> host, little-endian):
+ *   magic 0xB8 | type | seq u16 | value i32 | CRC-32 u32 over the first 8 bytes
+ *   ACK  seq = next chunk expected, every earlier one is written to flash
+ *   NAK  seq = chunk to resend from (go-back-N); the receiver drops everything else until then.
+ *        value ESP_ERR_INVALID_CRC: damaged or missing chunk, resend now; ESP_ERR_NO_MEM: no free
+ *        buffer (ota_bulk_rx_drop()), resend after the next ACK
+ *   DONE value = ota_engine_finish() result; ERROR value = the esp_err_t that ended the upload
+ */
+
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OTA_BULK_MAGIC 0xB7
+#define OTA_BULK_STATUS_MAGIC 0xB8
+#define OTA_BULK_HEADER_SIZE 8
+#define OTA_BULK_CRC_SIZE 4
+#define OTA_BULK_STATUS_SIZE 12
+#define OTA_BULK_CHUNK_MAX 4096 ///< Payload bytes; one flash sector
+#define OTA_BULK_BUFFERS 2
+
+#define OTA_BULK_FLAG_LAST 0x01  ///< Final chunk: finish and verify the image after writing it
+#define OTA_BULK_FLAG_ABORT 0x02 ///< Host gives up; the upload is aborted
+
+/** Bytes of buffer storage ota_bulk_init() needs for a given chunk size */
+#define OTA_BULK_STORAGE_SIZE(chunk_max) (OTA_BULK_BUFFERS * (OTA_BULK_HEADER_SIZE + (chunk_max) + OTA_BULK_CRC_SIZE))
+
+typedef enum {
+    OTA_BULK_STATUS_ACK   = 'A',
+    OTA_BULK_STATUS_NAK   = 'N',
+    OTA_BULK_STATUS_DONE  = 'D',
+    OTA_BULK_STATUS_ERROR = 'E',
+} ota_bulk_status_t;
+
+typedef enum {
+    OTA_BULK_RX_MORE,  ///< Keep reading
+    OTA_BULK_RX_BLOCK, ///< A chunk passed its checks and is queued for the writer
+    OTA_BULK_RX_BAD,   ///< Framing or CRC error: send a NAK for ota_bulk_rx_seq()
+} ota_bulk_rx_result_t;
+
+/**
+ * @brief One received chunk, valid until ota_bulk_release()
+ */
+typedef struct {
+    const uint8_t *data;
+    uint16_t len;
+    uint16_t seq;
+    uint8_t flags;
+} ota_bulk_block_t;
+
+typedef struct {
+    uint8_t *slot[OTA_BULK_BUFFERS];
+    ota_bulk_block_t block[OTA_BULK_BUFFERS];
+    size_t chunk_max;
+    atomic_uint head; ///< Blocks completed by the receiver
+    atomic_uint tail; ///< Blocks released by the writer
+
+    // Receiver only
+    size_t fill;      ///< Bytes of the current chunk in slot[head % OTA_BULK_BUFFERS]
+    size_t need;      ///< Bytes the current state is waiting for
+    size_t discard;   ///< Body bytes of an out-of-sequence chunk still to drop
+    uint16_t rx_seq;  ///< Next chunk the receiver accepts
+    uint8_t rx_flags; ///< Flags of the last chunk accepted: stop reading after LAST or ABORT
+    bool resync;      ///< After an error: scan for the header of chunk rx_seq
+    uint32_t crc_errors;
+    uint32_t framing_errors;
+    uint32_t out_of_sequence;
+    uint32_t stalls; ///< Reads refused because the writer held both buffers
+} ota_bulk_t;
+
+/**
+ * @brief CRC-32 (IEEE 802.3, reflected, as zlib); pass the previous result to continue, 0 to start
+ */
+uint32_t ota_bulk_crc32(uint32_t crc, const uint8_t *data, size_t len);
+
+/**
+ * @param storage OTA_BULK_STORAGE_SIZE(chunk_max) bytes, owned by the caller
+ * @param chunk_max Largest payload accepted, at most OTA_BULK_CHUNK_MAX
+ */
+void ota_bulk_init(ota_bulk_t *bulk, uint8_t *storage, size_t chunk_max);
+
+/**
+ * @brief Where the receiver should read to next and how much, never past the current chunk
+ *
+ * Read at most the returned count directly into *dst, then ota_bulk_rx_commit() what arrived.
+ *
+ * @return 0 while the writer holds both buffers: leave the data in the transport so it
+ *         pushes back on the host, and ask again after ota_bulk_release(); a transport that
+ *         cannot hold it calls ota_bulk_rx_drop()
+ */
+size_t ota_bulk_rx_window(ota_bulk_t *bulk, uint8_t **dst);
+
+/**
+ * @brief Drop data that found no free buffer, and everything after it until chunk ota_bulk_rx_seq() is resent
+ *
+ * @return true for the first drop since the last accepted chunk: send a NAK with ESP_ERR_NO_MEM
+ */
+bool ota_bulk_rx_drop(ota_bulk_t *bulk);
+
+/**
+ * @param len Bytes read into the last ota_bulk_rx_window() destination
+ */
+ota_bulk_rx_result_t ota_bulk_rx_commit(ota_bulk_t *bulk, size_t len);
+
+/**
+ * @brief Next chunk the receiver accepts (the NAK sequence number)
+ */
+uint16_t ota_bulk_rx_seq(const ota_bulk_t *bulk);
+
+/**
+ * @brief Oldest received chunk, or NULL if the writer has caught up
+ */
+const ota_bulk_block_t *ota_bulk_next_block(ota_bulk_t *bulk);
+
+/**
+ * @brief Hand the oldest chunk's buffer back to the receiver
+ */
+void ota_bulk_release(ota_bulk_t *bulk);
+
+/**
+ * @brief Encode a status record
+ *
+ * @return OTA_BULK_STATUS_SIZE
+ */
+size_t ota_bulk_encode_status(uint8_t out[OTA_BULK_STATUS_SIZE], ota_bulk_status_t type, uint16_t seq, int32_t value);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,97 @@
+/**
+ * @file ota_checkpoint.h
+ * @brief Resume points for interrupted firmware uploads
+ *
+ * CONTEXT: A BLE or Wi-Fi upload that dropped at 90% went through ota_engine_abort() and
+ *          the user started over from byte 0
+ * PURPOSE: Every interval bytes of a raw image, ota_engine stores where it is: the offset,
+ *          the SHA-256 midstate and the expected hash and signature. ota:resume reopens the
+ *          update partition at that offset and the transport sends only the rest; the final
+ *          hash still covers the whole image
+ * USAGE: Pure C; ota_engine.c persists records to NVS, tests/host interrupts simulated
+ *        transfers and resumes them from a byte buffer
+ *
+ * Boundaries are multiples of the interval, itself a multiple of the flash sector size, so
+ * everything before a checkpoint sits in whole sectors that resuming does not erase again.
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OTA_CHECKPOINT_MAGIC 0x314B434FU  ///< "OCK1"
+#define OTA_CHECKPOINT_HASH_STATE_MAX 128 ///< Room for the SHA-256 context, copied as is
+#define OTA_CHECKPOINT_SECTOR 4096
+
+typedef struct {
+    uint32_t magic;
+    uint32_t firmware_size;     ///< Size given to ota_engine_start()
+    uint32_t offset;            ///< Bytes written and hashed, a multiple of the interval
+    uint32_t partition_address; ///< Update partition holding them
+    char expected_sha256[65];   ///< Empty if the upload was not hash-verified
+    char signature[129];        ///< Empty if the upload was not signed
+    uint16_t hash_state_len;
+    uint8_t hash_state[OTA_CHECKPOINT_HASH_STATE_MAX];
+    uint32_t crc; ///< CRC-32 over everything before it
+} ota_checkpoint_t;
+
+/**
+ * @brief Set magic and CRC before the record is stored
+ */
+void ota_checkpoint_seal(ota_checkpoint_t *cp);
+
+/**
+ * @param stored_len Bytes the storage returned
+ * @return ESP_OK, ESP_ERR_INVALID_SIZE or ESP_ERR_INVALID_VERSION for a record from another
+ *         layout, ESP_ERR_INVALID_CRC for a torn or corrupted one, ESP_ERR_INVALID_STATE for
+ *         inconsistent fields
+ */
+esp_err_t ota_checkpoint_validate(const ota_checkpoint_t *cp, size_t stored_len);
+
+/**
+ * @brief Whether a valid record belongs to this upload; the SHA-256 compare ignores case
+ *
+ * Uploads without an expected hash never match: nothing would tell their bytes apart from
+ * another image's.
+ */
+bool ota_checkpoint_matches(const ota_checkpoint_t *cp, uint32_t firmware_size, const char *expected_sha256,
+                            uint32_t partition_address);
+
+/**
+ * @brief Splits writes at checkpoint boundaries
+ *
+ * write() flashes and hashes, save() records a checkpoint once offset reaches a boundary.
+ * A failed save only costs resume granularity: it is reported through save_failures.
+ */
+typedef struct {
+    esp_err_t (*write)(const uint8_t *data, size_t len, void *ctx);
+    esp_err_t (*save)(uint32_t offset, void *ctx);
+    void *ctx;
+    uint32_t interval; ///< Multiple of OTA_CHECKPOINT_SECTOR, 0 to never save
+    uint32_t offset;   ///< Bytes written so far
+    uint32_t save_failures;
+} ota_checkpointer_t;
+
+/**
+ * @param interval Rounded down to a multiple of OTA_CHECKPOINT_SECTOR
+ * @param offset Where writing starts: 0, or the offset of the checkpoint being resumed
+ */
+void ota_checkpointer_init(ota_checkpointer_t *cp, uint32_t interval, uint32_t offset,
+                           esp_err_t (*write)(const uint8_t *, size_t, void *), esp_err_t (*save)(uint32_t, void *),
+                           void *ctx);
+
+/**
+ * @return ESP_OK or the write() error
+ */
+esp_err_t ota_checkpointer_write(ota_checkpointer_t *cp, const uint8_t *data, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
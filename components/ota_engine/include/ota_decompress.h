@@ -0,0 +1,95 @@
+/**
+ * @file ota_decompress.h
+ * @brief Compressed OTA container and its streaming LZSS decoder
+ *
+ * CONTEXT: Every transport sent the raw application image; over BLE that takes minutes and a
+ *          LoRa path could never carry it
+ * PURPOSE: ota_engine accepts a container that scripts/sign_firmware.py --compress builds
+ *          and inflates it as it streams through ota_engine_write(), in a window of at most
+ *          4 KB. SHA-256 and the Ed25519 signature still cover the decompressed image, so
+ *          the same .sig verifies either form
+ * USAGE: Pure C; ota_engine.c detects the container by its magic, tests/host streams data
+ *        through the decoder in random pieces
+ *
+ * Container (little-endian):
+ *   magic "LCZ1" | format u8 (1 = LZSS) | window_bits u8 | lookahead_bits u8 | reserved u8 |
+ *   image_size u32 | image SHA-256 [32] | compressed stream
+ *
+ * The LZSS stream is the heatshrink encoding, read MSB first: tag bit 1 + 8-bit literal, or
+ * tag bit 0 + (distance - 1) in window_bits + (length - 1) in lookahead_bits.
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OTA_CONTAINER_MAGIC "LCZ1"
+#define OTA_CONTAINER_HEADER_SIZE 44
+#define OTA_CONTAINER_FORMAT_LZSS 1
+#define OTA_LZSS_WINDOW_BITS_MAX 12 ///< Decoder RAM is 1 << window_bits
+
+typedef struct {
+    uint8_t format;
+    uint8_t window_bits;
+    uint8_t lookahead_bits;
+    uint32_t image_size;
+    uint8_t image_sha256[32];
+} ota_container_t;
+
+/**
+ * @brief Parse a container header
+ *
+ * @param data At least OTA_CONTAINER_HEADER_SIZE bytes, or fewer to only check the magic
+ * @return ESP_OK, ESP_ERR_NOT_FOUND if data does not start with the magic (a raw image),
+ *         ESP_ERR_INVALID_SIZE if the magic matches but the header is incomplete,
+ *         ESP_ERR_NOT_SUPPORTED for an unknown format or window this decoder cannot hold
+ */
+esp_err_t ota_container_parse(const uint8_t *data, size_t len, ota_container_t *out);
+
+/**
+ * @brief Receives decompressed output, in order, in pieces of up to the window size
+ */
+typedef esp_err_t (*ota_decompress_sink_t)(const uint8_t *data, size_t len, void *ctx);
+
+typedef struct {
+    uint8_t *window;
+    uint32_t mask;
+    uint8_t window_bits;
+    uint8_t lookahead_bits;
+    uint8_t state;
+    uint8_t nbits;     ///< Unread bits in bits
+    uint32_t bits;
+    uint16_t distance; ///< Back-reference being copied
+    uint16_t remaining;
+    uint32_t produced; ///< Bytes decoded
+    uint32_t flushed;  ///< Bytes handed to the sink
+    ota_decompress_sink_t sink;
+    void *ctx;
+} ota_decompress_t;
+
+/**
+ * @param window 1 << container->window_bits bytes, owned by the caller
+ */
+void ota_decompress_init(ota_decompress_t *dec, const ota_container_t *container, uint8_t *window,
+                         ota_decompress_sink_t sink, void *ctx);
+
+/**
+ * @brief Decode the next piece of the compressed stream; input may be split anywhere
+ *
+ * Everything decoded so far reaches the sink before this returns.
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_ARG for a back-reference before the start of the image,
+ *         or the sink's error
+ */
+esp_err_t ota_decompress_feed(ota_decompress_t *dec, const uint8_t *data, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,108 @@
+/**
+ * @file ota_delta.h
+ * @brief Delta firmware patches applied against the running image
+ *
+ * CONTEXT: Releases change a small part of the image, yet every update carried and rewrote
+ *          all of it; over BLE, and over LoRa later, the transfer dominates the update
+ * PURPOSE: scripts/make_delta.py diffs a new build against a base build (bsdiff-style:
+ *          approximate matches carried as byte differences, plus inserted literals), and
+ *          ota_engine rebuilds the new image by streaming reads from the running partition
+ *          while the patch arrives through ota_engine_write(). RAM is a small scratch buffer,
+ *          plus the LZSS window when the patch body is compressed
+ * USAGE: Pure C; ota_engine.c detects the patch by its magic, tests/host applies patches to
+ *        synthetic images through a memory-backed base
+ *
+ * Patch (little-endian):
+ *   magic "LCD1" | format u8 (1) | window_bits u8 (0 = body stored) | lookahead_bits u8 |
+ *   reserved u8 | base_size u32 | image_size u32 | base SHA-256 [32] | image SHA-256 [32] |
+ *   body, LZSS-compressed as in ota_decompress.h unless window_bits is 0
+ *
+ * Body: records until image_size bytes are produced, each
+ *   diff_len varint | diff_len bytes added (mod 256) to the base from the base position on |
+ *   extra_len varint | extra_len literal bytes | seek zigzag varint added to the base position
+ * Varints are LEB128; the base position starts at 0 and advances with every diff byte.
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include "ota_decompress.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OTA_DELTA_MAGIC "LCD1"
+#define OTA_DELTA_HEADER_SIZE 80
+#define OTA_DELTA_FORMAT_BSDIFF 1
+#define OTA_DELTA_SCRATCH 256 ///< Base bytes read per step
+
+typedef struct {
+    uint8_t format;
+    uint8_t window_bits; ///< 0 if the body is stored
+    uint8_t lookahead_bits;
+    uint32_t base_size;
+    uint32_t image_size;
+    uint8_t base_sha256[32];
+    uint8_t image_sha256[32];
+} ota_delta_header_t;
+
+/**
+ * @brief Read len bytes of the base image at offset
+ */
+typedef esp_err_t (*ota_delta_read_t)(uint32_t offset, uint8_t *buf, size_t len, void *ctx);
+
+typedef struct {
+    ota_delta_read_t read;
+    void *read_ctx;
+    ota_decompress_sink_t sink;
+    void *sink_ctx;
+    uint32_t base_size;
+    uint32_t image_size;
+    uint32_t produced;
+    int64_t base_pos;   ///< Signed until a diff proves it in range
+    uint8_t state;
+    uint8_t shift;      ///< Varint bits collected
+    uint32_t varint;
+    uint32_t remaining; ///< Diff or extra bytes left in the current record
+    uint8_t scratch[OTA_DELTA_SCRATCH];
+} ota_delta_t;
+
+/**
+ * @brief Parse a patch header
+ *
+ * @return ESP_OK, ESP_ERR_NOT_FOUND without the magic, ESP_ERR_INVALID_SIZE if the magic
+ *         matches but the header is incomplete, ESP_ERR_NOT_SUPPORTED for an unknown format
+ *         or a body window the decoder cannot hold
+ */
+esp_err_t ota_delta_parse(const uint8_t *data, size_t len, ota_delta_header_t *out);
+
+/**
+ * @brief LZSS parameters of a compressed body, for ota_decompress_init()
+ */
+void ota_delta_body_container(const ota_delta_header_t *header, ota_container_t *out);
+
+void ota_delta_init(ota_delta_t *delta, const ota_delta_header_t *header, ota_delta_read_t read, void *read_ctx,
+                    ota_decompress_sink_t sink, void *sink_ctx);
+
+/**
+ * @brief Apply the next piece of the (decompressed) body; input may be split anywhere
+ *
+ * Matches ota_decompress_sink_t, so a compressed body decodes straight into it.
+ *
+ * @param ctx The ota_delta_t
+ * @return ESP_OK, ESP_ERR_INVALID_ARG for a record reaching outside the base,
+ *         ESP_ERR_INVALID_SIZE for output beyond image_size, or a read or sink error
+ */
+esp_err_t ota_delta_feed(const uint8_t *data, size_t len, void *ctx);
+
+/**
+ * @return true once image_size bytes have reached the sink
+ */
+bool ota_delta_complete(const ota_delta_t *delta);
+
+#ifdef __cplusplus
+}
+#endif
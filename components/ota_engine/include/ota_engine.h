@@ -2,16 +2,54 @@
 
 #include "esp_err.h"
 #include <stddef.h>
+#include <stdint.h>
 
 typedef enum { OTA_STATE_IDLE, OTA_STATE_ACTIVE, OTA_STATE_FINALIZING } ota_state_t;
 
+/**
+ * @brief Where the flash time of the current or last upload went
+ *
+ * Erasing runs in a background task ahead of the writes (ota_sector.h). While erase_wait_ms
+ * stays near 0 and write_ms + hash_ms are below the transfer time, the link sets the speed.
+ */
+typedef struct {
+    uint32_t erase_ms;      ///< Background eraser busy
+    uint32_t write_ms;      ///< Programming sectors
+    uint32_t hash_ms;       ///< SHA-256 of the image
+    uint32_t erase_wait_ms; ///< Writes blocked until the eraser had passed
+    uint32_t erased_bytes;  ///< Eraser position in the update partition
+    uint32_t flashed_bytes; ///< Write position: image bytes still in the sector buffer excluded
+} ota_timing_t;
+
 esp_err_t ota_engine_init(void);
+/**
+ * @param firmware_size Bytes the transport will write: the raw image, or the compressed
+ *        container from scripts/sign_firmware.py --compress (see ota_decompress.h)
+ */
 esp_err_t ota_engine_start(size_t firmware_size);
+/**
+ * @brief Continue an interrupted upload from its last checkpoint, or start it over
+ *
+ * Set the expected SHA-256 first: only a raw, hash-verified upload of the same size and hash
+ * to the same partition resumes (see ota_checkpoint.h). Otherwise this is ota_engine_start().
+ *
+ * @param[out] offset Where the transport continues: bytes before it are already in flash
+ */
+esp_err_t ota_engine_resume(size_t firmware_size, size_t *offset);
 esp_err_t ota_engine_set_expected_sha256(const char *sha256_hex);
 esp_err_t ota_engine_set_public_key(const uint8_t *public_key, size_t key_len);
 esp_err_t ota_engine_verify_signature(const char *signature_hex);
+/**
+ * @brief Write the next piece of the upload; a container is decompressed on the way to flash
+ *
+ * SHA-256 and the signature always cover the decompressed image.
+ */
 esp_err_t ota_engine_write(const uint8_t *data, size_t len);
 esp_err_t ota_engine_finish(void);
 esp_err_t ota_engine_abort(void);
-size_t ota_engine_get_progress(void);
+/**
+ * @param[out] timing Erase/write/hash breakdown, or NULL
+ * @return Percentage of firmware_size received
+ */
+size_t ota_engine_get_progress(ota_timing_t *timing);
 ota_state_t ota_engine_get_state(void);
@@ -0,0 +1,73 @@
+/**
+ * @file ota_sector.h
+ * @brief Whole-sector flash writes behind a background eraser
+ *
+ * CONTEXT: esp_ota_begin() erased the whole image region before the first byte was accepted,
+ *          and sequential-write mode stalls esp_ota_write() on an erase every 4 KB
+ * PURPOSE: ota_engine erases ahead of the write cursor in its own task while data arrives;
+ *          the writer collects upload pieces into one sector and programs it once the eraser
+ *          has passed it, so flash keeps up with the link instead of the link waiting on flash
+ * USAGE: Pure C; ota_engine.c supplies program (esp_ota_write_with_offset) and wait_erased
+ *        (blocks on the eraser), tests/host drives it with a simulated partition
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OTA_SECTOR_SIZE 4096
+#define OTA_SECTOR_ALIGN 16          ///< Flash encryption writes whole 16-byte blocks
+#define OTA_SECTOR_ERASE_BLOCK 65536 ///< Aligned ranges this large erase as one block command
+
+/**
+ * @brief Program len bytes at offset; offset is sector aligned, the range already erased
+ */
+typedef esp_err_t (*ota_sector_program_t)(uint32_t offset, const uint8_t *data, size_t len, void *ctx);
+
+/**
+ * @brief Return once [0, end) of the partition is erased, or the eraser's error
+ */
+typedef esp_err_t (*ota_sector_wait_t)(uint32_t end, void *ctx);
+
+typedef struct {
+    ota_sector_program_t program;
+    ota_sector_wait_t wait_erased;
+    void *ctx;
+    uint8_t *buf;    ///< OTA_SECTOR_SIZE bytes, owned by the caller
+    size_t fill;     ///< Bytes collected in buf
+    uint32_t offset; ///< Partition offset of buf[0]
+} ota_sector_writer_t;
+
+/**
+ * @param offset Where writing starts: 0, or a sector-aligned resume offset
+ */
+void ota_sector_writer_init(ota_sector_writer_t *w, uint8_t *buf, uint32_t offset, ota_sector_program_t program,
+                            ota_sector_wait_t wait_erased, void *ctx);
+
+/**
+ * @brief Append upload bytes; every sector is programmed as soon as it is complete
+ *
+ * Whole sectors that arrive sector aligned are programmed from data without a copy.
+ */
+esp_err_t ota_sector_writer_write(ota_sector_writer_t *w, const uint8_t *data, size_t len);
+
+/**
+ * @brief Program the partial last sector, padded with 0xFF to OTA_SECTOR_ALIGN
+ */
+esp_err_t ota_sector_writer_flush(ota_sector_writer_t *w);
+
+/**
+ * @return Bytes the eraser takes next from erased towards end: up to the next block boundary,
+ *         so aligned stretches go out as block erases
+ */
+uint32_t ota_sector_erase_step(uint32_t erased, uint32_t end);
+
+#ifdef __cplusplus
+}
+#endif
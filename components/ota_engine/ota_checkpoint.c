@@ -0,0 +1,80 @@
+/**
+ * @file ota_checkpoint.c
+ * @brief Resume points for interrupted firmware uploads
+ */
+
+#include "ota_checkpoint.h"
+#include "ota_bulk.h"
+#include <string.h>
+#include <strings.h>
+
+#define CRC_COVERED offsetof(ota_checkpoint_t, crc)
+
+void ota_checkpoint_seal(ota_checkpoint_t *cp)
+{
+    cp->magic = OTA_CHECKPOINT_MAGIC;
+    cp->crc   = ota_bulk_crc32(0, (const uint8_t *)cp, CRC_COVERED);
+}
+
+esp_err_t ota_checkpoint_validate(const ota_checkpoint_t *cp, size_t stored_len)
+{
+    if (stored_len != sizeof(*cp)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (cp->magic != OTA_CHECKPOINT_MAGIC) {
+        return ESP_ERR_INVALID_VERSION;
+    }
+    if (ota_bulk_crc32(0, (const uint8_t *)cp, CRC_COVERED) != cp->crc) {
+        return ESP_ERR_INVALID_CRC;
+    }
+    if (cp->offset > cp->firmware_size || cp->offset % OTA_CHECKPOINT_SECTOR != 0 ||
+        cp->hash_state_len > sizeof(cp->hash_state) || memchr(cp->expected_sha256, '\0', 65) == NULL ||
+        memchr(cp->signature, '\0', 129) == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return ESP_OK;
+}
+
+bool ota_checkpoint_matches(const ota_checkpoint_t *cp, uint32_t firmware_size, const char *expected_sha256,
+                            uint32_t partition_address)
+{
+    return expected_sha256 && expected_sha256[0] != '\0' && cp->firmware_size == firmware_size &&
+           cp->partition_address == partition_address && cp->offset > 0 &&
+           strcasecmp(cp->expected_sha256, expected_sha256) == 0;
+}
+
+void ota_checkpointer_init(ota_checkpointer_t *cp, uint32_t interval, uint32_t offset,
+                           esp_err_t (*write)(const uint8_t *, size_t, void *), esp_err_t (*save)(uint32_t, void *),
+                           void *ctx)
+{
+    memset(cp, 0, sizeof(*cp));
+    cp->write    = write;
+    cp->save     = save;
+    cp->ctx      = ctx;
+    cp->interval = interval - interval % OTA_CHECKPOINT_SECTOR;
+    cp->offset   = offset;
+}
+
+esp_err_t ota_checkpointer_write(ota_checkpointer_t *cp, const uint8_t *data, size_t len)
+{
+    while (len > 0) {
+        size_t n = len;
+        if (cp->interval > 0) {
+            uint32_t to_boundary = cp->interval - cp->offset % cp->interval;
+            n                    = n < to_boundary ? n : to_boundary;
+        }
+
+        esp_err_t ret = cp->write(data, n, cp->ctx);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        cp->offset += (uint32_t)n;
+        data += n;
+        len -= n;
+
+        if (cp->interval > 0 && cp->offset % cp->interval == 0 && cp->save(cp->offset, cp->ctx) != ESP_OK) {
+            cp->save_failures++;
+        }
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,151 @@
+/**
+ * @file ota_decompress.c
+ * @brief Compressed OTA container and its streaming LZSS decoder
+ */
+
+#include "ota_decompress.h"
+#include <string.h>
+
+#define MAGIC_LEN (sizeof(OTA_CONTAINER_MAGIC) - 1)
+#define WINDOW_BITS_MIN 4
+#define LOOKAHEAD_BITS_MIN 3
+
+enum {
+    STATE_TAG,
+    STATE_LITERAL,
+    STATE_DISTANCE,
+    STATE_LENGTH,
+    STATE_COPY,
+};
+
+esp_err_t ota_container_parse(const uint8_t *data, size_t len, ota_container_t *out)
+{
+    if (memcmp(data, OTA_CONTAINER_MAGIC, len < MAGIC_LEN ? len : MAGIC_LEN) != 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (len < OTA_CONTAINER_HEADER_SIZE) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    out->format         = data[4];
+    out->window_bits    = data[5];
+    out->lookahead_bits = data[6];
+    out->image_size     = (uint32_t)data[8] | (uint32_t)data[9] << 8 | (uint32_t)data[10] << 16 |
+                      (uint32_t)data[11] << 24;
+    memcpy(out->image_sha256, data + 12, sizeof(out->image_sha256));
+
+    if (out->format != OTA_CONTAINER_FORMAT_LZSS || data[7] != 0 || out->window_bits < WINDOW_BITS_MIN ||
+        out->window_bits > OTA_LZSS_WINDOW_BITS_MAX || out->lookahead_bits < LOOKAHEAD_BITS_MIN ||
+        out->lookahead_bits >= out->window_bits) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    return ESP_OK;
+}
+
+void ota_decompress_init(ota_decompress_t *dec, const ota_container_t *container, uint8_t *window,
+                         ota_decompress_sink_t sink, void *ctx)
+{
+    memset(dec, 0, sizeof(*dec));
+    dec->window         = window;
+    dec->mask           = (1u << container->window_bits) - 1;
+    dec->window_bits    = container->window_bits;
+    dec->lookahead_bits = container->lookahead_bits;
+    dec->state          = STATE_TAG;
+    dec->sink           = sink;
+    dec->ctx            = ctx;
+}
+
+static bool take_bits(ota_decompress_t *dec, const uint8_t **in, const uint8_t *end, uint8_t count, uint32_t *value)
+{
+    while (dec->nbits < count) {
+        if (*in == end) {
+            return false;
+        }
+        dec->bits = dec->bits << 8 | *(*in)++;
+        dec->nbits += 8;
+    }
+    dec->nbits -= count;
+    *value = (dec->bits >> dec->nbits) & ((1u << count) - 1);
+    return true;
+}
+
+// Hand the sink everything decoded and not yet passed on, as at most two window slices
+static esp_err_t flush(ota_decompress_t *dec)
+{
+    while (dec->flushed != dec->produced) {
+        uint32_t start = dec->flushed & dec->mask;
+        uint32_t len   = dec->produced - dec->flushed;
+        if (start + len > dec->mask + 1) {
+            len = dec->mask + 1 - start;
+        }
+        esp_err_t ret = dec->sink(dec->window + start, len, dec->ctx);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        dec->flushed += len;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t emit(ota_decompress_t *dec, uint8_t byte)
+{
+    dec->window[dec->produced & dec->mask] = byte;
+    dec->produced++;
+    // The next byte overwrites the oldest one: it has to be out of the window by then
+    return dec->produced - dec->flushed > dec->mask ? flush(dec) : ESP_OK;
+}
+
+esp_err_t ota_decompress_feed(ota_decompress_t *dec, const uint8_t *data, size_t len)
+{
+    const uint8_t *in  = data;
+    const uint8_t *end = data + len;
+    esp_err_t ret      = ESP_OK;
+    uint32_t value;
+
+    while (ret == ESP_OK) {
+        switch (dec->state) {
+        case STATE_TAG:
+            if (!take_bits(dec, &in, end, 1, &value)) {
+                return flush(dec);
+            }
+            dec->state = value ? STATE_LITERAL : STATE_DISTANCE;
+            break;
+
+        case STATE_LITERAL:
+            if (!take_bits(dec, &in, end, 8, &value)) {
+                return flush(dec);
+            }
+            ret        = emit(dec, (uint8_t)value);
+            dec->state = STATE_TAG;
+            break;
+
+        case STATE_DISTANCE:
+            if (!take_bits(dec, &in, end, dec->window_bits, &value)) {
+                return flush(dec);
+            }
+            dec->distance = (uint16_t)(value + 1);
+            dec->state    = STATE_LENGTH;
+            break;
+
+        case STATE_LENGTH:
+            if (!take_bits(dec, &in, end, dec->lookahead_bits, &value)) {
+                return flush(dec);
+            }
+            if (dec->distance > dec->produced) {
+                return ESP_ERR_INVALID_ARG;
+            }
+            dec->remaining = (uint16_t)(value + 1);
+            dec->state     = STATE_COPY;
+            break;
+
+        case STATE_COPY:
+            while (dec->remaining > 0 && ret == ESP_OK) {
+                ret = emit(dec, dec->window[(dec->produced - dec->distance) & dec->mask]);
+                dec->remaining--;
+            }
+            dec->state = STATE_TAG;
+            break;
+        }
+    }
+    return ret;
+}
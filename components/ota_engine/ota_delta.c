@@ -0,0 +1,188 @@
+/**
+ * @file ota_delta.c
+ * @brief Delta firmware patches applied against the running image
+ */
+
+#include "ota_delta.h"
+#include <string.h>
+
+#define MAGIC_LEN (sizeof(OTA_DELTA_MAGIC) - 1)
+#define VARINT_MAX_SHIFT 28
+
+enum {
+    STATE_DIFF_LEN,
+    STATE_DIFF,
+    STATE_EXTRA_LEN,
+    STATE_EXTRA,
+    STATE_SEEK,
+};
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+esp_err_t ota_delta_parse(const uint8_t *data, size_t len, ota_delta_header_t *out)
+{
+    if (memcmp(data, OTA_DELTA_MAGIC, len < MAGIC_LEN ? len : MAGIC_LEN) != 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (len < OTA_DELTA_HEADER_SIZE) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    out->format         = data[4];
+    out->window_bits    = data[5];
+    out->lookahead_bits = data[6];
+    out->base_size      = get_u32(data + 8);
+    out->image_size     = get_u32(data + 12);
+    memcpy(out->base_sha256, data + 16, sizeof(out->base_sha256));
+    memcpy(out->image_sha256, data + 48, sizeof(out->image_sha256));
+
+    if (out->format != OTA_DELTA_FORMAT_BSDIFF || data[7] != 0) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if (out->window_bits != 0) {
+        // Same limits as a compressed image
+        uint8_t header[OTA_CONTAINER_HEADER_SIZE] = OTA_CONTAINER_MAGIC;
+        ota_container_t body;
+        header[4] = OTA_CONTAINER_FORMAT_LZSS;
+        header[5] = out->window_bits;
+        header[6] = out->lookahead_bits;
+        return ota_container_parse(header, sizeof(header), &body);
+    }
+    return ESP_OK;
+}
+
+void ota_delta_body_container(const ota_delta_header_t *header, ota_container_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    out->format         = OTA_CONTAINER_FORMAT_LZSS;
+    out->window_bits    = header->window_bits;
+    out->lookahead_bits = header->lookahead_bits;
+}
+
+void ota_delta_init(ota_delta_t *delta, const ota_delta_header_t *header, ota_delta_read_t read, void *read_ctx,
+                    ota_decompress_sink_t sink, void *sink_ctx)
+{
+    memset(delta, 0, sizeof(*delta));
+    delta->read       = read;
+    delta->read_ctx   = read_ctx;
+    delta->sink       = sink;
+    delta->sink_ctx   = sink_ctx;
+    delta->base_size  = header->base_size;
+    delta->image_size = header->image_size;
+    delta->state      = STATE_DIFF_LEN;
+}
+
+// Collect one LEB128 varint; false if the input ran out first
+static bool take_varint(ota_delta_t *delta, const uint8_t **in, const uint8_t *end, esp_err_t *err)
+{
+    while (*in < end) {
+        uint8_t byte = *(*in)++;
+        if (delta->shift > VARINT_MAX_SHIFT) {
+            *err = ESP_ERR_INVALID_ARG;
+            return false;
+        }
+        delta->varint |= (uint32_t)(byte & 0x7F) << delta->shift;
+        delta->shift += 7;
+        if (!(byte & 0x80)) {
+            delta->shift = 0;
+            return true;
+        }
+    }
+    return false;
+}
+
+static esp_err_t output(ota_delta_t *delta, const uint8_t *data, size_t len)
+{
+    if (len > delta->image_size - delta->produced) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    delta->produced += len;
+    return delta->sink(data, len, delta->sink_ctx);
+}
+
+static esp_err_t apply_diff(ota_delta_t *delta, const uint8_t *diff, size_t len)
+{
+    if (delta->base_pos < 0 || delta->base_pos + (int64_t)len > delta->base_size) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t ret = delta->read((uint32_t)delta->base_pos, delta->scratch, len, delta->read_ctx);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    for (size_t i = 0; i < len; i++) {
+        delta->scratch[i] += diff[i];
+    }
+    delta->base_pos += len;
+    return output(delta, delta->scratch, len);
+}
+
+esp_err_t ota_delta_feed(const uint8_t *data, size_t len, void *ctx)
+{
+    ota_delta_t *delta = ctx;
+    const uint8_t *in  = data;
+    const uint8_t *end = data + len;
+    esp_err_t ret      = ESP_OK;
+
+    while (in < end && ret == ESP_OK) {
+        size_t n;
+        switch (delta->state) {
+        case STATE_DIFF_LEN:
+            if (!take_varint(delta, &in, end, &ret)) {
+                break;
+            }
+            delta->remaining = delta->varint;
+            delta->varint    = 0;
+            delta->state     = delta->remaining > 0 ? STATE_DIFF : STATE_EXTRA_LEN;
+            break;
+
+        case STATE_DIFF:
+            n   = delta->remaining < OTA_DELTA_SCRATCH ? delta->remaining : OTA_DELTA_SCRATCH;
+            n   = n < (size_t)(end - in) ? n : (size_t)(end - in);
+            ret = apply_diff(delta, in, n);
+            in += n;
+            delta->remaining -= n;
+            if (delta->remaining == 0) {
+                delta->state = STATE_EXTRA_LEN;
+            }
+            break;
+
+        case STATE_EXTRA_LEN:
+            if (!take_varint(delta, &in, end, &ret)) {
+                break;
+            }
+            delta->remaining = delta->varint;
+            delta->varint    = 0;
+            delta->state     = delta->remaining > 0 ? STATE_EXTRA : STATE_SEEK;
+            break;
+
+        case STATE_EXTRA:
+            n   = delta->remaining < (size_t)(end - in) ? delta->remaining : (size_t)(end - in);
+            ret = output(delta, in, n);
+            in += n;
+            delta->remaining -= n;
+            if (delta->remaining == 0) {
+                delta->state = STATE_SEEK;
+            }
+            break;
+
+        case STATE_SEEK:
+            if (!take_varint(delta, &in, end, &ret)) {
+                break;
+            }
+            // Zigzag: 0, -1, 1, -2, ...
+            delta->base_pos += (delta->varint & 1) ? -(int64_t)(delta->varint >> 1) - 1 : (int64_t)(delta->varint >> 1);
+            delta->varint = 0;
+            delta->state  = STATE_DIFF_LEN;
+            break;
+        }
+    }
+    return ret;
+}
+
+bool ota_delta_complete(const ota_delta_t *delta)
+{
+    return delta->produced == delta->image_size && delta->remaining == 0;
+}
@@ -1,10 +1,21 @@
 #include "ota_engine.h"
 #include "esp_log.h"
 #include "esp_ota_ops.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
+#include "freertos/task.h"
 #include "mbedtls/sha256.h"
+#include "nvs.h"
+#include "ota_checkpoint.h"
+#include "ota_decompress.h"
+#include "ota_delta.h"
+#include "ota_sector.h"
+#include "sdkconfig.h"
+#include "task_config.h"
 #include "tweetnacl.h"
+#include <stdatomic.h>
+#include <stdlib.h>
 #include <string.h>
 
 static const char *TAG = "ota_engine";
@@ -23,8 +34,51 @@ static uint8_t public_key[32]              = {0}; // Ed25519 public key (32 byte
 static bool public_key_set                 = false;
 static char expected_signature[129]        = {0}; // 128 hex chars + null terminator
 static bool signature_verification_enabled = false;
+static bool ota_hashing                    = false; // sha256_ctx is live
+
+// The first bytes of an upload decide between a raw image, a compressed container and a patch
+typedef enum { OTA_FORMAT_RAW, OTA_FORMAT_LZSS, OTA_FORMAT_DELTA } ota_format_t;
+
+static uint8_t ota_head[OTA_DELTA_HEADER_SIZE]; // The larger header
+static size_t ota_head_len     = 0;
+static ota_format_t ota_format = OTA_FORMAT_RAW;
+static uint8_t ota_declared_sha256[32]; // Image hash from a container or patch header
+static ota_container_t ota_container;
+static ota_delta_header_t ota_delta_header;
+static ota_decompress_t ota_decompress;
+static ota_delta_t ota_delta;
+static uint8_t *ota_window      = NULL; // LZSS window while a compressed stream is decoded
+static size_t ota_image_size    = 0;    // Bytes that go to flash: ota_total_size for a raw image
+static size_t ota_image_written = 0;
+
+// Raw, hash-verified images leave resume points in NVS (ota_checkpoint.h)
+static ota_checkpointer_t ota_checkpointer;
+static ota_checkpoint_t ota_checkpoint; // Scratch record, used with ota_mutex held
+
+// Image bytes reach flash as whole sectors behind a background eraser (ota_sector.h)
+static ota_sector_writer_t ota_sectors;
+static uint8_t *ota_sector_buf              = NULL;
+static TaskHandle_t ota_eraser              = NULL;
+static SemaphoreHandle_t ota_erase_progress = NULL; // Given after every erase step
+static const esp_partition_t *ota_erase_partition;
+static uint32_t ota_erase_end;
+static esp_err_t ota_erase_error;
+static atomic_uint ota_erased_to; // Everything below is erased
+static atomic_bool ota_erase_busy;
+static atomic_bool ota_erase_stop;
+static uint64_t ota_erase_us; // Written by the eraser only
+static uint64_t ota_write_us;
+static uint64_t ota_hash_us;
+static uint64_t ota_erase_wait_us;
 
 #define OTA_TIMEOUT_MS 30000
+#define OTA_ERASE_POLL_MS 20
+#define OTA_CHECKPOINT_NAMESPACE "ota"
+#define OTA_CHECKPOINT_KEY "ckpt"
+#define OTA_CHECKPOINT_INTERVAL ((uint32_t)CONFIG_LORACUE_OTA_CHECKPOINT_KB * 1024)
+
+// The midstate is stored as raw context bytes: only the firmware that wrote it reads it back
+_Static_assert(sizeof(mbedtls_sha256_context) <= OTA_CHECKPOINT_HASH_STATE_MAX, "SHA-256 context too large");
 
 // Embedded Ed25519 public key (32 bytes) from keys/firmware_public_ed25519.bin
 extern const uint8_t firmware_public_ed25519_bin_start[] asm("_binary_firmware_public_ed25519_bin_start");
@@ -122,6 +176,158 @@ esp_err_t ota_engine_verify_signature(const char *signature_hex)
     return ESP_OK;
 }
 
+static esp_err_t write_image(const uint8_t *data, size_t len, void *ctx);
+
+static void eraser_task(void *arg)
+{
+    (void)arg;
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        uint32_t erased = atomic_load(&ota_erased_to);
+        uint32_t step;
+        while (!atomic_load(&ota_erase_stop) && (step = ota_sector_erase_step(erased, ota_erase_end)) > 0) {
+            int64_t start = esp_timer_get_time();
+            esp_err_t ret = esp_partition_erase_range(ota_erase_partition, erased, step);
+            ota_erase_us += esp_timer_get_time() - start;
+            if (ret != ESP_OK) {
+                ota_erase_error = ret;
+                break;
+            }
+            erased += step;
+            atomic_store(&ota_erased_to, erased);
+            xSemaphoreGive(ota_erase_progress);
+        }
+        atomic_store(&ota_erase_busy, false);
+        xSemaphoreGive(ota_erase_progress);
+    }
+}
+
+static void stop_eraser(void)
+{
+    atomic_store(&ota_erase_stop, true);
+    while (atomic_load(&ota_erase_busy)) {
+        xSemaphoreTake(ota_erase_progress, pdMS_TO_TICKS(OTA_ERASE_POLL_MS));
+    }
+}
+
+// ota_sector_writer hooks: block until the eraser has passed, then program a sector
+static esp_err_t wait_erased(uint32_t end, void *ctx)
+{
+    (void)ctx;
+    int64_t start = esp_timer_get_time();
+    while (atomic_load(&ota_erased_to) < end) {
+        if (!atomic_load(&ota_erase_busy) && atomic_load(&ota_erased_to) < end) {
+            return ota_erase_error != ESP_OK ? ota_erase_error : ESP_ERR_INVALID_SIZE;
+        }
+        xSemaphoreTake(ota_erase_progress, pdMS_TO_TICKS(OTA_ERASE_POLL_MS));
+    }
+    ota_erase_wait_us += esp_timer_get_time() - start;
+    return ESP_OK;
+}
+
+static esp_err_t program_sector(uint32_t offset, const uint8_t *data, size_t len, void *ctx)
+{
+    (void)ctx;
+    int64_t start = esp_timer_get_time();
+    esp_err_t ret = esp_ota_write_with_offset(ota_handle, data, len, offset);
+    ota_write_us += esp_timer_get_time() - start;
+    return ret;
+}
+
+/**
+ * Start erasing [offset, image_size) in the background and write from offset. The handle was
+ * opened with OTA_WITH_SEQUENTIAL_WRITES, so esp_ota erases nothing itself.
+ */
+static esp_err_t begin_flash(const esp_partition_t *partition, uint32_t offset, size_t image_size)
+{
+    if (!ota_erase_progress && !(ota_erase_progress = xSemaphoreCreateBinary())) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (!ota_eraser && xTaskCreate(eraser_task, "ota_erase", TASK_STACK_SIZE_MEDIUM, NULL, TASK_PRIORITY_LOW,
+                                   &ota_eraser) != pdPASS) {
+        ota_eraser = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    ota_sector_buf = malloc(OTA_SECTOR_SIZE);
+    if (!ota_sector_buf) {
+        return ESP_ERR_NO_MEM;
+    }
+    ota_sector_writer_init(&ota_sectors, ota_sector_buf, offset, program_sector, wait_erased, NULL);
+
+    ota_erase_us        = 0;
+    ota_write_us        = 0;
+    ota_hash_us         = 0;
+    ota_erase_wait_us   = 0;
+    ota_erase_partition = partition;
+    ota_erase_end       = (image_size + OTA_SECTOR_SIZE - 1) & ~(uint32_t)(OTA_SECTOR_SIZE - 1);
+    ota_erase_error     = ESP_OK;
+    atomic_store(&ota_erased_to, offset);
+    atomic_store(&ota_erase_stop, false);
+    atomic_store(&ota_erase_busy, true);
+    xTaskNotifyGive(ota_eraser);
+    return ESP_OK;
+}
+
+static esp_err_t checkpoint_load(ota_checkpoint_t *cp)
+{
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(OTA_CHECKPOINT_NAMESPACE, NVS_READONLY, &handle);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    size_t size = sizeof(*cp);
+    ret         = nvs_get_blob(handle, OTA_CHECKPOINT_KEY, cp, &size);
+    nvs_close(handle);
+    return ret == ESP_OK ? ota_checkpoint_validate(cp, size) : ret;
+}
+
+static void checkpoint_clear(void)
+{
+    nvs_handle_t handle;
+    if (nvs_open(OTA_CHECKPOINT_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK) {
+        return;
+    }
+    if (nvs_erase_key(handle, OTA_CHECKPOINT_KEY) == ESP_OK) {
+        nvs_commit(handle);
+    }
+    nvs_close(handle);
+}
+
+// ota_checkpointer save hook: the bytes up to offset are flashed, hashed and erase-aligned
+static esp_err_t checkpoint_save(uint32_t offset, void *ctx)
+{
+    (void)ctx;
+    ota_checkpoint_t *cp = &ota_checkpoint;
+    memset(cp, 0, sizeof(*cp));
+    cp->firmware_size     = ota_total_size;
+    cp->offset            = offset;
+    cp->partition_address = ota_partition->address;
+    strcpy(cp->expected_sha256, expected_sha256);
+    if (signature_verification_enabled) {
+        strcpy(cp->signature, expected_signature);
+    }
+    cp->hash_state_len = sizeof(sha256_ctx);
+    memcpy(cp->hash_state, &sha256_ctx, sizeof(sha256_ctx));
+    ota_checkpoint_seal(cp);
+
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(OTA_CHECKPOINT_NAMESPACE, NVS_READWRITE, &handle);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    ret = nvs_set_blob(handle, OTA_CHECKPOINT_KEY, cp, sizeof(*cp));
+    if (ret == ESP_OK) {
+        ret = nvs_commit(handle);
+    }
+    nvs_close(handle);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Checkpoint at %lu not saved: %s", (unsigned long)offset, esp_err_to_name(ret));
+    } else {
+        ESP_LOGD(TAG, "Checkpoint at %lu of %zu", (unsigned long)offset, ota_total_size);
+    }
+    return ret;
+}
+
 esp_err_t ota_engine_start(size_t firmware_size)
 {
     if (!ota_mutex)
@@ -153,23 +359,30 @@ esp_err_t ota_engine_start(size_t firmware_size)
         return ESP_ERR_INVALID_SIZE;
     }
 
-    esp_err_t ret = esp_ota_begin(ota_partition, firmware_size, &ota_handle);
-    if (ret != ESP_OK) {
-        xSemaphoreGive(ota_mutex);
-        return ret;
-    }
+    // A new upload replaces whatever an interrupted one left to resume
+    checkpoint_clear();
 
+    // esp_ota_begin() waits for the first bytes: a container declares the size to erase
+    ota_handle          = 0;
     ota_total_size      = firmware_size;
     ota_received_bytes  = 0;
+    ota_head_len        = 0;
+    ota_format          = OTA_FORMAT_RAW;
+    ota_image_size      = 0;
+    ota_image_written   = 0;
     ota_state           = OTA_STATE_ACTIVE;
     ota_last_write_time = xTaskGetTickCount();
 
-    // Initialize SHA256 context if verification is enabled
-    if (sha256_verification_enabled) {
+    // Initialize SHA256 context if verification is enabled; the signature is over the hash too
+    ota_hashing = sha256_verification_enabled || signature_verification_enabled;
+    if (ota_hashing) {
         mbedtls_sha256_init(&sha256_ctx);
         mbedtls_sha256_starts(&sha256_ctx, 0); // 0 = SHA256 (not SHA224)
         ESP_LOGI(TAG, "SHA256 verification enabled");
     }
+    // A checkpoint is only resumed against an expected SHA256 (ota_engine_resume())
+    ota_checkpointer_init(&ota_checkpointer, sha256_verification_enabled ? OTA_CHECKPOINT_INTERVAL : 0, 0,
+                          write_image, checkpoint_save, NULL);
 
     ESP_LOGI(TAG, "OTA started: %zu bytes to partition %s", firmware_size, ota_partition->label);
 
@@ -177,6 +390,313 @@ esp_err_t ota_engine_start(size_t firmware_size)
     return ESP_OK;
 }
 
+// Reopen the update partition where the checkpoint of this upload left it
+static esp_err_t resume_from_checkpoint(size_t firmware_size)
+{
+    const esp_partition_t *partition = esp_ota_get_next_update_partition(NULL);
+    ota_checkpoint_t *cp             = &ota_checkpoint;
+    esp_err_t ret                    = partition ? checkpoint_load(cp) : ESP_FAIL;
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    if (!sha256_verification_enabled ||
+        !ota_checkpoint_matches(cp, firmware_size, expected_sha256, partition->address) ||
+        cp->hash_state_len != sizeof(sha256_ctx)) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    // The eraser clears the sectors from the offset on again as the rest arrives
+    ret = esp_ota_resume(partition, OTA_WITH_SEQUENTIAL_WRITES, cp->offset, &ota_handle);
+    if (ret == ESP_OK) {
+        ret = begin_flash(partition, cp->offset, firmware_size);
+    }
+    if (ret != ESP_OK) {
+        if (ota_handle) {
+            esp_ota_abort(ota_handle);
+        }
+        ota_handle = 0;
+        return ret;
+    }
+    if (!signature_verification_enabled && cp->signature[0] != '\0') {
+        ota_engine_verify_signature(cp->signature); // Still checked at finish
+    }
+
+    mbedtls_sha256_init(&sha256_ctx);
+    memcpy(&sha256_ctx, cp->hash_state, sizeof(sha256_ctx));
+    ota_hashing = true;
+    ota_checkpointer_init(&ota_checkpointer, OTA_CHECKPOINT_INTERVAL, cp->offset, write_image, checkpoint_save, NULL);
+
+    ota_partition       = partition;
+    ota_total_size      = firmware_size;
+    ota_received_bytes  = cp->offset;
+    ota_head_len        = 0;
+    ota_format          = OTA_FORMAT_RAW;
+    ota_image_size      = firmware_size;
+    ota_image_written   = cp->offset;
+    ota_state           = OTA_STATE_ACTIVE;
+    ota_last_write_time = xTaskGetTickCount();
+    return ESP_OK;
+}
+
+esp_err_t ota_engine_resume(size_t firmware_size, size_t *offset)
+{
+    if (!ota_mutex)
+        return ESP_ERR_INVALID_STATE;
+    if (!offset)
+        return ESP_ERR_INVALID_ARG;
+
+    if (xSemaphoreTake(ota_mutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    if (ota_state != OTA_STATE_IDLE) {
+        xSemaphoreGive(ota_mutex);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t ret = resume_from_checkpoint(firmware_size);
+    if (ret == ESP_OK) {
+        *offset = ota_received_bytes;
+        ESP_LOGI(TAG, "OTA resumed: %zu of %zu bytes already in partition %s", *offset, firmware_size,
+                 ota_partition->label);
+        xSemaphoreGive(ota_mutex);
+        return ESP_OK;
+    }
+    xSemaphoreGive(ota_mutex);
+
+    if (ret != ESP_ERR_NVS_NOT_FOUND && ret != ESP_ERR_NOT_FOUND) {
+        ESP_LOGW(TAG, "Checkpoint not usable (%s), starting over", esp_err_to_name(ret));
+    }
+    *offset = 0;
+    return ota_engine_start(firmware_size);
+}
+
+// Free what a session holds beyond the esp_ota handle
+static void release_session(void)
+{
+    if (ota_hashing) {
+        mbedtls_sha256_free(&sha256_ctx);
+        ota_hashing = false;
+    }
+    stop_eraser();
+    free(ota_window);
+    free(ota_sector_buf);
+    ota_window     = NULL;
+    ota_sector_buf = NULL;
+    ota_format     = OTA_FORMAT_RAW;
+}
+
+static esp_err_t begin_image(size_t image_size)
+{
+    esp_err_t ret = esp_ota_begin(ota_partition, OTA_WITH_SEQUENTIAL_WRITES, &ota_handle);
+    if (ret == ESP_OK) {
+        ret = begin_flash(ota_partition, 0, image_size);
+    }
+    if (ret != ESP_OK) {
+        if (ota_handle) {
+            esp_ota_abort(ota_handle);
+        }
+        ota_handle = 0;
+        return ret;
+    }
+    ota_image_size = image_size;
+    return ESP_OK;
+}
+
+// Flash and hash image bytes; the decompressor's or the patch's sink
+static esp_err_t write_image(const uint8_t *data, size_t len, void *ctx)
+{
+    (void)ctx;
+    if (ota_image_written + len > ota_image_size) {
+        ESP_LOGE(TAG, "Image exceeds its declared size");
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    if (ota_hashing) {
+        int64_t start = esp_timer_get_time();
+        mbedtls_sha256_update(&sha256_ctx, data, len);
+        ota_hash_us += esp_timer_get_time() - start;
+    }
+    esp_err_t ret = ota_sector_writer_write(&ota_sectors, data, len);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    ota_image_written += len;
+    return ESP_OK;
+}
+
+/**
+ * Check what a container or patch header says about the image it produces, then begin the
+ * update with that size. The declared hash is verified at finish in any case.
+ */
+static esp_err_t begin_declared_image(uint32_t image_size, const uint8_t sha256[32])
+{
+    if (image_size == 0 || image_size > ota_partition->size) {
+        ESP_LOGE(TAG, "Image size %lu does not fit partition %s", (unsigned long)image_size, ota_partition->label);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    char declared_hex[65];
+    for (int i = 0; i < 32; i++) {
+        snprintf(&declared_hex[i * 2], 3, "%02x", sha256[i]);
+    }
+    // An upload for another image would only fail after the whole transfer
+    if (sha256_verification_enabled && strcasecmp(declared_hex, expected_sha256) != 0) {
+        ESP_LOGE(TAG, "Upload is for image %.16s..., expected %.16s...", declared_hex, expected_sha256);
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    esp_err_t ret = begin_image(image_size);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    memcpy(ota_declared_sha256, sha256, sizeof(ota_declared_sha256));
+    if (!ota_hashing) {
+        mbedtls_sha256_init(&sha256_ctx);
+        mbedtls_sha256_starts(&sha256_ctx, 0);
+        ota_hashing = true;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t alloc_window(uint8_t window_bits)
+{
+    ota_window = malloc((size_t)1 << window_bits);
+    return ota_window ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+static esp_err_t begin_container(void)
+{
+    esp_err_t ret = alloc_window(ota_container.window_bits);
+    if (ret == ESP_OK) {
+        ret = begin_declared_image(ota_container.image_size, ota_container.image_sha256);
+    }
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    ota_decompress_init(&ota_decompress, &ota_container, ota_window, write_image, NULL);
+    ota_format = OTA_FORMAT_LZSS;
+    ESP_LOGI(TAG, "Compressed image: %zu -> %lu bytes, %u byte window", ota_total_size,
+             (unsigned long)ota_container.image_size, 1u << ota_container.window_bits);
+    return ESP_OK;
+}
+
+static esp_err_t read_base(uint32_t offset, uint8_t *buf, size_t len, void *ctx)
+{
+    return esp_partition_read((const esp_partition_t *)ctx, offset, buf, len);
+}
+
+// A patch only applies to the image it was made against
+static esp_err_t verify_base(const esp_partition_t *running, uint32_t base_size, const uint8_t sha256[32])
+{
+    const size_t chunk = 4096;
+    uint8_t *buf       = malloc(chunk);
+    if (!buf) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    TickType_t start = xTaskGetTickCount();
+    mbedtls_sha256_context ctx;
+    mbedtls_sha256_init(&ctx);
+    mbedtls_sha256_starts(&ctx, 0);
+    esp_err_t ret = ESP_OK;
+    for (uint32_t offset = 0; offset < base_size && ret == ESP_OK; offset += chunk) {
+        size_t n = base_size - offset < chunk ? base_size - offset : chunk;
+        ret      = esp_partition_read(running, offset, buf, n);
+        if (ret == ESP_OK) {
+            mbedtls_sha256_update(&ctx, buf, n);
+        }
+    }
+    uint8_t hash[32];
+    mbedtls_sha256_finish(&ctx, hash);
+    mbedtls_sha256_free(&ctx);
+    free(buf);
+
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    if (memcmp(hash, sha256, sizeof(hash)) != 0) {
+        ESP_LOGE(TAG, "Patch base does not match running image in %s", running->label);
+        return ESP_ERR_INVALID_VERSION;
+    }
+    ESP_LOGI(TAG, "Patch base verified: %lu bytes of %s in %lu ms", (unsigned long)base_size, running->label,
+             (unsigned long)pdTICKS_TO_MS(xTaskGetTickCount() - start));
+    return ESP_OK;
+}
+
+static esp_err_t begin_delta(void)
+{
+    const ota_delta_header_t *h    = &ota_delta_header;
+    const esp_partition_t *running = esp_ota_get_running_partition();
+    if (!running || h->base_size > running->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    esp_err_t ret = verify_base(running, h->base_size, h->base_sha256);
+    if (ret == ESP_OK && h->window_bits) {
+        ret = alloc_window(h->window_bits);
+    }
+    if (ret == ESP_OK) {
+        ret = begin_declared_image(h->image_size, h->image_sha256);
+    }
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    ota_delta_init(&ota_delta, h, read_base, (void *)running, write_image, NULL);
+    if (ota_window) {
+        ota_container_t body;
+        ota_delta_body_container(h, &body);
+        ota_decompress_init(&ota_decompress, &body, ota_window, ota_delta_feed, &ota_delta);
+    }
+    ota_format = OTA_FORMAT_DELTA;
+    ESP_LOGI(TAG, "Delta patch: %zu bytes -> %lu byte image from %s", ota_total_size, (unsigned long)h->image_size,
+             running->label);
+    return ESP_OK;
+}
+
+/**
+ * Hold the first bytes until they tell a container or patch from a raw image, then begin the
+ * update. On return *data and *len are what is left to write, decompress or apply.
+ */
+static esp_err_t detect_format(const uint8_t **data, size_t *len)
+{
+    size_t held = ota_head_len;
+    size_t take = sizeof(ota_head) - held < *len ? sizeof(ota_head) - held : *len;
+    memcpy(ota_head + held, *data, take);
+    ota_head_len += take;
+
+    esp_err_t lzss  = ota_container_parse(ota_head, ota_head_len, &ota_container);
+    esp_err_t delta = ota_delta_parse(ota_head, ota_head_len, &ota_delta_header);
+    if ((lzss == ESP_ERR_INVALID_SIZE || delta == ESP_ERR_INVALID_SIZE) && ota_received_bytes + *len < ota_total_size) {
+        *len = 0; // Looks like a header so far: wait for the rest of it
+        return ESP_OK;
+    }
+    // The header ends within this write (held is always shorter than it)
+    if (lzss == ESP_OK) {
+        *data += OTA_CONTAINER_HEADER_SIZE - held;
+        *len -= OTA_CONTAINER_HEADER_SIZE - held;
+        return begin_container();
+    }
+    if (delta == ESP_OK) {
+        *data += OTA_DELTA_HEADER_SIZE - held;
+        *len -= OTA_DELTA_HEADER_SIZE - held;
+        return begin_delta();
+    }
+    if (lzss == ESP_ERR_NOT_SUPPORTED || delta == ESP_ERR_NOT_SUPPORTED) {
+        ESP_LOGE(TAG, "Unsupported container or patch: %.4s format %u", (const char *)ota_head, ota_head[4]);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    // Raw image, possibly one shorter than a header
+    esp_err_t ret = begin_image(ota_total_size);
+    if (ret == ESP_OK) {
+        ret = ota_checkpointer_write(&ota_checkpointer, ota_head, held);
+    }
+    return ret;
+}
+
 esp_err_t ota_engine_write(const uint8_t *data, size_t len)
 {
     if (!ota_mutex)
@@ -186,7 +706,7 @@ esp_err_t ota_engine_write(const uint8_t *data, size_t len)
         return ESP_ERR_TIMEOUT;
     }
 
-    if (ota_state != OTA_STATE_ACTIVE || !ota_handle) {
+    if (ota_state != OTA_STATE_ACTIVE) {
         xSemaphoreGive(ota_mutex);
         return ESP_ERR_INVALID_STATE;
     }
@@ -205,15 +725,21 @@ esp_err_t ota_engine_write(const uint8_t *data, size_t len)
         return ESP_ERR_INVALID_SIZE;
     }
 
-    esp_err_t ret = esp_ota_write(ota_handle, data, len);
+    const uint8_t *rest = data;
+    size_t rest_len     = len;
+    esp_err_t ret       = ota_handle ? ESP_OK : detect_format(&rest, &rest_len);
+    if (ret == ESP_OK && rest_len > 0) {
+        if (ota_window) {
+            ret = ota_decompress_feed(&ota_decompress, rest, rest_len);
+        } else if (ota_format == OTA_FORMAT_DELTA) {
+            ret = ota_delta_feed(rest, rest_len, &ota_delta);
+        } else {
+            ret = ota_checkpointer_write(&ota_checkpointer, rest, rest_len);
+        }
+    }
     if (ret == ESP_OK) {
         ota_received_bytes += len;
         ota_last_write_time = now;
-
-        // Update SHA256 hash if verification is enabled
-        if (sha256_verification_enabled) {
-            mbedtls_sha256_update(&sha256_ctx, data, len);
-        }
     }
 
     xSemaphoreGive(ota_mutex);
@@ -234,85 +760,120 @@ esp_err_t ota_engine_finish(void)
         return ESP_ERR_INVALID_STATE;
     }
 
-    if (ota_received_bytes != ota_total_size) {
-        ESP_LOGW(TAG, "Size mismatch: received %zu, expected %zu", ota_received_bytes, ota_total_size);
+    if (ota_received_bytes != ota_total_size || ota_image_written != ota_image_size) {
+        ESP_LOGW(TAG, "Size mismatch: received %zu, expected %zu (image %zu of %zu)", ota_received_bytes,
+                 ota_total_size, ota_image_written, ota_image_size);
         xSemaphoreGive(ota_mutex);
         return ESP_ERR_INVALID_SIZE;
     }
 
+    esp_err_t ret = ota_sector_writer_flush(&ota_sectors);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Writing the last sector failed: %s", esp_err_to_name(ret));
+        xSemaphoreGive(ota_mutex);
+        return ret;
+    }
+    ota_timing_t timing;
+    ota_engine_get_progress(&timing);
+    ESP_LOGI(TAG, "Flash time: erase %lu ms in background, write %lu ms, hash %lu ms, waited %lu ms for erase",
+             (unsigned long)timing.erase_ms, (unsigned long)timing.write_ms, (unsigned long)timing.hash_ms,
+             (unsigned long)timing.erase_wait_ms);
+
     ota_state = OTA_STATE_FINALIZING;
+    checkpoint_clear(); // Whatever verification says, the upload is complete
 
-    // Verify SHA256 if enabled
-    if (sha256_verification_enabled) {
-        uint8_t calculated_hash[32];
+    // Hashes and signatures cover the image as written to flash, however it was uploaded
+    uint8_t calculated_hash[32];
+    char calculated_hex[65];
+    bool hashed = ota_hashing;
+    if (hashed) {
         mbedtls_sha256_finish(&sha256_ctx, calculated_hash);
-        mbedtls_sha256_free(&sha256_ctx);
-
-        // Convert calculated hash to hex string
-        char calculated_hex[65];
         for (int i = 0; i < 32; i++) {
             snprintf(&calculated_hex[i * 2], 3, "%02x", calculated_hash[i]);
         }
         calculated_hex[64] = '\0';
+    }
+    if (ota_format != OTA_FORMAT_RAW && memcmp(calculated_hash, ota_declared_sha256, 32) != 0) {
+        ESP_LOGE(TAG, "Image does not match the SHA256 its %s declared",
+                 ota_format == OTA_FORMAT_DELTA ? "patch" : "container");
+        release_session();
+        ota_handle = 0;
+        ota_state  = OTA_STATE_IDLE;
+        xSemaphoreGive(ota_mutex);
+        return ESP_ERR_INVALID_CRC;
+    }
+    release_session();
 
+    // Verify SHA256 if enabled
+    if (sha256_verification_enabled) {
         // Compare with expected hash (case-insensitive)
         if (strcasecmp(calculated_hex, expected_sha256) != 0) {
             ESP_LOGE(TAG, "SHA256 mismatch!");
             ESP_LOGE(TAG, "Expected:   %s", expected_sha256);
             ESP_LOGE(TAG, "Calculated: %s", calculated_hex);
-            ota_handle                  = 0;
-            ota_state                   = OTA_STATE_IDLE;
-            sha256_verification_enabled = false;
+            ota_handle                     = 0;
+            ota_state                      = OTA_STATE_IDLE;
+            sha256_verification_enabled    = false;
+            signature_verification_enabled = false;
             xSemaphoreGive(ota_mutex);
             return ESP_ERR_INVALID_CRC;
         }
 
         ESP_LOGI(TAG, "SHA256 verification passed: %s", calculated_hex);
         sha256_verification_enabled = false;
+    }
 
-        // Verify Ed25519 signature if enabled
-        if (signature_verification_enabled) {
-            // Convert signature from hex to binary
-            uint8_t signature_bin[64];
-            for (int i = 0; i < 64; i++) {
-                char hex[3]      = {expected_signature[i * 2], expected_signature[i * 2 + 1], '\0'};
-                signature_bin[i] = (uint8_t)strtol(hex, NULL, 16);
-            }
+    // Verify Ed25519 signature whenever one was set, with or without an expected SHA256
+    if (signature_verification_enabled) {
+        if (!hashed) {
+            ESP_LOGE(TAG, "No image hash to check the signature against - rejecting OTA");
+            ota_handle                     = 0;
+            ota_state                      = OTA_STATE_IDLE;
+            signature_verification_enabled = false;
+            xSemaphoreGive(ota_mutex);
+            return ESP_ERR_INVALID_RESPONSE;
+        }
 
-            // Convert SHA256 hash from hex to binary
-            uint8_t hash_bin[32];
-            for (int i = 0; i < 32; i++) {
-                char hex[3] = {calculated_hex[i * 2], calculated_hex[i * 2 + 1], '\0'};
-                hash_bin[i] = (uint8_t)strtol(hex, NULL, 16);
-            }
+        // Convert signature from hex to binary
+        uint8_t signature_bin[64];
+        for (int i = 0; i < 64; i++) {
+            char hex[3]      = {expected_signature[i * 2], expected_signature[i * 2 + 1], '\0'};
+            signature_bin[i] = (uint8_t)strtol(hex, NULL, 16);
+        }
 
-            // Verify Ed25519 signature using TweetNaCl
-            // crypto_sign_open returns 0 on success, -1 on failure
-            // We need to prepend signature to message for crypto_sign_open
-            uint8_t signed_message[96]; // 64 bytes signature + 32 bytes hash
-            memcpy(signed_message, signature_bin, 64);
-            memcpy(signed_message + 64, hash_bin, 32);
-
-            unsigned long long message_len;
-            uint8_t message_out[32];
-
-            if (crypto_sign_open(message_out, &message_len, signed_message, 96, public_key) != 0) {
-                ESP_LOGE(TAG, "Ed25519 signature verification FAILED!");
-                ESP_LOGE(TAG, "Firmware is NOT authentic - rejecting OTA");
-                ota_handle                     = 0;
-                ota_state                      = OTA_STATE_IDLE;
-                signature_verification_enabled = false;
-                xSemaphoreGive(ota_mutex);
-                return ESP_ERR_INVALID_RESPONSE;
-            }
+        // Convert SHA256 hash from hex to binary
+        uint8_t hash_bin[32];
+        for (int i = 0; i < 32; i++) {
+            char hex[3] = {calculated_hex[i * 2], calculated_hex[i * 2 + 1], '\0'};
+            hash_bin[i] = (uint8_t)strtol(hex, NULL, 16);
+        }
 
-            ESP_LOGI(TAG, "✓ Ed25519 signature verification PASSED");
-            ESP_LOGI(TAG, "✓ Firmware authenticity confirmed");
+        // Verify Ed25519 signature using TweetNaCl
+        // crypto_sign_open returns 0 on success, -1 on failure
+        // We need to prepend signature to message for crypto_sign_open
+        uint8_t signed_message[96]; // 64 bytes signature + 32 bytes hash
+        memcpy(signed_message, signature_bin, 64);
+        memcpy(signed_message + 64, hash_bin, 32);
+
+        unsigned long long message_len;
+        uint8_t message_out[32];
+
+        if (crypto_sign_open(message_out, &message_len, signed_message, 96, public_key) != 0) {
+            ESP_LOGE(TAG, "Ed25519 signature verification FAILED!");
+            ESP_LOGE(TAG, "Firmware is NOT authentic - rejecting OTA");
+            ota_handle                     = 0;
+            ota_state                      = OTA_STATE_IDLE;
             signature_verification_enabled = false;
+            xSemaphoreGive(ota_mutex);
+            return ESP_ERR_INVALID_RESPONSE;
         }
+
+        ESP_LOGI(TAG, "✓ Ed25519 signature verification PASSED");
+        ESP_LOGI(TAG, "✓ Firmware authenticity confirmed");
+        signature_verification_enabled = false;
     }
 
-    esp_err_t ret = esp_ota_end(ota_handle);
+    ret = esp_ota_end(ota_handle);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "OTA validation failed: %s", esp_err_to_name(ret));
         ota_handle = 0;
@@ -340,11 +901,13 @@ esp_err_t ota_engine_abort(void)
         return ESP_ERR_TIMEOUT;
     }
 
+    // A dropped transport ends up here: the partition and the checkpoint stay for ota:resume
     if (ota_handle) {
         esp_ota_abort(ota_handle);
         ota_handle = 0;
         ESP_LOGW(TAG, "OTA aborted");
     }
+    release_session();
 
     ota_received_bytes = 0;
     ota_total_size     = 0;
@@ -354,8 +917,16 @@ esp_err_t ota_engine_abort(void)
     return ESP_OK;
 }
 
-size_t ota_engine_get_progress(void)
+size_t ota_engine_get_progress(ota_timing_t *timing)
 {
+    if (timing) {
+        timing->erase_ms      = (uint32_t)(ota_erase_us / 1000);
+        timing->write_ms      = (uint32_t)(ota_write_us / 1000);
+        timing->hash_ms       = (uint32_t)(ota_hash_us / 1000);
+        timing->erase_wait_ms = (uint32_t)(ota_erase_wait_us / 1000);
+        timing->erased_bytes  = atomic_load(&ota_erased_to);
+        timing->flashed_bytes = ota_sectors.offset;
+    }
     if (ota_total_size > 0) {
         return (ota_received_bytes * 100) / ota_total_size;
     }
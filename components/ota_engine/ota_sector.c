@@ -0,0 +1,83 @@
+/**
+ * @file ota_sector.c
+ * @brief Whole-sector flash writes behind a background eraser
+ */
+
+#include "ota_sector.h"
+#include <string.h>
+
+void ota_sector_writer_init(ota_sector_writer_t *w, uint8_t *buf, uint32_t offset, ota_sector_program_t program,
+                            ota_sector_wait_t wait_erased, void *ctx)
+{
+    memset(w, 0, sizeof(*w));
+    w->program     = program;
+    w->wait_erased = wait_erased;
+    w->ctx         = ctx;
+    w->buf         = buf;
+    w->offset      = offset;
+}
+
+static esp_err_t program_sector(ota_sector_writer_t *w, const uint8_t *data, size_t len)
+{
+    esp_err_t ret = w->wait_erased(w->offset + len, w->ctx);
+    if (ret == ESP_OK) {
+        ret = w->program(w->offset, data, len, w->ctx);
+    }
+    if (ret == ESP_OK) {
+        w->offset += (uint32_t)len;
+    }
+    return ret;
+}
+
+esp_err_t ota_sector_writer_write(ota_sector_writer_t *w, const uint8_t *data, size_t len)
+{
+    while (len > 0) {
+        esp_err_t ret;
+        if (w->fill == 0 && len >= OTA_SECTOR_SIZE) {
+            ret = program_sector(w, data, OTA_SECTOR_SIZE);
+            if (ret != ESP_OK) {
+                return ret;
+            }
+            data += OTA_SECTOR_SIZE;
+            len -= OTA_SECTOR_SIZE;
+            continue;
+        }
+
+        size_t n = OTA_SECTOR_SIZE - w->fill < len ? OTA_SECTOR_SIZE - w->fill : len;
+        memcpy(w->buf + w->fill, data, n);
+        w->fill += n;
+        data += n;
+        len -= n;
+        if (w->fill == OTA_SECTOR_SIZE) {
+            ret = program_sector(w, w->buf, OTA_SECTOR_SIZE);
+            if (ret != ESP_OK) {
+                return ret;
+            }
+            w->fill = 0;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t ota_sector_writer_flush(ota_sector_writer_t *w)
+{
+    if (w->fill == 0) {
+        return ESP_OK;
+    }
+    size_t padded = (w->fill + OTA_SECTOR_ALIGN - 1) & ~(size_t)(OTA_SECTOR_ALIGN - 1);
+    memset(w->buf + w->fill, 0xFF, padded - w->fill);
+    esp_err_t ret = program_sector(w, w->buf, padded);
+    if (ret == ESP_OK) {
+        w->fill = 0;
+    }
+    return ret;
+}
+
+uint32_t ota_sector_erase_step(uint32_t erased, uint32_t end)
+{
+    if (erased >= end) {
+        return 0;
+    }
+    uint32_t to_block = OTA_SECTOR_ERASE_BLOCK - erased % OTA_SECTOR_ERASE_BLOCK;
+    return end - erased < to_block ? end - erased : to_block;
+}
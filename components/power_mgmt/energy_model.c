@@ -0,0 +1,197 @@
+/**
+ * @file energy_model.c
+ * @brief Residency accounting and fuel-gauge calibrated current model
+ */
+
+#include "energy_model.h"
+#include <string.h>
+
+#define CAL_EMA_ALPHA 0.2f // Weight of a new gauge sample in the calibration scale
+#define US_PER_S 1000000.0
+
+// Nominal currents (uA) from datasheets: ESP32-S3 @80MHz with PM, SX1262 @14dBm, e-paper/OLED, status LED
+static const uint32_t default_current_ua[ENERGY_COMPONENT_COUNT][ENERGY_MAX_STATES] = {
+    [ENERGY_COMPONENT_CPU]     = {[ENERGY_CPU_ACTIVE] = 8000, [ENERGY_CPU_LIGHT_SLEEP] = 800},
+    [ENERGY_COMPONENT_RADIO]   = {[ENERGY_RADIO_SLEEP]   = 2,
+                                  [ENERGY_RADIO_STANDBY] = 600,
+                                  [ENERGY_RADIO_RX]      = 5300,
+                                  [ENERGY_RADIO_TX]      = 45000},
+    [ENERGY_COMPONENT_DISPLAY] = {[ENERGY_DISPLAY_OFF] = 0, [ENERGY_DISPLAY_ON] = 2000},
+    [ENERGY_COMPONENT_LED]     = {[ENERGY_LED_OFF] = 0, [ENERGY_LED_ON] = 5000, [ENERGY_LED_FADE] = 2500},
+};
+
+static const uint8_t state_count[ENERGY_COMPONENT_COUNT] = {
+    [ENERGY_COMPONENT_CPU]     = 2,
+    [ENERGY_COMPONENT_RADIO]   = 4,
+    [ENERGY_COMPONENT_DISPLAY] = 2,
+    [ENERGY_COMPONENT_LED]     = 3,
+};
+
+static const char *const component_names[ENERGY_COMPONENT_COUNT] = {"cpu", "radio", "display", "led"};
+
+static const char *const state_names[ENERGY_COMPONENT_COUNT][ENERGY_MAX_STATES] = {
+    [ENERGY_COMPONENT_CPU]     = {"active", "light_sleep"},
+    [ENERGY_COMPONENT_RADIO]   = {"sleep", "standby", "rx", "tx"},
+    [ENERGY_COMPONENT_DISPLAY] = {"off", "on"},
+    [ENERGY_COMPONENT_LED]     = {"off", "on", "fade"},
+};
+
+static bool valid(energy_component_t component, uint8_t state)
+{
+    return (unsigned)component < ENERGY_COMPONENT_COUNT && state < state_count[component];
+}
+
+void energy_model_init(energy_model_t *model, uint64_t now_us)
+{
+    memset(model, 0, sizeof(*model));
+    memcpy(model->current_ua, default_current_ua, sizeof(model->current_ua));
+
+    model->state[ENERGY_COMPONENT_CPU]     = ENERGY_CPU_ACTIVE;
+    model->state[ENERGY_COMPONENT_RADIO]   = ENERGY_RADIO_SLEEP;
+    model->state[ENERGY_COMPONENT_DISPLAY] = ENERGY_DISPLAY_ON;
+    model->state[ENERGY_COMPONENT_LED]     = ENERGY_LED_OFF;
+    for (int c = 0; c < ENERGY_COMPONENT_COUNT; c++) {
+        model->state_since_us[c] = now_us;
+    }
+
+    model->start_us            = now_us;
+    model->scale               = 1.0f;
+    model->cal_window_start_us = now_us;
+}
+
+esp_err_t energy_model_set_coefficient(energy_model_t *model, energy_component_t component, uint8_t state,
+                                       uint32_t current_ua)
+{
+    if (!valid(component, state)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    model->current_ua[component][state] = current_ua;
+    return ESP_OK;
+}
+
+esp_err_t energy_model_set_state(energy_model_t *model, energy_component_t component, uint8_t state,
+                                 uint64_t now_us)
+{
+    if (!valid(component, state)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint8_t previous = model->state[component];
+    if (previous == state) {
+        return ESP_OK;
+    }
+
+    // Timestamps from different tasks may arrive slightly out of order
+    if (now_us > model->state_since_us[component]) {
+        model->residency_us[component][previous] += now_us - model->state_since_us[component];
+        model->state_since_us[component] = now_us;
+    }
+    model->state[component] = state;
+    model->transitions[component]++;
+    return ESP_OK;
+}
+
+uint64_t energy_model_residency_us(const energy_model_t *model, energy_component_t component, uint8_t state,
+                                   uint64_t now_us)
+{
+    if (!valid(component, state)) {
+        return 0;
+    }
+
+    uint64_t residency = model->residency_us[component][state];
+    if (model->state[component] == state && now_us > model->state_since_us[component]) {
+        residency += now_us - model->state_since_us[component];
+    }
+    return residency;
+}
+
+double energy_model_charge_uas(const energy_model_t *model, uint64_t now_us)
+{
+    double charge = 0.0;
+    for (int c = 0; c < ENERGY_COMPONENT_COUNT; c++) {
+        for (uint8_t s = 0; s < state_count[c]; s++) {
+            uint64_t residency = energy_model_residency_us(model, (energy_component_t)c, s, now_us);
+            charge += (double)residency * model->current_ua[c][s] / US_PER_S;
+        }
+    }
+    return charge;
+}
+
+esp_err_t energy_model_calibrate(energy_model_t *model, int32_t measured_ua, uint64_t now_us)
+{
+    if (measured_ua <= 0) {
+        // Charging or external power: restart the window so it is not folded into the next sample
+        model->cal_window_start_us     = now_us;
+        model->cal_window_start_charge = energy_model_charge_uas(model, now_us);
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (now_us < model->cal_window_start_us + ENERGY_CAL_MIN_WINDOW_US) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    double charge      = energy_model_charge_uas(model, now_us);
+    double window_s    = (double)(now_us - model->cal_window_start_us) / US_PER_S;
+    double modeled_avg = (charge - model->cal_window_start_charge) / window_s;
+
+    model->cal_window_start_us     = now_us;
+    model->cal_window_start_charge = charge;
+    model->last_measured_ua        = measured_ua;
+
+    if (modeled_avg <= 0.0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    float ratio = (float)(measured_ua / modeled_avg);
+    if (ratio < ENERGY_CAL_SCALE_MIN) {
+        ratio = ENERGY_CAL_SCALE_MIN;
+    } else if (ratio > ENERGY_CAL_SCALE_MAX) {
+        ratio = ENERGY_CAL_SCALE_MAX;
+    }
+
+    // First sample replaces the nominal scale, later ones are smoothed
+    model->scale = (model->calibration_samples == 0) ? ratio : model->scale + CAL_EMA_ALPHA * (ratio - model->scale);
+    model->calibration_samples++;
+    return ESP_OK;
+}
+
+void energy_model_report(const energy_model_t *model, uint64_t now_us, float remaining_mah, energy_report_t *report)
+{
+    memset(report, 0, sizeof(*report));
+
+    uint64_t elapsed_us = (now_us > model->start_us) ? now_us - model->start_us : 0;
+    report->uptime_ms   = elapsed_us / 1000;
+
+    for (int c = 0; c < ENERGY_COMPONENT_COUNT; c++) {
+        for (uint8_t s = 0; s < state_count[c]; s++) {
+            report->residency_ms[c][s] = energy_model_residency_us(model, (energy_component_t)c, s, now_us) / 1000;
+        }
+        report->transitions[c] = model->transitions[c];
+        report->state[c]       = model->state[c];
+    }
+
+    report->calibration_scale   = model->scale;
+    report->calibration_samples = model->calibration_samples;
+    report->last_measured_ua    = model->last_measured_ua;
+
+    if (elapsed_us == 0) {
+        return;
+    }
+
+    double modeled_avg        = energy_model_charge_uas(model, now_us) / ((double)elapsed_us / US_PER_S);
+    report->modeled_avg_ua    = (uint32_t)modeled_avg;
+    report->calibrated_avg_ua = (uint32_t)(modeled_avg * model->scale);
+
+    if (report->calibrated_avg_ua > 0 && remaining_mah > 0.0f) {
+        report->projected_hours = remaining_mah * 1000.0f / (float)report->calibrated_avg_ua;
+    }
+}
+
+const char *energy_model_component_name(energy_component_t component)
+{
+    return ((unsigned)component < ENERGY_COMPONENT_COUNT) ? component_names[component] : "unknown";
+}
+
+const char *energy_model_state_name(energy_component_t component, uint8_t state)
+{
+    return valid(component, state) ? state_names[component][state] : NULL;
+}
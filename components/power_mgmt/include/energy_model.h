@@ -0,0 +1,160 @@
+/**
+ * @file energy_model.h
+ * @brief Per-component power-state residency accounting and battery-life model
+ *
+ * CONTEXT: Battery-life estimates must come from what the hardware actually did
+ * PURPOSE: Fold timestamped CPU/radio/display/LED state transitions into residency
+ *          counters, weight them with per-state current coefficients, and scale the
+ *          result with fuel-gauge measurements where a gauge exists
+ * USAGE: Pure C, caller provides timestamps and serialization (see power_mgmt)
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ENERGY_MAX_STATES 4
+#define ENERGY_CAL_MIN_WINDOW_US 2000000ULL ///< Shorter calibration windows are too noisy
+#define ENERGY_CAL_SCALE_MIN 0.25f
+#define ENERGY_CAL_SCALE_MAX 4.0f
+
+/**
+ * @brief Components with independently tracked power states
+ */
+typedef enum {
+    ENERGY_COMPONENT_CPU,
+    ENERGY_COMPONENT_RADIO,
+    ENERGY_COMPONENT_DISPLAY,
+    ENERGY_COMPONENT_LED,
+    ENERGY_COMPONENT_COUNT,
+} energy_component_t;
+
+typedef enum {
+    ENERGY_CPU_ACTIVE,
+    ENERGY_CPU_LIGHT_SLEEP,
+} energy_cpu_state_t;
+
+typedef enum {
+    ENERGY_RADIO_SLEEP,
+    ENERGY_RADIO_STANDBY,
+    ENERGY_RADIO_RX,
+    ENERGY_RADIO_TX,
+} energy_radio_state_t;
+
+typedef enum {
+    ENERGY_DISPLAY_OFF,
+    ENERGY_DISPLAY_ON,
+} energy_display_state_t;
+
+typedef enum {
+    ENERGY_LED_OFF,
+    ENERGY_LED_ON,
+    ENERGY_LED_FADE,
+} energy_led_state_t;
+
+/**
+ * @brief Accounting state (one instance per device)
+ */
+typedef struct {
+    uint8_t state[ENERGY_COMPONENT_COUNT];
+    uint64_t state_since_us[ENERGY_COMPONENT_COUNT];
+    uint64_t residency_us[ENERGY_COMPONENT_COUNT][ENERGY_MAX_STATES];
+    uint32_t transitions[ENERGY_COMPONENT_COUNT];
+    uint32_t current_ua[ENERGY_COMPONENT_COUNT][ENERGY_MAX_STATES]; ///< Model coefficients
+    uint64_t start_us;
+
+    // Fuel-gauge calibration
+    float scale;                    ///< measured / modeled current
+    uint32_t calibration_samples;   ///< Accepted gauge samples
+    int32_t last_measured_ua;       ///< Last gauge reading (discharge positive)
+    uint64_t cal_window_start_us;   ///< Start of current calibration window
+    double cal_window_start_charge; ///< Modeled charge (uA*s) at window start
+} energy_model_t;
+
+/**
+ * @brief Snapshot for reporting
+ */
+typedef struct {
+    uint64_t uptime_ms;
+    uint64_t residency_ms[ENERGY_COMPONENT_COUNT][ENERGY_MAX_STATES];
+    uint32_t transitions[ENERGY_COMPONENT_COUNT];
+    uint8_t state[ENERGY_COMPONENT_COUNT];
+    uint32_t modeled_avg_ua;    ///< Coefficient model only
+    uint32_t calibrated_avg_ua; ///< Model scaled by fuel-gauge calibration
+    int32_t last_measured_ua;   ///< Last gauge reading, 0 if none
+    float calibration_scale;
+    uint32_t calibration_samples;
+    float projected_hours; ///< Remaining capacity / calibrated average current
+} energy_report_t;
+
+/**
+ * @brief Initialize model with default coefficients
+ *
+ * Boot state: CPU active, display on, radio asleep, LED off.
+ */
+void energy_model_init(energy_model_t *model, uint64_t now_us);
+
+/**
+ * @brief Override a current coefficient
+ *
+ * @return ESP_ERR_INVALID_ARG for unknown component/state
+ */
+esp_err_t energy_model_set_coefficient(energy_model_t *model, energy_component_t component, uint8_t state,
+                                       uint32_t current_ua);
+
+/**
+ * @brief Record a state transition (no-op if state is unchanged)
+ *
+ * @return ESP_ERR_INVALID_ARG for unknown component/state
+ */
+esp_err_t energy_model_set_state(energy_model_t *model, energy_component_t component, uint8_t state,
+                                 uint64_t now_us);
+
+/**
+ * @brief Residency of one state including the ongoing interval
+ */
+uint64_t energy_model_residency_us(const energy_model_t *model, energy_component_t component, uint8_t state,
+                                   uint64_t now_us);
+
+/**
+ * @brief Modeled charge drawn since init (uA*s, uncalibrated)
+ */
+double energy_model_charge_uas(const energy_model_t *model, uint64_t now_us);
+
+/**
+ * @brief Feed one fuel-gauge sample (average current since previous sample)
+ *
+ * Compares the gauge reading with the modeled average over the same window and
+ * moves the calibration scale towards it. Windows shorter than
+ * ENERGY_CAL_MIN_WINDOW_US are extended rather than evaluated.
+ *
+ * @param measured_ua Measured discharge current (positive)
+ * @return ESP_OK if the sample was applied, ESP_ERR_INVALID_STATE if the window is still too short,
+ *         ESP_ERR_INVALID_ARG for non-positive readings (charging; the window is restarted)
+ */
+esp_err_t energy_model_calibrate(energy_model_t *model, int32_t measured_ua, uint64_t now_us);
+
+/**
+ * @brief Build report, projecting battery life from remaining capacity
+ */
+void energy_model_report(const energy_model_t *model, uint64_t now_us, float remaining_mah, energy_report_t *report);
+
+/**
+ * @brief Component name for logs and JSON ("cpu", "radio", ...)
+ */
+const char *energy_model_component_name(energy_component_t component);
+
+/**
+ * @brief State name for logs and JSON, NULL for unused state slots
+ */
+const char *energy_model_state_name(energy_component_t component, uint8_t state);
+
+#ifdef __cplusplus
+}
+#endif
@@ -10,7 +10,9 @@
 #pragma once
 
 #include "config_manager.h"
+#include "energy_model.h"
 #include "esp_sleep.h"
+#include "sleep_policy.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -46,9 +48,26 @@ typedef struct {
     uint32_t deep_sleep_time_ms;    ///< Total deep sleep time
     uint32_t wake_count_button;     ///< Wake count from buttons
     uint32_t wake_count_timer;      ///< Wake count from timer
-    float estimated_battery_hours;  ///< Estimated battery life remaining
+    float estimated_battery_hours;  ///< Projected battery life from the energy model
 } power_stats_t;
 
+/**
+ * @brief Sleep orchestration snapshot
+ */
+typedef struct {
+    sleep_policy_t policy;      ///< Registered clients and their blocking history
+    uint64_t now_us;            ///< Snapshot time for sleep_policy_*_us() queries
+    uint32_t light_sleep_count; ///< Automatic light sleep entries (0 without PM sleep callbacks)
+    uint64_t light_sleep_us;    ///< Time spent in automatic light sleep
+} power_sleep_report_t;
+
+#define POWER_MGMT_MAX_DEEP_SLEEP_CBS 4
+
+/**
+ * @brief Called right before deep sleep starts, e.g. to park a radio or save state to RTC memory
+ */
+typedef void (*power_mgmt_deep_sleep_cb_t)(void);
+
 /**
  * @brief Initialize power management
  *
@@ -102,6 +121,78 @@ power_mode_t power_mgmt_get_recommended_mode(void);
  */
 esp_err_t power_mgmt_get_stats(power_stats_t *stats);
 
+/**
+ * @brief Record a power-state transition for energy accounting
+ *
+ * Cheap enough for hot paths (spinlock + integer update). Ignored before power_mgmt_init().
+ *
+ * @param component Component changing state
+ * @param state New state (energy_*_state_t of that component)
+ */
+void power_mgmt_record_state(energy_component_t component, uint8_t state);
+
+/**
+ * @brief Feed battery state into the energy model
+ *
+ * Updates remaining capacity and, on boards with a fuel gauge, calibrates the
+ * current model against the measured discharge current. Call periodically
+ * (every few seconds) from a task context.
+ *
+ * @param battery_percent Current state of charge
+ * @return ESP_OK if a calibration sample was applied, ESP_ERR_NOT_SUPPORTED without fuel gauge,
+ *         ESP_ERR_INVALID_ARG while charging, ESP_ERR_INVALID_STATE if the sample window is too short
+ */
+esp_err_t power_mgmt_energy_sample(uint8_t battery_percent);
+
+/**
+ * @brief Get per-component residency, average current and projected battery life
+ *
+ * @param report Output report
+ * @return ESP_OK on success
+ */
+esp_err_t power_mgmt_get_energy_report(energy_report_t *report);
+
+/**
+ * @brief Register a task or driver with the sleep orchestrator
+ *
+ * Declares the wake sources the client relies on so the audit in power:stats
+ * shows every periodic wakeup. Registering the same name again returns the
+ * existing client. Safe to call before power_mgmt_init().
+ *
+ * @param name Short client name (< SLEEP_POLICY_NAME_LEN)
+ * @param wake_sources sleep_wake_source_t bitmask
+ * @param wake_period_ms Polling period if the client wakes periodically, 0 if purely event driven
+ * @param client Output client id
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if the client table is full
+ */
+esp_err_t power_mgmt_sleep_register(const char *name, uint8_t wake_sources, uint32_t wake_period_ms, int *client);
+
+/**
+ * @brief Keep the system out of automatic light sleep (nestable)
+ *
+ * Use only for work whose clocks or timing do not survive light sleep.
+ *
+ * @param client Client id from power_mgmt_sleep_register()
+ * @return ESP_OK on success
+ */
+esp_err_t power_mgmt_sleep_block(int client);
+
+/**
+ * @brief Release one power_mgmt_sleep_block()
+ *
+ * @param client Client id from power_mgmt_sleep_register()
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if the client is not blocking
+ */
+esp_err_t power_mgmt_sleep_allow(int client);
+
+/**
+ * @brief Get sleep clients, current blocker and light sleep residency
+ *
+ * @param report Output report
+ * @return ESP_OK on success
+ */
+esp_err_t power_mgmt_get_sleep_report(power_sleep_report_t *report);
+
 /**
  * @brief Set CPU frequency for power optimization
  *
@@ -120,10 +211,21 @@ esp_sleep_wakeup_cause_t power_mgmt_get_wake_cause(void);
 /**
  * @brief Prepare system for sleep (disable peripherals)
  *
+ * Runs the registered deep sleep callbacks in registration order.
+ *
  * @return ESP_OK on success
  */
 esp_err_t power_mgmt_prepare_sleep(void);
 
+/**
+ * @brief Register a callback for power_mgmt_prepare_sleep()
+ *
+ * Registering the same callback twice is a no-op.
+ *
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if all slots are taken
+ */
+esp_err_t power_mgmt_register_deep_sleep_cb(power_mgmt_deep_sleep_cb_t cb);
+
 #ifdef __cplusplus
 }
 #endif
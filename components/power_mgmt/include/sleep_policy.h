@@ -0,0 +1,130 @@
+/**
+ * @file sleep_policy.h
+ * @brief Wake-source declarations and sleep-blocker accounting
+ *
+ * CONTEXT: Automatic light sleep only pays off if nothing wakes the CPU without cause
+ * PURPOSE: Every task that can keep the system awake registers as a client, declares
+ *          the wake sources it relies on (and its polling period, if any), and brackets
+ *          sections that must not sleep with block/allow. The policy answers whether
+ *          sleep is currently allowed and which client prevented it, and for how long.
+ * USAGE: Pure C, caller provides timestamps and serialization (see power_mgmt)
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SLEEP_POLICY_MAX_CLIENTS 16
+#define SLEEP_POLICY_NAME_LEN 16
+
+/**
+ * @brief Wake sources a client depends on (bitmask)
+ */
+typedef enum {
+    SLEEP_WAKE_GPIO  = (1 << 0), ///< Button level interrupt
+    SLEEP_WAKE_TIMER = (1 << 1), ///< Periodic task or esp_timer
+    SLEEP_WAKE_UART  = (1 << 2), ///< UART RX activity
+    SLEEP_WAKE_RADIO = (1 << 3), ///< SX126x DIO1 interrupt
+    SLEEP_WAKE_USB   = (1 << 4), ///< USB bus activity (host connected)
+} sleep_wake_source_t;
+
+#define SLEEP_WAKE_SOURCE_COUNT 5
+
+/**
+ * @brief One registered client
+ */
+typedef struct {
+    char name[SLEEP_POLICY_NAME_LEN];
+    uint8_t wake_sources;    ///< sleep_wake_source_t bitmask
+    uint32_t wake_period_ms; ///< Periodic wake interval, 0 if purely event driven
+    uint16_t block_depth;    ///< Nested block() calls outstanding
+    uint64_t blocked_since_us;
+    uint64_t blocked_us;  ///< Completed blocking time
+    uint32_t block_count; ///< Times this client started blocking
+} sleep_client_t;
+
+/**
+ * @brief Policy state (one instance per device)
+ */
+typedef struct {
+    sleep_client_t clients[SLEEP_POLICY_MAX_CLIENTS];
+    uint8_t count;
+    uint8_t blocking; ///< Clients with block_depth > 0
+    uint64_t any_blocked_since_us;
+    uint64_t any_blocked_us; ///< Completed time with at least one blocker
+} sleep_policy_t;
+
+/**
+ * @brief Initialize an empty policy
+ */
+void sleep_policy_init(sleep_policy_t *policy);
+
+/**
+ * @brief Register a client, or return the existing one with the same name
+ *
+ * Re-registering updates the declared wake sources and period.
+ *
+ * @param id Output client id
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if the table is full, ESP_ERR_INVALID_ARG for bad name
+ */
+esp_err_t sleep_policy_register(sleep_policy_t *policy, const char *name, uint8_t wake_sources,
+                                uint32_t wake_period_ms, int *id);
+
+/**
+ * @brief Start (or nest) a section in which the system must not sleep
+ */
+esp_err_t sleep_policy_block(sleep_policy_t *policy, int id, uint64_t now_us);
+
+/**
+ * @brief End one block() section
+ *
+ * @return ESP_ERR_INVALID_STATE if the client is not blocking
+ */
+esp_err_t sleep_policy_allow(sleep_policy_t *policy, int id, uint64_t now_us);
+
+/**
+ * @brief True if no client is blocking
+ */
+bool sleep_policy_can_sleep(const sleep_policy_t *policy);
+
+/**
+ * @brief Client that has been blocking the longest, -1 if none
+ */
+int sleep_policy_blocker(const sleep_policy_t *policy);
+
+/**
+ * @brief Union of all declared wake sources
+ */
+uint8_t sleep_policy_wake_sources(const sleep_policy_t *policy);
+
+/**
+ * @brief Shortest declared periodic wake interval, 0 if every client is event driven
+ *
+ * @param id Output client with that period (may be NULL), -1 if none
+ */
+uint32_t sleep_policy_min_wake_period_ms(const sleep_policy_t *policy, int *id);
+
+/**
+ * @brief Blocking time of one client including the ongoing interval
+ */
+uint64_t sleep_policy_blocked_us(const sleep_policy_t *policy, int id, uint64_t now_us);
+
+/**
+ * @brief Time with at least one blocker including the ongoing interval
+ */
+uint64_t sleep_policy_any_blocked_us(const sleep_policy_t *policy, uint64_t now_us);
+
+/**
+ * @brief Wake source name for logs and JSON ("gpio", "timer", ...), NULL for unknown bits
+ */
+const char *sleep_policy_wake_source_name(uint8_t source);
+
+#ifdef __cplusplus
+}
+#endif
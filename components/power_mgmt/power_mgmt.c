@@ -8,6 +8,7 @@
 
 #include "power_mgmt.h"
 #include "bsp.h"
+#include "energy_model.h"
 #include "driver/gpio.h"
 #include "driver/rtc_io.h"
 #include "driver/spi_master.h"
@@ -32,6 +33,23 @@ static uint64_t last_activity_time   = 0;
 static uint64_t session_start_time   = 0;
 static bool display_sleeping         = false;
 
+// Energy accounting (transitions arrive from several tasks, updates are a few integer ops)
+static energy_model_t energy_model;
+static portMUX_TYPE energy_lock    = portMUX_INITIALIZER_UNLOCKED;
+static bool energy_model_ready     = false;
+static float battery_remaining_mah = 0.0f;
+
+// Sleep orchestration: each client maps to an ESP_PM_NO_LIGHT_SLEEP lock held while it blocks
+static sleep_policy_t sleep_policy;
+static esp_pm_lock_handle_t sleep_locks[SLEEP_POLICY_MAX_CLIENTS];
+static portMUX_TYPE sleep_lock    = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t light_sleep_count = 0;
+static uint64_t light_sleep_us    = 0;
+
+// Components that retain state across deep sleep (radio warm start, RTC snapshots)
+static power_mgmt_deep_sleep_cb_t deep_sleep_cbs[POWER_MGMT_MAX_DEEP_SLEEP_CBS];
+static uint8_t deep_sleep_cb_count = 0;
+
 // Default timeout constants
 #define POWER_MGMT_DEFAULT_DISPLAY_SLEEP_MS 10000 // 10 seconds
 #define POWER_MGMT_DEFAULT_LIGHT_SLEEP_MS 30000   // 30 seconds
@@ -40,10 +58,7 @@ static bool display_sleeping         = false;
 #define CPU_FREQ_MIN_MHZ 10
 #define MS_TO_US 1000ULL
 #define BATTERY_CAPACITY_MAH 1000.0f
-#define CURRENT_ACTIVE_MA 10.0f
-#define CURRENT_DISPLAY_SLEEP_MA 8.0f
-#define CURRENT_LIGHT_SLEEP_MA 1.0f
-#define CURRENT_DEEP_SLEEP_MA 0.01f
+#define UA_PER_MA 1000
 
 // Default configuration
 static const power_config_t default_config = {
@@ -56,6 +71,26 @@ static const power_config_t default_config = {
     .cpu_freq_mhz              = CPU_FREQ_DEFAULT_MHZ, // 80MHz for power efficiency
 };
 
+#if CONFIG_PM_LIGHT_SLEEP_CALLBACKS
+// Called from the idle task around automatic light sleep, inside the PM critical section
+static esp_err_t light_sleep_enter_cb(int64_t sleep_time_us, void *arg)
+{
+    power_mgmt_record_state(ENERGY_COMPONENT_CPU, ENERGY_CPU_LIGHT_SLEEP);
+    return ESP_OK;
+}
+
+static esp_err_t light_sleep_exit_cb(int64_t sleep_time_us, void *arg)
+{
+    power_mgmt_record_state(ENERGY_COMPONENT_CPU, ENERGY_CPU_ACTIVE);
+
+    taskENTER_CRITICAL(&sleep_lock);
+    light_sleep_count++;
+    light_sleep_us += (sleep_time_us > 0) ? (uint64_t)sleep_time_us : 0;
+    taskEXIT_CRITICAL(&sleep_lock);
+    return ESP_OK;
+}
+#endif
+
 esp_err_t power_mgmt_init(const power_config_t *config)
 {
     ESP_LOGI(TAG, "Initializing power management");
@@ -98,10 +133,32 @@ esp_err_t power_mgmt_init(const power_config_t *config)
     };
     gpio_config(&wake_gpio_config);
 
+    // Pins armed with gpio_wakeup_enable() (buttons, radio DIO1) end automatic light sleep
+    if (current_config.enable_auto_light_sleep) {
+        esp_sleep_enable_gpio_wakeup();
+    }
+
+#if CONFIG_PM_LIGHT_SLEEP_CALLBACKS
+    esp_pm_sleep_cbs_register_config_t sleep_cbs = {
+        .enter_cb = light_sleep_enter_cb,
+        .exit_cb  = light_sleep_exit_cb,
+    };
+    ret = esp_pm_light_sleep_register_cbs(&sleep_cbs);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Light sleep callbacks unavailable: %s", esp_err_to_name(ret));
+    }
+#endif
+
     // Initialize timestamps
     last_activity_time = esp_timer_get_time();
     session_start_time = last_activity_time;
 
+    if (!energy_model_ready) {
+        energy_model_init(&energy_model, last_activity_time);
+        battery_remaining_mah = BATTERY_CAPACITY_MAH;
+        energy_model_ready    = true;
+    }
+
     // Check wake cause
     esp_sleep_wakeup_cause_t wake_cause = esp_sleep_get_wakeup_cause();
     switch (wake_cause) {
@@ -144,6 +201,7 @@ esp_err_t power_mgmt_display_sleep(void)
         power_stats.display_sleep_time_ms += (current_time - last_activity_time) / 1000;
 
         display_safe_sleep();
+        power_mgmt_record_state(ENERGY_COMPONENT_DISPLAY, ENERGY_DISPLAY_OFF);
     }
 
     return ESP_OK;
@@ -158,6 +216,7 @@ esp_err_t power_mgmt_light_sleep(uint32_t timeout_ms)
     ESP_LOGI(TAG, "Entering light sleep for %dms", timeout_ms);
 
     display_sleeping = true;
+    power_mgmt_record_state(ENERGY_COMPONENT_DISPLAY, ENERGY_DISPLAY_OFF);
 
     uint64_t sleep_start = esp_timer_get_time();
 
@@ -172,7 +231,9 @@ esp_err_t power_mgmt_light_sleep(uint32_t timeout_ms)
     // Enable UART wake
     esp_sleep_enable_uart_wakeup(UART_NUM_0);
 
+    power_mgmt_record_state(ENERGY_COMPONENT_CPU, ENERGY_CPU_LIGHT_SLEEP);
     esp_err_t ret = esp_light_sleep_start();
+    power_mgmt_record_state(ENERGY_COMPONENT_CPU, ENERGY_CPU_ACTIVE);
 
     uint64_t sleep_end      = esp_timer_get_time();
     uint32_t sleep_duration = (sleep_end - sleep_start) / 1000;
@@ -228,6 +289,7 @@ esp_err_t power_mgmt_update_activity(void)
     if (display_sleeping) {
         display_sleeping = false;
         display_safe_wake();
+        power_mgmt_record_state(ENERGY_COMPONENT_DISPLAY, ENERGY_DISPLAY_ON);
     }
 
     return ESP_OK;
@@ -272,16 +334,153 @@ esp_err_t power_mgmt_get_stats(power_stats_t *stats)
     *stats = power_stats;
     stats->active_time_ms += current_session_ms;
 
-    // Estimate battery life (rough calculation)
-    // Assumptions: 1000mAh battery, 10mA active, 8mA display sleep, 1mA light sleep, 0.01mA deep sleep
-    float avg_current_ma =
-        (stats->active_time_ms * CURRENT_ACTIVE_MA + stats->display_sleep_time_ms * CURRENT_DISPLAY_SLEEP_MA +
-         stats->light_sleep_time_ms * CURRENT_LIGHT_SLEEP_MA + stats->deep_sleep_time_ms * CURRENT_DEEP_SLEEP_MA) /
-        (stats->active_time_ms + stats->display_sleep_time_ms + stats->light_sleep_time_ms + stats->deep_sleep_time_ms +
-         1);
+    // Battery life from measured state residency (calibrated against the fuel gauge if present)
+    energy_report_t report;
+    power_mgmt_get_energy_report(&report);
+    stats->estimated_battery_hours = report.projected_hours;
+
+    return ESP_OK;
+}
+
+void power_mgmt_record_state(energy_component_t component, uint8_t state)
+{
+    if (!energy_model_ready) {
+        return;
+    }
+
+    uint64_t now = esp_timer_get_time();
+    taskENTER_CRITICAL(&energy_lock);
+    energy_model_set_state(&energy_model, component, state, now);
+    taskEXIT_CRITICAL(&energy_lock);
+}
+
+esp_err_t power_mgmt_energy_sample(uint8_t battery_percent)
+{
+    if (!energy_model_ready) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    float remaining_mah = BATTERY_CAPACITY_MAH * (battery_percent > 100 ? 100 : battery_percent) / 100.0f;
+
+    int16_t current_ma;
+    esp_err_t ret = bsp_battery_get_current_ma(&current_ma);
+
+    taskENTER_CRITICAL(&energy_lock);
+    battery_remaining_mah = remaining_mah;
+    taskEXIT_CRITICAL(&energy_lock);
+
+    if (ret != ESP_OK) {
+        return ret; // No fuel gauge, or the read failed: a 0 mA sample would skew the model
+    }
+
+    // Gauge reports discharge as negative current; copy out so float math runs outside the spinlock
+    energy_model_t model;
+    uint64_t now = esp_timer_get_time();
+    taskENTER_CRITICAL(&energy_lock);
+    model = energy_model;
+    taskEXIT_CRITICAL(&energy_lock);
+
+    ret = energy_model_calibrate(&model, -(int32_t)current_ma * UA_PER_MA, now);
+
+    taskENTER_CRITICAL(&energy_lock);
+    energy_model.scale                   = model.scale;
+    energy_model.calibration_samples     = model.calibration_samples;
+    energy_model.last_measured_ua        = model.last_measured_ua;
+    energy_model.cal_window_start_us     = model.cal_window_start_us;
+    energy_model.cal_window_start_charge = model.cal_window_start_charge;
+    taskEXIT_CRITICAL(&energy_lock);
+
+    if (ret == ESP_OK) {
+        ESP_LOGD(TAG, "Energy model calibrated: measured %dmA, scale %.2f", -current_ma, model.scale);
+    }
+    return ret;
+}
+
+esp_err_t power_mgmt_get_energy_report(energy_report_t *report)
+{
+    if (!report) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!energy_model_ready) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    energy_model_t model;
+    taskENTER_CRITICAL(&energy_lock);
+    model               = energy_model;
+    float remaining_mah = battery_remaining_mah;
+    taskEXIT_CRITICAL(&energy_lock);
+
+    energy_model_report(&model, esp_timer_get_time(), remaining_mah, report);
+    return ESP_OK;
+}
+
+esp_err_t power_mgmt_sleep_register(const char *name, uint8_t wake_sources, uint32_t wake_period_ms, int *client)
+{
+    taskENTER_CRITICAL(&sleep_lock);
+    esp_err_t ret   = sleep_policy_register(&sleep_policy, name, wake_sources, wake_period_ms, client);
+    bool needs_lock = (ret == ESP_OK && sleep_locks[*client] == NULL);
+    taskEXIT_CRITICAL(&sleep_lock);
+
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register sleep client %s: %s", name ? name : "(null)", esp_err_to_name(ret));
+        return ret;
+    }
+
+    if (needs_lock) {
+        // Lock name must outlive the lock; the policy table is static
+        esp_pm_lock_handle_t lock = NULL;
+        if (esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, sleep_policy.clients[*client].name, &lock) == ESP_OK) {
+            sleep_locks[*client] = lock;
+        } else {
+            ESP_LOGW(TAG, "No PM lock for sleep client %s (accounting only)", name);
+        }
+    }
+
+    ESP_LOGD(TAG, "Sleep client %s: wake sources 0x%02x, period %lums", name, wake_sources,
+             (unsigned long)wake_period_ms);
+    return ESP_OK;
+}
+
+esp_err_t power_mgmt_sleep_block(int client)
+{
+    uint64_t now = esp_timer_get_time();
+    taskENTER_CRITICAL(&sleep_lock);
+    esp_err_t ret = sleep_policy_block(&sleep_policy, client, now);
+    taskEXIT_CRITICAL(&sleep_lock);
+
+    if (ret == ESP_OK && sleep_locks[client]) {
+        esp_pm_lock_acquire(sleep_locks[client]);
+    }
+    return ret;
+}
+
+esp_err_t power_mgmt_sleep_allow(int client)
+{
+    uint64_t now = esp_timer_get_time();
+    taskENTER_CRITICAL(&sleep_lock);
+    esp_err_t ret = sleep_policy_allow(&sleep_policy, client, now);
+    taskEXIT_CRITICAL(&sleep_lock);
+
+    if (ret == ESP_OK && sleep_locks[client]) {
+        esp_pm_lock_release(sleep_locks[client]);
+    }
+    return ret;
+}
+
+esp_err_t power_mgmt_get_sleep_report(power_sleep_report_t *report)
+{
+    if (!report) {
+        return ESP_ERR_INVALID_ARG;
+    }
 
-    stats->estimated_battery_hours = BATTERY_CAPACITY_MAH / avg_current_ma; // mAh / mA = hours
+    taskENTER_CRITICAL(&sleep_lock);
+    report->policy            = sleep_policy;
+    report->light_sleep_count = light_sleep_count;
+    report->light_sleep_us    = light_sleep_us;
+    taskEXIT_CRITICAL(&sleep_lock);
 
+    report->now_us = esp_timer_get_time();
     return ESP_OK;
 }
 
@@ -323,10 +522,32 @@ esp_err_t power_mgmt_prepare_sleep(void)
 
     // Note: Peripherals will be powered down by deep sleep
     // No need to manually free buses - device will reboot on wake
+    for (uint8_t i = 0; i < deep_sleep_cb_count; i++) {
+        deep_sleep_cbs[i]();
+    }
 
     ESP_LOGD(TAG, "System prepared for deep sleep");
     return ESP_OK;
 }
 
-// Note: After deep sleep, device reboots and main() reinitializes everything
-// No restore function needed
+esp_err_t power_mgmt_register_deep_sleep_cb(power_mgmt_deep_sleep_cb_t cb)
+{
+    if (!cb) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    for (uint8_t i = 0; i < deep_sleep_cb_count; i++) {
+        if (deep_sleep_cbs[i] == cb) {
+            return ESP_OK;
+        }
+    }
+    if (deep_sleep_cb_count >= POWER_MGMT_MAX_DEEP_SLEEP_CBS) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    deep_sleep_cbs[deep_sleep_cb_count++] = cb;
+    return ESP_OK;
+}
+
+// Note: After deep sleep, device reboots and main() reinitializes everything.
+// State registered callbacks saved to RTC memory lets fast_resume transmit first.
@@ -0,0 +1,169 @@
+/**
+ * @file sleep_policy.c
+ * @brief Wake-source declarations and sleep-blocker accounting
+ */
+
+#include "sleep_policy.h"
+#include <string.h>
+
+static const char *const wake_source_names[SLEEP_WAKE_SOURCE_COUNT] = {"gpio", "timer", "uart", "radio", "usb"};
+
+static bool valid_id(const sleep_policy_t *policy, int id)
+{
+    return id >= 0 && id < policy->count;
+}
+
+void sleep_policy_init(sleep_policy_t *policy)
+{
+    memset(policy, 0, sizeof(*policy));
+}
+
+esp_err_t sleep_policy_register(sleep_policy_t *policy, const char *name, uint8_t wake_sources,
+                                uint32_t wake_period_ms, int *id)
+{
+    if (!name || !id || name[0] == '\0' || strlen(name) >= SLEEP_POLICY_NAME_LEN) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    for (int i = 0; i < policy->count; i++) {
+        if (strcmp(policy->clients[i].name, name) == 0) {
+            policy->clients[i].wake_sources   = wake_sources;
+            policy->clients[i].wake_period_ms = wake_period_ms;
+            *id                               = i;
+            return ESP_OK;
+        }
+    }
+
+    if (policy->count >= SLEEP_POLICY_MAX_CLIENTS) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    sleep_client_t *client = &policy->clients[policy->count];
+    memset(client, 0, sizeof(*client));
+    strcpy(client->name, name);
+    client->wake_sources   = wake_sources;
+    client->wake_period_ms = wake_period_ms;
+
+    *id = policy->count++;
+    return ESP_OK;
+}
+
+esp_err_t sleep_policy_block(sleep_policy_t *policy, int id, uint64_t now_us)
+{
+    if (!valid_id(policy, id)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    sleep_client_t *client = &policy->clients[id];
+    if (client->block_depth++ > 0) {
+        return ESP_OK;
+    }
+
+    client->blocked_since_us = now_us;
+    client->block_count++;
+    if (policy->blocking++ == 0) {
+        policy->any_blocked_since_us = now_us;
+    }
+    return ESP_OK;
+}
+
+esp_err_t sleep_policy_allow(sleep_policy_t *policy, int id, uint64_t now_us)
+{
+    if (!valid_id(policy, id)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    sleep_client_t *client = &policy->clients[id];
+    if (client->block_depth == 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (--client->block_depth > 0) {
+        return ESP_OK;
+    }
+
+    // Timestamps from different tasks may arrive slightly out of order
+    if (now_us > client->blocked_since_us) {
+        client->blocked_us += now_us - client->blocked_since_us;
+    }
+    if (--policy->blocking == 0 && now_us > policy->any_blocked_since_us) {
+        policy->any_blocked_us += now_us - policy->any_blocked_since_us;
+    }
+    return ESP_OK;
+}
+
+bool sleep_policy_can_sleep(const sleep_policy_t *policy)
+{
+    return policy->blocking == 0;
+}
+
+int sleep_policy_blocker(const sleep_policy_t *policy)
+{
+    int blocker = -1;
+    for (int i = 0; i < policy->count; i++) {
+        const sleep_client_t *client = &policy->clients[i];
+        if (client->block_depth > 0 &&
+            (blocker < 0 || client->blocked_since_us < policy->clients[blocker].blocked_since_us)) {
+            blocker = i;
+        }
+    }
+    return blocker;
+}
+
+uint8_t sleep_policy_wake_sources(const sleep_policy_t *policy)
+{
+    uint8_t sources = 0;
+    for (int i = 0; i < policy->count; i++) {
+        sources |= policy->clients[i].wake_sources;
+    }
+    return sources;
+}
+
+uint32_t sleep_policy_min_wake_period_ms(const sleep_policy_t *policy, int *id)
+{
+    uint32_t period = 0;
+    int owner       = -1;
+    for (int i = 0; i < policy->count; i++) {
+        uint32_t p = policy->clients[i].wake_period_ms;
+        if (p > 0 && (period == 0 || p < period)) {
+            period = p;
+            owner  = i;
+        }
+    }
+    if (id) {
+        *id = owner;
+    }
+    return period;
+}
+
+uint64_t sleep_policy_blocked_us(const sleep_policy_t *policy, int id, uint64_t now_us)
+{
+    if (!valid_id(policy, id)) {
+        return 0;
+    }
+
+    const sleep_client_t *client = &policy->clients[id];
+    uint64_t blocked             = client->blocked_us;
+    if (client->block_depth > 0 && now_us > client->blocked_since_us) {
+        blocked += now_us - client->blocked_since_us;
+    }
+    return blocked;
+}
+
+uint64_t sleep_policy_any_blocked_us(const sleep_policy_t *policy, uint64_t now_us)
+{
+    uint64_t blocked = policy->any_blocked_us;
+    if (policy->blocking > 0 && now_us > policy->any_blocked_since_us) {
+        blocked += now_us - policy->any_blocked_since_us;
+    }
+    return blocked;
+}
+
+const char *sleep_policy_wake_source_name(uint8_t source)
+{
+    for (int i = 0; i < SLEEP_WAKE_SOURCE_COUNT; i++) {
+        if (source == (1 << i)) {
+            return wake_source_names[i];
+        }
+    }
+    return NULL;
+}
@@ -31,6 +31,14 @@ esp_err_t presenter_mode_manager_init(void);
  */
 esp_err_t presenter_mode_manager_handle_input(input_event_t event);
 
+/**
+ * @brief HID keycode an input event sends in presenter mode
+ *
+ * @param event Type of input event
+ * @return Keycode, 0 if the event sends nothing over LoRa
+ */
+uint8_t presenter_mode_manager_get_keycode(input_event_t event);
+
 /**
  * @brief Deinitialize presenter mode manager
  */
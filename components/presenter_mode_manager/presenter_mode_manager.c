@@ -30,6 +30,25 @@ esp_err_t presenter_mode_manager_init(void)
     return ESP_OK;
 }
 
+uint8_t presenter_mode_manager_get_keycode(input_event_t event)
+{
+    switch (event) {
+        // Alpha: short press = next slide
+        // Alpha+: NEXT button short press = next slide (same event)
+        case INPUT_EVENT_NEXT_SHORT:
+            return HID_KEY_ARROW_RIGHT;
+
+        // Alpha: double press = prev slide
+        // Alpha+: PREV button short press = prev slide
+        case INPUT_EVENT_NEXT_DOUBLE:
+        case INPUT_EVENT_PREV_SHORT:
+            return HID_KEY_ARROW_LEFT;
+
+        default:
+            return 0;
+    }
+}
+
 esp_err_t presenter_mode_manager_handle_input(input_event_t event)
 {
     if (!state_mutex) {
@@ -42,45 +61,24 @@ esp_err_t presenter_mode_manager_handle_input(input_event_t event)
     general_config_t config;
     config_manager_get_general(&config);
 
-    esp_err_t ret = ESP_OK;
+    esp_err_t ret   = ESP_OK;
+    uint8_t keycode = presenter_mode_manager_get_keycode(event);
 
-    switch (event) {
-        // Alpha: short press = next slide
-        case INPUT_EVENT_NEXT_SHORT:
-            // Alpha+: NEXT button short press = next slide (same event)
-            ESP_LOGI(TAG, "Next slide - sending Cursor Right");
-#ifdef CONFIG_LORACUE_LORA_SEND_RELIABLE
-            ret = lora_protocol_send_keyboard_reliable(config.slot_id, 0, HID_KEY_ARROW_RIGHT, LORA_RELIABLE_TIMEOUT_MS,
-                                                       LORA_RELIABLE_MAX_RETRIES);
-#else
-            ret = lora_protocol_send_keyboard(config.slot_id, 0, HID_KEY_ARROW_RIGHT);
-#endif
-            break;
-
-        // Alpha: long press = menu (handled by UI)
-        case INPUT_EVENT_NEXT_LONG:
-        // Alpha+: encoder button = menu (handled by UI)
-        case INPUT_EVENT_ENCODER_BUTTON_SHORT:
-            ESP_LOGI(TAG, "Menu button - no LoRa transmission");
-            break;
-
-        // Alpha: double press = prev slide
-        case INPUT_EVENT_NEXT_DOUBLE:
-        // Alpha+: PREV button short press = prev slide
-        case INPUT_EVENT_PREV_SHORT:
-            ESP_LOGI(TAG, "Previous slide - sending Cursor Left");
+    if (keycode) {
+        ESP_LOGI(TAG, "%s slide - sending Cursor %s", keycode == HID_KEY_ARROW_RIGHT ? "Next" : "Previous",
+                 keycode == HID_KEY_ARROW_RIGHT ? "Right" : "Left");
 #ifdef CONFIG_LORACUE_LORA_SEND_RELIABLE
-            ret = lora_protocol_send_keyboard_reliable(config.slot_id, 0, HID_KEY_ARROW_LEFT, LORA_RELIABLE_TIMEOUT_MS,
-                                                       LORA_RELIABLE_MAX_RETRIES);
+        ret = lora_protocol_send_keyboard_reliable(config.slot_id, 0, keycode, LORA_RELIABLE_TIMEOUT_MS,
+                                                   LORA_RELIABLE_MAX_RETRIES);
 #else
-            ret = lora_protocol_send_keyboard(config.slot_id, 0, HID_KEY_ARROW_LEFT);
+        ret = lora_protocol_send_keyboard(config.slot_id, 0, keycode);
 #endif
-            break;
-
-        default:
-            ESP_LOGW(TAG, "Unknown input event: %d", event);
-            ret = ESP_ERR_INVALID_ARG;
-            break;
+    } else if (event == INPUT_EVENT_NEXT_LONG || event == INPUT_EVENT_ENCODER_BUTTON_SHORT) {
+        // Alpha: long press = menu, Alpha+: encoder button = menu (handled by UI)
+        ESP_LOGI(TAG, "Menu button - no LoRa transmission");
+    } else {
+        ESP_LOGW(TAG, "Unknown input event: %d", event);
+        ret = ESP_ERR_INVALID_ARG;
     }
 
     xSemaphoreGive(state_mutex);
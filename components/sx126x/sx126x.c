@@ -7,7 +7,9 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
+#include "esp_attr.h"
 #include "esp_log.h"
+#include "esp_rom_sys.h"
 #include <driver/gpio.h>
 #include <driver/spi_master.h>
 
@@ -26,6 +28,12 @@
 #define RX_TIMEOUT_INF 0xFFFFFF
 #define RX_CHECK_RETRY_COUNT 10
 #define RX_CHECK_DELAY_MS 1
+#define BUSY_SPIN_US 500       // Most commands finish well inside this; spinning avoids a 10 ms tick
+#define WARM_WAKE_SPIN_US 5000 // Warm start wake-up takes ~340 us plus TCXO startup
+#define TX_POLL_INTERVAL_US 100
+
+// Events routed to DIO1 when a task has asked for interrupt-driven operation
+#define DIO1_IRQ_MASK (SX126X_IRQ_RX_DONE | SX126X_IRQ_TX_DONE | SX126X_IRQ_TIMEOUT)
 
 // SPI Stuff
 #if CONFIG_LORACUE_SX126X_SPI2_HOST
@@ -44,6 +52,8 @@ typedef struct {
     gpio_num_t busy_pin;
     gpio_num_t txen_pin;
     gpio_num_t rxen_pin;
+    gpio_num_t dio1_pin;
+    TaskHandle_t irq_task; // Notified from the DIO1 ISR, NULL while polling
     uint8_t packet_params[6];
     bool tx_active;
     int tx_lost;
@@ -53,6 +63,21 @@ typedef struct {
 // Global handle (single instance)
 static sx126x_handle_internal_t *s_sx126x = NULL;
 
+// The radio keeps its configuration in warm-start sleep, only the packet params live on our side
+static RTC_DATA_ATTR uint8_t s_warm_packet_params[6];
+static RTC_DATA_ATTR bool s_warm_sleep = false;
+
+static bool busy_spin(uint32_t max_us)
+{
+    for (uint32_t us = 0; us < max_us; us++) {
+        if (gpio_get_level(s_sx126x->busy_pin) == 0) {
+            return true;
+        }
+        esp_rom_delay_us(1);
+    }
+    return gpio_get_level(s_sx126x->busy_pin) == 0;
+}
+
 esp_err_t sx126x_init(void)
 {
     if (s_sx126x != NULL) {
@@ -94,6 +119,7 @@ esp_err_t sx126x_init(void)
     ESP_LOGI(TAG, "NSS_GPIO=%d", pins->cs);
     ESP_LOGI(TAG, "RST_GPIO=%d", pins->rst);
     ESP_LOGI(TAG, "BUSY_GPIO=%d", pins->busy);
+    ESP_LOGI(TAG, "DIO1_GPIO=%d", pins->dio1);
     ESP_LOGI(TAG, "TXEN_GPIO=%d", -1);
     ESP_LOGI(TAG, "RXEN_GPIO=%d", -1);
 
@@ -102,14 +128,21 @@ esp_err_t sx126x_init(void)
     s_sx126x->busy_pin  = pins->busy;
     s_sx126x->txen_pin  = -1;
     s_sx126x->rxen_pin  = -1;
+    s_sx126x->dio1_pin  = pins->dio1;
     s_sx126x->tx_active = false;
     s_sx126x->tx_lost   = 0;
 
+    // Pins may still be latched from sx126x_sleep_warm(); drive them high before enabling
+    // the outputs so a warm-sleeping radio is not reset
+    gpio_hold_dis(s_sx126x->nss_pin);
+    gpio_hold_dis(s_sx126x->reset_pin);
+
     gpio_reset_pin(s_sx126x->nss_pin);
-    gpio_set_direction(s_sx126x->nss_pin, GPIO_MODE_OUTPUT);
     gpio_set_level(s_sx126x->nss_pin, 1);
+    gpio_set_direction(s_sx126x->nss_pin, GPIO_MODE_OUTPUT);
 
     gpio_reset_pin(s_sx126x->reset_pin);
+    gpio_set_level(s_sx126x->reset_pin, 1);
     gpio_set_direction(s_sx126x->reset_pin, GPIO_MODE_OUTPUT);
 
     gpio_reset_pin(s_sx126x->busy_pin);
@@ -260,6 +293,7 @@ esp_err_t sx126x_begin(uint32_t frequencyInHz, int8_t txPowerInDbm, float tcxoVo
         txPowerInDbm = -3;
 
     Reset();
+    s_warm_sleep = false; // Reset discards any retained configuration
 
     uint8_t wk[2];
     ReadRegister(SX126X_REG_LORA_SYNC_WORD_MSB, wk, 2); // 0x0740
@@ -367,11 +401,11 @@ esp_err_t sx126x_config(uint8_t spreadingFactor, uint8_t bandwidth, uint8_t codi
 
     WriteCommand(SX126X_CMD_SET_PACKET_PARAMS, s_sx126x->packet_params, 6); // 0x8C
 
-    // Do not use DIO interruptst
-    SetDioIrqParams(SX126X_IRQ_ALL,  // all interrupts enabled
-                    SX126X_IRQ_NONE, // interrupts on DIO1
-                    SX126X_IRQ_NONE, // interrupts on DIO2
-                    SX126X_IRQ_NONE  // interrupts on DIO3
+    // DIO1 only carries completion events once interrupt-driven operation is enabled
+    SetDioIrqParams(SX126X_IRQ_ALL,                                     // all interrupts enabled
+                    s_sx126x->irq_task ? DIO1_IRQ_MASK : SX126X_IRQ_NONE, // interrupts on DIO1
+                    SX126X_IRQ_NONE,                                    // interrupts on DIO2
+                    SX126X_IRQ_NONE                                     // interrupts on DIO3
     );
 
     // Receive state no receive timeoout
@@ -452,16 +486,167 @@ esp_err_t sx126x_send(const uint8_t *pData, int16_t len, uint8_t mode)
     return ESP_OK;
 }
 
-void sx126x_check_tx_done(void)
+esp_err_t sx126x_wait_tx_done(uint32_t timeout_ms)
 {
     if (!s_sx126x || !s_sx126x->tx_active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uint16_t irqStatus = 0;
+    for (uint32_t waited_us = 0; waited_us < timeout_ms * 1000; waited_us += TX_POLL_INTERVAL_US) {
+        irqStatus = GetIrqStatus();
+        if (irqStatus & (SX126X_IRQ_TX_DONE | SX126X_IRQ_TIMEOUT)) {
+            break;
+        }
+        esp_rom_delay_us(TX_POLL_INTERVAL_US);
+    }
+
+    s_sx126x->tx_active       = false;
+    s_sx126x->last_irq_status = irqStatus;
+    ClearIrqStatus(SX126X_IRQ_ALL);
+
+    if (irqStatus & SX126X_IRQ_TX_DONE) {
+        return ESP_OK;
+    }
+    s_sx126x->tx_lost++;
+    return ESP_ERR_TIMEOUT;
+}
+
+esp_err_t sx126x_sleep_warm(void)
+{
+    if (!s_sx126x) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    SetStandby(SX126X_STANDBY_RC);
+    memcpy(s_warm_packet_params, s_sx126x->packet_params, sizeof(s_warm_packet_params));
+
+    // Raw write: BUSY stays high while the radio sleeps, WriteCommand() would wait for it
+    uint8_t buf[2] = {SX126X_CMD_SET_SLEEP, SX126X_SLEEP_START_WARM | SX126X_SLEEP_RTC_OFF};
+    spi_write_byte(buf, sizeof(buf));
+    s_warm_sleep = true;
+
+    // A floating NSS or RESET during deep sleep would wake or reset the radio
+    gpio_set_level(s_sx126x->nss_pin, 1);
+    gpio_hold_en(s_sx126x->nss_pin);
+    gpio_hold_en(s_sx126x->reset_pin);
+    gpio_deep_sleep_hold_en();
+
+    ESP_LOGI(TAG, "Radio in warm-start sleep");
+    return ESP_OK;
+}
+
+esp_err_t sx126x_resume_warm(void)
+{
+    if (!s_warm_sleep) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_warm_sleep = false;
+
+    esp_err_t ret = sx126x_init();
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    // Any NSS falling edge wakes the radio; the command itself is ignored
+    uint8_t nop = SX126X_CMD_NOP;
+    spi_write_byte(&nop, 1);
+    if (!busy_spin(WARM_WAKE_SPIN_US)) {
+        ESP_LOGW(TAG, "Radio did not wake from warm sleep");
+        return ESP_ERR_TIMEOUT;
+    }
+
+    // Configuration is only retained if the radio kept power; a cold radio reports GFSK
+    uint8_t packet_type[2];
+    ReadCommand(SX126X_CMD_GET_PACKET_TYPE, packet_type, 2);
+    if (packet_type[1] != SX126X_PACKET_TYPE_LORA) {
+        ESP_LOGW(TAG, "Radio lost its configuration (packet type 0x%02x)", packet_type[1]);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    memcpy(s_sx126x->packet_params, s_warm_packet_params, sizeof(s_sx126x->packet_params));
+    return ESP_OK;
+}
+
+void sx126x_check_tx_done(void)
+{
+    // Polling mode skips the SPI read while idle; with DIO1 a stale flag would retrigger the level interrupt
+    if (!s_sx126x || (!s_sx126x->tx_active && !s_sx126x->irq_task)) {
         return;
     }
 
     uint16_t irqStatus = GetIrqStatus();
     if ((irqStatus & SX126X_IRQ_TX_DONE) || (irqStatus & SX126X_IRQ_TIMEOUT)) {
-        s_sx126x->last_irq_status = irqStatus;
-        xSemaphoreGive(s_sx126x->tx_done_sem);
+        if (s_sx126x->irq_task) {
+            ClearIrqStatus(SX126X_IRQ_TX_DONE | SX126X_IRQ_TIMEOUT);
+        }
+        if (s_sx126x->tx_active) {
+            s_sx126x->last_irq_status = irqStatus;
+            xSemaphoreGive(s_sx126x->tx_done_sem);
+        }
+    }
+}
+
+static void dio1_isr_handler(void *arg)
+{
+    // Level interrupt: mask it until the task has read and cleared the radio IRQ flags
+    gpio_intr_disable(s_sx126x->dio1_pin);
+
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(s_sx126x->irq_task, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+esp_err_t sx126x_enable_dio1_irq(TaskHandle_t notify_task)
+{
+    if (!notify_task) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_sx126x) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (s_sx126x->dio1_pin < 0) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    gpio_config_t dio1_cfg = {
+        .pin_bit_mask = (1ULL << s_sx126x->dio1_pin),
+        .mode         = GPIO_MODE_INPUT,
+        .pull_up_en   = GPIO_PULLUP_DISABLE,
+        .pull_down_en = GPIO_PULLDOWN_ENABLE,
+        .intr_type    = GPIO_INTR_HIGH_LEVEL,
+    };
+    esp_err_t ret = gpio_config(&dio1_cfg);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    // ISR service may already be installed by another driver
+    ret = gpio_install_isr_service(0);
+    if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) {
+        return ret;
+    }
+
+    s_sx126x->irq_task = notify_task;
+    ret                = gpio_isr_handler_add(s_sx126x->dio1_pin, dio1_isr_handler, NULL);
+    if (ret != ESP_OK) {
+        s_sx126x->irq_task = NULL;
+        return ret;
+    }
+
+    // A packet arriving during automatic light sleep wakes the CPU
+    gpio_wakeup_enable(s_sx126x->dio1_pin, GPIO_INTR_HIGH_LEVEL);
+
+    SetDioIrqParams(SX126X_IRQ_ALL, DIO1_IRQ_MASK, SX126X_IRQ_NONE, SX126X_IRQ_NONE);
+
+    ESP_LOGI(TAG, "DIO1 interrupt enabled on GPIO%d", s_sx126x->dio1_pin);
+    return ESP_OK;
+}
+
+void sx126x_dio1_rearm(void)
+{
+    if (s_sx126x && s_sx126x->irq_task) {
+        gpio_intr_enable(s_sx126x->dio1_pin);
     }
 }
 
@@ -850,9 +1035,12 @@ void WaitForIdleBegin(unsigned long timeout, char *text)
 
 bool WaitForIdle(unsigned long timeout, char *text, bool stop)
 {
-    bool ret         = true;
+    bool ret = true;
+    if (busy_spin(BUSY_SPIN_US)) {
+        return ret;
+    }
+
     TickType_t start = xTaskGetTickCount();
-    // delayMicroseconds(1);
     while (xTaskGetTickCount() - start < (timeout / portTICK_PERIOD_MS)) {
         if (gpio_get_level(s_sx126x->busy_pin) == 0)
             break;
@@ -1037,7 +1225,7 @@ void ReadCommand(uint8_t cmd, uint8_t *data, uint8_t numBytes)
     if (data != NULL && numBytes)
         memcpy(data, &buf[1], numBytes);
 
-    // wait for BUSY to go low
-    vTaskDelay(1);
+    // wait for BUSY to go low (it rises up to 600 ns after NSS)
+    esp_rom_delay_us(1);
     WaitForIdle(BUSY_WAIT, "end ReadCommand", false);
 }
@@ -3,6 +3,8 @@
 
 #include "driver/spi_master.h"
 #include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 
 // SX126X physical layer properties
 #define XTAL_FREQ (double)32000000
@@ -359,6 +361,11 @@ esp_err_t sx126x_config(uint8_t spreadingFactor, uint8_t bandwidth, uint8_t codi
 esp_err_t sx126x_receive(uint8_t *pData, int16_t len, uint8_t *received);
 esp_err_t sx126x_send(const uint8_t *pData, int16_t len, uint8_t mode);
 void sx126x_check_tx_done(void);
+esp_err_t sx126x_enable_dio1_irq(TaskHandle_t notify_task); // Notify task on RX/TX done, wake from light sleep
+void sx126x_dio1_rearm(void);                                // Unmask DIO1 after check_tx_done() + receive()
+esp_err_t sx126x_wait_tx_done(uint32_t timeout_ms);          // Busy-poll an ASYNC send, usable before tasks run
+esp_err_t sx126x_sleep_warm(void);  // Warm-start sleep, config retained across ESP32 deep sleep
+esp_err_t sx126x_resume_warm(void); // Init SPI and wake without reset/calibration after deep sleep
 
 // Private function
 void spi_write_byte(uint8_t *Dataout, size_t DataLength);
@@ -9,6 +9,7 @@
 
 #include "bsp.h"
 #include "commands.h"
+#include "rpc_frame.h"
 #include "driver/uart.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
@@ -30,31 +31,43 @@ static const char *TAG = "UART_CMD";
 #define CMD_MAX_LENGTH 2048     // Max single command length
 #define RX_FLOW_CTRL_THRESH 100 // De-assert RTS when hardware FIFO reaches 100 bytes (max 127)
 #define UART_READ_TIMEOUT_MS 20
-#define CMD_QUEUE_TIMEOUT_MS 100
 #define UART_RX_TASK_STACK_SIZE 3072
 #define UART_RX_TASK_PRIORITY 10
-#define CMD_PROC_TASK_STACK_SIZE 4096
-#define CMD_PROC_TASK_PRIORITY 5
 
-static TaskHandle_t uart_rx_task_handle       = NULL;
-static TaskHandle_t cmd_processor_task_handle = NULL;
-static QueueHandle_t cmd_queue                = NULL;
-static bool uart_running                      = false;
-static SemaphoreHandle_t uart_tx_mutex        = NULL;
+static TaskHandle_t uart_rx_task_handle = NULL;
+static bool uart_running                = false;
+static SemaphoreHandle_t uart_tx_mutex  = NULL;
 
-static void send_response(const char *response)
+static void response_write(const char *data, size_t len, void *ctx)
 {
-    if (response && uart_tx_mutex) {
+    (void)ctx;
+    if (uart_tx_mutex) {
         xSemaphoreTake(uart_tx_mutex, portMAX_DELAY);
+        uart_write_bytes(uart_num, data, len);
+        xSemaphoreGive(uart_tx_mutex);
+    }
+}
+
+static void response_end(bool binary, void *ctx)
+{
+    if (!binary) {
+        response_write("\r\n", 2, ctx);
+    }
+}
 
-        uart_write_bytes(uart_num, response, strlen(response));
-        uart_write_bytes(uart_num, "\r\n", 2);
+static const command_route_t uart_route = {.write = response_write, .end = response_end, .link = RPC_LINK_UART};
 
-        xSemaphoreGive(uart_tx_mutex);
+static void on_message(char *msg, size_t len, bool binary, void *ctx)
+{
+    (void)ctx;
+    esp_err_t ret = binary ? commands_submit_frame(COMMAND_TRANSPORT_UART, msg, len)
+                           : commands_submit(COMMAND_TRANSPORT_UART, msg);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Command queue full, dropping %s request", binary ? "binary" : "JSON");
     }
 }
 
-// High-priority RX task: only reads UART and queues commands
+// High-priority RX task: only reads UART and submits commands to the worker pool
 static void uart_rx_task(void *pvParameters)
 {
     uint8_t data[256]; // Small buffer for fast processing
@@ -64,37 +77,16 @@ static void uart_rx_task(void *pvParameters)
         vTaskDelete(NULL);
         return;
     }
-    size_t line_pos = 0;
+    // Terminal-friendly line editing for JSON; binary frames bypass it
+    rpc_rx_t rx;
+    rpc_rx_init(&rx, line_buffer, CMD_MAX_LENGTH, true);
 
     ESP_LOGI(TAG, "UART RX task started (high priority)");
 
     while (uart_running) {
         int len = uart_read_bytes(uart_num, data, sizeof(data), pdMS_TO_TICKS(UART_READ_TIMEOUT_MS));
-
-        for (int i = 0; i < len; i++) {
-            char c = (char)data[i];
-
-            if (c == '\n' || c == '\r') {
-                if (line_pos > 0) {
-                    line_buffer[line_pos] = '\0';
-
-                    // Allocate command string for queue
-                    char *cmd = heap_caps_malloc(line_pos + 1, MALLOC_CAP_8BIT);
-                    if (cmd) {
-                        memcpy(cmd, line_buffer, line_pos + 1);
-                        if (xQueueSend(cmd_queue, &cmd, 0) != pdTRUE) {
-                            ESP_LOGW(TAG, "Command queue full, dropping: %s", cmd);
-                            free(cmd);
-                        }
-                    }
-                    line_pos = 0;
-                }
-            } else if (c == '\b' || c == 127) {
-                if (line_pos > 0)
-                    line_pos--;
-            } else if (line_pos < CMD_MAX_LENGTH - 1 && c >= 32 && c < 127) {
-                line_buffer[line_pos++] = c;
-            }
+        if (len > 0) {
+            rpc_rx_feed(&rx, data, (size_t)len, on_message, NULL);
         }
     }
 
@@ -103,26 +95,6 @@ static void uart_rx_task(void *pvParameters)
     vTaskDelete(NULL);
 }
 
-// Lower-priority command processor: executes commands from queue
-static void cmd_processor_task(void *pvParameters)
-{
-    char *cmd = NULL;
-
-    ESP_LOGI(TAG, "Command processor task started");
-
-    while (uart_running) {
-        if (xQueueReceive(cmd_queue, &cmd, pdMS_TO_TICKS(CMD_QUEUE_TIMEOUT_MS)) == pdTRUE) {
-            ESP_LOGI(TAG, "Processing: %s", cmd);
-            commands_execute(cmd, send_response);
-            free(cmd);
-            cmd = NULL;
-        }
-    }
-
-    ESP_LOGI(TAG, "Command processor task stopped");
-    vTaskDelete(NULL);
-}
-
 esp_err_t uart_commands_init(void)
 {
     // Get UART pins from BSP
@@ -182,11 +154,10 @@ esp_err_t uart_commands_start(void)
         return ESP_OK;
     }
 
-    // Create command queue
-    cmd_queue = xQueueCreate(10, sizeof(char *));
-    if (!cmd_queue) {
-        ESP_LOGE(TAG, "Failed to create command queue");
-        return ESP_FAIL;
+    esp_err_t err = commands_register_transport(COMMAND_TRANSPORT_UART, &uart_route);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register command route: %s", esp_err_to_name(err));
+        return err;
     }
 
     uart_running = true;
@@ -197,22 +168,10 @@ esp_err_t uart_commands_start(void)
     if (ret != pdPASS) {
         ESP_LOGE(TAG, "Failed to create UART RX task");
         uart_running = false;
-        vQueueDelete(cmd_queue);
         return ESP_FAIL;
     }
 
-    // Lower-priority command processor (priority 5) - can be preempted
-    BaseType_t ret = xTaskCreate(cmd_processor_task, "cmd_proc", CMD_PROC_TASK_STACK_SIZE, NULL, CMD_PROC_TASK_PRIORITY,
-                                 &cmd_processor_task_handle);
-    if (ret != pdPASS) {
-        ESP_LOGE(TAG, "Failed to create command processor task");
-        uart_running = false;
-        vTaskDelete(uart_rx_task_handle);
-        vQueueDelete(cmd_queue);
-        return ESP_FAIL;
-    }
-
-    ESP_LOGI(TAG, "UART tasks started: RX (prio 10), CMD processor (prio 5)");
+    ESP_LOGI(TAG, "UART RX task started (prio 10), commands run on the command worker pool");
     return ESP_OK;
 }
 
@@ -224,20 +183,10 @@ esp_err_t uart_commands_stop(void)
 
     uart_running = false;
 
-    // Clean up queue (free any pending commands)
-    if (cmd_queue) {
-        char *cmd;
-        while (xQueueReceive(cmd_queue, &cmd, 0) == pdTRUE) {
-            free(cmd);
-        }
-        vQueueDelete(cmd_queue);
-        cmd_queue = NULL;
-    }
-
-    uart_rx_task_handle       = NULL;
-    cmd_processor_task_handle = NULL;
+    // Requests already submitted still run; their responses go out while the driver is installed
+    uart_rx_task_handle = NULL;
 
-    ESP_LOGI(TAG, "UART command tasks stopped");
+    ESP_LOGI(TAG, "UART command task stopped");
     return ESP_OK;
 }
 
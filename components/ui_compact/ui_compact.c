@@ -5,6 +5,7 @@
 #include "config_manager.h"
 #include "input_manager.h"
 #include "lora_protocol.h"
+#include "power_mgmt.h"
 #include "screens.h"
 #include "system_events.h"
 #include "tusb.h"
@@ -86,6 +87,10 @@ esp_err_t ui_compact_init(void)
         return ret;
     }
 
+    // LVGL tick timer is the fastest periodic wakeup in the system; declare it for the sleep audit
+    int lvgl_sleep_client;
+    power_mgmt_sleep_register("lvgl", SLEEP_WAKE_TIMER, ui_lvgl_get_timer_period_ms(), &lvgl_sleep_client);
+
     // Initialize UI component styles
     ui_components_init();
 
@@ -24,6 +24,15 @@ esp_err_t ui_lvgl_init(void);
  */
 esp_err_t ui_lvgl_deinit(void);
 
+/**
+ * @brief Get the LVGL tick timer period
+ *
+ * The port drives lv_tick from a periodic esp_timer, which wakes the CPU at this rate.
+ *
+ * @return Period in milliseconds, 0 before ui_lvgl_init()
+ */
+uint32_t ui_lvgl_get_timer_period_ms(void);
+
 /**
  * @brief Lock LVGL for thread-safe access
  */
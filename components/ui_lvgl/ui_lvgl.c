@@ -8,6 +8,7 @@ static const char *TAG = "ui_lvgl";
 
 static lv_display_t *display = NULL;
 static lv_indev_t *indev     = NULL;
+static uint32_t timer_period = 0;
 
 esp_err_t ui_lvgl_init(void)
 {
@@ -16,6 +17,7 @@ esp_err_t ui_lvgl_init(void)
     // Initialize LVGL port
     const lvgl_port_cfg_t lvgl_cfg = ESP_LVGL_PORT_INIT_CONFIG();
     ESP_ERROR_CHECK(lvgl_port_init(&lvgl_cfg));
+    timer_period = lvgl_cfg.timer_period_ms;
 
     // Initialize display
     display = lv_port_disp_init();
@@ -34,9 +36,15 @@ esp_err_t ui_lvgl_init(void)
 esp_err_t ui_lvgl_deinit(void)
 {
     lvgl_port_deinit();
+    timer_period = 0;
     return ESP_OK;
 }
 
+uint32_t ui_lvgl_get_timer_period_ms(void)
+{
+    return timer_period;
+}
+
 void ui_lvgl_lock(void)
 {
     lvgl_port_lock(0);
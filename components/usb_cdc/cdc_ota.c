@@ -0,0 +1,299 @@
+/**
+ * @file cdc_ota.c
+ * @brief Bulk firmware upload over USB CDC
+ *
+ * Two tasks, created on the first upload and kept: the receiver reads from the TinyUSB FIFO
+ * into whichever ota_bulk buffer is free and NAKs bad chunks, the writer feeds full buffers to
+ * ota_engine_write() and ACKs them. When both buffers are full the receiver stops reading, the
+ * FIFO fills and USB NAKs the host, so nothing is dropped however slow flash gets.
+ */
+
+#include "cdc_ota.h"
+#include "class/cdc/cdc_device.h"
+#include "commands.h"
+#include "esp_log.h"
+#include "esp_ota_ops.h"
+#include "esp_system.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "ota_bulk.h"
+#include "ota_engine.h"
+#include "task_config.h"
+#include "tusb.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+
+static const char *TAG = "CDC_OTA";
+
+#define CDC_OTA_WINDOW 4 // Chunks in flight: both buffers plus what the FIFO and the host stack hold
+#define CDC_OTA_IDLE_TIMEOUT_MS 5000
+#define CDC_OTA_POLL_MS 100
+#define CDC_OTA_REBOOT_DELAY_MS 1000
+
+static ota_bulk_t s_bulk;
+static uint8_t *s_storage;
+static TaskHandle_t s_rx_task;
+static TaskHandle_t s_writer_task;
+static SemaphoreHandle_t s_tx_lock; // ACKs come from the writer, NAKs from the receiver
+static atomic_bool s_session;
+static atomic_bool s_rx_active;
+static atomic_bool s_rx_exited;
+static atomic_bool s_stop; // Writer to receiver: the upload is over, stop reading
+
+static void send_status(ota_bulk_status_t type, uint16_t seq, int32_t value)
+{
+    uint8_t record[OTA_BULK_STATUS_SIZE];
+    size_t len       = ota_bulk_encode_status(record, type, seq, value);
+    const uint8_t *p = record;
+
+    xSemaphoreTake(s_tx_lock, portMAX_DELAY);
+    while (len > 0 && tud_cdc_connected()) {
+        uint32_t written = tud_cdc_write(p, len);
+        p += written;
+        len -= written;
+        if (len > 0) {
+            tud_cdc_write_flush();
+            vTaskDelay(1);
+        }
+    }
+    if (tud_cdc_connected()) {
+        tud_cdc_write_flush();
+    }
+    xSemaphoreGive(s_tx_lock);
+}
+
+static void receive(void)
+{
+    TickType_t idle_since = xTaskGetTickCount();
+
+    while (!atomic_load(&s_stop)) {
+        uint8_t *dst;
+        size_t want = ota_bulk_rx_window(&s_bulk, &dst);
+        uint32_t n  = want > 0 && tud_cdc_available() ? tud_cdc_read(dst, want) : 0;
+
+        if (n == 0) {
+            // Woken by tud_cdc_rx_cb(), a line state change or the writer freeing a buffer
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(CDC_OTA_POLL_MS));
+            if (!tud_cdc_connected()) {
+                ESP_LOGW(TAG, "Host disconnected during upload");
+                return;
+            }
+            if (want == 0) {
+                idle_since = xTaskGetTickCount(); // Waiting on flash, not on the host
+            } else if (xTaskGetTickCount() - idle_since > pdMS_TO_TICKS(CDC_OTA_IDLE_TIMEOUT_MS)) {
+                ESP_LOGW(TAG, "No data for %d ms, giving up", CDC_OTA_IDLE_TIMEOUT_MS);
+                return;
+            }
+            continue;
+        }
+        idle_since = xTaskGetTickCount();
+
+        ota_bulk_rx_result_t r = ota_bulk_rx_commit(&s_bulk, n);
+        if (r == OTA_BULK_RX_BAD) {
+            send_status(OTA_BULK_STATUS_NAK, ota_bulk_rx_seq(&s_bulk), ESP_ERR_INVALID_CRC);
+        } else if (r == OTA_BULK_RX_BLOCK) {
+            xTaskNotifyGive(s_writer_task);
+            if (s_bulk.rx_flags & (OTA_BULK_FLAG_LAST | OTA_BULK_FLAG_ABORT)) {
+                return; // Whatever follows is JSON-RPC again
+            }
+        }
+    }
+}
+
+// Created on the first upload and kept: tud_cdc_rx_cb() may notify it at any time
+static void rx_task(void *arg)
+{
+    (void)arg;
+    for (;;) {
+        while (!atomic_load(&s_rx_active)) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        }
+        receive();
+        atomic_store(&s_rx_active, false);
+        atomic_store(&s_rx_exited, true);
+        xTaskNotifyGive(s_writer_task);
+    }
+}
+
+static void end_session(void)
+{
+    atomic_store(&s_stop, true);
+    while (!atomic_load(&s_rx_exited)) {
+        xTaskNotifyGive(s_rx_task);
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(CDC_OTA_POLL_MS));
+    }
+    free(s_storage);
+    s_storage = NULL;
+}
+
+// One upload, from the first chunk to the final status; the receiver is already running
+static void write_upload(void)
+{
+    esp_err_t result  = ESP_ERR_TIMEOUT; // The receiver gave up before the last chunk
+    bool finished     = false;           // ota_engine_finish() ran: report DONE, not ERROR
+    uint32_t received = 0;
+    TickType_t start  = xTaskGetTickCount();
+
+    while (!finished) {
+        const ota_bulk_block_t *block = ota_bulk_next_block(&s_bulk);
+        if (!block) {
+            // Re-check after seeing the receiver gone: it may have queued a block just before
+            if (atomic_load(&s_rx_exited) && !ota_bulk_next_block(&s_bulk)) {
+                break;
+            }
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+
+        uint8_t flags = block->flags;
+        uint16_t seq  = block->seq;
+        esp_err_t ret = block->len > 0 ? ota_engine_write(block->data, block->len) : ESP_OK;
+        received += block->len;
+        ota_bulk_release(&s_bulk);
+        xTaskNotifyGive(s_rx_task);
+
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Write of chunk %u failed: %s", seq, esp_err_to_name(ret));
+            result = ret;
+            break;
+        }
+        if (flags & OTA_BULK_FLAG_ABORT) {
+            ESP_LOGW(TAG, "Upload aborted by host");
+            result = ESP_ERR_INVALID_STATE;
+            break;
+        }
+        send_status(OTA_BULK_STATUS_ACK, seq + 1, ESP_OK);
+        if (flags & OTA_BULK_FLAG_LAST) {
+            result   = ota_engine_finish();
+            finished = true;
+        }
+    }
+
+    // The port must be back in RPC mode before the host sees the final status
+    end_session();
+
+    uint32_t ms = pdTICKS_TO_MS(xTaskGetTickCount() - start);
+    ESP_LOGI(TAG, "%lu bytes in %lu ms (%lu KiB/s), %lu CRC errors, %lu framing errors, %lu stalls",
+             (unsigned long)received, (unsigned long)ms, (unsigned long)(ms ? received / 1024 * 1000 / ms : 0),
+             (unsigned long)s_bulk.crc_errors, (unsigned long)s_bulk.framing_errors, (unsigned long)s_bulk.stalls);
+
+    if (result == ESP_OK) {
+        result = esp_ota_set_boot_partition(esp_ota_get_next_update_partition(NULL));
+    }
+    if (result != ESP_OK) {
+        ota_engine_abort();
+    }
+    send_status(finished ? OTA_BULK_STATUS_DONE : OTA_BULK_STATUS_ERROR, ota_bulk_rx_seq(&s_bulk), result);
+    atomic_store(&s_session, false);
+
+    if (result != ESP_OK) {
+        ESP_LOGE(TAG, "Firmware upload failed: %s", esp_err_to_name(result));
+        return;
+    }
+    ESP_LOGI(TAG, "Firmware update complete, rebooting");
+    vTaskDelay(pdMS_TO_TICKS(CDC_OTA_REBOOT_DELAY_MS));
+    esp_restart();
+}
+
+static void writer_task(void *arg)
+{
+    (void)arg;
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (atomic_load(&s_session)) {
+            write_upload();
+        }
+    }
+}
+
+static bool start_tasks(void)
+{
+    if (!s_writer_task &&
+        xTaskCreate(writer_task, "cdc_ota_wr", TASK_STACK_SIZE_LARGE, NULL, TASK_PRIORITY_NORMAL, &s_writer_task) !=
+            pdPASS) {
+        return false;
+    }
+    if (!s_rx_task &&
+        xTaskCreate(rx_task, "cdc_ota_rx", TASK_STACK_SIZE_MEDIUM, NULL, TASK_PRIORITY_HIGH, &s_rx_task) != pdPASS) {
+        return false;
+    }
+    return true;
+}
+
+static void handle_firmware_bulk(rpc_request_t *req, const rpc_params_t *params)
+{
+    (void)params;
+
+    if (ota_engine_get_state() != OTA_STATE_ACTIVE) {
+        commands_send_error(req, JSONRPC_INVALID_REQUEST, "Call firmware:upgrade first");
+        return;
+    }
+    if (atomic_exchange(&s_session, true)) {
+        commands_send_error(req, JSONRPC_INVALID_REQUEST, "Upload already running");
+        return;
+    }
+
+    s_storage = malloc(OTA_BULK_STORAGE_SIZE(OTA_BULK_CHUNK_MAX));
+    if (!s_storage) {
+        atomic_store(&s_session, false);
+        commands_send_error(req, JSONRPC_INTERNAL_ERROR, "Out of memory");
+        return;
+    }
+    if (!start_tasks()) {
+        free(s_storage);
+        s_storage = NULL;
+        atomic_store(&s_session, false);
+        commands_send_error(req, JSONRPC_INTERNAL_ERROR, "Failed to start upload");
+        return;
+    }
+
+    // Bytes after this response are chunks: the receiver owns the port before the host may send
+    ota_bulk_init(&s_bulk, s_storage, OTA_BULK_CHUNK_MAX);
+    atomic_store(&s_stop, false);
+    atomic_store(&s_rx_exited, false);
+    atomic_store(&s_rx_active, true);
+    xTaskNotifyGive(s_rx_task);
+    xTaskNotifyGive(s_writer_task);
+
+    ESP_LOGI(TAG, "Bulk upload started: %d byte chunks, window %d", OTA_BULK_CHUNK_MAX, CDC_OTA_WINDOW);
+    json_writer_t *w = commands_begin_result(req);
+    json_write_object_begin(w);
+    json_write_kv_int(w, "chunk", OTA_BULK_CHUNK_MAX);
+    json_write_kv_int(w, "window", CDC_OTA_WINDOW);
+    json_write_object_end(w);
+    commands_end_response(req);
+}
+
+static const commands_method_t firmware_bulk_method = {
+    .info =
+        {
+            .name  = "firmware:bulk",
+            .flags = RPC_FLAG_AUTH | RPC_FLAG_LONG_RUNNING,
+            .links = RPC_LINK_USB_CDC,
+        },
+    .handler = handle_firmware_bulk,
+};
+
+esp_err_t cdc_ota_init(void)
+{
+    if (!s_tx_lock) {
+        s_tx_lock = xSemaphoreCreateMutex();
+        if (!s_tx_lock) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    return commands_register_method(&firmware_bulk_method);
+}
+
+bool cdc_ota_rx_active(void)
+{
+    return atomic_load(&s_rx_active);
+}
+
+void cdc_ota_rx_notify(void)
+{
+    if (s_rx_task && atomic_load(&s_rx_active)) {
+        xTaskNotifyGive(s_rx_task);
+    }
+}
@@ -0,0 +1,32 @@
+/**
+ * @file cdc_ota.h
+ * @brief Bulk firmware upload over USB CDC (ota_bulk stream, see ota_bulk.h)
+ *
+ * CONTEXT: firmware:upgrade starts ota_engine, but the CDC link had no way to deliver the
+ *          image (the XMODEM path never worked)
+ * PURPOSE: firmware:bulk hands the CDC port to an upload session: chunks are read straight
+ *          from the TinyUSB FIFO into ping-pong buffers and written by a second task, so
+ *          flash writes and hashing overlap reception. The port returns to JSON-RPC when the
+ *          upload ends
+ * USAGE: usb_cdc_init() calls cdc_ota_init(); tools/loracue_rpc.py upload drives it
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+
+/**
+ * @brief Register the firmware:bulk method (commands_init() must have run)
+ */
+esp_err_t cdc_ota_init(void);
+
+/**
+ * @brief Whether received CDC bytes belong to an upload instead of the RPC assembler
+ */
+bool cdc_ota_rx_active(void);
+
+/**
+ * @brief Wake the upload receiver: data arrived or the line state changed
+ */
+void cdc_ota_rx_notify(void);
@@ -5,8 +5,9 @@
 /**
  * @brief Initialize USB CDC command interface
  *
- * Creates dedicated task and queue for processing CDC commands.
- * CDC callbacks are registered automatically.
+ * Routes complete lines to the command worker pool (commands_init() must have run).
+ * CDC callbacks are registered automatically; firmware:bulk uploads are served here too
+ * (see cdc_ota.h).
  *
  * @return ESP_OK on success, error code otherwise
  */
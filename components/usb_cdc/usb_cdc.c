@@ -1,9 +1,10 @@
 #include "usb_cdc.h"
+#include "cdc_ota.h"
 #include "class/cdc/cdc_device.h"
 #include "commands.h"
+#include "rpc_frame.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
-#include "freertos/queue.h"
 #include "freertos/task.h"
 #include "tinyusb.h"
 #include "tusb.h"
@@ -11,110 +12,90 @@
 
 static const char *TAG = "USB_CDC";
 
-#define CDC_RX_QUEUE_SIZE 10
-#define CDC_TASK_STACK_SIZE 6144 // 2KB buffer + cJSON operations
-#define CDC_TASK_PRIORITY 5
 #define CMD_MAX_LENGTH 2048
+#define CDC_READ_CHUNK 64 // One full-speed bulk packet
 
-typedef struct {
-    char data[CMD_MAX_LENGTH];
-    size_t len;
-} cdc_rx_msg_t;
-
-static QueueHandle_t cdc_rx_queue   = NULL;
-static TaskHandle_t cdc_task_handle = NULL;
 static char rx_buffer[CMD_MAX_LENGTH];
-static size_t rx_len = 0;
+static rpc_rx_t rx; // Only touched from the TinyUSB task
 
-static void send_response(const char *response)
+// Response chunks go straight into the CDC FIFO; wait for the host to drain it rather than drop bytes
+static void response_write(const char *data, size_t len, void *ctx)
 {
-    if (response && tud_cdc_connected()) {
-        tud_cdc_write_str(response);
-        tud_cdc_write_str("\n");
-        tud_cdc_write_flush();
+    (void)ctx;
+    while (len > 0 && tud_cdc_connected()) {
+        uint32_t written = tud_cdc_write(data, len);
+        data += written;
+        len -= written;
+        if (len > 0) {
+            tud_cdc_write_flush();
+            vTaskDelay(1);
+        }
     }
 }
 
-static void process_command(const char *command_line)
+static void response_end(bool binary, void *ctx)
 {
-    ESP_LOGI(TAG, "Processing command: '%s' (len=%d)", command_line, strlen(command_line));
-    for (int i = 0; command_line[i] != '\0'; i++) {
-        ESP_LOGI(TAG, "  [%d] = 0x%02X ('%c')", i, (unsigned char)command_line[i],
-                 command_line[i] >= 32 && command_line[i] < 127 ? command_line[i] : '.');
+    if (!binary) {
+        response_write("\n", 1, ctx);
+    }
+    if (tud_cdc_connected()) {
+        tud_cdc_write_flush();
     }
-    commands_execute(command_line, send_response);
 }
 
-static void cdc_task(void *arg)
-{
-    ESP_LOGI(TAG, "CDC task started");
-    cdc_rx_msg_t msg;
+static const command_route_t cdc_route = {.write = response_write, .end = response_end, .link = RPC_LINK_USB_CDC};
 
-    while (1) {
-        if (xQueueReceive(cdc_rx_queue, &msg, portMAX_DELAY) == pdTRUE) {
-            msg.data[msg.len] = '\0';
-            process_command(msg.data);
-        }
+static void on_message(char *msg, size_t len, bool binary, void *ctx)
+{
+    (void)ctx;
+    esp_err_t ret = binary ? commands_submit_frame(COMMAND_TRANSPORT_USB_CDC, msg, len)
+                           : commands_submit(COMMAND_TRANSPORT_USB_CDC, msg);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Command queue full, dropping %s request", binary ? "binary" : "JSON");
     }
 }
 
-// Called from TinyUSB ISR context - must be non-blocking
+// Called from the TinyUSB task - must not block; commands run on the command worker pool
 void tud_cdc_rx_cb(uint8_t itf)
 {
     if (!tud_cdc_connected()) {
         return;
     }
+    if (cdc_ota_rx_active()) {
+        cdc_ota_rx_notify(); // Firmware chunks: the upload task reads them straight from the FIFO
+        return;
+    }
 
+    uint8_t chunk[CDC_READ_CHUNK];
     while (tud_cdc_available()) {
-        char c = tud_cdc_read_char();
-
-        if (c == '\n' || c == '\r') {
-            if (rx_len > 0) {
-                cdc_rx_msg_t msg;
-                msg.len = rx_len;
-                memcpy(msg.data, rx_buffer, rx_len);
-
-                if (xQueueSend(cdc_rx_queue, &msg, 0) != pdTRUE) {
-                    ESP_LOGW(TAG, "CDC RX queue full, dropping command");
-                }
-                rx_len = 0;
-            }
-        } else if (rx_len < sizeof(rx_buffer) - 1) {
-            rx_buffer[rx_len++] = c;
-        } else {
-            // Buffer overflow, reset
-            ESP_LOGW(TAG, "Command too long, dropping");
-            rx_len = 0;
-        }
+        uint32_t n = tud_cdc_read(chunk, sizeof(chunk));
+        rpc_rx_feed(&rx, chunk, n, on_message, NULL);
     }
 }
 
 void tud_cdc_line_state_cb(uint8_t itf, bool dtr, bool rts)
 {
     ESP_LOGD(TAG, "CDC line state changed: itf=%d, dtr=%d, rts=%d", itf, dtr, rts);
+    cdc_ota_rx_notify();
 }
 
 esp_err_t usb_cdc_init(void)
 {
     ESP_LOGI(TAG, "Initializing USB CDC command interface");
+    rpc_rx_init(&rx, rx_buffer, sizeof(rx_buffer), false);
 
-    // Create RX queue
-    cdc_rx_queue = xQueueCreate(CDC_RX_QUEUE_SIZE, sizeof(cdc_rx_msg_t));
-    if (!cdc_rx_queue) {
-        ESP_LOGE(TAG, "Failed to create CDC RX queue");
-        return ESP_ERR_NO_MEM;
+    esp_err_t ret = commands_register_transport(COMMAND_TRANSPORT_USB_CDC, &cdc_route);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register CDC command route: %s", esp_err_to_name(ret));
+        return ret;
     }
 
-    // Create CDC task
-    BaseType_t ret = xTaskCreate(cdc_task, "cdc", CDC_TASK_STACK_SIZE, NULL, CDC_TASK_PRIORITY, &cdc_task_handle);
-    if (ret != pdPASS) {
-        ESP_LOGE(TAG, "Failed to create CDC task");
-        vQueueDelete(cdc_rx_queue);
-        cdc_rx_queue = NULL;
-        return ESP_FAIL;
+    ret = cdc_ota_init();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register firmware:bulk: %s", esp_err_to_name(ret));
+        return ret;
     }
 
-    ESP_LOGI(TAG, "USB CDC initialized (queue=%d, stack=%d, priority=%d)", CDC_RX_QUEUE_SIZE, CDC_TASK_STACK_SIZE,
-             CDC_TASK_PRIORITY);
+    ESP_LOGI(TAG, "USB CDC initialized");
     return ESP_OK;
 }
@@ -11,6 +11,7 @@
 #include "esp_log.h"
 #include "config_manager.h"
 #include "input_manager.h"
+#include "system_events.h"
 #include "tinyusb.h"
 #include "tusb.h"
 #include "usb_cdc.h"
@@ -75,6 +76,33 @@ void tud_hid_set_report_cb(uint8_t instance, uint8_t report_id, hid_report_type_
     (void)bufsize;
 }
 
+// TinyUSB device state callbacks. A suspended bus counts as disconnected so the
+// USB sleep blocker is released while the host sleeps or the cable is charger-only.
+void tud_mount_cb(void)
+{
+    ESP_LOGI(TAG, "USB mounted");
+    system_events_post_usb(true);
+}
+
+void tud_umount_cb(void)
+{
+    ESP_LOGI(TAG, "USB unmounted");
+    system_events_post_usb(false);
+}
+
+void tud_suspend_cb(bool remote_wakeup_en)
+{
+    (void)remote_wakeup_en;
+    ESP_LOGI(TAG, "USB suspended");
+    system_events_post_usb(false);
+}
+
+void tud_resume_cb(void)
+{
+    ESP_LOGI(TAG, "USB resumed");
+    system_events_post_usb(tud_mounted());
+}
+
 bool usb_hid_is_connected(void)
 {
     return tud_hid_ready();
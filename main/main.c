@@ -8,7 +8,9 @@
  */
 
 #include "ble.h"
+#include "boot_trace.h"
 #include "bsp.h"
+#include "commands.h"
 #include "common_types.h"
 #include "device_registry.h"
 #include "esp_log.h"
@@ -16,13 +18,17 @@
 #include "esp_ota_ops.h"
 
 #include "esp_task_wdt.h"
+#include "fast_resume.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "config_manager.h"
+#include "config_wifi_server.h"
 #include "i2console.h"
+#include "init_scheduler.h"
 #include "input_manager.h"
 #include "led_manager.h"
 #include "lora_driver.h"
+#include "lora_fuota_service.h"
 #include "lora_protocol.h"
 #include "nvs.h"
 #include "nvs_flash.h"
@@ -49,10 +55,12 @@ static TimerHandle_t ota_validation_timer       = NULL;
 #define MAX_BOOT_ATTEMPTS 3
 
 #define BATTERY_MONITOR_INTERVAL_MS 5000
-#define USB_MONITOR_INTERVAL_MS 100
 #define LED_FADE_DURATION_MS 3000
 #define OTA_VALIDATION_TIME_MS 60000
 #define WDT_TIMEOUT_MS 90000
+#define WDT_FEED_INTERVAL_MS (WDT_TIMEOUT_MS / 3)
+
+static int usb_sleep_client = -1;
 
 static uint32_t ota_get_boot_counter(void)
 {
@@ -112,6 +120,26 @@ static void ota_validation_timer_cb(TimerHandle_t timer)
     }
 }
 
+// An idle presenter powers down; the button press that wakes it is sent by fast_resume_run() before the rest of
+// the system comes up. Receivers keep listening; a running update or an open configuration session holds the
+// device awake.
+static void check_deep_sleep(void)
+{
+    if (power_mgmt_get_recommended_mode() != POWER_MODE_DEEP_SLEEP) {
+        return;
+    }
+
+    const config_snapshot_t *config = config_snapshot_acquire();
+    bool presenter                  = config && config->general.device_mode == DEVICE_MODE_PRESENTER;
+    config_snapshot_release(config);
+    if (!presenter || ota_engine_get_state() != OTA_STATE_IDLE || ble_is_connected() ||
+        config_wifi_server_is_running()) {
+        return;
+    }
+
+    power_mgmt_deep_sleep(0);
+}
+
 static void battery_monitor_task(void *pvParameters)
 {
     uint8_t prev_battery = 0;
@@ -119,29 +147,34 @@ static void battery_monitor_task(void *pvParameters)
     while (1) {
         uint8_t current_battery = (uint8_t)(bsp_read_battery() * 100 / 4.2f);
 
+        // Remaining capacity and fuel-gauge calibration for battery-life projection
+        power_mgmt_energy_sample(current_battery);
+
         if (current_battery != prev_battery) {
             bool is_charging = bsp_battery_is_charging();
             system_events_post_battery(current_battery, is_charging);
             prev_battery = current_battery;
         }
 
+        check_deep_sleep();
+
         vTaskDelay(pdMS_TO_TICKS(BATTERY_MONITOR_INTERVAL_MS));
     }
 }
 
-static void usb_monitor_task(void *pvParameters)
+// USB state arrives from TinyUSB mount/suspend callbacks; an active host keeps the
+// system out of light sleep so HID and CDC latency stay unaffected
+static void usb_event_handler(void *handler_args, esp_event_base_t base, int32_t id, void *event_data)
 {
-    bool prev_usb = false;
+    static bool blocking            = false;
+    const system_event_usb_t *event = (const system_event_usb_t *)event_data;
 
-    while (1) {
-        bool current_usb = usb_hid_is_connected();
-
-        if (current_usb != prev_usb) {
-            system_events_post_usb(current_usb);
-            prev_usb = current_usb;
-        }
-
-        vTaskDelay(pdMS_TO_TICKS(USB_MONITOR_INTERVAL_MS));
+    if (event->connected && !blocking) {
+        power_mgmt_sleep_block(usb_sleep_client);
+        blocking = true;
+    } else if (!event->connected && blocking) {
+        power_mgmt_sleep_allow(usb_sleep_client);
+        blocking = false;
     }
 }
 
@@ -149,11 +182,12 @@ static void usb_monitor_task(void *pvParameters)
 static void lora_rx_handler(uint16_t device_id, uint16_t sequence_num, lora_command_t command, const uint8_t *payload,
                             uint8_t payload_length, int16_t rssi, void *user_ctx)
 {
-    general_config_t config;
-    config_manager_get_general(&config);
+    const config_snapshot_t *config = config_snapshot_acquire();
+    bool presenter                  = !config || config->general.device_mode == DEVICE_MODE_PRESENTER;
+    config_snapshot_release(config);
 
     // In presenter mode, only accept ACKs
-    if (config.device_mode == DEVICE_MODE_PRESENTER) {
+    if (presenter) {
         if (command == CMD_ACK) {
             ESP_LOGI(TAG, "Presenter mode: ACK received from 0x%04X (seq=%u)", device_id, sequence_num);
             // ACK handling is done in lora_protocol layer
@@ -177,27 +211,26 @@ static void lora_state_handler(lora_connection_state_t state, const void *user_c
     system_events_post_lora_state(connected, signal);
 }
 
-void app_main(void)
-{
-    ESP_LOGI(TAG, "LoRaCue starting - Enterprise presentation clicker");
-    ESP_LOGI(TAG, "Version: %s", LORACUE_VERSION_FULL);
-    ESP_LOGI(TAG, "Build: %s (%s)", LORACUE_BUILD_COMMIT_SHORT, LORACUE_BUILD_BRANCH);
-    ESP_LOGI(TAG, "Date: %s", LORACUE_BUILD_DATE);
+// Init stages, run by init_scheduler in dependency order (see boot_stages.c).
+// A stage returns an error only when the device cannot run without it.
 
-    // Check wake cause
-    esp_sleep_wakeup_cause_t wake_cause = esp_sleep_get_wakeup_cause();
-    if (wake_cause != ESP_SLEEP_WAKEUP_UNDEFINED) {
-        ESP_LOGI(TAG, "Wake from sleep, cause: %d", wake_cause);
-    }
+static esp_err_t fast_resume_ret = ESP_ERR_NOT_FOUND;
+static input_event_t wake_event;
+static bool wake_press = false;
 
-    // Initialize NVS
+static esp_err_t init_nvs(void)
+{
     esp_err_t ret = nvs_flash_init();
     if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
         ESP_ERROR_CHECK(nvs_flash_erase());
         ret = nvs_flash_init();
     }
     ESP_ERROR_CHECK(ret);
+    return ESP_OK;
+}
 
+static esp_err_t init_ota(void)
+{
     // OTA boot diagnostics
     running_partition = esp_ota_get_running_partition();
     ESP_LOGI(TAG, "Running from partition: %s (0x%lx, %lu bytes)", running_partition->label, running_partition->address,
@@ -239,35 +272,44 @@ void app_main(void)
 
     // Initialize OTA engine
     ESP_LOGI(TAG, "Initializing OTA engine...");
-    ret = ota_engine_init();
+    esp_err_t ret = ota_engine_init();
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "OTA engine initialization failed: %s", esp_err_to_name(ret));
     }
 
-    // Reconfigure watchdog (90s timeout for init + 60s validation)
-    esp_task_wdt_config_t wdt_config = {.timeout_ms = 90000, .idle_core_mask = 0, .trigger_panic = true};
-    ESP_ERROR_CHECK(esp_task_wdt_reconfigure(&wdt_config));
-    ESP_ERROR_CHECK(esp_task_wdt_add(NULL));
+    // Every command transport (USB CDC, BLE, UART) depends on this stage
+    ret = commands_init();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Command pool initialization failed: %s", esp_err_to_name(ret));
+    }
+    return ESP_OK;
+}
 
-    // Initialize device configuration
+static esp_err_t init_config(void)
+{
     ESP_LOGI(TAG, "Initializing device configuration system...");
-    ret = config_manager_init();
+    esp_err_t ret = config_manager_init();
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Device config initialization failed: %s", esp_err_to_name(ret));
-        return;
     }
+    return ret;
+}
 
-    // Get device config for power management settings
-    general_config_t config;
-    config_manager_get_general(&config);
+// config_manager cannot depend on power_mgmt (power_mgmt reads its config)
+static void config_deep_sleep_cb(void)
+{
+    config_manager_flush();
+}
 
+static esp_err_t init_power(void)
+{
     // Initialize power management with settings from config_manager
     ESP_LOGI(TAG, "Initializing power management...");
     power_config_t power_config;
-    ret = config_manager_get_power(&power_config);
+    esp_err_t ret = config_manager_get_power(&power_config);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to get power config: %s", esp_err_to_name(ret));
-        return;
+        return ret;
     }
 
     ESP_LOGI(TAG, "Power config: display_sleep=%s, light_sleep=%s, deep_sleep=%s",
@@ -277,21 +319,30 @@ void app_main(void)
     ret = power_mgmt_init(&power_config);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Power management initialization failed: %s", esp_err_to_name(ret));
-        return;
+        return ret;
     }
+    power_mgmt_register_deep_sleep_cb(config_deep_sleep_cb);
+    fast_resume_init();
+    return ESP_OK;
+}
 
-    // Initialize I2C bus first (needed for I2Console and display)
+static esp_err_t init_i2c(void)
+{
+    // I2C bus first (needed for I2Console, BSP and display)
     ESP_LOGI(TAG, "Initializing I2C bus...");
-    ret = bsp_i2c_init_default();
+    esp_err_t ret = bsp_i2c_init_default();
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "I2C initialization failed: %s", esp_err_to_name(ret));
-        return;
     }
+    return ret;
+}
 
-    // Check for I2Console device and initialize logging bridge (before display)
+static esp_err_t init_i2console(void)
+{
+    // Check for I2Console device and initialize logging bridge
     ESP_LOGI(TAG, "Checking for I2Console device...");
     vTaskDelay(pdMS_TO_TICKS(100)); // Allow I2Console chip to fully initialize
-    ret = i2console_init(I2CONSOLE_DEFAULT_ADDR);
+    esp_err_t ret = i2console_init(I2CONSOLE_DEFAULT_ADDR);
     if (ret == ESP_OK) {
         char version[16];
         if (i2console_get_version(version) == ESP_OK) {
@@ -300,146 +351,224 @@ void app_main(void)
     } else {
         ESP_LOGI(TAG, "I2Console not detected - using UART logging only");
     }
+    return ESP_OK;
+}
 
+static esp_err_t init_bsp(void)
+{
     // Initialize BSP (will skip I2C init since already done)
     ESP_LOGI(TAG, "Initializing Board Support Package...");
-    ret = bsp_init();
+    esp_err_t ret = bsp_init();
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "BSP initialization failed: %s", esp_err_to_name(ret));
-        return;
+        return ret;
     }
 
-    // Detect board type early
-    const char *board_id = bsp_get_board_id();
-    ESP_LOGI(TAG, "Board: %s", board_id);
+    ESP_LOGI(TAG, "Board: %s", bsp_get_board_id());
+    return ESP_OK;
+}
 
+static esp_err_t init_led(void)
+{
     // Initialize LED manager and turn on status LED
     ESP_LOGI(TAG, "Initializing LED manager...");
-    ret = led_manager_init();
+    esp_err_t ret = led_manager_init();
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "LED manager initialization failed: %s", esp_err_to_name(ret));
-        return;
+        return ret;
     }
     led_manager_solid(true); // Turn on LED during startup
+    return ESP_OK;
+}
 
-    // Initialize system events
+static esp_err_t init_events(void)
+{
     ESP_LOGI(TAG, "Initializing system events...");
-    ret = system_events_init();
+    esp_err_t ret = system_events_init();
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "System events initialization failed: %s", esp_err_to_name(ret));
-        return;
     }
+    return ret;
+}
 
-    // Initialize input manager first (before UI registers callbacks)
+static esp_err_t init_input(void)
+{
+    // Initialize input manager (before UI registers callbacks)
     ESP_LOGI(TAG, "Initializing input manager...");
-    ret = input_manager_init();
+    esp_err_t ret = input_manager_init();
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Input manager initialization failed: %s", esp_err_to_name(ret));
-        return;
     }
+    return ret;
+}
 
+static esp_err_t init_ui(void)
+{
     // Initialize UI (self-contained, creates own task)
     ESP_LOGI(TAG, "Initializing UI...");
-    ret = ui_compact_init();
+    esp_err_t ret = ui_compact_init();
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "UI initialization failed: %s", esp_err_to_name(ret));
-        return;
+        return ret;
     }
 
     ESP_LOGI(TAG, "Creating boot screen...");
     ui_compact_show_boot_screen();
+    return ESP_OK;
+}
 
-    // Initialize PC mode manager
+static esp_err_t init_mode_managers(void)
+{
     ESP_LOGI(TAG, "Initializing PC mode manager...");
-    ret = pc_mode_manager_init();
+    esp_err_t ret = pc_mode_manager_init();
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "PC mode manager initialization failed: %s", esp_err_to_name(ret));
-        return;
+        return ret;
     }
 
-    // Initialize presenter mode manager
     ESP_LOGI(TAG, "Initializing presenter mode manager...");
     ret = presenter_mode_manager_init();
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Presenter mode manager initialization failed: %s", esp_err_to_name(ret));
-        return;
+    }
+    return ret;
+}
+
+static esp_err_t init_input_start(void)
+{
+    // The wake press was handled by fast_resume; its release must not send it again
+    wake_press = fast_resume_get_wake_event(&wake_event);
+    if (wake_press) {
+        input_manager_consume_held_buttons();
+    }
+
+    ESP_LOGI(TAG, "Registering UI button callback...");
+    esp_err_t ret = ui_compact_register_button_callback();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "UI button callback registration failed: %s", esp_err_to_name(ret));
+        return ret;
     }
 
-    // Start input manager task
     ret = input_manager_start();
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to start input manager: %s", esp_err_to_name(ret));
-        return;
     }
+    return ret;
+}
 
-    // Initialize device registry
+static esp_err_t init_registry(void)
+{
     ESP_LOGI(TAG, "Initializing device registry...");
-    ret = device_registry_init();
+    esp_err_t ret = device_registry_init();
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Device registry initialization failed: %s", esp_err_to_name(ret));
-        return;
     }
+    return ret;
+}
 
-    // Initialize LoRa driver
+static esp_err_t init_lora_driver(void)
+{
     ESP_LOGI(TAG, "Initializing LoRa driver...");
-    ret = lora_driver_init();
+    esp_err_t ret = lora_driver_init();
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "LoRa driver initialization failed: %s", esp_err_to_name(ret));
-        return;
     }
+    return ret;
+}
 
-    // Get device mode from NVS (reuse config from contrast setting)
+static esp_err_t init_lora_protocol(void)
+{
+    general_config_t config;
     config_manager_get_general(&config);
 
     // Get device ID from MAC address (static identity)
     uint16_t device_id = config_manager_get_device_id();
-
     ESP_LOGI(TAG, "Device mode: %s, Static ID: 0x%04X", device_mode_to_string(config.device_mode), device_id);
 
-    // Notify UI of initial device mode
-    system_events_post_mode_changed(config.device_mode);
-
     // Get AES key from LoRa config
     lora_config_t lora_cfg;
     lora_get_config(&lora_cfg);
 
-    ret = lora_protocol_init(device_id, lora_cfg.aes_key);
+    esp_err_t ret = lora_protocol_init(device_id, lora_cfg.aes_key);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "LoRa protocol initialization failed: %s", esp_err_to_name(ret));
-        return;
+        return ret;
     }
+    boot_trace_mark(BOOT_TRACE_MARK_LORA_READY);
+    return ESP_OK;
+}
+
+static esp_err_t init_lora_start(void)
+{
+    // Application callbacks first so no packet arrives without a handler
+    lora_protocol_register_rx_callback(lora_rx_handler, NULL);
+    lora_protocol_register_state_callback((lora_protocol_state_callback_t)lora_state_handler, NULL);
 
-    // Initialize LoRa communication
-    ESP_LOGI(TAG, "Initializing LoRa communication...");
+    // Set to receive mode initially
+    lora_set_receive_mode();
 
-    // Initialize USB HID
-    ESP_LOGI(TAG, "Initializing USB HID interface...");
-    ret = usb_hid_init();
+    ESP_LOGI(TAG, "Starting LoRa communication...");
+    esp_err_t ret = lora_protocol_start();
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "USB HID initialization failed: %s", esp_err_to_name(ret));
-        return;
+        ESP_LOGW(TAG, "Failed to start LoRa communication: %s (continuing anyway)", esp_err_to_name(ret));
+        // Continue anyway - UI should still work
     }
 
-    // Register UI button callback (must be after usb_hid to override its callback)
-    ESP_LOGI(TAG, "Registering UI button callback...");
-    ret = ui_compact_register_button_callback();
+    ret = lora_fuota_service_start();
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "UI button callback registration failed: %s", esp_err_to_name(ret));
-        return;
+        ESP_LOGW(TAG, "LoRa firmware updates unavailable: %s", esp_err_to_name(ret));
     }
+    return ESP_OK;
+}
 
-    // Initialize USB CDC command interface
+static esp_err_t init_main_screen(void)
+{
+    general_config_t config;
+    config_manager_get_general(&config);
+
+    // Notify UI of initial device mode
+    system_events_post_mode_changed(config.device_mode);
+
+    if (wake_press && fast_resume_ret != ESP_OK) {
+        // Retained state unusable (e.g. radio lost power): send the wake press the normal way
+        presenter_mode_manager_handle_input(wake_event);
+    }
+
+    ESP_LOGI(TAG, "Switching to main screen...");
+    ui_compact_show_main_screen();
+    boot_trace_mark(BOOT_TRACE_MARK_KEYPRESS_READY);
+    return ESP_OK;
+}
+
+static esp_err_t init_usb_hid(void)
+{
+    ESP_LOGI(TAG, "Initializing USB HID interface...");
+    esp_err_t ret = usb_hid_init();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "USB HID initialization failed: %s", esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+static esp_err_t init_usb_cdc(void)
+{
     ESP_LOGI(TAG, "Initializing USB CDC command interface...");
-    ret = usb_cdc_init();
+    esp_err_t ret = usb_cdc_init();
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "USB CDC initialization failed: %s", esp_err_to_name(ret));
-        return;
     }
+    return ret;
+}
+
+static esp_err_t init_ble(void)
+{
+    general_config_t config;
+    config_manager_get_general(&config);
 
     // Initialize Bluetooth configuration based on settings
     ESP_LOGI(TAG, "Initializing Bluetooth configuration...");
     if (config.bluetooth_enabled) {
-        ret = ble_init();
+        esp_err_t ret = ble_init();
         if (ret != ESP_OK) {
             ESP_LOGW(TAG, "Bluetooth initialization failed: %s (continuing without BLE)", esp_err_to_name(ret));
             // Non-fatal - continue without Bluetooth
@@ -447,11 +576,14 @@ void app_main(void)
     } else {
         ESP_LOGI(TAG, "Bluetooth disabled in configuration");
     }
+    return ESP_OK;
+}
 
 #ifdef CONFIG_LORACUE_UART_COMMANDS_ENABLED
-    // Initialize UART command interface
+static esp_err_t init_uart(void)
+{
     ESP_LOGI(TAG, "Initializing UART command interface...");
-    ret = uart_commands_init();
+    esp_err_t ret = uart_commands_init();
     if (ret != ESP_OK) {
         ESP_LOGW(TAG, "UART commands initialization failed: %s", esp_err_to_name(ret));
     } else {
@@ -460,9 +592,66 @@ void app_main(void)
             ESP_LOGW(TAG, "UART commands start failed: %s", esp_err_to_name(ret));
         }
     }
-#else
-    ESP_LOGI(TAG, "UART commands disabled - UART0 used for debug logging");
+    return ESP_OK;
+}
+#endif
+
+static const init_stage_fn_t init_stages[BOOT_STAGE_COUNT] = {
+    [BOOT_STAGE_NVS]           = init_nvs,
+    [BOOT_STAGE_OTA]           = init_ota,
+    [BOOT_STAGE_CONFIG]        = init_config,
+    [BOOT_STAGE_POWER]         = init_power,
+    [BOOT_STAGE_I2C]           = init_i2c,
+    [BOOT_STAGE_I2CONSOLE]     = init_i2console,
+    [BOOT_STAGE_BSP]           = init_bsp,
+    [BOOT_STAGE_LED]           = init_led,
+    [BOOT_STAGE_EVENTS]        = init_events,
+    [BOOT_STAGE_INPUT]         = init_input,
+    [BOOT_STAGE_UI]            = init_ui,
+    [BOOT_STAGE_MODE_MANAGERS] = init_mode_managers,
+    [BOOT_STAGE_INPUT_START]   = init_input_start,
+    [BOOT_STAGE_REGISTRY]      = init_registry,
+    [BOOT_STAGE_LORA_DRIVER]   = init_lora_driver,
+    [BOOT_STAGE_LORA_PROTOCOL] = init_lora_protocol,
+    [BOOT_STAGE_LORA_START]    = init_lora_start,
+    [BOOT_STAGE_MAIN_SCREEN]   = init_main_screen,
+    [BOOT_STAGE_USB_HID]       = init_usb_hid,
+    [BOOT_STAGE_USB_CDC]       = init_usb_cdc,
+    [BOOT_STAGE_BLE]           = init_ble,
+#ifdef CONFIG_LORACUE_UART_COMMANDS_ENABLED
+    [BOOT_STAGE_UART] = init_uart,
 #endif
+};
+
+void app_main(void)
+{
+    boot_trace_mark(BOOT_TRACE_MARK_APP_START);
+
+    // A button wake from deep sleep sends its keypress before anything else is initialized
+    fast_resume_ret = fast_resume_run();
+
+    ESP_LOGI(TAG, "LoRaCue starting - Enterprise presentation clicker");
+    ESP_LOGI(TAG, "Version: %s", LORACUE_VERSION_FULL);
+    ESP_LOGI(TAG, "Build: %s (%s)", LORACUE_BUILD_COMMIT_SHORT, LORACUE_BUILD_BRANCH);
+    ESP_LOGI(TAG, "Date: %s", LORACUE_BUILD_DATE);
+
+    // Check wake cause
+    esp_sleep_wakeup_cause_t wake_cause = esp_sleep_get_wakeup_cause();
+    if (wake_cause != ESP_SLEEP_WAKEUP_UNDEFINED) {
+        ESP_LOGI(TAG, "Wake from sleep, cause: %d", wake_cause);
+    }
+
+    // Reconfigure watchdog (90s timeout for init + 60s validation)
+    esp_task_wdt_config_t wdt_config = {.timeout_ms = 90000, .idle_core_mask = 0, .trigger_panic = true};
+    ESP_ERROR_CHECK(esp_task_wdt_reconfigure(&wdt_config));
+    ESP_ERROR_CHECK(esp_task_wdt_add(NULL));
+
+    // Independent stages run on both cores; LoRa and input come first
+    esp_err_t ret = init_scheduler_run(init_stages);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Initialization failed: %s", esp_err_to_name(ret));
+        return;
+    }
 
     // Validate hardware
     ESP_LOGI(TAG, "Running hardware validation...");
@@ -475,21 +664,11 @@ void app_main(void)
     ESP_LOGI(TAG, "Starting LED fade pattern");
     led_manager_fade(LED_FADE_DURATION_MS);
 
-    // Set to receive mode initially
-    lora_set_receive_mode();
-
-    // Start LoRa communication task
-    ESP_LOGI(TAG, "Starting LoRa communication...");
-    ret = lora_protocol_start();
-    if (ret != ESP_OK) {
-        ESP_LOGW(TAG, "Failed to start LoRa communication: %s (continuing anyway)", esp_err_to_name(ret));
-        // Continue anyway - UI should still work
-    }
-
     // Reset watchdog after successful init
     esp_task_wdt_reset();
 
     // Start 60s validation timer for new firmware
+    esp_ota_img_states_t ota_state;
     if (esp_ota_get_state_partition(running_partition, &ota_state) == ESP_OK) {
         if (ota_state == ESP_OTA_IMG_PENDING_VERIFY) {
             ESP_LOGI(TAG, "Starting 60s health check for new firmware");
@@ -501,23 +680,24 @@ void app_main(void)
         }
     }
 
-    // Register application callbacks
-    lora_protocol_register_rx_callback(lora_rx_handler, NULL);
-    lora_protocol_register_state_callback((lora_protocol_state_callback_t)lora_state_handler, NULL);
-
     // Start monitoring tasks
+    int sleep_client;
+    power_mgmt_sleep_register("battery", SLEEP_WAKE_TIMER, BATTERY_MONITOR_INTERVAL_MS, &sleep_client);
     xTaskCreate(battery_monitor_task, "battery_monitor", 3072, NULL, 5, NULL);
-    xTaskCreate(usb_monitor_task, "usb_monitor", 2048, NULL, 5, NULL);
 
-    // Switch to main screen after initialization
-    ESP_LOGI(TAG, "Switching to main screen...");
-    ui_compact_show_main_screen();
+    // USB is event driven; post the current state once in case the host mounted before the handler existed
+    power_mgmt_sleep_register("usb", SLEEP_WAKE_USB, 0, &usb_sleep_client);
+    esp_event_handler_register_with(system_events_get_loop(), SYSTEM_EVENTS, SYSTEM_EVENT_USB_CHANGED,
+                                    usb_event_handler, NULL);
+    system_events_post_usb(usb_hid_is_connected());
 
     // Main task now just handles events
+    boot_trace_finish();
     ESP_LOGI(TAG, "Main loop starting");
+    power_mgmt_sleep_register("main", SLEEP_WAKE_TIMER, WDT_FEED_INTERVAL_MS, &sleep_client);
 
     while (1) {
         esp_task_wdt_reset();
-        vTaskDelay(pdMS_TO_TICKS(1000));
+        vTaskDelay(pdMS_TO_TICKS(WDT_FEED_INTERVAL_MS));
     }
 }
@@ -0,0 +1,90 @@
+#!/usr/bin/env python3
+"""LZSS in the heatshrink bit format, as decoded by components/ota_engine/ota_decompress.c.
+
+Used by sign_firmware.py --compress and make_delta.py.
+"""
+
+LZSS_WINDOW_BITS = 12     # 4 KB decoder window, OTA_LZSS_WINDOW_BITS_MAX on the device
+LZSS_LOOKAHEAD_BITS = 4   # Matches of up to 16 bytes
+LZSS_MIN_MATCH = 3        # A shorter back-reference costs more bits than its literals
+LZSS_CHAIN = 16           # Candidates tried per position
+
+
+class _BitWriter:
+    def __init__(self):
+        self.out = bytearray()
+        self.acc = 0
+        self.count = 0
+
+    def put(self, value: int, bits: int):
+        self.acc = (self.acc << bits) | value
+        self.count += bits
+        while self.count >= 8:
+            self.count -= 8
+            self.out.append((self.acc >> self.count) & 0xFF)
+        self.acc &= (1 << self.count) - 1
+
+    def finish(self) -> bytes:
+        if self.count:
+            self.put(0, 8 - self.count)
+        return bytes(self.out)
+
+
+def lzss_compress(data: bytes, window_bits: int = LZSS_WINDOW_BITS,
+                  lookahead_bits: int = LZSS_LOOKAHEAD_BITS) -> bytes:
+    """Greedy LZSS in the heatshrink bit format: 1 + literal, or 0 + distance-1 + length-1."""
+    window, max_len = 1 << window_bits, 1 << lookahead_bits
+    writer = _BitWriter()
+    chains = {}
+    pos = 0
+
+    while pos < len(data):
+        best_len, best_dist = 0, 0
+        limit = min(max_len, len(data) - pos)
+        for cand in reversed(chains.get(data[pos:pos + LZSS_MIN_MATCH], [])[-LZSS_CHAIN:]):
+            if pos - cand > window:
+                break
+            length = LZSS_MIN_MATCH
+            while length < limit and data[cand + length] == data[pos + length]:
+                length += 1
+            if length > best_len:
+                best_len, best_dist = length, pos - cand
+                if length == limit:
+                    break
+
+        if best_len >= LZSS_MIN_MATCH:
+            writer.put(0, 1)
+            writer.put(best_dist - 1, window_bits)
+            writer.put(best_len - 1, lookahead_bits)
+            step = best_len
+        else:
+            writer.put(0x100 | data[pos], 9)
+            step = 1
+        for p in range(pos, min(pos + step, len(data) - LZSS_MIN_MATCH + 1)):
+            chain = chains.setdefault(data[p:p + LZSS_MIN_MATCH], [])
+            chain.append(p)
+            if len(chain) > 4 * LZSS_CHAIN:
+                del chain[:2 * LZSS_CHAIN]
+        pos += step
+
+    return writer.finish()
+
+
+def lzss_decompress(stream: bytes, window_bits: int, lookahead_bits: int, size: int) -> bytes:
+    """Reference decoder, used to check every container before it is written."""
+    out = bytearray()
+    bits = ''.join(f'{byte:08b}' for byte in stream)
+    pos = 0
+    while len(out) < size:
+        if bits[pos] == '1':
+            out.append(int(bits[pos + 1:pos + 9], 2))
+            pos += 9
+            continue
+        pos += 1
+        dist = int(bits[pos:pos + window_bits], 2) + 1
+        pos += window_bits
+        length = int(bits[pos:pos + lookahead_bits], 2) + 1
+        pos += lookahead_bits
+        for _ in range(length):
+            out.append(out[-dist])
+    return bytes(out)
@@ -0,0 +1,167 @@
+#!/usr/bin/env python3
+"""Make a delta OTA patch that turns a base build into a new one.
+
+The device applies it against its running partition (components/ota_engine/include/ota_delta.h),
+so the base must be the exact image the device runs. The patch carries both SHA-256s: the device
+refuses it before erasing anything if its running image differs, and verifies the new image and
+its signature (the new build's .sig) as for a full upload.
+
+Usage:
+    make_delta.py <base.bin> <new.bin> [-o patch.lcd] [--stored]
+    python3 tools/loracue_rpc.py /dev/ttyACM0 upload patch.lcd --signature new.bin.sig
+"""
+
+import argparse
+import hashlib
+import struct
+import sys
+from pathlib import Path
+
+from lzss import LZSS_WINDOW_BITS, lzss_compress, lzss_decompress
+
+DELTA_MAGIC = b'LCD1'
+DELTA_FORMAT_BSDIFF = 1
+ANCHOR = 8                # Exact match length that starts a new alignment
+GIVE_UP = 256             # Bytes without a better approximate match before a diff run ends
+BODY_LOOKAHEAD_BITS = 10  # Diff runs are mostly zeros: matches of up to 1 KB pay off
+
+
+def _index(base: bytes) -> dict:
+    """First position of every ANCHOR-byte string in base."""
+    index = {}
+    for pos in range(len(base) - ANCHOR + 1):
+        index.setdefault(base[pos:pos + ANCHOR], pos)
+    return index
+
+
+def _diff_run(base: bytes, bpos: int, new: bytes, npos: int) -> int:
+    """Length of the approximate match at this alignment, bsdiff's forward extension:
+    the prefix that maximises matches minus mismatches."""
+    score = best = best_len = 0
+    limit = min(len(base) - bpos, len(new) - npos)
+    for k in range(limit):
+        score += 1 if base[bpos + k] == new[npos + k] else -1
+        if score > best:
+            best, best_len = score, k + 1
+        elif k + 1 - best_len > GIVE_UP:
+            break
+    return best_len
+
+
+def _varint(value: int) -> bytes:
+    out = bytearray()
+    while True:
+        byte = value & 0x7F
+        value >>= 7
+        if value:
+            out.append(byte | 0x80)
+        else:
+            out.append(byte)
+            return bytes(out)
+
+
+def _zigzag(value: int) -> int:
+    return value * 2 if value >= 0 else -value * 2 - 1
+
+
+def diff(base: bytes, new: bytes) -> bytes:
+    """Records as in ota_delta.h: diff run at the current alignment, literals up to the next
+    anchor, then a seek to the anchor's alignment."""
+    index = _index(base)
+    body = bytearray()
+    npos = bpos = 0
+
+    while npos < len(new):
+        run = _diff_run(base, bpos, new, npos)
+        delta = bytes((new[npos + i] - base[bpos + i]) & 0xFF for i in range(run))
+        npos += run
+        bpos += run
+
+        # Literals until new data lines up with the base again, preferring the current alignment
+        extra_start, target = npos, bpos
+        while npos < len(new):
+            key = new[npos:npos + ANCHOR]
+            aligned = bpos + (npos - extra_start)
+            if base[aligned:aligned + ANCHOR] == key:
+                target = aligned
+                break
+            if len(key) == ANCHOR and key in index:
+                target = index[key]
+                break
+            npos += 1
+        extra = new[extra_start:npos]
+
+        body += _varint(len(delta)) + delta + _varint(len(extra)) + extra + _varint(_zigzag(target - bpos))
+        bpos = target
+
+    return bytes(body)
+
+
+def apply(base: bytes, body: bytes, size: int) -> bytes:
+    """Reference applier, used to check every patch before it is written."""
+    out = bytearray()
+    pos = bpos = 0
+
+    def varint():
+        nonlocal pos
+        value = shift = 0
+        while True:
+            byte = body[pos]
+            pos += 1
+            value |= (byte & 0x7F) << shift
+            shift += 7
+            if not byte & 0x80:
+                return value
+
+    while len(out) < size:
+        count = varint()
+        out += bytes((body[pos + i] + base[bpos + i]) & 0xFF for i in range(count))
+        pos += count
+        bpos += count
+        count = varint()
+        out += body[pos:pos + count]
+        pos += count
+        seek = varint()
+        bpos += seek >> 1 if not seek & 1 else -(seek >> 1) - 1
+    return bytes(out)
+
+
+def make_patch(base: bytes, new: bytes, compress: bool = True) -> bytes:
+    body = diff(base, new)
+    if apply(base, body, len(new)) != new:
+        raise RuntimeError('patch does not reproduce the new image')
+
+    window_bits = lookahead_bits = 0
+    if compress:
+        packed = lzss_compress(body, LZSS_WINDOW_BITS, BODY_LOOKAHEAD_BITS)
+        if lzss_decompress(packed, LZSS_WINDOW_BITS, BODY_LOOKAHEAD_BITS, len(body)) != body:
+            raise RuntimeError('LZSS round trip failed')
+        body, window_bits, lookahead_bits = packed, LZSS_WINDOW_BITS, BODY_LOOKAHEAD_BITS
+
+    header = struct.pack('<4sBBBBII32s32s', DELTA_MAGIC, DELTA_FORMAT_BSDIFF, window_bits, lookahead_bits, 0,
+                         len(base), len(new), hashlib.sha256(base).digest(), hashlib.sha256(new).digest())
+    return header + body
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Make a delta OTA patch')
+    parser.add_argument('base', help='image the device runs')
+    parser.add_argument('new', help='image to update to')
+    parser.add_argument('-o', '--output', help='patch file (default: <new>.lcd)')
+    parser.add_argument('--stored', action='store_true', help='do not LZSS-compress the patch body')
+    args = parser.parse_args()
+
+    base = Path(args.base).read_bytes()
+    new = Path(args.new).read_bytes()
+    if not base or not new:
+        print('Error: empty image')
+        sys.exit(1)
+
+    patch = make_patch(base, new, not args.stored)
+    out_path = Path(args.output or f'{args.new}.lcd')
+    out_path.write_bytes(patch)
+    print(f"Patch written to: {out_path} ({len(patch)} bytes, {100 * len(patch) / len(new):.1f}% of {len(new)})")
+
+
+if __name__ == '__main__':
+    main()
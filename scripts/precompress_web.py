@@ -0,0 +1,101 @@
+#!/usr/bin/env python3
+"""Pre-compress the exported web UI and write the asset index the config server serves from.
+
+Next to every compressible file it writes <file>.gz (and <file>.br with --brotli) when that
+is actually smaller, and asset-index.txt at the root with one line per asset (the format is
+in components/config_wifi_server/include/web_assets.h):
+
+    <path>\t<sha256 prefix of the original>\t<g|b|gb|->
+
+Originals stay in place for clients that send no Accept-Encoding. Output is reproducible
+(gzip mtime 0, sorted index), so an unchanged UI gives a byte-identical LittleFS image.
+
+Browsers only offer br over HTTPS, and the config AP is plain HTTP, so brotli costs flash
+without a client that uses it; it is there for reverse-proxy or future TLS setups.
+
+Usage:
+    precompress_web.py web-interface/out [--brotli] [--min-size 256]
+"""
+
+import argparse
+import gzip
+import hashlib
+import sys
+from pathlib import Path
+
+INDEX_NAME = 'asset-index.txt'
+HASH_CHARS = 16  # 64 bits: a strong validator, short enough for every ETag header
+COMPRESSIBLE = {'.html', '.js', '.css', '.json', '.svg', '.txt', '.map', '.ico', '.xml', '.webmanifest'}
+
+
+def _gzip(data: bytes) -> bytes:
+    return gzip.compress(data, compresslevel=9, mtime=0)
+
+
+def _brotli(data: bytes) -> bytes:
+    import brotli  # pylint: disable=import-outside-toplevel
+    return brotli.compress(data, quality=11)
+
+
+def _write_variant(path: Path, suffix: str, original: bytes, packed: bytes) -> bool:
+    """Keep a variant only if it saves at least a few percent; remove a stale one otherwise."""
+    target = path.with_name(path.name + suffix)
+    if len(packed) < len(original) * 0.95:
+        target.write_bytes(packed)
+        return True
+    target.unlink(missing_ok=True)
+    return False
+
+
+def precompress(root: Path, use_brotli: bool, min_size: int) -> list:
+    entries = []
+    raw_total = sent_total = 0
+
+    for path in sorted(p for p in root.rglob('*') if p.is_file()):
+        if path.suffix in ('.gz', '.br') or path.name == INDEX_NAME:
+            continue
+        data = path.read_bytes()
+        url = '/' + path.relative_to(root).as_posix()
+        variants = ''
+
+        if path.suffix.lower() in COMPRESSIBLE and len(data) >= min_size:
+            if _write_variant(path, '.gz', data, _gzip(data)):
+                variants += 'g'
+            if use_brotli and _write_variant(path, '.br', data, _brotli(data)):
+                variants += 'b'
+
+        digest = hashlib.sha256(data).hexdigest()[:HASH_CHARS]
+        entries.append(f'{url}\t{digest}\t{variants or "-"}')
+
+        raw_total += len(data)
+        sent_total += path.with_name(path.name + '.gz').stat().st_size if 'g' in variants else len(data)
+
+    print(f'{len(entries)} assets, {raw_total} bytes; {sent_total} bytes sent gzip-encoded '
+          f'({100 * sent_total / max(raw_total, 1):.0f}%)')
+    return entries
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__.split('\n', 1)[0])
+    parser.add_argument('root', type=Path, help='static export directory (web-interface/out)')
+    parser.add_argument('--brotli', action='store_true', help='also write .br variants (needs the brotli module)')
+    parser.add_argument('--min-size', type=int, default=256, help='smaller files are not worth a variant')
+    args = parser.parse_args()
+
+    if not args.root.is_dir():
+        print(f'error: {args.root} is not a directory', file=sys.stderr)
+        return 1
+    if args.brotli:
+        try:
+            import brotli  # noqa: F401  pylint: disable=import-outside-toplevel,unused-import
+        except ImportError:
+            print('error: --brotli needs the brotli module (pip install brotli)', file=sys.stderr)
+            return 1
+
+    entries = precompress(args.root, args.brotli, args.min_size)
+    (args.root / INDEX_NAME).write_text('\n'.join(entries) + '\n')
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -1,9 +1,18 @@
 #!/usr/bin/env python3
-"""Sign firmware files with Ed25519 private key."""
+"""Sign firmware files with Ed25519 private key.
 
+With --compress, also package the file as a compressed OTA container (<file>.lcz) that
+ota_engine inflates while it streams in. The signature covers the uncompressed file, so the
+same <file>.sig verifies both forms. Container layout: components/ota_engine/include/ota_decompress.h
+"""
+
+import argparse
 import sys
 import hashlib
+import struct
 from pathlib import Path
+
+from lzss import LZSS_LOOKAHEAD_BITS, LZSS_WINDOW_BITS, lzss_compress, lzss_decompress
 from cryptography.hazmat.primitives import serialization
 from cryptography.hazmat.primitives.asymmetric import ed25519
 from cryptography.hazmat.backends import default_backend
@@ -33,13 +42,34 @@ def sign_file(file_path: Path, private_key_path: Path) -> str:
     return signature.hex()
 
 
+CONTAINER_MAGIC = b'LCZ1'
+CONTAINER_FORMAT_LZSS = 1
+def package(file_path: Path) -> Path:
+    """Write <file>.lcz and return its path."""
+    data = file_path.read_bytes()
+    stream = lzss_compress(data)
+    if lzss_decompress(stream, LZSS_WINDOW_BITS, LZSS_LOOKAHEAD_BITS, len(data)) != data:
+        raise RuntimeError('LZSS round trip failed')
+
+    header = struct.pack('<4sBBBBI32s', CONTAINER_MAGIC, CONTAINER_FORMAT_LZSS, LZSS_WINDOW_BITS,
+                         LZSS_LOOKAHEAD_BITS, 0, len(data), hashlib.sha256(data).digest())
+    out_path = file_path.with_suffix(file_path.suffix + '.lcz')
+    out_path.write_bytes(header + stream)
+    print(f"Container written to: {out_path} ({len(header) + len(stream)} of {len(data)} bytes, "
+          f"{100 * (len(header) + len(stream)) / len(data):.1f}%)")
+    return out_path
+
+
 def main():
-    if len(sys.argv) != 3:
-        print(f"Usage: {sys.argv[0]} <file_to_sign> <private_key_pem>")
-        sys.exit(1)
-    
-    file_path = Path(sys.argv[1])
-    private_key_path = Path(sys.argv[2])
+    parser = argparse.ArgumentParser(description='Sign a file with an Ed25519 private key')
+    parser.add_argument('file', help='file to sign')
+    parser.add_argument('private_key', help='Ed25519 private key (PEM)')
+    parser.add_argument('--compress', action='store_true',
+                        help='also write a compressed OTA container, <file>.lcz')
+    args = parser.parse_args()
+
+    file_path = Path(args.file)
+    private_key_path = Path(args.private_key)
     
     if not file_path.exists():
         print(f"Error: File not found: {file_path}")
@@ -57,6 +87,9 @@ def main():
     
     print(f"Signature written to: {sig_file}")
 
+    if args.compress:
+        package(file_path)
+
 
 if __name__ == '__main__':
     main()
@@ -0,0 +1,277 @@
+/**
+ * @file test_ble_ota_rx.c
+ * @brief BLE OTA protocol against a simulated central: chunks split across GATT writes, ACK
+ *        ordering, busy NAKs while the writer holds both buffers, and go-back-N after damage
+ */
+
+#include "unity.h"
+#include "ble_ota_rx.h"
+#include "esp_err.h"
+#include <string.h>
+
+#define CHUNK 256
+#define SLOT (OTA_BULK_HEADER_SIZE + CHUNK + OTA_BULK_CRC_SIZE)
+#define ATT_WRITE 100 // Payload of one write without response (ATT MTU 103)
+#define WINDOW 3      // Chunks the central keeps unacknowledged, as ble_ota_handler.h asks
+#define CHUNKS 12
+#define MAX_STATUS 256
+
+typedef struct {
+    ota_bulk_status_t type;
+    uint16_t seq;
+    int32_t value;
+} status_t;
+
+static uint8_t storage[OTA_BULK_STORAGE_SIZE(CHUNK)];
+static ble_ota_rx_t rx;
+static uint8_t payload[CHUNKS][CHUNK];
+
+// What the device did
+static status_t statuses[MAX_STATUS];
+static int status_count;
+static int blocks_queued;
+static uint8_t flashed[CHUNKS * CHUNK];
+static size_t flashed_len;
+static uint16_t flashed_seq[CHUNKS];
+static int flashed_count;
+
+static void copy_flat(void *ctx, const void *src, size_t off, size_t len, uint8_t *dst)
+{
+    (void)ctx;
+    memcpy(dst, (const uint8_t *)src + off, len);
+}
+
+static void record_status(void *ctx, ota_bulk_status_t type, uint16_t seq, int32_t value)
+{
+    (void)ctx;
+    TEST_ASSERT_TRUE(status_count < MAX_STATUS);
+    statuses[status_count++] = (status_t){.type = type, .seq = seq, .value = value};
+}
+
+static void count_block(void *ctx)
+{
+    (void)ctx;
+    blocks_queued++;
+}
+
+static const ble_ota_rx_ops_t ops = {
+    .copy   = copy_flat,
+    .status = record_status,
+    .block  = count_block,
+};
+
+static size_t make_chunk(uint8_t *out, uint16_t seq, uint8_t flags, const uint8_t *data, uint16_t len)
+{
+    out[0] = OTA_BULK_MAGIC;
+    out[1] = flags;
+    out[2] = (uint8_t)seq;
+    out[3] = (uint8_t)(seq >> 8);
+    out[4] = (uint8_t)len;
+    out[5] = (uint8_t)(len >> 8);
+    out[6] = 0;
+    out[7] = 0;
+    memcpy(out + OTA_BULK_HEADER_SIZE, data, len);
+    uint32_t crc = ota_bulk_crc32(0, out, OTA_BULK_HEADER_SIZE + len);
+    for (int i = 0; i < 4; i++) {
+        out[OTA_BULK_HEADER_SIZE + len + i] = (uint8_t)(crc >> (8 * i));
+    }
+    return OTA_BULK_HEADER_SIZE + len + OTA_BULK_CRC_SIZE;
+}
+
+// One chunk as consecutive writes of at most ATT_WRITE bytes
+static void send_chunk(uint16_t seq, uint8_t flags, bool damaged)
+{
+    uint8_t buf[SLOT];
+    size_t len = make_chunk(buf, seq, flags, payload[seq % CHUNKS], CHUNK);
+    if (damaged) {
+        buf[OTA_BULK_HEADER_SIZE + 10] ^= 0xFF;
+    }
+    for (size_t off = 0; off < len; off += ATT_WRITE) {
+        size_t n = len - off < ATT_WRITE ? len - off : ATT_WRITE;
+        ble_ota_rx_write(&rx, buf + off, n, &ops);
+    }
+}
+
+// The writer task: flash the oldest chunk and ACK it, as write_upload() does
+static bool write_one(void)
+{
+    const ota_bulk_block_t *block = ota_bulk_next_block(&rx.bulk);
+    if (!block) {
+        return false;
+    }
+    uint16_t seq = block->seq;
+    memcpy(flashed + flashed_len, block->data, block->len);
+    flashed_len += block->len;
+    flashed_seq[flashed_count++] = seq;
+    ota_bulk_release(&rx.bulk);
+    record_status(NULL, OTA_BULK_STATUS_ACK, seq + 1, ESP_OK);
+    return true;
+}
+
+/**
+ * @brief Upload CHUNKS chunks the way a central should
+ *
+ * Keeps WINDOW chunks unacknowledged, goes back on a NAK and, after a busy NAK, waits for the
+ * next ACK before resending. The writer flashes a chunk after every writer_every chunks sent
+ * and whenever the central has to wait.
+ */
+static void upload(int writer_every, int damaged_seq)
+{
+    uint16_t next  = 0;
+    uint16_t acked = 0;
+    bool busy      = false;
+    int seen       = 0;
+    int sent       = 0;
+
+    for (int step = 0;; step++) {
+        TEST_ASSERT_TRUE_MESSAGE(step < 10000, "upload stalled");
+
+        for (; seen < status_count; seen++) {
+            const status_t *s = &statuses[seen];
+            if (s->type == OTA_BULK_STATUS_ACK) {
+                acked = s->seq > acked ? s->seq : acked;
+                busy  = false;
+            } else if (s->type == OTA_BULK_STATUS_NAK) {
+                next = s->seq;
+                busy = s->value == ESP_ERR_NO_MEM;
+            }
+        }
+        if (acked == CHUNKS) {
+            return;
+        }
+        if (next < acked) {
+            next = acked;
+        }
+
+        if (!busy && next < CHUNKS && next < acked + WINDOW) {
+            uint8_t flags = next == CHUNKS - 1 ? OTA_BULK_FLAG_LAST : 0;
+            send_chunk(next, flags, next == damaged_seq);
+            if (next == damaged_seq) {
+                damaged_seq = -1; // The resend arrives intact
+            }
+            next++;
+            if (writer_every > 0 && ++sent % writer_every == 0) {
+                write_one();
+            }
+        } else {
+            TEST_ASSERT_TRUE_MESSAGE(write_one(), "central waits on a device with nothing to write");
+        }
+    }
+}
+
+static int count_naks(int32_t value)
+{
+    int n = 0;
+    for (int i = 0; i < status_count; i++) {
+        n += statuses[i].type == OTA_BULK_STATUS_NAK && statuses[i].value == value;
+    }
+    return n;
+}
+
+static void assert_image_flashed_in_order(void)
+{
+    TEST_ASSERT_EQUAL(CHUNKS, flashed_count);
+    TEST_ASSERT_EQUAL(CHUNKS * CHUNK, flashed_len);
+    for (int i = 0; i < CHUNKS; i++) {
+        TEST_ASSERT_EQUAL(i, flashed_seq[i]);
+        TEST_ASSERT_EQUAL_MEMORY(payload[i], flashed + i * CHUNK, CHUNK);
+    }
+    TEST_ASSERT_TRUE(rx.done);
+}
+
+void setUp(void)
+{
+    ble_ota_rx_start(&rx, storage, CHUNK);
+    uint32_t seed = 7;
+    for (int i = 0; i < CHUNKS; i++) {
+        for (int j = 0; j < CHUNK; j++) {
+            seed          = seed * 1103515245u + 12345u;
+            payload[i][j] = (uint8_t)(seed >> 16);
+        }
+    }
+    status_count  = 0;
+    blocks_queued = 0;
+    flashed_len   = 0;
+    flashed_count = 0;
+}
+
+void tearDown(void)
+{
+}
+
+void test_chunks_split_across_writes_are_flashed_and_acked_in_order(void)
+{
+    upload(1, -1);
+
+    assert_image_flashed_in_order();
+    TEST_ASSERT_EQUAL(CHUNKS, blocks_queued);
+    TEST_ASSERT_EQUAL(CHUNKS, status_count);
+    for (int i = 0; i < status_count; i++) {
+        TEST_ASSERT_EQUAL(OTA_BULK_STATUS_ACK, statuses[i].type);
+        TEST_ASSERT_EQUAL(i + 1, statuses[i].seq);
+    }
+}
+
+void test_busy_buffers_nak_once_and_the_central_resends_after_the_ack(void)
+{
+    upload(0, -1); // The writer only runs while the central waits
+
+    assert_image_flashed_in_order();
+    TEST_ASSERT_TRUE(count_naks(ESP_ERR_NO_MEM) > 0);
+    TEST_ASSERT_EQUAL(0, count_naks(ESP_ERR_INVALID_CRC));
+
+    // A busy NAK names the chunk after the two that hold the buffers, and another one needs an ACK first
+    bool nak_pending  = false;
+    uint16_t last_ack = 0;
+    for (int i = 0; i < status_count; i++) {
+        if (statuses[i].type == OTA_BULK_STATUS_NAK) {
+            TEST_ASSERT_FALSE(nak_pending);
+            TEST_ASSERT_EQUAL(last_ack + OTA_BULK_BUFFERS, statuses[i].seq);
+            nak_pending = true;
+        } else {
+            last_ack    = statuses[i].seq;
+            nak_pending = false;
+        }
+    }
+}
+
+void test_damaged_chunk_naks_and_goes_back_to_it(void)
+{
+    upload(1, 5);
+
+    assert_image_flashed_in_order();
+    TEST_ASSERT_EQUAL(1, count_naks(ESP_ERR_INVALID_CRC));
+    TEST_ASSERT_EQUAL(1, rx.bulk.crc_errors);
+    for (int i = 0; i < status_count; i++) {
+        if (statuses[i].type == OTA_BULK_STATUS_NAK) {
+            TEST_ASSERT_EQUAL(5, statuses[i].seq);
+        }
+    }
+}
+
+void test_writes_after_the_last_chunk_are_ignored(void)
+{
+    upload(1, -1);
+    int statuses_before = status_count;
+
+    send_chunk(CHUNKS, 0, false);
+    TEST_ASSERT_EQUAL(CHUNKS, blocks_queued);
+    TEST_ASSERT_EQUAL(statuses_before, status_count);
+    TEST_ASSERT_NULL(ota_bulk_next_block(&rx.bulk));
+}
+
+void test_abort_chunk_ends_reception(void)
+{
+    send_chunk(0, 0, false);
+    send_chunk(1, OTA_BULK_FLAG_ABORT, false);
+    TEST_ASSERT_TRUE(rx.done);
+
+    send_chunk(2, 0, false);
+    TEST_ASSERT_EQUAL(2, blocks_queued);
+    TEST_ASSERT_EQUAL(0, status_count);
+
+    write_one();
+    const ota_bulk_block_t *block = ota_bulk_next_block(&rx.bulk);
+    TEST_ASSERT_NOT_NULL(block);
+    TEST_ASSERT_EQUAL(OTA_BULK_FLAG_ABORT, block->flags);
+}
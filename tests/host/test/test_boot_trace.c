@@ -0,0 +1,178 @@
+/**
+ * @file test_boot_trace.c
+ * @brief Unit tests for the boot trace buffer and the LoRa-ready latency budget
+ */
+
+#include "unity.h"
+#include "boot_stages.h"
+#include "trace_buffer.h"
+#include <stdint.h>
+#include <string.h>
+
+#define MS_US 1000ULL
+
+static trace_buffer_t trace;
+
+// Simulated target for the stubbed boot
+static uint64_t clock_us;
+static uint32_t free_heap;
+
+void setUp(void)
+{
+    trace_buffer_init(&trace);
+    clock_us  = 0;
+    free_heap = 200000;
+}
+
+void tearDown(void)
+{
+}
+
+// Stub driver: takes its full budget (worst case on target) and allocates 1 KB
+static void run_stubbed_stage(boot_stage_t stage)
+{
+    const boot_stage_info_t *info = boot_stage_info(stage);
+    int id = trace_buffer_begin(&trace, info->name, info->budget_us, clock_us, free_heap);
+    clock_us += info->budget_us;
+    free_heap -= 1024;
+    trace_buffer_end(&trace, id, clock_us, free_heap);
+}
+
+void test_span_records_duration_and_heap_delta(void)
+{
+    int id = trace_buffer_begin(&trace, "nvs", 0, 10 * MS_US, 5000);
+    TEST_ASSERT_EQUAL(0, id);
+    TEST_ASSERT_TRUE(trace.spans[id].open);
+    TEST_ASSERT_EQUAL(0, trace_span_duration_us(&trace.spans[id]));
+
+    TEST_ASSERT_EQUAL(ESP_OK, trace_buffer_end(&trace, id, 25 * MS_US, 4000));
+    TEST_ASSERT_EQUAL(15 * MS_US, trace_span_duration_us(&trace.spans[id]));
+    TEST_ASSERT_EQUAL(-1000, trace.spans[id].heap_delta);
+    TEST_ASSERT_EQUAL(0, trace.depth);
+}
+
+void test_nested_spans_record_depth(void)
+{
+    int outer = trace_buffer_begin(&trace, "lora", 0, 0, 0);
+    int inner = trace_buffer_begin(&trace, "calibrate", 0, 1, 0);
+    TEST_ASSERT_EQUAL(0, trace.spans[outer].depth);
+    TEST_ASSERT_EQUAL(1, trace.spans[inner].depth);
+
+    trace_buffer_end(&trace, inner, 2, 0);
+    trace_buffer_end(&trace, outer, 3, 0);
+    TEST_ASSERT_EQUAL(0, trace.depth);
+}
+
+void test_spans_on_other_tracks_do_not_nest(void)
+{
+    int radio = trace_buffer_begin_on(&trace, 0, "lora_driver", 0, 0, 0);
+    int ui    = trace_buffer_begin_on(&trace, 1, "ui", 0, 1, 0);
+    int cal   = trace_buffer_begin_on(&trace, 0, "calibrate", 0, 2, 0);
+    TEST_ASSERT_EQUAL(0, trace.spans[radio].depth);
+    TEST_ASSERT_EQUAL(0, trace.spans[ui].depth);
+    TEST_ASSERT_EQUAL(1, trace.spans[ui].track);
+    TEST_ASSERT_EQUAL(1, trace.spans[cal].depth);
+    TEST_ASSERT_EQUAL(-1, trace_buffer_begin_on(&trace, TRACE_BUFFER_MAX_TRACKS, "bad", 0, 0, 0));
+
+    trace_buffer_end(&trace, radio, 3, 0); // Ends before the UI span on the other core
+    trace_buffer_end(&trace, cal, 3, 0);
+    trace_buffer_end(&trace, ui, 4, 0);
+    TEST_ASSERT_EQUAL(0, trace.depth);
+    TEST_ASSERT_EQUAL(0, trace.track_depth[0]);
+    TEST_ASSERT_EQUAL(0, trace.track_depth[1]);
+}
+
+void test_end_rejects_unknown_and_closed_spans(void)
+{
+    int id = trace_buffer_begin(&trace, "bsp", 0, 0, 0);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, trace_buffer_end(&trace, -1, 1, 0));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, trace_buffer_end(&trace, id + 1, 1, 0));
+    TEST_ASSERT_EQUAL(ESP_OK, trace_buffer_end(&trace, id, 1, 0));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, trace_buffer_end(&trace, id, 2, 0));
+}
+
+void test_end_before_begin_does_not_underflow(void)
+{
+    int id = trace_buffer_begin(&trace, "ui", 0, 100, 0);
+    trace_buffer_end(&trace, id, 50, 0);
+    TEST_ASSERT_EQUAL(0, trace_span_duration_us(&trace.spans[id]));
+}
+
+void test_marks_are_instant_and_findable(void)
+{
+    trace_buffer_mark(&trace, "app_main", 300 * MS_US, 0);
+    int id = trace_buffer_mark(&trace, "lora_ready", 700 * MS_US, 0);
+
+    TEST_ASSERT_EQUAL(id, trace_buffer_find(&trace, "lora_ready"));
+    TEST_ASSERT_TRUE(trace.spans[id].instant);
+    TEST_ASSERT_FALSE(trace.spans[id].open);
+    TEST_ASSERT_EQUAL(700 * MS_US, trace.spans[id].start_us);
+    TEST_ASSERT_EQUAL(-1, trace_buffer_find(&trace, "missing"));
+}
+
+void test_full_buffer_counts_drops(void)
+{
+    for (int i = 0; i < TRACE_BUFFER_MAX_SPANS; i++) {
+        TEST_ASSERT_NOT_EQUAL(-1, trace_buffer_mark(&trace, "m", i, 0));
+    }
+    TEST_ASSERT_EQUAL(-1, trace_buffer_begin(&trace, "late", 0, 0, 0));
+    TEST_ASSERT_EQUAL(-1, trace_buffer_mark(&trace, "late", 0, 0));
+    TEST_ASSERT_EQUAL(2, trace.dropped);
+    TEST_ASSERT_EQUAL(0, trace.depth);
+}
+
+void test_over_budget_reports_worst_span(void)
+{
+    int a = trace_buffer_begin(&trace, "a", 10 * MS_US, 0, 0);
+    trace_buffer_end(&trace, a, 15 * MS_US, 0); // 5 ms over
+    int b = trace_buffer_begin(&trace, "b", 10 * MS_US, 0, 0);
+    trace_buffer_end(&trace, b, 30 * MS_US, 0); // 20 ms over
+    int c = trace_buffer_begin(&trace, "c", 0, 0, 0);
+    trace_buffer_end(&trace, c, 100 * MS_US, 0); // No budget
+
+    int worst;
+    TEST_ASSERT_EQUAL(2, trace_buffer_over_budget(&trace, &worst));
+    TEST_ASSERT_EQUAL(b, worst);
+}
+
+void test_stage_table_is_complete(void)
+{
+    for (int i = 0; i < BOOT_STAGE_COUNT; i++) {
+        const boot_stage_info_t *info = boot_stage_info((boot_stage_t)i);
+        TEST_ASSERT_NOT_NULL(info);
+        TEST_ASSERT_NOT_NULL(info->name);
+        TEST_ASSERT_GREATER_THAN(0, info->budget_us);
+        for (int j = 0; j < i; j++) {
+            TEST_ASSERT_NOT_EQUAL(0, strcmp(info->name, boot_stage_info((boot_stage_t)j)->name));
+        }
+    }
+    TEST_ASSERT_NULL(boot_stage_info(BOOT_STAGE_COUNT));
+}
+
+// Regression gate: adding a stage before LoRa ready or raising a stage budget must not
+// push the first LoRa packet past BOOT_LORA_READY_BUDGET_US
+void test_lora_ready_budget_covers_preceding_stages(void)
+{
+    uint64_t needed = BOOT_PRE_APP_BUDGET_US + boot_stages_budget_until(BOOT_STAGE_LORA_READY);
+    TEST_ASSERT_TRUE(needed <= BOOT_LORA_READY_BUDGET_US);
+}
+
+void test_stubbed_boot_reaches_lora_ready_within_budget(void)
+{
+    clock_us = BOOT_PRE_APP_BUDGET_US;
+    trace_buffer_mark(&trace, "app_main", clock_us, free_heap);
+    for (int stage = 0; stage <= BOOT_STAGE_LORA_READY; stage++) {
+        run_stubbed_stage((boot_stage_t)stage);
+    }
+    trace_buffer_mark(&trace, "lora_ready", clock_us, free_heap);
+    for (int stage = BOOT_STAGE_LORA_READY + 1; stage < BOOT_STAGE_COUNT; stage++) {
+        run_stubbed_stage((boot_stage_t)stage);
+    }
+
+    int ready = trace_buffer_find(&trace, "lora_ready");
+    TEST_ASSERT_NOT_EQUAL(-1, ready);
+    TEST_ASSERT_TRUE(trace.spans[ready].start_us <= BOOT_LORA_READY_BUDGET_US);
+    TEST_ASSERT_EQUAL(0, trace_buffer_over_budget(&trace, NULL));
+    TEST_ASSERT_EQUAL(0, trace.dropped);
+    TEST_ASSERT_EQUAL(-1024, trace.spans[trace_buffer_find(&trace, "lora_driver")].heap_delta);
+}
@@ -0,0 +1,294 @@
+/**
+ * @file test_command_sched.c
+ * @brief Unit tests for the JSON-RPC worker pool scheduler: ordering, fairness and a
+ *        multi-transport stress test with per-request response routing
+ */
+
+#define _DEFAULT_SOURCE // usleep() under -std=c11
+
+#include "unity.h"
+#include "command_sched.h"
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static command_sched_t sched;
+static char lines[COMMAND_TRANSPORT_COUNT][COMMAND_SCHED_DEPTH + 1][8];
+
+void setUp(void)
+{
+    command_sched_init(&sched);
+}
+
+void tearDown(void)
+{
+}
+
+void test_empty_scheduler_has_no_work(void)
+{
+    command_job_t job;
+    TEST_ASSERT_FALSE(command_sched_next(&sched, &job));
+    TEST_ASSERT_EQUAL(0, command_sched_pending(&sched, COMMAND_TRANSPORT_BLE));
+}
+
+void test_push_rejects_invalid_and_full(void)
+{
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, command_sched_push(&sched, COMMAND_TRANSPORT_COUNT, lines[0][0]));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, command_sched_push(&sched, COMMAND_TRANSPORT_UART, NULL));
+
+    for (int i = 0; i < COMMAND_SCHED_DEPTH; i++) {
+        TEST_ASSERT_EQUAL(ESP_OK, command_sched_push(&sched, COMMAND_TRANSPORT_UART, lines[0][i]));
+    }
+    TEST_ASSERT_EQUAL(ESP_ERR_NO_MEM,
+                      command_sched_push(&sched, COMMAND_TRANSPORT_UART, lines[0][COMMAND_SCHED_DEPTH]));
+    TEST_ASSERT_EQUAL(COMMAND_SCHED_DEPTH, command_sched_pending(&sched, COMMAND_TRANSPORT_UART));
+
+    // Other transports have their own queues
+    TEST_ASSERT_EQUAL(ESP_OK, command_sched_push(&sched, COMMAND_TRANSPORT_BLE, lines[1][0]));
+}
+
+void test_one_transport_runs_in_order_and_never_twice(void)
+{
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_EQUAL(ESP_OK, command_sched_push(&sched, COMMAND_TRANSPORT_USB_CDC, lines[0][i]));
+    }
+
+    command_job_t job;
+    TEST_ASSERT_TRUE(command_sched_next(&sched, &job));
+    TEST_ASSERT_EQUAL_PTR(lines[0][0], job.line);
+    TEST_ASSERT_EQUAL(COMMAND_TRANSPORT_USB_CDC, job.transport);
+
+    // The second request must wait until the first finished, even with idle workers
+    TEST_ASSERT_FALSE(command_sched_next(&sched, &job));
+
+    command_sched_done(&sched, COMMAND_TRANSPORT_USB_CDC);
+    TEST_ASSERT_TRUE(command_sched_next(&sched, &job));
+    TEST_ASSERT_EQUAL_PTR(lines[0][1], job.line);
+    command_sched_done(&sched, COMMAND_TRANSPORT_USB_CDC);
+    TEST_ASSERT_TRUE(command_sched_next(&sched, &job));
+    TEST_ASSERT_EQUAL_PTR(lines[0][2], job.line);
+}
+
+void test_transports_run_in_parallel_round_robin(void)
+{
+    for (int t = 0; t < COMMAND_TRANSPORT_COUNT; t++) {
+        for (int i = 0; i < 2; i++) {
+            TEST_ASSERT_EQUAL(ESP_OK, command_sched_push(&sched, (command_transport_t)t, lines[t][i]));
+        }
+    }
+
+    // One request per transport can be in flight at once
+    command_job_t jobs[COMMAND_TRANSPORT_COUNT];
+    for (int t = 0; t < COMMAND_TRANSPORT_COUNT; t++) {
+        TEST_ASSERT_TRUE(command_sched_next(&sched, &jobs[t]));
+        TEST_ASSERT_EQUAL(t, jobs[t].transport);
+    }
+    command_job_t job;
+    TEST_ASSERT_FALSE(command_sched_next(&sched, &job));
+
+    // A finishing transport does not jump the queue ahead of the others
+    for (int t = 0; t < COMMAND_TRANSPORT_COUNT; t++) {
+        command_sched_done(&sched, (command_transport_t)t);
+    }
+    TEST_ASSERT_TRUE(command_sched_next(&sched, &job));
+    TEST_ASSERT_EQUAL(COMMAND_TRANSPORT_USB_CDC, job.transport);
+    TEST_ASSERT_EQUAL_PTR(lines[0][1], job.line);
+    TEST_ASSERT_TRUE(command_sched_next(&sched, &job));
+    TEST_ASSERT_EQUAL(COMMAND_TRANSPORT_BLE, job.transport);
+}
+
+void test_chatty_transport_does_not_starve_others(void)
+{
+    TEST_ASSERT_EQUAL(ESP_OK, command_sched_push(&sched, COMMAND_TRANSPORT_USB_CDC, lines[0][0]));
+    TEST_ASSERT_EQUAL(ESP_OK, command_sched_push(&sched, COMMAND_TRANSPORT_USB_CDC, lines[0][1]));
+
+    command_job_t job;
+    TEST_ASSERT_TRUE(command_sched_next(&sched, &job));
+    TEST_ASSERT_EQUAL(ESP_OK, command_sched_push(&sched, COMMAND_TRANSPORT_UART, lines[2][0]));
+    command_sched_done(&sched, COMMAND_TRANSPORT_USB_CDC);
+
+    TEST_ASSERT_TRUE(command_sched_next(&sched, &job));
+    TEST_ASSERT_EQUAL(COMMAND_TRANSPORT_UART, job.transport);
+}
+
+// Stress: transports fire interleaved requests at a pool that mirrors commands.c (pool lock,
+// counting wakeup semaphore, workers draining runnable work). Each request carries its id;
+// the fake executor answers through a per-request context and the transport's route.
+#define STRESS_WORKERS 3
+#define STRESS_REQUESTS 3000 // Per transport
+
+typedef struct {
+    void (*send)(const char *response, void *ctx);
+    void *ctx;
+} stress_route_t;
+
+typedef struct {
+    int transport;
+    atomic_int responses;
+    atomic_int mismatched; ///< Response for another transport or out of order
+    int last_seq;
+} stress_client_t;
+
+typedef struct {
+    const stress_route_t *route;
+    long id;
+} stress_request_t;
+
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static sem_t pool_work;
+static atomic_bool stress_done;
+static atomic_int executing[COMMAND_TRANSPORT_COUNT];
+static atomic_int overlap; ///< Two requests of one transport executing at once
+static atomic_int concurrent;
+static atomic_int max_concurrent;
+static stress_client_t clients[COMMAND_TRANSPORT_COUNT];
+static stress_route_t routes[COMMAND_TRANSPORT_COUNT];
+
+static void stress_send(const char *response, void *ctx)
+{
+    stress_client_t *client = ctx;
+    long id;
+    if (sscanf(response, "{\"result\":\"pong\",\"id\":%ld}", &id) != 1 || id / 1000000 != client->transport ||
+        id % 1000000 != client->last_seq + 1) {
+        atomic_fetch_add(&client->mismatched, 1);
+    } else {
+        client->last_seq = (int)(id % 1000000);
+    }
+    atomic_fetch_add(&client->responses, 1);
+}
+
+static void stress_execute(const char *line, const stress_route_t *route)
+{
+    stress_request_t req = {.route = route};
+    if (sscanf(line, "{\"method\":\"ping\",\"id\":%ld}", &req.id) != 1) {
+        req.id = -1;
+    }
+
+    int now = atomic_fetch_add(&concurrent, 1) + 1;
+    int max = atomic_load(&max_concurrent);
+    while (now > max && !atomic_compare_exchange_weak(&max_concurrent, &max, now)) {
+    }
+    if (req.id % 64 == 0) {
+        usleep(50); // A slow handler (BLE chunking, flash write) must not block other transports
+    } else {
+        sched_yield();
+    }
+
+    char response[64];
+    snprintf(response, sizeof(response), "{\"result\":\"pong\",\"id\":%ld}", req.id);
+    req.route->send(response, req.route->ctx);
+    atomic_fetch_sub(&concurrent, 1);
+}
+
+static void *stress_worker(void *arg)
+{
+    (void)arg;
+    while (1) {
+        sem_wait(&pool_work);
+        if (atomic_load(&stress_done)) {
+            return NULL;
+        }
+
+        command_job_t job;
+        while (1) {
+            pthread_mutex_lock(&pool_lock);
+            bool found = command_sched_next(&sched, &job);
+            pthread_mutex_unlock(&pool_lock);
+            if (!found) {
+                break;
+            }
+
+            if (atomic_fetch_add(&executing[job.transport], 1) != 0) {
+                atomic_fetch_add(&overlap, 1);
+            }
+            stress_execute(job.line, &routes[job.transport]);
+            atomic_fetch_sub(&executing[job.transport], 1);
+            free(job.line);
+
+            pthread_mutex_lock(&pool_lock);
+            command_sched_done(&sched, job.transport);
+            pthread_mutex_unlock(&pool_lock);
+        }
+    }
+}
+
+static void *stress_transport(void *arg)
+{
+    int transport = (int)(intptr_t)arg;
+    for (int seq = 1; seq <= STRESS_REQUESTS; seq++) {
+        char *line = malloc(48);
+        snprintf(line, 48, "{\"method\":\"ping\",\"id\":%ld}", (long)transport * 1000000 + seq);
+
+        // Like commands_submit(): a full queue is reported to the transport, which retries here
+        while (1) {
+            pthread_mutex_lock(&pool_lock);
+            esp_err_t ret = command_sched_push(&sched, (command_transport_t)transport, line);
+            pthread_mutex_unlock(&pool_lock);
+            if (ret == ESP_OK) {
+                break;
+            }
+            sched_yield();
+        }
+        sem_post(&pool_work);
+    }
+    return NULL;
+}
+
+void test_concurrent_transports_get_their_own_responses_in_order(void)
+{
+    TEST_ASSERT_EQUAL(0, sem_init(&pool_work, 0, 0));
+    atomic_store(&stress_done, false);
+    atomic_store(&overlap, 0);
+    atomic_store(&concurrent, 0);
+    atomic_store(&max_concurrent, 0);
+    for (int t = 0; t < COMMAND_TRANSPORT_COUNT; t++) {
+        clients[t].transport = t;
+        clients[t].last_seq  = 0;
+        atomic_store(&clients[t].responses, 0);
+        atomic_store(&clients[t].mismatched, 0);
+        atomic_store(&executing[t], 0);
+        routes[t].send = stress_send;
+        routes[t].ctx  = &clients[t];
+    }
+
+    pthread_t workers[STRESS_WORKERS];
+    pthread_t transports[COMMAND_TRANSPORT_COUNT];
+    for (int i = 0; i < STRESS_WORKERS; i++) {
+        TEST_ASSERT_EQUAL(0, pthread_create(&workers[i], NULL, stress_worker, NULL));
+    }
+    for (int t = 0; t < COMMAND_TRANSPORT_COUNT; t++) {
+        TEST_ASSERT_EQUAL(0, pthread_create(&transports[t], NULL, stress_transport, (void *)(intptr_t)t));
+    }
+    for (int t = 0; t < COMMAND_TRANSPORT_COUNT; t++) {
+        pthread_join(transports[t], NULL);
+    }
+
+    // Every request answered: wait for the pool to drain
+    for (int t = 0; t < COMMAND_TRANSPORT_COUNT; t++) {
+        while (atomic_load(&clients[t].responses) < STRESS_REQUESTS) {
+            sched_yield();
+        }
+    }
+    atomic_store(&stress_done, true);
+    for (int i = 0; i < STRESS_WORKERS; i++) {
+        sem_post(&pool_work);
+    }
+    for (int i = 0; i < STRESS_WORKERS; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    sem_destroy(&pool_work);
+
+    for (int t = 0; t < COMMAND_TRANSPORT_COUNT; t++) {
+        TEST_ASSERT_EQUAL(STRESS_REQUESTS, atomic_load(&clients[t].responses));
+        TEST_ASSERT_EQUAL(0, atomic_load(&clients[t].mismatched));
+        TEST_ASSERT_EQUAL(STRESS_REQUESTS, clients[t].last_seq);
+        TEST_ASSERT_EQUAL(0, command_sched_pending(&sched, (command_transport_t)t));
+    }
+    TEST_ASSERT_EQUAL(0, atomic_load(&overlap));
+    TEST_ASSERT_TRUE(atomic_load(&max_concurrent) > 1);
+}
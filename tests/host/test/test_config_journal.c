@@ -0,0 +1,324 @@
+/**
+ * @file test_config_journal.c
+ * @brief Unit tests for deferred config persistence: coalescing, torn writes and flash wear
+ */
+
+#include "unity.h"
+#include "config_journal.h"
+#include "config_snapshot.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SIM_PAGE_SIZE 4096
+#define SIM_ENTRY_SIZE 32 // NVS stores blobs as 32-byte entries plus one header entry
+#define QUIET_MS 2000
+#define MAX_DELAY_MS 10000
+#define CRASH_ITERATIONS 2000
+
+/**
+ * @brief Simulated NVS-like flash: records are appended to pages and a full page costs an erase
+ */
+typedef struct {
+    uint8_t slots[CONFIG_JOURNAL_SLOTS][sizeof(config_journal_record_t)];
+    size_t stored[CONFIG_JOURNAL_SLOTS]; ///< 0 = slot never written
+    size_t page_used;
+    int erase_count;
+    int write_count;
+    int fail_writes; ///< Number of upcoming writes that fail without touching flash
+    int tear_at;     ///< >0: next write loses power after this many bytes
+} sim_flash_t;
+
+static sim_flash_t flash;
+static config_journal_backend_t backend;
+static config_coalescer_t coalescer;
+static config_journal_t journal;
+static power_config_t power;
+
+static esp_err_t sim_read(void *ctx, uint8_t slot, void *buf, size_t *len)
+{
+    sim_flash_t *sim = ctx;
+    if (!sim->stored[slot]) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (*len < sim->stored[slot]) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(buf, sim->slots[slot], sim->stored[slot]);
+    *len = sim->stored[slot];
+    return ESP_OK;
+}
+
+static esp_err_t sim_write(void *ctx, uint8_t slot, const void *buf, size_t len)
+{
+    sim_flash_t *sim = ctx;
+    if (sim->fail_writes > 0) {
+        sim->fail_writes--;
+        return ESP_FAIL;
+    }
+
+    size_t bytes = ((len + SIM_ENTRY_SIZE - 1) / SIM_ENTRY_SIZE + 1) * SIM_ENTRY_SIZE;
+    if (sim->page_used + bytes > SIM_PAGE_SIZE) {
+        sim->erase_count++;
+        sim->page_used = 0;
+    }
+    sim->page_used += bytes;
+    sim->write_count++;
+    sim->stored[slot] = len;
+
+    if (sim->tear_at > 0) {
+        // Power lost: the head of the record landed, the rest is still erased
+        size_t landed = (size_t)sim->tear_at < len ? (size_t)sim->tear_at : len;
+        memset(sim->slots[slot], 0xFF, len);
+        memcpy(sim->slots[slot], buf, landed);
+        sim->tear_at = 0;
+        return ESP_FAIL;
+    }
+    memcpy(sim->slots[slot], buf, len);
+    return ESP_OK;
+}
+
+// What the persist task does once the coalescer says a flush is due
+static void flush_if_due(uint32_t now_ms)
+{
+    if (config_coalescer_due_in(&coalescer, now_ms) != 0) {
+        return;
+    }
+    uint32_t dirty = config_coalescer_take(&coalescer);
+    if ((dirty & CONFIG_SECTION_POWER) &&
+        config_journal_write(&journal, &backend, &power, sizeof(power)) != ESP_OK) {
+        config_coalescer_mark(&coalescer, CONFIG_SECTION_POWER, now_ms);
+    }
+}
+
+static power_config_t reopen(esp_err_t expected)
+{
+    power_config_t restored;
+    memset(&restored, 0xAA, sizeof(restored));
+    TEST_ASSERT_EQUAL(expected, config_journal_open(&journal, &backend, &restored, sizeof(restored)));
+    return restored;
+}
+
+void setUp(void)
+{
+    memset(&flash, 0, sizeof(flash));
+    memset(&journal, 0, sizeof(journal));
+    memset(&power, 0, sizeof(power));
+    backend.read  = sim_read;
+    backend.write = sim_write;
+    backend.ctx   = &flash;
+    config_coalescer_init(&coalescer, QUIET_MS, MAX_DELAY_MS);
+}
+
+void tearDown(void)
+{
+}
+
+void test_open_empty_journal(void)
+{
+    reopen(ESP_ERR_NOT_FOUND);
+    TEST_ASSERT_EQUAL(0, journal.generation);
+}
+
+void test_write_then_reopen_restores_newest(void)
+{
+    reopen(ESP_ERR_NOT_FOUND);
+    for (uint32_t i = 1; i <= 3; i++) {
+        power.light_sleep_timeout_ms = i;
+        TEST_ASSERT_EQUAL(ESP_OK, config_journal_write(&journal, &backend, &power, sizeof(power)));
+    }
+    TEST_ASSERT_TRUE(flash.stored[0] && flash.stored[1]);
+
+    power_config_t restored = reopen(ESP_OK);
+    TEST_ASSERT_EQUAL(3, restored.light_sleep_timeout_ms);
+    TEST_ASSERT_EQUAL(3, journal.generation);
+}
+
+void test_torn_write_falls_back_to_previous_record(void)
+{
+    reopen(ESP_ERR_NOT_FOUND);
+    power.light_sleep_timeout_ms = 1;
+    TEST_ASSERT_EQUAL(ESP_OK, config_journal_write(&journal, &backend, &power, sizeof(power)));
+
+    size_t record_size = CONFIG_JOURNAL_HEADER_SIZE + sizeof(power);
+    for (size_t landed = 1; landed < record_size; landed++) {
+        power.light_sleep_timeout_ms = 2;
+        flash.tear_at                = (int)landed;
+        TEST_ASSERT_EQUAL(ESP_FAIL, config_journal_write(&journal, &backend, &power, sizeof(power)));
+
+        power_config_t restored = reopen(ESP_OK);
+        TEST_ASSERT_EQUAL(1, restored.light_sleep_timeout_ms);
+    }
+}
+
+void test_failed_write_keeps_state(void)
+{
+    reopen(ESP_ERR_NOT_FOUND);
+    power.light_sleep_timeout_ms = 1;
+    TEST_ASSERT_EQUAL(ESP_OK, config_journal_write(&journal, &backend, &power, sizeof(power)));
+    config_journal_t before = journal;
+
+    flash.fail_writes = 1;
+    TEST_ASSERT_EQUAL(ESP_FAIL, config_journal_write(&journal, &backend, &power, sizeof(power)));
+    TEST_ASSERT_EQUAL(before.generation, journal.generation);
+    TEST_ASSERT_EQUAL(before.active_slot, journal.active_slot);
+}
+
+void test_corrupted_newest_record_falls_back(void)
+{
+    reopen(ESP_ERR_NOT_FOUND);
+    for (uint32_t i = 1; i <= 2; i++) {
+        power.light_sleep_timeout_ms = i;
+        TEST_ASSERT_EQUAL(ESP_OK, config_journal_write(&journal, &backend, &power, sizeof(power)));
+    }
+    flash.slots[journal.active_slot][CONFIG_JOURNAL_HEADER_SIZE] ^= 0x01;
+
+    power_config_t restored = reopen(ESP_OK);
+    TEST_ASSERT_EQUAL(1, restored.light_sleep_timeout_ms);
+    TEST_ASSERT_EQUAL(1, journal.generation);
+}
+
+void test_record_of_other_layout_is_ignored(void)
+{
+    // A firmware update changed the struct size: the old record must not be loaded
+    uint8_t old_layout[sizeof(power_config_t) - 4] = {1, 2, 3};
+    reopen(ESP_ERR_NOT_FOUND);
+    TEST_ASSERT_EQUAL(ESP_OK, config_journal_write(&journal, &backend, old_layout, sizeof(old_layout)));
+
+    power_config_t restored = reopen(ESP_ERR_NOT_FOUND);
+    TEST_ASSERT_EQUAL_HEX8(0xAA, ((uint8_t *)&restored)[0]);
+}
+
+void test_oversized_payload_is_rejected(void)
+{
+    uint8_t big[CONFIG_JOURNAL_MAX_PAYLOAD + 1] = {0};
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, config_journal_write(&journal, &backend, big, sizeof(big)));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, config_journal_open(&journal, &backend, big, sizeof(big)));
+    TEST_ASSERT_EQUAL(0, flash.write_count);
+}
+
+void test_coalescer_waits_for_quiet_period(void)
+{
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, config_coalescer_due_in(&coalescer, 0));
+
+    config_coalescer_mark(&coalescer, CONFIG_SECTION_POWER, 1000);
+    TEST_ASSERT_EQUAL_UINT32(QUIET_MS, config_coalescer_due_in(&coalescer, 1000));
+    config_coalescer_mark(&coalescer, CONFIG_SECTION_GENERAL, 2500);
+    TEST_ASSERT_EQUAL_UINT32(QUIET_MS - 500, config_coalescer_due_in(&coalescer, 3000));
+    TEST_ASSERT_EQUAL_UINT32(0, config_coalescer_due_in(&coalescer, 2500 + QUIET_MS));
+
+    TEST_ASSERT_EQUAL_UINT32(CONFIG_SECTION_POWER | CONFIG_SECTION_GENERAL, config_coalescer_take(&coalescer));
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, config_coalescer_due_in(&coalescer, 5000));
+}
+
+void test_coalescer_max_delay_bounds_continuous_changes(void)
+{
+    uint32_t now = 0;
+    for (; now < MAX_DELAY_MS; now += 100) {
+        config_coalescer_mark(&coalescer, CONFIG_SECTION_LORA, now);
+        TEST_ASSERT_TRUE(config_coalescer_due_in(&coalescer, now) <= MAX_DELAY_MS - now);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, config_coalescer_due_in(&coalescer, now));
+}
+
+void test_coalescer_clamps_max_delay_and_handles_wrap(void)
+{
+    config_coalescer_init(&coalescer, QUIET_MS, 10);
+    TEST_ASSERT_EQUAL_UINT32(QUIET_MS, coalescer.max_delay_ms);
+
+    uint32_t near_wrap = UINT32_MAX - 500;
+    config_coalescer_mark(&coalescer, CONFIG_SECTION_POWER, near_wrap);
+    TEST_ASSERT_EQUAL_UINT32(QUIET_MS - 1000, config_coalescer_due_in(&coalescer, near_wrap + 1000));
+    TEST_ASSERT_EQUAL_UINT32(0, config_coalescer_due_in(&coalescer, near_wrap + QUIET_MS));
+}
+
+void test_encoder_scroll_coalesces_into_one_write(void)
+{
+    reopen(ESP_ERR_NOT_FOUND);
+
+    // 60 detents, 50 ms apart, then the user lets go
+    uint32_t now = 0;
+    for (int detent = 0; detent < 60; detent++, now += 50) {
+        power.cpu_freq_mhz = (uint8_t)detent;
+        config_coalescer_mark(&coalescer, CONFIG_SECTION_POWER, now);
+        flush_if_due(now);
+    }
+    TEST_ASSERT_EQUAL(0, flash.write_count);
+
+    for (; now < 60 * 50 + QUIET_MS; now += 10) {
+        flush_if_due(now);
+    }
+    TEST_ASSERT_EQUAL(1, flash.write_count);
+    TEST_ASSERT_EQUAL(59, reopen(ESP_OK).cpu_freq_mhz);
+}
+
+void test_coalescing_saves_erase_cycles_against_write_through(void)
+{
+    sim_flash_t write_through               = {0};
+    config_journal_t direct                 = {0};
+    config_journal_backend_t direct_backend = {sim_read, sim_write, &write_through};
+    reopen(ESP_ERR_NOT_FOUND);
+
+    // 40 sessions of 100 detents each, 5 s apart
+    uint32_t now = 0;
+    for (int session = 0; session < 40; session++) {
+        for (int detent = 0; detent < 100; detent++, now += 40) {
+            power.display_sleep_timeout_ms = (uint32_t)(session * 100 + detent);
+            TEST_ASSERT_EQUAL(ESP_OK, config_journal_write(&direct, &direct_backend, &power, sizeof(power)));
+            config_coalescer_mark(&coalescer, CONFIG_SECTION_POWER, now);
+            flush_if_due(now);
+        }
+        for (uint32_t end = now + 5000; now < end; now += 10) {
+            flush_if_due(now);
+        }
+    }
+
+    TEST_ASSERT_EQUAL(4000, write_through.write_count);
+    TEST_ASSERT_EQUAL(40, flash.write_count);
+    TEST_ASSERT_TRUE(write_through.erase_count >= 50);
+    TEST_ASSERT_TRUE(flash.erase_count * 50 <= write_through.erase_count);
+    TEST_ASSERT_EQUAL(3999, reopen(ESP_OK).display_sleep_timeout_ms);
+}
+
+void test_failed_flush_is_retried(void)
+{
+    reopen(ESP_ERR_NOT_FOUND);
+    power.cpu_freq_mhz = 80;
+    config_coalescer_mark(&coalescer, CONFIG_SECTION_POWER, 0);
+
+    flash.fail_writes = 1;
+    flush_if_due(QUIET_MS);
+    TEST_ASSERT_EQUAL(0, flash.write_count);
+    TEST_ASSERT_EQUAL_UINT32(QUIET_MS, config_coalescer_due_in(&coalescer, QUIET_MS));
+
+    flush_if_due(2 * QUIET_MS);
+    TEST_ASSERT_EQUAL(1, flash.write_count);
+    TEST_ASSERT_EQUAL(80, reopen(ESP_OK).cpu_freq_mhz);
+}
+
+void test_power_loss_never_restores_garbage(void)
+{
+    srand(1234);
+    reopen(ESP_ERR_NOT_FOUND);
+    uint32_t durable = 0;
+    size_t record    = CONFIG_JOURNAL_HEADER_SIZE + sizeof(power);
+
+    for (uint32_t i = 1; i <= CRASH_ITERATIONS; i++) {
+        power.deep_sleep_timeout_ms  = i;
+        power.light_sleep_timeout_ms = ~i;
+        if (rand() % 3 == 0) {
+            flash.tear_at = 1 + rand() % (int)(record - 1);
+        }
+        if (config_journal_write(&journal, &backend, &power, sizeof(power)) == ESP_OK) {
+            durable = i;
+        }
+
+        // Reboot: whatever is restored must be the last durable value, never a mix
+        power_config_t restored = reopen(durable ? ESP_OK : ESP_ERR_NOT_FOUND);
+        if (durable) {
+            TEST_ASSERT_EQUAL_UINT32(durable, restored.deep_sleep_timeout_ms);
+            TEST_ASSERT_EQUAL_UINT32(~durable, restored.light_sleep_timeout_ms);
+        }
+    }
+}
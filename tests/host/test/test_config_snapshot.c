@@ -0,0 +1,239 @@
+/**
+ * @file test_config_snapshot.c
+ * @brief Unit tests for versioned config snapshots: pinning, slot reuse, subscribers and torn reads
+ */
+
+#include "unity.h"
+#include "config_snapshot.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <string.h>
+
+static general_config_t general;
+static power_config_t power;
+static lora_config_t lora;
+
+static int notify_count;
+static uint32_t notify_changed;
+static uint32_t notify_version;
+
+static void on_publish(const config_snapshot_t *snapshot, uint32_t changed, void *ctx)
+{
+    notify_count++;
+    notify_changed = changed;
+    notify_version = snapshot->version;
+    (*(int *)ctx)++;
+}
+
+void setUp(void)
+{
+    memset(&general, 0, sizeof(general));
+    memset(&power, 0, sizeof(power));
+    memset(&lora, 0, sizeof(lora));
+    strcpy(general.device_name, "test");
+    general.device_mode = DEVICE_MODE_PRESENTER;
+    power.cpu_freq_mhz  = 160;
+    lora.frequency      = 868100000;
+    notify_count        = 0;
+    notify_changed      = 0;
+
+    // Module state persists across tests; make sure one snapshot exists
+    if (config_snapshot_version() == 0) {
+        TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, config_snapshot_publish(&general, NULL, &lora));
+        TEST_ASSERT_EQUAL(0, config_snapshot_version());
+    }
+    TEST_ASSERT_EQUAL(ESP_OK, config_snapshot_publish(&general, &power, &lora));
+}
+
+void tearDown(void)
+{
+}
+
+void test_acquire_returns_published_values(void)
+{
+    const config_snapshot_t *snapshot = config_snapshot_acquire();
+    TEST_ASSERT_NOT_NULL(snapshot);
+    TEST_ASSERT_EQUAL_STRING("test", snapshot->general.device_name);
+    TEST_ASSERT_EQUAL(160, snapshot->power.cpu_freq_mhz);
+    TEST_ASSERT_EQUAL(868100000, snapshot->lora.frequency);
+    TEST_ASSERT_EQUAL(snapshot->version, config_snapshot_version());
+    config_snapshot_release(snapshot);
+}
+
+void test_partial_publish_carries_other_sections(void)
+{
+    uint32_t before     = config_snapshot_version();
+    general.device_mode = DEVICE_MODE_PC;
+    TEST_ASSERT_EQUAL(ESP_OK, config_snapshot_publish(&general, NULL, NULL));
+
+    const config_snapshot_t *snapshot = config_snapshot_acquire();
+    TEST_ASSERT_EQUAL(DEVICE_MODE_PC, snapshot->general.device_mode);
+    TEST_ASSERT_EQUAL(160, snapshot->power.cpu_freq_mhz);
+    TEST_ASSERT_EQUAL(868100000, snapshot->lora.frequency);
+    TEST_ASSERT_TRUE(snapshot->version > before);
+    config_snapshot_release(snapshot);
+}
+
+void test_pinned_snapshot_is_immutable_across_publishes(void)
+{
+    const config_snapshot_t *pinned = config_snapshot_acquire();
+    uint32_t version                = pinned->version;
+
+    // Far more publishes than slots: the pinned slot must never be reused
+    for (int i = 0; i < CONFIG_SNAPSHOT_SLOTS * 3; i++) {
+        lora.frequency = 902000000 + i;
+        TEST_ASSERT_EQUAL(ESP_OK, config_snapshot_publish(NULL, NULL, &lora));
+    }
+
+    TEST_ASSERT_EQUAL(version, pinned->version);
+    TEST_ASSERT_EQUAL(868100000, pinned->lora.frequency);
+    config_snapshot_release(pinned);
+
+    const config_snapshot_t *latest = config_snapshot_acquire();
+    TEST_ASSERT_NOT_EQUAL(pinned, latest);
+    TEST_ASSERT_EQUAL(902000000 + CONFIG_SNAPSHOT_SLOTS * 3 - 1, latest->lora.frequency);
+    config_snapshot_release(latest);
+}
+
+void test_publish_fails_when_every_other_slot_is_pinned(void)
+{
+    const config_snapshot_t *pins[CONFIG_SNAPSHOT_SLOTS];
+    pins[0] = config_snapshot_acquire();
+    for (int i = 1; i < CONFIG_SNAPSHOT_SLOTS; i++) {
+        TEST_ASSERT_EQUAL(ESP_OK, config_snapshot_publish(NULL, &power, NULL));
+        pins[i] = config_snapshot_acquire();
+    }
+
+    uint32_t version = config_snapshot_version();
+    TEST_ASSERT_EQUAL(ESP_ERR_NO_MEM, config_snapshot_publish(NULL, &power, NULL));
+    TEST_ASSERT_EQUAL(version, config_snapshot_version());
+
+    config_snapshot_release(pins[0]);
+    TEST_ASSERT_EQUAL(ESP_OK, config_snapshot_publish(NULL, &power, NULL));
+    for (int i = 1; i < CONFIG_SNAPSHOT_SLOTS; i++) {
+        config_snapshot_release(pins[i]);
+    }
+}
+
+void test_subscribers_get_changed_sections(void)
+{
+    int calls = 0;
+    TEST_ASSERT_EQUAL(ESP_OK, config_snapshot_subscribe(on_publish, &calls));
+
+    power.cpu_freq_mhz = 80;
+    TEST_ASSERT_EQUAL(ESP_OK, config_snapshot_publish(NULL, &power, NULL));
+    TEST_ASSERT_EQUAL(1, calls);
+    TEST_ASSERT_EQUAL(CONFIG_SECTION_POWER, notify_changed);
+    TEST_ASSERT_EQUAL(config_snapshot_version(), notify_version);
+
+    // Rewriting identical values still publishes, but reports nothing changed
+    TEST_ASSERT_EQUAL(ESP_OK, config_snapshot_publish(&general, &power, &lora));
+    TEST_ASSERT_EQUAL(2, calls);
+    TEST_ASSERT_EQUAL(0, notify_changed);
+
+    TEST_ASSERT_EQUAL(ESP_OK, config_snapshot_unsubscribe(on_publish, &calls));
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, config_snapshot_unsubscribe(on_publish, &calls));
+    TEST_ASSERT_EQUAL(ESP_OK, config_snapshot_publish(NULL, &power, NULL));
+    TEST_ASSERT_EQUAL(2, calls);
+}
+
+void test_subscriber_table_is_bounded(void)
+{
+    int ctx[CONFIG_SNAPSHOT_MAX_SUBSCRIBERS + 1];
+    for (int i = 0; i < CONFIG_SNAPSHOT_MAX_SUBSCRIBERS; i++) {
+        TEST_ASSERT_EQUAL(ESP_OK, config_snapshot_subscribe(on_publish, &ctx[i]));
+    }
+    TEST_ASSERT_EQUAL(ESP_ERR_NO_MEM, config_snapshot_subscribe(on_publish, &ctx[CONFIG_SNAPSHOT_MAX_SUBSCRIBERS]));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, config_snapshot_subscribe(NULL, NULL));
+    for (int i = 0; i < CONFIG_SNAPSHOT_MAX_SUBSCRIBERS; i++) {
+        TEST_ASSERT_EQUAL(ESP_OK, config_snapshot_unsubscribe(on_publish, &ctx[i]));
+    }
+}
+
+// Every field of a published snapshot is derived from one counter; a reader that ever sees
+// fields from two different publishes has observed a torn or recycled snapshot. At every
+// checkpoint the publisher waits for each reader to finish a read, so reads overlap the
+// publishes however the host schedules the threads (a single core included)
+#define STRESS_READERS 3
+#define STRESS_PUBLISHES 20000
+#define STRESS_CHECKPOINT 500
+
+static atomic_bool stress_done;
+static atomic_int stress_torn;
+static atomic_int stress_reads[STRESS_READERS];
+
+static void wait_for_every_reader(void)
+{
+    int seen[STRESS_READERS];
+    for (int i = 0; i < STRESS_READERS; i++) {
+        seen[i] = atomic_load(&stress_reads[i]);
+    }
+    for (int i = 0; i < STRESS_READERS; i++) {
+        while (atomic_load(&stress_reads[i]) == seen[i]) {
+            sched_yield();
+        }
+    }
+}
+
+static void *stress_reader(void *arg)
+{
+    atomic_int *reads     = arg;
+    uint32_t last_version = 0;
+    while (!atomic_load(&stress_done)) {
+        const config_snapshot_t *s = config_snapshot_acquire();
+        uint32_t n                 = s->lora.frequency;
+        if (s->power.light_sleep_timeout_ms != n || s->general.display_contrast != (uint8_t)n ||
+            s->lora.bandwidth != (uint16_t)n || s->version < last_version) {
+            atomic_fetch_add(&stress_torn, 1);
+        }
+        last_version = s->version;
+        config_snapshot_release(s);
+        atomic_fetch_add(reads, 1);
+    }
+    return NULL;
+}
+
+void test_concurrent_readers_never_see_torn_snapshots(void)
+{
+    atomic_store(&stress_done, false);
+    atomic_store(&stress_torn, 0);
+    for (int i = 0; i < STRESS_READERS; i++) {
+        atomic_store(&stress_reads[i], 0);
+    }
+
+    general.display_contrast     = 0;
+    power.light_sleep_timeout_ms = 0;
+    lora.bandwidth               = 0;
+    lora.frequency               = 0;
+    TEST_ASSERT_EQUAL(ESP_OK, config_snapshot_publish(&general, &power, &lora));
+
+    pthread_t readers[STRESS_READERS];
+    for (int i = 0; i < STRESS_READERS; i++) {
+        TEST_ASSERT_EQUAL(0, pthread_create(&readers[i], NULL, stress_reader, &stress_reads[i]));
+    }
+
+    for (uint32_t n = 1; n <= STRESS_PUBLISHES; n++) {
+        general.display_contrast     = (uint8_t)n;
+        power.light_sleep_timeout_ms = n;
+        lora.bandwidth               = (uint16_t)n;
+        lora.frequency               = n;
+        // Readers hold pins only briefly; a full slot table just means try again
+        while (config_snapshot_publish(&general, &power, &lora) == ESP_ERR_NO_MEM) {
+        }
+        if (n % STRESS_CHECKPOINT == 0) {
+            wait_for_every_reader();
+        }
+    }
+
+    atomic_store(&stress_done, true);
+    for (int i = 0; i < STRESS_READERS; i++) {
+        pthread_join(readers[i], NULL);
+    }
+
+    TEST_ASSERT_EQUAL(0, atomic_load(&stress_torn));
+    for (int i = 0; i < CONFIG_SNAPSHOT_SLOTS; i++) {
+        // No pins leaked: a full round of publishes succeeds without retries
+        TEST_ASSERT_EQUAL(ESP_OK, config_snapshot_publish(NULL, &power, NULL));
+    }
+}
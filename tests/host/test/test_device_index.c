@@ -0,0 +1,203 @@
+/**
+ * @file test_device_index.c
+ * @brief Unit tests and lookup benchmark for the device registry hash index
+ */
+
+#define _POSIX_C_SOURCE 199309L // clock_gettime
+
+#include "unity.h"
+#include "device_index.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#define MAX_TEST_DEVICES 128
+#define BENCH_LOOKUPS 200000
+
+static device_index_bucket_t buckets[DEVICE_INDEX_BUCKETS(MAX_TEST_DEVICES)];
+static device_index_t index_under_test;
+
+// MAC-derived IDs (mac[4] << 8 | mac[5]) from one vendor range share high bytes
+static uint16_t test_device_id(size_t n)
+{
+    return (uint16_t)(0xA400 + n * 7);
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+void setUp(void)
+{
+    TEST_ASSERT_EQUAL(ESP_OK, device_index_init(&index_under_test, buckets, DEVICE_INDEX_BUCKETS(MAX_TEST_DEVICES)));
+}
+
+void tearDown(void)
+{
+}
+
+void test_init_rejects_non_power_of_two(void)
+{
+    device_index_t idx;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, device_index_init(&idx, buckets, 12));
+}
+
+void test_bucket_count_keeps_load_factor_at_half(void)
+{
+    TEST_ASSERT_EQUAL(8, DEVICE_INDEX_BUCKETS(4));
+    TEST_ASSERT_EQUAL(64, DEVICE_INDEX_BUCKETS(32));
+    TEST_ASSERT_EQUAL(256, DEVICE_INDEX_BUCKETS(128));
+}
+
+void test_find_on_empty_index(void)
+{
+    TEST_ASSERT_EQUAL(-1, device_index_find(&index_under_test, 0x1234));
+}
+
+void test_put_and_find(void)
+{
+    TEST_ASSERT_EQUAL(ESP_OK, device_index_put(&index_under_test, 0x1234, 3));
+    TEST_ASSERT_EQUAL(3, device_index_find(&index_under_test, 0x1234));
+    TEST_ASSERT_EQUAL(-1, device_index_find(&index_under_test, 0x1235));
+}
+
+void test_device_id_zero_is_valid_key(void)
+{
+    TEST_ASSERT_EQUAL(ESP_OK, device_index_put(&index_under_test, 0x0000, 7));
+    TEST_ASSERT_EQUAL(7, device_index_find(&index_under_test, 0x0000));
+}
+
+void test_put_existing_updates_slot(void)
+{
+    device_index_put(&index_under_test, 0xBEEF, 1);
+    device_index_put(&index_under_test, 0xBEEF, 9);
+    TEST_ASSERT_EQUAL(9, device_index_find(&index_under_test, 0xBEEF));
+    TEST_ASSERT_EQUAL(1, index_under_test.count);
+}
+
+void test_put_rejects_empty_slot_marker(void)
+{
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, device_index_put(&index_under_test, 0x1000, DEVICE_INDEX_EMPTY_SLOT));
+}
+
+void test_fill_to_capacity(void)
+{
+    for (size_t i = 0; i < MAX_TEST_DEVICES; i++) {
+        TEST_ASSERT_EQUAL(ESP_OK, device_index_put(&index_under_test, test_device_id(i), (uint16_t)i));
+    }
+    TEST_ASSERT_EQUAL(ESP_ERR_NO_MEM, device_index_put(&index_under_test, 0x0001, 0));
+
+    for (size_t i = 0; i < MAX_TEST_DEVICES; i++) {
+        TEST_ASSERT_EQUAL((int)i, device_index_find(&index_under_test, test_device_id(i)));
+    }
+}
+
+void test_remove_keeps_probe_chains_intact(void)
+{
+    for (size_t i = 0; i < MAX_TEST_DEVICES; i++) {
+        device_index_put(&index_under_test, test_device_id(i), (uint16_t)i);
+    }
+
+    // Remove every third entry, then verify all others are still reachable
+    for (size_t i = 0; i < MAX_TEST_DEVICES; i += 3) {
+        TEST_ASSERT_EQUAL(ESP_OK, device_index_remove(&index_under_test, test_device_id(i)));
+    }
+
+    for (size_t i = 0; i < MAX_TEST_DEVICES; i++) {
+        int expected = (i % 3 == 0) ? -1 : (int)i;
+        TEST_ASSERT_EQUAL(expected, device_index_find(&index_under_test, test_device_id(i)));
+    }
+}
+
+void test_remove_missing_device(void)
+{
+    device_index_put(&index_under_test, 0x1111, 0);
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, device_index_remove(&index_under_test, 0x2222));
+    TEST_ASSERT_EQUAL(1, index_under_test.count);
+}
+
+void test_colliding_ids_with_wraparound(void)
+{
+    // IDs that differ only above the bucket mask collide in a small table
+    device_index_bucket_t small[8];
+    device_index_t idx;
+    device_index_init(&idx, small, 8);
+
+    uint16_t ids[4] = {0x0001, 0x0101, 0x0201, 0x0301};
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL(ESP_OK, device_index_put(&idx, ids[i], (uint16_t)i));
+    }
+    TEST_ASSERT_EQUAL(ESP_OK, device_index_remove(&idx, ids[1]));
+    TEST_ASSERT_EQUAL(0, device_index_find(&idx, ids[0]));
+    TEST_ASSERT_EQUAL(-1, device_index_find(&idx, ids[1]));
+    TEST_ASSERT_EQUAL(2, device_index_find(&idx, ids[2]));
+    TEST_ASSERT_EQUAL(3, device_index_find(&idx, ids[3]));
+}
+
+// Linear scan equivalent of the previous registry lookup, for comparison
+static int linear_find(const uint16_t *ids, size_t count, uint16_t device_id)
+{
+    for (size_t i = 0; i < count; i++) {
+        if (ids[i] == device_id) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+static void run_lookup_benchmark(size_t device_count)
+{
+    uint16_t ids[MAX_TEST_DEVICES];
+    device_index_bucket_t bench_buckets[DEVICE_INDEX_BUCKETS(MAX_TEST_DEVICES)];
+    device_index_t idx;
+    size_t bucket_count = (device_count <= 4)    ? DEVICE_INDEX_BUCKETS(4)
+                          : (device_count <= 32) ? DEVICE_INDEX_BUCKETS(32)
+                                                 : DEVICE_INDEX_BUCKETS(128);
+    device_index_init(&idx, bench_buckets, bucket_count);
+
+    for (size_t i = 0; i < device_count; i++) {
+        ids[i] = test_device_id(i);
+        device_index_put(&idx, ids[i], (uint16_t)i);
+    }
+
+    volatile int sink = 0;
+    uint64_t start    = now_ns();
+    for (size_t n = 0; n < BENCH_LOOKUPS; n++) {
+        sink += device_index_find(&idx, ids[n % device_count]);
+    }
+    uint64_t hash_ns = now_ns() - start;
+
+    start = now_ns();
+    for (size_t n = 0; n < BENCH_LOOKUPS; n++) {
+        sink += linear_find(ids, device_count, ids[n % device_count]);
+    }
+    uint64_t linear_ns = now_ns() - start;
+
+    printf("[BENCH][device_index] %3zu devices: hash %6.1f ns/lookup, linear %6.1f ns/lookup\n", device_count,
+           (double)hash_ns / BENCH_LOOKUPS, (double)linear_ns / BENCH_LOOKUPS);
+
+    // Every benchmark lookup must hit
+    for (size_t i = 0; i < device_count; i++) {
+        TEST_ASSERT_EQUAL((int)i, device_index_find(&idx, ids[i]));
+    }
+    (void)sink;
+}
+
+void test_benchmark_lookup_4_devices(void)
+{
+    run_lookup_benchmark(4);
+}
+
+void test_benchmark_lookup_32_devices(void)
+{
+    run_lookup_benchmark(32);
+}
+
+void test_benchmark_lookup_128_devices(void)
+{
+    run_lookup_benchmark(128);
+}
@@ -0,0 +1,176 @@
+/**
+ * @file test_energy_model.c
+ * @brief Unit tests for power-state residency accounting and battery-life projection
+ */
+
+#include "unity.h"
+#include "energy_model.h"
+#include <stdint.h>
+
+#define SEC_US 1000000ULL
+
+static energy_model_t model;
+
+// Zero all coefficients so tests control the expected current exactly
+static void clear_coefficients(void)
+{
+    for (int c = 0; c < ENERGY_COMPONENT_COUNT; c++) {
+        for (uint8_t s = 0; s < ENERGY_MAX_STATES; s++) {
+            energy_model_set_coefficient(&model, (energy_component_t)c, s, 0);
+        }
+    }
+}
+
+void setUp(void)
+{
+    energy_model_init(&model, 0);
+}
+
+void tearDown(void)
+{
+}
+
+void test_boot_state(void)
+{
+    TEST_ASSERT_EQUAL(ENERGY_CPU_ACTIVE, model.state[ENERGY_COMPONENT_CPU]);
+    TEST_ASSERT_EQUAL(ENERGY_DISPLAY_ON, model.state[ENERGY_COMPONENT_DISPLAY]);
+    TEST_ASSERT_EQUAL(ENERGY_RADIO_SLEEP, model.state[ENERGY_COMPONENT_RADIO]);
+    TEST_ASSERT_EQUAL(ENERGY_LED_OFF, model.state[ENERGY_COMPONENT_LED]);
+}
+
+void test_residency_includes_ongoing_state(void)
+{
+    energy_model_set_state(&model, ENERGY_COMPONENT_RADIO, ENERGY_RADIO_RX, 1 * SEC_US);
+    energy_model_set_state(&model, ENERGY_COMPONENT_RADIO, ENERGY_RADIO_TX, 4 * SEC_US);
+
+    uint64_t now = 5 * SEC_US;
+    TEST_ASSERT_EQUAL(1 * SEC_US, energy_model_residency_us(&model, ENERGY_COMPONENT_RADIO, ENERGY_RADIO_SLEEP, now));
+    TEST_ASSERT_EQUAL(3 * SEC_US, energy_model_residency_us(&model, ENERGY_COMPONENT_RADIO, ENERGY_RADIO_RX, now));
+    TEST_ASSERT_EQUAL(1 * SEC_US, energy_model_residency_us(&model, ENERGY_COMPONENT_RADIO, ENERGY_RADIO_TX, now));
+    TEST_ASSERT_EQUAL(2, model.transitions[ENERGY_COMPONENT_RADIO]);
+}
+
+void test_repeated_state_is_not_a_transition(void)
+{
+    energy_model_set_state(&model, ENERGY_COMPONENT_LED, ENERGY_LED_ON, 1 * SEC_US);
+    energy_model_set_state(&model, ENERGY_COMPONENT_LED, ENERGY_LED_ON, 2 * SEC_US);
+    TEST_ASSERT_EQUAL(1, model.transitions[ENERGY_COMPONENT_LED]);
+    TEST_ASSERT_EQUAL(2 * SEC_US, energy_model_residency_us(&model, ENERGY_COMPONENT_LED, ENERGY_LED_ON, 3 * SEC_US));
+}
+
+void test_out_of_order_timestamp_does_not_underflow(void)
+{
+    energy_model_set_state(&model, ENERGY_COMPONENT_CPU, ENERGY_CPU_LIGHT_SLEEP, 5 * SEC_US);
+    energy_model_set_state(&model, ENERGY_COMPONENT_CPU, ENERGY_CPU_ACTIVE, 4 * SEC_US);
+    uint64_t active_us = energy_model_residency_us(&model, ENERGY_COMPONENT_CPU, ENERGY_CPU_ACTIVE, 5 * SEC_US);
+    TEST_ASSERT_EQUAL(5 * SEC_US, active_us);
+}
+
+void test_invalid_state_rejected(void)
+{
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, energy_model_set_state(&model, ENERGY_COMPONENT_DISPLAY, 3, 0));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, energy_model_set_state(&model, ENERGY_COMPONENT_COUNT, 0, 0));
+    TEST_ASSERT_NULL(energy_model_state_name(ENERGY_COMPONENT_LED, 3));
+}
+
+void test_charge_is_weighted_residency(void)
+{
+    clear_coefficients();
+    energy_model_set_coefficient(&model, ENERGY_COMPONENT_CPU, ENERGY_CPU_ACTIVE, 10000);
+    energy_model_set_coefficient(&model, ENERGY_COMPONENT_CPU, ENERGY_CPU_LIGHT_SLEEP, 1000);
+
+    // 10 s active, 90 s light sleep
+    energy_model_set_state(&model, ENERGY_COMPONENT_CPU, ENERGY_CPU_LIGHT_SLEEP, 10 * SEC_US);
+    TEST_ASSERT_EQUAL_FLOAT(10000.0 * 10 + 1000.0 * 90, energy_model_charge_uas(&model, 100 * SEC_US));
+
+    energy_report_t report;
+    energy_model_report(&model, 100 * SEC_US, 1000.0f, &report);
+    TEST_ASSERT_EQUAL(1900, report.modeled_avg_ua);
+    TEST_ASSERT_EQUAL(1900, report.calibrated_avg_ua);
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, 1000.0f * 1000.0f / 1900.0f, report.projected_hours);
+}
+
+void test_calibration_scales_model_to_measurement(void)
+{
+    clear_coefficients();
+    energy_model_set_coefficient(&model, ENERGY_COMPONENT_CPU, ENERGY_CPU_ACTIVE, 10000);
+
+    // Gauge measures 15 mA where the model predicts 10 mA
+    TEST_ASSERT_EQUAL(ESP_OK, energy_model_calibrate(&model, 15000, 10 * SEC_US));
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 1.5f, model.scale);
+
+    energy_report_t report;
+    energy_model_report(&model, 10 * SEC_US, 1000.0f, &report);
+    TEST_ASSERT_EQUAL(10000, report.modeled_avg_ua);
+    TEST_ASSERT_EQUAL(15000, report.calibrated_avg_ua);
+    TEST_ASSERT_EQUAL(15000, report.last_measured_ua);
+}
+
+void test_calibration_converges_on_repeated_samples(void)
+{
+    clear_coefficients();
+    energy_model_set_coefficient(&model, ENERGY_COMPONENT_CPU, ENERGY_CPU_ACTIVE, 10000);
+
+    energy_model_calibrate(&model, 20000, 5 * SEC_US); // First sample: scale 2.0
+    for (int i = 2; i <= 40; i++) {
+        energy_model_calibrate(&model, 12000, (uint64_t)i * 5 * SEC_US);
+    }
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 1.2f, model.scale);
+}
+
+void test_calibration_window_too_short(void)
+{
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, energy_model_calibrate(&model, 10000, ENERGY_CAL_MIN_WINDOW_US - 1));
+    TEST_ASSERT_EQUAL(0, model.calibration_samples);
+}
+
+void test_charging_sample_restarts_window(void)
+{
+    clear_coefficients();
+    energy_model_set_coefficient(&model, ENERGY_COMPONENT_CPU, ENERGY_CPU_ACTIVE, 10000);
+
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, energy_model_calibrate(&model, -500, 10 * SEC_US));
+    TEST_ASSERT_EQUAL(10 * SEC_US, model.cal_window_start_us);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, energy_model_calibrate(&model, 10000, 11 * SEC_US));
+    TEST_ASSERT_EQUAL(ESP_OK, energy_model_calibrate(&model, 10000, 20 * SEC_US));
+}
+
+void test_calibration_scale_is_clamped(void)
+{
+    clear_coefficients();
+    energy_model_set_coefficient(&model, ENERGY_COMPONENT_CPU, ENERGY_CPU_ACTIVE, 1000);
+
+    energy_model_calibrate(&model, 1000000, 10 * SEC_US); // Implausible gauge reading
+    TEST_ASSERT_EQUAL_FLOAT(ENERGY_CAL_SCALE_MAX, model.scale);
+}
+
+void test_calibration_uses_window_not_lifetime_average(void)
+{
+    clear_coefficients();
+    energy_model_set_coefficient(&model, ENERGY_COMPONENT_RADIO, ENERGY_RADIO_SLEEP, 1000);
+    energy_model_set_coefficient(&model, ENERGY_COMPONENT_RADIO, ENERGY_RADIO_TX, 41000);
+
+    energy_model_calibrate(&model, 1000, 10 * SEC_US); // Model exact: scale 1.0
+
+    // Next window: half TX, half sleep -> modeled 21 mA
+    energy_model_set_state(&model, ENERGY_COMPONENT_RADIO, ENERGY_RADIO_TX, 15 * SEC_US);
+    energy_model_set_state(&model, ENERGY_COMPONENT_RADIO, ENERGY_RADIO_SLEEP, 20 * SEC_US);
+    energy_model_calibrate(&model, 21000, 20 * SEC_US);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 1.0f, model.scale);
+}
+
+void test_default_model_projects_finite_battery_life(void)
+{
+    energy_report_t report;
+    energy_model_report(&model, 3600 * SEC_US, 1000.0f, &report);
+    TEST_ASSERT_GREATER_THAN(0, report.modeled_avg_ua);
+    TEST_ASSERT_TRUE(report.projected_hours > 0.0f);
+    TEST_ASSERT_EQUAL(3600000, report.residency_ms[ENERGY_COMPONENT_DISPLAY][ENERGY_DISPLAY_ON]);
+}
+
+void test_component_and_state_names(void)
+{
+    TEST_ASSERT_EQUAL_STRING("radio", energy_model_component_name(ENERGY_COMPONENT_RADIO));
+    TEST_ASSERT_EQUAL_STRING("tx", energy_model_state_name(ENERGY_COMPONENT_RADIO, ENERGY_RADIO_TX));
+    TEST_ASSERT_EQUAL_STRING("light_sleep", energy_model_state_name(ENERGY_COMPONENT_CPU, ENERGY_CPU_LIGHT_SLEEP));
+}
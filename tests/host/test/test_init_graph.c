@@ -0,0 +1,217 @@
+/**
+ * @file test_init_graph.c
+ * @brief Unit tests for the init dependency graph, critical path and parallel boot schedule
+ */
+
+#include "unity.h"
+#include "boot_stages.h"
+#include "init_graph.h"
+#include <stdint.h>
+
+#define MS_US 1000ULL
+#define BIT(id) (1UL << (id))
+
+static init_graph_t graph;
+
+void setUp(void)
+{
+    init_graph_init(&graph);
+}
+
+void tearDown(void)
+{
+}
+
+// Diamond plus a slow independent branch:
+//   a(10) -> b(30) -> d(10)   target d
+//   a(10) -> c(5)  -> d
+//   e(100) independent
+static void build_diamond(void)
+{
+    init_graph_add(&graph, "a", 0, 10 * MS_US, NULL);
+    init_graph_add(&graph, "b", BIT(0), 30 * MS_US, NULL);
+    init_graph_add(&graph, "c", BIT(0), 5 * MS_US, NULL);
+    init_graph_add(&graph, "d", BIT(1) | BIT(2), 10 * MS_US, NULL);
+    init_graph_add(&graph, "e", 0, 100 * MS_US, NULL);
+    TEST_ASSERT_EQUAL(ESP_OK, init_graph_finalize(&graph, BIT(3)));
+}
+
+static void build_boot_graph(void)
+{
+    for (int i = 0; i < BOOT_STAGE_COUNT; i++) {
+        const boot_stage_info_t *info = boot_stage_info((boot_stage_t)i);
+        TEST_ASSERT_EQUAL(ESP_OK, init_graph_add(&graph, info->name, info->deps, info->budget_us, NULL));
+    }
+    TEST_ASSERT_EQUAL(ESP_OK,
+                      init_graph_finalize(&graph, BOOT_DEP(BOOT_STAGE_LORA_READY) | BOOT_DEP(BOOT_STAGE_KEYPRESS_READY)));
+}
+
+void test_unknown_dependency_rejected(void)
+{
+    init_graph_add(&graph, "a", BIT(5), 0, NULL);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, init_graph_finalize(&graph, 0));
+}
+
+void test_unknown_target_rejected(void)
+{
+    init_graph_add(&graph, "a", 0, 0, NULL);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, init_graph_finalize(&graph, BIT(1)));
+}
+
+void test_cycle_rejected(void)
+{
+    init_graph_add(&graph, "root", 0, 0, NULL);
+    init_graph_add(&graph, "a", BIT(0) | BIT(2), 0, NULL);
+    init_graph_add(&graph, "b", BIT(1), 0, NULL);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, init_graph_finalize(&graph, 0));
+    TEST_ASSERT_FALSE(graph.finalized);
+}
+
+void test_forward_dependency_allowed(void)
+{
+    int late;
+    init_graph_add(&graph, "late_dep", BIT(1), 0, NULL);
+    init_graph_add(&graph, "first", 0, 0, &late);
+    TEST_ASSERT_EQUAL(ESP_OK, init_graph_finalize(&graph, 0));
+    TEST_ASSERT_EQUAL(late, graph.order[0]);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, init_graph_add(&graph, "after", 0, 0, NULL));
+}
+
+void test_critical_set_is_target_ancestors(void)
+{
+    build_diamond();
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_TRUE(init_graph_is_critical(&graph, i));
+    }
+    TEST_ASSERT_FALSE(init_graph_is_critical(&graph, 4));
+}
+
+void test_pick_prefers_critical_over_longer_work(void)
+{
+    build_diamond();
+    // a and e are ready; e has the longer path but a leads to the target
+    TEST_ASSERT_EQUAL(0, init_graph_pick(&graph, 0, 0));
+    TEST_ASSERT_EQUAL(4, init_graph_pick(&graph, 0, BIT(0)));
+    // After a: b (rank 40) before c (rank 15)
+    TEST_ASSERT_EQUAL(1, init_graph_pick(&graph, BIT(0), BIT(0) | BIT(4)));
+    TEST_ASSERT_EQUAL(-1, init_graph_pick(&graph, 0, BIT(0) | BIT(4)));
+}
+
+void test_critical_path_to_target(void)
+{
+    build_diamond();
+    uint8_t path[INIT_GRAPH_MAX_NODES];
+    uint8_t len;
+    TEST_ASSERT_EQUAL(50 * MS_US, init_graph_critical_path(&graph, NULL, 3, path, &len));
+    TEST_ASSERT_EQUAL(3, len);
+    TEST_ASSERT_EQUAL(0, path[0]);
+    TEST_ASSERT_EQUAL(1, path[1]);
+    TEST_ASSERT_EQUAL(3, path[2]);
+
+    // Longest chain overall is the independent node
+    TEST_ASSERT_EQUAL(100 * MS_US, init_graph_critical_path(&graph, NULL, -1, path, &len));
+    TEST_ASSERT_EQUAL(1, len);
+    TEST_ASSERT_EQUAL(4, path[0]);
+}
+
+void test_critical_path_follows_measured_durations(void)
+{
+    build_diamond();
+    uint32_t measured[5] = {10 * MS_US, 5 * MS_US, 40 * MS_US, 10 * MS_US, 1 * MS_US};
+    uint8_t path[INIT_GRAPH_MAX_NODES];
+    uint8_t len;
+    TEST_ASSERT_EQUAL(60 * MS_US, init_graph_critical_path(&graph, measured, 3, path, &len));
+    TEST_ASSERT_EQUAL(2, path[1]); // c is now the slow branch
+}
+
+void test_serial_simulation_runs_target_first(void)
+{
+    build_diamond();
+    init_schedule_t sched;
+    TEST_ASSERT_EQUAL(ESP_OK, init_graph_simulate(&graph, NULL, 1, &sched));
+    TEST_ASSERT_EQUAL(155 * MS_US, sched.makespan_us);
+    TEST_ASSERT_EQUAL(55 * MS_US, sched.end_us[3]); // Critical branch does not wait for e
+    TEST_ASSERT_EQUAL(55 * MS_US, sched.start_us[4]);
+}
+
+void test_two_workers_overlap_independent_work(void)
+{
+    build_diamond();
+    init_schedule_t sched;
+    TEST_ASSERT_EQUAL(ESP_OK, init_graph_simulate(&graph, NULL, 2, &sched));
+    TEST_ASSERT_EQUAL(100 * MS_US, sched.makespan_us);
+    TEST_ASSERT_EQUAL(55 * MS_US, sched.end_us[3]); // b and c share a worker while e runs
+    TEST_ASSERT_NOT_EQUAL(sched.worker[0], sched.worker[4]);
+    TEST_ASSERT_EQUAL(0, sched.start_us[4]);
+}
+
+void test_simulate_rejects_bad_arguments(void)
+{
+    init_schedule_t sched;
+    init_graph_add(&graph, "a", 0, 0, NULL);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, init_graph_simulate(&graph, NULL, 1, &sched));
+    init_graph_finalize(&graph, 0);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, init_graph_simulate(&graph, NULL, 0, &sched));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, init_graph_simulate(&graph, NULL, INIT_GRAPH_MAX_WORKERS + 1, &sched));
+}
+
+void test_boot_graph_is_acyclic_and_fits_mask(void)
+{
+    TEST_ASSERT_TRUE(BOOT_STAGE_COUNT <= INIT_GRAPH_MAX_NODES);
+    build_boot_graph();
+    TEST_ASSERT_TRUE(init_graph_is_critical(&graph, BOOT_STAGE_LORA_DRIVER));
+    TEST_ASSERT_TRUE(init_graph_is_critical(&graph, BOOT_STAGE_INPUT_START));
+    TEST_ASSERT_FALSE(init_graph_is_critical(&graph, BOOT_STAGE_BLE));
+    TEST_ASSERT_FALSE(init_graph_is_critical(&graph, BOOT_STAGE_I2CONSOLE));
+    TEST_ASSERT_FALSE(init_graph_is_critical(&graph, BOOT_STAGE_USB_CDC));
+}
+
+// Regression gate: a new dependency or a slower stage on the keypress path must not push the
+// first keypress past its budget when the stages take their full budgets on two cores
+void test_boot_graph_keypress_ready_within_budget_on_two_cores(void)
+{
+    build_boot_graph();
+    init_schedule_t serial, parallel;
+    TEST_ASSERT_EQUAL(ESP_OK, init_graph_simulate(&graph, NULL, 1, &serial));
+    TEST_ASSERT_EQUAL(ESP_OK, init_graph_simulate(&graph, NULL, 2, &parallel));
+
+    uint64_t keypress = BOOT_PRE_APP_BUDGET_US + parallel.end_us[BOOT_STAGE_KEYPRESS_READY];
+    uint64_t lora     = BOOT_PRE_APP_BUDGET_US + parallel.end_us[BOOT_STAGE_LORA_READY];
+    TEST_ASSERT_TRUE(keypress <= BOOT_KEYPRESS_READY_BUDGET_US);
+    TEST_ASSERT_TRUE(lora <= BOOT_LORA_READY_BUDGET_US);
+
+    // Two cores beat serial init; no schedule can beat the dependency chain
+    TEST_ASSERT_TRUE(parallel.end_us[BOOT_STAGE_KEYPRESS_READY] < serial.end_us[BOOT_STAGE_KEYPRESS_READY]);
+    TEST_ASSERT_TRUE(parallel.makespan_us < serial.makespan_us);
+    TEST_ASSERT_TRUE(init_graph_critical_path(&graph, NULL, BOOT_STAGE_KEYPRESS_READY, NULL, NULL) <=
+                     parallel.end_us[BOOT_STAGE_KEYPRESS_READY]);
+}
+
+void test_boot_graph_display_overlaps_radio_bring_up(void)
+{
+    build_boot_graph();
+    init_schedule_t sched;
+    init_graph_simulate(&graph, NULL, 2, &sched);
+
+    TEST_ASSERT_NOT_EQUAL(sched.worker[BOOT_STAGE_UI], sched.worker[BOOT_STAGE_LORA_DRIVER]);
+    TEST_ASSERT_TRUE(sched.start_us[BOOT_STAGE_UI] < sched.end_us[BOOT_STAGE_LORA_DRIVER]);
+    TEST_ASSERT_TRUE(sched.start_us[BOOT_STAGE_LORA_DRIVER] < sched.end_us[BOOT_STAGE_UI]);
+}
+
+// Critical-first: slower BLE, USB or I2Console bring-up must not delay the first keypress
+void test_boot_graph_keypress_ignores_non_critical_stages(void)
+{
+    build_boot_graph();
+    uint32_t slow[INIT_GRAPH_MAX_NODES];
+    for (int i = 0; i < BOOT_STAGE_COUNT; i++) {
+        slow[i] = graph.nodes[i].cost_us * (init_graph_is_critical(&graph, i) ? 1 : 10);
+    }
+
+    for (uint8_t workers = 1; workers <= 2; workers++) {
+        init_schedule_t nominal, slowed;
+        init_graph_simulate(&graph, NULL, workers, &nominal);
+        init_graph_simulate(&graph, slow, workers, &slowed);
+        TEST_ASSERT_EQUAL(nominal.end_us[BOOT_STAGE_KEYPRESS_READY], slowed.end_us[BOOT_STAGE_KEYPRESS_READY]);
+        TEST_ASSERT_EQUAL(nominal.end_us[BOOT_STAGE_LORA_READY], slowed.end_us[BOOT_STAGE_LORA_READY]);
+    }
+}
@@ -0,0 +1,608 @@
+/**
+ * @file test_json_stream.c
+ * @brief Unit tests for the allocation-free JSON tokenizer and streaming writer
+ */
+
+#include "unity.h"
+#include "json_stream.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+static char collected[1024];
+static size_t collected_len;
+static int sink_calls;
+
+static void collect_sink(const char *data, size_t len, void *ctx)
+{
+    (void)ctx;
+    TEST_ASSERT_TRUE(collected_len + len < sizeof(collected));
+    memcpy(collected + collected_len, data, len);
+    collected_len += len;
+    collected[collected_len] = '\0';
+    sink_calls++;
+}
+
+void setUp(void)
+{
+    collected[0]  = '\0';
+    collected_len = 0;
+    sink_calls    = 0;
+}
+
+void tearDown(void)
+{
+}
+
+// Tokenizes input to the end; returns false if any token is an error
+static bool tokenize_all(const char *json, json_tok_type_t *types, int max, int *count)
+{
+    json_reader_t reader;
+    json_token_t tok;
+    json_reader_init(&reader, json, strlen(json));
+
+    *count = 0;
+    while (*count < max) {
+        json_tok_type_t type = json_next(&reader, &tok);
+        types[(*count)++]    = type;
+        if (type == JSON_TOK_ERROR) {
+            return false;
+        }
+        if (type == JSON_TOK_END) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool is_valid(const char *json)
+{
+    json_tok_type_t types[64];
+    int count;
+    return tokenize_all(json, types, 64, &count);
+}
+
+//==============================================================================
+// READER
+//==============================================================================
+
+void test_tokenizes_nested_document(void)
+{
+    const json_tok_type_t expected[] = {
+        JSON_TOK_OBJECT_BEGIN, JSON_TOK_KEY,  JSON_TOK_STRING,     JSON_TOK_KEY,          JSON_TOK_ARRAY_BEGIN,
+        JSON_TOK_NUMBER,       JSON_TOK_TRUE, JSON_TOK_NULL,       JSON_TOK_OBJECT_BEGIN, JSON_TOK_OBJECT_END,
+        JSON_TOK_ARRAY_END,    JSON_TOK_KEY,  JSON_TOK_FALSE,      JSON_TOK_OBJECT_END,   JSON_TOK_END,
+    };
+    json_tok_type_t types[32];
+    int count;
+
+    TEST_ASSERT_TRUE(tokenize_all(" { \"a\" : \"x\", \"b\": [ -1.5e3, true, null, {} ], \"c\":false }\r\n", types, 32,
+                                  &count));
+    TEST_ASSERT_EQUAL(sizeof(expected) / sizeof(expected[0]), count);
+    TEST_ASSERT_EQUAL_INT_ARRAY(expected, types, count);
+}
+
+void test_tokens_point_into_input(void)
+{
+    const char *json = "{\"method\":\"ping\",\"id\":42}";
+    json_reader_t reader;
+    json_token_t tok;
+    json_reader_init(&reader, json, strlen(json));
+
+    TEST_ASSERT_EQUAL(JSON_TOK_OBJECT_BEGIN, json_next(&reader, &tok));
+    TEST_ASSERT_EQUAL(0, tok.depth);
+    TEST_ASSERT_EQUAL(JSON_TOK_KEY, json_next(&reader, &tok));
+    TEST_ASSERT_EQUAL_PTR(json + 1, tok.start);
+    TEST_ASSERT_EQUAL(8, tok.len); // Quotes included
+    TEST_ASSERT_EQUAL(1, tok.depth);
+    TEST_ASSERT_TRUE(json_token_equals(&tok, "method"));
+    TEST_ASSERT_FALSE(json_token_equals(&tok, "meth"));
+    TEST_ASSERT_FALSE(json_token_equals(&tok, "methods"));
+
+    TEST_ASSERT_EQUAL(JSON_TOK_STRING, json_next(&reader, &tok));
+    TEST_ASSERT_TRUE(json_token_equals(&tok, "ping"));
+    TEST_ASSERT_EQUAL(JSON_TOK_KEY, json_next(&reader, &tok));
+    TEST_ASSERT_EQUAL(JSON_TOK_NUMBER, json_next(&reader, &tok));
+    TEST_ASSERT_EQUAL_STRING_LEN("42", tok.start, tok.len);
+    TEST_ASSERT_EQUAL(JSON_TOK_OBJECT_END, json_next(&reader, &tok));
+    TEST_ASSERT_EQUAL(0, tok.depth);
+    TEST_ASSERT_EQUAL(JSON_TOK_END, json_next(&reader, &tok));
+}
+
+void test_rejects_malformed_input(void)
+{
+    const char *invalid[] = {
+        "", "{", "{\"a\"}", "{\"a\":}", "{\"a\":1,}", "[1,]", "[1 2]", "{a:1}", "{'a':1}", "01", "1.", ".5", "-",
+        "1e", "tru", "nul", "\"abc", "\"\\x\"", "\"\\u12G4\"", "\"a\tb\"", "{} {}", "[}", "{]", "{\"a\" 1}", "\"\\",
+        "+1", "truex", "[1]]",
+    };
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+        TEST_ASSERT_FALSE_MESSAGE(is_valid(invalid[i]), invalid[i]);
+    }
+}
+
+void test_accepts_scalars_and_edge_numbers(void)
+{
+    const char *valid[] = {"0", "-0", "1e5", "1E+5", "2.5e-3", "\"\"", "true", "[]", "{}", "[[[]]]", "  null  "};
+    for (size_t i = 0; i < sizeof(valid) / sizeof(valid[0]); i++) {
+        TEST_ASSERT_TRUE_MESSAGE(is_valid(valid[i]), valid[i]);
+    }
+}
+
+void test_errors_are_sticky(void)
+{
+    json_reader_t reader;
+    json_token_t tok;
+    json_reader_init(&reader, "[x, 1]", 6);
+
+    TEST_ASSERT_EQUAL(JSON_TOK_ARRAY_BEGIN, json_next(&reader, &tok));
+    TEST_ASSERT_EQUAL(JSON_TOK_ERROR, json_next(&reader, &tok));
+    TEST_ASSERT_EQUAL(JSON_TOK_ERROR, json_next(&reader, &tok));
+}
+
+void test_depth_limit(void)
+{
+    char deep[2 * JSON_MAX_DEPTH + 3];
+    memset(deep, '[', JSON_MAX_DEPTH);
+    memset(deep + JSON_MAX_DEPTH, ']', JSON_MAX_DEPTH);
+    deep[2 * JSON_MAX_DEPTH] = '\0';
+    TEST_ASSERT_TRUE(is_valid(deep));
+
+    memset(deep, '[', JSON_MAX_DEPTH + 1);
+    memset(deep + JSON_MAX_DEPTH + 1, ']', JSON_MAX_DEPTH + 1);
+    deep[2 * JSON_MAX_DEPTH + 2] = '\0';
+    TEST_ASSERT_FALSE(is_valid(deep));
+}
+
+void test_skip_consumes_whole_value(void)
+{
+    const char *json = "{\"skip\":{\"a\":[1,{\"b\":[]}],\"c\":\"}\"},\"next\":7}";
+    json_reader_t reader;
+    json_token_t tok;
+    json_reader_init(&reader, json, strlen(json));
+
+    json_next(&reader, &tok);
+    json_next(&reader, &tok);
+    TEST_ASSERT_EQUAL(JSON_TOK_OBJECT_BEGIN, json_next(&reader, &tok));
+    TEST_ASSERT_TRUE(json_skip(&reader, &tok));
+
+    TEST_ASSERT_EQUAL(JSON_TOK_KEY, json_next(&reader, &tok));
+    TEST_ASSERT_TRUE(json_token_equals(&tok, "next"));
+    TEST_ASSERT_EQUAL(JSON_TOK_NUMBER, json_next(&reader, &tok));
+    TEST_ASSERT_TRUE(json_skip(&reader, &tok)); // Scalars: nothing to consume
+    TEST_ASSERT_EQUAL(JSON_TOK_OBJECT_END, json_next(&reader, &tok));
+}
+
+void test_skip_reports_truncated_value(void)
+{
+    const char *json = "[1,[2,3";
+    json_reader_t reader;
+    json_token_t tok;
+    json_reader_init(&reader, json, strlen(json));
+
+    json_next(&reader, &tok);
+    json_next(&reader, &tok);
+    TEST_ASSERT_EQUAL(JSON_TOK_ARRAY_BEGIN, json_next(&reader, &tok));
+    TEST_ASSERT_FALSE(json_skip(&reader, &tok));
+}
+
+static json_token_t first_token(const char *json)
+{
+    json_reader_t reader;
+    json_token_t tok;
+    json_reader_init(&reader, json, strlen(json));
+    json_next(&reader, &tok);
+    return tok;
+}
+
+void test_string_decoding(void)
+{
+    char out[32];
+    size_t len;
+
+    json_token_t tok = first_token("\"a\\\"b\\\\c\\/d\\n\\t\"");
+    TEST_ASSERT_TRUE(json_token_copy(&tok, out, sizeof(out), &len));
+    TEST_ASSERT_EQUAL_STRING("a\"b\\c/d\n\t", out);
+    TEST_ASSERT_EQUAL(9, len);
+    TEST_ASSERT_TRUE(json_token_equals(&tok, "a\"b\\c/d\n\t"));
+
+    tok = first_token("\"\\u00e9\\u20ac\\ud83d\\ude00\"");
+    TEST_ASSERT_TRUE(json_token_copy(&tok, out, sizeof(out), &len));
+    TEST_ASSERT_EQUAL_STRING("\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80", out);
+    TEST_ASSERT_TRUE(json_token_equals(&tok, "\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80"));
+}
+
+void test_string_decoding_rejects_bad_input(void)
+{
+    char out[8];
+
+    json_token_t tok = first_token("\"\\u0000\"");
+    TEST_ASSERT_FALSE(json_token_copy(&tok, out, sizeof(out), NULL));
+
+    tok = first_token("\"\\ude00\"");
+    TEST_ASSERT_FALSE(json_token_copy(&tok, out, sizeof(out), NULL));
+
+    tok = first_token("\"\\ud83dx\"");
+    TEST_ASSERT_FALSE(json_token_copy(&tok, out, sizeof(out), NULL));
+
+    tok = first_token("\"1234567\"");
+    TEST_ASSERT_TRUE(json_token_copy(&tok, out, sizeof(out), NULL));
+    tok = first_token("\"12345678\"");
+    TEST_ASSERT_FALSE(json_token_copy(&tok, out, sizeof(out), NULL)); // No room for the NUL
+
+    tok = first_token("42");
+    TEST_ASSERT_FALSE(json_token_copy(&tok, out, sizeof(out), NULL));
+}
+
+void test_integer_conversion(void)
+{
+    int64_t v;
+
+    json_token_t tok = first_token("-42");
+    TEST_ASSERT_TRUE(json_token_int(&tok, &v));
+    TEST_ASSERT_EQUAL_INT64(-42, v);
+
+    tok = first_token("9223372036854775807");
+    TEST_ASSERT_TRUE(json_token_int(&tok, &v));
+    TEST_ASSERT_EQUAL_INT64(INT64_MAX, v);
+
+    tok = first_token("-9223372036854775808");
+    TEST_ASSERT_TRUE(json_token_int(&tok, &v));
+    TEST_ASSERT_EQUAL_INT64(INT64_MIN, v);
+
+    tok = first_token("9223372036854775808");
+    TEST_ASSERT_FALSE(json_token_int(&tok, &v));
+    tok = first_token("1.5");
+    TEST_ASSERT_FALSE(json_token_int(&tok, &v));
+    tok = first_token("1e3");
+    TEST_ASSERT_FALSE(json_token_int(&tok, &v));
+    tok = first_token("\"1\"");
+    TEST_ASSERT_FALSE(json_token_int(&tok, &v));
+}
+
+//==============================================================================
+// WRITER
+//==============================================================================
+
+static void write_sample(json_writer_t *w)
+{
+    json_write_object_begin(w);
+    json_write_kv_string(w, "jsonrpc", "2.0");
+    json_write_key(w, "id");
+    json_write_raw(w, "\"abc\"", 5);
+    json_write_kv_object(w, "result");
+    json_write_kv_int(w, "neg", -12);
+    json_write_kv_uint(w, "big", UINT64_MAX);
+    json_write_kv_bool(w, "on", true);
+    json_write_kv_null(w, "none");
+    json_write_kv_array(w, "list");
+    json_write_int(w, 1);
+    json_write_string(w, "two");
+    json_write_array_begin(w);
+    json_write_array_end(w);
+    json_write_object_begin(w);
+    json_write_object_end(w);
+    json_write_array_end(w);
+    json_write_object_end(w);
+    json_write_object_end(w);
+}
+
+static const char *SAMPLE_JSON = "{\"jsonrpc\":\"2.0\",\"id\":\"abc\",\"result\":{\"neg\":-12,"
+                                 "\"big\":18446744073709551615,\"on\":true,\"none\":null,\"list\":[1,\"two\",[],{}]}}";
+
+void test_writer_separators_and_nesting(void)
+{
+    char buf[256];
+    json_writer_t w;
+    json_writer_init(&w, buf, sizeof(buf), collect_sink, NULL);
+
+    write_sample(&w);
+    TEST_ASSERT_EQUAL(0, sink_calls); // Nothing is sent until the buffer fills or is flushed
+    json_writer_flush(&w);
+
+    TEST_ASSERT_EQUAL_STRING(SAMPLE_JSON, collected);
+    TEST_ASSERT_EQUAL(strlen(SAMPLE_JSON), w.total);
+    TEST_ASSERT_EQUAL(1, sink_calls);
+}
+
+void test_writer_streams_through_small_buffer(void)
+{
+    char buf[7];
+    json_writer_t w;
+    json_writer_init(&w, buf, sizeof(buf), collect_sink, NULL);
+
+    write_sample(&w);
+    json_writer_flush(&w);
+
+    TEST_ASSERT_EQUAL_STRING(SAMPLE_JSON, collected);
+    TEST_ASSERT_EQUAL((strlen(SAMPLE_JSON) + sizeof(buf) - 1) / sizeof(buf), sink_calls);
+}
+
+void test_writer_escapes_strings(void)
+{
+    char buf[64];
+    json_writer_t w;
+    json_writer_init(&w, buf, sizeof(buf), collect_sink, NULL);
+
+    json_write_string(&w, "q\"b\\n\n\x01\xc3\xa9");
+    json_writer_flush(&w);
+    TEST_ASSERT_EQUAL_STRING("\"q\\\"b\\\\n\\n\\u0001\xc3\xa9\"", collected);
+}
+
+void test_writer_escaped_output_reads_back(void)
+{
+    const char *original = "tab\there \"quoted\" back\\slash \x1f end";
+    char buf[16];
+    char decoded[64];
+    json_writer_t w;
+    json_writer_init(&w, buf, sizeof(buf), collect_sink, NULL);
+    json_write_string(&w, original);
+    json_writer_flush(&w);
+
+    json_token_t tok = first_token(collected);
+    TEST_ASSERT_EQUAL(JSON_TOK_STRING, tok.type);
+    TEST_ASSERT_TRUE(json_token_copy(&tok, decoded, sizeof(decoded), NULL));
+    TEST_ASSERT_EQUAL_STRING(original, decoded);
+}
+
+void test_writer_numbers(void)
+{
+    char buf[128];
+    json_writer_t w;
+    json_writer_init(&w, buf, sizeof(buf), collect_sink, NULL);
+
+    json_write_array_begin(&w);
+    json_write_int(&w, INT64_MIN);
+    json_write_int(&w, 0);
+    json_write_double(&w, 3.0);
+    json_write_double(&w, 0.25);
+    json_write_double(&w, -1.0000004);
+    json_write_double(&w, -0.0000001);
+    json_write_double(&w, 1.5e13);
+    json_write_double(&w, 0.0 / 0.0);
+    json_write_array_end(&w);
+    json_writer_flush(&w);
+
+    TEST_ASSERT_EQUAL_STRING("[-9223372036854775808,0,3,0.25,-1,0,15000000000000,null]", collected);
+}
+
+void test_writer_null_string(void)
+{
+    char buf[32];
+    json_writer_t w;
+    json_writer_init(&w, buf, sizeof(buf), collect_sink, NULL);
+
+    json_write_object_begin(&w);
+    json_write_kv_string(&w, "blocker", NULL);
+    json_write_object_end(&w);
+    json_writer_flush(&w);
+    TEST_ASSERT_EQUAL_STRING("{\"blocker\":null}", collected);
+}
+
+//==============================================================================
+// CBOR
+//==============================================================================
+
+static bool cbor_tokenize_all(const uint8_t *cbor, size_t len, json_tok_type_t *types, int max, int *count)
+{
+    json_reader_t reader;
+    json_token_t tok;
+    json_reader_init_cbor(&reader, (const char *)cbor, len);
+
+    *count = 0;
+    while (*count < max) {
+        json_tok_type_t type = json_next(&reader, &tok);
+        types[(*count)++]    = type;
+        if (type == JSON_TOK_ERROR) {
+            return false;
+        }
+        if (type == JSON_TOK_END) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool cbor_is_valid(const uint8_t *cbor, size_t len)
+{
+    json_tok_type_t types[64];
+    int count;
+    return cbor_tokenize_all(cbor, len, types, 64, &count);
+}
+
+#define CBOR_VALID(...)                                                                                                \
+    cbor_is_valid((const uint8_t[]){__VA_ARGS__}, sizeof((const uint8_t[]){__VA_ARGS__}))
+
+void test_cbor_reads_definite_containers(void)
+{
+    // {"a": 1, "b": [2, -3]} as definite-length items, the way host CBOR libraries encode
+    static const uint8_t doc[] = {0xA2, 0x61, 'a', 0x01, 0x61, 'b', 0x82, 0x02, 0x22};
+    static const json_tok_type_t expected[] = {
+        JSON_TOK_OBJECT_BEGIN, JSON_TOK_KEY,       JSON_TOK_NUMBER,    JSON_TOK_KEY,        JSON_TOK_ARRAY_BEGIN,
+        JSON_TOK_NUMBER,       JSON_TOK_NUMBER,    JSON_TOK_ARRAY_END, JSON_TOK_OBJECT_END, JSON_TOK_END,
+    };
+    json_tok_type_t types[16];
+    int count;
+    TEST_ASSERT_TRUE(cbor_tokenize_all(doc, sizeof(doc), types, 16, &count));
+    TEST_ASSERT_EQUAL(sizeof(expected) / sizeof(expected[0]), count);
+    TEST_ASSERT_EQUAL_INT_ARRAY(expected, types, count);
+
+    json_reader_t reader;
+    json_token_t tok;
+    int64_t v;
+    json_reader_init_cbor(&reader, (const char *)doc, sizeof(doc));
+    json_next(&reader, &tok);
+    json_next(&reader, &tok);
+    TEST_ASSERT_TRUE(json_token_equals(&tok, "a"));
+    TEST_ASSERT_FALSE(json_token_equals(&tok, "ab"));
+    json_next(&reader, &tok);
+    TEST_ASSERT_TRUE(json_token_int(&tok, &v));
+    TEST_ASSERT_EQUAL(1, v);
+    json_next(&reader, &tok);
+    json_next(&reader, &tok);
+    TEST_ASSERT_EQUAL(1, tok.depth);
+    TEST_ASSERT_TRUE(json_skip(&reader, &tok));
+    TEST_ASSERT_EQUAL(JSON_TOK_OBJECT_END, json_next(&reader, &tok));
+    TEST_ASSERT_EQUAL(JSON_TOK_END, json_next(&reader, &tok));
+}
+
+void test_cbor_writer_round_trips_through_reader(void)
+{
+    char buf[16];
+    json_writer_t w;
+    json_writer_init_cbor(&w, buf, sizeof(buf), collect_sink, NULL);
+
+    json_write_object_begin(&w);
+    json_write_kv_string(&w, "name", "LoRaCue \xc3\xa9");
+    json_write_kv_int(&w, "neg", -1000);
+    json_write_kv_bool(&w, "on", false);
+    json_write_kv_null(&w, "none");
+    json_write_kv_array(&w, "list");
+    json_write_uint(&w, 24);
+    json_write_object_begin(&w);
+    json_write_object_end(&w);
+    json_write_array_end(&w);
+    json_write_object_end(&w);
+    json_writer_flush(&w);
+
+    static const json_tok_type_t expected[] = {
+        JSON_TOK_OBJECT_BEGIN, JSON_TOK_KEY,    JSON_TOK_STRING,       JSON_TOK_KEY,        JSON_TOK_NUMBER,
+        JSON_TOK_KEY,          JSON_TOK_FALSE,  JSON_TOK_KEY,          JSON_TOK_NULL,       JSON_TOK_KEY,
+        JSON_TOK_ARRAY_BEGIN,  JSON_TOK_NUMBER, JSON_TOK_OBJECT_BEGIN, JSON_TOK_OBJECT_END, JSON_TOK_ARRAY_END,
+        JSON_TOK_OBJECT_END,   JSON_TOK_END,
+    };
+    json_tok_type_t types[32];
+    int count;
+    TEST_ASSERT_TRUE(cbor_tokenize_all((const uint8_t *)collected, collected_len, types, 32, &count));
+    TEST_ASSERT_EQUAL(sizeof(expected) / sizeof(expected[0]), count);
+    TEST_ASSERT_EQUAL_INT_ARRAY(expected, types, count);
+
+    json_reader_t reader;
+    json_token_t tok;
+    char text[32];
+    int64_t v;
+    json_reader_init_cbor(&reader, collected, collected_len);
+    json_next(&reader, &tok);
+    json_next(&reader, &tok);
+    json_next(&reader, &tok);
+    TEST_ASSERT_TRUE(json_token_copy(&tok, text, sizeof(text), NULL));
+    TEST_ASSERT_EQUAL_STRING("LoRaCue \xc3\xa9", text);
+    json_next(&reader, &tok);
+    json_next(&reader, &tok);
+    TEST_ASSERT_TRUE(json_token_int(&tok, &v));
+    TEST_ASSERT_EQUAL(-1000, v);
+}
+
+// Encodings from RFC 8949 Appendix A, written back to back
+void test_cbor_writer_rfc8949_vectors(void)
+{
+    static const uint8_t expected[] = {
+        0x00,                                                 // 0
+        0x17,                                                 // 23
+        0x18, 0x18,                                           // 24
+        0x19, 0x03, 0xE8,                                     // 1000
+        0x1A, 0x00, 0x0F, 0x42, 0x40,                         // 1000000
+        0x1B, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, // UINT64_MAX
+        0x20,                                                 // -1
+        0x39, 0x03, 0xE7,                                     // -1000
+        0x3B, 0x7F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, // INT64_MIN
+        0x19, 0x03, 0xE8,                                     // 1000.0 (integral doubles shrink)
+        0xFA, 0x3F, 0xC0, 0x00, 0x00,                         // 1.5
+        0xFB, 0x3F, 0xF1, 0x99, 0x99, 0x99, 0x99, 0x99, 0x9A, // 1.1
+        0xF6,                                                 // NaN, as in JSON
+        0x61, 'a',                                            // "a"
+        0xF5, 0xF4, 0xF6,                                     // true, false, null
+        0x9F, 0x01, 0xFF,                                     // [_ 1]
+        0xBF, 0x61, 'k', 0x9F, 0xFF, 0xFF,                    // {_ "k": [_ ]}
+    };
+
+    char buf[16];
+    json_writer_t w;
+    json_writer_init_cbor(&w, buf, sizeof(buf), collect_sink, NULL);
+    json_write_uint(&w, 0);
+    json_write_uint(&w, 23);
+    json_write_int(&w, 24);
+    json_write_uint(&w, 1000);
+    json_write_int(&w, 1000000);
+    json_write_uint(&w, UINT64_MAX);
+    json_write_int(&w, -1);
+    json_write_int(&w, -1000);
+    json_write_int(&w, INT64_MIN);
+    json_write_double(&w, 1000.0);
+    json_write_double(&w, 1.5);
+    json_write_double(&w, 1.1);
+    json_write_double(&w, 0.0 / 0.0);
+    json_write_string(&w, "a");
+    json_write_bool(&w, true);
+    json_write_bool(&w, false);
+    json_write_string(&w, NULL);
+    json_write_array_begin(&w);
+    json_write_int(&w, 1);
+    json_write_array_end(&w);
+    json_write_object_begin(&w);
+    json_write_kv_array(&w, "k");
+    json_write_array_end(&w);
+    json_write_object_end(&w);
+    json_writer_flush(&w);
+
+    TEST_ASSERT_EQUAL(sizeof(expected), collected_len);
+    TEST_ASSERT_EQUAL_MEMORY(expected, collected, sizeof(expected));
+}
+
+void test_cbor_rejects_malformed_input(void)
+{
+    TEST_ASSERT_TRUE(CBOR_VALID(0xA1, 0x61, 'a', 0xF6));
+    TEST_ASSERT_TRUE(CBOR_VALID(0xBF, 0x61, 'a', 0x9F, 0xFF, 0xFF));
+    TEST_ASSERT_TRUE(CBOR_VALID(0xFB, 0, 0, 0, 0, 0, 0, 0, 0));
+
+    TEST_ASSERT_FALSE(CBOR_VALID(0xA2, 0x61, 'a', 0x01));        // Truncated map
+    TEST_ASSERT_FALSE(CBOR_VALID(0x62, 'a'));                    // Truncated text
+    TEST_ASSERT_FALSE(CBOR_VALID(0x19, 0x01));                   // Truncated head
+    TEST_ASSERT_FALSE(CBOR_VALID(0x41, 0x00));                   // Byte string
+    TEST_ASSERT_FALSE(CBOR_VALID(0xC1, 0x01));                   // Tag
+    TEST_ASSERT_FALSE(CBOR_VALID(0xA1, 0x01, 0x02));             // Non-text key
+    TEST_ASSERT_FALSE(CBOR_VALID(0xBF, 0x61, 'a', 0xFF));        // Break after a key
+    TEST_ASSERT_FALSE(CBOR_VALID(0x7F, 0x61, 'a', 0xFF));        // Indefinite text
+    TEST_ASSERT_FALSE(CBOR_VALID(0x1C));                         // Reserved additional info
+    TEST_ASSERT_FALSE(CBOR_VALID(0xF0));                         // Unassigned simple value
+    TEST_ASSERT_FALSE(CBOR_VALID(0xFF));                         // Stray break
+    TEST_ASSERT_FALSE(CBOR_VALID(0x01, 0x01));                   // Trailing item
+    TEST_ASSERT_FALSE(CBOR_VALID(0x9B, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF)); // Count past the input
+}
+
+void test_cbor_depth_limit(void)
+{
+    uint8_t doc[JSON_MAX_DEPTH + 2];
+    memset(doc, 0x81, sizeof(doc)); // [[[...
+    doc[JSON_MAX_DEPTH] = 0x01;
+    TEST_ASSERT_TRUE(cbor_is_valid(doc, JSON_MAX_DEPTH + 1));
+    doc[JSON_MAX_DEPTH + 1] = 0x01;
+    TEST_ASSERT_FALSE(cbor_is_valid(doc, JSON_MAX_DEPTH + 2));
+}
+
+void test_cbor_token_access(void)
+{
+    static const uint8_t nul_text[] = {0x63, 'a', 0x00, 'b'};
+    static const uint8_t float_num[] = {0xFA, 0x3F, 0xC0, 0x00, 0x00};
+    static const uint8_t big_neg[]   = {0x3B, 0x80, 0, 0, 0, 0, 0, 0, 0}; // -2^63 - 1
+    json_reader_t reader;
+    json_token_t tok;
+    char out[4];
+    int64_t v;
+
+    json_reader_init_cbor(&reader, (const char *)nul_text, sizeof(nul_text));
+    TEST_ASSERT_EQUAL(JSON_TOK_STRING, json_next(&reader, &tok));
+    TEST_ASSERT_FALSE(json_token_copy(&tok, out, sizeof(out), NULL));
+    TEST_ASSERT_FALSE(json_token_equals(&tok, "a"));
+
+    json_reader_init_cbor(&reader, (const char *)nul_text + 1, 0);
+    TEST_ASSERT_EQUAL(JSON_TOK_ERROR, json_next(&reader, &tok));
+
+    json_reader_init_cbor(&reader, (const char *)float_num, sizeof(float_num));
+    TEST_ASSERT_EQUAL(JSON_TOK_NUMBER, json_next(&reader, &tok));
+    TEST_ASSERT_FALSE(json_token_int(&tok, &v));
+
+    json_reader_init_cbor(&reader, (const char *)big_neg, sizeof(big_neg));
+    TEST_ASSERT_EQUAL(JSON_TOK_NUMBER, json_next(&reader, &tok));
+    TEST_ASSERT_FALSE(json_token_int(&tok, &v));
+}
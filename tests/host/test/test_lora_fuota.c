@@ -0,0 +1,434 @@
+/**
+ * @file test_lora_fuota.c
+ * @brief Unit tests for LoRa multicast firmware updates: frame authentication, the parity
+ *        matrix, decoding lost fragments, and whole sessions to several presenters over a
+ *        simulated lossy radio under the duty-cycle budget
+ */
+
+#include "unity.h"
+#include "lora_fuota.h"
+#include <string.h>
+
+#define RECEIVER_ID 0x1001
+#define UNPAIRED_ID 0x0BAD
+#define PRESENTERS 6
+#define FRAG_SIZE 64
+#define IMAGE_SIZE (40 * 1024 + 17)
+#define FRAG_COUNT ((IMAGE_SIZE + FRAG_SIZE - 1) / FRAG_SIZE)
+#define MAX_MISSING 256
+#define MAX_ROUNDS 20
+
+typedef struct {
+    uint16_t device_id;
+    uint8_t store[FRAG_COUNT * FRAG_SIZE];
+    uint8_t mem[12 * 1024];
+    lora_fuota_rx_t rx;
+    bool active;
+} presenter_t;
+
+static uint8_t image[FRAG_COUNT * FRAG_SIZE]; // Zero padded, as the service stores it
+static uint8_t row_buf[(FRAG_COUNT + 7) / 8];
+static presenter_t presenters[PRESENTERS];
+static uint32_t rng;
+static uint32_t loss_percent;
+static uint64_t now_us;
+
+void setUp(void)
+{
+    rng          = 0x5EED1234;
+    loss_percent = 0;
+    now_us       = 0;
+    memset(image, 0, sizeof(image));
+    for (size_t i = 0; i < IMAGE_SIZE; i++) {
+        image[i] = (uint8_t)(i * 13 + (i >> 7));
+    }
+    memset(presenters, 0, sizeof(presenters));
+}
+
+void tearDown(void)
+{
+}
+
+static uint32_t next_rand(void)
+{
+    rng = rng * 1103515245u + 12345u;
+    return rng >> 8;
+}
+
+static bool lost(void)
+{
+    return next_rand() % 100 < loss_percent;
+}
+
+// Keyed FNV-1a standing in for HMAC-SHA256: every device has its own key
+static esp_err_t test_mac(uint16_t device_id, const uint8_t *data, size_t len, uint8_t mac[LORA_FUOTA_MAC_SIZE],
+                          void *ctx)
+{
+    if (device_id == UNPAIRED_ID) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    uint32_t key = ctx ? *(const uint32_t *)ctx : device_id * 0x9E3779B9u;
+    uint32_t h   = 2166136261u ^ key;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ data[i]) * 16777619u;
+    }
+    memcpy(mac, &h, LORA_FUOTA_MAC_SIZE);
+    return ESP_OK;
+}
+
+static esp_err_t image_read(uint16_t index, uint8_t *data, void *ctx)
+{
+    (void)ctx;
+    memcpy(data, image + (size_t)index * FRAG_SIZE, FRAG_SIZE);
+    return ESP_OK;
+}
+
+static esp_err_t store_read(uint16_t index, uint8_t *data, void *ctx)
+{
+    memcpy(data, ((presenter_t *)ctx)->store + (size_t)index * FRAG_SIZE, FRAG_SIZE);
+    return ESP_OK;
+}
+
+static esp_err_t store_write(uint16_t index, const uint8_t *data, void *ctx)
+{
+    memcpy(((presenter_t *)ctx)->store + (size_t)index * FRAG_SIZE, data, FRAG_SIZE);
+    return ESP_OK;
+}
+
+static void presenter_init(presenter_t *p, uint16_t device_id, uint16_t max_missing)
+{
+    lora_fuota_setup_t setup = {.image_size = IMAGE_SIZE, .frag_count = FRAG_COUNT, .frag_size = FRAG_SIZE};
+    TEST_ASSERT_TRUE(lora_fuota_rx_mem_size(FRAG_COUNT, FRAG_SIZE, max_missing) <= sizeof(p->mem));
+    p->device_id = device_id;
+    TEST_ASSERT_EQUAL(ESP_OK, lora_fuota_rx_init(&p->rx, &setup, max_missing, p->mem, store_read, store_write, p));
+}
+
+/**
+ * @brief Send one frame under the duty cycle; every presenter loses it independently
+ */
+static void broadcast(lora_fuota_duty_t *duty, const uint8_t *frame, size_t len, uint8_t session)
+{
+    now_us += lora_fuota_duty_wait_us(duty, now_us);
+    uint32_t airtime = lora_fuota_airtime_us(7, 500, 5, 8, len);
+    lora_fuota_duty_spend(duty, now_us, airtime);
+    now_us += airtime;
+
+    for (int i = 0; i < PRESENTERS; i++) {
+        if (!presenters[i].active || lost()) {
+            continue;
+        }
+        lora_fuota_frame_t f;
+        TEST_ASSERT_EQUAL(ESP_OK, lora_fuota_parse(frame, len, &f, test_mac, NULL));
+        TEST_ASSERT_EQUAL_UINT16(RECEIVER_ID, f.device_id);
+        if (f.type == LORA_FUOTA_FRAME_FRAG && f.session == session) {
+            esp_err_t ret = lora_fuota_rx_fragment(&presenters[i].rx, f.frag.index, f.frag.data, f.frag.len);
+            TEST_ASSERT_EQUAL(ESP_OK, ret);
+        }
+    }
+}
+
+void test_frames_round_trip_and_are_authenticated(void)
+{
+    uint8_t buf[LORA_FUOTA_FRAME_MAX];
+    lora_fuota_frame_t f;
+
+    lora_fuota_setup_t setup = {.image_size = IMAGE_SIZE,
+                                .frag_count = FRAG_COUNT,
+                                .frag_size  = FRAG_SIZE,
+                                .version    = LORA_FUOTA_VERSION(1, 4, 2)};
+    for (int i = 0; i < LORA_FUOTA_SIGNATURE_SIZE; i++) {
+        setup.signature[i] = (uint8_t)(0xA0 + i);
+    }
+    size_t len = lora_fuota_build_setup(buf, RECEIVER_ID, 7, &setup, test_mac, NULL);
+    TEST_ASSERT_EQUAL(LORA_FUOTA_SETUP_SIZE, len);
+    TEST_ASSERT_EQUAL(ESP_OK, lora_fuota_parse(buf, len, &f, test_mac, NULL));
+    TEST_ASSERT_EQUAL(LORA_FUOTA_FRAME_SETUP, f.type);
+    TEST_ASSERT_EQUAL(7, f.session);
+    TEST_ASSERT_EQUAL_UINT32(IMAGE_SIZE, f.setup.image_size);
+    TEST_ASSERT_EQUAL_UINT16(FRAG_COUNT, f.setup.frag_count);
+    TEST_ASSERT_EQUAL_HEX32(LORA_FUOTA_VERSION(1, 4, 2), f.setup.version);
+    TEST_ASSERT_EQUAL_MEMORY(setup.signature, f.setup.signature, LORA_FUOTA_SIGNATURE_SIZE);
+
+    lora_fuota_status_t status = {.state         = LORA_FUOTA_RX_RECEIVING,
+                                  .received      = 600,
+                                  .needed        = 42,
+                                  .first_missing = 3,
+                                  .missing       = 0x8000000000000005ULL};
+    len = lora_fuota_build_status(buf, 0x2002, 7, &status, test_mac, NULL);
+    TEST_ASSERT_EQUAL(LORA_FUOTA_STATUS_SIZE, len);
+    TEST_ASSERT_EQUAL(ESP_OK, lora_fuota_parse(buf, len, &f, test_mac, NULL));
+    TEST_ASSERT_EQUAL_UINT16(0x2002, f.device_id);
+    TEST_ASSERT_EQUAL_UINT16(42, f.status.needed);
+    TEST_ASSERT_EQUAL_UINT16(3, f.status.first_missing);
+    TEST_ASSERT_TRUE(f.status.missing == 0x8000000000000005ULL);
+
+    // Any changed bit, or another device's key, fails the MAC
+    buf[5] ^= 0x01;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_CRC, lora_fuota_parse(buf, len, &f, test_mac, NULL));
+    buf[5] ^= 0x01;
+    uint32_t other_key = 0x12345678;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_CRC, lora_fuota_parse(buf, len, &f, test_mac, &other_key));
+    TEST_ASSERT_EQUAL(0, lora_fuota_build_status(buf, UNPAIRED_ID, 7, &status, test_mac, NULL));
+    buf[0] = UNPAIRED_ID >> 8;
+    buf[1] = UNPAIRED_ID & 0xFF;
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, lora_fuota_parse(buf, len, &f, test_mac, NULL));
+
+    len = lora_fuota_build_poll(buf, RECEIVER_ID, 7, 150, test_mac, NULL);
+    TEST_ASSERT_EQUAL(ESP_OK, lora_fuota_parse(buf, len, &f, test_mac, NULL));
+    TEST_ASSERT_EQUAL_UINT16(150, f.poll_slot_ms);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, lora_fuota_parse(buf, len - 1, &f, test_mac, NULL));
+}
+
+void test_versions_parse_and_order_as_releases(void)
+{
+    uint32_t v;
+    TEST_ASSERT_EQUAL(ESP_OK, lora_fuota_parse_version("1.4.2", &v));
+    TEST_ASSERT_EQUAL_HEX32(LORA_FUOTA_VERSION(1, 4, 2), v);
+    TEST_ASSERT_EQUAL(ESP_OK, lora_fuota_parse_version("2.0.0-beta.3+12", &v));
+    TEST_ASSERT_EQUAL_HEX32(LORA_FUOTA_VERSION(2, 0, 0), v);
+
+    TEST_ASSERT_TRUE(LORA_FUOTA_VERSION(1, 10, 0) > LORA_FUOTA_VERSION(1, 9, 300));
+    TEST_ASSERT_TRUE(LORA_FUOTA_VERSION(2, 0, 0) > LORA_FUOTA_VERSION(1, 255, 65535));
+
+    static const char *const bad[] = {"", "1.4", "1..2", "v1.4.2", "1.4.2.7", "256.0.0", "1.4.65536", "1.4.2x",
+                                      "-1.4.2"};
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        TEST_ASSERT_EQUAL_MESSAGE(ESP_ERR_INVALID_ARG, lora_fuota_parse_version(bad[i], &v), bad[i]);
+    }
+}
+
+void test_no_frame_has_the_hid_packet_length(void)
+{
+    TEST_ASSERT_NOT_EQUAL(22, LORA_FUOTA_SETUP_SIZE);
+    TEST_ASSERT_NOT_EQUAL(22, LORA_FUOTA_POLL_SIZE);
+    TEST_ASSERT_NOT_EQUAL(22, LORA_FUOTA_STATUS_SIZE);
+    TEST_ASSERT_TRUE(LORA_FUOTA_FRAG_OVERHEAD + LORA_FUOTA_FRAG_SIZE_MIN > 22);
+    TEST_ASSERT_TRUE(LORA_FUOTA_FRAME_MAX <= 255);
+
+    uint8_t hid[22] = {0x01, 0x02, 0x55};
+    lora_fuota_frame_t f;
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_SUPPORTED, lora_fuota_parse(hid, sizeof(hid), &f, test_mac, NULL));
+}
+
+void test_parity_rows_cover_half_of_the_fragments(void)
+{
+    uint8_t a[(FRAG_COUNT + 7) / 8], b[(FRAG_COUNT + 7) / 8];
+    for (uint16_t n = 1; n < 40; n++) {
+        lora_fuota_parity_row(n, FRAG_COUNT, a);
+        int weight = 0;
+        for (int i = 0; i < FRAG_COUNT; i++) {
+            weight += (a[i / 8] >> (i % 8)) & 1;
+        }
+        // floor(M/2) draws with repeats: roughly 40% distinct
+        TEST_ASSERT_TRUE(weight > FRAG_COUNT / 4 && weight <= FRAG_COUNT / 2);
+
+        lora_fuota_parity_row(n, FRAG_COUNT, b);
+        TEST_ASSERT_EQUAL_MEMORY(a, b, sizeof(a)); // Both ends derive the same row
+        lora_fuota_parity_row(n + 1, FRAG_COUNT, b);
+        TEST_ASSERT_TRUE(memcmp(a, b, sizeof(a)) != 0);
+    }
+
+    uint8_t one = 0;
+    lora_fuota_parity_row(1, 1, &one);
+    TEST_ASSERT_EQUAL_HEX8(0x01, one);
+}
+
+void test_lost_fragments_are_rebuilt_from_parity(void)
+{
+    presenter_t *p = &presenters[0];
+    presenter_init(p, 0x2001, MAX_MISSING);
+
+    uint8_t frag[FRAG_SIZE];
+    int dropped = 0;
+    for (uint16_t i = 0; i < FRAG_COUNT; i++) {
+        if (next_rand() % 100 < 10) {
+            dropped++;
+            continue;
+        }
+        image_read(i, frag, NULL);
+        TEST_ASSERT_EQUAL(ESP_OK, lora_fuota_rx_fragment(&p->rx, i, frag, FRAG_SIZE));
+    }
+    lora_fuota_status_t status;
+    lora_fuota_rx_status(&p->rx, &status);
+    TEST_ASSERT_EQUAL_UINT16(dropped, status.needed);
+    TEST_ASSERT_FALSE(p->rx.state == LORA_FUOTA_RX_COMPLETE);
+
+    lora_fuota_tx_t tx;
+    TEST_ASSERT_EQUAL(ESP_OK, lora_fuota_tx_init(&tx, 1, IMAGE_SIZE, FRAG_SIZE, 0, row_buf, image_read, NULL));
+    tx.next_data = FRAG_COUNT; // Data round already sent
+    lora_fuota_tx_repair(&tx, (uint16_t)(dropped + 20));
+
+    uint8_t buf[LORA_FUOTA_FRAME_MAX];
+    int parity = 0;
+    esp_err_t err;
+    while (p->rx.state != LORA_FUOTA_RX_COMPLETE) {
+        size_t len = lora_fuota_tx_next(&tx, RECEIVER_ID, buf, test_mac, NULL, &err);
+        TEST_ASSERT_TRUE(len > 0);
+        lora_fuota_frame_t f;
+        TEST_ASSERT_EQUAL(ESP_OK, lora_fuota_parse(buf, len, &f, test_mac, NULL));
+        TEST_ASSERT_TRUE(f.frag.index >= FRAG_COUNT);
+        TEST_ASSERT_EQUAL(ESP_OK, lora_fuota_rx_fragment(&p->rx, f.frag.index, f.frag.data, f.frag.len));
+        parity++;
+    }
+
+    // Random XOR rows of half the image: nearly every one is independent of the others
+    TEST_ASSERT_TRUE(parity >= dropped && parity <= dropped + 8);
+    TEST_ASSERT_EQUAL_MEMORY(image, p->store, IMAGE_SIZE);
+    lora_fuota_rx_status(&p->rx, &status);
+    TEST_ASSERT_EQUAL(LORA_FUOTA_RX_COMPLETE, status.state);
+    TEST_ASSERT_EQUAL_UINT16(0, status.needed);
+}
+
+void test_late_data_fragments_join_the_decoding(void)
+{
+    presenter_t *p = &presenters[0];
+    presenter_init(p, 0x2001, MAX_MISSING);
+
+    uint8_t frag[FRAG_SIZE];
+    for (uint16_t i = 0; i < FRAG_COUNT; i++) {
+        if (i % 50 == 3) {
+            continue;
+        }
+        image_read(i, frag, NULL);
+        TEST_ASSERT_EQUAL(ESP_OK, lora_fuota_rx_fragment(&p->rx, i, frag, FRAG_SIZE));
+    }
+
+    // One parity freezes the missing set; the lost data fragments then arrive as such
+    lora_fuota_tx_t tx;
+    uint8_t buf[LORA_FUOTA_FRAME_MAX];
+    esp_err_t err;
+    lora_fuota_frame_t f;
+    TEST_ASSERT_EQUAL(ESP_OK, lora_fuota_tx_init(&tx, 1, IMAGE_SIZE, FRAG_SIZE, 0, row_buf, image_read, NULL));
+    tx.next_data = FRAG_COUNT;
+    lora_fuota_tx_repair(&tx, 1);
+    size_t len = lora_fuota_tx_next(&tx, RECEIVER_ID, buf, test_mac, NULL, &err);
+    TEST_ASSERT_EQUAL(ESP_OK, lora_fuota_parse(buf, len, &f, test_mac, NULL));
+    TEST_ASSERT_EQUAL(ESP_OK, lora_fuota_rx_fragment(&p->rx, f.frag.index, f.frag.data, f.frag.len));
+    TEST_ASSERT_TRUE(p->rx.coded);
+
+    for (uint16_t i = 3; i < FRAG_COUNT; i += 50) {
+        image_read(i, frag, NULL);
+        TEST_ASSERT_EQUAL(ESP_OK, lora_fuota_rx_fragment(&p->rx, i, frag, FRAG_SIZE));
+    }
+    TEST_ASSERT_EQUAL(LORA_FUOTA_RX_COMPLETE, p->rx.state);
+    TEST_ASSERT_EQUAL_MEMORY(image, p->store, IMAGE_SIZE);
+}
+
+void test_too_many_lost_fragments_fail_the_session(void)
+{
+    presenter_t *p = &presenters[0];
+    presenter_init(p, 0x2001, 8);
+
+    uint8_t frag[FRAG_SIZE];
+    for (uint16_t i = 10; i < FRAG_COUNT; i++) {
+        image_read(i, frag, NULL);
+        TEST_ASSERT_EQUAL(ESP_OK, lora_fuota_rx_fragment(&p->rx, i, frag, FRAG_SIZE));
+    }
+    lora_fuota_status_t status;
+    lora_fuota_rx_status(&p->rx, &status);
+    TEST_ASSERT_EQUAL_UINT16(0, status.first_missing);
+    TEST_ASSERT_TRUE(status.missing == 0x3FF);
+
+    TEST_ASSERT_EQUAL(ESP_ERR_NO_MEM, lora_fuota_rx_fragment(&p->rx, FRAG_COUNT, frag, FRAG_SIZE));
+    lora_fuota_rx_status(&p->rx, &status);
+    TEST_ASSERT_EQUAL(LORA_FUOTA_RX_FAILED, status.state);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, lora_fuota_rx_init(&p->rx,
+                                                              &(lora_fuota_setup_t){.image_size = IMAGE_SIZE,
+                                                                                    .frag_count = FRAG_COUNT + 1,
+                                                                                    .frag_size  = FRAG_SIZE},
+                                                              8, p->mem, store_read, store_write, p));
+}
+
+void test_multicast_session_over_a_lossy_radio(void)
+{
+    const uint8_t session = 0x5A;
+    loss_percent          = 15;
+    for (int i = 0; i < PRESENTERS; i++) {
+        presenter_init(&presenters[i], (uint16_t)(0x2001 + i), MAX_MISSING);
+        presenters[i].active = true;
+    }
+
+    lora_fuota_duty_t duty;
+    lora_fuota_duty_init(&duty, 10);
+    lora_fuota_tx_t tx;
+    TEST_ASSERT_EQUAL(ESP_OK, lora_fuota_tx_init(&tx, session, IMAGE_SIZE, FRAG_SIZE, 10, row_buf, image_read, NULL));
+
+    uint8_t buf[LORA_FUOTA_FRAME_MAX];
+    esp_err_t err;
+    uint32_t sent = 0;
+    int rounds    = 0;
+    for (; rounds < MAX_ROUNDS; rounds++) {
+        size_t len;
+        while ((len = lora_fuota_tx_next(&tx, RECEIVER_ID, buf, test_mac, NULL, &err)) > 0) {
+            broadcast(&duty, buf, len, session);
+            sent++;
+        }
+        TEST_ASSERT_EQUAL(ESP_OK, err);
+
+        // Poll: STATUS replies are authenticated with each presenter's own key and can be lost too
+        len = lora_fuota_build_poll(buf, RECEIVER_ID, session, 100, test_mac, NULL);
+        broadcast(&duty, buf, len, session);
+        uint16_t needed = 0;
+        bool all_done   = true;
+        for (int i = 0; i < PRESENTERS; i++) {
+            lora_fuota_status_t status;
+            lora_fuota_rx_status(&presenters[i].rx, &status);
+            TEST_ASSERT_NOT_EQUAL(LORA_FUOTA_RX_FAILED, status.state);
+            all_done = all_done && status.state == LORA_FUOTA_RX_COMPLETE;
+
+            uint8_t reply[LORA_FUOTA_FRAME_MAX];
+            lora_fuota_frame_t f;
+            size_t n = lora_fuota_build_status(reply, presenters[i].device_id, session, &status, test_mac, NULL);
+            if (lost()) {
+                needed = needed > status.needed ? needed : status.needed; // Last round's answer stands in
+                continue;
+            }
+            TEST_ASSERT_EQUAL(ESP_OK, lora_fuota_parse(reply, n, &f, test_mac, NULL));
+            needed = needed > f.status.needed ? needed : f.status.needed;
+        }
+        if (all_done) {
+            break;
+        }
+        TEST_ASSERT_TRUE(lora_fuota_tx_repair(&tx, needed) > 0);
+    }
+
+    TEST_ASSERT_TRUE(rounds < MAX_ROUNDS);
+    for (int i = 0; i < PRESENTERS; i++) {
+        TEST_ASSERT_EQUAL_MEMORY(image, presenters[i].store, IMAGE_SIZE);
+    }
+
+    // Repairs are shared: far below one retransmission per device and lost fragment
+    uint32_t unicast = FRAG_COUNT + PRESENTERS * (FRAG_COUNT * 15 / 100);
+    TEST_ASSERT_TRUE(sent < FRAG_COUNT * 135 / 100);
+    TEST_ASSERT_TRUE(sent < unicast);
+
+    // Never above the 10% duty cycle
+    TEST_ASSERT_TRUE(duty.airtime_us * 10 <= duty.next_tx_us);
+}
+
+void test_airtime_matches_the_semtech_formula(void)
+{
+    // 43 payload symbols + 12.25 preamble symbols of 1.024 ms
+    TEST_ASSERT_UINT32_WITHIN(2, 56576, lora_fuota_airtime_us(7, 125, 5, 8, 22));
+    // 18 + 12.25 symbols of 32.768 ms
+    TEST_ASSERT_UINT32_WITHIN(2, 991232, lora_fuota_airtime_us(12, 125, 5, 8, 10));
+    // Full-size fragment at the default SF7/BW500: well under 100 ms
+    uint32_t frag = lora_fuota_airtime_us(7, 500, 5, 8, LORA_FUOTA_FRAME_MAX);
+    TEST_ASSERT_TRUE(frag > 70000 && frag < 100000);
+    TEST_ASSERT_TRUE(lora_fuota_airtime_us(7, 500, 8, 8, 100) > lora_fuota_airtime_us(7, 500, 5, 8, 100));
+}
+
+void test_duty_cycle_holds_off_the_next_transmission(void)
+{
+    lora_fuota_duty_t duty;
+    lora_fuota_duty_init(&duty, 1);
+    TEST_ASSERT_TRUE(lora_fuota_duty_wait_us(&duty, 0) == 0);
+    lora_fuota_duty_spend(&duty, 1000, 50000);
+    TEST_ASSERT_TRUE(lora_fuota_duty_wait_us(&duty, 1000) == 5000000);
+    TEST_ASSERT_TRUE(lora_fuota_duty_wait_us(&duty, 5001000) == 0);
+    TEST_ASSERT_TRUE(duty.airtime_us == 50000);
+
+    lora_fuota_duty_init(&duty, 0); // No limit: only the transmission itself
+    lora_fuota_duty_spend(&duty, 0, 50000);
+    TEST_ASSERT_TRUE(lora_fuota_duty_wait_us(&duty, 0) == 50000);
+}
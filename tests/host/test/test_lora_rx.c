@@ -0,0 +1,111 @@
+/**
+ * @file test_lora_rx.c
+ * @brief Unit tests for routing received payloads: full-length FUOTA frames reach the frame
+ *        path intact and HID packets keep theirs
+ */
+
+#include "unity.h"
+#include "lora_fuota.h"
+#include "lora_rx.h"
+#include <string.h>
+
+#define RECEIVER_ID 0x1001
+#define IMAGE_SIZE 4096
+
+static uint8_t rx_buffer[LORA_RX_BUFFER_SIZE];
+
+void setUp(void)
+{
+    memset(rx_buffer, 0, sizeof(rx_buffer));
+}
+
+void tearDown(void)
+{
+}
+
+static esp_err_t test_mac(uint16_t device_id, const uint8_t *data, size_t len, uint8_t mac[LORA_FUOTA_MAC_SIZE],
+                          void *ctx)
+{
+    (void)ctx;
+    uint32_t h = 2166136261u ^ (device_id * 0x9E3779B9u);
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ data[i]) * 16777619u;
+    }
+    memcpy(mac, &h, LORA_FUOTA_MAC_SIZE);
+    return ESP_OK;
+}
+
+static esp_err_t image_read(uint16_t index, uint8_t *data, void *ctx)
+{
+    uint8_t frag_size = *(const uint8_t *)ctx;
+    for (uint8_t i = 0; i < frag_size; i++) {
+        data[i] = (uint8_t)(index * 31 + i);
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief What lora_receive_packet() and lora_protocol_receive_packet() do with a received payload
+ */
+static lora_rx_kind_t receive(const uint8_t *payload, size_t length, lora_fuota_frame_t *frame)
+{
+    TEST_ASSERT_TRUE(length <= sizeof(rx_buffer));
+    memcpy(rx_buffer, payload, length);
+
+    lora_rx_kind_t kind = lora_rx_classify(length);
+    if (kind == LORA_RX_FRAME) {
+        TEST_ASSERT_EQUAL(ESP_OK, lora_fuota_parse(rx_buffer, length, frame, test_mac, NULL));
+    }
+    return kind;
+}
+
+void test_full_length_setup_frame_reaches_the_frame_path(void)
+{
+    lora_fuota_setup_t setup = {.image_size = IMAGE_SIZE, .frag_count = 64, .frag_size = 64, .version = 0x01020003};
+    memset(setup.signature, 0xA5, sizeof(setup.signature));
+
+    uint8_t out[LORA_FUOTA_FRAME_MAX];
+    size_t len = lora_fuota_build_setup(out, RECEIVER_ID, 3, &setup, test_mac, NULL);
+    TEST_ASSERT_EQUAL(LORA_FUOTA_SETUP_SIZE, len);
+
+    lora_fuota_frame_t f;
+    TEST_ASSERT_EQUAL(LORA_RX_FRAME, receive(out, len, &f));
+    TEST_ASSERT_EQUAL(LORA_FUOTA_FRAME_SETUP, f.type);
+    TEST_ASSERT_EQUAL(0x01020003, f.setup.version);
+    TEST_ASSERT_EQUAL_MEMORY(setup.signature, f.setup.signature, sizeof(setup.signature));
+}
+
+void test_frag_frames_of_every_size_reach_the_frame_path(void)
+{
+    const uint8_t sizes[] = {LORA_FUOTA_FRAG_SIZE_MIN, 64, LORA_FUOTA_FRAG_SIZE_MAX};
+    for (size_t i = 0; i < sizeof(sizes); i++) {
+        uint8_t frag_size = sizes[i];
+        uint8_t row[(IMAGE_SIZE / LORA_FUOTA_FRAG_SIZE_MIN + 7) / 8];
+        lora_fuota_tx_t tx;
+        TEST_ASSERT_EQUAL(ESP_OK, lora_fuota_tx_init(&tx, 3, IMAGE_SIZE, frag_size, 0, row, image_read, &frag_size));
+
+        uint8_t out[LORA_FUOTA_FRAME_MAX];
+        esp_err_t err = ESP_OK;
+        size_t len    = lora_fuota_tx_next(&tx, RECEIVER_ID, out, test_mac, NULL, &err);
+        TEST_ASSERT_EQUAL(LORA_FUOTA_FRAG_OVERHEAD + frag_size, len);
+
+        lora_fuota_frame_t f;
+        TEST_ASSERT_EQUAL(LORA_RX_FRAME, receive(out, len, &f));
+        TEST_ASSERT_EQUAL(LORA_FUOTA_FRAME_FRAG, f.type);
+        TEST_ASSERT_EQUAL(0, f.frag.index);
+        TEST_ASSERT_EQUAL(frag_size, f.frag.len);
+        TEST_ASSERT_EQUAL_UINT8(frag_size - 1, f.frag.data[frag_size - 1]); // Last byte survived the receive path
+    }
+}
+
+void test_hid_packets_and_bad_lengths_are_told_apart(void)
+{
+    uint8_t packet[LORA_RX_PACKET_SIZE] = {0x10, 0x01};
+    TEST_ASSERT_EQUAL(LORA_RX_PACKET, receive(packet, sizeof(packet), NULL));
+
+    TEST_ASSERT_EQUAL(LORA_RX_INVALID, lora_rx_classify(0));
+    TEST_ASSERT_EQUAL(LORA_RX_INVALID, lora_rx_classify(LORA_RX_BUFFER_SIZE + 1));
+    TEST_ASSERT_EQUAL(LORA_RX_FRAME, lora_rx_classify(LORA_FUOTA_POLL_SIZE));
+    TEST_ASSERT_EQUAL(LORA_RX_FRAME, lora_rx_classify(LORA_FUOTA_STATUS_SIZE));
+    TEST_ASSERT_TRUE(LORA_FUOTA_FRAME_MAX <= LORA_RX_BUFFER_SIZE);
+}
@@ -0,0 +1,229 @@
+/**
+ * @file test_lora_tables.c
+ * @brief Round-trip and index tests for the regulatory tables generated from lora_regulatory.json
+ *
+ * The pre_build hook in project.yml runs tools/generate_lora_tables.py, which writes
+ * lora_tables.c and, straight from the JSON, the canonical form the tables must serialize to.
+ */
+
+#include "unity.h"
+#include "lora_bands.h"
+#include "lora_tables.h"
+#include "lora_tables_canonical.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+static char json[8192];
+static size_t json_len;
+
+void setUp(void)
+{
+    json_len = 0;
+    json[0]  = '\0';
+}
+
+void tearDown(void)
+{
+}
+
+static void emit(const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(json + json_len, sizeof(json) - json_len, fmt, args);
+    va_end(args);
+    TEST_ASSERT_TRUE(len >= 0 && json_len + len < sizeof(json));
+    json_len += len;
+}
+
+static void emit_string(const char *key, const char *value, bool last)
+{
+    emit("\"%s\":\"", key);
+    for (const char *c = value; *c; c++) {
+        emit(*c == '"' || *c == '\\' ? "\\%c" : "%c", *c);
+    }
+    emit(last ? "\"" : "\",");
+}
+
+// Same layout as json.dumps(separators=(',', ':')) in the generator
+static void serialize_tables(void)
+{
+    emit("{\"hardware\":[");
+    for (int i = 0; i < lora_hardware_count; i++) {
+        const lora_hardware_t *hw = &lora_hardware_table[i];
+        emit("%s{", i ? "," : "");
+        emit_string("id", hw->id, false);
+        emit_string("name", hw->name, false);
+        emit("\"freq_min_khz\":%lu,\"freq_max_khz\":%lu,\"optimal_khz\":%lu}", (unsigned long)hw->freq_min_khz,
+             (unsigned long)hw->freq_max_khz, (unsigned long)hw->optimal_khz);
+    }
+    emit("],\"regions\":[");
+    for (int i = 0; i < lora_region_count; i++) {
+        emit("%s{", i ? "," : "");
+        emit_string("id", lora_region_table[i].id, false);
+        emit_string("name", lora_region_table[i].name, true);
+        emit("}");
+    }
+    emit("],\"compliance\":[");
+    for (int i = 0; i < lora_compliance_count; i++) {
+        const lora_compliance_t *rule = &lora_compliance_table[i];
+        emit("%s{", i ? "," : "");
+        emit_string("region", rule->region_id, false);
+        emit_string("hardware", rule->hardware_id, false);
+        emit("\"freq_min_khz\":%lu,\"freq_max_khz\":%lu,\"max_power_dbm\":%d,\"duty_cycle_percent\":%u,"
+             "\"fhss_required\":%s,\"lbt_required\":%s}",
+             (unsigned long)rule->freq_min_khz, (unsigned long)rule->freq_max_khz, rule->max_power_dbm,
+             rule->duty_cycle_percent, rule->fhss_required ? "true" : "false", rule->lbt_required ? "true" : "false");
+    }
+    emit("]}");
+}
+
+// What lora_bands.c did before the indexes: first match in JSON order
+static int linear_hardware_by_frequency(uint32_t freq_khz)
+{
+    for (int i = 0; i < lora_hardware_count; i++) {
+        if (freq_khz >= lora_hardware_table[i].freq_min_khz && freq_khz <= lora_hardware_table[i].freq_max_khz) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static const lora_compliance_t *linear_compliance(const char *region_id, const char *hardware_id)
+{
+    for (int i = 0; i < lora_compliance_count; i++) {
+        if (strcmp(lora_compliance_table[i].region_id, region_id) == 0 &&
+            strcmp(lora_compliance_table[i].hardware_id, hardware_id) == 0) {
+            return &lora_compliance_table[i];
+        }
+    }
+    return NULL;
+}
+
+void test_tables_round_trip_to_source_json(void)
+{
+    serialize_tables();
+    TEST_ASSERT_EQUAL_STRING(LORA_TABLES_CANONICAL_JSON, json);
+}
+
+void test_init_needs_no_parsing(void)
+{
+    TEST_ASSERT_EQUAL(ESP_OK, lora_regulatory_init());
+    TEST_ASSERT_EQUAL(lora_hardware_count, lora_hardware_get_count());
+    TEST_ASSERT_EQUAL(lora_region_count, lora_regulatory_get_region_count());
+    TEST_ASSERT_EQUAL_PTR(&lora_region_table[0], lora_regulatory_get_region(0));
+    TEST_ASSERT_NULL(lora_regulatory_get_region(lora_region_count));
+    TEST_ASSERT_NULL(lora_hardware_get_profile(-1));
+}
+
+void test_region_index_is_sorted_and_complete(void)
+{
+    int rules = 0;
+    for (int i = 0; i < lora_region_count; i++) {
+        const lora_region_slot_t *slot = &lora_region_index[i];
+        if (i > 0) {
+            TEST_ASSERT_TRUE(strcmp(lora_region_index[i - 1].id, slot->id) < 0);
+        }
+        TEST_ASSERT_EQUAL_STRING(slot->id, lora_region_table[slot->region].id);
+        TEST_ASSERT_EQUAL(rules, slot->rules_first);
+        for (int r = 0; r < slot->rules_count; r++) {
+            TEST_ASSERT_EQUAL_STRING(slot->id,
+                                     lora_compliance_table[lora_compliance_by_region[slot->rules_first + r]].region_id);
+        }
+        rules += slot->rules_count;
+    }
+    TEST_ASSERT_EQUAL(lora_compliance_count, rules);
+}
+
+void test_region_lookup_by_id(void)
+{
+    for (int i = 0; i < lora_region_count; i++) {
+        TEST_ASSERT_EQUAL_PTR(&lora_region_table[i], lora_regulatory_get_region_by_id(lora_region_table[i].id));
+        TEST_ASSERT_TRUE(lora_regulatory_validate_domain(lora_region_table[i].id));
+    }
+    TEST_ASSERT_NULL(lora_regulatory_get_region_by_id("XX"));
+    TEST_ASSERT_NULL(lora_regulatory_get_region_by_id(NULL));
+    TEST_ASSERT_TRUE(lora_regulatory_validate_domain(""));
+    TEST_ASSERT_FALSE(lora_regulatory_validate_domain("XX"));
+    TEST_ASSERT_FALSE(lora_regulatory_validate_domain("EUR"));
+}
+
+void test_compliance_lookup_matches_first_rule_in_json_order(void)
+{
+    for (int r = 0; r < lora_region_count; r++) {
+        for (int h = 0; h < lora_hardware_count; h++) {
+            const char *region   = lora_region_table[r].id;
+            const char *hardware = lora_hardware_table[h].id;
+            TEST_ASSERT_EQUAL_PTR(linear_compliance(region, hardware),
+                                  lora_regulatory_get_compliance(region, hardware));
+        }
+    }
+    TEST_ASSERT_NULL(lora_regulatory_get_compliance("XX", lora_hardware_table[0].id));
+    TEST_ASSERT_NULL(lora_regulatory_get_limits("", lora_hardware_table[0].id));
+}
+
+void test_available_hardware_is_deduplicated_in_rule_order(void)
+{
+    for (int r = 0; r < lora_region_count; r++) {
+        const char *ids[8];
+        int count = lora_regulatory_get_available_hardware(lora_region_table[r].id, ids, 8);
+
+        // Expected: hardware of this region's rules, first occurrence only
+        const char *expected[8];
+        int expected_count = 0;
+        for (int i = 0; i < lora_compliance_count && expected_count < 8; i++) {
+            const lora_compliance_t *rule = &lora_compliance_table[i];
+            bool seen                     = false;
+            for (int j = 0; j < expected_count; j++) {
+                seen |= strcmp(expected[j], rule->hardware_id) == 0;
+            }
+            if (strcmp(rule->region_id, lora_region_table[r].id) == 0 && !seen) {
+                expected[expected_count++] = rule->hardware_id;
+            }
+        }
+
+        TEST_ASSERT_EQUAL(expected_count, count);
+        for (int i = 0; i < count; i++) {
+            TEST_ASSERT_EQUAL_STRING(expected[i], ids[i]);
+        }
+    }
+    TEST_ASSERT_EQUAL(0, lora_regulatory_get_available_hardware("XX", NULL, 8));
+}
+
+void test_frequency_index_segments_are_disjoint_and_sorted(void)
+{
+    TEST_ASSERT_TRUE(lora_freq_index_count > 0);
+    for (int i = 0; i < lora_freq_index_count; i++) {
+        TEST_ASSERT_TRUE(lora_freq_index[i].freq_min_khz <= lora_freq_index[i].freq_max_khz);
+        TEST_ASSERT_TRUE(lora_freq_index[i].hardware < lora_hardware_count);
+        if (i > 0) {
+            TEST_ASSERT_TRUE(lora_freq_index[i - 1].freq_max_khz < lora_freq_index[i].freq_min_khz);
+        }
+    }
+}
+
+// Probe every profile edge and optimum: overlapping profiles resolve to the first in JSON order
+void test_frequency_lookup_matches_linear_scan(void)
+{
+    for (int i = 0; i < lora_hardware_count; i++) {
+        const lora_hardware_t *hw = &lora_hardware_table[i];
+        uint32_t probes[]         = {hw->freq_min_khz - 1, hw->freq_min_khz, hw->optimal_khz, hw->freq_max_khz,
+                                     hw->freq_max_khz + 1};
+        for (size_t p = 0; p < sizeof(probes) / sizeof(probes[0]); p++) {
+            TEST_ASSERT_EQUAL(linear_hardware_by_frequency(probes[p]),
+                              lora_hardware_get_index_by_frequency(probes[p] * 1000));
+        }
+    }
+    TEST_ASSERT_EQUAL(-1, lora_hardware_get_index_by_frequency(0));
+    TEST_ASSERT_EQUAL(-1, lora_hardware_get_index_by_frequency(UINT32_MAX));
+}
+
+void test_profile_lookup_by_id(void)
+{
+    for (int i = 0; i < lora_hardware_count; i++) {
+        TEST_ASSERT_EQUAL_PTR(&lora_hardware_table[i], lora_hardware_get_profile_by_id(lora_hardware_table[i].id));
+    }
+    TEST_ASSERT_NULL(lora_hardware_get_profile_by_id("HW_0"));
+    TEST_ASSERT_NULL(lora_hardware_get_profile_by_id(NULL));
+}
@@ -0,0 +1,513 @@
+/**
+ * @file test_ota_bulk.c
+ * @brief Unit tests for the bulk upload stream and a threaded loopback upload against a fake
+ *        ota_engine: windowed ping-pong versus stop-and-wait, and recovery from corruption
+ */
+
+#define _DEFAULT_SOURCE // usleep(), clock_gettime() under -std=c11
+
+#include "unity.h"
+#include "ota_bulk.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define CHUNK 256
+#define SLOT (OTA_BULK_HEADER_SIZE + CHUNK + OTA_BULK_CRC_SIZE)
+
+static uint8_t storage[OTA_BULK_STORAGE_SIZE(OTA_BULK_CHUNK_MAX)];
+static ota_bulk_t bulk;
+
+// Results of feed()
+static int blocks;
+static int bad;
+static uint16_t block_seq[16];
+static uint8_t image[8 * CHUNK];
+static size_t image_len;
+
+static size_t make_chunk(uint8_t *out, uint16_t seq, uint8_t flags, const uint8_t *payload, uint16_t len)
+{
+    out[0] = OTA_BULK_MAGIC;
+    out[1] = flags;
+    out[2] = (uint8_t)seq;
+    out[3] = (uint8_t)(seq >> 8);
+    out[4] = (uint8_t)len;
+    out[5] = (uint8_t)(len >> 8);
+    out[6] = 0;
+    out[7] = 0;
+    memcpy(out + OTA_BULK_HEADER_SIZE, payload, len);
+    uint32_t crc = ota_bulk_crc32(0, out, OTA_BULK_HEADER_SIZE + len);
+    for (int i = 0; i < 4; i++) {
+        out[OTA_BULK_HEADER_SIZE + len + i] = (uint8_t)(crc >> (8 * i));
+    }
+    return OTA_BULK_HEADER_SIZE + len + OTA_BULK_CRC_SIZE;
+}
+
+static void pattern(uint8_t *out, size_t len, uint32_t seed)
+{
+    for (size_t i = 0; i < len; i++) {
+        seed   = seed * 1103515245u + 12345u;
+        out[i] = (uint8_t)(seed >> 16);
+    }
+}
+
+// Writer that keeps up: every block is consumed as soon as it is complete
+static void drain(void)
+{
+    const ota_bulk_block_t *block;
+    while ((block = ota_bulk_next_block(&bulk)) != NULL) {
+        block_seq[blocks++ % 16] = block->seq;
+        memcpy(image + image_len, block->data, block->len);
+        image_len += block->len;
+        ota_bulk_release(&bulk);
+    }
+}
+
+// Reads the way the CDC task does: never more than the receiver asks for, at most step at a time
+static size_t feed(const uint8_t *data, size_t len, size_t step, bool writer_runs)
+{
+    size_t done = 0;
+    while (done < len) {
+        uint8_t *dst;
+        size_t want = ota_bulk_rx_window(&bulk, &dst);
+        if (want == 0) {
+            break;
+        }
+        size_t n = len - done;
+        n        = n < want ? n : want;
+        n        = n < step ? n : step;
+        memcpy(dst, data + done, n);
+        done += n;
+
+        ota_bulk_rx_result_t r = ota_bulk_rx_commit(&bulk, n);
+        if (r == OTA_BULK_RX_BAD) {
+            bad++;
+        } else if (r == OTA_BULK_RX_BLOCK && writer_runs) {
+            drain();
+        }
+    }
+    return done;
+}
+
+void setUp(void)
+{
+    ota_bulk_init(&bulk, storage, CHUNK);
+    blocks    = 0;
+    bad       = 0;
+    image_len = 0;
+}
+
+void tearDown(void)
+{
+}
+
+void test_crc32_check_value(void)
+{
+    TEST_ASSERT_EQUAL_HEX32(0xCBF43926, ota_bulk_crc32(0, (const uint8_t *)"123456789", 9));
+    uint32_t crc = ota_bulk_crc32(0, (const uint8_t *)"1234", 4);
+    TEST_ASSERT_EQUAL_HEX32(0xCBF43926, ota_bulk_crc32(crc, (const uint8_t *)"56789", 5));
+}
+
+void test_chunks_arrive_for_any_read_size(void)
+{
+    static const size_t steps[] = {1, 3, 7, 64, SIZE_MAX};
+    uint8_t payload[3][CHUNK];
+    uint8_t stream[3 * SLOT];
+    size_t len = 0;
+
+    for (int i = 0; i < 3; i++) {
+        pattern(payload[i], CHUNK, i);
+        len += make_chunk(stream + len, i, i == 2 ? OTA_BULK_FLAG_LAST : 0, payload[i], i == 2 ? 100 : CHUNK);
+    }
+    for (size_t s = 0; s < sizeof(steps) / sizeof(steps[0]); s++) {
+        setUp();
+        TEST_ASSERT_EQUAL(len, feed(stream, len, steps[s], true));
+        TEST_ASSERT_EQUAL(3, blocks);
+        TEST_ASSERT_EQUAL(0, bad);
+        TEST_ASSERT_EQUAL(2 * CHUNK + 100, image_len);
+        TEST_ASSERT_EQUAL_MEMORY(payload[1], image + CHUNK, CHUNK);
+        TEST_ASSERT_EQUAL(3, ota_bulk_rx_seq(&bulk));
+    }
+}
+
+void test_receiver_stops_reading_while_writer_holds_both_buffers(void)
+{
+    uint8_t payload[CHUNK] = {0};
+    uint8_t stream[3 * SLOT];
+    size_t len = 0;
+    for (int i = 0; i < 3; i++) {
+        len += make_chunk(stream + len, i, 0, payload, CHUNK);
+    }
+
+    // Two chunks fill both buffers; not one byte of the third is taken
+    TEST_ASSERT_EQUAL(2 * SLOT, feed(stream, len, SIZE_MAX, false));
+    TEST_ASSERT_EQUAL(1, bulk.stalls);
+
+    const ota_bulk_block_t *first = ota_bulk_next_block(&bulk);
+    TEST_ASSERT_NOT_NULL(first);
+    TEST_ASSERT_EQUAL(0, first->seq);
+    ota_bulk_release(&bulk);
+
+    // Freeing one buffer lets the third chunk in while the writer still holds the second
+    TEST_ASSERT_EQUAL(SLOT, feed(stream + 2 * SLOT, SLOT, SIZE_MAX, false));
+    TEST_ASSERT_EQUAL(1, ota_bulk_next_block(&bulk)->seq);
+    ota_bulk_release(&bulk);
+    TEST_ASSERT_EQUAL(2, ota_bulk_next_block(&bulk)->seq);
+    ota_bulk_release(&bulk);
+    TEST_ASSERT_NULL(ota_bulk_next_block(&bulk));
+}
+
+void test_drop_without_buffer_naks_once_and_resyncs_on_resend(void)
+{
+    uint8_t payload[4][CHUNK];
+    uint8_t stream[4][SLOT];
+    for (int i = 0; i < 4; i++) {
+        pattern(payload[i], CHUNK, 200 + i);
+        make_chunk(stream[i], i, 0, payload[i], CHUNK);
+    }
+
+    // A transport that cannot hold data (BLE writes) drops what finds no free buffer
+    feed(stream[0], SLOT, SIZE_MAX, false);
+    feed(stream[1], SLOT, SIZE_MAX, false);
+    TEST_ASSERT_EQUAL(0, feed(stream[2], SLOT, SIZE_MAX, false));
+    TEST_ASSERT_TRUE(ota_bulk_rx_drop(&bulk));
+    TEST_ASSERT_EQUAL(2, ota_bulk_rx_seq(&bulk));
+    TEST_ASSERT_FALSE(ota_bulk_rx_drop(&bulk)); // Chunk 3, still in flight: no second NAK
+    drain();
+
+    // Once a buffer is back, chunk 3 arriving ahead of the resend is dropped silently
+    feed(stream[3], SLOT, 64, true);
+    TEST_ASSERT_EQUAL(2, blocks);
+    for (int i = 2; i < 4; i++) {
+        feed(stream[i], SLOT, 64, true);
+    }
+    TEST_ASSERT_EQUAL(4, blocks);
+    TEST_ASSERT_EQUAL(0, bad);
+    TEST_ASSERT_EQUAL(4 * CHUNK, image_len);
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL(i, block_seq[i]);
+        TEST_ASSERT_EQUAL_MEMORY(payload[i], image + i * CHUNK, CHUNK);
+    }
+}
+
+void test_crc_error_naks_and_drops_until_resend(void)
+{
+    uint8_t payload[4][CHUNK];
+    uint8_t stream[4][SLOT];
+    for (int i = 0; i < 4; i++) {
+        pattern(payload[i], CHUNK, 100 + i);
+        make_chunk(stream[i], i, 0, payload[i], CHUNK);
+    }
+
+    feed(stream[0], SLOT, SIZE_MAX, true);
+    stream[1][OTA_BULK_HEADER_SIZE + 10] ^= 0x40;
+    feed(stream[1], SLOT, SIZE_MAX, true);
+    TEST_ASSERT_EQUAL(1, bad);
+    TEST_ASSERT_EQUAL(1, bulk.crc_errors);
+    TEST_ASSERT_EQUAL(1, ota_bulk_rx_seq(&bulk));
+
+    // Chunks the host sent before it saw the NAK are dropped without another NAK
+    feed(stream[2], SLOT, 64, true);
+    feed(stream[3], SLOT, 64, true);
+    TEST_ASSERT_EQUAL(1, blocks);
+    TEST_ASSERT_EQUAL(1, bad);
+
+    // Go-back-N from the NAK
+    stream[1][OTA_BULK_HEADER_SIZE + 10] ^= 0x40;
+    for (int i = 1; i < 4; i++) {
+        feed(stream[i], SLOT, 64, true);
+    }
+    TEST_ASSERT_EQUAL(4, blocks);
+    TEST_ASSERT_EQUAL(1, bad);
+    TEST_ASSERT_EQUAL(4 * CHUNK, image_len);
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL(i, block_seq[i]);
+        TEST_ASSERT_EQUAL_MEMORY(payload[i], image + i * CHUNK, CHUNK);
+    }
+}
+
+void test_garbage_and_bad_headers_are_framing_errors(void)
+{
+    uint8_t payload[CHUNK];
+    uint8_t chunk[SLOT];
+    pattern(payload, CHUNK, 7);
+    size_t len = make_chunk(chunk, 0, 0, payload, CHUNK);
+
+    // Stray text (a log line) ahead of the first chunk, with a magic byte in it
+    static const uint8_t junk[] = "I (1234) boot: \xB7 ready\r\n";
+    feed(junk, sizeof(junk) - 1, SIZE_MAX, true);
+    TEST_ASSERT_EQUAL(1, bad);
+    feed(chunk, len, 5, true);
+    TEST_ASSERT_EQUAL(1, blocks);
+    TEST_ASSERT_EQUAL(1, bulk.framing_errors);
+
+    // Length beyond the negotiated chunk size, unknown flag bits, non-zero reserved field
+    uint8_t header[OTA_BULK_HEADER_SIZE];
+    static const uint8_t patches[][2] = {{5, 0x10}, {1, 0x80}, {6, 0x01}};
+    for (size_t i = 0; i < sizeof(patches) / sizeof(patches[0]); i++) {
+        setUp();
+        make_chunk(chunk, 0, 0, payload, CHUNK);
+        memcpy(header, chunk, sizeof(header));
+        header[patches[i][0]] |= patches[i][1];
+        feed(header, sizeof(header), SIZE_MAX, true);
+        TEST_ASSERT_EQUAL(1, bad);
+        feed(chunk, len, SIZE_MAX, true);
+        TEST_ASSERT_EQUAL(1, blocks);
+    }
+}
+
+void test_duplicates_are_skipped_and_gaps_nak(void)
+{
+    uint8_t payload[CHUNK] = {0};
+    uint8_t stream[3][SLOT];
+    for (int i = 0; i < 3; i++) {
+        make_chunk(stream[i], i, 0, payload, CHUNK);
+    }
+
+    feed(stream[0], SLOT, SIZE_MAX, true);
+    feed(stream[0], SLOT, SIZE_MAX, true); // The host retransmitted before the ACK arrived
+    TEST_ASSERT_EQUAL(1, blocks);
+    TEST_ASSERT_EQUAL(0, bad);
+    TEST_ASSERT_EQUAL(1, bulk.out_of_sequence);
+
+    feed(stream[2], SLOT, SIZE_MAX, true); // Chunk 1 never arrived
+    TEST_ASSERT_EQUAL(1, bad);
+    TEST_ASSERT_EQUAL(1, ota_bulk_rx_seq(&bulk));
+    feed(stream[1], SLOT, SIZE_MAX, true);
+    feed(stream[2], SLOT, SIZE_MAX, true);
+    TEST_ASSERT_EQUAL(3, blocks);
+}
+
+void test_empty_chunk_carries_flags(void)
+{
+    uint8_t chunk[SLOT];
+    size_t len = make_chunk(chunk, 0, OTA_BULK_FLAG_ABORT, NULL, 0);
+    feed(chunk, len, SIZE_MAX, false);
+    const ota_bulk_block_t *block = ota_bulk_next_block(&bulk);
+    TEST_ASSERT_NOT_NULL(block);
+    TEST_ASSERT_EQUAL(0, block->len);
+    TEST_ASSERT_EQUAL(OTA_BULK_FLAG_ABORT, block->flags);
+}
+
+void test_status_encoding(void)
+{
+    uint8_t out[OTA_BULK_STATUS_SIZE];
+    TEST_ASSERT_EQUAL(OTA_BULK_STATUS_SIZE, ota_bulk_encode_status(out, OTA_BULK_STATUS_DONE, 0x1234, -3));
+    static const uint8_t head[] = {OTA_BULK_STATUS_MAGIC, 'D', 0x34, 0x12, 0xFD, 0xFF, 0xFF, 0xFF};
+    TEST_ASSERT_EQUAL_MEMORY(head, out, sizeof(head));
+    uint32_t crc = ota_bulk_crc32(0, out, 8);
+    TEST_ASSERT_EQUAL_HEX32(crc, out[8] | out[9] << 8 | out[10] << 16 | (uint32_t)out[11] << 24);
+}
+
+//==============================================================================
+// LOOPBACK UPLOAD
+//==============================================================================
+
+// Full-speed USB moves a 4 KB chunk in about 4 ms, internal flash writes and hashes it in about
+// 3 ms; both scaled down 4x so the test stays quick
+#define LOOP_CHUNKS 48
+#define LOOP_LINK_US 1000
+#define LOOP_FLASH_US 750
+#define LOOP_FIFO 512 // TinyUSB CDC RX FIFO
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    uint8_t fifo[LOOP_FIFO]; // Host -> device bytes not yet read by the receiver
+    size_t fifo_head;
+    size_t fifo_len;
+    uint16_t acked;   // ACK: chunks written
+    int nak;          // NAK sequence, -1 if none pending
+    bool done;
+    int naks;
+    int errors;       // Failed fake writes and finish; asserted on the test's own thread
+    int corrupt_seq;  // Flip a bit in this chunk's first transmission
+    int window;
+} loop_t;
+
+// Fake ota_engine: stores the image and takes flash time for every write
+static uint8_t loop_source[LOOP_CHUNKS * OTA_BULK_CHUNK_MAX];
+static uint8_t loop_flash[LOOP_CHUNKS * OTA_BULK_CHUNK_MAX];
+static size_t loop_written;
+static int loop_finished;
+
+static int fake_ota_write(const uint8_t *data, size_t len)
+{
+    if (loop_written + len > sizeof(loop_flash)) {
+        return -1;
+    }
+    usleep(LOOP_FLASH_US);
+    memcpy(loop_flash + loop_written, data, len);
+    loop_written += len;
+    return 0;
+}
+
+static int fake_ota_finish(void)
+{
+    loop_finished++;
+    return loop_written == sizeof(loop_source) && memcmp(loop_flash, loop_source, loop_written) == 0 ? 0 : -1;
+}
+
+static void *host_thread(void *arg)
+{
+    loop_t *loop = arg;
+    static uint8_t chunk[OTA_BULK_HEADER_SIZE + OTA_BULK_CHUNK_MAX + OTA_BULK_CRC_SIZE];
+    uint16_t next = 0;
+    bool corrupted = false;
+
+    pthread_mutex_lock(&loop->lock);
+    while (!loop->done) {
+        if (loop->nak >= 0) {
+            next      = (uint16_t)loop->nak;
+            loop->nak = -1;
+        }
+        if (next >= LOOP_CHUNKS || (uint16_t)(next - loop->acked) >= loop->window) {
+            pthread_cond_wait(&loop->changed, &loop->lock);
+            continue;
+        }
+        pthread_mutex_unlock(&loop->lock);
+
+        uint8_t flags = next == LOOP_CHUNKS - 1 ? OTA_BULK_FLAG_LAST : 0;
+        size_t len = make_chunk(chunk, next, flags, loop_source + next * OTA_BULK_CHUNK_MAX, OTA_BULK_CHUNK_MAX);
+        if (next == loop->corrupt_seq && !corrupted) {
+            chunk[100] ^= 0x01;
+            corrupted = true;
+        }
+        usleep(LOOP_LINK_US);
+        next++;
+
+        // Into the FIFO as fast as the receiver drains it: USB NAKs the host while it is full
+        pthread_mutex_lock(&loop->lock);
+        for (size_t sent = 0; sent < len && !loop->done;) {
+            if (loop->fifo_len == LOOP_FIFO) {
+                pthread_cond_wait(&loop->changed, &loop->lock);
+                continue;
+            }
+            loop->fifo[(loop->fifo_head + loop->fifo_len) % LOOP_FIFO] = chunk[sent++];
+            loop->fifo_len++;
+            pthread_cond_broadcast(&loop->changed);
+        }
+    }
+    pthread_mutex_unlock(&loop->lock);
+    return NULL;
+}
+
+static void *rx_thread(void *arg)
+{
+    loop_t *loop = arg;
+
+    pthread_mutex_lock(&loop->lock);
+    while (!loop->done) {
+        uint8_t *dst;
+        size_t want = ota_bulk_rx_window(&bulk, &dst);
+        if (want == 0 || loop->fifo_len == 0) {
+            pthread_cond_wait(&loop->changed, &loop->lock);
+            continue;
+        }
+        size_t n = want < loop->fifo_len ? want : loop->fifo_len;
+        for (size_t i = 0; i < n; i++) {
+            dst[i] = loop->fifo[(loop->fifo_head + i) % LOOP_FIFO];
+        }
+        loop->fifo_head = (loop->fifo_head + n) % LOOP_FIFO;
+        loop->fifo_len -= n;
+
+        ota_bulk_rx_result_t r = ota_bulk_rx_commit(&bulk, n);
+        if (r == OTA_BULK_RX_BAD) {
+            loop->nak = ota_bulk_rx_seq(&bulk);
+            loop->naks++;
+        }
+        pthread_cond_broadcast(&loop->changed);
+    }
+    pthread_mutex_unlock(&loop->lock);
+    return NULL;
+}
+
+static void *writer_thread(void *arg)
+{
+    loop_t *loop = arg;
+
+    pthread_mutex_lock(&loop->lock);
+    while (!loop->done) {
+        const ota_bulk_block_t *block = ota_bulk_next_block(&bulk);
+        if (!block) {
+            pthread_cond_wait(&loop->changed, &loop->lock);
+            continue;
+        }
+        pthread_mutex_unlock(&loop->lock);
+
+        // Flash write and hash run unlocked, overlapping reception into the other buffer
+        int err      = fake_ota_write(block->data, block->len);
+        bool last = block->flags & OTA_BULK_FLAG_LAST;
+        uint16_t seq = block->seq;
+        ota_bulk_release(&bulk);
+
+        pthread_mutex_lock(&loop->lock);
+        loop->acked = seq + 1;
+        loop->errors += err != 0;
+        if (last) {
+            loop->errors += fake_ota_finish() != 0;
+            loop->done = true;
+        }
+        pthread_cond_broadcast(&loop->changed);
+    }
+    pthread_mutex_unlock(&loop->lock);
+    return NULL;
+}
+
+static double run_upload(int window, int corrupt_seq, int *naks)
+{
+    loop_t loop = {.nak = -1, .corrupt_seq = corrupt_seq, .window = window};
+    pthread_mutex_init(&loop.lock, NULL);
+    pthread_cond_init(&loop.changed, NULL);
+    ota_bulk_init(&bulk, storage, OTA_BULK_CHUNK_MAX);
+    loop_written = 0;
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pthread_t threads[3];
+    pthread_create(&threads[0], NULL, host_thread, &loop);
+    pthread_create(&threads[1], NULL, rx_thread, &loop);
+    pthread_create(&threads[2], NULL, writer_thread, &loop);
+    for (int i = 0; i < 3; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    *naks = loop.naks;
+    TEST_ASSERT_EQUAL(0, loop.errors);
+    pthread_cond_destroy(&loop.changed);
+    pthread_mutex_destroy(&loop.lock);
+    return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+void test_loopback_upload_recovers_from_corruption(void)
+{
+    int naks;
+    pattern(loop_source, sizeof(loop_source), 42);
+    loop_finished = 0;
+
+    run_upload(4, 5, &naks);
+    TEST_ASSERT_EQUAL(1, loop_finished);
+    TEST_ASSERT_EQUAL(1, naks);
+    TEST_ASSERT_EQUAL(1, bulk.crc_errors);
+    TEST_ASSERT_EQUAL(sizeof(loop_source), loop_written);
+    TEST_ASSERT_EQUAL_MEMORY(loop_source, loop_flash, loop_written);
+}
+
+void test_benchmark_windowed_vs_stop_and_wait(void)
+{
+    int naks;
+    pattern(loop_source, sizeof(loop_source), 43);
+
+    double stop_and_wait = run_upload(1, -1, &naks);
+    double windowed      = run_upload(4, -1, &naks);
+    TEST_ASSERT_EQUAL(0, naks);
+    TEST_ASSERT_EQUAL_MEMORY(loop_source, loop_flash, sizeof(loop_source));
+
+    double kib = sizeof(loop_source) / 1024.0;
+    printf("[BENCH][ota_bulk] stop-and-wait %6.0f KiB/s, window 4 ping-pong %6.0f KiB/s (%.2fx, %u stalls)\n",
+           kib / stop_and_wait, kib / windowed, stop_and_wait / windowed, (unsigned)bulk.stalls);
+}
@@ -0,0 +1,421 @@
+/**
+ * @file test_ota_checkpoint.c
+ * @brief Unit tests for OTA resume points: record validation, boundary splitting, and
+ *        transfers dropped at random offsets, resumed from the stored record after a
+ *        simulated reboot and checked against the SHA-256 of the whole image
+ */
+
+#include "unity.h"
+#include "ota_bulk.h"
+#include "ota_checkpoint.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#define IMAGE_MAX (320 * 1024)
+#define INTERVAL (64 * 1024)
+#define PARTITION_ADDRESS 0x110000
+#define CHUNK_MAX 4096
+
+// Minimal SHA-256 whose context, like mbedtls', is plain data the checkpoint copies
+typedef struct {
+    uint32_t state[8];
+    uint64_t total;
+    uint8_t buffer[64];
+} sha256_t;
+
+static const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+#define ROR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void sha256_block(sha256_t *s, const uint8_t *p)
+{
+    uint32_t w[64], v[8];
+    for (int i = 0; i < 16; i++) {
+        w[i] = (uint32_t)p[i * 4] << 24 | (uint32_t)p[i * 4 + 1] << 16 | (uint32_t)p[i * 4 + 2] << 8 | p[i * 4 + 3];
+    }
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = ROR(w[i - 15], 7) ^ ROR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = ROR(w[i - 2], 17) ^ ROR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i]        = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    memcpy(v, s->state, sizeof(v));
+    for (int i = 0; i < 64; i++) {
+        uint32_t t1 = v[7] + (ROR(v[4], 6) ^ ROR(v[4], 11) ^ ROR(v[4], 25)) + ((v[4] & v[5]) ^ (~v[4] & v[6])) + K[i] +
+                      w[i];
+        uint32_t t2 = (ROR(v[0], 2) ^ ROR(v[0], 13) ^ ROR(v[0], 22)) + ((v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]));
+        memmove(v + 1, v, 7 * sizeof(v[0]));
+        v[4] += t1;
+        v[0] = t1 + t2;
+    }
+    for (int i = 0; i < 8; i++) {
+        s->state[i] += v[i];
+    }
+}
+
+static void sha256_starts(sha256_t *s)
+{
+    static const uint32_t init[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                     0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    memset(s, 0, sizeof(*s));
+    memcpy(s->state, init, sizeof(init));
+}
+
+static void sha256_update(sha256_t *s, const uint8_t *data, size_t len)
+{
+    while (len > 0) {
+        size_t used = s->total % 64;
+        size_t n    = 64 - used < len ? 64 - used : len;
+        memcpy(s->buffer + used, data, n);
+        s->total += n;
+        data += n;
+        len -= n;
+        if (s->total % 64 == 0) {
+            sha256_block(s, s->buffer);
+        }
+    }
+}
+
+static void sha256_finish(sha256_t *s, uint8_t out[32])
+{
+    uint64_t bits   = s->total * 8;
+    uint8_t pad[72] = {0x80};
+    size_t pad_len  = (s->total % 64 < 56 ? 56 : 120) - s->total % 64;
+    for (int i = 0; i < 8; i++) {
+        pad[pad_len + i] = (uint8_t)(bits >> (56 - 8 * i));
+    }
+    sha256_update(s, pad, pad_len + 8);
+    for (int i = 0; i < 32; i++) {
+        out[i] = (uint8_t)(s->state[i / 4] >> (24 - 8 * (i % 4)));
+    }
+}
+
+// The device: flash, the running hash, and the one NVS blob
+static uint8_t image[IMAGE_MAX];
+static size_t image_len;
+static char image_hex[65];
+static uint8_t flash[IMAGE_MAX];
+static sha256_t hash;
+static uint8_t nvs[sizeof(ota_checkpoint_t)];
+static size_t nvs_len;
+static int saves;
+static uint32_t boundary_crossings;
+static bool fail_saves;
+static bool fail_writes;
+static uint32_t rng;
+static ota_checkpointer_t writer;
+
+void setUp(void)
+{
+    memset(flash, 0xFF, sizeof(flash));
+    nvs_len            = 0;
+    saves              = 0;
+    boundary_crossings = 0;
+    fail_saves         = false;
+    fail_writes        = false;
+    rng                = 0x13579BDF;
+}
+
+void tearDown(void)
+{
+}
+
+static uint32_t next_rand(void)
+{
+    rng = rng * 1103515245u + 12345u;
+    return rng >> 8;
+}
+
+static void to_hex(const uint8_t *bin, size_t len, char *hex)
+{
+    for (size_t i = 0; i < len; i++) {
+        snprintf(hex + i * 2, 3, "%02X", bin[i]); // Upper case: matching ignores case
+    }
+}
+
+static void make_image(size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        image[i] = (uint8_t)(next_rand() >> (i % 3 * 4));
+    }
+    image_len = len;
+
+    sha256_t s;
+    uint8_t digest[32];
+    sha256_starts(&s);
+    sha256_update(&s, image, len);
+    sha256_finish(&s, digest);
+    to_hex(digest, 32, image_hex);
+}
+
+static esp_err_t write_flash(const uint8_t *data, size_t len, void *ctx)
+{
+    ota_checkpointer_t *cp = ctx;
+    if (fail_writes) {
+        return ESP_FAIL;
+    }
+    if (cp->offset / INTERVAL != (cp->offset + len - 1) / INTERVAL) {
+        boundary_crossings++;
+    }
+    TEST_ASSERT_TRUE(cp->offset + len <= image_len);
+    memcpy(flash + cp->offset, data, len);
+    sha256_update(&hash, data, len);
+    return ESP_OK;
+}
+
+// As ota_engine.c: midstate and upload parameters, sealed, one blob
+static esp_err_t save_record(uint32_t offset, void *ctx)
+{
+    (void)ctx;
+    if (fail_saves) {
+        return ESP_ERR_NO_MEM;
+    }
+    ota_checkpoint_t cp;
+    memset(&cp, 0, sizeof(cp));
+    cp.firmware_size     = image_len;
+    cp.offset            = offset;
+    cp.partition_address = PARTITION_ADDRESS;
+    strcpy(cp.expected_sha256, image_hex);
+    cp.hash_state_len = sizeof(hash);
+    memcpy(cp.hash_state, &hash, sizeof(hash));
+    ota_checkpoint_seal(&cp);
+
+    memcpy(nvs, &cp, sizeof(cp));
+    nvs_len = sizeof(cp);
+    saves++;
+    return ESP_OK;
+}
+
+/**
+ * Power-on: RAM state is gone, bytes after the stored offset are erased again as the rest
+ * arrives. Returns the offset the transport restarts from.
+ */
+static uint32_t reboot_and_resume(void)
+{
+    memset(&hash, 0xA5, sizeof(hash));
+
+    ota_checkpoint_t cp;
+    memcpy(&cp, nvs, sizeof(cp));
+    uint32_t offset = 0;
+    if (nvs_len > 0 && ota_checkpoint_validate(&cp, nvs_len) == ESP_OK &&
+        ota_checkpoint_matches(&cp, image_len, image_hex, PARTITION_ADDRESS) && cp.hash_state_len == sizeof(hash)) {
+        memcpy(&hash, cp.hash_state, sizeof(hash));
+        offset = cp.offset;
+    } else {
+        sha256_starts(&hash);
+    }
+    memset(flash + offset, 0xFF, image_len - offset);
+    ota_checkpointer_init(&writer, INTERVAL, offset, write_flash, save_record, &writer);
+    return offset;
+}
+
+// Send image[from, until) in random chunk sizes, as the transport would
+static void send(uint32_t from, uint32_t until)
+{
+    while (from < until) {
+        uint32_t n = 1 + next_rand() % CHUNK_MAX;
+        n          = n < until - from ? n : until - from;
+        TEST_ASSERT_EQUAL(ESP_OK, ota_checkpointer_write(&writer, image + from, n));
+        from += n;
+    }
+    TEST_ASSERT_EQUAL_UINT32(until, writer.offset);
+}
+
+static void assert_image_complete(void)
+{
+    uint8_t digest[32];
+    char hex[65];
+    sha256_finish(&hash, digest);
+    to_hex(digest, 32, hex);
+    TEST_ASSERT_EQUAL_STRING(image_hex, hex);
+    TEST_ASSERT_EQUAL_MEMORY(image, flash, image_len);
+}
+
+void test_reference_hash(void)
+{
+    sha256_t s;
+    uint8_t digest[32];
+    char hex[65];
+    sha256_starts(&s);
+    sha256_update(&s, (const uint8_t *)"abc", 3);
+    sha256_finish(&s, digest);
+    to_hex(digest, 32, hex);
+    TEST_ASSERT_EQUAL_STRING("BA7816BF8F01CFEA414140DE5DAE2223B00361A396177A9CB410FF61F20015AD", hex);
+}
+
+void test_record_round_trip_and_rejects(void)
+{
+    make_image(200 * 1024);
+    ota_checkpointer_init(&writer, INTERVAL, 0, write_flash, save_record, &writer);
+    sha256_starts(&hash);
+    send(0, INTERVAL);
+    TEST_ASSERT_EQUAL(1, saves);
+
+    ota_checkpoint_t cp;
+    memcpy(&cp, nvs, sizeof(cp));
+    TEST_ASSERT_EQUAL_HEX32(OTA_CHECKPOINT_MAGIC, cp.magic);
+    TEST_ASSERT_EQUAL(ESP_OK, ota_checkpoint_validate(&cp, sizeof(cp)));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, ota_checkpoint_validate(&cp, sizeof(cp) - 4));
+
+    ota_checkpoint_t bad = cp;
+    bad.hash_state[7] ^= 0x10; // A torn or bit-flipped record
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_CRC, ota_checkpoint_validate(&bad, sizeof(bad)));
+
+    bad       = cp;
+    bad.magic = 0x324B434F;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_VERSION, ota_checkpoint_validate(&bad, sizeof(bad)));
+
+    bad        = cp;
+    bad.offset = image_len + OTA_CHECKPOINT_SECTOR; // Sealed, but past the end
+    ota_checkpoint_seal(&bad);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, ota_checkpoint_validate(&bad, sizeof(bad)));
+
+    bad        = cp;
+    bad.offset = INTERVAL - 1; // Not sector aligned: resuming would re-erase written bytes
+    ota_checkpoint_seal(&bad);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, ota_checkpoint_validate(&bad, sizeof(bad)));
+
+    bad = cp;
+    memset(bad.expected_sha256, 'a', sizeof(bad.expected_sha256)); // Unterminated
+    ota_checkpoint_seal(&bad);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, ota_checkpoint_validate(&bad, sizeof(bad)));
+}
+
+void test_record_matches_only_the_same_upload(void)
+{
+    make_image(200 * 1024);
+    ota_checkpoint_t cp;
+    memset(&cp, 0, sizeof(cp));
+    cp.firmware_size     = image_len;
+    cp.offset            = INTERVAL;
+    cp.partition_address = PARTITION_ADDRESS;
+    strcpy(cp.expected_sha256, image_hex);
+
+    char lower[65];
+    for (int i = 0; i < 65; i++) {
+        lower[i] = (char)(image_hex[i] >= 'A' && image_hex[i] <= 'F' ? image_hex[i] + 32 : image_hex[i]);
+    }
+    TEST_ASSERT_TRUE(ota_checkpoint_matches(&cp, image_len, lower, PARTITION_ADDRESS));
+    TEST_ASSERT_FALSE(ota_checkpoint_matches(&cp, image_len + 1, image_hex, PARTITION_ADDRESS));
+    TEST_ASSERT_FALSE(ota_checkpoint_matches(&cp, image_len, image_hex, PARTITION_ADDRESS + 0x100000));
+    TEST_ASSERT_FALSE(ota_checkpoint_matches(&cp, image_len, "", PARTITION_ADDRESS));
+    TEST_ASSERT_FALSE(ota_checkpoint_matches(&cp, image_len, NULL, PARTITION_ADDRESS));
+
+    lower[10] = lower[10] == '0' ? '1' : '0';
+    TEST_ASSERT_FALSE(ota_checkpoint_matches(&cp, image_len, lower, PARTITION_ADDRESS));
+
+    cp.offset = 0;
+    TEST_ASSERT_FALSE(ota_checkpoint_matches(&cp, image_len, image_hex, PARTITION_ADDRESS));
+}
+
+void test_writes_split_at_boundaries(void)
+{
+    make_image(IMAGE_MAX);
+    ota_checkpointer_init(&writer, INTERVAL, 0, write_flash, save_record, &writer);
+    sha256_starts(&hash);
+    TEST_ASSERT_EQUAL(ESP_OK, ota_checkpointer_write(&writer, image, 100));
+    TEST_ASSERT_EQUAL(ESP_OK, ota_checkpointer_write(&writer, image + 100, image_len - 100)); // One large write
+    TEST_ASSERT_EQUAL(0, boundary_crossings);
+    TEST_ASSERT_EQUAL(IMAGE_MAX / INTERVAL, saves);
+    assert_image_complete();
+
+    // Rounded down to whole sectors; 0 never saves
+    ota_checkpointer_init(&writer, 10000, 0, write_flash, save_record, &writer);
+    TEST_ASSERT_EQUAL_UINT32(8192, writer.interval);
+    saves = 0;
+    ota_checkpointer_init(&writer, 0, 0, write_flash, save_record, &writer);
+    sha256_starts(&hash);
+    send(0, image_len);
+    TEST_ASSERT_EQUAL(0, saves);
+}
+
+void test_failed_saves_are_counted_not_fatal(void)
+{
+    make_image(3 * INTERVAL);
+    ota_checkpointer_init(&writer, INTERVAL, 0, write_flash, save_record, &writer);
+    sha256_starts(&hash);
+    fail_saves = true;
+    send(0, image_len);
+    TEST_ASSERT_EQUAL_UINT32(3, writer.save_failures);
+    assert_image_complete();
+}
+
+void test_write_errors_propagate(void)
+{
+    make_image(INTERVAL);
+    ota_checkpointer_init(&writer, INTERVAL, 0, write_flash, save_record, &writer);
+    sha256_starts(&hash);
+    fail_writes = true;
+    TEST_ASSERT_EQUAL(ESP_FAIL, ota_checkpointer_write(&writer, image, 512));
+    TEST_ASSERT_EQUAL_UINT32(0, writer.offset);
+    TEST_ASSERT_EQUAL(0, saves);
+}
+
+void test_upload_dropped_at_90_percent_resumes(void)
+{
+    make_image(300 * 1024 + 123);
+    uint32_t drop = (uint32_t)(image_len * 9 / 10);
+
+    TEST_ASSERT_EQUAL_UINT32(0, reboot_and_resume());
+    send(0, drop);
+
+    uint32_t offset = reboot_and_resume();
+    TEST_ASSERT_EQUAL_UINT32(drop / INTERVAL * INTERVAL, offset);
+    send(offset, image_len);
+    assert_image_complete();
+}
+
+void test_repeated_random_drops_resume_to_the_same_hash(void)
+{
+    for (int round = 0; round < 20; round++) {
+        make_image(IMAGE_MAX - next_rand() % (64 * 1024));
+        nvs_len = 0;
+
+        uint32_t offset = reboot_and_resume();
+        uint32_t resent = 0;
+        for (int drops = 0; drops < 4; drops++) {
+            uint32_t drop = offset + next_rand() % (uint32_t)(image_len - offset);
+            send(offset, drop);
+            uint32_t resumed = reboot_and_resume();
+            TEST_ASSERT_TRUE(resumed <= drop && drop - resumed < INTERVAL);
+            resent += drop - resumed;
+            offset = resumed;
+        }
+        send(offset, image_len);
+        assert_image_complete();
+        TEST_ASSERT_TRUE(resent < 4 * INTERVAL);
+    }
+}
+
+void test_torn_record_starts_over(void)
+{
+    make_image(200 * 1024);
+    reboot_and_resume();
+    send(0, 150 * 1024);
+    TEST_ASSERT_EQUAL(2, saves);
+
+    nvs[offsetof(ota_checkpoint_t, offset)] ^= 0x01; // Power lost while NVS wrote it
+    TEST_ASSERT_EQUAL_UINT32(0, reboot_and_resume());
+    send(0, image_len);
+    assert_image_complete();
+}
+
+void test_drop_before_first_checkpoint_starts_over(void)
+{
+    make_image(200 * 1024);
+    reboot_and_resume();
+    send(0, INTERVAL - 1);
+    TEST_ASSERT_EQUAL(0, saves);
+    TEST_ASSERT_EQUAL_UINT32(0, reboot_and_resume());
+    send(0, image_len);
+    assert_image_complete();
+}
@@ -0,0 +1,308 @@
+/**
+ * @file test_ota_decompress.c
+ * @brief Unit tests for the compressed OTA container and the streaming LZSS decoder: a vector
+ *        from scripts/sign_firmware.py, and random images fed in random chunk sizes
+ */
+
+#define _DEFAULT_SOURCE // clock_gettime() under -std=c11
+
+#include "unity.h"
+#include "ota_decompress.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define IMAGE_MAX (48 * 1024)
+
+static uint8_t window[1 << OTA_LZSS_WINDOW_BITS_MAX];
+static uint8_t image[IMAGE_MAX];
+static uint8_t stream[IMAGE_MAX * 2];
+static uint8_t out[IMAGE_MAX];
+static size_t out_len;
+static size_t out_pieces;
+static size_t largest_piece;
+static uint32_t rng;
+
+void setUp(void)
+{
+    out_len       = 0;
+    out_pieces    = 0;
+    largest_piece = 0;
+    rng           = 0x12345678;
+}
+
+void tearDown(void)
+{
+}
+
+static uint32_t next_rand(void)
+{
+    rng = rng * 1103515245u + 12345u;
+    return rng >> 8;
+}
+
+static esp_err_t collect(const uint8_t *data, size_t len, void *ctx)
+{
+    (void)ctx;
+    TEST_ASSERT_TRUE(out_len + len <= sizeof(out));
+    memcpy(out + out_len, data, len);
+    out_len += len;
+    out_pieces++;
+    largest_piece = len > largest_piece ? len : largest_piece;
+    return ESP_OK;
+}
+
+static esp_err_t refuse(const uint8_t *data, size_t len, void *ctx)
+{
+    (void)data;
+    (void)len;
+    (void)ctx;
+    return ESP_ERR_INVALID_SIZE;
+}
+
+static void make_header(uint8_t *h, uint8_t window_bits, uint8_t lookahead_bits, uint32_t size)
+{
+    memset(h, 0, OTA_CONTAINER_HEADER_SIZE);
+    memcpy(h, OTA_CONTAINER_MAGIC, 4);
+    h[4]  = OTA_CONTAINER_FORMAT_LZSS;
+    h[5]  = window_bits;
+    h[6]  = lookahead_bits;
+    h[8]  = (uint8_t)size;
+    h[9]  = (uint8_t)(size >> 8);
+    h[10] = (uint8_t)(size >> 16);
+    h[11] = (uint8_t)(size >> 24);
+    memset(h + 12, 0xA5, 32);
+}
+
+static ota_container_t container(uint8_t window_bits, uint8_t lookahead_bits, uint32_t size)
+{
+    ota_container_t c = {
+        .format         = OTA_CONTAINER_FORMAT_LZSS,
+        .window_bits    = window_bits,
+        .lookahead_bits = lookahead_bits,
+        .image_size     = size,
+    };
+    return c;
+}
+
+// Test-side encoder: same bit format as sign_firmware.py, brute-force longest match
+typedef struct {
+    uint8_t *out;
+    size_t len;
+    uint32_t acc;
+    int count;
+} bit_writer_t;
+
+static void put_bits(bit_writer_t *w, uint32_t value, int bits)
+{
+    w->acc = w->acc << bits | value;
+    w->count += bits;
+    while (w->count >= 8) {
+        w->count -= 8;
+        w->out[w->len++] = (uint8_t)(w->acc >> w->count);
+    }
+}
+
+static size_t compress(const uint8_t *data, size_t len, int window_bits, int lookahead_bits)
+{
+    bit_writer_t w = {.out = stream};
+    size_t max_dist = (size_t)1 << window_bits;
+    size_t max_len  = (size_t)1 << lookahead_bits;
+
+    for (size_t pos = 0; pos < len;) {
+        size_t best_len = 0, best_dist = 0;
+        for (size_t dist = 1; dist <= max_dist && dist <= pos; dist++) {
+            size_t n = 0;
+            while (n < max_len && pos + n < len && data[pos + n - dist] == data[pos + n]) {
+                n++;
+            }
+            if (n > best_len) {
+                best_len  = n;
+                best_dist = dist;
+            }
+        }
+        if (best_len >= 3) {
+            put_bits(&w, 0, 1);
+            put_bits(&w, (uint32_t)(best_dist - 1), window_bits);
+            put_bits(&w, (uint32_t)(best_len - 1), lookahead_bits);
+            pos += best_len;
+        } else {
+            put_bits(&w, 0x100 | data[pos], 9);
+            pos++;
+        }
+    }
+    if (w.count) {
+        put_bits(&w, 0, 8 - w.count);
+    }
+    return w.len;
+}
+
+// Random bytes with repeats copied from near and far back, like code and its constant tables
+static void make_image(size_t len)
+{
+    for (size_t pos = 0; pos < len;) {
+        size_t run = 1 + next_rand() % 40;
+        if (pos > 64 && next_rand() % 3) {
+            size_t dist = 1 + next_rand() % (pos < 6000 ? pos : 6000);
+            for (size_t i = 0; i < run && pos < len; i++, pos++) {
+                image[pos] = image[pos - dist];
+            }
+        } else {
+            for (size_t i = 0; i < run && pos < len; i++, pos++) {
+                image[pos] = (uint8_t)next_rand();
+            }
+        }
+    }
+}
+
+static void feed_in_random_pieces(ota_decompress_t *dec, size_t len, size_t max_piece)
+{
+    for (size_t pos = 0; pos < len;) {
+        size_t n = 1 + next_rand() % max_piece;
+        n        = n < len - pos ? n : len - pos;
+        TEST_ASSERT_EQUAL(ESP_OK, ota_decompress_feed(dec, stream + pos, n));
+        pos += n;
+    }
+}
+
+void test_parse_header(void)
+{
+    uint8_t h[OTA_CONTAINER_HEADER_SIZE];
+    ota_container_t c;
+
+    make_header(h, 12, 4, 123456);
+    TEST_ASSERT_EQUAL(ESP_OK, ota_container_parse(h, sizeof(h), &c));
+    TEST_ASSERT_EQUAL(OTA_CONTAINER_FORMAT_LZSS, c.format);
+    TEST_ASSERT_EQUAL(12, c.window_bits);
+    TEST_ASSERT_EQUAL(4, c.lookahead_bits);
+    TEST_ASSERT_EQUAL_UINT32(123456, c.image_size);
+    uint8_t sha[32];
+    memset(sha, 0xA5, sizeof(sha));
+    TEST_ASSERT_EQUAL_MEMORY(sha, c.image_sha256, sizeof(sha));
+}
+
+void test_parse_tells_raw_images_and_incomplete_headers_apart(void)
+{
+    uint8_t h[OTA_CONTAINER_HEADER_SIZE];
+    uint8_t raw[OTA_CONTAINER_HEADER_SIZE] = {0xE9, 0x05}; // ESP image magic
+    ota_container_t c;
+
+    make_header(h, 12, 4, 100);
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, ota_container_parse(raw, sizeof(raw), &c));
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, ota_container_parse(raw, 1, &c));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, ota_container_parse(h, 2, &c));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, ota_container_parse(h, sizeof(h) - 1, &c));
+}
+
+void test_parse_rejects_what_the_decoder_cannot_hold(void)
+{
+    uint8_t h[OTA_CONTAINER_HEADER_SIZE];
+    ota_container_t c;
+
+    make_header(h, OTA_LZSS_WINDOW_BITS_MAX + 1, 4, 100);
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_SUPPORTED, ota_container_parse(h, sizeof(h), &c));
+    make_header(h, 8, 8, 100);
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_SUPPORTED, ota_container_parse(h, sizeof(h), &c));
+    make_header(h, 12, 4, 100);
+    h[4] = 2;
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_SUPPORTED, ota_container_parse(h, sizeof(h), &c));
+    make_header(h, 12, 4, 100);
+    h[7] = 1;
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_SUPPORTED, ota_container_parse(h, sizeof(h), &c));
+}
+
+void test_decodes_stream_from_sign_firmware_py(void)
+{
+    // lzss_compress(b'abracadabra abracadabra abracadabra!!') with the default W=12, L=4
+    static const uint8_t vector[] = {0xb0, 0xd8, 0xae, 0x56, 0x1b, 0x1d, 0x86, 0xc8, 0x00,
+                                     0x63, 0x90, 0x00, 0x2f, 0xc0, 0x16, 0xd2, 0x19, 0x08};
+    static const char expected[]  = "abracadabra abracadabra abracadabra!!";
+    ota_container_t c             = container(12, 4, sizeof(expected) - 1);
+    ota_decompress_t dec;
+
+    for (size_t piece = 1; piece <= sizeof(vector); piece++) {
+        out_len = 0;
+        ota_decompress_init(&dec, &c, window, collect, NULL);
+        for (size_t pos = 0; pos < sizeof(vector); pos += piece) {
+            size_t n = piece < sizeof(vector) - pos ? piece : sizeof(vector) - pos;
+            TEST_ASSERT_EQUAL(ESP_OK, ota_decompress_feed(&dec, vector + pos, n));
+        }
+        TEST_ASSERT_EQUAL(sizeof(expected) - 1, out_len);
+        TEST_ASSERT_EQUAL_MEMORY(expected, out, out_len);
+    }
+}
+
+void test_random_images_in_random_chunk_sizes(void)
+{
+    static const struct {
+        uint8_t window_bits;
+        uint8_t lookahead_bits;
+        size_t max_piece;
+    } cases[] = {{12, 4, 1}, {12, 4, 7}, {12, 4, 4096}, {8, 4, 300}, {10, 6, 33}, {4, 3, 2}};
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        setUp();
+        size_t len = 8192 + next_rand() % 8192;
+        make_image(len);
+        size_t packed = compress(image, len, cases[i].window_bits, cases[i].lookahead_bits);
+
+        ota_container_t c = container(cases[i].window_bits, cases[i].lookahead_bits, (uint32_t)len);
+        ota_decompress_t dec;
+        ota_decompress_init(&dec, &c, window, collect, NULL);
+        feed_in_random_pieces(&dec, packed, cases[i].max_piece);
+
+        TEST_ASSERT_EQUAL(len, out_len);
+        TEST_ASSERT_EQUAL_MEMORY(image, out, len);
+        // Bounded RAM: the decoder never holds more than its window
+        TEST_ASSERT_TRUE(largest_piece <= ((size_t)1 << cases[i].window_bits));
+    }
+}
+
+void test_back_reference_before_start_is_rejected(void)
+{
+    // Tag 0, distance 1, length 3 with nothing decoded yet
+    static const uint8_t bad[] = {0x00, 0x00, 0x20};
+    ota_container_t c          = container(12, 4, 100);
+    ota_decompress_t dec;
+
+    ota_decompress_init(&dec, &c, window, collect, NULL);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, ota_decompress_feed(&dec, bad, sizeof(bad)));
+    TEST_ASSERT_EQUAL(0, out_len);
+}
+
+void test_sink_error_stops_decoding(void)
+{
+    make_image(4096);
+    size_t packed     = compress(image, 4096, 12, 4);
+    ota_container_t c = container(12, 4, 4096);
+    ota_decompress_t dec;
+
+    ota_decompress_init(&dec, &c, window, refuse, NULL);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, ota_decompress_feed(&dec, stream, packed));
+}
+
+void test_benchmark_decode(void)
+{
+    size_t len = IMAGE_MAX;
+    make_image(len);
+    size_t packed = compress(image, len, 12, 4);
+
+    ota_container_t c = container(12, 4, (uint32_t)len);
+    ota_decompress_t dec;
+    struct timespec t0, t1;
+    int rounds = 50;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int i = 0; i < rounds; i++) {
+        out_len = 0;
+        ota_decompress_init(&dec, &c, window, collect, NULL);
+        feed_in_random_pieces(&dec, packed, 512);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    TEST_ASSERT_EQUAL_MEMORY(image, out, len);
+
+    double s = (double)(t1.tv_sec - t0.tv_sec) + (double)(t1.tv_nsec - t0.tv_nsec) / 1e9;
+    printf("[BENCH][ota_decompress] %zu -> %zu bytes (%.1f%%), decode %.1f MiB/s, %zu sink calls per image\n", len,
+           packed, 100.0 * (double)packed / (double)len, (double)len * rounds / s / (1024 * 1024), out_pieces);
+}
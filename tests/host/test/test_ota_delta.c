@@ -0,0 +1,321 @@
+/**
+ * @file test_ota_delta.c
+ * @brief Unit tests for delta patches: a compressed patch from scripts/make_delta.py, and
+ *        synthetic images rebuilt from random records fed in random chunk sizes
+ */
+
+#include "unity.h"
+#include "ota_decompress.h"
+#include "ota_delta.h"
+#include <string.h>
+
+#define BASE_MAX (64 * 1024)
+#define IMAGE_MAX (96 * 1024)
+
+static uint8_t base[BASE_MAX];
+static size_t base_len;
+static uint8_t image[IMAGE_MAX]; // What the patch must produce
+static size_t image_len;
+static uint8_t body[IMAGE_MAX * 2];
+static size_t body_len;
+static uint8_t out[IMAGE_MAX];
+static size_t out_len;
+static size_t largest_read;
+static bool fail_reads;
+static uint32_t rng;
+static ota_delta_t delta;
+
+void setUp(void)
+{
+    base_len     = 0;
+    image_len    = 0;
+    body_len     = 0;
+    out_len      = 0;
+    largest_read = 0;
+    fail_reads   = false;
+    rng          = 0x2468ACE1;
+}
+
+void tearDown(void)
+{
+}
+
+static uint32_t next_rand(void)
+{
+    rng = rng * 1103515245u + 12345u;
+    return rng >> 8;
+}
+
+static esp_err_t read_base(uint32_t offset, uint8_t *buf, size_t len, void *ctx)
+{
+    (void)ctx;
+    if (fail_reads) {
+        return ESP_FAIL;
+    }
+    TEST_ASSERT_TRUE(offset + len <= base_len);
+    memcpy(buf, base + offset, len);
+    largest_read = len > largest_read ? len : largest_read;
+    return ESP_OK;
+}
+
+static esp_err_t collect(const uint8_t *data, size_t len, void *ctx)
+{
+    (void)ctx;
+    TEST_ASSERT_TRUE(out_len + len <= sizeof(out));
+    memcpy(out + out_len, data, len);
+    out_len += len;
+    return ESP_OK;
+}
+
+static ota_delta_header_t header(uint32_t base_size, uint32_t image_size)
+{
+    ota_delta_header_t h = {
+        .format     = OTA_DELTA_FORMAT_BSDIFF,
+        .base_size  = base_size,
+        .image_size = image_size,
+    };
+    return h;
+}
+
+static void put_varint(uint32_t value)
+{
+    do {
+        uint8_t byte = value & 0x7F;
+        value >>= 7;
+        body[body_len++] = byte | (value ? 0x80 : 0);
+    } while (value);
+}
+
+static void put_record(size_t diff_len, const uint8_t *diff, size_t extra_len, const uint8_t *extra, int32_t seek)
+{
+    put_varint((uint32_t)diff_len);
+    if (diff_len > 0) {
+        memcpy(body + body_len, diff, diff_len);
+        body_len += diff_len;
+    }
+    put_varint((uint32_t)extra_len);
+    if (extra_len > 0) {
+        memcpy(body + body_len, extra, extra_len);
+        body_len += extra_len;
+    }
+    put_varint(seek >= 0 ? (uint32_t)seek * 2 : (uint32_t)(-seek) * 2 - 1);
+}
+
+static void make_base(size_t len)
+{
+    base_len = len;
+    for (size_t i = 0; i < len; i++) {
+        base[i] = (uint8_t)(next_rand() % 7 == 0 ? next_rand() : i >> 3);
+    }
+}
+
+/**
+ * A new build of the base: runs carried over with sparse byte changes (moved code fixing up
+ * its addresses), inserted bytes, and jumps back and forth in the base. Writes the image the
+ * patch should produce and the patch body.
+ */
+static void make_synthetic_patch(size_t target_len)
+{
+    uint8_t diff[2048];
+    uint8_t extra[512];
+    int64_t bpos = 0;
+
+    while (image_len < target_len) {
+        size_t run = next_rand() % sizeof(diff);
+        run        = run < base_len - (size_t)bpos ? run : base_len - (size_t)bpos;
+        for (size_t i = 0; i < run; i++) {
+            diff[i]              = next_rand() % 20 == 0 ? (uint8_t)next_rand() : 0;
+            image[image_len + i] = (uint8_t)(base[bpos + i] + diff[i]);
+        }
+        image_len += run;
+        bpos += run;
+
+        size_t extra_len = next_rand() % 4 == 0 ? next_rand() % sizeof(extra) : 0;
+        for (size_t i = 0; i < extra_len; i++) {
+            extra[i]             = (uint8_t)next_rand();
+            image[image_len + i] = extra[i];
+        }
+        image_len += extra_len;
+
+        int64_t target = (int64_t)(next_rand() % base_len);
+        put_record(run, diff, extra_len, extra, (int32_t)(target - bpos));
+        bpos = target;
+    }
+}
+
+static void feed_in_random_pieces(size_t max_piece)
+{
+    for (size_t pos = 0; pos < body_len;) {
+        size_t n = 1 + next_rand() % max_piece;
+        n        = n < body_len - pos ? n : body_len - pos;
+        TEST_ASSERT_EQUAL(ESP_OK, ota_delta_feed(body + pos, n, &delta));
+        pos += n;
+    }
+}
+
+void test_parse_header(void)
+{
+    uint8_t h[OTA_DELTA_HEADER_SIZE] = OTA_DELTA_MAGIC;
+    ota_delta_header_t parsed;
+
+    h[4]  = OTA_DELTA_FORMAT_BSDIFF;
+    h[5]  = 12;
+    h[6]  = 10;
+    h[8]  = 0x58; // base_size 600
+    h[9]  = 0x02;
+    h[12] = 0x53; // image_size 595
+    h[13] = 0x02;
+    memset(h + 16, 0x11, 32);
+    memset(h + 48, 0x22, 32);
+
+    TEST_ASSERT_EQUAL(ESP_OK, ota_delta_parse(h, sizeof(h), &parsed));
+    TEST_ASSERT_EQUAL(12, parsed.window_bits);
+    TEST_ASSERT_EQUAL(10, parsed.lookahead_bits);
+    TEST_ASSERT_EQUAL_UINT32(600, parsed.base_size);
+    TEST_ASSERT_EQUAL_UINT32(595, parsed.image_size);
+    TEST_ASSERT_EQUAL_HEX8(0x11, parsed.base_sha256[31]);
+    TEST_ASSERT_EQUAL_HEX8(0x22, parsed.image_sha256[0]);
+
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, ota_delta_parse(h, 3, &parsed));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, ota_delta_parse(h, sizeof(h) - 1, &parsed));
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, ota_delta_parse((const uint8_t *)"LCZ1", 4, &parsed));
+
+    h[5] = 0; // Stored body
+    TEST_ASSERT_EQUAL(ESP_OK, ota_delta_parse(h, sizeof(h), &parsed));
+    h[5] = OTA_LZSS_WINDOW_BITS_MAX + 1;
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_SUPPORTED, ota_delta_parse(h, sizeof(h), &parsed));
+    h[5] = 12;
+    h[4] = 2;
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_SUPPORTED, ota_delta_parse(h, sizeof(h), &parsed));
+}
+
+void test_applies_compressed_patch_from_make_delta_py(void)
+{
+    // make_patch(base, new) in scripts/make_delta.py, body only; base and new as built below
+    static const uint8_t patch_body[] = {
+        0xb2, 0x40, 0x00, 0x00, 0x31, 0x41, 0x69, 0x14, 0x5a, 0x65, 0x32, 0x9f, 0x00,
+        0xe4, 0x40, 0x40, 0x34, 0x08, 0x80, 0x00, 0xb6, 0x8a, 0x68, 0xa0, 0x40, 0x14,
+        0x04, 0x40, 0x00, 0x23, 0x84, 0x98, 0x03, 0x00, 0x18, 0x46, 0x00, 0x02, 0x84,
+    };
+    static uint8_t window[1 << 12];
+
+    base_len = 600;
+    for (size_t i = 0; i < base_len; i++) {
+        base[i] = (uint8_t)((i * 7) ^ (i >> 5));
+    }
+    // new = base with bytes 400..436 step 4 incremented, 300..309 deleted, "HELLO" at 100
+    memcpy(image, base, 100);
+    memcpy(image + 100, "HELLO", 5);
+    memcpy(image + 105, base + 100, 200);
+    memcpy(image + 305, base + 310, 290);
+    for (size_t i = 400; i < 440; i += 4) {
+        image[i - 10 + 5]++;
+    }
+    image_len = 595;
+
+    ota_delta_header_t h = header(600, 595);
+    h.window_bits        = 12;
+    h.lookahead_bits     = 10;
+    ota_container_t lzss;
+    ota_decompress_t dec;
+    ota_delta_body_container(&h, &lzss);
+
+    for (size_t piece = 1; piece <= sizeof(patch_body); piece += 5) {
+        out_len = 0;
+        ota_delta_init(&delta, &h, read_base, NULL, collect, NULL);
+        ota_decompress_init(&dec, &lzss, window, ota_delta_feed, &delta);
+        for (size_t pos = 0; pos < sizeof(patch_body); pos += piece) {
+            size_t n = piece < sizeof(patch_body) - pos ? piece : sizeof(patch_body) - pos;
+            TEST_ASSERT_EQUAL(ESP_OK, ota_decompress_feed(&dec, patch_body + pos, n));
+        }
+        TEST_ASSERT_TRUE(ota_delta_complete(&delta));
+        TEST_ASSERT_EQUAL(image_len, out_len);
+        TEST_ASSERT_EQUAL_MEMORY(image, out, image_len);
+    }
+}
+
+void test_synthetic_images_in_random_chunk_sizes(void)
+{
+    static const size_t max_piece[] = {1, 3, 64, 1000, 9000};
+
+    for (size_t i = 0; i < sizeof(max_piece) / sizeof(max_piece[0]); i++) {
+        setUp();
+        rng += (uint32_t)i;
+        make_base(16 * 1024 + next_rand() % (48 * 1024));
+        make_synthetic_patch(8 * 1024 + next_rand() % (80 * 1024));
+
+        ota_delta_header_t h = header((uint32_t)base_len, (uint32_t)image_len);
+        ota_delta_init(&delta, &h, read_base, NULL, collect, NULL);
+        feed_in_random_pieces(max_piece[i]);
+
+        TEST_ASSERT_TRUE(ota_delta_complete(&delta));
+        TEST_ASSERT_EQUAL(image_len, out_len);
+        TEST_ASSERT_EQUAL_MEMORY(image, out, image_len);
+        // Bounded RAM: base reads never exceed the scratch buffer
+        TEST_ASSERT_TRUE(largest_read <= OTA_DELTA_SCRATCH);
+    }
+}
+
+void test_identical_image_is_one_record(void)
+{
+    static uint8_t zeros[8 * 1024];
+
+    make_base(sizeof(zeros));
+    memcpy(image, base, base_len);
+    image_len = base_len;
+    put_record(base_len, zeros, 0, NULL, 0);
+
+    ota_delta_header_t h = header((uint32_t)base_len, (uint32_t)image_len);
+    ota_delta_init(&delta, &h, read_base, NULL, collect, NULL);
+    feed_in_random_pieces(500);
+    TEST_ASSERT_TRUE(ota_delta_complete(&delta));
+    TEST_ASSERT_EQUAL_MEMORY(base, out, base_len);
+}
+
+void test_records_outside_the_base_are_rejected(void)
+{
+    uint8_t diff[16] = {0};
+    ota_delta_header_t h;
+
+    make_base(1024);
+
+    // Seek before the start, then diff
+    put_record(0, NULL, 0, NULL, -1);
+    put_record(4, diff, 0, NULL, 0);
+    h = header(1024, 100);
+    ota_delta_init(&delta, &h, read_base, NULL, collect, NULL);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, ota_delta_feed(body, body_len, &delta));
+
+    // Diff running past the end of the base
+    body_len = 0;
+    put_record(0, NULL, 0, NULL, 1020);
+    put_record(8, diff, 0, NULL, 0);
+    ota_delta_init(&delta, &h, read_base, NULL, collect, NULL);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, ota_delta_feed(body, body_len, &delta));
+    TEST_ASSERT_EQUAL(0, out_len);
+}
+
+void test_output_beyond_image_size_is_rejected(void)
+{
+    uint8_t extra[32] = {0};
+    ota_delta_header_t h;
+
+    make_base(1024);
+    put_record(0, NULL, sizeof(extra), extra, 0);
+    h = header(1024, sizeof(extra) - 1);
+    ota_delta_init(&delta, &h, read_base, NULL, collect, NULL);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, ota_delta_feed(body, body_len, &delta));
+    TEST_ASSERT_FALSE(ota_delta_complete(&delta));
+}
+
+void test_base_read_error_stops_patching(void)
+{
+    uint8_t diff[8] = {0};
+
+    make_base(1024);
+    put_record(sizeof(diff), diff, 0, NULL, 0);
+    ota_delta_header_t h = header(1024, sizeof(diff));
+    ota_delta_init(&delta, &h, read_base, NULL, collect, NULL);
+    fail_reads = true;
+    TEST_ASSERT_EQUAL(ESP_FAIL, ota_delta_feed(body, body_len, &delta));
+}
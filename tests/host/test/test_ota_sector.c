@@ -0,0 +1,169 @@
+/**
+ * @file test_ota_sector.c
+ * @brief Unit tests for the sector writer: uploads in random pieces reach a simulated
+ *        partition as whole, erased, aligned sectors, and the eraser's block steps
+ */
+
+#include "unity.h"
+#include "ota_sector.h"
+#include <string.h>
+
+#define PARTITION_SIZE (256 * 1024)
+
+static uint8_t partition[PARTITION_SIZE];
+static uint8_t image[PARTITION_SIZE];
+static uint8_t buf[OTA_SECTOR_SIZE];
+static uint32_t erased_to;   // Simulated eraser position
+static uint32_t erase_limit; // Eraser stops here, as after a flash error
+static int programs;
+static int copies_avoided;
+static size_t last_len;
+static uint32_t rng;
+static ota_sector_writer_t writer;
+
+void setUp(void)
+{
+    memset(partition, 0x00, sizeof(partition)); // Old image: programming it without erasing shows
+    erased_to      = 0;
+    erase_limit    = PARTITION_SIZE;
+    programs       = 0;
+    copies_avoided = 0;
+    last_len       = 0;
+    rng            = 0xC0FFEE11;
+    for (size_t i = 0; i < sizeof(image); i++) {
+        image[i] = (uint8_t)(i * 7 + (i >> 9));
+    }
+}
+
+void tearDown(void)
+{
+}
+
+static uint32_t next_rand(void)
+{
+    rng = rng * 1103515245u + 12345u;
+    return rng >> 8;
+}
+
+static esp_err_t wait_erased(uint32_t end, void *ctx)
+{
+    (void)ctx;
+    while (erased_to < end) {
+        if (erased_to >= erase_limit) {
+            return ESP_ERR_INVALID_STATE;
+        }
+        uint32_t step = ota_sector_erase_step(erased_to, erase_limit);
+        memset(partition + erased_to, 0xFF, step);
+        erased_to += step;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t program(uint32_t offset, const uint8_t *data, size_t len, void *ctx)
+{
+    (void)ctx;
+    TEST_ASSERT_EQUAL_UINT32(0, offset % OTA_SECTOR_SIZE);
+    TEST_ASSERT_EQUAL(0, len % OTA_SECTOR_ALIGN);
+    TEST_ASSERT_TRUE(offset + len <= erased_to);
+    for (size_t i = 0; i < len; i++) {
+        TEST_ASSERT_EQUAL_HEX8(0xFF, partition[offset + i]);
+    }
+    memcpy(partition + offset, data, len);
+    if (data != buf) {
+        copies_avoided++;
+    }
+    programs++;
+    last_len = len;
+    return ESP_OK;
+}
+
+static void write_random_pieces(uint32_t from, uint32_t until)
+{
+    while (from < until) {
+        uint32_t n = 1 + next_rand() % (3 * OTA_SECTOR_SIZE);
+        n          = n < until - from ? n : until - from;
+        TEST_ASSERT_EQUAL(ESP_OK, ota_sector_writer_write(&writer, image + from, n));
+        from += n;
+    }
+}
+
+void test_random_pieces_reach_flash_as_whole_sectors(void)
+{
+    const uint32_t size = 200 * 1024 + 1234;
+    ota_sector_writer_init(&writer, buf, 0, program, wait_erased, NULL);
+    write_random_pieces(0, size);
+
+    TEST_ASSERT_EQUAL(size / OTA_SECTOR_SIZE, programs); // Everything but the tail
+    TEST_ASSERT_EQUAL(size % OTA_SECTOR_SIZE, writer.fill);
+    TEST_ASSERT_EQUAL(ESP_OK, ota_sector_writer_flush(&writer));
+    TEST_ASSERT_EQUAL(size / OTA_SECTOR_SIZE + 1, programs);
+    TEST_ASSERT_EQUAL((size % OTA_SECTOR_SIZE + 15) / 16 * 16, last_len);
+    TEST_ASSERT_EQUAL_MEMORY(image, partition, size);
+
+    // Padding is 0xFF, as erased flash: the image verifier never sees it as data
+    for (uint32_t i = size; i < writer.offset; i++) {
+        TEST_ASSERT_EQUAL_HEX8(0xFF, partition[i]);
+    }
+    TEST_ASSERT_EQUAL(ESP_OK, ota_sector_writer_flush(&writer)); // Nothing left
+    TEST_ASSERT_EQUAL(size / OTA_SECTOR_SIZE + 1, programs);
+}
+
+void test_aligned_sectors_are_programmed_without_a_copy(void)
+{
+    ota_sector_writer_init(&writer, buf, 0, program, wait_erased, NULL);
+    TEST_ASSERT_EQUAL(ESP_OK, ota_sector_writer_write(&writer, image, 16 * OTA_SECTOR_SIZE));
+    TEST_ASSERT_EQUAL(16, programs);
+    TEST_ASSERT_EQUAL(16, copies_avoided);
+
+    // A partial sector goes through the buffer; once it is complete, whole sectors skip it again
+    TEST_ASSERT_EQUAL(ESP_OK, ota_sector_writer_write(&writer, image + 16 * OTA_SECTOR_SIZE, 100));
+    TEST_ASSERT_EQUAL(ESP_OK,
+                      ota_sector_writer_write(&writer, image + 16 * OTA_SECTOR_SIZE + 100, 2 * OTA_SECTOR_SIZE));
+    TEST_ASSERT_EQUAL(18, programs);
+    TEST_ASSERT_EQUAL(17, copies_avoided);
+    TEST_ASSERT_EQUAL(100, writer.fill);
+    TEST_ASSERT_EQUAL_MEMORY(image, partition, 18 * OTA_SECTOR_SIZE);
+}
+
+void test_writes_start_at_a_resume_offset(void)
+{
+    const uint32_t offset = 64 * 1024;
+    erased_to             = offset; // Sectors before it hold the checkpointed part of the image
+    memcpy(partition, image, offset);
+
+    ota_sector_writer_init(&writer, buf, offset, program, wait_erased, NULL);
+    write_random_pieces(offset, PARTITION_SIZE);
+    TEST_ASSERT_EQUAL(ESP_OK, ota_sector_writer_flush(&writer));
+    TEST_ASSERT_EQUAL((PARTITION_SIZE - offset) / OTA_SECTOR_SIZE, programs);
+    TEST_ASSERT_EQUAL_MEMORY(image, partition, PARTITION_SIZE);
+}
+
+void test_eraser_errors_stop_the_writer(void)
+{
+    erase_limit = 8 * OTA_SECTOR_SIZE;
+    ota_sector_writer_init(&writer, buf, 0, program, wait_erased, NULL);
+    TEST_ASSERT_EQUAL(ESP_OK, ota_sector_writer_write(&writer, image, 8 * OTA_SECTOR_SIZE));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, ota_sector_writer_write(&writer, image, OTA_SECTOR_SIZE));
+    TEST_ASSERT_EQUAL(8, programs);
+    TEST_ASSERT_EQUAL_UINT32(8 * OTA_SECTOR_SIZE, writer.offset);
+}
+
+void test_erase_steps_follow_block_boundaries(void)
+{
+    TEST_ASSERT_EQUAL_UINT32(OTA_SECTOR_ERASE_BLOCK, ota_sector_erase_step(0, 200 * 1024));
+    TEST_ASSERT_EQUAL_UINT32(OTA_SECTOR_ERASE_BLOCK - OTA_SECTOR_SIZE, ota_sector_erase_step(4096, 200 * 1024));
+    TEST_ASSERT_EQUAL_UINT32(8 * 1024, ota_sector_erase_step(192 * 1024, 200 * 1024));
+    TEST_ASSERT_EQUAL_UINT32(0, ota_sector_erase_step(200 * 1024, 200 * 1024));
+
+    // A resumed upload erases from its offset: whole blocks once aligned again
+    uint32_t erased = 20 * 1024, steps = 0;
+    while (erased < 200 * 1024) {
+        uint32_t step = ota_sector_erase_step(erased, 200 * 1024);
+        TEST_ASSERT_TRUE(step > 0 && step <= OTA_SECTOR_ERASE_BLOCK);
+        TEST_ASSERT_EQUAL_UINT32(erased / OTA_SECTOR_ERASE_BLOCK, (erased + step - 1) / OTA_SECTOR_ERASE_BLOCK);
+        erased += step;
+        steps++;
+    }
+    TEST_ASSERT_EQUAL_UINT32(200 * 1024, erased);
+    TEST_ASSERT_EQUAL_UINT32(4, steps);
+}
@@ -0,0 +1,139 @@
+/**
+ * @file test_replay_window.c
+ * @brief Unit tests for the per-device replay window, including a re-paired presenter
+ */
+
+#include "unity.h"
+#include "replay_window.h"
+#include <stdint.h>
+
+static replay_window_t window;
+
+void setUp(void)
+{
+    window = (replay_window_t){0};
+}
+
+void tearDown(void)
+{
+}
+
+void test_first_packet_starts_the_window(void)
+{
+    TEST_ASSERT_EQUAL(REPLAY_WINDOW_FIRST, replay_window_check(&window, 1234));
+    TEST_ASSERT_EQUAL(1234, window.highest);
+    TEST_ASSERT_EQUAL(REPLAY_WINDOW_DUPLICATE, replay_window_check(&window, 1234));
+}
+
+void test_in_order_out_of_order_and_duplicates(void)
+{
+    replay_window_check(&window, 10);
+    TEST_ASSERT_EQUAL(REPLAY_WINDOW_NEW, replay_window_check(&window, 11));
+    TEST_ASSERT_EQUAL(REPLAY_WINDOW_NEW, replay_window_check(&window, 14));
+    TEST_ASSERT_EQUAL(REPLAY_WINDOW_OUT_OF_ORDER, replay_window_check(&window, 13));
+    TEST_ASSERT_EQUAL(REPLAY_WINDOW_DUPLICATE, replay_window_check(&window, 13));
+    TEST_ASSERT_EQUAL(REPLAY_WINDOW_DUPLICATE, replay_window_check(&window, 11));
+    TEST_ASSERT_EQUAL(14, window.highest);
+}
+
+void test_packets_behind_the_window_are_stale(void)
+{
+    replay_window_check(&window, 100);
+    TEST_ASSERT_EQUAL(REPLAY_WINDOW_OUT_OF_ORDER, replay_window_check(&window, 100 - (REPLAY_WINDOW_RECENT - 1)));
+    TEST_ASSERT_EQUAL(REPLAY_WINDOW_STALE, replay_window_check(&window, 100 - REPLAY_WINDOW_RECENT));
+}
+
+void test_large_gap_restarts_the_window(void)
+{
+    replay_window_check(&window, 5);
+    TEST_ASSERT_EQUAL(REPLAY_WINDOW_JUMP, replay_window_check(&window, 5 + REPLAY_WINDOW_GAP));
+    TEST_ASSERT_EQUAL(1, window.recent);
+    TEST_ASSERT_EQUAL(REPLAY_WINDOW_STALE, replay_window_check(&window, 6));
+}
+
+void test_wraparound_is_forward_progress(void)
+{
+    replay_window_check(&window, UINT16_MAX - 1);
+    TEST_ASSERT_EQUAL(REPLAY_WINDOW_NEW, replay_window_check(&window, 1));
+    TEST_ASSERT_EQUAL(REPLAY_WINDOW_OUT_OF_ORDER, replay_window_check(&window, UINT16_MAX));
+    TEST_ASSERT_EQUAL(REPLAY_WINDOW_DUPLICATE, replay_window_check(&window, UINT16_MAX - 1));
+}
+
+void test_restored_window_rejects_everything_up_to_the_end_of_the_block(void)
+{
+    replay_window_restore(&window, 5000);
+    TEST_ASSERT_EQUAL(REPLAY_WINDOW_DUPLICATE, replay_window_check(&window, 5000 + SEQ_JOURNAL_BLOCK_SIZE - 2));
+    TEST_ASSERT_EQUAL(REPLAY_WINDOW_STALE, replay_window_check(&window, 5001));
+    TEST_ASSERT_EQUAL(REPLAY_WINDOW_STALE, replay_window_check(&window, 3));
+    TEST_ASSERT_EQUAL(REPLAY_WINDOW_NEW, replay_window_check(&window, 5000 + SEQ_JOURNAL_BLOCK_SIZE));
+}
+
+void test_packets_accepted_since_the_last_snapshot_are_rejected_after_a_reboot(void)
+{
+    // Journal as device_registry does: on the first packet, then once per block crossed
+    uint16_t journaled      = 0;
+    bool has_journal        = false;
+    const uint16_t start    = 0xFF80; // The block wraps the 16-bit sequence space
+    const uint16_t accepted = SEQ_JOURNAL_BLOCK_SIZE + 100;
+
+    for (uint16_t i = 0; i <= accepted; i++) {
+        uint16_t seq = (uint16_t)(start + i);
+        TEST_ASSERT_TRUE(replay_window_accepted(replay_window_check(&window, seq)));
+        if (!has_journal || seq_journal_block_crossed(journaled, window.highest)) {
+            journaled   = window.highest;
+            has_journal = true;
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT16((uint16_t)(start + SEQ_JOURNAL_BLOCK_SIZE), journaled);
+
+    // Receiver reboots: the 100 packets after the last snapshot must not be replayable
+    replay_window_restore(&window, journaled);
+    for (uint16_t i = SEQ_JOURNAL_BLOCK_SIZE + 1; i <= accepted; i++) {
+        TEST_ASSERT_FALSE(replay_window_accepted(replay_window_check(&window, (uint16_t)(start + i))));
+    }
+
+    // A sender that skipped a block after the reboot (lora_protocol.c) is ahead again
+    uint16_t resynced = (uint16_t)(start + accepted + 1 + SEQ_JOURNAL_BLOCK_SIZE);
+    TEST_ASSERT_TRUE(replay_window_accepted(replay_window_check(&window, resynced)));
+}
+
+void test_repaired_presenter_counting_from_zero_is_accepted_after_reset(void)
+{
+    // The receiver still holds the window of the presenter before its factory reset
+    replay_window_restore(&window, 5000);
+    for (uint16_t seq = 0; seq < 4; seq++) {
+        TEST_ASSERT_EQUAL(REPLAY_WINDOW_STALE, replay_window_check(&window, seq));
+    }
+
+    // Re-pairing resets the window, as device_registry_add() does for a known device
+    window = (replay_window_t){0};
+    TEST_ASSERT_EQUAL(REPLAY_WINDOW_FIRST, replay_window_check(&window, 0));
+    TEST_ASSERT_EQUAL(REPLAY_WINDOW_NEW, replay_window_check(&window, 1));
+    TEST_ASSERT_EQUAL(REPLAY_WINDOW_DUPLICATE, replay_window_check(&window, 0));
+}
+
+void test_sender_behind_the_window_is_locked_out_until_re_paired(void)
+{
+    replay_window_check(&window, 20000);
+
+    // A sender that started over lower (or a replayed capture) is never taken for a restart
+    for (uint16_t seq = 1000; seq < 1500; seq++) {
+        TEST_ASSERT_EQUAL(REPLAY_WINDOW_STALE, replay_window_check(&window, seq));
+    }
+    // More than half the sequence space ahead reads as behind
+    TEST_ASSERT_EQUAL(REPLAY_WINDOW_STALE, replay_window_check(&window, (uint16_t)(20000 + 0x8001)));
+    TEST_ASSERT_EQUAL(20000, window.highest);
+
+    window = (replay_window_t){0};
+    TEST_ASSERT_EQUAL(REPLAY_WINDOW_FIRST, replay_window_check(&window, 1000));
+}
+
+void test_only_new_and_out_of_order_results_are_accepted(void)
+{
+    TEST_ASSERT_TRUE(replay_window_accepted(REPLAY_WINDOW_FIRST));
+    TEST_ASSERT_TRUE(replay_window_accepted(REPLAY_WINDOW_NEW));
+    TEST_ASSERT_TRUE(replay_window_accepted(REPLAY_WINDOW_JUMP));
+    TEST_ASSERT_TRUE(replay_window_accepted(REPLAY_WINDOW_OUT_OF_ORDER));
+    TEST_ASSERT_FALSE(replay_window_accepted(REPLAY_WINDOW_DUPLICATE));
+    TEST_ASSERT_FALSE(replay_window_accepted(REPLAY_WINDOW_STALE));
+}
@@ -0,0 +1,466 @@
+/**
+ * @file test_rpc_frame.c
+ * @brief Unit tests and round-trip benchmark for binary RPC framing (COBS + CRC, CBOR)
+ */
+
+#define _POSIX_C_SOURCE 199309L // clock_gettime
+
+#include "unity.h"
+#include "json_stream.h"
+#include "rpc_frame.h"
+#include "rpc_schema.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_ITERATIONS 20000
+#define UART_BYTES_PER_SEC (460800 / 10) // uart_commands.c line rate, 8N1
+#define MAX_MESSAGES 8
+
+static uint8_t wire[4096];
+static size_t wire_len;
+static int wire_writes;
+
+typedef struct {
+    char data[512];
+    size_t len;
+    bool binary;
+} message_t;
+
+static message_t messages[MAX_MESSAGES];
+static int message_count;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void wire_sink(const char *data, size_t len, void *ctx)
+{
+    (void)ctx;
+    TEST_ASSERT_TRUE(wire_len + len <= sizeof(wire));
+    memcpy(wire + wire_len, data, len);
+    wire_len += len;
+    wire_writes++;
+}
+
+static void on_message(char *msg, size_t len, bool binary, void *ctx)
+{
+    (void)ctx;
+    TEST_ASSERT_TRUE(message_count < MAX_MESSAGES);
+    TEST_ASSERT_TRUE(len < sizeof(messages[0].data));
+    memcpy(messages[message_count].data, msg, len);
+    messages[message_count].data[len] = '\0';
+    messages[message_count].len    = len;
+    messages[message_count].binary = binary;
+    message_count++;
+}
+
+void setUp(void)
+{
+    wire_len      = 0;
+    wire_writes   = 0;
+    message_count = 0;
+}
+
+void tearDown(void)
+{
+}
+
+// Frames payload onto the wire with the streaming encoder, fed in uneven pieces
+static void encode(const uint8_t *payload, size_t len)
+{
+    rpc_frame_encoder_t enc;
+    rpc_frame_encoder_begin(&enc, wire_sink, NULL);
+    size_t step = 1;
+    for (size_t i = 0; i < len; i += step, step = step * 3 % 17 + 1) {
+        size_t n = len - i < step ? len - i : step;
+        rpc_frame_encoder_write((const char *)payload + i, n, &enc);
+    }
+    rpc_frame_encoder_end(&enc);
+}
+
+//==============================================================================
+// FRAMING
+//==============================================================================
+
+void test_crc16_check_value(void)
+{
+    TEST_ASSERT_EQUAL_HEX16(0x29B1, rpc_frame_crc16(0xFFFF, (const uint8_t *)"123456789", 9));
+}
+
+static void assert_round_trip(const uint8_t *payload, size_t len)
+{
+    setUp();
+    encode(payload, len);
+
+    TEST_ASSERT_EQUAL(RPC_FRAME_DELIMITER, wire[0]);
+    TEST_ASSERT_EQUAL(RPC_FRAME_DELIMITER, wire[wire_len - 1]);
+    TEST_ASSERT_NULL(memchr(wire + 1, RPC_FRAME_DELIMITER, wire_len - 2));
+    // COBS overhead: one code byte per 254 bytes, rounded up, for payload + CRC
+    size_t coded = len + RPC_FRAME_CRC_SIZE;
+    TEST_ASSERT_TRUE(wire_len - 2 <= coded + coded / RPC_FRAME_COBS_BLOCK + 1);
+
+    size_t decoded_len;
+    TEST_ASSERT_TRUE(rpc_frame_decode(wire + 1, wire_len - 2, &decoded_len));
+    TEST_ASSERT_EQUAL(len, decoded_len);
+    if (len) {
+        TEST_ASSERT_EQUAL_MEMORY(payload, wire + 1, len);
+    }
+}
+
+void test_cobs_round_trips_block_boundaries(void)
+{
+    static uint8_t payload[1200];
+    static const size_t lengths[] = {0, 1, 2, 251, 252, 253, 254, 255, 506, 507, 508, 509, 1200};
+
+    // No zeros: exercises full 0xFF blocks and the lazily closed last block
+    memset(payload, 0xA5, sizeof(payload));
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+        assert_round_trip(payload, lengths[i]);
+    }
+
+    // Zeros everywhere, then a zero right after each full block
+    memset(payload, 0, sizeof(payload));
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+        assert_round_trip(payload, lengths[i]);
+    }
+    memset(payload, 0x11, sizeof(payload));
+    payload[254] = payload[508] = payload[509] = 0;
+    assert_round_trip(payload, 600);
+}
+
+void test_cobs_round_trips_pseudo_random_payloads(void)
+{
+    static uint8_t payload[2000];
+    uint32_t seed = 12345;
+    for (size_t len = 0; len < sizeof(payload); len += 37) {
+        for (size_t i = 0; i < len; i++) {
+            seed       = seed * 1103515245 + 12345;
+            payload[i] = (seed >> 16) % 4 ? (uint8_t)(seed >> 8) : 0; // Zero-heavy like CBOR
+        }
+        assert_round_trip(payload, len);
+    }
+}
+
+void test_encoder_sends_large_pieces(void)
+{
+    static uint8_t payload[2000];
+    memset(payload, 0x42, sizeof(payload));
+    encode(payload, sizeof(payload));
+    // Buffered: one sink call per RPC_FRAME_ENCODER_BUF worth of output, not per block
+    TEST_ASSERT_TRUE(wire_writes <= (int)(wire_len / (RPC_FRAME_ENCODER_BUF - RPC_FRAME_COBS_BLOCK - 2)) + 1);
+}
+
+void test_decode_rejects_corruption(void)
+{
+    static const uint8_t payload[] = {0x82, 0x01, 0x64, 'p', 'i', 'n', 'g'};
+    size_t len;
+
+    encode(payload, sizeof(payload));
+    wire[3] ^= 0x01;
+    TEST_ASSERT_FALSE(rpc_frame_decode(wire + 1, wire_len - 2, &len));
+
+    uint8_t overrun[] = {0x05, 0x01, 0x02};
+    TEST_ASSERT_FALSE(rpc_frame_decode(overrun, sizeof(overrun), &len));
+    uint8_t zero_code[] = {0x02, 0x01, 0x00, 0x01};
+    TEST_ASSERT_FALSE(rpc_frame_decode(zero_code, sizeof(zero_code), &len));
+    uint8_t too_short[] = {0x02, 0x01};
+    TEST_ASSERT_FALSE(rpc_frame_decode(too_short, sizeof(too_short), &len));
+}
+
+//==============================================================================
+// RECEIVE ASSEMBLER
+//==============================================================================
+
+// A JSON line, a frame and another line back to back, as one client stream
+static size_t build_mixed_stream(uint8_t *out)
+{
+    static const uint8_t payload[] = {0x82, 0x01, 0x64, 'p', 'i', 'n', 'g'};
+    size_t n = 0;
+    memcpy(out, "{\"method\":\"ping\"}\n", 18);
+    n += 18;
+    encode(payload, sizeof(payload));
+    memcpy(out + n, wire, wire_len);
+    n += wire_len;
+    memcpy(out + n, "\r\n{\"id\":2}\r\n", 12);
+    return n + 12;
+}
+
+static void assert_mixed_messages(void)
+{
+    TEST_ASSERT_EQUAL(3, message_count);
+    TEST_ASSERT_FALSE(messages[0].binary);
+    TEST_ASSERT_EQUAL_STRING_LEN("{\"method\":\"ping\"}", messages[0].data, messages[0].len);
+    TEST_ASSERT_TRUE(messages[1].binary);
+    TEST_ASSERT_EQUAL(7, messages[1].len);
+    TEST_ASSERT_EQUAL_MEMORY("\x82\x01\x64ping", messages[1].data, 7);
+    TEST_ASSERT_FALSE(messages[2].binary);
+    TEST_ASSERT_EQUAL_STRING_LEN("{\"id\":2}", messages[2].data, messages[2].len);
+}
+
+void test_rx_splits_lines_and_frames(void)
+{
+    uint8_t stream[128];
+    char buf[64];
+    rpc_rx_t rx;
+    size_t n = build_mixed_stream(stream);
+
+    rpc_rx_init(&rx, buf, sizeof(buf), false);
+    rpc_rx_feed(&rx, stream, n, on_message, NULL);
+    assert_mixed_messages();
+    TEST_ASSERT_EQUAL(0, rx.dropped);
+
+    // Byte by byte, as a slow link delivers it
+    message_count = 0;
+    rpc_rx_init(&rx, buf, sizeof(buf), false);
+    for (size_t i = 0; i < n; i++) {
+        rpc_rx_feed(&rx, stream + i, 1, on_message, NULL);
+    }
+    assert_mixed_messages();
+}
+
+void test_rx_drops_overlong_and_bad_input(void)
+{
+    char buf[8];
+    rpc_rx_t rx;
+    rpc_rx_init(&rx, buf, sizeof(buf), false);
+
+    rpc_rx_feed(&rx, (const uint8_t *)"0123456789abc\nok\n", 17, on_message, NULL);
+    TEST_ASSERT_EQUAL(1, message_count);
+    TEST_ASSERT_EQUAL_STRING("ok", messages[0].data);
+    TEST_ASSERT_EQUAL(1, rx.dropped);
+
+    // Frame longer than the buffer, a frame with a bad CRC, a line cut off by a frame start
+    static const uint8_t bad[] = {0x00, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0x00, 0x00, 0x03, 0x11, 0x22, 0x00, 'x', 0x00};
+    rpc_rx_feed(&rx, bad, sizeof(bad), on_message, NULL);
+    TEST_ASSERT_EQUAL(1, message_count);
+    TEST_ASSERT_EQUAL(4, rx.dropped);
+    TEST_ASSERT_TRUE(rx.binary);
+
+    // Back-to-back delimiters are idle time, not empty frames
+    static const uint8_t idle[] = {0x00, 0x00, 0x00};
+    rpc_rx_feed(&rx, idle, sizeof(idle), on_message, NULL);
+    TEST_ASSERT_EQUAL(4, rx.dropped);
+}
+
+void test_rx_line_editing(void)
+{
+    char buf[16];
+    rpc_rx_t rx;
+    rpc_rx_init(&rx, buf, sizeof(buf), true);
+
+    rpc_rx_feed(&rx, (const uint8_t *)"ab\bc\x01\x7f" "d\xc3\n", 9, on_message, NULL);
+    TEST_ASSERT_EQUAL(1, message_count);
+    TEST_ASSERT_EQUAL_STRING("ad", messages[0].data);
+}
+
+//==============================================================================
+// ROUND-TRIP BENCHMARK
+//==============================================================================
+
+typedef struct {
+    const char *method;
+    void (*write_params)(json_writer_t *w);
+} bench_request_t;
+
+static void params_general_set(json_writer_t *w)
+{
+    json_write_object_begin(w);
+    json_write_kv_string(w, "name", "Stage Left");
+    json_write_kv_string(w, "mode", "PRESENTER");
+    json_write_kv_int(w, "contrast", 200);
+    json_write_kv_bool(w, "bluetooth", true);
+    json_write_kv_int(w, "slot_id", 3);
+    json_write_object_end(w);
+}
+
+static void params_pair(json_writer_t *w)
+{
+    json_write_object_begin(w);
+    json_write_kv_string(w, "name", "Clicker 07");
+    json_write_kv_string(w, "mac", "aa:bb:cc:dd:ee:07");
+    json_write_kv_string(w, "aes_key", "00112233445566778899aabbccddeeff00112233445566778899aabbccddeeff");
+    json_write_object_end(w);
+}
+
+static void params_lora_set(json_writer_t *w)
+{
+    json_write_object_begin(w);
+    json_write_kv_int(w, "frequency_khz", 868100);
+    json_write_kv_int(w, "spreading_factor", 7);
+    json_write_kv_int(w, "bandwidth_khz", 125);
+    json_write_kv_int(w, "coding_rate", 5);
+    json_write_kv_int(w, "tx_power_dbm", 14);
+    json_write_object_end(w);
+}
+
+static const bench_request_t bench_requests[] = {
+    {"ping", NULL},
+    {"general:set", params_general_set},
+    {"paired:pair", params_pair},
+    {"lora:set", params_lora_set},
+};
+
+// Request as a client sends it: a JSON-RPC line, or CBOR [id, method, params]
+static void write_request(json_writer_t *w, const bench_request_t *r, int id)
+{
+    if (w->cbor) {
+        json_write_array_begin(w);
+        json_write_int(w, id);
+        json_write_string(w, r->method);
+    } else {
+        json_write_object_begin(w);
+        json_write_kv_string(w, "jsonrpc", "2.0");
+        json_write_kv_int(w, "id", id);
+        json_write_kv_string(w, "method", r->method);
+        if (r->write_params) {
+            json_write_key(w, "params");
+        }
+    }
+    if (r->write_params) {
+        r->write_params(w);
+    }
+    if (w->cbor) {
+        json_write_array_end(w);
+    } else {
+        json_write_object_end(w);
+    }
+}
+
+// The telemetry-pull shape: paired:list with 16 devices, the way commands.c writes it
+static void write_response(json_writer_t *w, const rpc_envelope_t *env)
+{
+    if (w->cbor) {
+        json_write_array_begin(w);
+        json_write_raw(w, env->id, env->id_len);
+        json_write_int(w, 0);
+    } else {
+        json_write_object_begin(w);
+        json_write_kv_string(w, "jsonrpc", "2.0");
+        json_write_key(w, "id");
+        json_write_raw(w, env->id, env->id_len);
+        json_write_key(w, "result");
+    }
+    json_write_array_begin(w);
+    for (int i = 0; i < 16; i++) {
+        char name[16];
+        char mac[18];
+        snprintf(name, sizeof(name), "Clicker %02d", i);
+        snprintf(mac, sizeof(mac), "aa:bb:cc:dd:ee:%02x", i);
+        json_write_object_begin(w);
+        json_write_kv_string(w, "name", name);
+        json_write_kv_string(w, "mac", mac);
+        json_write_object_end(w);
+    }
+    json_write_array_end(w);
+    if (w->cbor) {
+        json_write_array_end(w);
+    } else {
+        json_write_object_end(w);
+    }
+}
+
+static size_t response_bytes;
+
+static void count_sink(const char *data, size_t len, void *ctx)
+{
+    (void)data;
+    (void)ctx;
+    response_bytes += len;
+}
+
+// Device side of one request: assemble, parse, bind, answer; the request is already on the wire
+static void device_on_message(char *msg, size_t len, bool binary, void *ctx)
+{
+    (void)ctx;
+    rpc_envelope_t env;
+    rpc_params_t params;
+    int bad;
+    int err = binary ? rpc_parse_envelope_cbor(msg, len, &env) : rpc_parse_envelope(msg, len, &env);
+    TEST_ASSERT_EQUAL(0, err);
+    TEST_ASSERT_EQUAL(0, rpc_bind_params(&env, &params, &bad));
+
+    char chunk[244];
+    json_writer_t w;
+    if (binary) {
+        rpc_frame_encoder_t enc;
+        rpc_frame_encoder_begin(&enc, count_sink, NULL);
+        json_writer_init_cbor(&w, chunk, sizeof(chunk), rpc_frame_encoder_write, &enc);
+        write_response(&w, &env);
+        json_writer_flush(&w);
+        rpc_frame_encoder_end(&enc);
+    } else {
+        json_writer_init(&w, chunk, sizeof(chunk), count_sink, NULL);
+        write_response(&w, &env);
+        json_writer_flush(&w);
+        count_sink("\n", 1, NULL);
+    }
+}
+
+static size_t build_client_request(const bench_request_t *r, bool binary, uint8_t *out)
+{
+    char chunk[64];
+    json_writer_t w;
+    setUp();
+    if (binary) {
+        rpc_frame_encoder_t enc;
+        rpc_frame_encoder_begin(&enc, wire_sink, NULL);
+        json_writer_init_cbor(&w, chunk, sizeof(chunk), rpc_frame_encoder_write, &enc);
+        write_request(&w, r, 42);
+        json_writer_flush(&w);
+        rpc_frame_encoder_end(&enc);
+    } else {
+        json_writer_init(&w, chunk, sizeof(chunk), wire_sink, NULL);
+        write_request(&w, r, 42);
+        json_writer_flush(&w);
+        wire_sink("\n", 1, NULL);
+    }
+    memcpy(out, wire, wire_len);
+    return wire_len;
+}
+
+void test_benchmark_round_trip_json_vs_binary(void)
+{
+    static char rx_buf[2048];
+    uint8_t request[512];
+
+    for (size_t i = 0; i < sizeof(bench_requests) / sizeof(bench_requests[0]); i++) {
+        const bench_request_t *r = &bench_requests[i];
+        size_t bytes[2][2];
+        double ns[2];
+
+        for (int binary = 0; binary <= 1; binary++) {
+            size_t request_len = build_client_request(r, binary, request);
+            rpc_rx_t rx;
+            rpc_rx_init(&rx, rx_buf, sizeof(rx_buf), false);
+
+            response_bytes = 0;
+            rpc_rx_feed(&rx, request, request_len, device_on_message, NULL);
+            bytes[binary][0] = request_len;
+            bytes[binary][1] = response_bytes;
+
+            uint64_t start = now_ns();
+            for (int it = 0; it < BENCH_ITERATIONS; it++) {
+                rpc_rx_feed(&rx, request, request_len, device_on_message, NULL);
+            }
+            ns[binary] = (double)(now_ns() - start) / BENCH_ITERATIONS;
+            TEST_ASSERT_EQUAL(0, rx.dropped);
+        }
+
+        for (int binary = 0; binary <= 1; binary++) {
+            size_t total = bytes[binary][0] + bytes[binary][1];
+            printf("[BENCH][rpc_frame] %-12s %-6s req %4zu B, resp %4zu B, device %7.1f ns (%7.0f req/s),"
+                   " UART-bound %6.1f req/s\n",
+                   r->method, binary ? "binary" : "json", bytes[binary][0], bytes[binary][1], ns[binary],
+                   1e9 / ns[binary], (double)UART_BYTES_PER_SEC / (double)total);
+        }
+        // Binary must not cost more on the wire for any request shape
+        TEST_ASSERT_TRUE(bytes[1][0] < bytes[0][0]);
+        TEST_ASSERT_TRUE(bytes[1][1] < bytes[0][1]);
+    }
+}
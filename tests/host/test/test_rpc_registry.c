@@ -0,0 +1,194 @@
+/**
+ * @file test_rpc_registry.c
+ * @brief Unit tests for runtime method registration: lookup, schema checks, capacity and
+ *        lookups racing a registering thread
+ *
+ * The registry is append-only and process-wide, so the tests run in file order and build
+ * on each other's registrations.
+ */
+
+#include "unity.h"
+#include "json_stream.h"
+#include "rpc_schema.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#define RACE_METHODS 8
+
+typedef struct {
+    uint32_t present;
+    int32_t interval_ms;
+    char channel[16];
+    bool verbose;
+} telemetry_params_t;
+
+static const rpc_param_t telemetry_params[] = {
+    {.name     = "interval_ms",
+     .type     = RPC_PARAM_INT,
+     .required = true,
+     .offset   = offsetof(telemetry_params_t, interval_ms),
+     .min      = 10,
+     .max      = 60000},
+    {.name   = "channel",
+     .type   = RPC_PARAM_STRING,
+     .offset = offsetof(telemetry_params_t, channel),
+     .size   = sizeof(((telemetry_params_t *)0)->channel)},
+    {.name = "verbose", .type = RPC_PARAM_BOOL, .offset = offsetof(telemetry_params_t, verbose)},
+};
+
+static const rpc_method_info_t telemetry_start = {
+    .name        = "telemetry:start",
+    .params      = telemetry_params,
+    .param_count = 3,
+    .flags       = RPC_FLAG_LONG_RUNNING,
+    .links       = RPC_LINK_USB_CDC,
+};
+
+static const rpc_method_info_t telemetry_stop = {.name = "telemetry:stop"};
+
+static int parse(const char *json, rpc_envelope_t *env)
+{
+    return rpc_parse_envelope(json, strlen(json), env);
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+void test_registered_method_is_found_and_bound(void)
+{
+    rpc_method_t start;
+    rpc_method_t stop;
+    TEST_ASSERT_EQUAL(ESP_OK, rpc_register_method(&telemetry_start, &start));
+    TEST_ASSERT_EQUAL(ESP_OK, rpc_register_method(&telemetry_stop, &stop));
+    TEST_ASSERT_EQUAL(RPC_METHOD_COUNT, start);
+    TEST_ASSERT_EQUAL(RPC_METHOD_COUNT + 1, stop);
+    TEST_ASSERT_EQUAL(RPC_METHOD_COUNT + 2, rpc_method_count());
+    TEST_ASSERT_EQUAL_PTR(&telemetry_start, rpc_method_info(start));
+    TEST_ASSERT_NULL(rpc_method_info((rpc_method_t)(RPC_METHOD_COUNT + 2)));
+
+    TEST_ASSERT_EQUAL(stop, rpc_method_find("telemetry:stop", 14));
+    TEST_ASSERT_EQUAL(RPC_METHOD_NONE, rpc_method_find("telemetry:sto", 13));
+    TEST_ASSERT_EQUAL(RPC_METHOD_PING, rpc_method_find("ping", 4));
+
+    rpc_envelope_t env;
+    rpc_params_t params;
+    int bad;
+    TEST_ASSERT_EQUAL(0, parse("{\"method\":\"telemetry:start\",\"params\":{\"interval_ms\":250,\"channel\":\"batt\"},"
+                               "\"id\":1}",
+                               &env));
+    TEST_ASSERT_EQUAL(start, env.method);
+    TEST_ASSERT_EQUAL(0, rpc_bind_params(&env, &params, &bad));
+    const telemetry_params_t *p = (const telemetry_params_t *)&params;
+    TEST_ASSERT_EQUAL(250, p->interval_ms);
+    TEST_ASSERT_EQUAL_STRING("batt", p->channel);
+    TEST_ASSERT_FALSE(rpc_param_present(&params, 2));
+
+    TEST_ASSERT_EQUAL(0, parse("{\"method\":\"telemetry:start\",\"params\":{\"interval_ms\":5},\"id\":2}", &env));
+    TEST_ASSERT_EQUAL(JSONRPC_INVALID_PARAMS, rpc_bind_params(&env, &params, &bad));
+    TEST_ASSERT_EQUAL(0, bad);
+}
+
+void test_registration_rejects_bad_methods(void)
+{
+    static const rpc_param_t over_present[] = {
+        {.name = "x", .type = RPC_PARAM_INT, .offset = 0},
+    };
+    static const rpc_param_t past_end[] = {
+        {.name = "x", .type = RPC_PARAM_STRING, .offset = sizeof(rpc_params_t) - 4, .size = 8},
+    };
+    static const rpc_method_info_t bad[] = {
+        {.name = NULL},
+        {.name = ""},
+        {.name = "this:method:name:is:longer:than:32"},
+        {.name = "x:overlap", .params = over_present, .param_count = 1},
+        {.name = "x:past", .params = past_end, .param_count = 1},
+        {.name = "x:missing", .params = NULL, .param_count = 1},
+    };
+    size_t before = rpc_method_count();
+
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, rpc_register_method(NULL, NULL));
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        TEST_ASSERT_EQUAL_MESSAGE(ESP_ERR_INVALID_ARG, rpc_register_method(&bad[i], NULL), bad[i].name);
+    }
+
+    static const rpc_method_info_t builtin_name = {.name = "ping"};
+    static const rpc_method_info_t twice        = {.name = "telemetry:stop"};
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, rpc_register_method(&builtin_name, NULL));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, rpc_register_method(&twice, NULL));
+    TEST_ASSERT_EQUAL(before, rpc_method_count());
+}
+
+//==============================================================================
+// LOOKUPS RACING REGISTRATION
+//==============================================================================
+
+static rpc_method_info_t race_methods[RACE_METHODS];
+static char race_names[RACE_METHODS][16];
+static atomic_bool race_done;
+static atomic_int race_mismatches;
+
+static void *lookup_thread(void *arg)
+{
+    (void)arg;
+    while (!atomic_load(&race_done)) {
+        for (int i = 0; i < RACE_METHODS; i++) {
+            rpc_method_t m = rpc_method_find(race_names[i], strlen(race_names[i]));
+            // Not there yet is fine; found must mean fully visible
+            if (m != RPC_METHOD_NONE && rpc_method_info(m) != &race_methods[i]) {
+                atomic_fetch_add(&race_mismatches, 1);
+            }
+        }
+    }
+    return NULL;
+}
+
+void test_lookups_race_registration(void)
+{
+    pthread_t readers[3];
+    for (int i = 0; i < RACE_METHODS; i++) {
+        snprintf(race_names[i], sizeof(race_names[i]), "race:%d", i);
+        race_methods[i].name = race_names[i];
+    }
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_EQUAL(0, pthread_create(&readers[i], NULL, lookup_thread, NULL));
+    }
+    for (int i = 0; i < RACE_METHODS; i++) {
+        TEST_ASSERT_EQUAL(ESP_OK, rpc_register_method(&race_methods[i], NULL));
+    }
+    atomic_store(&race_done, true);
+    for (int i = 0; i < 3; i++) {
+        pthread_join(readers[i], NULL);
+    }
+    TEST_ASSERT_EQUAL(0, atomic_load(&race_mismatches));
+}
+
+void test_registry_capacity(void)
+{
+    static rpc_method_info_t fill[RPC_REGISTERED_METHODS_MAX];
+    static char names[RPC_REGISTERED_METHODS_MAX][16];
+    size_t registered = rpc_method_count() - RPC_METHOD_COUNT;
+
+    for (size_t i = 0; registered < RPC_REGISTERED_METHODS_MAX; i++, registered++) {
+        snprintf(names[i], sizeof(names[i]), "fill:%zu", i);
+        fill[i].name = names[i];
+        TEST_ASSERT_EQUAL(ESP_OK, rpc_register_method(&fill[i], NULL));
+    }
+    static const rpc_method_info_t one_more = {.name = "fill:overflow"};
+    TEST_ASSERT_EQUAL(ESP_ERR_NO_MEM, rpc_register_method(&one_more, NULL));
+    TEST_ASSERT_EQUAL(RPC_METHOD_COUNT + RPC_REGISTERED_METHODS_MAX, rpc_method_count());
+
+    // Every method, built-in or registered, is still found through its own name
+    for (size_t m = 0; m < rpc_method_count(); m++) {
+        const char *name = rpc_method_info((rpc_method_t)m)->name;
+        TEST_ASSERT_EQUAL_MESSAGE(m, rpc_method_find(name, strlen(name)), name);
+    }
+    TEST_ASSERT_EQUAL(RPC_METHOD_NONE, rpc_method_find("fill:overflow", 13));
+}
@@ -0,0 +1,541 @@
+/**
+ * @file test_rpc_schema.c
+ * @brief Unit tests and parse benchmark for JSON-RPC envelope parsing and param binding
+ */
+
+#define _POSIX_C_SOURCE 199309L // clock_gettime
+
+#include "unity.h"
+#include "json_stream.h"
+#include "rpc_schema.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_ITERATIONS 20000
+
+// cJSON_Parse() heap model on the ESP32 (32-bit pointers): one cJSON node per value plus one
+// copy of every key and string value (cJSON.c: cJSON_New_Item, parse_string)
+#define CJSON_NODE_SIZE 40
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static int parse(const char *json, rpc_envelope_t *env)
+{
+    return rpc_parse_envelope(json, strlen(json), env);
+}
+
+// Parses and binds a request that must be valid up to the params
+static int bind(const char *json, rpc_params_t *params, int *bad_param)
+{
+    rpc_envelope_t env;
+    TEST_ASSERT_EQUAL(0, parse(json, &env));
+    return rpc_bind_params(&env, params, bad_param);
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+//==============================================================================
+// ENVELOPE
+//==============================================================================
+
+void test_envelope_locates_method_id_and_params(void)
+{
+    const char *json = "{\"jsonrpc\":\"2.0\",\"method\":\"general:set\",\"params\":{\"name\":\"x\"},\"id\":7}";
+    rpc_envelope_t env;
+
+    TEST_ASSERT_EQUAL(0, parse(json, &env));
+    TEST_ASSERT_EQUAL(RPC_METHOD_GENERAL_SET, env.method);
+    TEST_ASSERT_EQUAL_STRING_LEN("7", env.id, env.id_len);
+    TEST_ASSERT_EQUAL(1, env.id_len);
+    TEST_ASSERT_EQUAL_STRING_LEN("{\"name\":\"x\"}", env.params, env.params_len);
+    TEST_ASSERT_EQUAL(12, env.params_len);
+}
+
+void test_envelope_member_order_does_not_matter(void)
+{
+    const char *json = " { \"params\" : [ ] , \"id\" : \"a-b\" , \"method\" : \"ping\" } ";
+    rpc_envelope_t env;
+
+    TEST_ASSERT_EQUAL(0, parse(json, &env));
+    TEST_ASSERT_EQUAL(RPC_METHOD_PING, env.method);
+    TEST_ASSERT_EQUAL(5, env.id_len);
+    TEST_ASSERT_EQUAL_STRING_LEN("\"a-b\"", env.id, env.id_len); // Echoed verbatim, quotes included
+    TEST_ASSERT_EQUAL_STRING_LEN("[ ]", env.params, env.params_len);
+}
+
+void test_envelope_without_id(void)
+{
+    rpc_envelope_t env;
+    TEST_ASSERT_EQUAL(0, parse("{\"method\":\"ping\"}", &env));
+    TEST_ASSERT_NULL(env.id);
+    TEST_ASSERT_NULL(env.params);
+}
+
+void test_envelope_matches_escaped_method_name(void)
+{
+    rpc_envelope_t env;
+    TEST_ASSERT_EQUAL(0, parse("{\"method\":\"\\u0070ing\",\"id\":1}", &env));
+    TEST_ASSERT_EQUAL(RPC_METHOD_PING, env.method);
+}
+
+void test_envelope_errors(void)
+{
+    rpc_envelope_t env;
+
+    TEST_ASSERT_EQUAL(JSONRPC_PARSE_ERROR, parse("{invalid json", &env));
+    TEST_ASSERT_EQUAL(JSONRPC_PARSE_ERROR, parse("{\"method\":\"ping\"} trailing", &env));
+    TEST_ASSERT_EQUAL(JSONRPC_PARSE_ERROR, parse("{\"method\":\"ping\",\"params\":{\"a\":[1,}}", &env));
+    TEST_ASSERT_EQUAL(JSONRPC_PARSE_ERROR, parse("", &env));
+
+    TEST_ASSERT_EQUAL(JSONRPC_INVALID_REQUEST, parse("[1,2]", &env));
+    TEST_ASSERT_EQUAL(JSONRPC_INVALID_REQUEST, parse("\"ping\"", &env));
+    TEST_ASSERT_EQUAL(JSONRPC_INVALID_REQUEST, parse("{\"id\":1}", &env));
+    TEST_ASSERT_EQUAL(JSONRPC_INVALID_REQUEST, parse("{\"method\":5,\"id\":1}", &env));
+    TEST_ASSERT_NULL(env.id);
+
+    TEST_ASSERT_EQUAL(JSONRPC_METHOD_NOT_FOUND, parse("{\"method\":\"nope\",\"id\":3}", &env));
+    TEST_ASSERT_EQUAL(RPC_METHOD_NONE, env.method);
+    TEST_ASSERT_EQUAL_STRING_LEN("3", env.id, env.id_len);
+    TEST_ASSERT_EQUAL(JSONRPC_METHOD_NOT_FOUND, parse("{\"method\":\"pin\",\"id\":3}", &env));
+    TEST_ASSERT_EQUAL(JSONRPC_METHOD_NOT_FOUND, parse("{\"method\":\"pingg\",\"id\":3}", &env));
+}
+
+void test_envelope_does_not_depend_on_nul_terminator(void)
+{
+    const char *json = "{\"method\":\"ping\"}{\"method\":\"device:info\"}";
+    rpc_envelope_t env;
+
+    TEST_ASSERT_EQUAL(0, rpc_parse_envelope(json, 17, &env));
+    TEST_ASSERT_EQUAL(RPC_METHOD_PING, env.method);
+    TEST_ASSERT_EQUAL(0, rpc_parse_envelope(json + 17, strlen(json) - 17, &env));
+    TEST_ASSERT_EQUAL(RPC_METHOD_DEVICE_INFO, env.method);
+}
+
+//==============================================================================
+// METHOD LOOKUP
+//==============================================================================
+
+void test_method_find_every_builtin(void)
+{
+    for (int m = 0; m < RPC_METHOD_COUNT; m++) {
+        const char *name = rpc_method_info((rpc_method_t)m)->name;
+        size_t len       = strlen(name);
+        char longer[RPC_METHOD_NAME_MAX + 2];
+
+        TEST_ASSERT_EQUAL_MESSAGE(m, rpc_method_find(name, len), name);
+        TEST_ASSERT_EQUAL_MESSAGE(RPC_METHOD_NONE, rpc_method_find(name, len - 1), name);
+        snprintf(longer, sizeof(longer), "%sx", name);
+        TEST_ASSERT_EQUAL_MESSAGE(RPC_METHOD_NONE, rpc_method_find(longer, len + 1), name);
+    }
+    TEST_ASSERT_EQUAL(RPC_METHOD_COUNT, rpc_method_count());
+    TEST_ASSERT_EQUAL(RPC_METHOD_NONE, rpc_method_find("", 0));
+    TEST_ASSERT_EQUAL(RPC_METHOD_NONE, rpc_method_find("ping\0", 5));
+}
+
+void test_method_name_too_long_for_lookup(void)
+{
+    char json[128];
+    rpc_envelope_t env;
+    snprintf(json, sizeof(json), "{\"method\":\"%0*d\",\"id\":1}", RPC_METHOD_NAME_MAX + 1, 0);
+    TEST_ASSERT_EQUAL(JSONRPC_METHOD_NOT_FOUND, parse(json, &env));
+    TEST_ASSERT_EQUAL(RPC_METHOD_NONE, env.method);
+}
+
+void test_method_metadata(void)
+{
+    const rpc_method_info_t *ping     = rpc_method_info(RPC_METHOD_PING);
+    const rpc_method_info_t *key_get  = rpc_method_info(RPC_METHOD_LORA_KEY_GET);
+    const rpc_method_info_t *firmware = rpc_method_info(RPC_METHOD_FIRMWARE_UPGRADE);
+
+    TEST_ASSERT_EQUAL(0, ping->flags);
+    TEST_ASSERT_EQUAL(RPC_LINK_ANY, ping->links);
+    TEST_ASSERT_EQUAL(RPC_FLAG_AUTH, key_get->flags);
+    TEST_ASSERT_EQUAL(RPC_FLAG_AUTH | RPC_FLAG_LONG_RUNNING, firmware->flags);
+    TEST_ASSERT_EQUAL(RPC_LINK_USB_CDC | RPC_LINK_UART | RPC_LINK_BLE, firmware->links);
+}
+
+//==============================================================================
+// PARAM BINDING
+//==============================================================================
+
+void test_bind_partial_update(void)
+{
+    rpc_params_t params;
+    int bad;
+
+    TEST_ASSERT_EQUAL(0, bind("{\"method\":\"general:set\",\"params\":{\"contrast\":200,\"bluetooth\":false,"
+                              "\"slot_id\":16,\"name\":\"Stage \\\"Left\\\"\"}}",
+                              &params, &bad));
+    const rpc_general_set_params_t *p = &params.general_set;
+    TEST_ASSERT_TRUE(rpc_param_present(&params, GENERAL_SET_NAME));
+    TEST_ASSERT_FALSE(rpc_param_present(&params, GENERAL_SET_MODE));
+    TEST_ASSERT_TRUE(rpc_param_present(&params, GENERAL_SET_CONTRAST));
+    TEST_ASSERT_TRUE(rpc_param_present(&params, GENERAL_SET_BLUETOOTH));
+    TEST_ASSERT_FALSE(rpc_param_present(&params, GENERAL_SET_BLUETOOTH_PAIRING));
+    TEST_ASSERT_TRUE(rpc_param_present(&params, GENERAL_SET_SLOT_ID));
+    TEST_ASSERT_EQUAL_STRING("Stage \"Left\"", p->name);
+    TEST_ASSERT_EQUAL(200, p->contrast);
+    TEST_ASSERT_FALSE(p->bluetooth);
+    TEST_ASSERT_EQUAL(16, p->slot_id);
+}
+
+void test_bind_rejects_wrong_types(void)
+{
+    rpc_params_t params;
+    int bad;
+
+    TEST_ASSERT_EQUAL(JSONRPC_INVALID_PARAMS, bind("{\"method\":\"general:set\",\"params\":{\"contrast\":\"5\"}}",
+                                                   &params, &bad));
+    TEST_ASSERT_EQUAL(GENERAL_SET_CONTRAST, bad);
+
+    TEST_ASSERT_EQUAL(JSONRPC_INVALID_PARAMS, bind("{\"method\":\"general:set\",\"params\":{\"bluetooth\":1}}",
+                                                   &params, &bad));
+    TEST_ASSERT_EQUAL(GENERAL_SET_BLUETOOTH, bad);
+
+    TEST_ASSERT_EQUAL(JSONRPC_INVALID_PARAMS, bind("{\"method\":\"general:set\",\"params\":{\"name\":null}}",
+                                                   &params, &bad));
+    TEST_ASSERT_EQUAL(GENERAL_SET_NAME, bad);
+
+    TEST_ASSERT_EQUAL(JSONRPC_INVALID_PARAMS, bind("{\"method\":\"general:set\",\"params\":{\"contrast\":1.5}}",
+                                                   &params, &bad));
+    TEST_ASSERT_EQUAL(GENERAL_SET_CONTRAST, bad);
+}
+
+void test_bind_enforces_ranges_and_lengths(void)
+{
+    rpc_params_t params;
+    int bad;
+
+    TEST_ASSERT_EQUAL(JSONRPC_INVALID_PARAMS, bind("{\"method\":\"general:set\",\"params\":{\"slot_id\":17}}",
+                                                   &params, &bad));
+    TEST_ASSERT_EQUAL(GENERAL_SET_SLOT_ID, bad);
+    TEST_ASSERT_EQUAL_STRING("Invalid slot_id (1-16)",
+                             rpc_method_info(RPC_METHOD_GENERAL_SET)->params[GENERAL_SET_SLOT_ID].error);
+
+    TEST_ASSERT_EQUAL(JSONRPC_INVALID_PARAMS, bind("{\"method\":\"general:set\",\"params\":{\"slot_id\":0}}",
+                                                   &params, &bad));
+    TEST_ASSERT_EQUAL(JSONRPC_INVALID_PARAMS, bind("{\"method\":\"lora:set\",\"params\":{\"tx_power_dbm\":128}}",
+                                                   &params, &bad));
+    TEST_ASSERT_EQUAL(LORA_SET_TX_POWER_DBM, bad);
+    TEST_ASSERT_EQUAL(0, bind("{\"method\":\"lora:set\",\"params\":{\"tx_power_dbm\":-9}}", &params, &bad));
+    TEST_ASSERT_EQUAL(-9, params.lora_set.tx_power_dbm);
+
+    // 31 characters fit device_name[32], 32 do not
+    TEST_ASSERT_EQUAL(0, bind("{\"method\":\"general:set\",\"params\":{\"name\":\"0123456789012345678901234567890\"}}",
+                              &params, &bad));
+    TEST_ASSERT_EQUAL(JSONRPC_INVALID_PARAMS,
+                      bind("{\"method\":\"general:set\",\"params\":{\"name\":\"01234567890123456789012345678901\"}}",
+                           &params, &bad));
+    TEST_ASSERT_EQUAL(GENERAL_SET_NAME, bad);
+
+    TEST_ASSERT_EQUAL(JSONRPC_INVALID_PARAMS, bind("{\"method\":\"lora:set\",\"params\":{\"regulatory_domain\":\"EUR\"}}",
+                                                   &params, &bad));
+    TEST_ASSERT_EQUAL(LORA_SET_REGULATORY_DOMAIN, bad);
+}
+
+void test_bind_missing_params(void)
+{
+    rpc_params_t params;
+    int bad = 0;
+
+    TEST_ASSERT_EQUAL(JSONRPC_INVALID_PARAMS, bind("{\"method\":\"general:set\",\"id\":1}", &params, &bad));
+    TEST_ASSERT_EQUAL(RPC_PARAM_NONE, bad);
+
+    TEST_ASSERT_EQUAL(JSONRPC_INVALID_PARAMS, bind("{\"method\":\"general:set\",\"params\":[1]}", &params, &bad));
+    TEST_ASSERT_EQUAL(RPC_PARAM_NONE, bad);
+
+    bad = 0;
+    TEST_ASSERT_EQUAL(JSONRPC_INVALID_PARAMS,
+                      bind("{\"method\":\"paired:pair\",\"params\":{\"name\":\"a\",\"mac\":\"00:11:22:33:44:55\"}}",
+                           &params, &bad));
+    TEST_ASSERT_EQUAL(RPC_PARAM_NONE, bad);
+
+    // All-optional params still need the params object, like the cJSON path
+    TEST_ASSERT_EQUAL(0, bind("{\"method\":\"power:set\",\"params\":{}}", &params, &bad));
+    TEST_ASSERT_EQUAL(0, params.present);
+}
+
+void test_bind_skips_unknown_members(void)
+{
+    rpc_params_t params;
+    int bad;
+
+    TEST_ASSERT_EQUAL(0, bind("{\"method\":\"paired:unpair\",\"params\":{\"extra\":{\"mac\":[1,{\"x\":2}]},"
+                              "\"mac\":\"aa:bb:cc:dd:ee:ff\",\"more\":true}}",
+                              &params, &bad));
+    TEST_ASSERT_EQUAL_STRING("aa:bb:cc:dd:ee:ff", params.paired_unpair.mac);
+}
+
+void test_methods_without_params_ignore_them(void)
+{
+    rpc_params_t params;
+    int bad;
+
+    TEST_ASSERT_EQUAL(0, bind("{\"method\":\"ping\",\"params\":{\"anything\":[1,2,3]}}", &params, &bad));
+    TEST_ASSERT_EQUAL(0, bind("{\"method\":\"ping\",\"params\":42}", &params, &bad));
+}
+
+//==============================================================================
+// BINARY (CBOR) REQUESTS
+//==============================================================================
+
+static int parse_cbor(const uint8_t *cbor, size_t len, rpc_envelope_t *env)
+{
+    return rpc_parse_envelope_cbor((const char *)cbor, len, env);
+}
+
+#define PARSE_CBOR(env, ...)                                                                                           \
+    parse_cbor((const uint8_t[]){__VA_ARGS__}, sizeof((const uint8_t[]){__VA_ARGS__}), (env))
+
+void test_cbor_envelope_binds_like_json(void)
+{
+    // [7, "general:set", {"contrast": 200, "name": "x"}]
+    static const uint8_t req[] = {0x83, 0x07, 0x6B, 'g',  'e',  'n', 'e', 'r', 'a', 'l', ':', 's', 'e', 't', 0xA2,
+                                  0x68, 'c',  'o',  'n',  't',  'r', 'a', 's', 't', 0x18, 0xC8, 0x64, 'n', 'a',
+                                  'm',  'e',  0x61, 'x'};
+    rpc_envelope_t env;
+    rpc_params_t params;
+    int bad;
+
+    TEST_ASSERT_EQUAL(0, parse_cbor(req, sizeof(req), &env));
+    TEST_ASSERT_TRUE(env.cbor);
+    TEST_ASSERT_EQUAL(RPC_METHOD_GENERAL_SET, env.method);
+    TEST_ASSERT_EQUAL(1, env.id_len);
+    TEST_ASSERT_EQUAL(0x07, (uint8_t)env.id[0]); // Raw CBOR, echoed back verbatim
+
+    TEST_ASSERT_EQUAL(0, rpc_bind_params(&env, &params, &bad));
+    TEST_ASSERT_EQUAL(200, params.general_set.contrast);
+    TEST_ASSERT_EQUAL_STRING("x", params.general_set.name);
+    TEST_ASSERT_TRUE(rpc_param_present(&params, GENERAL_SET_CONTRAST));
+    TEST_ASSERT_FALSE(rpc_param_present(&params, GENERAL_SET_MODE));
+}
+
+void test_cbor_bind_checks_types_and_required_params(void)
+{
+    rpc_envelope_t env;
+    rpc_params_t params;
+    int bad;
+
+    // [1, "general:set", {_ "contrast": "x"}]
+    TEST_ASSERT_EQUAL(0, PARSE_CBOR(&env, 0x83, 0x01, 0x6B, 'g', 'e', 'n', 'e', 'r', 'a', 'l', ':', 's', 'e', 't',
+                                    0xBF, 0x68, 'c', 'o', 'n', 't', 'r', 'a', 's', 't', 0x61, 'x', 0xFF));
+    TEST_ASSERT_EQUAL(JSONRPC_INVALID_PARAMS, rpc_bind_params(&env, &params, &bad));
+    TEST_ASSERT_EQUAL(GENERAL_SET_CONTRAST, bad);
+
+    // [1, "paired:unpair"]: params omitted
+    TEST_ASSERT_EQUAL(0, PARSE_CBOR(&env, 0x82, 0x01, 0x6D, 'p', 'a', 'i', 'r', 'e', 'd', ':', 'u', 'n', 'p', 'a',
+                                    'i', 'r'));
+    TEST_ASSERT_EQUAL(JSONRPC_INVALID_PARAMS, rpc_bind_params(&env, &params, &bad));
+    TEST_ASSERT_EQUAL(RPC_PARAM_NONE, bad);
+}
+
+void test_cbor_envelope_errors(void)
+{
+    rpc_envelope_t env;
+
+    TEST_ASSERT_EQUAL(JSONRPC_PARSE_ERROR, PARSE_CBOR(&env, 0x83, 0x01));
+    TEST_ASSERT_EQUAL(JSONRPC_PARSE_ERROR, PARSE_CBOR(&env, 0x82, 0x01, 0x64, 'p', 'i', 'n', 'g', 0x00));
+    TEST_ASSERT_EQUAL(JSONRPC_INVALID_REQUEST, PARSE_CBOR(&env, 0xA1, 0x61, 'm', 0x01));
+    TEST_ASSERT_EQUAL(JSONRPC_INVALID_REQUEST, PARSE_CBOR(&env, 0x81, 0x01));
+    TEST_ASSERT_EQUAL(JSONRPC_INVALID_REQUEST, PARSE_CBOR(&env, 0x82, 0x01, 0x05));
+    TEST_ASSERT_EQUAL(JSONRPC_INVALID_REQUEST, PARSE_CBOR(&env, 0x84, 0x01, 0x64, 'p', 'i', 'n', 'g', 0xF6, 0xF6));
+    TEST_ASSERT_NULL(env.id);
+
+    TEST_ASSERT_EQUAL(JSONRPC_METHOD_NOT_FOUND, PARSE_CBOR(&env, 0x82, 0x18, 0x2A, 0x64, 'n', 'o', 'p', 'e'));
+    TEST_ASSERT_EQUAL(2, env.id_len);
+    TEST_ASSERT_EQUAL(0, PARSE_CBOR(&env, 0x9F, 0x01, 0x64, 'p', 'i', 'n', 'g', 0xFF));
+    TEST_ASSERT_EQUAL(RPC_METHOD_PING, env.method);
+}
+
+//==============================================================================
+// EVERY METHOD + BENCHMARK
+//==============================================================================
+
+static const char *const sample_requests[RPC_METHOD_COUNT] = {
+    [RPC_METHOD_PING]        = "{\"jsonrpc\":\"2.0\",\"method\":\"ping\",\"id\":1}",
+    [RPC_METHOD_DEVICE_INFO] = "{\"jsonrpc\":\"2.0\",\"method\":\"device:info\",\"id\":2}",
+    [RPC_METHOD_GENERAL_GET] = "{\"jsonrpc\":\"2.0\",\"method\":\"general:get\",\"id\":3}",
+    [RPC_METHOD_GENERAL_SET] = "{\"jsonrpc\":\"2.0\",\"method\":\"general:set\",\"params\":{\"name\":\"LoRaCue Stage\","
+                               "\"mode\":\"PRESENTER\",\"contrast\":128,\"bluetooth\":true,\"bluetooth_pairing\":false,"
+                               "\"slot_id\":3},\"id\":4}",
+    [RPC_METHOD_POWER_GET]   = "{\"jsonrpc\":\"2.0\",\"method\":\"power:get\",\"id\":5}",
+    [RPC_METHOD_POWER_SET]   = "{\"jsonrpc\":\"2.0\",\"method\":\"power:set\",\"params\":{\"display_sleep_enabled\":true,"
+                               "\"display_sleep_timeout_ms\":30000,\"light_sleep_enabled\":true,"
+                               "\"light_sleep_timeout_ms\":60000,\"deep_sleep_enabled\":false,"
+                               "\"deep_sleep_timeout_ms\":600000},\"id\":6}",
+    [RPC_METHOD_POWER_STATS] = "{\"jsonrpc\":\"2.0\",\"method\":\"power:stats\",\"id\":7}",
+    [RPC_METHOD_SYSTEM_BOOT_TRACE] = "{\"jsonrpc\":\"2.0\",\"method\":\"system:bootTrace\",\"id\":8}",
+    [RPC_METHOD_LORA_GET]          = "{\"jsonrpc\":\"2.0\",\"method\":\"lora:get\",\"id\":9}",
+    [RPC_METHOD_LORA_SET] = "{\"jsonrpc\":\"2.0\",\"method\":\"lora:set\",\"params\":{\"band_id\":\"HW_868\","
+                            "\"frequency_khz\":868100,\"spreading_factor\":7,\"bandwidth_khz\":125,\"coding_rate\":5,"
+                            "\"tx_power_dbm\":14,\"regulatory_domain\":\"DE\"},\"id\":10}",
+    [RPC_METHOD_LORA_KEY_GET] = "{\"jsonrpc\":\"2.0\",\"method\":\"lora:key:get\",\"id\":11}",
+    [RPC_METHOD_LORA_KEY_SET] = "{\"jsonrpc\":\"2.0\",\"method\":\"lora:key:set\",\"params\":{\"aes_key\":"
+                                "\"000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f\"},\"id\":12}",
+    [RPC_METHOD_PAIRED_LIST]  = "{\"jsonrpc\":\"2.0\",\"method\":\"paired:list\",\"id\":13}",
+    [RPC_METHOD_PAIRED_PAIR]  = "{\"jsonrpc\":\"2.0\",\"method\":\"paired:pair\",\"params\":{\"name\":\"Clicker\","
+                                "\"mac\":\"aa:bb:cc:dd:ee:ff\",\"aes_key\":"
+                                "\"000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f\"},\"id\":14}",
+    [RPC_METHOD_PAIRED_UNPAIR] = "{\"jsonrpc\":\"2.0\",\"method\":\"paired:unpair\",\"params\":{\"mac\":"
+                                 "\"aa:bb:cc:dd:ee:ff\"},\"id\":15}",
+    [RPC_METHOD_DEVICE_RESET]  = "{\"jsonrpc\":\"2.0\",\"method\":\"device:reset\",\"id\":16}",
+    [RPC_METHOD_FIRMWARE_UPGRADE] =
+        "{\"jsonrpc\":\"2.0\",\"method\":\"firmware:upgrade\",\"params\":{\"size\":1048576,\"sha256\":"
+        "\"e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855\",\"signature\":"
+        "\"00112233445566778899aabbccddeeff00112233445566778899aabbccddeeff"
+        "00112233445566778899aabbccddeeff00112233445566778899aabbccddeeff\"},\"id\":17}",
+    [RPC_METHOD_OTA_RESUME] =
+        "{\"jsonrpc\":\"2.0\",\"method\":\"ota:resume\",\"params\":{\"size\":1048576,\"sha256\":"
+        "\"e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855\",\"signature\":"
+        "\"00112233445566778899aabbccddeeff00112233445566778899aabbccddeeff"
+        "00112233445566778899aabbccddeeff00112233445566778899aabbccddeeff\"},\"id\":19}",
+    [RPC_METHOD_RPC_LIST_METHODS] = "{\"jsonrpc\":\"2.0\",\"method\":\"rpc:listMethods\",\"id\":18}",
+};
+
+typedef struct {
+    int allocations;
+    size_t bytes;
+} heap_model_t;
+
+static heap_model_t cjson_parse_model(const char *json)
+{
+    heap_model_t model = {0};
+    json_reader_t reader;
+    json_token_t tok;
+    json_reader_init(&reader, json, strlen(json));
+
+    json_tok_type_t type;
+    while ((type = json_next(&reader, &tok)) != JSON_TOK_END) {
+        TEST_ASSERT_NOT_EQUAL(JSON_TOK_ERROR, type);
+        if (type == JSON_TOK_OBJECT_END || type == JSON_TOK_ARRAY_END) {
+            continue;
+        }
+        if (type != JSON_TOK_KEY) {
+            model.allocations++;
+            model.bytes += CJSON_NODE_SIZE;
+        }
+        if (type == JSON_TOK_KEY || type == JSON_TOK_STRING) {
+            char decoded[256];
+            size_t len;
+            TEST_ASSERT_TRUE(json_token_copy(&tok, decoded, sizeof(decoded), &len));
+            model.allocations++;
+            model.bytes += len + 1;
+        }
+    }
+    return model;
+}
+
+void test_every_method_parses_and_binds(void)
+{
+    for (int m = 0; m < RPC_METHOD_COUNT; m++) {
+        const rpc_method_info_t *info = rpc_method_info((rpc_method_t)m);
+        TEST_ASSERT_NOT_NULL(info->name);
+        TEST_ASSERT_NOT_NULL_MESSAGE(sample_requests[m], info->name);
+
+        rpc_envelope_t env;
+        rpc_params_t params;
+        int bad;
+        TEST_ASSERT_EQUAL(0, parse(sample_requests[m], &env));
+        TEST_ASSERT_EQUAL(m, env.method);
+        TEST_ASSERT_EQUAL(0, rpc_bind_params(&env, &params, &bad));
+        for (int i = 0; i < info->param_count; i++) {
+            TEST_ASSERT_TRUE_MESSAGE(rpc_param_present(&params, i), info->params[i].name);
+        }
+    }
+    TEST_ASSERT_NULL(rpc_method_info(RPC_METHOD_COUNT));
+}
+
+void test_benchmark_every_method(void)
+{
+    size_t total_model_bytes = 0;
+    for (int m = 0; m < RPC_METHOD_COUNT; m++) {
+        const char *json = sample_requests[m];
+        size_t len       = strlen(json);
+        rpc_envelope_t env;
+        rpc_params_t params;
+        int bad;
+        int failures = 0;
+
+        uint64_t start = now_ns();
+        for (int i = 0; i < BENCH_ITERATIONS; i++) {
+            failures += rpc_parse_envelope(json, len, &env) != 0;
+            failures += rpc_bind_params(&env, &params, &bad) != 0;
+        }
+        uint64_t elapsed = now_ns() - start;
+        TEST_ASSERT_EQUAL(0, failures);
+
+        // The streaming path's state lives on the caller's stack: envelope plus params union
+        heap_model_t cjson = cjson_parse_model(json);
+        total_model_bytes += cjson.bytes;
+        printf("[BENCH][rpc] %-17s %4zu B: stream %7.1f ns, 0 allocs, %3zu B stack | cJSON_Parse %3d allocs, %5zu B heap\n",
+               rpc_method_info((rpc_method_t)m)->name, len, (double)elapsed / BENCH_ITERATIONS,
+               sizeof(env) + sizeof(params), cjson.allocations, cjson.bytes);
+    }
+    printf("[BENCH][rpc] cJSON_Parse heap across all methods: %zu B\n", total_model_bytes);
+}
+
+// The lookup this replaced: compare the request's method token against every name in turn
+static rpc_method_t linear_find(const json_token_t *name)
+{
+    for (int m = 0; m < RPC_METHOD_COUNT; m++) {
+        if (json_token_equals(name, rpc_method_info((rpc_method_t)m)->name)) {
+            return (rpc_method_t)m;
+        }
+    }
+    return RPC_METHOD_NONE;
+}
+
+// What rpc_parse_envelope() does now: unescape the token, then one hash probe
+static rpc_method_t hash_find(const json_token_t *name)
+{
+    char buf[RPC_METHOD_NAME_MAX + 1];
+    size_t len;
+    return json_token_copy(name, buf, sizeof(buf), &len) ? rpc_method_find(buf, len) : RPC_METHOD_NONE;
+}
+
+void test_benchmark_method_lookup(void)
+{
+    static const char *const misses[] = {"nope", "lora:key:gets", "rpc:listmethods"};
+    volatile int sink = 0;
+    uint64_t hash_ns  = 0;
+    uint64_t scan_ns  = 0;
+
+    for (int m = 0; m < RPC_METHOD_COUNT + 3; m++) {
+        const char *name = m < RPC_METHOD_COUNT ? rpc_method_info((rpc_method_t)m)->name : misses[m - RPC_METHOD_COUNT];
+        char json[48];
+        json_reader_t reader;
+        json_token_t tok;
+        snprintf(json, sizeof(json), "\"%s\"", name);
+        json_reader_init(&reader, json, strlen(json));
+        TEST_ASSERT_EQUAL(JSON_TOK_STRING, json_next(&reader, &tok));
+        TEST_ASSERT_EQUAL(linear_find(&tok), hash_find(&tok));
+
+        uint64_t start = now_ns();
+        for (int i = 0; i < BENCH_ITERATIONS; i++) {
+            sink += hash_find(&tok);
+        }
+        uint64_t mid = now_ns();
+        for (int i = 0; i < BENCH_ITERATIONS; i++) {
+            sink += linear_find(&tok);
+        }
+        hash_ns += mid - start;
+        scan_ns += now_ns() - mid;
+    }
+    double lookups = (double)(RPC_METHOD_COUNT + 3) * BENCH_ITERATIONS;
+    printf("[BENCH][rpc] method lookup over %d names + 3 misses: perfect hash %5.1f ns, linear scan %5.1f ns\n",
+           RPC_METHOD_COUNT, (double)hash_ns / lookups, (double)scan_ns / lookups);
+}
@@ -0,0 +1,384 @@
+/**
+ * @file test_seq_journal.c
+ * @brief Unit tests for the sequence journal with a fault-injecting flash backend
+ */
+
+#include "unity.h"
+#include "seq_journal.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CRASH_ITERATIONS 2000
+
+/**
+ * @brief Simulated flash: two slots, failures and torn writes on demand
+ */
+typedef struct {
+    seq_journal_record_t slots[SEQ_JOURNAL_SLOTS];
+    bool present[SEQ_JOURNAL_SLOTS];
+    int fail_writes; ///< Number of upcoming writes that fail without touching flash
+    int tear_writes; ///< Number of upcoming writes that leave a corrupt record behind
+    int write_count;
+} sim_flash_t;
+
+static sim_flash_t flash;
+static seq_journal_backend_t backend;
+
+static esp_err_t sim_read(void *ctx, uint8_t slot, seq_journal_record_t *record)
+{
+    sim_flash_t *sim = ctx;
+    if (!sim->present[slot]) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    *record = sim->slots[slot];
+    return ESP_OK;
+}
+
+static esp_err_t sim_write(void *ctx, uint8_t slot, const seq_journal_record_t *record)
+{
+    sim_flash_t *sim = ctx;
+    if (sim->fail_writes > 0) {
+        sim->fail_writes--;
+        return ESP_FAIL;
+    }
+
+    sim->write_count++;
+    sim->slots[slot]   = *record;
+    sim->present[slot] = true;
+
+    if (sim->tear_writes > 0) {
+        sim->tear_writes--;
+        sim->slots[slot].crc ^= 0x5A5A5A5Au; // Power lost mid-write
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+void setUp(void)
+{
+    memset(&flash, 0, sizeof(flash));
+    backend.read  = sim_read;
+    backend.write = sim_write;
+    backend.ctx   = &flash;
+}
+
+void tearDown(void)
+{
+}
+
+void test_open_empty_journal(void)
+{
+    seq_journal_t journal;
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, seq_journal_open(&journal, &backend));
+    TEST_ASSERT_FALSE(seq_journal_has_value(&journal));
+}
+
+void test_write_then_reopen(void)
+{
+    seq_journal_t journal;
+    seq_journal_open(&journal, &backend);
+    TEST_ASSERT_EQUAL(ESP_OK, seq_journal_write(&journal, &backend, 1000));
+    TEST_ASSERT_EQUAL(ESP_OK, seq_journal_write(&journal, &backend, 2000));
+
+    seq_journal_t reopened;
+    TEST_ASSERT_EQUAL(ESP_OK, seq_journal_open(&reopened, &backend));
+    TEST_ASSERT_EQUAL(2000, reopened.value);
+    TEST_ASSERT_EQUAL(journal.generation, reopened.generation);
+}
+
+void test_writes_alternate_slots(void)
+{
+    seq_journal_t journal;
+    seq_journal_open(&journal, &backend);
+    seq_journal_write(&journal, &backend, 1);
+    uint8_t first = journal.active_slot;
+    seq_journal_write(&journal, &backend, 2);
+    TEST_ASSERT_NOT_EQUAL(first, journal.active_slot);
+}
+
+void test_failed_write_keeps_state(void)
+{
+    seq_journal_t journal;
+    seq_journal_open(&journal, &backend);
+    seq_journal_write(&journal, &backend, 500);
+
+    flash.fail_writes = 1;
+    TEST_ASSERT_EQUAL(ESP_FAIL, seq_journal_write(&journal, &backend, 900));
+    TEST_ASSERT_EQUAL(500, journal.value);
+
+    seq_journal_t reopened;
+    seq_journal_open(&reopened, &backend);
+    TEST_ASSERT_EQUAL(500, reopened.value);
+}
+
+void test_torn_write_falls_back_to_previous_record(void)
+{
+    seq_journal_t journal;
+    seq_journal_open(&journal, &backend);
+    seq_journal_write(&journal, &backend, 100);
+    seq_journal_write(&journal, &backend, 200);
+
+    flash.tear_writes = 1;
+    seq_journal_write(&journal, &backend, 300);
+
+    seq_journal_t reopened;
+    TEST_ASSERT_EQUAL(ESP_OK, seq_journal_open(&reopened, &backend));
+    TEST_ASSERT_EQUAL(200, reopened.value);
+}
+
+void test_torn_first_write_reads_as_empty(void)
+{
+    seq_journal_t journal;
+    seq_journal_open(&journal, &backend);
+
+    flash.tear_writes = 1;
+    seq_journal_write(&journal, &backend, 42);
+
+    seq_journal_t reopened;
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, seq_journal_open(&reopened, &backend));
+}
+
+void test_reservation_first_boot_uses_seed(void)
+{
+    seq_reservation_t res;
+    TEST_ASSERT_EQUAL(ESP_OK, seq_reservation_init(&res, &backend, 0x1234));
+
+    uint32_t seq;
+    TEST_ASSERT_EQUAL(ESP_OK, seq_reservation_take(&res, &seq));
+    TEST_ASSERT_EQUAL(0x1234, seq);
+    TEST_ASSERT_EQUAL(1, flash.write_count);
+}
+
+void test_reservation_resumes_above_everything_sent(void)
+{
+    seq_reservation_t res;
+    seq_reservation_init(&res, &backend, 10);
+
+    uint32_t seq = 0;
+    for (int i = 0; i < 50; i++) {
+        seq_reservation_take(&res, &seq);
+    }
+
+    seq_reservation_t rebooted;
+    TEST_ASSERT_EQUAL(ESP_OK, seq_reservation_init(&rebooted, &backend, 0xFFFF));
+    uint32_t next;
+    seq_reservation_take(&rebooted, &next);
+    TEST_ASSERT_GREATER_THAN(seq, next);
+}
+
+void test_reservation_exhaustion_requires_extend(void)
+{
+    seq_reservation_t res;
+    seq_reservation_init(&res, &backend, 0);
+
+    uint32_t seq;
+    for (int i = 0; i < SEQ_JOURNAL_BLOCK_SIZE; i++) {
+        TEST_ASSERT_EQUAL(ESP_OK, seq_reservation_take(&res, &seq));
+    }
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, seq_reservation_take(&res, &seq));
+
+    TEST_ASSERT_EQUAL(ESP_OK, seq_reservation_extend(&res, &backend));
+    TEST_ASSERT_EQUAL(ESP_OK, seq_reservation_take(&res, &seq));
+    TEST_ASSERT_EQUAL(SEQ_JOURNAL_BLOCK_SIZE, seq);
+}
+
+void test_reservation_low_water(void)
+{
+    seq_reservation_t res;
+    seq_reservation_init(&res, &backend, 0);
+    TEST_ASSERT_FALSE(seq_reservation_needs_extend(&res));
+
+    uint32_t seq;
+    for (int i = 0; i < SEQ_JOURNAL_BLOCK_SIZE - SEQ_JOURNAL_LOW_WATER; i++) {
+        seq_reservation_take(&res, &seq);
+    }
+    TEST_ASSERT_TRUE(seq_reservation_needs_extend(&res));
+}
+
+void test_reservation_handles_32bit_wrap(void)
+{
+    seq_reservation_t res;
+    seq_reservation_init(&res, &backend, UINT32_MAX - 10);
+
+    uint32_t seq;
+    for (int i = 0; i < 20; i++) {
+        TEST_ASSERT_EQUAL(ESP_OK, seq_reservation_take(&res, &seq));
+    }
+    TEST_ASSERT_EQUAL(8, seq);
+}
+
+void test_one_flash_write_per_block(void)
+{
+    seq_reservation_t res;
+    seq_reservation_init(&res, &backend, 0);
+
+    uint32_t seq;
+    for (int i = 0; i < 10 * SEQ_JOURNAL_BLOCK_SIZE; i++) {
+        if (seq_reservation_needs_extend(&res)) {
+            seq_reservation_extend(&res, &backend);
+        }
+        seq_reservation_take(&res, &seq);
+    }
+    TEST_ASSERT_LESS_OR_EQUAL(11, flash.write_count);
+}
+
+void test_skip_moves_a_block_ahead_of_everything_sent(void)
+{
+    seq_reservation_t res;
+    seq_reservation_init(&res, &backend, 100);
+
+    uint32_t sent = 0;
+    for (int i = 0; i < 200; i++) {
+        seq_reservation_take(&res, &sent);
+    }
+
+    TEST_ASSERT_EQUAL(ESP_OK, seq_reservation_skip(&res, &backend, SEQ_JOURNAL_BLOCK_SIZE));
+    TEST_ASSERT_FALSE(seq_reservation_needs_extend(&res));
+
+    uint32_t next;
+    TEST_ASSERT_EQUAL(ESP_OK, seq_reservation_take(&res, &next));
+    TEST_ASSERT_EQUAL(sent + 1 + SEQ_JOURNAL_BLOCK_SIZE, next);
+
+    // The skipped-to position is durable: a reboot resumes above it
+    seq_reservation_t rebooted;
+    seq_reservation_init(&rebooted, &backend, 0);
+    TEST_ASSERT_GREATER_THAN(next, rebooted.next);
+}
+
+void test_failed_skip_keeps_the_next_sequence(void)
+{
+    seq_reservation_t res;
+    seq_reservation_init(&res, &backend, 0);
+    uint32_t next = res.next;
+
+    flash.fail_writes = 1;
+    TEST_ASSERT_EQUAL(ESP_FAIL, seq_reservation_skip(&res, &backend, SEQ_JOURNAL_BLOCK_SIZE));
+    TEST_ASSERT_EQUAL(next, res.next);
+
+    uint32_t seq;
+    TEST_ASSERT_EQUAL(ESP_OK, seq_reservation_take(&res, &seq));
+    TEST_ASSERT_EQUAL(next, seq);
+}
+
+void test_resume_continues_inside_reservation_without_write(void)
+{
+    seq_reservation_t res;
+    seq_reservation_init(&res, &backend, 0);
+
+    uint32_t seq;
+    for (int i = 0; i < 20; i++) {
+        seq_reservation_take(&res, &seq);
+    }
+
+    // Deep sleep: RAM lost, RTC keeps res.next
+    seq_reservation_t woken;
+    int writes = flash.write_count;
+    TEST_ASSERT_EQUAL(ESP_OK, seq_reservation_resume(&woken, &backend, res.next, 0xFFFF));
+    TEST_ASSERT_EQUAL(writes, flash.write_count);
+
+    uint32_t next;
+    seq_reservation_take(&woken, &next);
+    TEST_ASSERT_EQUAL(seq + 1, next);
+}
+
+void test_resume_extends_when_below_low_water(void)
+{
+    seq_reservation_t res;
+    seq_reservation_init(&res, &backend, 0);
+
+    uint32_t seq;
+    for (int i = 0; i < SEQ_JOURNAL_BLOCK_SIZE - 1; i++) {
+        seq_reservation_take(&res, &seq);
+    }
+
+    seq_reservation_t woken;
+    int writes = flash.write_count;
+    TEST_ASSERT_EQUAL(ESP_OK, seq_reservation_resume(&woken, &backend, res.next, 0));
+    TEST_ASSERT_EQUAL(writes + 1, flash.write_count);
+    TEST_ASSERT_FALSE(seq_reservation_needs_extend(&woken));
+}
+
+void test_resume_outside_reservation_falls_back_to_init(void)
+{
+    seq_reservation_t res;
+    seq_reservation_init(&res, &backend, 1000);
+
+    // Stale counter at or above the durable reservation must not be trusted
+    seq_reservation_t woken;
+    TEST_ASSERT_EQUAL(ESP_OK, seq_reservation_resume(&woken, &backend, res.reserved + 5, 0));
+
+    uint32_t next;
+    seq_reservation_take(&woken, &next);
+    TEST_ASSERT_EQUAL(res.reserved, next);
+}
+
+void test_resume_on_empty_journal_uses_seed(void)
+{
+    seq_reservation_t res;
+    TEST_ASSERT_EQUAL(ESP_OK, seq_reservation_resume(&res, &backend, 500, 0x1234));
+
+    uint32_t seq;
+    seq_reservation_take(&res, &seq);
+    TEST_ASSERT_EQUAL(0x1234, seq);
+}
+
+void test_block_crossed_detection(void)
+{
+    TEST_ASSERT_FALSE(seq_journal_block_crossed(1000, 1000 + SEQ_JOURNAL_BLOCK_SIZE - 1));
+    TEST_ASSERT_TRUE(seq_journal_block_crossed(1000, 1000 + SEQ_JOURNAL_BLOCK_SIZE));
+    // 16-bit wrap-around is still forward progress
+    TEST_ASSERT_TRUE(seq_journal_block_crossed(0xFF80, 0x0080));
+    // Going backwards never triggers a snapshot
+    TEST_ASSERT_FALSE(seq_journal_block_crossed(5000, 1000));
+}
+
+/**
+ * Random power loss during sends and reservation writes: after every reboot the
+ * allocator must never hand out a sequence at or below one already transmitted.
+ */
+void test_crash_loop_never_reuses_sequence(void)
+{
+    srand(12345);
+
+    uint32_t highest_sent = 0;
+    bool any_sent         = false;
+
+    for (int boot = 0; boot < CRASH_ITERATIONS; boot++) {
+        seq_reservation_t res;
+        if (seq_reservation_init(&res, &backend, 100) != ESP_OK) {
+            continue; // Reservation write failed: nothing may be sent this boot
+        }
+
+        int sends = rand() % 600;
+        for (int i = 0; i < sends; i++) {
+            if (seq_reservation_needs_extend(&res)) {
+                int fault = rand() % 8;
+                if (fault == 0) {
+                    flash.fail_writes = 1;
+                } else if (fault == 1) {
+                    flash.tear_writes = 1;
+                }
+                seq_reservation_extend(&res, &backend);
+                flash.fail_writes = 0;
+                if (fault == 1) {
+                    break; // Torn write means power was lost
+                }
+            }
+
+            uint32_t seq;
+            if (seq_reservation_take(&res, &seq) != ESP_OK) {
+                break;
+            }
+            if (any_sent) {
+                TEST_ASSERT_GREATER_THAN(highest_sent, seq);
+            }
+            highest_sent = seq;
+            any_sent     = true;
+        }
+        flash.tear_writes = 0;
+    }
+
+    TEST_ASSERT_TRUE(any_sent);
+}
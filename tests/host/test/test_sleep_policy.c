@@ -0,0 +1,156 @@
+/**
+ * @file test_sleep_policy.c
+ * @brief Unit tests for wake-source declarations and sleep-blocker accounting
+ */
+
+#include "unity.h"
+#include "sleep_policy.h"
+#include <stdint.h>
+
+#define MS_US 1000ULL
+
+static sleep_policy_t policy;
+
+void setUp(void)
+{
+    sleep_policy_init(&policy);
+}
+
+void tearDown(void)
+{
+}
+
+void test_empty_policy_allows_sleep(void)
+{
+    TEST_ASSERT_TRUE(sleep_policy_can_sleep(&policy));
+    TEST_ASSERT_EQUAL(-1, sleep_policy_blocker(&policy));
+    TEST_ASSERT_EQUAL(0, sleep_policy_wake_sources(&policy));
+}
+
+void test_register_is_idempotent_by_name(void)
+{
+    int first, second;
+    TEST_ASSERT_EQUAL(ESP_OK, sleep_policy_register(&policy, "input", SLEEP_WAKE_GPIO, 0, &first));
+    TEST_ASSERT_EQUAL(ESP_OK, sleep_policy_register(&policy, "input", SLEEP_WAKE_GPIO | SLEEP_WAKE_TIMER, 10, &second));
+    TEST_ASSERT_EQUAL(first, second);
+    TEST_ASSERT_EQUAL(1, policy.count);
+    TEST_ASSERT_EQUAL(10, policy.clients[first].wake_period_ms);
+}
+
+void test_register_rejects_bad_names_and_overflow(void)
+{
+    int id;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, sleep_policy_register(&policy, "", 0, 0, &id));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, sleep_policy_register(&policy, "name_far_too_long", 0, 0, &id));
+
+    char name[4] = "c00";
+    for (int i = 0; i < SLEEP_POLICY_MAX_CLIENTS; i++) {
+        name[1] = '0' + i / 10;
+        name[2] = '0' + i % 10;
+        TEST_ASSERT_EQUAL(ESP_OK, sleep_policy_register(&policy, name, 0, 0, &id));
+    }
+    TEST_ASSERT_EQUAL(ESP_ERR_NO_MEM, sleep_policy_register(&policy, "extra", 0, 0, &id));
+}
+
+void test_block_prevents_sleep_and_names_blocker(void)
+{
+    int led;
+    sleep_policy_register(&policy, "led", SLEEP_WAKE_TIMER, 20, &led);
+
+    sleep_policy_block(&policy, led, 1000 * MS_US);
+    TEST_ASSERT_FALSE(sleep_policy_can_sleep(&policy));
+    TEST_ASSERT_EQUAL(led, sleep_policy_blocker(&policy));
+
+    sleep_policy_allow(&policy, led, 1500 * MS_US);
+    TEST_ASSERT_TRUE(sleep_policy_can_sleep(&policy));
+    TEST_ASSERT_EQUAL(500 * MS_US, sleep_policy_blocked_us(&policy, led, 2000 * MS_US));
+    TEST_ASSERT_EQUAL(1, policy.clients[led].block_count);
+}
+
+void test_nested_blocks_count_once(void)
+{
+    int input;
+    sleep_policy_register(&policy, "input", SLEEP_WAKE_GPIO, 0, &input);
+
+    sleep_policy_block(&policy, input, 0);
+    sleep_policy_block(&policy, input, 10 * MS_US);
+    sleep_policy_allow(&policy, input, 20 * MS_US);
+    TEST_ASSERT_FALSE(sleep_policy_can_sleep(&policy));
+
+    sleep_policy_allow(&policy, input, 30 * MS_US);
+    TEST_ASSERT_TRUE(sleep_policy_can_sleep(&policy));
+    TEST_ASSERT_EQUAL(30 * MS_US, sleep_policy_blocked_us(&policy, input, 30 * MS_US));
+    TEST_ASSERT_EQUAL(1, policy.clients[input].block_count);
+}
+
+void test_unbalanced_allow_rejected(void)
+{
+    int usb;
+    sleep_policy_register(&policy, "usb", SLEEP_WAKE_USB, 0, &usb);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, sleep_policy_allow(&policy, usb, 0));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, sleep_policy_block(&policy, 7, 0));
+    TEST_ASSERT_TRUE(sleep_policy_can_sleep(&policy));
+}
+
+void test_longest_running_blocker_is_reported(void)
+{
+    int usb, led;
+    sleep_policy_register(&policy, "usb", SLEEP_WAKE_USB, 0, &usb);
+    sleep_policy_register(&policy, "led", SLEEP_WAKE_TIMER, 20, &led);
+
+    sleep_policy_block(&policy, led, 100 * MS_US);
+    sleep_policy_block(&policy, usb, 200 * MS_US);
+    TEST_ASSERT_EQUAL(led, sleep_policy_blocker(&policy));
+
+    sleep_policy_allow(&policy, led, 300 * MS_US);
+    TEST_ASSERT_EQUAL(usb, sleep_policy_blocker(&policy));
+}
+
+void test_any_blocked_time_merges_overlaps(void)
+{
+    int a, b;
+    sleep_policy_register(&policy, "a", 0, 0, &a);
+    sleep_policy_register(&policy, "b", 0, 0, &b);
+
+    // a: 0-300ms, b: 100-500ms -> system blocked 0-500ms
+    sleep_policy_block(&policy, a, 0);
+    sleep_policy_block(&policy, b, 100 * MS_US);
+    sleep_policy_allow(&policy, a, 300 * MS_US);
+    sleep_policy_allow(&policy, b, 500 * MS_US);
+
+    TEST_ASSERT_EQUAL(500 * MS_US, sleep_policy_any_blocked_us(&policy, 1000 * MS_US));
+    TEST_ASSERT_EQUAL(700 * MS_US, sleep_policy_blocked_us(&policy, a, 1000 * MS_US) +
+                                       sleep_policy_blocked_us(&policy, b, 1000 * MS_US));
+}
+
+void test_ongoing_block_included_in_totals(void)
+{
+    int radio;
+    sleep_policy_register(&policy, "lora_rx", SLEEP_WAKE_RADIO, 0, &radio);
+    sleep_policy_block(&policy, radio, 50 * MS_US);
+    TEST_ASSERT_EQUAL(150 * MS_US, sleep_policy_blocked_us(&policy, radio, 200 * MS_US));
+    TEST_ASSERT_EQUAL(150 * MS_US, sleep_policy_any_blocked_us(&policy, 200 * MS_US));
+}
+
+void test_wake_source_union_and_min_period(void)
+{
+    int input, battery, lvgl, owner;
+    sleep_policy_register(&policy, "input", SLEEP_WAKE_GPIO, 0, &input);
+    TEST_ASSERT_EQUAL(0, sleep_policy_min_wake_period_ms(&policy, &owner));
+    TEST_ASSERT_EQUAL(-1, owner);
+
+    sleep_policy_register(&policy, "battery", SLEEP_WAKE_TIMER, 5000, &battery);
+    sleep_policy_register(&policy, "lvgl", SLEEP_WAKE_TIMER, 5, &lvgl);
+
+    TEST_ASSERT_EQUAL(SLEEP_WAKE_GPIO | SLEEP_WAKE_TIMER, sleep_policy_wake_sources(&policy));
+    TEST_ASSERT_EQUAL(5, sleep_policy_min_wake_period_ms(&policy, &owner));
+    TEST_ASSERT_EQUAL(lvgl, owner);
+}
+
+void test_wake_source_names(void)
+{
+    TEST_ASSERT_EQUAL_STRING("gpio", sleep_policy_wake_source_name(SLEEP_WAKE_GPIO));
+    TEST_ASSERT_EQUAL_STRING("radio", sleep_policy_wake_source_name(SLEEP_WAKE_RADIO));
+    TEST_ASSERT_NULL(sleep_policy_wake_source_name(SLEEP_WAKE_GPIO | SLEEP_WAKE_TIMER));
+    TEST_ASSERT_NULL(sleep_policy_wake_source_name(0));
+}
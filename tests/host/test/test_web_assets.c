@@ -0,0 +1,156 @@
+/**
+ * @file test_web_assets.c
+ * @brief Unit tests for the web UI asset index: parsing, SPA lookup, encoding negotiation,
+ *        ETag matching and cache policy
+ */
+
+#define _DEFAULT_SOURCE // strdup() under -std=c11
+
+#include "unity.h"
+#include "web_assets.h"
+#include <stdlib.h>
+#include <string.h>
+
+static web_assets_t table;
+
+static const char INDEX[] = "/index.html\t0123456789abcdef\tgb\n"
+                            "/_next/static/chunks/main-1a2b3c.js\tfedcba9876543210\tg\n"
+                            "/settings/index.html\t00112233aabbccdd\tg\n"
+                            "/favicon.ico\taabbccddeeff0011\t-\n"
+                            "/404.html\t1111222233334444\tg"; // No final LF
+
+static void load(const char *text)
+{
+    char *copy = strdup(text);
+    TEST_ASSERT_NOT_NULL(copy);
+    TEST_ASSERT_EQUAL(ESP_OK, web_assets_parse(&table, copy));
+}
+
+void setUp(void)
+{
+    memset(&table, 0, sizeof(table));
+}
+
+void tearDown(void)
+{
+    web_assets_free(&table);
+}
+
+void test_parse_reads_every_line(void)
+{
+    load(INDEX);
+    TEST_ASSERT_EQUAL(5, table.count);
+
+    const web_asset_t *a = web_assets_find(&table, "/_next/static/chunks/main-1a2b3c.js");
+    TEST_ASSERT_NOT_NULL(a);
+    TEST_ASSERT_EQUAL_STRING("fedcba9876543210", a->hash);
+    TEST_ASSERT_EQUAL(WEB_ASSET_GZIP, a->variants);
+
+    a = web_assets_find(&table, "/404.html");
+    TEST_ASSERT_NOT_NULL(a);
+    TEST_ASSERT_EQUAL_STRING("1111222233334444", a->hash);
+
+    TEST_ASSERT_EQUAL(0, web_assets_find(&table, "/favicon.ico")->variants);
+}
+
+void test_parse_rejects_malformed_lines(void)
+{
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, web_assets_parse(&table, strdup("/index.html\tabc\n")));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, web_assets_parse(&table, strdup("index.html\tabc\tg\n")));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, web_assets_parse(&table, strdup("/index.html\t\tg\n")));
+    TEST_ASSERT_EQUAL(0, table.count);
+
+    TEST_ASSERT_EQUAL(ESP_OK, web_assets_parse(&table, strdup("")));
+    TEST_ASSERT_NULL(web_assets_find(&table, "/"));
+}
+
+void test_find_resolves_routes_like_the_static_export(void)
+{
+    load(INDEX);
+
+    TEST_ASSERT_EQUAL_STRING("/index.html", web_assets_find(&table, "/")->path);
+    TEST_ASSERT_EQUAL_STRING("/index.html", web_assets_find(&table, "/?lang=de")->path);
+    TEST_ASSERT_EQUAL_STRING("/settings/index.html", web_assets_find(&table, "/settings/")->path);
+    TEST_ASSERT_EQUAL_STRING("/settings/index.html", web_assets_find(&table, "/settings")->path);
+    TEST_ASSERT_EQUAL_STRING("/settings/index.html", web_assets_find(&table, "/settings?tab=lora")->path);
+
+    // Files with a page extension are never treated as directories
+    TEST_ASSERT_NULL(web_assets_find(&table, "/missing.js"));
+    TEST_ASSERT_NULL(web_assets_find(&table, "/devices"));
+    TEST_ASSERT_NULL(web_assets_find(&table, ""));
+}
+
+void test_find_rejects_overlong_uris(void)
+{
+    load(INDEX);
+    char uri[600];
+    memset(uri, 'a', sizeof(uri) - 1);
+    uri[0]               = '/';
+    uri[sizeof(uri) - 1] = '\0';
+    TEST_ASSERT_NULL(web_assets_find(&table, uri));
+}
+
+void test_encoding_prefers_brotli_then_gzip(void)
+{
+    load(INDEX);
+    const web_asset_t *index = web_assets_find(&table, "/");
+    const web_asset_t *js    = web_assets_find(&table, "/_next/static/chunks/main-1a2b3c.js");
+    const web_asset_t *icon  = web_assets_find(&table, "/favicon.ico");
+
+    TEST_ASSERT_EQUAL(WEB_ENCODING_BROTLI, web_assets_pick_encoding(index, "gzip, deflate, br"));
+    TEST_ASSERT_EQUAL(WEB_ENCODING_GZIP, web_assets_pick_encoding(index, "gzip, deflate"));
+    TEST_ASSERT_EQUAL(WEB_ENCODING_GZIP, web_assets_pick_encoding(js, "gzip, deflate, br"));
+    TEST_ASSERT_EQUAL(WEB_ENCODING_IDENTITY, web_assets_pick_encoding(icon, "gzip, br"));
+    TEST_ASSERT_EQUAL(WEB_ENCODING_IDENTITY, web_assets_pick_encoding(index, NULL));
+    TEST_ASSERT_EQUAL(WEB_ENCODING_IDENTITY, web_assets_pick_encoding(index, "identity"));
+}
+
+void test_encoding_honours_q_values_and_wildcards(void)
+{
+    load(INDEX);
+    const web_asset_t *index = web_assets_find(&table, "/");
+
+    TEST_ASSERT_EQUAL(WEB_ENCODING_GZIP, web_assets_pick_encoding(index, "br;q=0, gzip;q=0.8"));
+    TEST_ASSERT_EQUAL(WEB_ENCODING_IDENTITY, web_assets_pick_encoding(index, "br;q=0.0, gzip; q=0"));
+    TEST_ASSERT_EQUAL(WEB_ENCODING_BROTLI, web_assets_pick_encoding(index, "*"));
+    // An exact token wins over "*" wherever either appears in the list
+    TEST_ASSERT_EQUAL(WEB_ENCODING_GZIP, web_assets_pick_encoding(index, "*;q=0, gzip"));
+    TEST_ASSERT_EQUAL(WEB_ENCODING_GZIP, web_assets_pick_encoding(index, "br;q=0, *"));
+    TEST_ASSERT_EQUAL(WEB_ENCODING_IDENTITY, web_assets_pick_encoding(index, "*, br;q=0, gzip;q=0"));
+    TEST_ASSERT_EQUAL(WEB_ENCODING_GZIP, web_assets_pick_encoding(index, "GZIP"));
+    TEST_ASSERT_EQUAL(WEB_ENCODING_IDENTITY, web_assets_pick_encoding(index, "xgzip, brotli"));
+}
+
+void test_etags_differ_per_variant_and_match_if_none_match(void)
+{
+    load(INDEX);
+    const web_asset_t *index = web_assets_find(&table, "/");
+    char plain[WEB_ASSETS_ETAG_MAX];
+    char gzip[WEB_ASSETS_ETAG_MAX];
+    web_assets_format_etag(index, WEB_ENCODING_IDENTITY, plain);
+    web_assets_format_etag(index, WEB_ENCODING_GZIP, gzip);
+
+    TEST_ASSERT_EQUAL_STRING("\"0123456789abcdef\"", plain);
+    TEST_ASSERT_EQUAL_STRING("\"0123456789abcdef-gz\"", gzip);
+
+    TEST_ASSERT_TRUE(web_assets_etag_match("\"0123456789abcdef-gz\"", gzip));
+    TEST_ASSERT_TRUE(web_assets_etag_match("\"x\", W/\"0123456789abcdef-gz\"", gzip));
+    TEST_ASSERT_TRUE(web_assets_etag_match("*", plain));
+    TEST_ASSERT_FALSE(web_assets_etag_match("\"0123456789abcdef\"", gzip));
+    TEST_ASSERT_FALSE(web_assets_etag_match("\"0123456789abcde\"", plain));
+    TEST_ASSERT_FALSE(web_assets_etag_match(NULL, plain));
+    TEST_ASSERT_FALSE(web_assets_etag_match("", plain));
+}
+
+void test_cache_control_and_content_type(void)
+{
+    TEST_ASSERT_EQUAL_STRING("public, max-age=31536000, immutable",
+                             web_assets_cache_control("/_next/static/chunks/main-1a2b3c.js"));
+    TEST_ASSERT_EQUAL_STRING("no-cache", web_assets_cache_control("/index.html"));
+    TEST_ASSERT_EQUAL_STRING("no-cache", web_assets_cache_control("/_next/data.json"));
+
+    TEST_ASSERT_EQUAL_STRING("text/html", web_assets_content_type("/index.html"));
+    TEST_ASSERT_EQUAL_STRING("application/javascript", web_assets_content_type("/a/b.c/main.js"));
+    TEST_ASSERT_EQUAL_STRING("image/svg+xml", web_assets_content_type("/logo.SVG"));
+    TEST_ASSERT_EQUAL_STRING("application/octet-stream", web_assets_content_type("/a.b/LICENSE"));
+}
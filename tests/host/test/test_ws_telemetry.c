@@ -0,0 +1,160 @@
+/**
+ * @file test_ws_telemetry.c
+ * @brief Unit tests for the WebSocket telemetry state: change detection, per-client deltas,
+ *        rate limits and coalescing under backpressure
+ */
+
+#include "unity.h"
+#include "json_stream.h" // Links json_stream.c, which ws_telemetry.c encodes with
+#include "ws_telemetry.h"
+#include <string.h>
+
+#define MIN_INTERVAL_MS 100
+
+static ws_telemetry_state_t state;
+static ws_telemetry_client_t client;
+static char frame[WS_TELEMETRY_FRAME_MAX];
+
+// Encode and mark sent, as the server does after a successful send
+static const char *send_frame(uint32_t now_ms)
+{
+    size_t len = ws_telemetry_encode(&state, &client, now_ms, frame, sizeof(frame) - 1);
+    TEST_ASSERT_GREATER_THAN(0, len);
+    frame[len] = '\0';
+    ws_telemetry_client_sent(&state, &client, now_ms);
+    return frame;
+}
+
+void setUp(void)
+{
+    ws_telemetry_init(&state);
+    ws_telemetry_client_init(&client, 7, 250, MIN_INTERVAL_MS);
+}
+
+void tearDown(void)
+{
+}
+
+void test_first_frame_is_a_snapshot_of_known_topics(void)
+{
+    ws_telemetry_set_battery(&state, 87, true);
+    ws_telemetry_set_lora(&state, true, -71);
+    ws_telemetry_set_mode(&state, "PRESENTER");
+
+    TEST_ASSERT_TRUE(ws_telemetry_client_due(&state, &client, 0)); // No interval before the first frame
+    TEST_ASSERT_EQUAL_STRING("{\"t\":5,\"bat\":[87,true],\"lora\":[true,-71],\"mode\":\"PRESENTER\"}", send_frame(5));
+}
+
+void test_nothing_to_send_without_changes(void)
+{
+    TEST_ASSERT_FALSE(ws_telemetry_client_due(&state, &client, 0));
+
+    ws_telemetry_set_usb(&state, true);
+    send_frame(0);
+    TEST_ASSERT_FALSE(ws_telemetry_client_due(&state, &client, 10000));
+}
+
+void test_unchanged_values_do_not_bump(void)
+{
+    ws_telemetry_set_battery(&state, 50, false);
+    send_frame(0);
+
+    ws_telemetry_set_battery(&state, 50, false);
+    ws_telemetry_set_mode(&state, NULL);
+    TEST_ASSERT_EQUAL_STRING("{\"t\":1000,\"mode\":null}", send_frame(1000));
+
+    ws_telemetry_set_ota(&state, 0, "idle");
+    send_frame(2000);
+    ws_telemetry_set_ota(&state, 0, "idle");
+    TEST_ASSERT_FALSE(ws_telemetry_client_due(&state, &client, 3000));
+}
+
+void test_delta_carries_only_changed_topics(void)
+{
+    ws_telemetry_set_battery(&state, 80, false);
+    ws_telemetry_set_usb(&state, false);
+    send_frame(0);
+
+    ws_telemetry_set_usb(&state, true);
+    TEST_ASSERT_EQUAL_STRING("{\"t\":300,\"usb\":true}", send_frame(300));
+}
+
+void test_rate_limit_holds_updates_until_the_interval(void)
+{
+    ws_telemetry_set_lora(&state, true, -60);
+    send_frame(1000);
+
+    ws_telemetry_set_lora(&state, true, -61);
+    TEST_ASSERT_FALSE(ws_telemetry_client_due(&state, &client, 1100));
+    TEST_ASSERT_FALSE(ws_telemetry_client_due(&state, &client, 1249));
+    TEST_ASSERT_TRUE(ws_telemetry_client_due(&state, &client, 1250));
+}
+
+void test_requested_interval_is_clamped_to_the_minimum(void)
+{
+    ws_telemetry_client_init(&client, 7, 10, MIN_INTERVAL_MS);
+    TEST_ASSERT_EQUAL(MIN_INTERVAL_MS, client.interval_ms);
+
+    ws_telemetry_client_init(&client, 7, 2000, MIN_INTERVAL_MS);
+    TEST_ASSERT_EQUAL(2000, client.interval_ms);
+}
+
+void test_stale_updates_coalesce_to_the_latest(void)
+{
+    ws_telemetry_set_ota(&state, 0, "active");
+    send_frame(0);
+
+    // Backpressure: the server skips three ticks while the value keeps moving
+    for (uint8_t percent = 10; percent <= 30; percent += 10) {
+        ws_telemetry_set_ota(&state, percent, "active");
+        client.skipped++;
+    }
+    TEST_ASSERT_EQUAL_STRING("{\"t\":900,\"ota\":[30,\"active\"],\"skip\":3}", send_frame(900));
+    TEST_ASSERT_EQUAL(0, client.skipped);
+}
+
+void test_events_count_so_clients_see_missed_ones(void)
+{
+    const uint8_t report[5] = {0x02, 0x4f, 0x00, 0x00, 0x00};
+
+    ws_telemetry_add_lora_command(&state, "NEXT", -80);
+    ws_telemetry_add_lora_command(&state, "NEXT", -80); // Same command again still counts
+    ws_telemetry_add_hid_report(&state, 0x1234, 1, report);
+    TEST_ASSERT_EQUAL_STRING("{\"t\":0,\"cmd\":[2,\"NEXT\",-80],\"hid\":[1,4660,1,\"024f000000\"]}", send_frame(0));
+}
+
+void test_clients_track_versions_independently(void)
+{
+    ws_telemetry_client_t other;
+    ws_telemetry_client_init(&other, 8, 250, MIN_INTERVAL_MS);
+
+    ws_telemetry_set_battery(&state, 90, false);
+    send_frame(0);
+    ws_telemetry_set_usb(&state, true);
+
+    // The second client never got a frame: it still needs both topics
+    size_t len = ws_telemetry_encode(&state, &other, 500, frame, sizeof(frame) - 1);
+    frame[len] = '\0';
+    TEST_ASSERT_EQUAL_STRING("{\"t\":500,\"bat\":[90,false],\"usb\":true}", frame);
+    TEST_ASSERT_EQUAL_STRING("{\"t\":500,\"usb\":true}", send_frame(500));
+}
+
+void test_strings_are_escaped_and_frames_fit(void)
+{
+    ws_telemetry_set_battery(&state, 255, true);
+    ws_telemetry_set_usb(&state, true);
+    ws_telemetry_set_lora(&state, false, -128);
+    ws_telemetry_set_mode(&state, "PRESENTER");
+    ws_telemetry_set_ota(&state, 100, "\"\\\x01\x02\x03\x04\x05\x06\x07\x08\x09\x0a\x0b\x0c\x0d\x0e\x0f"
+                                      "\x10\x11\x12\x13\x14\x15\x16\x17\x18\x19\x1a\x1b\x1c\x1d\x1e\x1f");
+    ws_telemetry_add_lora_command(&state, "\x01\x02\x03\x04\x05\x06\x07\x08\x0b\x0c\x0e\x0f\x10\x11\x12", -128);
+    ws_telemetry_add_hid_report(&state, 0xffff, 255, (const uint8_t[5]){0xff, 0xff, 0xff, 0xff, 0xff});
+    client.skipped = UINT32_MAX;
+
+    size_t len = ws_telemetry_encode(&state, &client, UINT32_MAX, frame, sizeof(frame));
+    TEST_ASSERT_GREATER_THAN(0, len);
+    TEST_ASSERT_LESS_OR_EQUAL(WS_TELEMETRY_FRAME_MAX, len);
+    TEST_ASSERT_NOT_NULL(memchr(frame, '\\', len));
+
+    TEST_ASSERT_EQUAL(0, ws_telemetry_encode(&state, &client, 0, frame, 16)); // Too small: nothing
+}
@@ -2,11 +2,11 @@ import pytest
 
 DOCUMENTED_METHODS = [
     "ping", "device:info", "general:get", "general:set",
-    "power:get", "power:set", "lora:get", "lora:set",
+    "power:get", "power:set", "power:stats", "lora:get", "lora:set",
     "lora:bands", "lora:key:get", "lora:key:set",
     "lora:presets:list", "lora:presets:set",
     "paired:list", "paired:pair", "paired:unpair",
-    "device:reset", "firmware:upgrade",
+    "device:reset", "firmware:upgrade", "ota:resume", "system:bootTrace",
 ]
 
 @pytest.mark.parametrize("method", DOCUMENTED_METHODS)
@@ -20,6 +20,25 @@ def test_method_exists(rpc_client, method):
         # -32601 is Method not found
         assert resp["error"]["code"] != -32601, f"Method {method} not implemented"
 
+def test_power_stats(rpc_client):
+    resp = rpc_client("power:stats")
+    assert "result" in resp
+    res = resp["result"]
+    for component in ("cpu", "radio", "display", "led"):
+        assert component in res["components"]
+        assert "residency_ms" in res["components"][component]
+    assert "projected_battery_hours" in res
+
+def test_boot_trace(rpc_client):
+    resp = rpc_client("system:bootTrace")
+    assert "result" in resp
+    res = resp["result"]
+    assert len(res["traceEvents"]) > 0
+    for event in res["traceEvents"]:
+        assert event["ph"] in ("X", "i")
+        assert "ts" in event
+    assert res["otherData"]["lora_ready_us"] > 0
+
 def test_ping(rpc_client):
     resp = rpc_client("ping")
     assert resp.get("result") == "pong"
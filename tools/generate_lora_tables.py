@@ -0,0 +1,240 @@
+#!/usr/bin/env python3
+"""
+Generates const C tables from lora_regulatory.json
+Replaces the cJSON parse in lora_regulatory_init(): hardware profiles, regions and
+compliance rules land in flash together with a region index sorted by id and a
+frequency index of disjoint segments, so lookups are binary searches
+
+Usage:
+    generate_lora_tables.py <lora_regulatory.json> <lora_tables.c> [--canonical <header.h>]
+
+--canonical additionally writes LORA_TABLES_CANONICAL_JSON, the JSON fields the tables
+carry in a fixed compact form, for the host round-trip test
+"""
+
+import argparse
+import json
+import sys
+from pathlib import Path
+
+INT8_RANGE = (-128, 127)
+
+
+class TableError(Exception):
+    pass
+
+
+def c_string(value):
+    """C string literal, non-ASCII as octal escapes of the UTF-8 bytes"""
+    out = []
+    for byte in value.encode('utf-8'):
+        ch = chr(byte)
+        if ch in '"\\':
+            out.append('\\' + ch)
+        elif 0x20 <= byte < 0x7f:
+            out.append(ch)
+        else:
+            out.append(f'\\{byte:03o}')
+    return '"' + ''.join(out) + '"'
+
+
+def require(entry, key, kind, where):
+    value = entry.get(key)
+    if not isinstance(value, kind) or isinstance(value, bool) != (kind is bool):
+        raise TableError(f"{where}: '{key}' missing or not {kind.__name__}")
+    return value
+
+
+def load_tables(path):
+    """Parse and validate; returns (hardware, regions, compliance) in JSON order"""
+    with open(path, encoding='utf-8') as f:
+        root = json.load(f)
+
+    hardware = []
+    for i, hw in enumerate(root.get('hardware', [])):
+        where = f'hardware[{i}]'
+        hardware.append({
+            'id': require(hw, 'id', str, where),
+            'name': require(hw, 'name', str, where),
+            'freq_min_khz': require(hw, 'freq_min_khz', int, where),
+            'freq_max_khz': require(hw, 'freq_max_khz', int, where),
+            'optimal_khz': require(hw, 'optimal_khz', int, where),
+        })
+        if not hardware[-1]['freq_min_khz'] <= hardware[-1]['optimal_khz'] <= hardware[-1]['freq_max_khz']:
+            raise TableError(f'{where}: optimal_khz outside freq_min_khz..freq_max_khz')
+
+    regions = []
+    for i, region in enumerate(root.get('regions', [])):
+        where = f'regions[{i}]'
+        regions.append({
+            'id': require(region, 'id', str, where),
+            'name': require(region, 'name', str, where),
+        })
+
+    for kind, entries in (('hardware', hardware), ('region', regions)):
+        ids = [e['id'] for e in entries]
+        dupes = sorted({i for i in ids if ids.count(i) > 1})
+        if dupes:
+            raise TableError(f"duplicate {kind} id(s): {', '.join(dupes)}")
+
+    hw_by_id = {hw['id']: hw for hw in hardware}
+    region_ids = {r['id'] for r in regions}
+    compliance = []
+    for i, rule in enumerate(root.get('compliance', [])):
+        where = f'compliance[{i}]'
+        entry = {
+            'region': require(rule, 'region', str, where),
+            'hardware': require(rule, 'hardware', str, where),
+            'freq_min_khz': require(rule, 'freq_min_khz', int, where),
+            'freq_max_khz': require(rule, 'freq_max_khz', int, where),
+            'max_power_dbm': require(rule, 'max_power_dbm', int, where),
+            'duty_cycle_percent': rule.get('duty_cycle_percent', 0),
+            'fhss_required': rule.get('fhss_required', False) is True,
+            'lbt_required': rule.get('lbt_required', False) is True,
+        }
+        if entry['region'] not in region_ids:
+            raise TableError(f"{where}: unknown region '{entry['region']}'")
+        hw = hw_by_id.get(entry['hardware'])
+        if hw is None:
+            raise TableError(f"{where}: unknown hardware '{entry['hardware']}'")
+        if not hw['freq_min_khz'] <= entry['freq_min_khz'] <= entry['freq_max_khz'] <= hw['freq_max_khz']:
+            raise TableError(f"{where}: frequency range outside {hw['id']}")
+        if not INT8_RANGE[0] <= entry['max_power_dbm'] <= INT8_RANGE[1]:
+            raise TableError(f'{where}: max_power_dbm does not fit int8_t')
+        if not isinstance(entry['duty_cycle_percent'], int) or not 0 <= entry['duty_cycle_percent'] <= 100:
+            raise TableError(f'{where}: duty_cycle_percent must be 0..100')
+        compliance.append(entry)
+
+    if not hardware or not regions or not compliance:
+        raise TableError('need at least one hardware profile, region and compliance rule')
+    if len(hardware) > 255 or len(regions) > 255 or len(compliance) > 255:
+        raise TableError('table indexes are uint8_t, at most 255 entries per table')
+    return hardware, regions, compliance
+
+
+def frequency_segments(hardware):
+    """Disjoint [min, max] kHz segments mapped to the first profile (JSON order) covering them"""
+    edges = sorted({hw['freq_min_khz'] for hw in hardware} | {hw['freq_max_khz'] + 1 for hw in hardware})
+    segments = []
+    for start, end in zip(edges, edges[1:]):
+        owner = next((i for i, hw in enumerate(hardware)
+                      if hw['freq_min_khz'] <= start and end - 1 <= hw['freq_max_khz']), None)
+        if owner is None:
+            continue
+        if segments and segments[-1][2] == owner and segments[-1][1] + 1 == start:
+            segments[-1][1] = end - 1
+        else:
+            segments.append([start, end - 1, owner])
+    return segments
+
+
+def region_slots(regions, compliance):
+    """Regions sorted by id, each with its slice of compliance rule indexes (JSON order kept)"""
+    rule_index = []
+    slots = []
+    for region_idx, region in sorted(enumerate(regions), key=lambda r: r[1]['id'].encode('utf-8')):
+        first = len(rule_index)
+        rule_index.extend(i for i, rule in enumerate(compliance) if rule['region'] == region['id'])
+        slots.append((region['id'], region_idx, first, len(rule_index) - first))
+    return slots, rule_index
+
+
+def render_tables(source_name, hardware, regions, compliance):
+    segments = frequency_segments(hardware)
+    slots, rule_index = region_slots(regions, compliance)
+    bool_c = {True: 'true', False: 'false'}
+
+    lines = [
+        '/**',
+        ' * @file lora_tables.c',
+        f' * @brief LoRa regulatory tables generated from {source_name}',
+        ' *',
+        ' * Generated by tools/generate_lora_tables.py during the build. Do not edit;',
+        f' * change {source_name} instead.',
+        ' */',
+        '',
+        '#include "lora_tables.h"',
+        '',
+        'const lora_hardware_t lora_hardware_table[] = {',
+    ]
+    for hw in hardware:
+        lines.append(f"    {{{c_string(hw['id'])}, {c_string(hw['name'])}, {hw['freq_min_khz']}, "
+                     f"{hw['freq_max_khz']}, {hw['optimal_khz']}}},")
+    lines += ['};', f'const int lora_hardware_count = {len(hardware)};', '']
+
+    lines.append('const lora_freq_segment_t lora_freq_index[] = {')
+    for start, end, owner in segments:
+        lines.append(f'    {{{start}, {end}, {owner}}}, // {hardware[owner]["id"]}')
+    lines += ['};', f'const int lora_freq_index_count = {len(segments)};', '']
+
+    lines.append('const lora_region_t lora_region_table[] = {')
+    for region in regions:
+        lines.append(f"    {{{c_string(region['id'])}, {c_string(region['name'])}}},")
+    lines += ['};', f'const int lora_region_count = {len(regions)};', '']
+
+    lines.append('const lora_region_slot_t lora_region_index[] = {')
+    for region_id, region_idx, first, count in slots:
+        lines.append(f'    {{{c_string(region_id)}, {region_idx}, {first}, {count}}},')
+    lines += ['};', '']
+
+    lines.append('const lora_compliance_t lora_compliance_table[] = {')
+    for rule in compliance:
+        lines.append(f"    {{{c_string(rule['region'])}, {c_string(rule['hardware'])}, {rule['freq_min_khz']}, "
+                     f"{rule['freq_max_khz']}, {rule['max_power_dbm']}, {rule['duty_cycle_percent']}, "
+                     f"{bool_c[rule['fhss_required']]}, {bool_c[rule['lbt_required']]}}},")
+    lines += ['};', f'const int lora_compliance_count = {len(compliance)};', '']
+
+    lines.append('const uint8_t lora_compliance_by_region[] = {')
+    lines.append('    ' + ', '.join(str(i) for i in rule_index) + ',')
+    lines += ['};', '']
+    return '\n'.join(lines)
+
+
+def render_canonical(hardware, regions, compliance):
+    canonical = json.dumps({'hardware': hardware, 'regions': regions, 'compliance': compliance},
+                           separators=(',', ':'), ensure_ascii=False)
+    return '\n'.join([
+        '/**',
+        ' * @file lora_tables_canonical.h',
+        ' * @brief lora_regulatory.json fields carried by lora_tables.c, compact and in table order',
+        ' *',
+        ' * Generated by tools/generate_lora_tables.py --canonical for the host round-trip test.',
+        ' */',
+        '',
+        '#pragma once',
+        '',
+        f'#define LORA_TABLES_CANONICAL_JSON {c_string(canonical)}',
+        '',
+    ])
+
+
+def write_if_changed(path, content):
+    """Leave the file alone when unchanged so dependents are not rebuilt"""
+    path = Path(path)
+    if path.exists() and path.read_text(encoding='utf-8') == content:
+        return
+    path.parent.mkdir(parents=True, exist_ok=True)
+    path.write_text(content, encoding='utf-8')
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Generate LoRa regulatory C tables')
+    parser.add_argument('json', help='lora_regulatory.json')
+    parser.add_argument('output', help='Generated lora_tables.c')
+    parser.add_argument('--canonical', help='Also write the canonical JSON header for host tests')
+    args = parser.parse_args()
+
+    try:
+        hardware, regions, compliance = load_tables(args.json)
+    except (OSError, ValueError, TableError) as e:
+        print(f'generate_lora_tables: {args.json}: {e}', file=sys.stderr)
+        return 1
+
+    write_if_changed(args.output, render_tables(Path(args.json).name, hardware, regions, compliance))
+    if args.canonical:
+        write_if_changed(args.canonical, render_canonical(hardware, regions, compliance))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,130 @@
+#!/usr/bin/env python3
+"""
+Generates the perfect hash over the built-in JSON-RPC method names
+Reads the names from method_table in rpc_schema.c and searches for a seed under which
+rpc_method_hash() maps every name to its own slot, so dispatch is one hash, one table
+read and one string compare
+
+Usage:
+    generate_rpc_hash.py <rpc_schema.c> <rpc_method_hash.h>
+"""
+
+import argparse
+import re
+import sys
+from pathlib import Path
+
+MAX_SEEDS = 1 << 20
+MAX_SLOTS = 255  # Slots are uint8_t method ids, 0xFF (RPC_METHOD_NONE) marks an empty one
+MASK32 = 0xFFFFFFFF
+
+TABLE_RE = re.compile(r'method_table\[RPC_METHOD_COUNT\]\s*=\s*\{(.*?)\n\};', re.S)
+ENTRY_RE = re.compile(r'\[(RPC_METHOD_\w+)\]\s*=\s*[^"\[]*"([^"]*)"')
+
+
+class HashError(Exception):
+    pass
+
+
+def method_hash(seed, name):
+    """rpc_method_hash() in rpc_schema.c: seeded FNV-1a with a final mix"""
+    h = 2166136261 ^ seed
+    for byte in name.encode('utf-8'):
+        h = ((h ^ byte) * 16777619) & MASK32
+    h ^= h >> 16
+    h = (h * 0x7FEB352D) & MASK32
+    h ^= h >> 15
+    return h
+
+
+def load_methods(path):
+    """(enum constant, name) pairs in table order"""
+    source = Path(path).read_text(encoding='utf-8')
+    table = TABLE_RE.search(source)
+    if not table:
+        raise HashError('method_table[RPC_METHOD_COUNT] not found')
+    methods = ENTRY_RE.findall(table.group(1))
+    if not methods:
+        raise HashError('method_table has no entries')
+
+    names = [name for _, name in methods]
+    dupes = sorted({name for name in names if names.count(name) > 1})
+    if dupes:
+        raise HashError(f"duplicate method name(s): {', '.join(dupes)}")
+    return methods
+
+
+def find_seed(methods):
+    """Smallest power-of-two table, then the first seed without collisions"""
+    slots = 1
+    while slots < len(methods):
+        slots *= 2
+    while slots <= MAX_SLOTS:
+        for seed in range(MAX_SEEDS):
+            used = {method_hash(seed, name) & (slots - 1) for _, name in methods}
+            if len(used) == len(methods):
+                return seed, slots
+        slots *= 2
+    raise HashError(f'no perfect hash for {len(methods)} names within {MAX_SLOTS} slots')
+
+
+def render_header(source_name, methods, seed, slots):
+    table = ['RPC_METHOD_NONE'] * slots
+    for constant, name in methods:
+        table[method_hash(seed, name) & (slots - 1)] = constant
+
+    lines = [
+        '/**',
+        ' * @file rpc_method_hash.h',
+        f' * @brief Perfect hash over the method names in {source_name}',
+        ' *',
+        ' * Generated by tools/generate_rpc_hash.py during the build. Do not edit;',
+        f' * change method_table in {source_name} instead. Included by rpc_schema.c only.',
+        ' */',
+        '',
+        '#pragma once',
+        '',
+        f'#define RPC_METHOD_HASH_SLOTS {slots}',
+        '',
+        f'static const uint32_t rpc_method_hash_seed = 0x{seed:08X}u;',
+        '',
+        'static const uint8_t rpc_method_hash_slots[RPC_METHOD_HASH_SLOTS] = {',
+    ]
+    lines += [f'    {constant},' for constant in table]
+    lines += [
+        '};',
+        '',
+        f'_Static_assert(RPC_METHOD_COUNT == {len(methods)}, "rpc_method_hash.h is stale: regenerate it");',
+        '',
+    ]
+    return '\n'.join(lines)
+
+
+def write_if_changed(path, content):
+    """Leave the file alone when unchanged so dependents are not rebuilt"""
+    path = Path(path)
+    if path.exists() and path.read_text(encoding='utf-8') == content:
+        return
+    path.parent.mkdir(parents=True, exist_ok=True)
+    path.write_text(content, encoding='utf-8')
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Generate the JSON-RPC method perfect hash')
+    parser.add_argument('schema', help='rpc_schema.c')
+    parser.add_argument('output', help='Generated rpc_method_hash.h')
+    args = parser.parse_args()
+
+    try:
+        methods = load_methods(args.schema)
+        seed, slots = find_seed(methods)
+    except (OSError, HashError) as e:
+        print(f'generate_rpc_hash: {args.schema}: {e}', file=sys.stderr)
+        return 1
+
+    write_if_changed(args.output, render_header(Path(args.schema).name, methods, seed, slots))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
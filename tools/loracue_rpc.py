@@ -0,0 +1,421 @@
+#!/usr/bin/env python3
+"""
+Host side of the LoRaCue management RPC, as JSON lines or binary frames
+A binary frame is 0x00, COBS(CBOR request + CRC-16/CCITT-FALSE big-endian), 0x00;
+requests are [id, method, params], responses [id, 0, result] or [id, code, message].
+Both formats share one serial port, the device picks per message (see rpc_frame.h)
+
+Usage:
+    loracue_rpc.py <port> call <method> [params-json] [--binary]
+    loracue_rpc.py <port> methods
+    loracue_rpc.py <port> bench [--count N] [--method M] [--params JSON]
+    loracue_rpc.py <port> upload <firmware.bin> [--signature FILE]
+
+methods lists what the device serves (rpc:listMethods), including methods other
+components registered, with their params and auth/long-running/link metadata
+
+bench runs the same request N times in each format and prints bytes on the wire and
+round trips per second; requires pyserial
+
+upload sends a signed image over USB CDC (firmware:upgrade, then firmware:bulk): CRC-checked
+chunks with a window of them in flight, resent from the device's NAK (see ota_bulk.h). The
+signature defaults to <firmware.bin>.sig from scripts/sign_firmware.py; the device reboots
+into the new image when it verifies. A .lcz container from sign_firmware.py --compress is sent
+as is and inflated on the device, a .lcd patch from make_delta.py is applied against the
+running image; either uses the .sig of the image it produces (<file> without the suffix).
+A raw image starts with ota:resume: after a dropped upload of the same image the device
+reports how much it already has and only the rest is sent
+"""
+
+import argparse
+import hashlib
+import json
+import struct
+import sys
+import time
+import zlib
+from pathlib import Path
+
+FRAME_DELIMITER = 0x00
+
+OTA_CHUNK_MAGIC = 0xB7
+OTA_STATUS_MAGIC = 0xB8
+OTA_STATUS_SIZE = 12
+OTA_FLAG_LAST = 0x01
+OTA_CONTAINER_MAGIC = b'LCZ1'  # sign_firmware.py --compress, see ota_decompress.h
+OTA_DELTA_MAGIC = b'LCD1'  # make_delta.py, see ota_delta.h
+OTA_RETRANSMIT_TIMEOUT = 2.0  # Seconds without an ACK before resending the window
+
+
+class RpcError(Exception):
+    pass
+
+
+# ---------------------------------------------------------------------------
+# CBOR (the JSON data model only, as the device accepts it)
+# ---------------------------------------------------------------------------
+
+def _cbor_head(major, value):
+    if value < 24:
+        return bytes([major << 5 | value])
+    for info, fmt in ((24, '>B'), (25, '>H'), (26, '>I'), (27, '>Q')):
+        if value < 1 << (8 * struct.calcsize(fmt)):
+            return bytes([major << 5 | info]) + struct.pack(fmt, value)
+    raise RpcError(f'integer out of range: {value}')
+
+
+def cbor_encode(value):
+    if value is None:
+        return b'\xf6'
+    if value is True:
+        return b'\xf5'
+    if value is False:
+        return b'\xf4'
+    if isinstance(value, int):
+        return _cbor_head(0, value) if value >= 0 else _cbor_head(1, -1 - value)
+    if isinstance(value, float):
+        return b'\xfb' + struct.pack('>d', value)
+    if isinstance(value, str):
+        data = value.encode('utf-8')
+        return _cbor_head(3, len(data)) + data
+    if isinstance(value, (list, tuple)):
+        return _cbor_head(4, len(value)) + b''.join(cbor_encode(v) for v in value)
+    if isinstance(value, dict):
+        return _cbor_head(5, len(value)) + b''.join(cbor_encode(str(k)) + cbor_encode(v) for k, v in value.items())
+    raise RpcError(f'cannot encode {type(value).__name__}')
+
+
+def _cbor_decode(data, pos):
+    if pos >= len(data):
+        raise RpcError('truncated CBOR')
+    initial = data[pos]
+    major, info = initial >> 5, initial & 0x1F
+    pos += 1
+
+    if major == 7:
+        simple = {20: False, 21: True, 22: None, 23: None}
+        if info in simple:
+            return simple[info], pos
+        formats = {25: ('>e', 2), 26: ('>f', 4), 27: ('>d', 8)}
+        if info not in formats:
+            raise RpcError(f'unsupported CBOR simple value {info}')
+        fmt, size = formats[info]
+        return struct.unpack(fmt, data[pos:pos + size])[0], pos + size
+
+    if info == 31:
+        if major not in (4, 5):
+            raise RpcError('indefinite string')
+        items = []
+        while data[pos] != 0xFF:
+            item, pos = _cbor_decode(data, pos)
+            items.append(item)
+        pos += 1
+        return (items if major == 4 else dict(zip(items[::2], items[1::2]))), pos
+
+    if info < 24:
+        arg = info
+    elif info <= 27:
+        size = 1 << (info - 24)
+        arg = int.from_bytes(data[pos:pos + size], 'big')
+        pos += size
+    else:
+        raise RpcError('malformed CBOR head')
+
+    if major == 0:
+        return arg, pos
+    if major == 1:
+        return -1 - arg, pos
+    if major == 3:
+        return data[pos:pos + arg].decode('utf-8'), pos + arg
+    if major == 4:
+        items = []
+        for _ in range(arg):
+            item, pos = _cbor_decode(data, pos)
+            items.append(item)
+        return items, pos
+    if major == 5:
+        result = {}
+        for _ in range(arg):
+            key, pos = _cbor_decode(data, pos)
+            result[key], pos = _cbor_decode(data, pos)
+        return result, pos
+    raise RpcError(f'unsupported CBOR major type {major}')
+
+
+def cbor_decode(data):
+    value, pos = _cbor_decode(data, 0)
+    if pos != len(data):
+        raise RpcError('trailing bytes after CBOR item')
+    return value
+
+
+# ---------------------------------------------------------------------------
+# Framing
+# ---------------------------------------------------------------------------
+
+def crc16(data, crc=0xFFFF):
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) & 0xFFFF if crc & 0x8000 else (crc << 1) & 0xFFFF
+    return crc
+
+
+def cobs_encode(data):
+    out = bytearray([0])
+    code_pos = 0
+    for byte in data:
+        if len(out) - code_pos == 255:
+            out[code_pos] = 255
+            code_pos = len(out)
+            out.append(0)
+        if byte == 0:
+            out[code_pos] = len(out) - code_pos
+            code_pos = len(out)
+            out.append(0)
+        else:
+            out.append(byte)
+    out[code_pos] = len(out) - code_pos
+    return bytes(out)
+
+
+def cobs_decode(data):
+    out = bytearray()
+    pos = 0
+    while pos < len(data):
+        code = data[pos]
+        if code == 0 or pos + code > len(data):
+            raise RpcError('malformed COBS block')
+        out += data[pos + 1:pos + code]
+        pos += code
+        if code != 255 and pos < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def encode_frame(payload):
+    body = payload + struct.pack('>H', crc16(payload))
+    return bytes([FRAME_DELIMITER]) + cobs_encode(body) + bytes([FRAME_DELIMITER])
+
+
+def decode_frame(encoded):
+    body = cobs_decode(encoded)
+    if len(body) < 2 or crc16(body[:-2]) != struct.unpack('>H', body[-2:])[0]:
+        raise RpcError('frame CRC mismatch')
+    return body[:-2]
+
+
+# ---------------------------------------------------------------------------
+# Transport
+# ---------------------------------------------------------------------------
+
+class Client:
+    def __init__(self, port, baudrate=460800, timeout=5.0):
+        try:
+            import serial
+        except ImportError:
+            sys.exit('pyserial is required: pip install pyserial')
+        self.serial = serial.Serial(port, baudrate, timeout=timeout)
+        self.timeout = timeout
+        self.status_buf = bytearray()
+        self.next_id = 1
+        self.tx_bytes = 0
+        self.rx_bytes = 0
+
+    def _read_until(self, terminators):
+        data = bytearray()
+        while True:
+            byte = self.serial.read(1)
+            if not byte:
+                raise RpcError('timeout waiting for response')
+            self.rx_bytes += 1
+            if byte[0] in terminators:
+                return bytes(data)
+            data += byte
+
+    def read_ota_status(self, timeout):
+        """Status records received so far, as (type, seq, value); log text around them is skipped"""
+        self.serial.timeout = timeout
+        data = self.serial.read(max(1, self.serial.in_waiting))
+        self.serial.timeout = self.timeout
+        self.rx_bytes += len(data)
+        self.status_buf += data
+
+        records = []
+        while True:
+            start = self.status_buf.find(bytes([OTA_STATUS_MAGIC]))
+            if start < 0:
+                self.status_buf.clear()
+                break
+            del self.status_buf[:start]
+            if len(self.status_buf) < OTA_STATUS_SIZE:
+                break
+            record = bytes(self.status_buf[:OTA_STATUS_SIZE])
+            _, kind, seq, value, crc = struct.unpack('<BBHiI', record)
+            if zlib.crc32(record[:8]) != crc:
+                del self.status_buf[:1]
+                continue
+            del self.status_buf[:OTA_STATUS_SIZE]
+            records.append((chr(kind), seq, value))
+        return records
+
+    def call_json(self, method, params=None):
+        request = {'jsonrpc': '2.0', 'id': self.next_id, 'method': method}
+        if params is not None:
+            request['params'] = params
+        self.next_id += 1
+        line = json.dumps(request, separators=(',', ':')).encode('utf-8') + b'\n'
+        self.serial.write(line)
+        self.tx_bytes += len(line)
+        while True:
+            response = self._read_until(b'\r\n')
+            if response.startswith(b'{'):
+                break
+        response = json.loads(response)
+        if 'error' in response:
+            raise RpcError(f"{response['error']['code']}: {response['error']['message']}")
+        return response.get('result')
+
+    def call_binary(self, method, params=None):
+        request = [self.next_id, method] + ([params] if params is not None else [])
+        self.next_id += 1
+        frame = encode_frame(cbor_encode(request))
+        self.serial.write(frame)
+        self.tx_bytes += len(frame)
+        while True:
+            self._read_until(bytes([FRAME_DELIMITER]))  # Skip to the opening delimiter
+            encoded = self._read_until(bytes([FRAME_DELIMITER]))
+            if encoded:
+                break
+        _, code, result = cbor_decode(decode_frame(encoded))
+        if code != 0:
+            raise RpcError(f'{code}: {result}')
+        return result
+
+
+def bench(client, method, params, count):
+    results = {}
+    for name, call in (('json', client.call_json), ('binary', client.call_binary)):
+        client.tx_bytes = client.rx_bytes = 0
+        start = time.perf_counter()
+        for _ in range(count):
+            call(method, params)
+        elapsed = time.perf_counter() - start
+        results[name] = (client.tx_bytes / count, client.rx_bytes / count, count / elapsed)
+        print(f'[BENCH][loracue_rpc] {method} {name:6s} req {results[name][0]:6.1f} B, '
+              f'resp {results[name][1]:7.1f} B, {results[name][2]:7.1f} req/s')
+    json_rate, binary_rate = results['json'][2], results['binary'][2]
+    print(f'binary/json throughput: {binary_rate / json_rate:.2f}x')
+
+
+def ota_chunk(seq, payload, flags=0):
+    body = struct.pack('<BBHHH', OTA_CHUNK_MAGIC, flags, seq, len(payload), 0) + payload
+    return body + struct.pack('<I', zlib.crc32(body))
+
+
+def upload(client, path, signature_path=None):
+    image = Path(path).read_bytes()
+    if not image:
+        raise RpcError(f'{path} is empty')
+    if image[:4] in (OTA_CONTAINER_MAGIC, OTA_DELTA_MAGIC):
+        # size is what crosses the link; sha256 and signature are of the image it produces
+        sha256 = (image[12:44] if image[:4] == OTA_CONTAINER_MAGIC else image[48:80]).hex()
+        signature_path = signature_path or f'{Path(path).with_suffix("")}.sig'
+    else:
+        sha256 = hashlib.sha256(image).hexdigest()
+    signature = Path(signature_path or f'{path}.sig').read_text(encoding='utf-8').strip()
+    params = {'size': len(image), 'sha256': sha256, 'signature': signature}
+    try:
+        offset = client.call_json('ota:resume', params)['offset']
+    except RpcError as e:
+        if not str(e).startswith('-32601:'):
+            raise
+        client.call_json('firmware:upgrade', params)  # Firmware from before ota:resume
+        offset = 0
+    if offset:
+        print(f'Resuming at {offset} of {len(image)} bytes', file=sys.stderr)
+    rest = image[offset:]
+    session = client.call_json('firmware:bulk')
+    size, window = session['chunk'], session['window']
+    # An empty LAST chunk still makes the device finish when it already has every byte
+    chunks = [rest[i:i + size] for i in range(0, len(rest), size)] or [b'']
+    if len(chunks) > 0xFFFF:
+        raise RpcError('image needs more chunks than sequence numbers')
+
+    acked = sent = resent = 0
+    start = last_ack = time.perf_counter()
+    while True:
+        # Go-back-N: keep the window full; a NAK or a silent device rewinds to the first unwritten chunk
+        while sent < len(chunks) and sent - acked < window:
+            flags = OTA_FLAG_LAST if sent == len(chunks) - 1 else 0
+            client.serial.write(ota_chunk(sent, chunks[sent], flags))
+            sent += 1
+
+        for kind, seq, value in client.read_ota_status(0.1 if sent - acked >= window else 0):
+            if kind == 'A' and seq > acked:
+                acked, last_ack = seq, time.perf_counter()
+                print(f'\r{acked * 100 // len(chunks):3d}% ', end='', file=sys.stderr, flush=True)
+            elif kind == 'N':
+                resent += sent - seq
+                sent = seq
+            elif kind == 'D' and value == 0:
+                elapsed = time.perf_counter() - start
+                print(f'\n[BENCH][loracue_rpc] upload {len(rest)} B in {elapsed:.2f} s, '
+                      f'{len(rest) / 1024 / elapsed:.1f} KiB/s, {resent} chunks resent; device is rebooting')
+                return
+            elif kind in 'DE':
+                raise RpcError(f'upload failed on the device: esp_err 0x{value & 0xFFFFFFFF:x}')
+
+        if acked < len(chunks) and time.perf_counter() - last_ack > OTA_RETRANSMIT_TIMEOUT:
+            resent += sent - acked
+            sent, last_ack = acked, time.perf_counter()
+
+
+def print_methods(methods):
+    for method in methods:
+        tags = [tag for tag in ('auth', 'long_running') if method.get(tag)]
+        params = ', '.join(f"{p['name']}: {p['type']}{'' if p['required'] else '?'}" for p in method['params'])
+        print(f"{method['name']:20s} ({params}) [{', '.join(method['links'])}] {' '.join(tags)}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description='LoRaCue management RPC client (JSON or binary frames)')
+    parser.add_argument('port', help='serial port, e.g. /dev/ttyACM0')
+    parser.add_argument('--baudrate', type=int, default=460800)
+    sub = parser.add_subparsers(dest='command', required=True)
+
+    call = sub.add_parser('call', help='send one request')
+    call.add_argument('method')
+    call.add_argument('params', nargs='?', help='params as JSON')
+    call.add_argument('--binary', action='store_true', help='send as a COBS/CBOR frame')
+
+    sub.add_parser('methods', help='list the methods the device serves')
+
+    run = sub.add_parser('bench', help='compare JSON and binary round trips')
+    run.add_argument('--count', type=int, default=200)
+    run.add_argument('--method', default='paired:list')
+    run.add_argument('--params', help='params as JSON')
+
+    send = sub.add_parser('upload', help='upload signed firmware over USB CDC')
+    send.add_argument('firmware', help='application image (.bin), compressed container (.bin.lcz) or patch (.bin.lcd)')
+    send.add_argument('--signature', help='hex Ed25519 signature file (default: <firmware>.sig)')
+
+    args = parser.parse_args()
+    client = Client(args.port, args.baudrate)
+    try:
+        if args.command == 'call':
+            params = json.loads(args.params) if args.params else None
+            result = (client.call_binary if args.binary else client.call_json)(args.method, params)
+            print(json.dumps(result, indent=2))
+        elif args.command == 'methods':
+            print_methods(client.call_json('rpc:listMethods'))
+        elif args.command == 'upload':
+            upload(client, args.firmware, args.signature)
+        else:
+            bench(client, args.method, json.loads(args.params) if args.params else None, args.count)
+    except (RpcError, OSError) as e:
+        sys.exit(f'Error: {e}')
+
+
+if __name__ == '__main__':
+    main()
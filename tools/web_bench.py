@@ -0,0 +1,303 @@
+#!/usr/bin/env python3
+"""Page load benchmark for the config server's static file path, against a local stand-in.
+
+Serves a static export the way config_wifi_server.c does, over a throttled link:
+  legacy  fopen probing for SPA routes, 1 KB reads, one chunk per read, no caching headers
+  assets  asset-index.txt lookup, pre-compressed .gz by Accept-Encoding, 8 KB reads,
+          strong ETags with 304, Cache-Control immutable for /_next/static/
+
+A browser-like client then loads a page cold (empty cache) and warm (reload: immutable
+assets come from cache, the rest revalidates with If-None-Match) over six connections.
+
+The link model is a soft-AP phone connection: bandwidth, round trip per request, and a
+per-send and per-open cost standing in for lwIP and LittleFS on the device. The numbers
+compare the two serving paths; they are not a prediction of absolute device timings.
+
+Without --site a synthetic export is built from web-interface/ sources with Next.js-like
+chunk sizes (no npm in CI); the gzip ratio it prints shows how realistic it is.
+
+Usage:
+    web_bench.py [--site web-interface/out] [--kbps 4000] [--rtt-ms 8] [--page /]
+"""
+
+import argparse
+import gzip
+import hashlib
+import http.client
+import random
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+from concurrent.futures import ThreadPoolExecutor
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from pathlib import Path
+
+REPO = Path(__file__).resolve().parent.parent
+INDEX_NAME = 'asset-index.txt'
+LEGACY_READ = 1024
+ASSETS_READ = 8192
+BROWSER_CONNECTIONS = 6
+PAGE_EXTENSIONS = ('.html', '.js', '.css', '.json')
+CONTENT_TYPES = {'.html': 'text/html', '.css': 'text/css', '.js': 'application/javascript',
+                 '.json': 'application/json', '.txt': 'text/plain', '.ico': 'image/x-icon'}
+
+# Typical next build output for a small app: framework and main dominate
+SYNTHETIC_CHUNKS = {'framework': 186_000, 'main': 118_000, 'webpack': 3_500, 'pages/_app': 42_000,
+                    'polyfills': 112_000}
+SYNTHETIC_PAGE_CHUNK = 14_000
+SYNTHETIC_CSS = 28_000
+
+
+class Link:
+    """Shared bottleneck: one radio, so all connections queue on the same byte budget."""
+
+    def __init__(self, kbps: int, send_ms: float, open_ms: float):
+        self.bytes_per_s = kbps * 1000 / 8
+        self.send_s = send_ms / 1000
+        self.open_s = open_ms / 1000
+        self.lock = threading.Lock()
+        self.free_at = 0.0
+
+    def send(self, size: int):
+        with self.lock:
+            start = max(time.monotonic(), self.free_at)
+            self.free_at = start + self.send_s + size / self.bytes_per_s
+            done = self.free_at
+        time.sleep(max(0.0, done - time.monotonic()))
+
+    def open(self):
+        time.sleep(self.open_s)
+
+
+def make_handler(root: Path, mode: str, link: Link, rtt_s: float, index: dict):
+    class Handler(BaseHTTPRequestHandler):
+        protocol_version = 'HTTP/1.1'
+
+        def log_message(self, *args):
+            pass
+
+        def _chunked(self, path: Path, read_size: int):
+            link.open()
+            with open(path, 'rb') as file:
+                while True:
+                    block = file.read(read_size)
+                    if not block:
+                        break
+                    link.send(len(block) + 8)
+                    self.wfile.write(b'%x\r\n%s\r\n' % (len(block), block))
+            link.send(5)
+            self.wfile.write(b'0\r\n\r\n')
+
+        def _headers(self, status: int, headers: dict):
+            self.send_response(status)
+            for name, value in headers.items():
+                self.send_header(name, value)
+            self.end_headers()
+            link.send(200)
+
+        def _not_found(self):
+            self._headers(404, {'Content-Length': '0'})
+
+        def _legacy(self, uri: str):
+            path = root / ('index.html' if uri == '/' else uri.lstrip('/'))
+            link.open()  # fopen() probe
+            if not path.is_file() and not uri.endswith(PAGE_EXTENSIONS):
+                path = path / 'index.html'
+            if not path.is_file():
+                self._not_found()
+                return
+            self._headers(200, {'Content-Type': CONTENT_TYPES.get(path.suffix, 'text/html'),
+                                'Transfer-Encoding': 'chunked'})
+            self._chunked(path, LEGACY_READ)
+
+        def _assets(self, uri: str):
+            key = '/index.html' if uri == '/' else uri
+            if key not in index and not key.endswith(PAGE_EXTENSIONS):
+                key = key.rstrip('/') + '/index.html'
+            if key not in index:
+                self._not_found()
+                return
+            digest, variants = index[key]
+            gz = 'g' in variants and 'gzip' in self.headers.get('Accept-Encoding', '')
+            etag = f'"{digest}-gz"' if gz else f'"{digest}"'
+            headers = {'Content-Type': CONTENT_TYPES.get(Path(key).suffix, 'application/octet-stream'),
+                       'Cache-Control': ('public, max-age=31536000, immutable'
+                                         if key.startswith('/_next/static/') else 'no-cache'),
+                       'ETag': etag}
+            if variants != '-':
+                headers['Vary'] = 'Accept-Encoding'
+            if self.headers.get('If-None-Match') == etag:
+                self._headers(304, {**headers, 'Content-Length': '0'})
+                return
+            if gz:
+                headers['Content-Encoding'] = 'gzip'
+            self._headers(200, {**headers, 'Transfer-Encoding': 'chunked'})
+            self._chunked(root / (key.lstrip('/') + ('.gz' if gz else '')), ASSETS_READ)
+
+        def do_GET(self):  # noqa: N802
+            time.sleep(rtt_s)
+            uri = self.path.split('?', 1)[0]
+            if mode == 'legacy':
+                self._legacy(uri)
+            else:
+                self._assets(uri)
+
+    return Handler
+
+
+class Browser:
+    """Fetches a page and its subresources; keeps an HTTP cache between loads."""
+
+    def __init__(self, port: int):
+        self.port = port
+        self.cache = {}  # uri -> (etag, immutable)
+        self.local = threading.local()
+        self.html = b''
+
+    def _conn(self) -> http.client.HTTPConnection:
+        if not hasattr(self.local, 'conn'):
+            self.local.conn = http.client.HTTPConnection('127.0.0.1', self.port)
+        return self.local.conn
+
+    def get(self, uri: str) -> tuple:
+        cached = self.cache.get(uri)
+        if cached and cached[1]:
+            return 0, b''
+        headers = {'Accept-Encoding': 'gzip, deflate'}
+        if cached:
+            headers['If-None-Match'] = cached[0]
+        conn = self._conn()
+        conn.request('GET', uri, headers=headers)
+        resp = conn.getresponse()
+        body = resp.read()
+        if resp.status == 200 and resp.getheader('ETag'):
+            self.cache[uri] = (resp.getheader('ETag'), 'immutable' in (resp.getheader('Cache-Control') or ''))
+        if resp.getheader('Content-Encoding') == 'gzip':
+            body = gzip.decompress(body)
+        return len(body), body
+
+    def load(self, page: str) -> tuple:
+        start = time.monotonic()
+        _, html = self.get(page)
+        if not html:
+            html = self.html  # 304: the cached copy
+        self.html = html
+        refs = sorted(set(re.findall(rb'(?:src|href)="(/[^"]+)"', html)))
+        with ThreadPoolExecutor(BROWSER_CONNECTIONS) as pool:
+            for _ in pool.map(lambda ref: self.get(ref.decode()), refs):
+                pass
+        return time.monotonic() - start, len(refs) + 1
+
+
+def _mangle(source: str, rng: random.Random) -> str:
+    """Minifier-like text: no comments or indentation, short random identifiers."""
+    source = re.sub(r'/\*.*?\*/|//[^\n]*', '', source, flags=re.S)
+    source = re.sub(r'\s+', ' ', source)
+    names = {}
+
+    def rename(match):
+        word = match.group(0)
+        if word not in names:
+            names[word] = ''.join(rng.choice('abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_$')
+                                  for _ in range(rng.randint(1, 3)))
+        return names[word]
+
+    return re.sub(r'\b[a-z][A-Za-z0-9]{3,}\b', rename, source)
+
+
+def build_synthetic(out: Path):
+    sources = sorted((REPO / 'web-interface').glob('*/*.tsx'))
+    corpus = [p.read_text() for p in sources]
+    rng = random.Random(1)
+
+    def blob(size: int) -> str:
+        text = ''
+        while len(text) < size:
+            text += _mangle(rng.choice(corpus), rng)  # fresh identifiers each round, like distinct modules
+        return text[:size]
+
+    static = out / '_next' / 'static'
+    refs = []
+    for name, size in SYNTHETIC_CHUNKS.items():
+        body = blob(size)
+        path = static / 'chunks' / f'{name}-{hashlib.sha256(body.encode()).hexdigest()[:16]}.js'
+        path.parent.mkdir(parents=True, exist_ok=True)
+        path.write_text(body)
+        refs.append(f'<script src="/{path.relative_to(out).as_posix()}" defer></script>')
+    css = static / 'css' / 'app.css'
+    css.parent.mkdir(parents=True, exist_ok=True)
+    css.write_text(((REPO / 'web-interface/styles/globals.css').read_text() * 40)[:SYNTHETIC_CSS])
+    refs.append('<link rel="stylesheet" href="/_next/static/css/app.css"/>')
+    shutil.copy(REPO / 'web-interface/public/favicon.ico', out / 'favicon.ico')
+    refs.append('<link rel="icon" href="/favicon.ico"/>')
+
+    for page in (REPO / 'web-interface/pages').glob('*.tsx'):
+        if page.stem.startswith('_'):
+            continue
+        chunk = static / 'chunks' / 'pages' / f'{page.stem}-{rng.getrandbits(64):016x}.js'
+        chunk.parent.mkdir(parents=True, exist_ok=True)
+        chunk.write_text(blob(SYNTHETIC_PAGE_CHUNK))
+        html = ('<!DOCTYPE html><html><head>' + ''.join(refs) +
+                f'<script src="/{chunk.relative_to(out).as_posix()}" defer></script></head><body>' +
+                _mangle(page.read_text(), rng)[:6000] + '</body></html>')
+        target = out / 'index.html' if page.stem == 'index' else out / page.stem / 'index.html'
+        target.parent.mkdir(parents=True, exist_ok=True)
+        target.write_text(html)
+
+
+def read_index(root: Path) -> dict:
+    index = {}
+    for line in (root / INDEX_NAME).read_text().splitlines():
+        path, digest, variants = line.split('\t')
+        index[path] = (digest, variants)
+    return index
+
+
+def run(root: Path, mode: str, args) -> tuple:
+    link = Link(args.kbps, args.send_ms, args.open_ms)
+    index = read_index(root) if mode == 'assets' else {}
+    server = ThreadingHTTPServer(('127.0.0.1', 0), make_handler(root, mode, link, args.rtt_ms / 1000, index))
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+    try:
+        browser = Browser(server.server_address[1])
+        cold = browser.load(args.page)
+        warm = browser.load(args.page)
+        return cold, warm
+    finally:
+        server.shutdown()
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__.split('\n', 1)[0])
+    parser.add_argument('--site', type=Path, help='static export (default: synthetic)')
+    parser.add_argument('--page', default='/')
+    parser.add_argument('--kbps', type=int, default=4000, help='link bandwidth, kbit/s')
+    parser.add_argument('--rtt-ms', type=float, default=8.0, help='round trip per request')
+    parser.add_argument('--send-ms', type=float, default=0.4, help='cost per send on the device')
+    parser.add_argument('--open-ms', type=float, default=2.0, help='cost per LittleFS open')
+    args = parser.parse_args()
+
+    with tempfile.TemporaryDirectory() as tmp:
+        root = Path(tmp) / 'out'
+        if args.site:
+            shutil.copytree(args.site, root)
+        else:
+            build_synthetic(root)
+        subprocess.run([sys.executable, str(REPO / 'scripts/precompress_web.py'), str(root)], check=True)
+
+        print(f'link {args.kbps} kbit/s, rtt {args.rtt_ms} ms, send {args.send_ms} ms, open {args.open_ms} ms')
+        results = {mode: run(root, mode, args) for mode in ('legacy', 'assets')}
+        for mode, ((cold_s, requests), (warm_s, _)) in results.items():
+            print(f'{mode:7} cold {cold_s * 1000:7.0f} ms  warm {warm_s * 1000:7.0f} ms  ({requests} requests)')
+        (legacy_cold, _), (legacy_warm, _) = results['legacy']
+        (assets_cold, _), (assets_warm, _) = results['assets']
+        print(f'speedup cold {legacy_cold / assets_cold:.1f}x, warm {legacy_warm / assets_warm:.1f}x')
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,71 @@
+import { useEffect, useState } from 'react'
+
+// Frame format: components/config_wifi_server/include/ws_telemetry.h
+export interface Telemetry {
+  connected: boolean
+  uptimeMs?: number
+  battery?: { level: number; charging: boolean }
+  usb?: boolean
+  lora?: { connected: boolean; rssi: number }
+  mode?: string
+  ota?: { percent: number; status: string }
+  loraCommand?: { count: number; command: string; rssi: number }
+  hid?: { count: number; deviceId: number; type: number; report: string }
+}
+
+const RECONNECT_MIN_MS = 1000
+const RECONNECT_MAX_MS = 10000
+
+function merge(state: Telemetry, frame: any): Telemetry {
+  const next: Telemetry = { ...state, connected: true, uptimeMs: frame.t }
+  if (frame.bat) next.battery = { level: frame.bat[0], charging: frame.bat[1] }
+  if ('usb' in frame) next.usb = frame.usb
+  if (frame.lora) next.lora = { connected: frame.lora[0], rssi: frame.lora[1] }
+  if ('mode' in frame) next.mode = frame.mode
+  if (frame.ota) next.ota = { percent: frame.ota[0], status: frame.ota[1] }
+  if (frame.cmd) next.loraCommand = { count: frame.cmd[0], command: frame.cmd[1], rssi: frame.cmd[2] }
+  if (frame.hid) next.hid = { count: frame.hid[0], deviceId: frame.hid[1], type: frame.hid[2], report: frame.hid[3] }
+  return next
+}
+
+// Live device state pushed by the config server; frames carry only what changed, so they are merged
+export function useTelemetry(intervalMs?: number): Telemetry {
+  const [telemetry, setTelemetry] = useState<Telemetry>({ connected: false })
+
+  useEffect(() => {
+    let socket: WebSocket | null = null
+    let retry: ReturnType<typeof setTimeout> | undefined
+    let delay = RECONNECT_MIN_MS
+    let closed = false
+
+    const connect = () => {
+      const query = intervalMs ? `?interval=${intervalMs}` : ''
+      socket = new WebSocket(`ws://${window.location.host}/ws/telemetry${query}`)
+      socket.onopen = () => { delay = RECONNECT_MIN_MS }
+      socket.onmessage = (event) => {
+        try {
+          const frame = JSON.parse(event.data)
+          setTelemetry(state => merge(state, frame))
+        } catch {
+          // Ignore malformed frames
+        }
+      }
+      socket.onclose = () => {
+        setTelemetry(state => ({ ...state, connected: false }))
+        if (!closed) {
+          retry = setTimeout(connect, delay)
+          delay = Math.min(delay * 2, RECONNECT_MAX_MS)
+        }
+      }
+    }
+
+    connect()
+    return () => {
+      closed = true
+      clearTimeout(retry)
+      socket?.close()
+    }
+  }, [intervalMs])
+
+  return telemetry
+}
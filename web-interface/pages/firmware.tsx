@@ -1,7 +1,7 @@
 import { useState, useRef } from 'react'
 import Layout from '../components/Layout'
 import { useToast } from '../components/Toast'
-import { Upload, Loader2, FileText, Zap } from 'lucide-react'
+import { Upload, Loader2, FileText, Zap, Radio } from 'lucide-react'
 
 export default function FirmwarePage() {
   const toast = useToast()
@@ -9,6 +9,9 @@ export default function FirmwarePage() {
   const [uploading, setUploading] = useState(false)
   const [progress, setProgress] = useState(0)
   const fileInputRef = useRef<HTMLInputElement>(null)
+  const [container, setContainer] = useState<File | null>(null)
+  const [signature, setSignature] = useState<File | null>(null)
+  const [broadcasting, setBroadcasting] = useState(false)
 
   const handleFileSelect = (e: React.ChangeEvent<HTMLInputElement>) => {
     const selectedFile = e.target.files?.[0]
@@ -68,6 +71,30 @@ export default function FirmwarePage() {
     }
   }
 
+  // Multicast to the paired presenters: a .lcz container from sign_firmware.py --compress and the image's .sig
+  const handleBroadcast = async () => {
+    if (!container || !signature) return
+
+    setBroadcasting(true)
+    try {
+      const hex = (await signature.text()).trim()
+      const response = await fetch(`/api/fuota/broadcast?signature=${encodeURIComponent(hex)}`, {
+        method: 'POST',
+        body: container,
+      })
+      if (!response.ok) {
+        throw new Error(response.status === 409 ? 'A broadcast is already running' : response.statusText)
+      }
+      toast.success('Broadcast started; presenters reboot into the update when they have it')
+      setContainer(null)
+      setSignature(null)
+    } catch (error) {
+      toast.error(`Broadcast failed: ${error instanceof Error ? error.message : 'Unknown error'}`)
+    } finally {
+      setBroadcasting(false)
+    }
+  }
+
   const formatFileSize = (bytes: number) => {
     if (bytes === 0) return '0 Bytes'
     const k = 1024
@@ -166,6 +193,54 @@ export default function FirmwarePage() {
             </div>
           </div>
         </div>
+
+        <div className="card p-8">
+          <div className="space-y-6">
+            <div>
+              <h2 className="text-xl font-semibold mb-2 flex items-center space-x-2">
+                <Radio size={20} />
+                <span>Update Presenters over LoRa</span>
+              </h2>
+              <p className="text-gray-600 dark:text-gray-400">
+                Broadcast a signed container to every paired presenter at once. Presenters only accept a newer version.
+              </p>
+            </div>
+
+            <div className="grid gap-4 md:grid-cols-2">
+              <label className="block">
+                <span className="text-sm font-medium">Container (.lcz)</span>
+                <input
+                  type="file"
+                  accept=".lcz"
+                  onChange={(e) => setContainer(e.target.files?.[0] ?? null)}
+                  className="mt-1 block w-full text-sm"
+                  disabled={broadcasting}
+                />
+              </label>
+              <label className="block">
+                <span className="text-sm font-medium">Signature (.sig)</span>
+                <input
+                  type="file"
+                  accept=".sig"
+                  onChange={(e) => setSignature(e.target.files?.[0] ?? null)}
+                  className="mt-1 block w-full text-sm"
+                  disabled={broadcasting}
+                />
+              </label>
+            </div>
+
+            <div className="flex justify-end pt-4 border-t border-gray-200 dark:border-gray-700">
+              <button
+                onClick={handleBroadcast}
+                disabled={!container || !signature || broadcasting}
+                className="btn-primary disabled:opacity-50 disabled:cursor-not-allowed flex items-center space-x-2"
+              >
+                {broadcasting ? <Loader2 className="animate-spin" size={18} /> : <Radio size={18} />}
+                <span>{broadcasting ? 'Staging...' : 'Broadcast'}</span>
+              </button>
+            </div>
+          </div>
+        </div>
       </div>
     </Layout>
   )
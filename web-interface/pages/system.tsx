@@ -1,6 +1,7 @@
 import { useState, useEffect } from 'react'
 import Layout from '../components/Layout'
 import { useToast } from '../components/Toast'
+import { useTelemetry } from '../components/useTelemetry'
 import { RefreshCw, AlertTriangle, Loader2 } from 'lucide-react'
 
 interface SystemInfo {
@@ -24,6 +25,7 @@ export default function SystemPage() {
   const [info, setInfo] = useState<SystemInfo | null>(null)
   const [loading, setLoading] = useState(true)
   const [resetting, setResetting] = useState(false)
+  const telemetry = useTelemetry()
 
   const loadInfo = async () => {
     try {
@@ -38,10 +40,9 @@ export default function SystemPage() {
     }
   }
 
+  // Static info once; live values (uptime included) come from the telemetry stream
   useEffect(() => {
     loadInfo()
-    const interval = setInterval(loadInfo, 5000)
-    return () => clearInterval(interval)
   }, [])
 
   const handleFactoryReset = async () => {
@@ -141,7 +142,7 @@ export default function SystemPage() {
               <dl className="space-y-3">
                 <div>
                   <dt className="text-sm text-gray-500 dark:text-gray-400">Uptime</dt>
-                  <dd>{formatUptime(info.uptime_sec)}</dd>
+                  <dd>{formatUptime(telemetry.uptimeMs !== undefined ? Math.floor(telemetry.uptimeMs / 1000) : info.uptime_sec)}</dd>
                 </div>
                 <div>
                   <dt className="text-sm text-gray-500 dark:text-gray-400">Free Heap</dt>
@@ -149,6 +150,53 @@ export default function SystemPage() {
                 </div>
               </dl>
             </div>
+
+            <div className="card p-6">
+              <h2 className="text-lg font-semibold mb-4">
+                Live Status
+                <span className={`ml-2 inline-block w-2 h-2 rounded-full ${telemetry.connected ? 'bg-green-500' : 'bg-gray-400'}`} />
+              </h2>
+              <dl className="space-y-3">
+                <div>
+                  <dt className="text-sm text-gray-500 dark:text-gray-400">Mode</dt>
+                  <dd>{telemetry.mode ?? '-'}</dd>
+                </div>
+                <div>
+                  <dt className="text-sm text-gray-500 dark:text-gray-400">Battery</dt>
+                  <dd>{telemetry.battery ? `${telemetry.battery.level}%${telemetry.battery.charging ? ' (charging)' : ''}` : '-'}</dd>
+                </div>
+                <div>
+                  <dt className="text-sm text-gray-500 dark:text-gray-400">USB</dt>
+                  <dd>{telemetry.usb === undefined ? '-' : telemetry.usb ? 'Connected' : 'Disconnected'}</dd>
+                </div>
+                <div>
+                  <dt className="text-sm text-gray-500 dark:text-gray-400">LoRa Link</dt>
+                  <dd>{telemetry.lora ? (telemetry.lora.connected ? `Connected, ${telemetry.lora.rssi} dBm` : 'No link') : '-'}</dd>
+                </div>
+                {telemetry.loraCommand && (
+                  <div>
+                    <dt className="text-sm text-gray-500 dark:text-gray-400">LoRa Commands</dt>
+                    <dd className="font-mono text-sm">
+                      {telemetry.loraCommand.count} received, last {telemetry.loraCommand.command} at {telemetry.loraCommand.rssi} dBm
+                    </dd>
+                  </div>
+                )}
+                {telemetry.hid && (
+                  <div>
+                    <dt className="text-sm text-gray-500 dark:text-gray-400">HID Reports</dt>
+                    <dd className="font-mono text-sm">
+                      {telemetry.hid.count} received, last {telemetry.hid.report} from {telemetry.hid.deviceId.toString(16).padStart(4, '0')}
+                    </dd>
+                  </div>
+                )}
+                {telemetry.ota && telemetry.ota.status !== 'idle' && (
+                  <div>
+                    <dt className="text-sm text-gray-500 dark:text-gray-400">Firmware Update</dt>
+                    <dd>{telemetry.ota.status}, {telemetry.ota.percent}%</dd>
+                  </div>
+                )}
+              </dl>
+            </div>
           </div>
         )}
 